@@ -160,6 +160,16 @@ struct channel {
   LIST_ENTRY(channel) dpid_entry;
 
   struct ofp_async_config role_mask;
+
+  /* Reply suspended until the send queue is drained. */
+  channel_resume_proc_t resume_proc;
+  void (*resume_free)(void *arg);
+  void *resume_arg;
+  size_t resume_low;
+  bool resume_queued;
+  /* Messages received while the reply is suspended. */
+  TAILQ_HEAD(, channelq_data) deferred;
+  size_t deferred_num;
 };
 
 LIST_HEAD(channel_h, channel);
@@ -185,6 +195,8 @@ static bool channel_packet_ready(struct pbuf *pbuf, struct ofp_header *sneak);
 static void channel_event(struct channel *channel, enum channel_event cevent);
 static void channel_lock(struct channel *channel);
 static void channel_unlock(struct channel *channel);
+static size_t channel_send_queue_size_nolock(struct channel *channel);
+static void channel_suspend_drop_nolock(struct channel *channel);
 
 
 /* Non-blocking connect result check. */
@@ -259,6 +271,7 @@ channelq_data_create(struct channelq_data **retptr,
                           pbuf_plen_get(cdata->pbuf));
 
     cdata->channel = channel;
+    WHAT_TIME_IS_IT_NOW_IN_NSEC(cdata->time);
     *retptr = cdata;
 
     return true;
@@ -323,8 +336,9 @@ channel_read(struct channel *channel) {
     goto done;
   }
 
-  /* get channelq */
-  rc = ofp_handler_get_channelq(&channelq);
+  /* get channelq of the thread handling the bridge. */
+  rc = ofp_handler_get_channelq_by_dpid(channel_dpid_get_nolock(channel),
+                                        &channelq);
   if (rc != LAGOPUS_RESULT_OK) {
     goto done;
   }
@@ -379,6 +393,11 @@ channel_write_nolock(struct channel *channel) {
     return;
   }
 
+  /* Nothing to write, woken up for the suspended reply. */
+  if (pbuf_list_first(channel->out) == NULL) {
+    return;
+  }
+
   lagopus_msg_debug(10, "write_on\n");
   /* Write packet to the socket. */
   nbytes = pbuf_list_session_write(channel->out, channel->session);
@@ -410,9 +429,36 @@ channel_write_nolock(struct channel *channel) {
 /* Socket write function. */
 void
 channel_write(struct channel *channel) {
+  lagopus_result_t rc;
+  channelq_t *channelq;
+  struct channelq_data *cdata;
+
   channel_lock(channel);
   /* Clear event pointer. */
   channel_write_nolock(channel);
+
+  /* Resume the suspended reply in the ofp_handler thread. */
+  if (channel->resume_proc != NULL && channel->resume_queued == false &&
+      channel_send_queue_size_nolock(channel) <= channel->resume_low) {
+    rc = ofp_handler_get_channelq_by_dpid(channel_dpid_get_nolock(channel),
+                                          &channelq);
+    if (rc == LAGOPUS_RESULT_OK &&
+        (cdata = (struct channelq_data *)calloc(1, sizeof(*cdata))) != NULL) {
+      cdata->channel = channel;
+      cdata->pbuf = NULL;
+      WHAT_TIME_IS_IT_NOW_IN_NSEC(cdata->time);
+      channel->resume_queued = true;
+      channel_unlock(channel);
+      channel_refs_get(channel);
+      lagopus_bbq_put(channelq, &cdata, struct channel *, -1);
+      return;
+    }
+    /* No ofp_handler to queue, resume here not to leave it suspended. */
+    lagopus_msg_warning("resume the suspended reply in place.\n");
+    channel_unlock(channel);
+    (void) channel_send_resume(channel);
+    return;
+  }
   channel_unlock(channel);
   return;
 }
@@ -470,6 +516,191 @@ channel_send_packet(struct channel *channel, struct pbuf *pbuf) {
   channel_unlock(channel);
 }
 
+static size_t
+channel_send_queue_size_nolock(struct channel *channel) {
+  struct pbuf *pbuf;
+  size_t size = 0;
+
+  TAILQ_FOREACH(pbuf, &channel->out->tailq, entry) {
+    size += (size_t)(pbuf->putp - pbuf->getp);
+  }
+  return size;
+}
+
+size_t
+channel_send_queue_size(struct channel *channel) {
+  size_t size;
+
+  channel_lock(channel);
+  size = channel_send_queue_size_nolock(channel);
+  channel_unlock(channel);
+
+  return size;
+}
+
+lagopus_result_t
+channel_send_packet_bounded(struct channel *channel, struct pbuf *pbuf,
+                            size_t queue_max) {
+  lagopus_result_t res = LAGOPUS_RESULT_OK;
+  ssize_t nbytes;
+
+  if (channel == NULL || pbuf == NULL) {
+    return LAGOPUS_RESULT_INVALID_ARGS;
+  }
+
+  channel_lock(channel);
+  pbuf_list_add(channel->out, pbuf);
+  while (channel_send_queue_size_nolock(channel) > queue_max) {
+    nbytes = pbuf_list_session_write(channel->out, channel->session);
+    if (nbytes > 0) {
+      continue;
+    }
+    if (nbytes < 0 && errno == EAGAIN) {
+      /* socket buffer is full, written by the event manager. */
+      res = LAGOPUS_RESULT_BUSY;
+    } else {
+      lagopus_msg_warning("FAILED : write packet.\n");
+      res = LAGOPUS_RESULT_POSIX_API_ERROR;
+    }
+    break;
+  }
+  if (pbuf_list_first(channel->out) != NULL) {
+    channel_write_on(channel);
+  }
+  channel_unlock(channel);
+
+  return res;
+}
+
+lagopus_result_t
+channel_send_suspend(struct channel *channel, size_t queue_low,
+                     channel_resume_proc_t proc,
+                     void (*free_proc)(void *arg), void *arg) {
+  lagopus_result_t res;
+
+  if (channel == NULL || proc == NULL) {
+    return LAGOPUS_RESULT_INVALID_ARGS;
+  }
+
+  channel_lock(channel);
+  if (channel->resume_proc != NULL) {
+    res = LAGOPUS_RESULT_ALREADY_EXISTS;
+  } else if (channel_send_queue_size_nolock(channel) <= queue_low) {
+    res = LAGOPUS_RESULT_OK;
+  } else {
+    channel->resume_proc = proc;
+    channel->resume_free = free_proc;
+    channel->resume_arg = arg;
+    channel->resume_low = queue_low;
+    channel->resume_queued = false;
+    /* the queue may be drained before the next write event. */
+    channel_write_on(channel);
+    res = LAGOPUS_RESULT_BUSY;
+  }
+  channel_unlock(channel);
+
+  return res;
+}
+
+lagopus_result_t
+channel_send_resume(struct channel *channel) {
+  lagopus_result_t res = LAGOPUS_RESULT_OK;
+  channel_resume_proc_t proc;
+  void (*free_proc)(void *arg);
+  void *arg;
+
+  channel_lock(channel);
+  proc = channel->resume_proc;
+  free_proc = channel->resume_free;
+  arg = channel->resume_arg;
+  channel->resume_proc = NULL;
+  channel->resume_free = NULL;
+  channel->resume_arg = NULL;
+  channel->resume_queued = false;
+  channel_unlock(channel);
+
+  if (proc != NULL) {
+    res = proc(channel, arg);
+    if (res != LAGOPUS_RESULT_BUSY) {
+      if (free_proc != NULL) {
+        channel_lock(channel);
+        free_proc(arg);
+        channel_unlock(channel);
+      }
+    }
+  }
+
+  return res;
+}
+
+bool
+channel_send_is_suspended(struct channel *channel) {
+  bool ret;
+
+  channel_lock(channel);
+  ret = (channel->resume_proc != NULL);
+  channel_unlock(channel);
+
+  return ret;
+}
+
+lagopus_result_t
+channel_deferred_put(struct channel *channel, struct channelq_data *cdata) {
+  lagopus_result_t res;
+
+  channel_lock(channel);
+  if (channel->deferred_num >= CHANNEL_DEFERRED_MAX) {
+    res = LAGOPUS_RESULT_TOO_MANY_OBJECTS;
+  } else {
+    TAILQ_INSERT_TAIL(&channel->deferred, cdata, entry);
+    channel->deferred_num++;
+    res = LAGOPUS_RESULT_OK;
+  }
+  channel_unlock(channel);
+
+  return res;
+}
+
+struct channelq_data *
+channel_deferred_get(struct channel *channel) {
+  struct channelq_data *cdata;
+
+  channel_lock(channel);
+  cdata = TAILQ_FIRST(&channel->deferred);
+  if (cdata != NULL) {
+    TAILQ_REMOVE(&channel->deferred, cdata, entry);
+    channel->deferred_num--;
+  }
+  channel_unlock(channel);
+
+  return cdata;
+}
+
+/* Drop the suspended reply and deferred messages, assume channel locked. */
+static void
+channel_suspend_drop_nolock(struct channel *channel) {
+  struct channelq_data *cdata;
+
+  if (channel->resume_proc != NULL) {
+    lagopus_msg_info("suspended reply is dropped.\n");
+    if (channel->resume_free != NULL) {
+      channel->resume_free(channel->resume_arg);
+    }
+    channel->resume_proc = NULL;
+    channel->resume_free = NULL;
+    channel->resume_arg = NULL;
+  }
+  while ((cdata = TAILQ_FIRST(&channel->deferred)) != NULL) {
+    TAILQ_REMOVE(&channel->deferred, cdata, entry);
+    /* same as channelq_data_destroy() with the lock held. */
+    assert(channel->refs > 0);
+    channel->refs--;
+    pbuf_free(cdata->pbuf);
+    free(cdata);
+  }
+  channel->deferred_num = 0;
+}
+
 lagopus_result_t
 channel_send_packet_list(struct channel *channel,
                          struct pbuf_list *pbuf_list) {
@@ -598,6 +829,8 @@ channel_stop(struct channel *channel) {
   lagopus_msg_debug(10, "channel_stop(%p) is called, refs:%d\n",
                     channel, channel->refs);
 
+  channel_suspend_drop_nolock(channel);
+
   if (session_is_alive(channel->session)) {
     lagopus_msg_info("closing the socket %d\n",
                      session_sockfd_get(channel->session));
@@ -997,6 +1230,8 @@ channel_alloc_internal(lagopus_ip_address_t *controller) {
     free(channel);
     return NULL;
   }
+  TAILQ_INIT(&channel->deferred);
+  channel->deferred_num = 0;
   channel->out = pbuf_list_alloc();
   if (channel->out == NULL) {
     lagopus_ip_address_destroy(channel->controller);
@@ -1138,6 +1373,7 @@ channel_free(struct channel *channel) {
     channel->controller = NULL;
     lagopus_ip_address_destroy(channel->local_addr);
     channel->local_addr = NULL;
+    channel_suspend_drop_nolock(channel);
     pbuf_free(channel->in);
     pbuf_list_free(channel->out);
 
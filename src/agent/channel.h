@@ -44,11 +44,16 @@ enum channel_protocol {
 /* decl channelq_t */
 struct channelq_data {
   struct channel *channel;
-  struct pbuf *pbuf;
+  struct pbuf *pbuf;            /* NULL to resume a suspended reply. */
+  lagopus_chrono_t time;        /* enqueued time. */
+  TAILQ_ENTRY(channelq_data) entry;     /* deferred while suspended. */
 };
 
 #define SEC_TO_NSEC(a)  ((a) * 1000LL * 1000LL * 1000LL)
 
+/* Max messages deferred while a reply is suspended. */
+#define CHANNEL_DEFERRED_MAX 1024
+
 typedef LAGOPUS_BOUND_BLOCK_Q_DECL(channelq,
                                    struct channelq_data *) channelq_t;
 
@@ -349,6 +354,126 @@ channel_send_packet_by_event_nolock(struct channel *channel, struct pbuf *pbuf);
 void
 channel_send_packet_by_event(struct channel *channel, struct pbuf *pbuf);
 
+/**
+ * Procedure resuming a reply suspended by channel_send_suspend().
+ *
+ *  @param[in] channel  A channel pointer.
+ *  @param[in] arg      An argument given to channel_send_suspend().
+ *
+ *  @retval LAGOPUS_RESULT_OK Succeeded, the reply is completed.
+ *  @retval LAGOPUS_RESULT_BUSY The reply is suspended again.
+ *  @retval LAGOPUS_RESULT_ANY_FAILURES Failed, the reply is aborted.
+ *
+ */
+typedef lagopus_result_t
+(*channel_resume_proc_t)(struct channel *channel, void *arg);
+
+/**
+ * Send a packet to a controller without waiting.  The send queue is
+ * written while more than queue_max bytes are queued, and is left to
+ * the event manager when the socket is not writable.
+ *
+ *  @param[in] channel    A channel pointer.
+ *  @param[in] pbuf       A pbuf pointer.
+ *  @param[in] queue_max  Max bytes left in the send queue.
+ *
+ *  @retval LAGOPUS_RESULT_OK Succeeded.
+ *  @retval LAGOPUS_RESULT_BUSY Succeeded, but more than queue_max
+ *  bytes are left in the send queue.
+ *  @retval LAGOPUS_RESULT_INVALID_ARGS Failed, invalid args.
+ *  @retval LAGOPUS_RESULT_POSIX_API_ERROR Failed, write error.
+ *
+ */
+lagopus_result_t
+channel_send_packet_bounded(struct channel *channel, struct pbuf *pbuf,
+                            size_t queue_max);
+
+/**
+ * Suspend a reply until the send queue is drained down to queue_low
+ * bytes.  proc is called in the ofp_handler thread after the write
+ * event of the channel, and messages received from the channel are
+ * deferred until the reply is completed.
+ *
+ *  @param[in] channel    A channel pointer.
+ *  @param[in] queue_low  Bytes left in the send queue to resume.
+ *  @param[in] proc       Procedure resuming the reply.
+ *  @param[in] free_proc  Procedure freeing arg, called with the channel
+ *  locked when the reply is completed or the channel is stopped.
+ *  @param[in] arg        An argument of proc and free_proc.
+ *
+ *  @retval LAGOPUS_RESULT_BUSY Succeeded, the reply is suspended.
+ *  @retval LAGOPUS_RESULT_OK Not suspended, the send queue is already
+ *  drained.
+ *  @retval LAGOPUS_RESULT_INVALID_ARGS Failed, invalid args.
+ *  @retval LAGOPUS_RESULT_ALREADY_EXISTS Failed, another reply is
+ *  suspended.
+ *
+ */
+lagopus_result_t
+channel_send_suspend(struct channel *channel, size_t queue_low,
+                     channel_resume_proc_t proc,
+                     void (*free_proc)(void *arg), void *arg);
+
+/**
+ * Resume the suspended reply, called by the ofp_handler.
+ *
+ *  @param[in] channel  A channel pointer.
+ *
+ *  @retval Result of channel_resume_proc_t, LAGOPUS_RESULT_OK if no
+ *  reply is suspended.
+ *
+ */
+lagopus_result_t
+channel_send_resume(struct channel *channel);
+
+/**
+ * Is a reply suspended on the channel.
+ *
+ *  @param[in] channel  A channel pointer.
+ *
+ *  @retval true  Suspended.
+ *  @retval false Not suspended.
+ *
+ */
+bool
+channel_send_is_suspended(struct channel *channel);
+
+/**
+ * Get bytes left in the send queue.
+ *
+ *  @param[in] channel  A channel pointer.
+ *
+ *  @retval Bytes left in the send queue.
+ *
+ */
+size_t
+channel_send_queue_size(struct channel *channel);
+
+/**
+ * Defer a received message while a reply is suspended.
+ *
+ *  @param[in] channel  A channel pointer.
+ *  @param[in] cdata    channel queue data, owned by the channel.
+ *
+ *  @retval LAGOPUS_RESULT_OK                Succeeded.
+ *  @retval LAGOPUS_RESULT_TOO_MANY_OBJECTS  Too many messages are deferred,
+ *                                           cdata is not owned.
+ *
+ */
+lagopus_result_t
+channel_deferred_put(struct channel *channel, struct channelq_data *cdata);
+
+/**
+ * Get a deferred message.
+ *
+ *  @param[in] channel  A channel pointer.
+ *
+ *  @retval channel queue data, NULL if no message is deferred.
+ *
+ */
+struct channelq_data *
+channel_deferred_get(struct channel *channel);
+
 /**
  * Send packets to a controller.
  *
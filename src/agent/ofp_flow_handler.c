@@ -27,176 +27,252 @@
 #include "ofp_instruction.h"
 #include "ofp_tlv.h"
 
-static void
-s_ofp_flow_stats_list_elem_free(struct flow_stats_list *flow_stats_list) {
-  struct flow_stats *flow_stats;
+/* Bytes of replies queued in the channel before flow stats suspends. */
+#define FLOW_STATS_QUEUE_MAX (4 * 64 * 1024)
+/* Bytes of replies left in the channel to resume flow stats. */
+#define FLOW_STATS_QUEUE_LOW (FLOW_STATS_QUEUE_MAX / 2)
 
-  while ((flow_stats = TAILQ_FIRST(flow_stats_list)) != NULL) {
-    TAILQ_REMOVE(flow_stats_list, flow_stats, entry);
-    ofp_match_list_elem_free(&flow_stats->match_list);
-    ofp_instruction_list_elem_free(&flow_stats->instruction_list);
-    free(flow_stats);
-  }
-}
+/* flow_stats reply sent in OFP_PACKET_MAX_SIZE chunks. */
+struct flow_stats_stream {
+  struct channel *channel;
+  struct ofp_flow_stats_request request;
+  struct match_list match_list;
+  struct flow_stats_cursor cursor;
+  struct ofp_multipart_reply reply;
+  struct pbuf *pbuf;
+  int nflows;
+  bool full;
+};
 
+/* encode a flow_stats into the current chunk, called in flowdb walk. */
 static lagopus_result_t
-s_flow_stats_list_encode(struct pbuf_list *pbuf_list,
-                         struct pbuf **pbuf,
-                         struct flow_stats_list *flow_stats_list) {
+s_flow_stats_encode(void *arg,
+                    const struct ofp_flow_stats *flow_stats,
+                    struct match_list *match_list,
+                    struct instruction_list *instruction_list) {
   lagopus_result_t res = LAGOPUS_RESULT_ANY_FAILURES;
+  struct flow_stats_stream *stream = arg;
+  struct pbuf *pbuf = stream->pbuf;
+  pbuf_info_t pbuf_info;
   uint16_t match_total_len = 0;
   uint16_t instruction_total_len = 0;
   uint16_t flow_stats_len;
   uint8_t *flow_stats_head = NULL;
-  struct flow_stats *flow_stats = NULL;
-  struct pbuf *entry_pbuf = NULL;
 
-  if (TAILQ_EMPTY(flow_stats_list) == false) {
-    /* encode flow_stats list */
-    TAILQ_FOREACH(flow_stats, flow_stats_list, entry) {
-      entry_pbuf = pbuf_alloc(OFP_PACKET_MAX_SIZE);
-      if (entry_pbuf == NULL) {
-        res = LAGOPUS_RESULT_NO_MEMORY;
-        goto done;
-      }
-      entry_pbuf->plen = OFP_PACKET_MAX_SIZE;
+  pbuf_info_store(pbuf, &pbuf_info);
 
-      /* encode flow_stats */
-      res = ofp_flow_stats_encode(entry_pbuf, &(flow_stats->ofp));
-      if (res == LAGOPUS_RESULT_OK) {
+  res = ofp_flow_stats_encode(pbuf, flow_stats);
+  if (res == LAGOPUS_RESULT_OK) {
+    flow_stats_head = pbuf_putp_get(pbuf) - sizeof(struct ofp_flow_stats);
+    res = ofp_match_list_encode(pbuf, match_list, &match_total_len);
+  }
+  if (res == LAGOPUS_RESULT_OK) {
+    res = ofp_instruction_list_encode(pbuf, instruction_list,
+                                      &instruction_total_len);
+  }
+  if (res == LAGOPUS_RESULT_OK) {
+    flow_stats_len = match_total_len;
+    res = ofp_tlv_length_sum(&flow_stats_len, instruction_total_len);
+    if (res == LAGOPUS_RESULT_OK) {
+      res = ofp_tlv_length_sum(&flow_stats_len,
+                               sizeof(struct ofp_flow_stats));
+    }
+    if (res == LAGOPUS_RESULT_OK) {
+      res = ofp_multipart_length_set(flow_stats_head, flow_stats_len);
+    }
+  }
 
-        /* flow_stats head pointer. */
-        flow_stats_head = pbuf_putp_get(entry_pbuf) - sizeof(struct ofp_flow_stats);
+  if (res == LAGOPUS_RESULT_OK) {
+    stream->nflows++;
+  } else {
+    /* roll back, the flow is encoded into the next chunk. */
+    pbuf_info_load(pbuf, &pbuf_info);
+    if (res == LAGOPUS_RESULT_OUT_OF_RANGE) {
+      stream->full = true;
+    } else {
+      lagopus_msg_warning("FAILED : flow_stats encode (%s).\n",
+                          lagopus_error_get_string(res));
+    }
+  }
+  return res;
+}
 
-        /* encode match */
-        res = ofp_match_list_encode(entry_pbuf, &(flow_stats->match_list),
-                                    &match_total_len);
-        if (res == LAGOPUS_RESULT_OK) {
-          /* encode instruction */
-          res = ofp_instruction_list_encode(entry_pbuf,
-                                            &(flow_stats->instruction_list),
-                                            &instruction_total_len);
-          if (res == LAGOPUS_RESULT_OK) {
-            /* Set flow_stats length (match total length +       */
-            /*                        instruction total length + */
-            /*                        size of ofp_flow_stats).   */
-            /* And check overflow.                               */
-            flow_stats_len = match_total_len;
-            res = ofp_tlv_length_sum(&flow_stats_len, instruction_total_len);
-            if (res == LAGOPUS_RESULT_OK) {
-              res = ofp_tlv_length_sum(&flow_stats_len,
-                                       sizeof(struct ofp_flow_stats));
-              if (res == LAGOPUS_RESULT_OK) {
-                res = ofp_multipart_length_set(flow_stats_head,
-                                               flow_stats_len);
-                if (res == LAGOPUS_RESULT_OK) {
-                  res = ofp_multipart_append(pbuf_list, entry_pbuf, pbuf);
-                  if (res != LAGOPUS_RESULT_OK) {
-                    lagopus_msg_warning("FAILED (%s).\n",
-                                        lagopus_error_get_string(res));
-                  }
-                } else {
-                  lagopus_msg_warning("FAILED (%s).\n",
-                                      lagopus_error_get_string(res));
-                }
-              } else {
-                lagopus_msg_warning("over flow_stats length.\n");
-              }
-            } else {
-              lagopus_msg_warning("over flow_stats length.\n");
-            }
-          } else {
-            lagopus_msg_warning("FAILED : ofp_instruction_list_encode (%s).\n",
-                                lagopus_error_get_string(res));
-          }
-        } else {
-          lagopus_msg_warning("FAILED : ofp_match_list_encode (%s).\n",
-                              lagopus_error_get_string(res));
-        }
-      } else {
-        lagopus_msg_warning("FAILED : ofp_flow_stats_encode (%s).\n",
-                            lagopus_error_get_string(res));
-      }
+static lagopus_result_t
+s_flow_stats_chunk_start(struct flow_stats_stream *stream) {
+  lagopus_result_t res = LAGOPUS_RESULT_ANY_FAILURES;
 
-      pbuf_free(entry_pbuf);
-      entry_pbuf = NULL;
-      if (res != LAGOPUS_RESULT_OK) {
-        break;
-      }
-    }
-  } else {
-    /* flow_stats_list is empty. */
-    res = LAGOPUS_RESULT_OK;
+  stream->pbuf = channel_pbuf_list_get(stream->channel,
+                                       OFP_PACKET_MAX_SIZE);
+  if (stream->pbuf == NULL) {
+    return LAGOPUS_RESULT_NO_MEMORY;
   }
+  stream->nflows = 0;
+  stream->full = false;
 
-done:
+  /* encode header, multipart reply. length and flags are set in */
+  /* s_flow_stats_chunk_send(). */
+  pbuf_plen_set(stream->pbuf, OFP_PACKET_MAX_SIZE);
+  res = ofp_multipart_reply_encode(stream->pbuf, &stream->reply);
+  if (res != LAGOPUS_RESULT_OK) {
+    lagopus_msg_warning("FAILED : ofp_multipart_reply_encode (%s).\n",
+                        lagopus_error_get_string(res));
+    channel_pbuf_list_unget(stream->channel, stream->pbuf);
+    stream->pbuf = NULL;
+  }
   return res;
 }
 
-/* createflow_stats reply. */
-STATIC lagopus_result_t
-ofp_flow_stats_reply_create(struct channel *channel,
-                            struct pbuf_list **pbuf_list,
-                            struct flow_stats_list *flow_stats_list,
-                            struct ofp_header *xid_header) {
+static lagopus_result_t
+s_flow_stats_chunk_send(struct flow_stats_stream *stream, bool more) {
   lagopus_result_t res = LAGOPUS_RESULT_ANY_FAILURES;
+  struct pbuf *pbuf = stream->pbuf;
+  pbuf_info_t pbuf_info;
   uint16_t length = 0;
-  struct pbuf *pbuf = NULL;
-  struct ofp_multipart_reply reply;
 
-  /* check params */
-  if (channel != NULL && pbuf_list != NULL &&
-      flow_stats_list != NULL && xid_header != NULL) {
-    /* alloc */
-    *pbuf_list = pbuf_list_alloc();
-    if (*pbuf_list != NULL) {
-      pbuf = pbuf_list_last_get(*pbuf_list);
-      if (pbuf != NULL) {
-        /* set data. */
-        memset(&reply, 0, sizeof(reply));
-        ofp_header_set(&reply.header,
-                       channel_version_get(channel),
-                       OFPT_MULTIPART_REPLY,
-                       0, /* length set in ofp_header_length_set()  */
-                       xid_header->xid);
-        reply.type = OFPMP_FLOW;
+  res = pbuf_length_get(pbuf, &length);
+  if (res == LAGOPUS_RESULT_OK) {
+    /* rewrite header with length and flags. */
+    stream->reply.header.length = length;
+    stream->reply.flags = (more == true) ? OFPMPF_REPLY_MORE : 0;
+    pbuf_info_store(pbuf, &pbuf_info);
+    pbuf_reset(pbuf);
+    pbuf_plen_set(pbuf, sizeof(struct ofp_multipart_reply));
+    res = ofp_multipart_reply_encode(pbuf, &stream->reply);
+    pbuf_info_load(pbuf, &pbuf_info);
+  }
+  if (res != LAGOPUS_RESULT_OK) {
+    lagopus_msg_warning("FAILED (%s).\n", lagopus_error_get_string(res));
+    channel_pbuf_list_unget(stream->channel, pbuf);
+    stream->pbuf = NULL;
+    return res;
+  }
+  pbuf_plen_reset(pbuf);
 
-        /* encode header, multipart reply */
-        pbuf_plen_set(pbuf, pbuf_size_get(pbuf));
-        res = ofp_multipart_reply_encode(pbuf, &reply);
-        if (res == LAGOPUS_RESULT_OK) {
-          res = s_flow_stats_list_encode(*pbuf_list, &pbuf, flow_stats_list);
-          if (res == LAGOPUS_RESULT_OK) {
-            /* set packet length */
-            res = pbuf_length_get(pbuf, &length);
-            if (res == LAGOPUS_RESULT_OK) {
-              res = ofp_header_length_set(pbuf, length);
-              if (res == LAGOPUS_RESULT_OK) {
-                pbuf_plen_reset(pbuf);
-              } else {
-                lagopus_msg_warning("FAILED : ofp_header_length_set (%s).\n",
-                                    lagopus_error_get_string(res));
-              }
-            } else {
-              lagopus_msg_warning("FAILED (%s).\n",
-                                  lagopus_error_get_string(res));
-            }
-          }
-        } else {
-          lagopus_msg_warning("FAILED : ofp_multipart_reply_encode (%s).\n",
-                              lagopus_error_get_string(res));
-        }
+  /* the channel owns the chunk. */
+  stream->pbuf = NULL;
+  res = channel_send_packet_bounded(stream->channel, pbuf,
+                                    FLOW_STATS_QUEUE_MAX);
+  if (res != LAGOPUS_RESULT_OK && res != LAGOPUS_RESULT_BUSY) {
+    lagopus_msg_warning("Socket write error (%s).\n",
+                        lagopus_error_get_string(res));
+  }
+  return res;
+}
+
+static void
+s_flow_stats_stream_free(void *arg) {
+  struct flow_stats_stream *stream = arg;
+
+  ofp_match_list_elem_free(&stream->match_list);
+  free(stream);
+}
+
+static lagopus_result_t
+s_flow_stats_stream_resume(struct channel *channel, void *arg);
+
+/*
+ * walk flows and send flow_stats reply chunk by chunk.  When the
+ * controller is slow, the walk is suspended and resumed from the write
+ * event of the channel, not to block the ofp_handler thread.
+ */
+static lagopus_result_t
+s_flow_stats_stream_run(struct flow_stats_stream *stream,
+                        struct ofp_error *error) {
+  lagopus_result_t res = LAGOPUS_RESULT_OK;
+
+  while (res == LAGOPUS_RESULT_OK) {
+    if (stream->pbuf == NULL) {
+      res = s_flow_stats_chunk_start(stream);
+      if (res != LAGOPUS_RESULT_OK) {
+        break;
+      }
+    }
+    /* flowdb is unlocked between walks. */
+    res = ofp_flow_stats_walk(channel_dpid_get(stream->channel),
+                              &stream->request, &stream->match_list,
+                              &stream->cursor,
+                              s_flow_stats_encode, stream, error);
+    if (res != LAGOPUS_RESULT_OK) {
+      lagopus_msg_warning("flow_stats decode error (%s)\n",
+                          lagopus_error_get_string(res));
+    } else if (stream->cursor.done == true) {
+      res = s_flow_stats_chunk_send(stream, false);
+      if (res == LAGOPUS_RESULT_BUSY) {
+        /* last chunk, left to the event manager. */
+        res = LAGOPUS_RESULT_OK;
+      }
+      break;
+    } else if (stream->full == true) {
+      if (stream->nflows == 0) {
+        lagopus_msg_warning("over flow_stats length.\n");
+        res = LAGOPUS_RESULT_OUT_OF_RANGE;
       } else {
-        /* pbuf_list_last_get returns NULL */
-        res = LAGOPUS_RESULT_NO_MEMORY;
+        res = s_flow_stats_chunk_send(stream, true);
+        if (res == LAGOPUS_RESULT_BUSY) {
+          res = channel_send_suspend(stream->channel, FLOW_STATS_QUEUE_LOW,
+                                     s_flow_stats_stream_resume,
+                                     s_flow_stats_stream_free, stream);
+        }
       }
-    } else {
-      /* pbuf_list_alloc returns NULL */
-      res = LAGOPUS_RESULT_NO_MEMORY;
     }
+  }
+
+  if (stream->pbuf != NULL) {
+    channel_pbuf_list_unget(stream->channel, stream->pbuf);
+    stream->pbuf = NULL;
+  }
+  return res;
+}
+
+/* resume the suspended flow_stats reply, called in ofp_handler. */
+static lagopus_result_t
+s_flow_stats_stream_resume(struct channel *channel, void *arg) {
+  lagopus_result_t res = LAGOPUS_RESULT_ANY_FAILURES;
+  struct flow_stats_stream *stream = arg;
+  struct ofp_error error;
+
+  (void) channel;
+
+  res = s_flow_stats_stream_run(stream, &error);
+  if (res != LAGOPUS_RESULT_OK && res != LAGOPUS_RESULT_BUSY) {
+    /* OFPMPF_REPLY_MORE is already sent, the reply is truncated. */
+    lagopus_msg_warning("flow_stats reply aborted (%s).\n",
+                        lagopus_error_get_string(res));
+  }
+  return res;
+}
+
+static lagopus_result_t
+s_flow_stats_reply_stream(struct channel *channel,
+                          struct ofp_flow_stats_request *request,
+                          struct match_list *match_list,
+                          struct ofp_header *xid_header,
+                          struct ofp_error *error) {
+  lagopus_result_t res = LAGOPUS_RESULT_ANY_FAILURES;
+  struct flow_stats_stream *stream;
+
+  stream = (struct flow_stats_stream *)calloc(1, sizeof(*stream));
+  if (stream == NULL) {
+    return LAGOPUS_RESULT_NO_MEMORY;
+  }
+  stream->channel = channel;
+  stream->request = *request;
+  /* the stream takes matches, may live after the request. */
+  TAILQ_INIT(&stream->match_list);
+  TAILQ_CONCAT(&stream->match_list, match_list, entry);
+  ofp_header_set(&stream->reply.header,
+                 channel_version_get(channel),
+                 OFPT_MULTIPART_REPLY,
+                 0, /* length set in s_flow_stats_chunk_send() */
+                 xid_header->xid);
+  stream->reply.type = OFPMP_FLOW;
+
+  res = s_flow_stats_stream_run(stream, error);
+  if (res == LAGOPUS_RESULT_BUSY) {
+    /* suspended, the channel owns the stream. */
+    res = LAGOPUS_RESULT_OK;
   } else {
-    /* params are NULL */
-    res = LAGOPUS_RESULT_INVALID_ARGS;
+    s_flow_stats_stream_free(stream);
   }
   return res;
 }
@@ -207,10 +283,8 @@ ofp_flow_stats_request_handle(struct channel *channel, struct pbuf *pbuf,
                               struct ofp_header *xid_header,
                               struct ofp_error *error) {
   lagopus_result_t res = LAGOPUS_RESULT_ANY_FAILURES;
-  struct pbuf_list *send_pbuf_list = NULL;
   struct ofp_flow_stats_request request;
   struct match_list match_list;
-  struct flow_stats_list flow_stats_list;
 
   /* check params */
   if (channel != NULL && pbuf != NULL &&
@@ -220,40 +294,19 @@ ofp_flow_stats_request_handle(struct channel *channel, struct pbuf *pbuf,
     if (res == LAGOPUS_RESULT_OK) {
       /* init. */
       TAILQ_INIT(&match_list);
-      TAILQ_INIT(&flow_stats_list);
 
       /* decode */
       if ((res = ofp_match_parse(channel, pbuf, &match_list, error))
           != LAGOPUS_RESULT_OK) {
         lagopus_msg_warning("match decode error (%s)\n",
                             lagopus_error_get_string(res));
-      } else if ((res = ofp_flow_stats_get(
-                          channel_dpid_get(channel),
-                          &request, &match_list, &flow_stats_list, error))
-                 != LAGOPUS_RESULT_OK) {
-        lagopus_msg_warning("flow_stats decode error (%s)\n",
-                            lagopus_error_get_string(res));
       } else {                  /* decode success */
-        /* create flow_stats_reply. */
-        res = ofp_flow_stats_reply_create(channel, &send_pbuf_list,
-                                          &flow_stats_list,
-                                          xid_header);
-        if (res == LAGOPUS_RESULT_OK) {
-          /* send flow_stats reply */
-          res = channel_send_packet_list(channel, send_pbuf_list);
-          if (res != LAGOPUS_RESULT_OK) {
-            lagopus_msg_warning("Socket write error (%s).\n",
-                                lagopus_error_get_string(res));
-          }
-        } else {
-          lagopus_msg_warning("reply creation failed, (%s).\n",
-                              lagopus_error_get_string(res));
-        }
-        pbuf_list_free(send_pbuf_list);
+        /* encode flow_stats directly into reply chunks. */
+        res = s_flow_stats_reply_stream(channel, &request, &match_list,
+                                        xid_header, error);
       }
 
       ofp_match_list_elem_free(&match_list);
-      s_ofp_flow_stats_list_elem_free(&flow_stats_list);
     } else {
       lagopus_msg_warning("flow_stats_request decode error (%s)\n",
                           lagopus_error_get_string(res));
@@ -43,23 +43,4 @@ ofp_flow_stats_request_handle(struct channel *channel, struct pbuf *pbuf,
                               struct ofp_header *xid_header,
                               struct ofp_error *error);
 
-#ifdef __UNIT_TESTING__
-/**
- * Create ofp_flow_stats_reply.
- *
- *     @param[in]	channel	A pointer to \e channel structure.
- *     @param[out]	pbuf_list	A pointer to list of \e pbuf structures.
- *     @param[in]	flow_stats_list	A pointer to ist of \e flow_stats structures.
- *     @param[in]	xid_header	A pointer to \e ofp_header structure.
- *
- *     @retval	LAGOPUS_RESULT_OK	Succeeded.
- *     @retval	LAGOPUS_RESULT_ANY_FAILURES Failed.
- */
-lagopus_result_t
-ofp_flow_stats_reply_create(struct channel *channel,
-                            struct pbuf_list **pbuf_list,
-                            struct flow_stats_list *flow_stats_list,
-                            struct ofp_header *xid_header);
-#endif /* __UNIT_TESTING__ */
-
 #endif /* __OFP_FLOW_HANDLER_H__ */
@@ -63,18 +63,29 @@ struct ofp_handler_record {
 
   enum ofp_handler_running_status  m_status;
   lagopus_mutex_t m_status_lock;   /* lock of m_status */
+
+  uint16_t m_idx;                  /* index of handler threads */
+  volatile uint64_t m_n_requests;  /* processed channelq entries */
+  volatile uint64_t m_n_echoes;    /* processed echo requests */
+  volatile uint64_t m_latency_sum; /* sum of time in channelq (nsec) */
+  volatile uint64_t m_latency_max; /* max time in channelq (nsec) */
 };
 typedef struct ofp_handler_record *ofp_handler_t;
 
 /*
  * values
  */
+/* s_ofp_handler is s_ofp_handlers[0], the thread of the module. */
+static ofp_handler_t s_ofp_handlers[OFP_HANDLER_THREADS_MAX];
 static ofp_handler_t s_ofp_handler = NULL;
 static pthread_once_t s_initialized = PTHREAD_ONCE_INIT;
 static volatile bool s_is_started = false;
 static volatile bool s_is_running = false;
 static volatile uint16_t channelq_size = CHANNELQ_SIZE;
 static volatile uint16_t channelq_max_batches = CHANNELQ_SIZE;
+/* number of threads, configured and running. */
+static volatile uint16_t handler_threads = 1;
+static volatile uint16_t s_n_handlers = 1;
 
 /*
  * prototype
@@ -94,6 +105,8 @@ s_process_eventq_entry(struct ofp_bridge *ofp_bridge,
 static inline bool
 s_validate_ofp_handler(void);
 static inline bool
+s_validate_handler(ofp_handler_t thd);
+static inline bool
 s_ofp_handler_is_canceled(void);
 /* thread procs */
 static lagopus_result_t
@@ -110,32 +123,42 @@ s_ofph_thread_freeup(const lagopus_thread_t *selfptr,
 static void
 s_initialize_once(void);
 static inline lagopus_result_t
-s_recreate(void);
+s_recreate(ofp_handler_t thd);
 static inline void
-s_destroy_for_recreate(void);
+s_destroy_for_recreate(ofp_handler_t thd);
 /* channel_free() wrapper for bbq */
 static void
 s_channel_freeup_proc(void **val);
 /* dequeue(or enqueue) each queues */
 static inline lagopus_result_t
-s_channelq_dequeue(channelq_t *q_ptr,
+s_channelq_dequeue(ofp_handler_t thd,
                    lagopus_qmuxer_poll_t qpoll);
 static inline lagopus_result_t
-s_eventq_dequeue(struct ofp_bridge *ofp_bridge,
+s_eventq_dequeue(ofp_handler_t thd,
+                 struct ofp_bridge *ofp_bridge,
                  lagopus_qmuxer_poll_t qpoll);
 static inline lagopus_result_t
-s_dataq_dequeue(struct ofp_bridge *ofp_bridge,
+s_dataq_dequeue(ofp_handler_t thd,
+                struct ofp_bridge *ofp_bridge,
                 lagopus_qmuxer_poll_t qpoll);
 #ifdef OFPH_POLL_WRITING
 static inline lagopus_result_t
-s_event_dataq_enqueue(struct ofp_bridge *ofp_bridge,
-                      lagopus_qmuxer_poll_t *poll_ptr);
+s_event_dataq_enqueue(ofp_handler_t thd,
+                      struct ofp_bridge *ofp_bridge,
+                      lagopus_qmuxer_poll_t qpoll);
 #endif  /* OFPH_POLL_WRITING */
+/* sharding of bridges */
+static inline uint16_t
+s_dpid_to_idx(uint64_t dpid);
+static uint64_t
+s_bridgeqs_filter(ofp_handler_t thd,
+                  struct ofp_bridgeq *bridgeqs[],
+                  uint64_t n_bridgeqs);
 /* management m_shutdowned */
 static inline enum ofp_handler_running_status
-s_get_status(void);
+s_get_status(ofp_handler_t thd);
 static inline void
-s_set_status(enum ofp_handler_running_status set);
+s_set_status(ofp_handler_t thd, enum ofp_handler_running_status set);
 
 
 
@@ -161,20 +184,30 @@ ofp_handler_initialize(void *arg,
 lagopus_result_t
 ofp_handler_start(void) {
   lagopus_result_t res = LAGOPUS_RESULT_ANY_FAILURES;
+  uint16_t i;
+
   lagopus_msg_info("called.\n");
   if (s_validate_ofp_handler() == true) {
-    if (s_get_status() != OFPH_RUNNING) {
+    if (s_get_status(s_ofp_handler) != OFPH_RUNNING) {
       mbar();
       s_is_running = true;
-      s_set_status(OFPH_RUNNING);
-      res = s_recreate();
-      if (res == LAGOPUS_RESULT_OK) {
-        res = lagopus_thread_start((lagopus_thread_t *)&s_ofp_handler, false);
-        if (res != LAGOPUS_RESULT_OK) {
+      s_n_handlers = handler_threads;
+      lagopus_msg_info("start %"PRIu16" handler threads.\n", s_n_handlers);
+      /* start others first, thread 0 waits for them at shutdown. */
+      for (i = s_n_handlers; i > 0; i--) {
+        s_set_status(s_ofp_handlers[i - 1], OFPH_RUNNING);
+        res = s_recreate(s_ofp_handlers[i - 1]);
+        if (res == LAGOPUS_RESULT_OK) {
+          res = lagopus_thread_start((lagopus_thread_t *)
+                                     &s_ofp_handlers[i - 1], false);
+          if (res != LAGOPUS_RESULT_OK) {
+            lagopus_perror(res);
+            break;
+          }
+        } else {
           lagopus_perror(res);
+          break;
         }
-      } else {
-        lagopus_perror(res);
       }
     } else {
       res = LAGOPUS_RESULT_ALREADY_EXISTS;
@@ -189,6 +222,7 @@ lagopus_result_t
 ofp_handler_shutdown(shutdown_grace_level_t level) {
   lagopus_result_t res = LAGOPUS_RESULT_ANY_FAILURES;
   bool is_valid = false;
+  uint16_t i;
 
   lagopus_msg_info("called. (level:%d)\n", level);
   if (s_ofp_handler != NULL) {
@@ -198,16 +232,18 @@ ofp_handler_shutdown(shutdown_grace_level_t level) {
       if (is_valid == true) {
         mbar();
         s_is_running = false;
-        switch (level) {
-          case SHUTDOWN_RIGHT_NOW:
-            s_set_status(OFPH_SHUTDOWN_RIGHT_NOW);
-            break;
-          case SHUTDOWN_GRACEFULLY:
-            s_set_status(OFPH_SHUTDOWN_GRACEFULLY);
-            break;
-          default:
-            res = LAGOPUS_RESULT_INVALID_ARGS;
-            break;
+        for (i = 0; i < s_n_handlers && res == LAGOPUS_RESULT_OK; i++) {
+          switch (level) {
+            case SHUTDOWN_RIGHT_NOW:
+              s_set_status(s_ofp_handlers[i], OFPH_SHUTDOWN_RIGHT_NOW);
+              break;
+            case SHUTDOWN_GRACEFULLY:
+              s_set_status(s_ofp_handlers[i], OFPH_SHUTDOWN_GRACEFULLY);
+              break;
+            default:
+              res = LAGOPUS_RESULT_INVALID_ARGS;
+              break;
+          }
         }
         if (res != LAGOPUS_RESULT_OK) {
           lagopus_perror(res);
@@ -229,9 +265,18 @@ ofp_handler_shutdown(shutdown_grace_level_t level) {
 lagopus_result_t
 ofp_handler_stop(void) {
   lagopus_result_t res = LAGOPUS_RESULT_ANY_FAILURES;
+  uint16_t i;
+
   lagopus_msg_info("called.\n");
   if (s_validate_ofp_handler() == true
       && s_ofp_handler_is_canceled() == false) {
+    /* thread 0 is the last, it clears bridgeqs. */
+    for (i = s_n_handlers; i > 1; i--) {
+      if (s_validate_handler(s_ofp_handlers[i - 1]) == true) {
+        (void)lagopus_thread_cancel((lagopus_thread_t *)
+                                    &s_ofp_handlers[i - 1]);
+      }
+    }
     res = lagopus_thread_cancel((lagopus_thread_t *)&s_ofp_handler);
   }
   return res;
@@ -239,9 +284,17 @@ ofp_handler_stop(void) {
 
 void
 ofp_handler_finalize(void) {
+  uint16_t i;
+
   lagopus_msg_info("called.\n");
   if (s_validate_ofp_handler() == true) {
+    for (i = OFP_HANDLER_THREADS_MAX; i > 1; i--) {
+      if (s_validate_handler(s_ofp_handlers[i - 1]) == true) {
+        lagopus_thread_destroy((lagopus_thread_t *)&s_ofp_handlers[i - 1]);
+      }
+    }
     lagopus_thread_destroy((lagopus_thread_t *)&s_ofp_handler);
+    s_ofp_handlers[0] = NULL;
   }
 }
 
@@ -276,6 +329,33 @@ ofp_handler_get_channelq(lagopus_bbq_t **retptr) {
   return res;
 }
 
+lagopus_result_t
+ofp_handler_get_channelq_by_dpid(uint64_t dpid, lagopus_bbq_t **retptr) {
+  lagopus_result_t res = LAGOPUS_RESULT_ANY_FAILURES;
+  ofp_handler_t thd;
+
+  lagopus_msg_debug(1, "called. (dpid: %"PRIu64", retptr: %p)\n",
+                    dpid, retptr);
+  if (retptr != NULL) {
+    if (s_validate_ofp_handler() == true) {
+      thd = s_ofp_handlers[s_dpid_to_idx(dpid)];
+      if (s_validate_handler(thd) == true && thd->m_channelq != NULL) {
+        *retptr = &(thd->m_channelq);
+        res = LAGOPUS_RESULT_OK;
+      } else {
+        lagopus_msg_error("ofp-handler thread is invalid.\n");
+        res = LAGOPUS_RESULT_INVALID_OBJECT;
+      }
+    } else {
+      lagopus_msg_error("ofp-handler thread is invalid.\n");
+      res = LAGOPUS_RESULT_INVALID_OBJECT;
+    }
+  } else {
+    res = LAGOPUS_RESULT_INVALID_ARGS;
+  }
+  return res;
+}
+
 lagopus_result_t
 ofp_handler_dataq_data_put(uint64_t dpid,
                            struct eventq_data **data,
@@ -305,6 +385,39 @@ ofp_handler_dataq_data_put(uint64_t dpid,
   return ret;
 }
 
+lagopus_result_t
+ofp_handler_dataq_data_put_n(uint64_t dpid,
+                             struct eventq_data **data,
+                             size_t n,
+                             size_t *n_put,
+                             lagopus_chrono_t timeout) {
+  lagopus_result_t ret = LAGOPUS_RESULT_ANY_FAILURES;
+  struct ofp_bridgeq *bridgeq;
+  struct ofp_bridge *bridge;
+
+  /* check params */
+  if (data != NULL && n_put != NULL) {
+    *n_put = 0;
+    /* find ofp_bridge */
+    ret = ofp_bridgeq_mgr_bridge_lookup(dpid, &bridgeq);
+    if (ret == LAGOPUS_RESULT_OK) {
+      bridge = ofp_bridgeq_mgr_bridge_get(bridgeq);
+      ret = lagopus_bbq_put_n(&bridge->dataq,
+                              data, n,
+                              struct eventq_data *,
+                              timeout, n_put);
+      if (ret >= 0) {
+        ret = LAGOPUS_RESULT_OK;
+      }
+      ofp_bridgeq_mgr_bridgeq_free(bridgeq);
+    }
+  } else {
+    ret = LAGOPUS_RESULT_INVALID_ARGS;
+  }
+
+  return ret;
+}
+
 lagopus_result_t
 ofp_handler_eventq_data_put(uint64_t dpid,
                             struct eventq_data **data,
@@ -334,6 +447,41 @@ ofp_handler_eventq_data_put(uint64_t dpid,
   return ret;
 }
 
+lagopus_result_t
+ofp_handler_eventq_data_put_n(uint64_t dpid,
+                              struct eventq_data **data,
+                              size_t n,
+                              size_t *n_put,
+                              lagopus_chrono_t timeout) {
+  lagopus_result_t ret = LAGOPUS_RESULT_ANY_FAILURES;
+  struct ofp_bridgeq *bridgeq;
+  struct ofp_bridge *bridge;
+
+  /* check params */
+  if (data != NULL && n_put != NULL) {
+    *n_put = 0;
+    /* find ofp_bridge */
+    ret = ofp_bridgeq_mgr_bridge_lookup(dpid, &bridgeq);
+    if (ret == LAGOPUS_RESULT_OK) {
+      bridge = ofp_bridgeq_mgr_bridge_get(bridgeq);
+      ret = lagopus_bbq_put_n(&bridge->eventq,
+                              data, n,
+                              struct eventq_data *,
+                              timeout, n_put);
+      if (ret >= 0) {
+        ret = LAGOPUS_RESULT_OK;
+      }
+      ofp_bridgeq_mgr_bridgeq_free(bridgeq);
+    } else {
+      lagopus_perror(ret);
+    }
+  } else {
+    ret = LAGOPUS_RESULT_INVALID_ARGS;
+  }
+
+  return ret;
+}
+
 lagopus_result_t
 ofp_handler_event_dataq_data_get(uint64_t dpid,
                                  struct eventq_data **data,
@@ -392,6 +540,8 @@ lagopus_result_t
 ofp_handler_channelq_stats_get(uint16_t *val) {
   lagopus_result_t res = LAGOPUS_RESULT_ANY_FAILURES;
   bool is_valid = false;
+  uint64_t sum = 0;
+  uint16_t i;
 
   if (val != NULL) {
     if (s_ofp_handler != NULL) {
@@ -399,9 +549,15 @@ ofp_handler_channelq_stats_get(uint16_t *val) {
                                     &is_valid);
       if (res == LAGOPUS_RESULT_OK) {
         if (is_valid == true) {
-          res = lagopus_bbq_size(&(s_ofp_handler->m_channelq));
+          for (i = 0; i < s_n_handlers; i++) {
+            res = lagopus_bbq_size(&(s_ofp_handlers[i]->m_channelq));
+            if (res < LAGOPUS_RESULT_OK) {
+              break;
+            }
+            sum += (uint64_t) res;
+          }
           if (res >= LAGOPUS_RESULT_OK) {
-            *val = (uint16_t) res;
+            *val = (sum <= UINT16_MAX) ? (uint16_t) sum : UINT16_MAX;
             res = LAGOPUS_RESULT_OK;
           }
         } else {
@@ -422,19 +578,92 @@ ofp_handler_channelq_stats_get(uint16_t *val) {
   return res;
 }
 
+lagopus_result_t
+ofp_handler_threads_set(uint16_t val) {
+  if (val == 0 || val > OFP_HANDLER_THREADS_MAX) {
+    return LAGOPUS_RESULT_OUT_OF_RANGE;
+  }
+  mbar();
+  handler_threads = val;
+  lagopus_msg_info("set handler_threads: %"PRIu16".\n", val);
+  return LAGOPUS_RESULT_OK;
+}
+
+uint16_t
+ofp_handler_threads_get(void) {
+  return handler_threads;
+}
+
+lagopus_result_t
+ofp_handler_thread_stats_get(uint16_t idx, struct ofp_handler_stats *stats) {
+  lagopus_result_t res = LAGOPUS_RESULT_ANY_FAILURES;
+  struct ofp_bridgeq *bridgeqs[MAX_BRIDGES];
+  struct ofp_bridge *bridge;
+  uint64_t n_bridgeqs = 0;
+  uint64_t i;
+  ofp_handler_t thd;
+
+  if (stats == NULL) {
+    return LAGOPUS_RESULT_INVALID_ARGS;
+  }
+  if (s_validate_ofp_handler() == false) {
+    return LAGOPUS_RESULT_INVALID_OBJECT;
+  }
+  if (idx >= s_n_handlers) {
+    return LAGOPUS_RESULT_OUT_OF_RANGE;
+  }
+  thd = s_ofp_handlers[idx];
+  memset(stats, 0, sizeof(*stats));
+
+  res = lagopus_bbq_size(&(thd->m_channelq));
+  if (res > 0) {
+    stats->channelq_entries = (uint64_t) res;
+  }
+  res = ofp_bridgeq_mgr_bridgeqs_to_array(bridgeqs, &n_bridgeqs,
+                                          MAX_BRIDGES);
+  if (res != LAGOPUS_RESULT_OK) {
+    return res;
+  }
+  for (i = 0; i < n_bridgeqs; i++) {
+    bridge = ofp_bridgeq_mgr_bridge_get(bridgeqs[i]);
+    if (bridge != NULL && s_dpid_to_idx(bridge->dpid) == idx) {
+      stats->bridges++;
+      res = lagopus_bbq_size(&(bridge->eventq));
+      if (res > 0) {
+        stats->eventq_entries += (uint64_t) res;
+      }
+      res = lagopus_bbq_size(&(bridge->dataq));
+      if (res > 0) {
+        stats->dataq_entries += (uint64_t) res;
+      }
+    }
+  }
+  ofp_bridgeq_mgr_bridgeqs_free(bridgeqs, n_bridgeqs);
+
+  stats->requests = thd->m_n_requests;
+  stats->echo_requests = thd->m_n_echoes;
+  if (stats->requests != 0) {
+    stats->latency_avg = thd->m_latency_sum / stats->requests;
+  }
+  stats->latency_max = thd->m_latency_max;
+
+  return LAGOPUS_RESULT_OK;
+}
+
 /*
  * private functions
  */
-/* initialize thread. it runs only once. */
-static void
-s_initialize_once(void) {
+/* create a handler thread. */
+static ofp_handler_t
+s_create_handler(uint16_t idx) {
   lagopus_result_t res = LAGOPUS_RESULT_ANY_FAILURES;
   lagopus_qmuxer_poll_t *polls = NULL;
+  ofp_handler_t thd = NULL;
+  char name[32];
 
-  lagopus_msg_debug(10, "called.\n");
   /* allocate thread */
-  s_ofp_handler = (ofp_handler_t)malloc(sizeof(*s_ofp_handler));
-  if (s_ofp_handler == NULL) {
+  thd = (ofp_handler_t)malloc(sizeof(*thd));
+  if (thd == NULL) {
     lagopus_exit_fatal("ofp_handler_initialize:allocate ofp_handler");
   }
 
@@ -445,41 +674,69 @@ s_initialize_once(void) {
   }
 
   /* init lagopus_thread_t */
-  res = lagopus_thread_create((lagopus_thread_t *)&s_ofp_handler,
+  if (idx == 0) {
+    snprintf(name, sizeof(name), "ofp_handler");
+  } else {
+    snprintf(name, sizeof(name), "ofp_handler%"PRIu16, idx);
+  }
+  res = lagopus_thread_create((lagopus_thread_t *)&thd,
                               s_ofph_thread_main, s_ofph_thread_shutdown,
-                              s_ofph_thread_freeup, "ofp_handler", NULL);
+                              s_ofph_thread_freeup, name, NULL);
   if (res != LAGOPUS_RESULT_OK) {
     lagopus_exit_fatal("ofp_handler_initialize:lagopus_thread_crate (%s)",
                        lagopus_error_get_string(res));
   }
   /* set thread_free_when_destroy */
-  lagopus_thread_free_when_destroy((lagopus_thread_t *)&s_ofp_handler);
+  lagopus_thread_free_when_destroy((lagopus_thread_t *)&thd);
 
   /* create mutex */
-  res = lagopus_mutex_create(&(s_ofp_handler->m_status_lock));
+  res = lagopus_mutex_create(&(thd->m_status_lock));
   if (res != LAGOPUS_RESULT_OK) {
     lagopus_exit_fatal("ofp_handler_initialize:lagopus_mutex_create (%s)",
                        lagopus_error_get_string(res));
   }
   /* Create the qmuxer. */
-  res = lagopus_qmuxer_create(&(s_ofp_handler->muxer));
+  res = lagopus_qmuxer_create(&(thd->muxer));
   if (res != LAGOPUS_RESULT_OK) {
     lagopus_exit_fatal("ofp_handler_initialize:lagopus_qmuxer_create (%s)",
                        lagopus_error_get_string(res));
   }
 
+  /* init other */
+  thd->m_channelq = NULL;
+  thd->m_status = OFPH_SHUTDOWNED;
+  thd->m_polls = polls;
+  thd->m_n_polls = 0;
+  thd->m_idx = idx;
+  thd->m_n_requests = 0;
+  thd->m_n_echoes = 0;
+  thd->m_latency_sum = 0;
+  thd->m_latency_max = 0;
+  lagopus_msg_debug(1, "created. (retptr: %p)\n", thd);
+
+  return thd;
+}
+
+/* initialize thread. it runs only once. */
+static void
+s_initialize_once(void) {
+  uint16_t i;
+
+  lagopus_msg_debug(10, "called.\n");
+  /* create all, threads as many as configured are started. */
+  for (i = 0; i < OFP_HANDLER_THREADS_MAX; i++) {
+    s_ofp_handlers[i] = s_create_handler(i);
+  }
+  s_ofp_handler = s_ofp_handlers[0];
+
   /* Register queue put function. */
   dp_dataq_put_func_register(ofp_handler_dataq_data_put);
   dp_eventq_put_func_register(ofp_handler_eventq_data_put);
+  dp_dataq_put_n_func_register(ofp_handler_dataq_data_put_n);
+  dp_eventq_put_n_func_register(ofp_handler_eventq_data_put_n);
 
   ofp_bridgeq_mgr_initialize(NULL);
 
-  /* init other */
-  s_set_status(OFPH_SHUTDOWNED);
-  s_ofp_handler->m_polls = polls;
-  s_ofp_handler->m_n_polls = 0;
-  lagopus_msg_debug(1, "created. (retptr: %p)\n", s_ofp_handler);
-
   return;
 }
 
@@ -501,6 +758,24 @@ s_validate_ofp_handler(void) {
   }
 }
 
+/* if thd is valid thread, return true */
+static inline bool
+s_validate_handler(ofp_handler_t thd) {
+  lagopus_result_t res = LAGOPUS_RESULT_ANY_FAILURES;
+  bool is_valid = false;
+
+  if (thd == NULL) {
+    return false;
+  }
+  res = lagopus_thread_is_valid((const lagopus_thread_t *)&thd,
+                                &is_valid);
+  if (res == LAGOPUS_RESULT_OK && is_valid == true) {
+    return true;
+  } else {
+    return false;
+  }
+}
+
 /* if ptr is chanceled thread, return true */
 static inline bool
 s_ofp_handler_is_canceled(void) {
@@ -841,7 +1116,7 @@ done:
 
 /* read each queues. */
 static lagopus_result_t
-s_dequeue(struct ofp_bridgeq *brqs) {
+s_dequeue(ofp_handler_t thd, struct ofp_bridgeq *brqs) {
   lagopus_result_t res = LAGOPUS_RESULT_ANY_FAILURES;
   struct ofp_bridge *bridge;
   lagopus_qmuxer_poll_t qpoll;
@@ -849,20 +1124,20 @@ s_dequeue(struct ofp_bridgeq *brqs) {
   if (brqs != NULL) {
     bridge = ofp_bridgeq_mgr_bridge_get(brqs);
     qpoll = ofp_bridgeq_mgr_eventq_poll_get(brqs);
-    res = s_eventq_dequeue(bridge, qpoll);
+    res = s_eventq_dequeue(thd, bridge, qpoll);
     if (res != LAGOPUS_RESULT_OK) {
       lagopus_perror(res);
       goto done;
     }
     qpoll = ofp_bridgeq_mgr_dataq_poll_get(brqs);
-    res = s_dataq_dequeue(bridge, qpoll);
+    res = s_dataq_dequeue(thd, bridge, qpoll);
     if (res != LAGOPUS_RESULT_OK) {
       lagopus_perror(res);
       goto done;
     }
 #ifdef OFPH_POLL_WRITING
-    poll = ofp_bridgeq_mgr_event_dataq_poll_get(brqs);
-    res = s_event_dataq_enqueue(bridge, qpoll);
+    qpoll = ofp_bridgeq_mgr_event_dataq_poll_get(brqs);
+    res = s_event_dataq_enqueue(thd, bridge, qpoll);
     if (res != LAGOPUS_RESULT_OK) {
       lagopus_perror(res);
       goto done;
@@ -923,7 +1198,7 @@ s_ofph_thread_main(const lagopus_thread_t *selfptr,
     n_need_watch = 0;
     n_valid_polls = 0;
 
-    if (s_get_status() == OFPH_SHUTDOWN_RIGHT_NOW) {
+    if (s_get_status(thd) == OFPH_SHUTDOWN_RIGHT_NOW) {
       goto done;
     }
 
@@ -934,6 +1209,8 @@ s_ofph_thread_main(const lagopus_thread_t *selfptr,
       lagopus_perror(res);
       goto done;
     }
+    /* take bridges of this thread. */
+    n_bridgeqs = s_bridgeqs_filter(thd, bridgeqs, n_bridgeqs);
 
     /* get polls.*/
     n_polls = thd->m_n_polls;
@@ -952,7 +1229,7 @@ s_ofph_thread_main(const lagopus_thread_t *selfptr,
       res = lagopus_qmuxer_poll_get_queue(&(thd->m_polls[i]), &bbq);
       if (res != LAGOPUS_RESULT_OK) {
         lagopus_perror(res);
-        s_set_status(OFPH_SHUTDOWN_RIGHT_NOW);
+        s_set_status(thd, OFPH_SHUTDOWN_RIGHT_NOW);
         goto free_bridgeqs;
       }
       if (bbq != NULL && ofp_handler_validate_bbq(&bbq) == true) {
@@ -962,14 +1239,14 @@ s_ofph_thread_main(const lagopus_thread_t *selfptr,
       res = lagopus_qmuxer_poll_reset(&(thd->m_polls[i]));
       if (res != LAGOPUS_RESULT_OK) {
         lagopus_perror(res);
-        s_set_status(OFPH_SHUTDOWN_RIGHT_NOW);
+        s_set_status(thd, OFPH_SHUTDOWN_RIGHT_NOW);
         goto free_bridgeqs;
       }
       n_need_watch++;
     }
     if (n_valid_polls == 0) {
       lagopus_msg_error("there are no valid queues.\n");
-      s_set_status(OFPH_SHUTDOWN_RIGHT_NOW);
+      s_set_status(thd, OFPH_SHUTDOWN_RIGHT_NOW);
       res = LAGOPUS_RESULT_INVALID_OBJECT;
       goto free_bridgeqs;
     }
@@ -977,13 +1254,13 @@ s_ofph_thread_main(const lagopus_thread_t *selfptr,
     res = lagopus_qmuxer_poll(&(thd->muxer),
                               (lagopus_qmuxer_poll_t *const)(thd->m_polls),
                               (size_t)n_need_watch, MUXER_TIMEOUT);
-    if (s_get_status() == OFPH_SHUTDOWN_RIGHT_NOW) {
+    if (s_get_status(thd) == OFPH_SHUTDOWN_RIGHT_NOW) {
       res = LAGOPUS_RESULT_NOT_OPERATIONAL;
       goto free_bridgeqs;
     }
     if (res > 0) {
       /* read channelq */
-      res = s_channelq_dequeue(&(thd->m_channelq), thd->m_polls[0]);
+      res = s_channelq_dequeue(thd, thd->m_polls[0]);
       if (res != LAGOPUS_RESULT_OK) {
         lagopus_perror(res);
         /* Not exit. */
@@ -992,7 +1269,14 @@ s_ofph_thread_main(const lagopus_thread_t *selfptr,
       /* read eventq, dataq, event_dataq */
       if (thd->m_n_polls > 1) {
         for (i = 0; i < n_bridgeqs; i++) {
-          res = s_dequeue(bridgeqs[i]);
+          res = s_dequeue(thd, bridgeqs[i]);
+          if (res != LAGOPUS_RESULT_OK) {
+            lagopus_perror(res);
+            /* Not exit. */
+            res = LAGOPUS_RESULT_OK;
+          }
+          /* channelq is not kept waiting for events of all bridges. */
+          res = s_channelq_dequeue(thd, thd->m_polls[0]);
           if (res != LAGOPUS_RESULT_OK) {
             lagopus_perror(res);
             /* Not exit. */
@@ -1006,7 +1290,7 @@ s_ofph_thread_main(const lagopus_thread_t *selfptr,
       res = LAGOPUS_RESULT_OK;
     } else {
       lagopus_perror(res);
-      s_set_status(OFPH_SHUTDOWN_RIGHT_NOW);
+      s_set_status(thd, OFPH_SHUTDOWN_RIGHT_NOW);
     }
 
   free_bridgeqs:
@@ -1030,10 +1314,12 @@ done:
 static void
 s_ofph_thread_shutdown(const lagopus_thread_t *selfptr,
                        bool is_canceled, void *arg) {
+  uint16_t i;
   (void)arg;
   lagopus_msg_debug(10, "called. %s.\n",
                     (is_canceled == false) ? "finished" : "canceled");
-  if (s_validate_ofp_handler() == true) {
+  if (selfptr != NULL &&
+      s_validate_handler((ofp_handler_t)*selfptr) == true) {
     ofp_handler_t thd = (ofp_handler_t)*selfptr;
     /* if canceled, unlock all mutexes */
     if (is_canceled == true) {
@@ -1042,8 +1328,15 @@ s_ofph_thread_shutdown(const lagopus_thread_t *selfptr,
     }
     /* shutdown all queues, bridges, hashmaps */
     lagopus_bbq_shutdown(&(thd->m_channelq), true);
-    s_destroy_for_recreate();
-    s_set_status(OFPH_SHUTDOWNED);
+    if (thd->m_idx == 0) {
+      /* bridgeqs are shared, wait for other threads. */
+      for (i = 1; i < s_n_handlers; i++) {
+        (void)lagopus_thread_wait((lagopus_thread_t *)&s_ofp_handlers[i],
+                                  SHUTDOWN_TIMEOUT);
+      }
+    }
+    s_destroy_for_recreate(thd);
+    s_set_status(thd, OFPH_SHUTDOWNED);
   }
   if (is_canceled == true && s_is_started == false) {
     global_state_cancel_janitor();
@@ -1055,9 +1348,14 @@ s_ofph_thread_shutdown(const lagopus_thread_t *selfptr,
 static void
 s_ofph_thread_freeup(const lagopus_thread_t *selfptr,
                      void *arg) {
+  bool is_primary = false;
   (void)arg;
   lagopus_msg_debug(10, "called. %p\n", selfptr);
-  if (s_validate_ofp_handler() == true) {
+  if (selfptr != NULL) {
+    is_primary = ((void *)*selfptr == (void *)s_ofp_handler);
+  }
+  if (selfptr != NULL &&
+      s_validate_handler((ofp_handler_t)*selfptr) == true) {
     ofp_handler_t thd = (ofp_handler_t)*selfptr;
 
     free(thd->m_polls);
@@ -1068,7 +1366,9 @@ s_ofph_thread_freeup(const lagopus_thread_t *selfptr,
     thd->m_status_lock = NULL;
   }
 
-  ofp_bridgeq_mgr_destroy();
+  if (is_primary == true) {
+    ofp_bridgeq_mgr_destroy();
+  }
   lagopus_msg_debug(10, "ok.\n");
 }
 
@@ -1080,28 +1380,95 @@ s_channel_freeup_proc(void **val) {
   }
 }
 
+/* is the entry of channelq an echo request ? */
+static inline bool
+s_is_echo_request(struct channelq_data *entry) {
+  struct ofp_header header;
+
+  return (entry != NULL && entry->pbuf != NULL &&
+          ofp_header_decode_sneak(entry->pbuf, &header) == LAGOPUS_RESULT_OK &&
+          header.type == OFPT_ECHO_REQUEST);
+}
+
+/* process deferred messages until a reply is suspended again. */
+static inline void
+s_process_channelq_deferred(struct channel *channel) {
+  struct channelq_data *deferred;
+
+  while (channel_send_is_suspended(channel) == false &&
+         (deferred = channel_deferred_get(channel)) != NULL) {
+    s_process_channelq_entry(deferred);
+    channelq_data_destroy(deferred);
+  }
+}
+
+/* process an entry of channelq, and update latency stats. */
+static inline void
+s_channelq_entry_handle(ofp_handler_t thd,
+                        struct channelq_data *entry,
+                        lagopus_chrono_t now) {
+  lagopus_chrono_t latency;
+  int cstate;
+
+  if (entry != NULL) {
+    latency = now - entry->time;
+    if (latency > 0) {
+      thd->m_latency_sum += (uint64_t) latency;
+      if ((uint64_t) latency > thd->m_latency_max) {
+        thd->m_latency_max = (uint64_t) latency;
+      }
+    }
+    thd->m_n_requests++;
+  }
+  lagopus_mutex_enter_critical(&(thd->m_status_lock), &cstate);
+  {
+    if (entry != NULL && entry->channel != NULL && entry->pbuf == NULL) {
+      /* resume the suspended reply, then process deferred messages. */
+      (void) channel_send_resume(entry->channel);
+      s_process_channelq_deferred(entry->channel);
+    } else if (entry != NULL && entry->channel != NULL &&
+               s_is_echo_request(entry) == false) {
+      /* the reply may be resumed in the channel, keep received order. */
+      s_process_channelq_deferred(entry->channel);
+      if (channel_send_is_suspended(entry->channel) == false) {
+        s_process_channelq_entry(entry);
+      } else if (channel_deferred_put(entry->channel,
+                                      entry) == LAGOPUS_RESULT_OK) {
+        /* replied after the suspended reply. */
+        entry = NULL;
+      } else {
+        lagopus_msg_warning("too many deferred messages, dropped.\n");
+      }
+    } else {
+      s_process_channelq_entry(entry);
+    }
+    channelq_data_destroy(entry);
+  }
+  lagopus_mutex_leave_critical(&(thd->m_status_lock), cstate);
+}
+
 /* read channelq */
 static inline lagopus_result_t
-s_channelq_dequeue(channelq_t *q_ptr,
+s_channelq_dequeue(ofp_handler_t thd,
                    lagopus_qmuxer_poll_t qpoll) {
   lagopus_result_t res = LAGOPUS_RESULT_ANY_FAILURES;
+  channelq_t *q_ptr = &(thd->m_channelq);
   struct channelq_data **gets = NULL;
   lagopus_result_t q_size = lagopus_bbq_size(q_ptr);
   uint16_t max_batches = channelq_max_batches;
-  size_t get_num;
+  lagopus_chrono_t now;
+  size_t get_num = 0;
   size_t i;
 
   lagopus_msg_debug(10,
                     "called. q_size: %lu, max_batches: %"PRIu16"\n",
                     q_size, max_batches);
   if (q_size > 0) {
-    int cstate;
-
     gets = (struct channelq_data **)
            malloc(sizeof(struct channelq_data *) * max_batches);
     if (gets != NULL) {
       res = lagopus_bbq_get_n(q_ptr, gets,
-                              (size_t) channelq_max_batches, 0LL,
+                              (size_t) max_batches, 0LL,
                               struct channelq_data *, 0LL, &get_num);
       if (res < LAGOPUS_RESULT_OK) {
         lagopus_perror(res);
@@ -1114,13 +1481,19 @@ s_channelq_dequeue(channelq_t *q_ptr,
         res = LAGOPUS_RESULT_OK;
       }
 
+      WHAT_TIME_IS_IT_NOW_IN_NSEC(now);
+      /* reply to echo requests first not to be disconnected. */
       for (i = 0; i < get_num; i++) {
-        lagopus_mutex_enter_critical(&(s_ofp_handler->m_status_lock), &cstate);
-        {
-          s_process_channelq_entry(gets[i]);
-          channelq_data_destroy(gets[i]);
+        if (s_is_echo_request(gets[i]) == true) {
+          thd->m_n_echoes++;
+          s_channelq_entry_handle(thd, gets[i], now);
+          gets[i] = NULL;
+        }
+      }
+      for (i = 0; i < get_num; i++) {
+        if (gets[i] != NULL) {
+          s_channelq_entry_handle(thd, gets[i], now);
         }
-        lagopus_mutex_leave_critical(&(s_ofp_handler->m_status_lock), cstate);
       }
     } else {
       res = LAGOPUS_RESULT_NO_MEMORY;
@@ -1137,7 +1510,8 @@ done:
 
 /* read eventq */
 static inline lagopus_result_t
-s_eventq_dequeue(struct ofp_bridge *ofp_bridge,
+s_eventq_dequeue(ofp_handler_t thd,
+                 struct ofp_bridge *ofp_bridge,
                  lagopus_qmuxer_poll_t qpoll) {
   lagopus_result_t res = LAGOPUS_RESULT_ANY_FAILURES;
   struct eventq_data **gets = NULL;
@@ -1177,7 +1551,7 @@ s_eventq_dequeue(struct ofp_bridge *ofp_bridge,
       }
 
       for (i = 0; i < get_num; i++) {
-        lagopus_mutex_enter_critical(&(s_ofp_handler->m_status_lock), &cstate);
+        lagopus_mutex_enter_critical(&(thd->m_status_lock), &cstate);
         {
           res = s_process_eventq_entry(ofp_bridge, gets[i]);
           if (gets[i] != NULL && gets[i]->free != NULL) {
@@ -1186,7 +1560,7 @@ s_eventq_dequeue(struct ofp_bridge *ofp_bridge,
             free(gets[i]);
           }
         }
-        lagopus_mutex_leave_critical(&(s_ofp_handler->m_status_lock), cstate);
+        lagopus_mutex_leave_critical(&(thd->m_status_lock), cstate);
       }
     } else {
       res = LAGOPUS_RESULT_NO_MEMORY;
@@ -1202,7 +1576,8 @@ done:
 
 /* read dataq */
 static inline lagopus_result_t
-s_dataq_dequeue(struct ofp_bridge *ofp_bridge,
+s_dataq_dequeue(ofp_handler_t thd,
+                struct ofp_bridge *ofp_bridge,
                 lagopus_qmuxer_poll_t qpoll) {
   lagopus_result_t res = LAGOPUS_RESULT_ANY_FAILURES;
   struct eventq_data **gets = NULL;
@@ -1242,7 +1617,7 @@ s_dataq_dequeue(struct ofp_bridge *ofp_bridge,
       }
 
       for (i = 0; i < get_num; i++) {
-        lagopus_mutex_enter_critical(&(s_ofp_handler->m_status_lock), &cstate);
+        lagopus_mutex_enter_critical(&(thd->m_status_lock), &cstate);
         {
           res = s_process_dataq_entry(ofp_bridge, gets[i]);
           if (gets[i] != NULL && gets[i]->free != NULL) {
@@ -1251,7 +1626,7 @@ s_dataq_dequeue(struct ofp_bridge *ofp_bridge,
             free(gets[i]);
           }
         }
-        lagopus_mutex_leave_critical(&(s_ofp_handler->m_status_lock), cstate);
+        lagopus_mutex_leave_critical(&(thd->m_status_lock), cstate);
       }
     } else {
       res = LAGOPUS_RESULT_NO_MEMORY;
@@ -1268,7 +1643,8 @@ done:
 /* write event_dataq */
 #ifdef OFPH_POLL_WRITING
 static inline lagopus_result_t
-s_event_dataq_enqueue(struct ofp_bridge *ofp_bridge,
+s_event_dataq_enqueue(ofp_handler_t thd,
+                      struct ofp_bridge *ofp_bridge,
                       lagopus_qmuxer_poll_t qpoll) {
   int i;
   lagopus_result_t res = LAGOPUS_RESULT_ANY_FAILURES;
@@ -1281,7 +1657,7 @@ s_event_dataq_enqueue(struct ofp_bridge *ofp_bridge,
     int cstate;
     MUXER_FAIRNESS(q_size);
     for (i = 0; i < q_size; i++) {
-      lagopus_mutex_enter_critical(&(s_ofp_handler->m_status_lock), &cstate);
+      lagopus_mutex_enter_critical(&(thd->m_status_lock), &cstate);
       {
         struct edq_buffer_entry *qe
           = STAILQ_FIRST(&(ofp_bridge->edq_buffer));
@@ -1301,7 +1677,7 @@ s_event_dataq_enqueue(struct ofp_bridge *ofp_bridge,
           free(qe);
         }
       }
-      lagopus_mutex_leave_critical(&(s_ofp_handler->m_status_lock), cstate);
+      lagopus_mutex_leave_critical(&(thd->m_status_lock), cstate);
     }
     res = LAGOPUS_RESULT_OK;
   } else if (q_size == 0) {
@@ -1313,39 +1689,41 @@ done:
 #endif  /* OFPH_POLL_WRITING */
 
 static inline void
-s_destroy_for_recreate(void) {
-  if (s_validate_ofp_handler() == true) {
-    lagopus_bbq_destroy(&(s_ofp_handler->m_channelq), true);
-    s_ofp_handler->m_channelq = NULL;
-    lagopus_qmuxer_poll_destroy(&(s_ofp_handler->m_polls[0]));
-    s_ofp_handler->m_polls[0] = NULL;
-    s_ofp_handler->m_n_polls = 0;
-  }
-  /* clear bridgeq hashmap */
-  (void) ofp_bridgeq_mgr_clear();
+s_destroy_for_recreate(ofp_handler_t thd) {
+  if (s_validate_handler(thd) == true) {
+    lagopus_bbq_destroy(&(thd->m_channelq), true);
+    thd->m_channelq = NULL;
+    lagopus_qmuxer_poll_destroy(&(thd->m_polls[0]));
+    thd->m_polls[0] = NULL;
+    thd->m_n_polls = 0;
+    if (thd->m_idx == 0) {
+      /* clear bridgeq hashmap */
+      (void) ofp_bridgeq_mgr_clear();
+    }
+  }
 }
 
 static inline lagopus_result_t
-s_recreate(void) {
+s_recreate(ofp_handler_t thd) {
   lagopus_result_t res = LAGOPUS_RESULT_ANY_FAILURES;
 
-  if (s_validate_ofp_handler() == true) {
+  if (s_validate_handler(thd) == true) {
     /* Create channelq */
-    res = lagopus_bbq_create(&(s_ofp_handler->m_channelq), struct channel *,
+    res = lagopus_bbq_create(&(thd->m_channelq), struct channel *,
                              channelq_size, s_channel_freeup_proc);
     if (res != LAGOPUS_RESULT_OK) {
       lagopus_perror(res);
       goto done;
     }
     /* Create poll objects for channel queue. */
-    res = lagopus_qmuxer_poll_create(&(s_ofp_handler->m_polls[0]),
-                                     s_ofp_handler->m_channelq,
+    res = lagopus_qmuxer_poll_create(&(thd->m_polls[0]),
+                                     thd->m_channelq,
                                      LAGOPUS_QMUXER_POLL_READABLE);
     if (res != LAGOPUS_RESULT_OK) {
       lagopus_perror(res);
       goto done;
     }
-    s_ofp_handler->m_n_polls++;
+    thd->m_n_polls++;
   } else {
     res = LAGOPUS_RESULT_INVALID_ARGS;
   }
@@ -1353,25 +1731,58 @@ done:
   return res;
 }
 
+/* index of the thread handling the bridge. */
+static inline uint16_t
+s_dpid_to_idx(uint64_t dpid) {
+  uint16_t n = s_n_handlers;
+
+  if (n <= 1) {
+    return 0;
+  }
+  /* fold upper bits, dpid often has MAC address in lower bits. */
+  dpid ^= dpid >> 32;
+  dpid ^= dpid >> 16;
+  return (uint16_t)(dpid % n);
+}
+
+/* keep bridgeqs handled by the thread, and free others. */
+static uint64_t
+s_bridgeqs_filter(ofp_handler_t thd,
+                  struct ofp_bridgeq *bridgeqs[],
+                  uint64_t n_bridgeqs) {
+  struct ofp_bridge *bridge;
+  uint64_t i, n = 0;
+
+  for (i = 0; i < n_bridgeqs; i++) {
+    bridge = ofp_bridgeq_mgr_bridge_get(bridgeqs[i]);
+    if (bridge != NULL && s_dpid_to_idx(bridge->dpid) == thd->m_idx) {
+      bridgeqs[n++] = bridgeqs[i];
+    } else {
+      ofp_bridgeq_mgr_bridgeq_free(bridgeqs[i]);
+    }
+  }
+  return n;
+}
+
 static inline enum ofp_handler_running_status
-s_get_status(void) {
-  bool ret = false;
-  lagopus_mutex_lock(&(s_ofp_handler->m_status_lock));
+s_get_status(ofp_handler_t thd) {
+  enum ofp_handler_running_status ret;
+  lagopus_mutex_lock(&(thd->m_status_lock));
   {
-    ret = s_ofp_handler->m_status;
+    ret = thd->m_status;
   }
-  lagopus_mutex_unlock(&(s_ofp_handler->m_status_lock));
+  lagopus_mutex_unlock(&(thd->m_status_lock));
   return ret;
 }
 
 static inline void
-s_set_status(enum ofp_handler_running_status set) {
-  lagopus_mutex_lock(&(s_ofp_handler->m_status_lock));
+s_set_status(ofp_handler_t thd, enum ofp_handler_running_status set) {
+  lagopus_mutex_lock(&(thd->m_status_lock));
   {
     /* TODO: check, current_status < set */
-    s_ofp_handler->m_status = set;
+    thd->m_status = set;
   }
-  lagopus_mutex_unlock(&(s_ofp_handler->m_status_lock));
+  lagopus_mutex_unlock(&(thd->m_status_lock));
 }
 
 #if 0
@@ -426,3 +426,46 @@ test_channel_multipart_get_put_err(void) {
 
   channel_free(channel);
 }
+
+void
+test_channel_deferred_put_get(void) {
+  lagopus_result_t ret;
+  struct channel *channel;
+  struct channelq_data *cdata;
+  struct channelq_data over;
+  int i;
+
+  channel = s_create_data_channel();
+
+  TEST_ASSERT_NULL(channel_deferred_get(channel));
+  for (i = 0; i < CHANNEL_DEFERRED_MAX; i++) {
+    cdata = (struct channelq_data *)calloc(1, sizeof(*cdata));
+    TEST_ASSERT_NOT_NULL(cdata);
+    cdata->time = i;
+    ret = channel_deferred_put(channel, cdata);
+    TEST_ASSERT_EQUAL_MESSAGE(LAGOPUS_RESULT_OK, ret,
+                              "channel_deferred_put() error.");
+  }
+  /* the list is capped, over is not owned by the channel. */
+  ret = channel_deferred_put(channel, &over);
+  TEST_ASSERT_EQUAL_MESSAGE(LAGOPUS_RESULT_TOO_MANY_OBJECTS, ret,
+                            "channel_deferred_put() error.");
+
+  /* got in put order. */
+  for (i = 0; i < CHANNEL_DEFERRED_MAX; i++) {
+    cdata = channel_deferred_get(channel);
+    TEST_ASSERT_NOT_NULL(cdata);
+    TEST_ASSERT_EQUAL(i, cdata->time);
+    free(cdata);
+  }
+  TEST_ASSERT_NULL(channel_deferred_get(channel));
+
+  /* put again after got. */
+  cdata = (struct channelq_data *)calloc(1, sizeof(*cdata));
+  TEST_ASSERT_NOT_NULL(cdata);
+  TEST_ASSERT_EQUAL(LAGOPUS_RESULT_OK, channel_deferred_put(channel, cdata));
+  TEST_ASSERT_TRUE(channel_deferred_get(channel) == cdata);
+  free(cdata);
+
+  channel_free(channel);
+}
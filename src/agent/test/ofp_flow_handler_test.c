@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <errno.h>
+#include <arpa/inet.h>
 #include "unity.h"
 #include "../ofp_apis.h"
 #include "handler_test_utils.h"
@@ -21,6 +23,7 @@
 #include "../ofp_match.h"
 #include "../ofp_instruction.h"
 #include "../channel_mgr.h"
+#include "lagopus/ofp_dp_apis.h"
 
 void
 setUp(void) {
@@ -39,31 +42,6 @@ ofp_multipart_request_handle_wrap(struct channel *channel,
   return ofp_multipart_request_handle(channel, pbuf, xid_header, error);
 }
 
-static struct flow_stats *
-s_flow_stats_alloc(void) {
-  struct flow_stats *flow_stats;
-
-  flow_stats = calloc(1, sizeof(struct flow_stats));
-  if (flow_stats != NULL) {
-    TAILQ_INIT(&flow_stats->match_list);
-    TAILQ_INIT(&flow_stats->instruction_list);
-  }
-
-  return flow_stats;
-}
-
-static struct flow_stats_list s_flow_stats_list;
-
-static lagopus_result_t
-s_ofp_flow_reply_create_wrap(struct channel *channel,
-                             struct pbuf_list **pbuf_list,
-                             struct ofp_header *xid_header) {
-  return ofp_flow_stats_reply_create(channel, pbuf_list,
-                                     &s_flow_stats_list,
-                                     xid_header);
-}
-
-
 void
 test_prologue(void) {
   lagopus_result_t r;
@@ -519,160 +497,215 @@ test_ofp_flow_handle_null(void) {
   pbuf_free(pbuf);
 }
 
-void
-test_ofp_flow_reply_create_01(void) {
-  lagopus_result_t ret = LAGOPUS_RESULT_ANY_FAILURES;
-  struct flow_stats *flow_stats = NULL;
-  struct instruction *instruction = NULL;
-  struct match *match = NULL;
-  const char *require[1] = {
-    "04 13 00 58 00 00 00 10 00 01 00 00 00 00 00 00 "
-    "00 48 01 00 00 00 00 02 00 00 00 03 00 04 00 05 "
-    "00 06 00 07 00 00 00 00 00 00 00 00 00 00 00 08 "
-    "00 00 00 00 00 00 00 09 00 00 00 00 00 00 00 0a "
-    "00 01 00 10 00 00 01 08 00 00 00 00 00 00 00 00 "
-    "00 01 00 08 00 00 00 00"
-  };
+#define STREAM_FLOWS 6000
+#define STREAM_BUF_SIZE (4 * 1024 * 1024)
 
-  TAILQ_INIT(&s_flow_stats_list);
-  if ((flow_stats = s_flow_stats_alloc()) != NULL) {
-    /* flow_stats = 48, match = 16, instruction = 8, sum = 72 */
-    flow_stats->ofp.length = 48 + 16 + 8;
-    flow_stats->ofp.table_id = 0x01;
-    flow_stats->ofp.duration_sec = 0x02;
-    flow_stats->ofp.duration_nsec = 0x03;
-    flow_stats->ofp.priority = 0x04;
-    flow_stats->ofp.idle_timeout = 0x05;
-    flow_stats->ofp.hard_timeout = 0x06;
-    flow_stats->ofp.flags = 0x07;
-    flow_stats->ofp.cookie = 0x08;
-    flow_stats->ofp.packet_count = 0x09;
-    flow_stats->ofp.byte_count = 0x0a;
-    if ((match = match_alloc(8)) != NULL) {
-      match->oxm_class = 0x00;
-      match->oxm_field = 0x01;
-      match->oxm_length = 0x08;
-      TAILQ_INSERT_TAIL(&(flow_stats->match_list), match, entry);
-    }
-    if ((instruction = instruction_alloc()) != NULL) {
-      instruction->ofpit_goto_table.type = OFPIT_GOTO_TABLE;
-      instruction->ofpit_goto_table.len = 0x08; /* action_list empty */
-      instruction->ofpit_goto_table.table_id = 0x00;
-      TAILQ_INSERT_TAIL(&(flow_stats->instruction_list), instruction, entry);
-    }
-    TAILQ_INSERT_TAIL(&s_flow_stats_list, flow_stats, entry);
-  } else {
-    TEST_FAIL_MESSAGE("allocation error.");
-  }
+static uint8_t *s_stream_buf;
+static size_t s_stream_len;
+static bool s_stream_blocked;
 
-  /* port 0 */
-  ret = check_pbuf_list_packet_create(s_ofp_flow_reply_create_wrap, require, 1);
-  TEST_ASSERT_EQUAL_MESSAGE(LAGOPUS_RESULT_OK, ret, "create port 0 error.");
+/* controller side of the channel, or blocked as a slow controller. */
+static ssize_t
+s_stream_write(lagopus_session_t s, void *buf, size_t n) {
+  (void) s;
 
-  /* free */
-  while ((flow_stats = TAILQ_FIRST(&s_flow_stats_list)) != NULL) {
-    TAILQ_REMOVE(&s_flow_stats_list, flow_stats, entry);
-    ofp_match_list_elem_free(&flow_stats->match_list);
-    ofp_instruction_list_elem_free(&flow_stats->instruction_list);
-    free(flow_stats);
+  if (s_stream_blocked == true) {
+    errno = EAGAIN;
+    return -1;
   }
-}
-
-void
-test_ofp_flow_reply_create_02(void) {
-  lagopus_result_t ret = LAGOPUS_RESULT_ANY_FAILURES;
-  struct flow_stats *flow_stats = NULL;
-  struct match *match = NULL;
-  const char *header_data[2] = {
-    "04 13 ff b8 00 00 00 10 00 01 00 01 00 00 00 00 ",
-    "04 13 00 58 00 00 00 10 00 01 00 00 00 00 00 00 "
-  };
-  const char *body_data[2] = {
-    "00 48 01 00 00 00 00 02 00 00 00 03 00 04 00 05 "
-    "00 06 00 07 00 00 00 00 00 00 00 00 00 00 00 08 "
-    "00 00 00 00 00 00 00 09 00 00 00 00 00 00 00 0a "
-    "00 01 00 18 00 00 01 10 00 00 00 00 00 00 00 00 "
-    "00 00 00 00 00 00 00 00",
-    "00 48 01 00 00 00 00 02 00 00 00 03 00 04 00 05 "
-    "00 06 00 07 00 00 00 00 00 00 00 00 00 00 00 08 "
-    "00 00 00 00 00 00 00 09 00 00 00 00 00 00 00 0a "
-    "00 01 00 18 00 00 01 10 00 00 00 00 00 00 00 00 "
-    "00 00 00 00 00 00 00 00"
-  };
-  size_t nums[2] = {909, 1};
+  TEST_ASSERT_TRUE(s_stream_len + n <= STREAM_BUF_SIZE);
+  memcpy(s_stream_buf + s_stream_len, buf, n);
+  s_stream_len += n;
+  return (ssize_t) n;
+}
+
+static void
+s_stream_flows_add(uint64_t dpid) {
+  struct ofp_flow_mod flow_mod;
+  struct match_list match_list;
+  struct instruction_list instruction_list;
+  struct match *match;
+  struct ofp_error error;
+  uint32_t port;
   int i;
 
-  /* data */
-  TAILQ_INIT(&s_flow_stats_list);
-  for (i = 0; i < 910; i++) {
-    if ((flow_stats = s_flow_stats_alloc()) != NULL) {
-      /* flow_stats = 48, match = 24, sum = 72 */
-      flow_stats->ofp.length = 0;
-      flow_stats->ofp.table_id = 0x01;
-      flow_stats->ofp.duration_sec = 0x02;
-      flow_stats->ofp.duration_nsec = 0x03;
-      flow_stats->ofp.priority = 0x04;
-      flow_stats->ofp.idle_timeout = 0x05;
-      flow_stats->ofp.hard_timeout = 0x06;
-      flow_stats->ofp.flags = 0x07;
-      flow_stats->ofp.cookie = 0x08;
-      flow_stats->ofp.packet_count = 0x09;
-      flow_stats->ofp.byte_count = 0x0a;
-      if ((match = match_alloc(16)) != NULL) {
-        match->oxm_class = 0x00;
-        match->oxm_field = 0x01;
-        match->oxm_length = 0x10;
-        TAILQ_INSERT_TAIL(&(flow_stats->match_list), match, entry);
-      }
-      TAILQ_INSERT_TAIL(&s_flow_stats_list, flow_stats, entry);
-    } else {
-      TEST_FAIL_MESSAGE("allocation error.");
-    }
+  memset(&flow_mod, 0, sizeof(flow_mod));
+  flow_mod.table_id = 0;
+  flow_mod.out_port = OFPP_ANY;
+  flow_mod.out_group = OFPG_ANY;
+  for (i = 0; i < STREAM_FLOWS; i++) {
+    TAILQ_INIT(&match_list);
+    TAILQ_INIT(&instruction_list);
+    match = calloc(1, sizeof(struct match) + sizeof(port));
+    TEST_ASSERT_NOT_NULL(match);
+    match->oxm_class = OFPXMC_OPENFLOW_BASIC;
+    match->oxm_field = OFPXMT_OFB_IN_PORT << 1;
+    match->oxm_length = sizeof(port);
+    port = htonl((uint32_t) i + 1);
+    memcpy(match->oxm_value, &port, sizeof(port));
+    TAILQ_INSERT_TAIL(&match_list, match, entry);
+    flow_mod.priority = (uint16_t) i;
+    TEST_ASSERT_EQUAL(LAGOPUS_RESULT_OK,
+                      ofp_flow_mod_check_add(dpid, &flow_mod, &match_list,
+                                             &instruction_list, &error));
   }
+}
 
-  ret = check_pbuf_list_across_packet_create(s_ofp_flow_reply_create_wrap,
-        header_data, body_data, nums, 2);
-  TEST_ASSERT_EQUAL_MESSAGE(LAGOPUS_RESULT_OK, ret, "create port 0 error.");
+static void
+s_stream_flows_delete(uint64_t dpid) {
+  struct ofp_flow_mod flow_mod;
+  struct match_list match_list;
+  struct ofp_error error;
 
-  /* free */
-  while ((flow_stats = TAILQ_FIRST(&s_flow_stats_list)) != NULL) {
-    TAILQ_REMOVE(&s_flow_stats_list, flow_stats, entry);
-    ofp_match_list_elem_free(&flow_stats->match_list);
-    ofp_instruction_list_elem_free(&flow_stats->instruction_list);
-    free(flow_stats);
+  TAILQ_INIT(&match_list);
+  memset(&flow_mod, 0, sizeof(flow_mod));
+  flow_mod.table_id = OFPTT_ALL;
+  flow_mod.command = OFPFC_DELETE;
+  flow_mod.out_port = OFPP_ANY;
+  flow_mod.out_group = OFPG_ANY;
+  TEST_ASSERT_EQUAL(LAGOPUS_RESULT_OK,
+                    ofp_flow_mod_delete(dpid, &flow_mod, &match_list,
+                                        &error));
+}
+
+/* check multipart replies written to the controller. */
+static int
+s_stream_check(uint32_t xid) {
+  static uint8_t seen[STREAM_FLOWS];
+  uint8_t *p, *end, *msg_end;
+  uint16_t length, flags, priority;
+  int nmsgs = 0, nflows = 0;
+  bool last = false;
+
+  memset(seen, 0, sizeof(seen));
+  p = s_stream_buf;
+  end = s_stream_buf + s_stream_len;
+  while (p < end) {
+    TEST_ASSERT_FALSE_MESSAGE(last, "reply after the last chunk");
+    TEST_ASSERT_TRUE(p + sizeof(struct ofp_multipart_reply) <= end);
+    TEST_ASSERT_EQUAL(OFPT_MULTIPART_REPLY, p[1]);
+    length = (uint16_t) ((p[2] << 8) | p[3]);
+    TEST_ASSERT_EQUAL(xid, ntohl(*(uint32_t *)(p + 4)));
+    TEST_ASSERT_EQUAL(OFPMP_FLOW, (p[8] << 8) | p[9]);
+    flags = (uint16_t) ((p[10] << 8) | p[11]);
+    last = ((flags & OFPMPF_REPLY_MORE) == 0);
+    msg_end = p + length;
+    TEST_ASSERT_TRUE(msg_end <= end);
+    p += sizeof(struct ofp_multipart_reply);
+    while (p < msg_end) {
+      length = (uint16_t) ((p[0] << 8) | p[1]);
+      priority = (uint16_t) ((p[12] << 8) | p[13]);
+      TEST_ASSERT_TRUE(priority < STREAM_FLOWS);
+      TEST_ASSERT_EQUAL(0, seen[priority]);
+      seen[priority] = 1;
+      nflows++;
+      p += length;
+    }
+    nmsgs++;
   }
+  TEST_ASSERT_TRUE_MESSAGE(last, "no last chunk");
+  TEST_ASSERT_EQUAL(STREAM_FLOWS, nflows);
+  return nmsgs;
+}
+
+static lagopus_result_t
+s_stream_request(struct channel *channel, uint32_t xid) {
+  struct ofp_header xid_header;
+  struct ofp_error error;
+  struct pbuf *pbuf;
+  lagopus_result_t ret;
+
+  /* flow stats request of all tables, without match. */
+  create_packet("ff 00 00 00 ff ff ff ff ff ff ff ff 00 00 00 00 "
+                "00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 "
+                "00 01 00 04 00 00 00 00", &pbuf);
+  memset(&xid_header, 0, sizeof(xid_header));
+  xid_header.xid = xid;
+  ret = ofp_flow_stats_request_handle(channel, pbuf, &xid_header, &error);
+  pbuf_free(pbuf);
+  return ret;
 }
 
 void
-test_ofp_flow_reply_create_null(void) {
-  lagopus_result_t ret = LAGOPUS_RESULT_ANY_FAILURES;
-  struct channel *channel = channel_alloc_ip4addr("127.0.0.1", "1000", 0x01);
-  struct pbuf_list *pbuf_list = NULL;
-  struct flow_stats_list flow_stats_list;
-  struct ofp_header ofp_header;
+test_ofp_flow_stats_reply_stream_empty(void) {
+  struct channel *channel;
+  lagopus_session_t session;
+  int i;
 
-  ret = ofp_flow_stats_reply_create(NULL, &pbuf_list,
-                                    &flow_stats_list,
-                                    &ofp_header);
-  TEST_ASSERT_EQUAL_MESSAGE(LAGOPUS_RESULT_INVALID_ARGS, ret,
-                            "NULL-check error. (channel)");
+  s_stream_buf = malloc(STREAM_BUF_SIZE);
+  TEST_ASSERT_NOT_NULL(s_stream_buf);
+  channel = create_data_channel();
+  session = channel_session_get(channel);
+  session_write_set(session, s_stream_write);
+
+  /* no flows, a multipart reply without body and REPLY_MORE. */
+  s_stream_len = 0;
+  s_stream_blocked = false;
+  TEST_ASSERT_EQUAL(LAGOPUS_RESULT_OK, s_stream_request(channel, 0x10));
+  TEST_ASSERT_FALSE(channel_send_is_suspended(channel));
+  for (i = 0; i < 10 && channel_send_queue_size(channel) > 0; i++) {
+    channel_write(channel);
+  }
+  TEST_ASSERT_EQUAL(sizeof(struct ofp_multipart_reply), s_stream_len);
+  TEST_ASSERT_EQUAL(OFPT_MULTIPART_REPLY, s_stream_buf[1]);
+  TEST_ASSERT_EQUAL(sizeof(struct ofp_multipart_reply),
+                    (s_stream_buf[2] << 8) | s_stream_buf[3]);
+  TEST_ASSERT_EQUAL(0x10, ntohl(*(uint32_t *)(s_stream_buf + 4)));
+  TEST_ASSERT_EQUAL(OFPMP_FLOW, (s_stream_buf[8] << 8) | s_stream_buf[9]);
+  TEST_ASSERT_EQUAL(0, (s_stream_buf[10] << 8) | s_stream_buf[11]);
 
-  ret = ofp_flow_stats_reply_create(channel, NULL,
-                                    &flow_stats_list,
-                                    &ofp_header);
-  TEST_ASSERT_EQUAL_MESSAGE(LAGOPUS_RESULT_INVALID_ARGS, ret,
-                            "NULL-check error. (pbuf)");
+  free(s_stream_buf);
+  s_stream_buf = NULL;
+}
 
-  ret = ofp_flow_stats_reply_create(channel, &pbuf_list,
-                                    NULL, &ofp_header);
-  TEST_ASSERT_EQUAL_MESSAGE(LAGOPUS_RESULT_INVALID_ARGS, ret,
-                            "NULL-check error. (flow_stats_list)");
+void
+test_ofp_flow_stats_reply_stream(void) {
+  struct channel *channel;
+  lagopus_session_t session;
+  int i, nmsgs;
+
+  s_stream_buf = malloc(STREAM_BUF_SIZE);
+  TEST_ASSERT_NOT_NULL(s_stream_buf);
+  channel = create_data_channel();
+  session = channel_session_get(channel);
+  session_write_set(session, s_stream_write);
+  s_stream_flows_add(channel_dpid_get(channel));
+
+  /* the controller reads replies, sent in chunks with REPLY_MORE. */
+  s_stream_len = 0;
+  s_stream_blocked = false;
+  TEST_ASSERT_EQUAL(LAGOPUS_RESULT_OK, s_stream_request(channel, 0x100));
+  TEST_ASSERT_FALSE(channel_send_is_suspended(channel));
+  for (i = 0; i < 100 && channel_send_queue_size(channel) > 0; i++) {
+    channel_write(channel);
+  }
+  TEST_ASSERT_EQUAL(0, channel_send_queue_size(channel));
+  nmsgs = s_stream_check(0x100);
+  TEST_ASSERT_TRUE(nmsgs > 1);
+
+  /* a slow controller, the reply is suspended without blocking. */
+  s_stream_len = 0;
+  s_stream_blocked = true;
+  TEST_ASSERT_EQUAL(LAGOPUS_RESULT_OK, s_stream_request(channel, 0x101));
+  TEST_ASSERT_TRUE(channel_send_is_suspended(channel));
+  TEST_ASSERT_EQUAL(0, s_stream_len);
+
+  /* resumed in the write event after the send queue is drained, */
+  /* in place as no ofp_handler runs. */
+  s_stream_blocked = false;
+  for (i = 0; i < 100; i++) {
+    if (channel_send_queue_size(channel) == 0 &&
+        channel_send_is_suspended(channel) == false) {
+      break;
+    }
+    channel_write(channel);
+  }
+  TEST_ASSERT_FALSE(channel_send_is_suspended(channel));
+  TEST_ASSERT_EQUAL(nmsgs, s_stream_check(0x101));
 
-  ret = ofp_flow_stats_reply_create(channel, &pbuf_list,
-                                    &flow_stats_list, NULL);
-  TEST_ASSERT_EQUAL_MESSAGE(LAGOPUS_RESULT_INVALID_ARGS, ret,
-                            "NULL-check error. (ofp_header)");
-  channel_free(channel);
+  s_stream_flows_delete(channel_dpid_get(channel));
+  free(s_stream_buf);
+  s_stream_buf = NULL;
 }
 
 void
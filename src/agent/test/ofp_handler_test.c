@@ -489,6 +489,7 @@ test_put_channelq_packet_out(void) {
   cdata = (struct channelq_data *)malloc(sizeof(*cdata));
   if (cdata != NULL) {
     cdata->channel = channel;
+    WHAT_TIME_IS_IT_NOW_IN_NSEC(cdata->time);
   } else {
     TEST_FAIL_MESSAGE("cdata alloc error");
   }
@@ -522,6 +523,91 @@ test_put_channelq_packet_out(void) {
   TEST_ASSERT_EQUAL_MESSAGE(LAGOPUS_RESULT_OK, res, "wait error");
 }
 
+void
+test_thread_stats(void) {
+  lagopus_result_t res = LAGOPUS_RESULT_ANY_FAILURES;
+  struct ofp_handler_stats stats;
+
+  TEST_ASSERT_EQUAL(LAGOPUS_RESULT_OUT_OF_RANGE, ofp_handler_threads_set(0));
+  TEST_ASSERT_EQUAL(LAGOPUS_RESULT_OUT_OF_RANGE,
+                    ofp_handler_threads_set(OFP_HANDLER_THREADS_MAX + 1));
+  TEST_ASSERT_EQUAL(1, ofp_handler_threads_get());
+
+  (void) s_register_bridge(1, LAGOPUS_RESULT_OK);
+  res = ofp_handler_thread_stats_get(0, &stats);
+  TEST_ASSERT_EQUAL(LAGOPUS_RESULT_OK, res);
+  TEST_ASSERT_EQUAL(1, stats.bridges);
+  /* packet_out in test_put_channelq_packet_out. */
+  TEST_ASSERT_TRUE(stats.requests >= 1);
+  TEST_ASSERT_TRUE(stats.latency_max >= stats.latency_avg);
+  res = ofp_handler_thread_stats_get(1, &stats);
+  TEST_ASSERT_EQUAL(LAGOPUS_RESULT_OUT_OF_RANGE, res);
+
+  ofp_handler_shutdown(SHUTDOWN_GRACEFULLY);
+  res = lagopus_thread_wait((lagopus_thread_t *) th,
+                            SHUTDOWN_TIMEOUT);
+  TEST_ASSERT_EQUAL_MESSAGE(LAGOPUS_RESULT_OK, res, "wait error");
+}
+
+void
+test_multi_threads(void) {
+  lagopus_result_t res = LAGOPUS_RESULT_ANY_FAILURES;
+  struct ofp_handler_stats stats;
+  struct ofp_bridge *ofpb[4];
+  struct eventq_data *put;
+  lagopus_bbq_t *channelq0 = NULL, *channelq1 = NULL;
+  uint64_t i, n_bridges = 0;
+  int j;
+
+  /* restart with 2 threads. */
+  ofp_handler_shutdown(SHUTDOWN_GRACEFULLY);
+  res = lagopus_thread_wait((lagopus_thread_t *) th,
+                            SHUTDOWN_TIMEOUT);
+  TEST_ASSERT_EQUAL_MESSAGE(LAGOPUS_RESULT_OK, res, "wait error");
+  TEST_ASSERT_EQUAL(LAGOPUS_RESULT_OK, ofp_handler_threads_set(2));
+  res = ofp_handler_initialize(NULL, &th);
+  TEST_ASSERT_EQUAL_MESSAGE(LAGOPUS_RESULT_OK, res, "init error");
+  res = ofp_handler_start();
+  TEST_ASSERT_EQUAL_MESSAGE(LAGOPUS_RESULT_OK, res, "start error");
+
+  /* bridges are sharded to the threads. */
+  res = ofp_handler_get_channelq_by_dpid(0, &channelq0);
+  TEST_ASSERT_EQUAL(LAGOPUS_RESULT_OK, res);
+  res = ofp_handler_get_channelq_by_dpid(1, &channelq1);
+  TEST_ASSERT_EQUAL(LAGOPUS_RESULT_OK, res);
+  TEST_ASSERT_TRUE(channelq0 != channelq1);
+
+  /* queues of all bridges are read. */
+  for (i = 0; i < 4; i++) {
+    ofpb[i] = s_register_bridge(i, LAGOPUS_RESULT_OK);
+    put = (struct eventq_data *)calloc(1, sizeof(struct eventq_data));
+    res = lagopus_bbq_put(&(ofpb[i]->eventq), &put, struct eventq_data *,
+                          PUT_TIMEOUT);
+    TEST_ASSERT_EQUAL_MESSAGE(LAGOPUS_RESULT_OK, res, "eventq put error");
+  }
+  for (i = 0; i < 4; i++) {
+    for (j = 0; j < TIME_OUT_COUNTER &&
+         lagopus_bbq_size(&(ofpb[i]->eventq)) != 0; j++) {
+      SLEEP_SHORT();
+    }
+    res = lagopus_bbq_size(&(ofpb[i]->eventq));
+    TEST_ASSERT_EQUAL_MESSAGE(0, res, "eventq polling error");
+  }
+  for (i = 0; i < 2; i++) {
+    res = ofp_handler_thread_stats_get((uint16_t) i, &stats);
+    TEST_ASSERT_EQUAL(LAGOPUS_RESULT_OK, res);
+    TEST_ASSERT_EQUAL(2, stats.bridges);
+    n_bridges += stats.bridges;
+  }
+  TEST_ASSERT_EQUAL(4, n_bridges);
+
+  ofp_handler_shutdown(SHUTDOWN_GRACEFULLY);
+  res = lagopus_thread_wait((lagopus_thread_t *) th,
+                            SHUTDOWN_TIMEOUT);
+  TEST_ASSERT_EQUAL_MESSAGE(LAGOPUS_RESULT_OK, res, "wait error");
+  TEST_ASSERT_EQUAL(LAGOPUS_RESULT_OK, ofp_handler_threads_set(1));
+}
+
 #define TIMEOUT 100LL * 1000LL * 1000LL
 
 void
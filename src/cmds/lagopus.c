@@ -220,6 +220,10 @@ main(int argc, const char *const argv[]) {
   (void)lagopus_log_initialize(dst, logarg, false, true,
                                (cur_debug_level > s_debug_level) ?
                                cur_debug_level : s_debug_level);
+  /*
+   * Emit the messages from the writer thread, unless debugging.
+   */
+  lagopus_log_set_async((s_debug_level == 0) ? true : false);
 
   (void)lagopus_signal(SIGHUP, s_hup_handler, NULL);
   (void)lagopus_signal(SIGINT, s_term_handler, NULL);
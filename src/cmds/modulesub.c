@@ -148,6 +148,19 @@ s_once_proc(void) {
     lagopus_perror(r);
     lagopus_exit_fatal("can't register the \"%s\" module.\n", name);
   }
+  name = "dp_stats";
+  r = lagopus_module_register(name,
+                              dp_stats_thread_init,
+                              NULL,
+                              dp_stats_thread_start,
+                              dp_stats_thread_shutdown,
+                              dp_stats_thread_stop,
+                              dp_stats_thread_fini,
+                              NULL);
+  if (r != LAGOPUS_RESULT_OK) {
+    lagopus_perror(r);
+    lagopus_exit_fatal("can't register the \"%s\" module.\n", name);
+  }
   name = "dpqueuemgr";
   r = lagopus_module_register(name,
                               ofp_dpqueue_mgr_initialize,
@@ -76,6 +76,7 @@
 #include "lagopus/ofcache.h"
 
 #include "dpdk.h"
+#include "meter_bucket.h"
 
 struct app_params app;
 static bool portid_specified = false;
@@ -101,7 +102,8 @@ static const char usage[] =
   "    --show-core-config : Print core assignment configuration and exit          \n"
   "    --no-cache : Don't use flow cache                                          \n"
   "    --kvstype TYPE: Select key-value store type for flow cache                 \n"
-  "           hashmap_nolock  Use hashmap without rwlock (default)                \n"
+  "           cuckoo          Use preallocated cuckoo hash table (default)        \n"
+  "           hashmap_nolock  Use hashmap without rwlock                          \n"
   "           hashmap         Use hashmap                                         \n"
 #ifdef __SSE4_2__
   "           rte_hash        Use DPDK hash table                                 \n"
@@ -110,10 +112,21 @@ static const char usage[] =
   "           intel64  Intel_hash64                                               \n"
   "           murmur3  MurmurHash3 (32bit)                                        \n"
 #endif /* __SSE4_2__ */
-  "    --fifoness MODE: Select FIFOness mode, MODE is one of none, port, or flow  \n"
+  "    --fifoness MODE: Select FIFOness mode, MODE is one of none, port, flow,    \n"
+  "           or tuple                                                            \n"
   "           flow : FIFOness per each flow (default.)                            \n"
+  "           tuple: FIFOness per each 5-tuple, NIC RSS hash is used if present.  \n"
+  "                  inner headers of VXLAN and GRE are hashed otherwise.         \n"
   "           port : FIFOness per each port.                                      \n"
   "           none : FIFOness is disabled.                                        \n"
+  "    --rawsock-ring DEV[,DEV...]: Use PACKET_MMAP ring for raw socket devices  \n"
+  "           all : use PACKET_MMAP ring for all raw socket devices.              \n"
+  "    --rawsock-workers N: Number of raw socket worker threads (default 1)      \n"
+  "    --afxdp-generic : Use generic XDP mode for ethernet-afxdp interfaces      \n"
+  "    --port-stats-interval MSEC: Interval of port statistics collection        \n"
+  "           (default 1000)                                                      \n"
+  "    --meter-quantum USEC: Max meter credit taken by a worker at once, bounds  \n"
+  "           meter error to 16 quanta (default 100)                              \n"
   "    --rsz \"A, B, C, D\" : Ring sizes                                          \n"
   "           A = Size (in number of buffer descriptors) of each of the NIC RX    \n"
   "               rings read by the I/O RX lcores (default value is %u)           \n"
@@ -579,7 +592,9 @@ parse_arg_core_assign(const char *arg) {
 
 static int
 parse_arg_kvstype(const char *arg) {
-  if (!strcmp(arg, "hashmap_nolock")) {
+  if (!strcmp(arg, "cuckoo")) {
+    app.kvs_type = FLOWCACHE_CUCKOO;
+  } else if (!strcmp(arg, "hashmap_nolock")) {
     app.kvs_type = FLOWCACHE_HASHMAP_NOLOCK;
   } else if (!strcmp(arg, "hashmap")) {
     app.kvs_type = FLOWCACHE_HASHMAP;
@@ -613,6 +628,8 @@ parse_arg_fifoness(const char *arg) {
     app.fifoness = FIFONESS_PORT;
   } else if (!strcmp(arg, "flow")) {
     app.fifoness = FIFONESS_FLOW;
+  } else if (!strcmp(arg, "tuple")) {
+    app.fifoness = FIFONESS_TUPLE;
   } else {
     return -1;
   }
@@ -678,6 +695,11 @@ app_parse_args(int argc, const char *argv[]) {
     {"hashtype", 1, 0, 0},
 #endif /* __SSE4_2__ */
     {"fifoness", 1, 0, 0},
+    {"rawsock-ring", 1, 0, 0},
+    {"rawsock-workers", 1, 0, 0},
+    {"afxdp-generic", 0, 0, 0},
+    {"port-stats-interval", 1, 0, 0},
+    {"meter-quantum", 1, 0, 0},
     {"show-core-config", 0, 0, 0},
     {NULL, 0, 0, 0}
   };
@@ -696,6 +718,7 @@ app_parse_args(int argc, const char *argv[]) {
   bool show_core_assign = false;
 
   argvopt = (char **)argv;
+  app.kvs_type = FLOWCACHE_CUCKOO;
 
   while ((opt = getopt_long(argc, argvopt, "p:w:",
                             lgopts, &option_index)) != EOF) {
@@ -791,6 +814,41 @@ app_parse_args(int argc, const char *argv[]) {
             return -1;
           }
         }
+        if (!strcmp(lgopts[option_index].name, "rawsock-ring")) {
+          app.rawsock_ring = strdup(optarg);
+          if (app.rawsock_ring == NULL) {
+            printf("Can't allocate --rawsock-ring argument\n");
+            return -1;
+          }
+        }
+        if (!strcmp(lgopts[option_index].name, "rawsock-workers")) {
+          n = (uint8_t)strtoul(optarg, &end, 10);
+          if (*end != '\0' || n == 0) {
+            printf("Incorrect value for --rawsock-workers argument\n");
+            return -1;
+          }
+          app.rawsock_workers = n;
+        }
+        if (!strcmp(lgopts[option_index].name, "afxdp-generic")) {
+          app.afxdp_generic = 1;
+        }
+        if (!strcmp(lgopts[option_index].name, "port-stats-interval")) {
+          app.port_stats_interval = (uint32_t)strtoul(optarg, &end, 10);
+          if (*end != '\0' || app.port_stats_interval == 0) {
+            printf("Incorrect value for --port-stats-interval argument\n");
+            return -1;
+          }
+        }
+        if (!strcmp(lgopts[option_index].name, "meter-quantum")) {
+          unsigned long usec;
+
+          usec = strtoul(optarg, &end, 10);
+          if (*end != '\0') {
+            printf("Incorrect value for --meter-quantum argument\n");
+            return -1;
+          }
+          meter_bucket_quantum_set((uint64_t)usec * 1000);
+        }
         if (!strcmp(lgopts[option_index].name, "show-core-config")) {
           show_core_assign = true;
         }
@@ -93,6 +93,7 @@
 #include "lagopus/port.h"
 #include "lagopus_gstate.h"
 #include "lagopus/ofp_dp_apis.h"
+#include "lagopus/dp_apis.h"
 
 #include "lagopus/dataplane.h"
 #include "pktbuf.h"
@@ -173,6 +174,7 @@ dp_dpdk_init(void) {
 
 /* --------------------------Lagopus code start ----------------------------- */
 
+static uint64_t pktbuf_exhausted;
 
 struct lagopus_packet *
 alloc_lagopus_packet(void) {
@@ -189,6 +191,7 @@ alloc_lagopus_packet(void) {
       }
     }
     if (mbuf == NULL) {
+      (void)__sync_add_and_fetch(&pktbuf_exhausted, 1);
       lagopus_msg_error("rte_pktmbuf_alloc failed\n");
       return NULL;
     }
@@ -199,6 +202,7 @@ alloc_lagopus_packet(void) {
                                   RTE_MBUF_PRIV_ALIGN) +
                   RTE_PKTMBUF_HEADROOM + MAX_PACKET_SZ);
     if (mbuf == NULL) {
+      (void)__sync_add_and_fetch(&pktbuf_exhausted, 1);
       lagopus_msg_error("memory exhausted\n");
       return NULL;
     }
@@ -213,6 +217,26 @@ alloc_lagopus_packet(void) {
   return pkt;
 }
 
+void
+dp_get_pktbuf_statistics(struct dp_pktbuf_stats *st) {
+  unsigned sock;
+
+  st->size = 0;
+  st->in_use = 0;
+  st->exhausted = pktbuf_exhausted;
+  for (sock = 0; sock < APP_MAX_SOCKETS; sock++) {
+    if (app.pools[sock] == NULL) {
+      continue;
+    }
+    st->size += app.pools[sock]->size;
+#if RTE_VERSION >= RTE_VERSION_NUM(16, 7, 0, 0)
+    st->in_use += rte_mempool_in_use_count(app.pools[sock]);
+#else
+    st->in_use += app.pools[sock]->size - rte_mempool_count(app.pools[sock]);
+#endif /* RTE_VERSION */
+  }
+}
+
 void
 lagopus_instruction_experimenter(__UNUSED struct lagopus_packet *pkt,
                                  __UNUSED uint32_t exp_id) {
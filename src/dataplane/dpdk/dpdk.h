@@ -257,6 +257,7 @@
 #define FIFONESS_FLOW 0 /* default */
 #define FIFONESS_PORT 1
 #define FIFONESS_NONE 2
+#define FIFONESS_TUPLE 3
 
 #define NIC_RX_QUEUE_UNCONFIGURED 0
 #define NIC_RX_QUEUE_ENABLED      1
@@ -304,6 +305,7 @@ struct app_lcore_params_io {
     uint32_t nic_queues_iters[APP_MAX_NIC_RX_QUEUES_PER_IO_LCORE];
     uint32_t rings_count[APP_MAX_WORKER_LCORES];
     uint32_t rings_iters[APP_MAX_WORKER_LCORES];
+    uint64_t workers_count[APP_MAX_WORKER_LCORES];
   } rx;
 
   /* I/O TX */
@@ -399,6 +401,18 @@ struct app_params {
 
   /* fifoness */
   uint8_t fifoness;
+
+  /* raw socket devices using PACKET_MMAP ring */
+  char *rawsock_ring;
+
+  /* number of raw socket worker threads */
+  uint8_t rawsock_workers;
+
+  /* use generic XDP mode for AF_XDP interfaces */
+  uint8_t afxdp_generic;
+
+  /* interval of port statistics collection in msec */
+  uint32_t port_stats_interval;
 } __rte_cache_aligned;
 
 extern struct app_params app;
@@ -447,6 +461,7 @@ void app_lcore_io_flush(struct app_lcore_params_io *lp,
                         uint32_t n_workers,
                         void *arg);
 void app_lcore_io(struct app_lcore_params_io *lp, uint32_t n_workers);
+void app_lcore_io_print_dispatch(unsigned lcore, uint32_t n_workers);
 void app_lcore_main_loop_io(void *arg);
 void app_lcore_main_loop_worker(void *arg);
 void app_lcore_main_loop_io_worker(void *arg);
@@ -91,8 +91,6 @@
 #include <rte_pci.h>
 #ifdef __SSE4_2__
 #include <rte_hash_crc.h>
-#else
-#include "City.h"
 #endif /* __SSE4_2__ */
 #include <rte_string_fns.h>
 
@@ -112,6 +110,8 @@
 #include "pktbuf.h"
 #include "packet.h"
 #include "dpdk/dpdk.h"
+#include "City.h"
+#include "dispatch_hash.h"
 
 #undef IO_DEBUG
 #ifdef IO_DEBUG
@@ -279,6 +279,25 @@ app_lcore_io_rx_buffer_to_send (
   lp->rx.mbuf_out[worker].n_mbufs = 0;
 }
 
+/**
+ * Hash of the flow to select worker, the RSS hash computed by NIC if
+ * present.
+ */
+static inline uint32_t
+app_lcore_io_rx_tuple_hash(struct rte_mbuf *m, uint8_t portid) {
+#ifdef RTE_MBUF_HAS_PKT
+  if ((m->ol_flags & PKT_RX_RSS_HASH) != 0) {
+    return m->pkt.hash.rss;
+  }
+#else
+  if ((m->ol_flags & PKT_RX_RSS_HASH) != 0) {
+    return m->hash.rss;
+  }
+#endif /* RTE_MBUF_HAS_PKT */
+  return dispatch_hash(rte_pktmbuf_mtod(m, const uint8_t *),
+                       rte_pktmbuf_data_len(m), portid);
+}
+
 static inline void
 app_lcore_io_rx(struct app_lcore_params_io *lpio,
                 uint32_t n_workers,
@@ -314,6 +333,9 @@ app_lcore_io_rx(struct app_lcore_params_io *lpio,
             wkid = CityHash64WithSeed(OS_MTOD(mbufs[j], void *),
                                       sizeof(ETHER_HDR) + 2, portid) % n_workers;
             break;
+          case FIFONESS_TUPLE:
+            wkid = app_lcore_io_rx_tuple_hash(mbufs[j], portid) % n_workers;
+            break;
           case FIFONESS_PORT:
             wkid = portid % n_workers;
             break;
@@ -322,6 +344,7 @@ app_lcore_io_rx(struct app_lcore_params_io *lpio,
             wkid = j % n_workers;
             break;
         }
+        lpio->rx.workers_count[wkid]++;
         app_lcore_io_rx_buffer_to_send(lpio, wkid, mbufs[j], bsz_wr);
       }
     }
@@ -508,6 +531,40 @@ app_lcore_io(struct app_lcore_params_io *lp, uint32_t n_workers) {
   app_lcore_io_tx(lp, n_workers, bsz_tx_rd, bsz_tx_wr);
 }
 
+/**
+ * Print packets dispatched to each worker by the I/O lcore, and
+ * imbalance as the busiest worker over the average.
+ */
+void
+app_lcore_io_print_dispatch(unsigned lcore, uint32_t n_workers) {
+  struct app_lcore_params_io *lp;
+  uint64_t total, max;
+  uint32_t worker;
+
+  lp = &app.lcore_params[lcore].io;
+  if (lp->rx.n_nic_queues == 0 || n_workers == 0) {
+    return;
+  }
+  total = 0;
+  max = 0;
+  for (worker = 0; worker < n_workers; worker++) {
+    total += lp->rx.workers_count[worker];
+    if (max < lp->rx.workers_count[worker]) {
+      max = lp->rx.workers_count[worker];
+    }
+  }
+  printf("dispatch:\n");
+  printf("  lcore %u:\n", lcore);
+  for (worker = 0; worker < n_workers; worker++) {
+    printf("    worker %u: %" PRIu64 " packets (%.1f%%)\n",
+           worker, lp->rx.workers_count[worker],
+           total == 0 ? 0.0 :
+           (double)lp->rx.workers_count[worker] * 100.0 / (double)total);
+  }
+  printf("    imbalance: %.2f\n",
+         total == 0 ? 0.0 : (double)max * n_workers / (double)total);
+}
+
 void
 app_lcore_main_loop_io(void *arg) {
   uint32_t lcore = rte_lcore_id();
@@ -578,6 +635,7 @@ app_lcore_main_loop_io(void *arg) {
   if (likely(lp->tx.n_nic_ports > 0)) {
     app_lcore_io_tx_cleanup(lp);
   }
+  app_lcore_io_print_dispatch(lcore, n_workers);
 }
 
 void
@@ -820,6 +878,16 @@ dpdk_configure_interface(struct interface *ifp) {
   }
 
   rte_eth_dev_info_get(portid, &ifp->devinfo);
+  if (app.fifoness == FIFONESS_TUPLE) {
+    /* let NIC compute the hash of 5-tuple for dispatching. */
+    port_conf.rxmode.mq_mode = ETH_MQ_RX_RSS;
+    port_conf.rx_adv_conf.rss_conf.rss_hf =
+      (ETH_RSS_IP | ETH_RSS_TCP | ETH_RSS_UDP) &
+      ifp->devinfo.flow_type_rss_offloads;
+    if (port_conf.rx_adv_conf.rss_conf.rss_hf == 0) {
+      port_conf.rxmode.mq_mode = ETH_MQ_RX_NONE;
+    }
+  }
 
   /* Init port */
   printf("Initializing NIC port %u ...\n", (unsigned) portid);
@@ -1069,7 +1137,6 @@ dpdk_port_stats(struct port *port) {
   }
   stats->ofp.duration_nsec += (uint32_t)ts.tv_nsec;
   stats->ofp.duration_nsec -= (uint32_t)port->create_time.tv_nsec;
-  OS_MEMCPY(&port->ofp_port_stats, &stats->ofp, sizeof(stats->ofp));
 
   return stats;
 }
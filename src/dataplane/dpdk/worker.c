@@ -111,6 +111,8 @@
 #include "packet.h"
 #include "csum.h"
 #include "lock.h"
+#include "counter.h"
+#include "packet_in.h"
 #include "dpdk/dpdk.h"
 
 #ifndef APP_LCORE_WORKER_FLUSH
@@ -137,17 +139,74 @@ struct worker_arg {
   struct lagopus_packet *pkt;
 };
 
+/* max number of bridges remembered in a burst. */
+#define DP_BULK_FLOWDB_MAX 8
+
+/**
+ * Enter epoch section for the bridges receiving the burst.  Only
+ * these bridges are waited for if modified in place.
+ */
+static inline void
+dp_bulk_epoch_enter(OS_MBUF *mbufs[], size_t n_mbufs) {
+  struct flowdb *flowdbs[DP_BULK_FLOWDB_MAX];
+  struct interface *ifp;
+  struct flowdb *flowdb;
+  size_t i, j, n;
+
+  flowdb_epoch_enter(NULL);
+  dp_counter_clock_update();
+  packet_in_batch_begin();
+retry:
+  n = 0;
+  for (i = 0; i < n_mbufs; i++) {
+#ifdef RTE_MBUF_HAS_PKT
+    ifp = dpdk_interface_lookup(mbufs[i]->pkt.in_port);
+#else
+    ifp = dpdk_interface_lookup(mbufs[i]->port);
+#endif /* RTE_MBUF_HAS_PKT */
+    if (ifp == NULL || ifp->port == NULL || ifp->port->bridge == NULL) {
+      continue;
+    }
+    flowdb = ifp->port->bridge->flowdb;
+    for (j = 0; j < n; j++) {
+      if (flowdbs[j] == flowdb) {
+        break;
+      }
+    }
+    if (j < n) {
+      continue;
+    }
+    if (flowdb_epoch_check(flowdb) == false) {
+      /* configuration may be changed meanwhile. */
+      goto retry;
+    }
+    if (n < DP_BULK_FLOWDB_MAX) {
+      flowdbs[n++] = flowdb;
+    }
+  }
+}
+
 void
 dp_bulk_match_and_action(OS_MBUF *mbufs[], size_t n_mbufs,
                          struct flowcache *cache) {
+  struct app_lcore_params_worker *lp;
   struct interface *ifp;
   struct lagopus_packet *pkt;
+  struct lagopus_packet *pkts[APP_MBUF_ARRAY_SIZE];
   enum switch_mode mode;
-  size_t i;
+  size_t i, npkts;
 
   APP_WORKER_PREFETCH1(rte_pktmbuf_mtod(mbufs[0], unsigned char *));
   APP_WORKER_PREFETCH0(mbufs[1]);
-  flowdb_rdlock(NULL);
+  dp_bulk_epoch_enter(mbufs, n_mbufs);
+  lp = &app.lcore_params[rte_lcore_id()].worker;
+  if (unlikely(lp->cache_flush != 0)) {
+    /* flow table is updated, cached entries may be stale. */
+    lp->cache_flush = 0;
+    if (cache != NULL) {
+      clear_all_cache(cache);
+    }
+  }
 
   for (i = 0; i < n_mbufs; i++) {
     OS_MBUF *m;
@@ -208,26 +267,16 @@ dp_bulk_match_and_action(OS_MBUF *mbufs[], size_t n_mbufs,
         continue;
       }
     }
+    npkts = 0;
     for (i = 0; i < n_mbufs; i++) {
-      OS_MBUF *m;
-
-      m = mbufs[i];
-      if (unlikely(m == NULL)) {
-        continue;
-      }
-      if (likely(i < n_mbufs - 1)) {
-        APP_WORKER_PREFETCH1(rte_pktmbuf_mtod(mbufs[i + 1],
-                                              unsigned char *));
-      }
-      if (likely(i < n_mbufs - 2)) {
-        APP_WORKER_PREFETCH0(mbufs[i + 2]);
+      if (likely(mbufs[i] != NULL)) {
+        pkts[npkts++] = MBUF2PKT(mbufs[i]);
       }
-      pkt = MBUF2PKT(m);
-      APP_WORKER_PREFETCH0(pkt);
-      pkt->cache = cache;
-      lagopus_match_and_action(pkt);
     }
-    flowdb_rdunlock(NULL);
+    /* hash, cache lookup and classification are done per burst. */
+    lagopus_bulk_match_and_action(pkts, npkts, cache);
+    packet_in_batch_end();
+    flowdb_epoch_exit(NULL);
 }
 
 static inline void
@@ -310,7 +359,6 @@ app_lcore_main_loop_worker(void *arg) {
       if (rte_atomic32_read(&dpdk_stop) != 0) {
         break;
       }
-      flowdb_check_update(NULL);
       app_lcore_worker_flush(lp);
       i = 0;
     }
@@ -344,7 +392,6 @@ app_lcore_main_loop_io_worker(void *arg) {
         break;
       }
       app_lcore_io_flush(lp_io, n_workers, arg);
-      flowdb_check_update(NULL);
       app_lcore_worker_flush(lp);
       i = 0;
     }
@@ -354,6 +401,11 @@ app_lcore_main_loop_io_worker(void *arg) {
   }
 }
 
+/**
+ * Clear flow cache of workers.  Workers clear their own cache at the
+ * beginning of next burst, unless wait_flush is true.  If wait_flush
+ * is true, caller must stop workers by flowdb_wrlock().
+ */
 void
 clear_worker_flowcache(bool wait_flush) {
   uint32_t lcore;
@@ -369,7 +421,11 @@ clear_worker_flowcache(bool wait_flush) {
       continue;
     }
     lp = &app.lcore_params[lcore].worker;
-    clear_all_cache(lp->cache);
+    if (wait_flush == true) {
+      clear_all_cache(lp->cache);
+    } else {
+      lp->cache_flush = 1;
+    }
   }
 }
 
@@ -382,6 +438,7 @@ dp_get_flowcache_statistics(struct bridge *bridge, struct ofcachestat *st) {
   st->nentries = 0;
   st->hit = 0;
   st->miss = 0;
+  st->invalidated = 0;
   if (app.no_cache) {
     return;
   }
@@ -398,7 +455,35 @@ dp_get_flowcache_statistics(struct bridge *bridge, struct ofcachestat *st) {
     st->nentries += s.nentries;
     st->hit += s.hit;
     st->miss += s.miss;
+    st->invalidated += s.invalidated;
+  }
+}
+
+size_t
+dp_get_worker_statistics(struct dp_worker_stats *st, size_t n) {
+  struct app_lcore_params_io *lp;
+  uint32_t lcore, worker, n_workers;
+
+  n_workers = app_get_lcores_worker();
+  if (n > n_workers) {
+    n = n_workers;
+  }
+  memset(st, 0, sizeof(*st) * n);
+  /* packets dispatched to each worker by I/O lcores. */
+  for (lcore = 0; lcore < APP_MAX_LCORES; lcore++) {
+    if (app.lcore_params[lcore].type != e_APP_LCORE_IO &&
+        app.lcore_params[lcore].type != e_APP_LCORE_IO_WORKER) {
+      continue;
+    }
+    lp = &app.lcore_params[lcore].io;
+    if (lp->rx.n_nic_queues == 0) {
+      continue;
+    }
+    for (worker = 0; worker < n; worker++) {
+      st[worker].rx_packets += lp->rx.workers_count[worker];
+    }
   }
+  return n;
 }
 
 void
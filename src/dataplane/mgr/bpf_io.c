@@ -45,6 +45,8 @@
 #include "csum.h"
 #include "thread.h"
 #include "lock.h"
+#include "counter.h"
+#include "packet_in.h"
 
 static struct port_stats *bpf_port_stats(struct port *port);
 
@@ -62,7 +64,7 @@ static struct pkt_buffers pkt_buffers[NUM_PORTID];
 
 #ifndef HAVE_DPDK
 static bool no_cache = true;
-static int kvs_type = FLOWCACHE_HASHMAP_NOLOCK;
+static int kvs_type = FLOWCACHE_CUCKOO;
 static int hashtype = HASH_TYPE_INTEL64;
 static struct flowcache *flowcache;
 #endif /* HAVE_DPDK */
@@ -141,7 +143,9 @@ rawsock_dataplane_init(int argc, const char *const argv[]) {
           no_cache = true;
         }
         if (!strcmp(lgopts[optind].name, "kvstype")) {
-          if (!strcmp(optarg, "hashmap_nolock")) {
+          if (!strcmp(optarg, "cuckoo")) {
+            kvs_type = FLOWCACHE_CUCKOO;
+          } else if (!strcmp(optarg, "hashmap_nolock")) {
             kvs_type = FLOWCACHE_HASHMAP_NOLOCK;
           } else if (!strcmp(optarg, "hashmap")) {
             kvs_type = FLOWCACHE_HASHMAP;
@@ -382,7 +386,6 @@ static lagopus_result_t
 dp_bpf_thread_loop(__UNUSED const lagopus_thread_t *selfptr, void *arg) {
   static const uint8_t eth_bcast[] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
   struct lagopus_packet *pkt;
-  struct port_stats *stats;
   ssize_t len;
   unsigned int i;
   lagopus_result_t rv;
@@ -418,27 +421,30 @@ dp_bpf_thread_loop(__UNUSED const lagopus_thread_t *selfptr, void *arg) {
       err(errno, "poll");
     }
     for (i = 0; i < portidx; i++) {
+      flowdb_epoch_enter(NULL);
+      dp_counter_clock_update();
+      packet_in_batch_begin();
 #ifndef HAVE_DPDK
       if (clear_cache == true && flowcache != NULL) {
-        clear_all_cache(flowcache);
         clear_cache = false;
+        clear_all_cache(flowcache);
       }
 #endif /* HAVE_DPDK */
-      flowdb_rdlock(NULL);
-      port = dp_port_lookup(DATASTORE_INTERFACE_TYPE_ETHERNET_RAWSOCK,
-                            (uint32_t)i);
+      for (;;) {
+        port = dp_port_lookup(DATASTORE_INTERFACE_TYPE_ETHERNET_RAWSOCK,
+                              (uint32_t)i);
+        /* wait only for the flow database of this bridge. */
+        if (port == NULL || port->bridge == NULL ||
+            flowdb_epoch_check(port->bridge->flowdb) == true) {
+          break;
+        }
+      }
       if (port == NULL) {
-        flowdb_rdunlock(NULL);
+        flowdb_epoch_exit(NULL);
         continue;
       }
-      /* update port stats. */
-      if (port->interface != NULL && port->interface->stats != NULL) {
-        stats = port->interface->stats(port);
-        free(stats);
-      }
-
       if ((pollfd[i].revents & POLLIN) == 0) {
-        flowdb_rdunlock(NULL);
+        flowdb_epoch_exit(NULL);
         continue;
       }
       if (port->bridge != NULL &&
@@ -462,7 +468,7 @@ dp_bpf_thread_loop(__UNUSED const lagopus_thread_t *selfptr, void *arg) {
               case ECONNABORTED:
               case ECONNRESET:
               case EINTR:
-                flowdb_rdunlock(NULL);
+                lagopus_packet_free(pkt);
                 continue;
 
               default:
@@ -495,7 +501,8 @@ dp_bpf_thread_loop(__UNUSED const lagopus_thread_t *selfptr, void *arg) {
           }
         }
       }
-      flowdb_rdunlock(NULL);
+      packet_in_batch_end();
+      flowdb_epoch_exit(NULL);
     }
   }
 
@@ -33,6 +33,7 @@
 #endif /* HYBRID */
 
 #include "lagopus/dp_apis.h"
+#include "packet_in.h"
 
 #define SET32_FLAG(V, F)        (V) = (V) | (uint32_t)(F)
 #define UNSET32_FLAG(V, F)      (V) = (V) & (uint32_t)~(F)
@@ -237,11 +238,17 @@ bridge_alloc(const char *name) {
   }
 
   /* Allocate meter table. */
-  bridge->meter_table = meter_table_alloc();
+  bridge->meter_table = meter_table_alloc(bridge);
   if (bridge->meter_table == NULL) {
     goto out;
   }
 
+  /* Allocate packet-in event pool. */
+  bridge->packet_in = packet_in_queue_alloc();
+  if (bridge->packet_in == NULL) {
+    goto out;
+  }
+
 
 #ifdef HYBRID
   if (mactable_init(&bridge->mactable) != LAGOPUS_RESULT_OK) {
@@ -296,11 +303,13 @@ bridge_free(struct bridge *bridge) {
 #ifdef HAVE_DPDK
     clear_worker_flowcache(true);
 #endif /* HAVE_DPDK */
+    clear_rawsock_flowcache();
     flowdb_free(bridge->flowdb);
   }
   if (bridge->meter_table != NULL) {
     meter_table_free(bridge->meter_table);
   }
+  packet_in_queue_free(bridge->packet_in);
 #ifdef HYBRID
   /* stop timer. */
   if (bridge->updater_timer != NULL) {
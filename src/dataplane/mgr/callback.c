@@ -26,7 +26,9 @@
 #include "callback.h"
 
 dp_dataq_put_func_t dataq_put_func = NULL;
+dp_dataq_put_n_func_t dataq_put_n_func = NULL;
 dp_eventq_put_func_t eventq_put_func = NULL;
+dp_eventq_put_n_func_t eventq_put_n_func = NULL;
 
 dp_dataq_put_func_t
 dp_dataq_put_func_register(dp_dataq_put_func_t func) {
@@ -37,6 +39,15 @@ dp_dataq_put_func_register(dp_dataq_put_func_t func) {
   return oldfunc;
 }
 
+dp_dataq_put_n_func_t
+dp_dataq_put_n_func_register(dp_dataq_put_n_func_t func) {
+  dp_dataq_put_n_func_t oldfunc;
+
+  oldfunc = dataq_put_n_func;
+  dataq_put_n_func = func;
+  return oldfunc;
+}
+
 dp_eventq_put_func_t
 dp_eventq_put_func_register(dp_eventq_put_func_t func) {
   dp_eventq_put_func_t oldfunc;
@@ -46,6 +57,15 @@ dp_eventq_put_func_register(dp_eventq_put_func_t func) {
   return oldfunc;
 }
 
+dp_eventq_put_n_func_t
+dp_eventq_put_n_func_register(dp_eventq_put_n_func_t func) {
+  dp_eventq_put_n_func_t oldfunc;
+
+  oldfunc = eventq_put_n_func;
+  eventq_put_n_func = func;
+  return oldfunc;
+}
+
 lagopus_result_t
 dp_dataq_data_put(uint64_t dpid,
                   struct eventq_data **data,
@@ -56,6 +76,34 @@ dp_dataq_data_put(uint64_t dpid,
   return LAGOPUS_RESULT_OK;
 }
 
+lagopus_result_t
+dp_dataq_data_put_n(uint64_t dpid,
+                    struct eventq_data **data,
+                    size_t n,
+                    size_t *n_put,
+                    lagopus_chrono_t timeout) {
+  lagopus_result_t rv;
+  size_t i;
+
+  if (dataq_put_n_func != NULL) {
+    return dataq_put_n_func(dpid, data, n, n_put, timeout);
+  }
+  if (dataq_put_func == NULL) {
+    /* nobody receives, not put. */
+    *n_put = 0;
+    return LAGOPUS_RESULT_OK;
+  }
+  rv = LAGOPUS_RESULT_OK;
+  for (i = 0; i < n; i++) {
+    rv = dataq_put_func(dpid, &data[i], timeout);
+    if (rv != LAGOPUS_RESULT_OK) {
+      break;
+    }
+  }
+  *n_put = i;
+  return rv;
+}
+
 lagopus_result_t
 dp_eventq_data_put(uint64_t dpid,
                    struct eventq_data **data,
@@ -65,3 +113,26 @@ dp_eventq_data_put(uint64_t dpid,
   }
   return LAGOPUS_RESULT_OK;
 }
+
+lagopus_result_t
+dp_eventq_data_put_n(uint64_t dpid,
+                     struct eventq_data **data,
+                     size_t n,
+                     size_t *n_put,
+                     lagopus_chrono_t timeout) {
+  lagopus_result_t rv;
+  size_t i;
+
+  if (eventq_put_n_func != NULL) {
+    return eventq_put_n_func(dpid, data, n, n_put, timeout);
+  }
+  rv = LAGOPUS_RESULT_OK;
+  for (i = 0; i < n; i++) {
+    rv = dp_eventq_data_put(dpid, &data[i], timeout);
+    if (rv != LAGOPUS_RESULT_OK) {
+      break;
+    }
+  }
+  *n_put = i;
+  return rv;
+}
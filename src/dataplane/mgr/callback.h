@@ -25,7 +25,21 @@ dp_dataq_data_put(uint64_t dpid,
                   struct eventq_data **data,
                   lagopus_chrono_t timeout);
 
+lagopus_result_t
+dp_dataq_data_put_n(uint64_t dpid,
+                    struct eventq_data **data,
+                    size_t n,
+                    size_t *n_put,
+                    lagopus_chrono_t timeout);
+
 lagopus_result_t
 dp_eventq_data_put(uint64_t dpid,
                    struct eventq_data **data,
                    lagopus_chrono_t timeout);
+
+lagopus_result_t
+dp_eventq_data_put_n(uint64_t dpid,
+                     struct eventq_data **data,
+                     size_t n,
+                     size_t *n_put,
+                     lagopus_chrono_t timeout);
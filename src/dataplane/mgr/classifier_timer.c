@@ -0,0 +1,79 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <time.h>
+
+#include "lagopus_apis.h"
+#include "lagopus/flowdb.h"
+#include "lagopus/bridge.h"
+#include "lagopus/dp_apis.h"
+#include "lock.h"
+#include "dp_timer.h"
+
+#undef DEBUG
+#ifdef DEBUG
+#include <stdio.h>
+
+#define DPRINTF(...) printf(__VA_ARGS__)
+#else
+#define DPRINTF(...)
+#endif
+
+/* flows of some table in auto mode are changed. */
+static volatile bool classifier_timer_pending = false;
+
+static bool
+classifier_timer_bridge_update(void *key, void *val,
+                               lagopus_hashentry_t he, void *arg) {
+  struct bridge *bridge;
+
+  (void) key;
+  (void) he;
+  (void) arg;
+
+  bridge = val;
+  flowdb_classifier_update(bridge->flowdb);
+  return true;
+}
+
+/*
+ * changes in the period are profiled at once, tables of all bridges
+ * are checked.
+ */
+static void
+classifier_timer_expire(struct dp_timer *dp_timer) {
+  (void) dp_timer;
+
+  DPRINTF("expired\n");
+  classifier_timer_pending = false;
+  mbar();
+  flowdb_rdlock(NULL);
+  (void)dp_bridge_iterate(classifier_timer_bridge_update, NULL);
+  flowdb_rdunlock(NULL);
+}
+
+lagopus_result_t
+add_classifier_timer(time_t timeout) {
+  if (__sync_bool_compare_and_swap(&classifier_timer_pending,
+                                   false, true) == true) {
+    if (add_dp_timer(CLASSIFIER_TIMER, timeout,
+                     classifier_timer_expire, NULL) == NULL) {
+      classifier_timer_pending = false;
+      return LAGOPUS_RESULT_NO_MEMORY;
+    }
+  }
+  return LAGOPUS_RESULT_OK;
+}
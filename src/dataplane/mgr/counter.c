@@ -0,0 +1,283 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ *      @file   counter.c
+ *      @brief  Packet and byte counters sharded per forwarding thread.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lagopus_apis.h"
+#include "counter.h"
+
+#ifdef HAVE_DPDK
+#include <rte_cycles.h>
+#endif /* HAVE_DPDK */
+
+static struct dp_counter_shard counter_shards[DP_COUNTER_SHARDS_MAX];
+static volatile int counter_nshards = 0;
+
+__thread struct dp_counter_shard *dp_counter_self = NULL;
+__thread time_t dp_counter_clock = 0;
+static pthread_key_t counter_key;
+static pthread_once_t counter_once = PTHREAD_ONCE_INIT;
+
+/* updates of DP_COUNTER_NONE and of counters on allocation failure. */
+static struct dp_counter counter_spare;
+
+/*
+ * Count at allocation or reset of each counter, subtracted from sum
+ * of shards.  Written by control threads only.
+ */
+static struct dp_counter *counter_bases[DP_COUNTER_CHUNKS_MAX];
+
+#ifdef HAVE_DPDK
+/* TSC and CLOCK_MONOTONIC at calibration. */
+static uint64_t clock_tsc_hz = 0;
+static uint64_t clock_tsc_base;
+static time_t clock_sec_base;
+static pthread_once_t clock_once = PTHREAD_ONCE_INIT;
+#endif /* HAVE_DPDK */
+
+static pthread_mutex_t counter_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t counter_next_id = DP_COUNTER_NONE + 1;
+static uint32_t *counter_free_ids = NULL;
+static uint32_t counter_nfree = 0;
+static uint32_t counter_free_size = 0;
+
+static void
+counter_shard_release(void *arg) {
+  struct dp_counter_shard *shard;
+
+  /* counts are kept, next thread takes over the shard. */
+  shard = arg;
+  mbar();
+  shard->used = false;
+}
+
+static void
+counter_key_create(void) {
+  (void)pthread_key_create(&counter_key, counter_shard_release);
+}
+
+static struct dp_counter_shard *
+counter_shard_get(void) {
+  struct dp_counter_shard *shard;
+  int i, n;
+
+  if (likely(dp_counter_self != NULL)) {
+    return dp_counter_self;
+  }
+  (void)pthread_once(&counter_once, counter_key_create);
+  for (i = 0; i < DP_COUNTER_SHARDS_MAX; i++) {
+    shard = &counter_shards[i];
+    if (shard->used == false &&
+        __sync_bool_compare_and_swap(&shard->used, false, true) == true) {
+      while ((n = counter_nshards) < i + 1) {
+        (void)__sync_bool_compare_and_swap(&counter_nshards, n, i + 1);
+      }
+      (void)pthread_setspecific(counter_key, shard);
+      dp_counter_self = shard;
+      return shard;
+    }
+  }
+  lagopus_exit_fatal("too many threads updating counters (max %d).\n",
+                     DP_COUNTER_SHARDS_MAX);
+  return NULL;
+}
+
+#ifdef HAVE_DPDK
+static void
+counter_clock_calibrate(void) {
+  struct timespec ts;
+  uint64_t hz;
+
+  hz = rte_get_tsc_hz();
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  clock_tsc_base = rte_rdtsc();
+  clock_sec_base = ts.tv_sec;
+  mbar();
+  clock_tsc_hz = hz;
+}
+#endif /* HAVE_DPDK */
+
+void
+dp_counter_clock_update(void) {
+  struct timespec ts;
+
+#ifdef HAVE_DPDK
+  if (likely(clock_tsc_hz != 0)) {
+    dp_counter_clock = clock_sec_base +
+                       (time_t)((rte_rdtsc() - clock_tsc_base) / clock_tsc_hz);
+    return;
+  }
+  (void)pthread_once(&clock_once, counter_clock_calibrate);
+#endif /* HAVE_DPDK */
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+  dp_counter_clock = ts.tv_sec;
+}
+
+static struct dp_counter *
+counter_chunk_alloc(void) {
+  void *chunk;
+  size_t size;
+
+  size = sizeof(struct dp_counter) * DP_COUNTER_CHUNK_SIZE;
+  if (posix_memalign(&chunk, 64, size) != 0) {
+    return NULL;
+  }
+  memset(chunk, 0, size);
+  return chunk;
+}
+
+struct dp_counter *
+dp_counter_lookup_slow(uint32_t id) {
+  struct dp_counter_shard *shard;
+  struct dp_counter *chunk;
+  uint32_t c;
+
+  if (id == DP_COUNTER_NONE || id >= DP_COUNTER_MAX) {
+    return &counter_spare;
+  }
+  shard = counter_shard_get();
+  c = id >> DP_COUNTER_CHUNK_SHIFT;
+  chunk = shard->chunks[c];
+  if (chunk == NULL) {
+    chunk = counter_chunk_alloc();
+    if (chunk == NULL) {
+      return &counter_spare;
+    }
+    /* zeroed chunk must be visible before summed by readers. */
+    mbar();
+    shard->chunks[c] = chunk;
+  }
+  return &chunk[id & DP_COUNTER_CHUNK_MASK];
+}
+
+static void
+counter_sum(uint32_t id, struct dp_counter *sum) {
+  struct dp_counter *chunk;
+  uint32_t c, i;
+  int s, nshards;
+
+  c = id >> DP_COUNTER_CHUNK_SHIFT;
+  i = id & DP_COUNTER_CHUNK_MASK;
+  sum->packets = 0;
+  sum->bytes = 0;
+  sum->seen = 0;
+  nshards = counter_nshards;
+  for (s = 0; s < nshards; s++) {
+    chunk = counter_shards[s].chunks[c];
+    if (chunk != NULL) {
+      sum->packets += chunk[i].packets;
+      sum->bytes += chunk[i].bytes;
+      if (chunk[i].seen > sum->seen) {
+        sum->seen = chunk[i].seen;
+      }
+    }
+  }
+}
+
+static bool
+counter_base_alloc(uint32_t id) {
+  uint32_t c;
+
+  c = id >> DP_COUNTER_CHUNK_SHIFT;
+  if (counter_bases[c] == NULL) {
+    counter_bases[c] = counter_chunk_alloc();
+    if (counter_bases[c] == NULL) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint32_t
+dp_counter_alloc(void) {
+  uint32_t id;
+
+  pthread_mutex_lock(&counter_lock);
+  if (counter_nfree > 0) {
+    id = counter_free_ids[--counter_nfree];
+  } else if (counter_next_id < DP_COUNTER_MAX &&
+             counter_base_alloc(counter_next_id) == true) {
+    id = counter_next_id++;
+  } else {
+    id = DP_COUNTER_NONE;
+  }
+  pthread_mutex_unlock(&counter_lock);
+
+  if (id == DP_COUNTER_NONE) {
+    lagopus_msg_warning("no more counters, statistics are not counted.\n");
+    return DP_COUNTER_NONE;
+  }
+  /* shards keep count of previous user. */
+  dp_counter_reset(id);
+  return id;
+}
+
+void
+dp_counter_free(uint32_t id) {
+  uint32_t *ids;
+  uint32_t size;
+
+  if (id == DP_COUNTER_NONE || id >= DP_COUNTER_MAX) {
+    return;
+  }
+  pthread_mutex_lock(&counter_lock);
+  if (counter_nfree == counter_free_size) {
+    size = counter_free_size == 0 ? 1024 : counter_free_size * 2;
+    ids = realloc(counter_free_ids, sizeof(uint32_t) * size);
+    if (ids == NULL) {
+      /* leak the id. */
+      pthread_mutex_unlock(&counter_lock);
+      return;
+    }
+    counter_free_ids = ids;
+    counter_free_size = size;
+  }
+  counter_free_ids[counter_nfree++] = id;
+  pthread_mutex_unlock(&counter_lock);
+}
+
+void
+dp_counter_get(uint32_t id, struct dp_counter *counter) {
+  struct dp_counter *base;
+
+  if (id == DP_COUNTER_NONE || id >= DP_COUNTER_MAX) {
+    counter->packets = 0;
+    counter->bytes = 0;
+    counter->seen = 0;
+    return;
+  }
+  counter_sum(id, counter);
+  base = &counter_bases[id >> DP_COUNTER_CHUNK_SHIFT]
+         [id & DP_COUNTER_CHUNK_MASK];
+  counter->packets -= base->packets;
+  counter->bytes -= base->bytes;
+}
+
+void
+dp_counter_reset(uint32_t id) {
+  if (id == DP_COUNTER_NONE || id >= DP_COUNTER_MAX) {
+    return;
+  }
+  counter_sum(id, &counter_bases[id >> DP_COUNTER_CHUNK_SHIFT]
+              [id & DP_COUNTER_CHUNK_MASK]);
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ *      @file   counter.h
+ *      @brief  Packet and byte counters sharded per forwarding thread.
+ *
+ * Counters of flows, tables, groups and meters are identified by
+ * number.  Each thread updating counters owns a shard holding its own
+ * copy of every counter, so updates never write cache lines shared
+ * with other threads.  Shards are summed only when statistics are
+ * requested.
+ *
+ * Each update also stamps the counter with the coarse time of the
+ * thread, so idle time of flows is known without reading the clock
+ * per packet.
+ */
+
+#ifndef SRC_DATAPLANE_MGR_COUNTER_H_
+#define SRC_DATAPLANE_MGR_COUNTER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "lagopus_apis.h"
+#include "epoch.h"
+
+/* max number of threads updating counters. */
+#define DP_COUNTER_SHARDS_MAX   DP_EPOCH_THREADS_MAX
+
+#define DP_COUNTER_CHUNK_SHIFT  10
+#define DP_COUNTER_CHUNK_SIZE   (1 << DP_COUNTER_CHUNK_SHIFT)
+#define DP_COUNTER_CHUNK_MASK   (DP_COUNTER_CHUNK_SIZE - 1)
+#define DP_COUNTER_CHUNKS_MAX   4096
+
+/* max number of counters. */
+#define DP_COUNTER_MAX          (DP_COUNTER_CHUNK_SIZE * DP_COUNTER_CHUNKS_MAX)
+
+/**
+ * Counter id shared by objects without own counter.  Updates are
+ * accepted and never reported.
+ */
+#define DP_COUNTER_NONE         0
+
+/**
+ * @brief Packet and byte count.
+ */
+struct dp_counter {
+  uint64_t packets;             /** Packet count. */
+  uint64_t bytes;               /** Byte count. */
+  uint64_t seen;                /** Coarse time of last update (sec). */
+};
+
+/**
+ * @brief Counters of one thread, allocated by chunk on first update.
+ */
+struct dp_counter_shard {
+  struct dp_counter *volatile chunks[DP_COUNTER_CHUNKS_MAX];
+  volatile bool used;
+} __attribute__((aligned(64)));
+
+extern __thread struct dp_counter_shard *dp_counter_self;
+
+/**
+ * Coarse time of the calling thread in seconds of CLOCK_MONOTONIC,
+ * updated by dp_counter_clock_update().
+ */
+extern __thread time_t dp_counter_clock;
+
+/**
+ * Update coarse time of the calling thread.  Called by forwarding
+ * threads once per received burst.  TSC is used on DPDK,
+ * CLOCK_MONOTONIC_COARSE otherwise.
+ */
+void dp_counter_clock_update(void);
+
+/**
+ * Get counter in the shard of the calling thread, allocate the shard
+ * or the chunk if needed.  Slow path of dp_counter_add().
+ *
+ * @param[in]   id      Counter id.
+ *
+ * @retval      Counter.
+ */
+struct dp_counter *dp_counter_lookup_slow(uint32_t id);
+
+/**
+ * Add packet and byte count to the counter.  Called by forwarding
+ * threads without lock.
+ *
+ * @param[in]   id      Counter id.
+ * @param[in]   packets Packet count.
+ * @param[in]   bytes   Byte count.
+ */
+static inline void
+dp_counter_add(uint32_t id, uint64_t packets, uint64_t bytes) {
+  struct dp_counter_shard *shard;
+  struct dp_counter *chunk;
+  struct dp_counter *counter;
+
+  shard = dp_counter_self;
+  if (likely(shard != NULL) &&
+      likely((chunk = shard->chunks[id >> DP_COUNTER_CHUNK_SHIFT]) != NULL)) {
+    counter = &chunk[id & DP_COUNTER_CHUNK_MASK];
+  } else {
+    counter = dp_counter_lookup_slow(id);
+  }
+  counter->packets += packets;
+  counter->bytes += bytes;
+  counter->seen = (uint64_t)dp_counter_clock;
+}
+
+/**
+ * Allocate counter.  Count of new counter is zero.
+ *
+ * @retval      Counter id, DP_COUNTER_NONE if counters are exhausted.
+ */
+uint32_t dp_counter_alloc(void);
+
+/**
+ * Free counter.
+ *
+ * @param[in]   id      Counter id.
+ */
+void dp_counter_free(uint32_t id);
+
+/**
+ * Sum counter over all shards.
+ *
+ * @param[in]   id      Counter id.
+ * @param[out]  counter Sum of count since allocated or reset,
+ *                      and latest time of update.
+ */
+void dp_counter_get(uint32_t id, struct dp_counter *counter);
+
+/**
+ * Reset counter to zero.
+ *
+ * @param[in]   id      Counter id.
+ */
+void dp_counter_reset(uint32_t id);
+
+#endif /* SRC_DATAPLANE_MGR_COUNTER_H_ */
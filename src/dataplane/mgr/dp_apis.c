@@ -25,6 +25,7 @@
 #include "lagopus/bridge.h"
 #include "lagopus/port.h"
 #include "lagopus/interface.h"
+#include "lagopus/group.h"
 
 #include "lagopus_apis.h"
 #include "lagopus/dp_apis.h"
@@ -34,6 +35,7 @@
 #endif /* HYBRID */
 
 #include "lock.h"
+#include "packet_in.h"
 
 struct dp_bridge_iter {
   struct flowdb *flowdb;
@@ -213,6 +215,14 @@ dp_interface_info_set(const char *name,
           free(ifp->info.eth_rawsock.ip_addr);
         }
         break;
+      case DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP:
+        if (ifp->info.eth_afxdp.device) {
+          free((void *)ifp->info.eth_afxdp.device);
+        }
+        if (ifp->info.eth_afxdp.ip_addr) {
+          free((void *)ifp->info.eth_afxdp.ip_addr);
+        }
+        break;
       case DATASTORE_INTERFACE_TYPE_VXLAN:
         if (ifp->info.vxlan.dst_addr) {
           free(ifp->info.vxlan.dst_addr);
@@ -237,6 +247,7 @@ dp_interface_info_set(const char *name,
     switch (interface_info->type) {
       case DATASTORE_INTERFACE_TYPE_ETHERNET_DPDK_PHY:
       case DATASTORE_INTERFACE_TYPE_ETHERNET_RAWSOCK:
+      case DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP:
       case DATASTORE_INTERFACE_TYPE_VXLAN:
       case DATASTORE_INTERFACE_TYPE_UNKNOWN:
         break;
@@ -471,6 +482,7 @@ dp_port_start(const char *name) {
     return LAGOPUS_RESULT_INVALID_ARGS;
   }
   port->ofp_port.config &= ~OFPPC_PORT_DOWN;
+  group_liveness_changed();
 
   return rv;
 }
@@ -485,6 +497,7 @@ dp_port_stop(const char *name) {
     return rv;
   }
   port->ofp_port.config |= OFPPC_PORT_DOWN;
+  group_liveness_changed();
 
   return rv;
 }
@@ -528,15 +541,41 @@ dp_port_state_get(const char *name, uint32_t *state) {
   if (rv != LAGOPUS_RESULT_OK) {
     goto out;
   }
-  if (port->interface != NULL) {
-    port->interface->stats(port);
-  }
+  /* link state is refreshed by dp_stats thread. */
   *state = port->ofp_port.state;
 out:
   flowdb_rdunlock(NULL);
   return rv;
 }
 
+static bool
+port_stats_collect_iterate(void *key, void *val,
+                           lagopus_hashentry_t he, void *arg) {
+  struct port *port;
+  struct port_stats *stats;
+
+  (void) key;
+  (void) he;
+  (void) arg;
+
+  port = val;
+  if (port->interface != NULL && port->interface->stats != NULL) {
+    stats = port->interface->stats(port);
+    if (stats != NULL) {
+      dp_port_stats_publish(port, &stats->ofp);
+      free(stats);
+    }
+  }
+  return true;
+}
+
+void
+dp_port_stats_collect(void) {
+  flowdb_rdlock(NULL);
+  lagopus_hashmap_iterate(&port_hashmap, port_stats_collect_iterate, NULL);
+  flowdb_rdunlock(NULL);
+}
+
 lagopus_result_t
 dp_port_interface_set(const char *name, const char *ifname) {
   struct port *port;
@@ -1077,6 +1116,11 @@ dp_bridge_lookup_by_dpid(uint64_t dpid) {
   return bridge;
 }
 
+lagopus_result_t
+dp_bridge_iterate(lagopus_hashmap_iteration_proc_t proc, void *arg) {
+  return lagopus_hashmap_iterate(&bridge_hashmap, proc, arg);
+}
+
 lagopus_result_t
 dp_bridge_table_id_iter_create(const char *name, dp_bridge_iter_t *iterp) {
   dp_bridge_iter_t iter;
@@ -1180,8 +1224,12 @@ dp_bridge_stats_get(const char *name,
                     datastore_bridge_stats_t *stats) {
   struct ofp_error error;
   struct ofcachestat cache_stats;
+  struct dp_pktbuf_stats pktbuf_stats;
+  struct dp_worker_stats worker_stats[DATASTORE_BRIDGE_MAX_WORKERS];
   struct bridge *bridge;
   lagopus_result_t rv;
+  uint64_t total, max;
+  size_t i, n;
 
   flowdb_wrlock(NULL);
   rv = lagopus_hashmap_find(&bridge_hashmap, (void *)name, (void **)&bridge);
@@ -1192,6 +1240,7 @@ dp_bridge_stats_get(const char *name,
   stats->flowcache_entries = 0;
   stats->flowcache_hit = 0;
   stats->flowcache_miss = 0;
+  stats->flowcache_invalidated = 0;
   stats->flow_entries = 0;
   stats->flow_lookup_count = 0;
   stats->flow_matched_count = 0;
@@ -1209,12 +1258,98 @@ dp_bridge_stats_get(const char *name,
   stats->flowcache_entries = cache_stats.nentries;
   stats->flowcache_hit = cache_stats.hit;
   stats->flowcache_miss = cache_stats.miss;
+  stats->flowcache_invalidated = cache_stats.invalidated;
+  stats->packet_in_drops = packet_in_drops_get(bridge->packet_in);
+  dp_get_pktbuf_statistics(&pktbuf_stats);
+  stats->pktbuf_pool_size = pktbuf_stats.size;
+  stats->pktbuf_pool_in_use = pktbuf_stats.in_use;
+  stats->pktbuf_pool_exhausted = pktbuf_stats.exhausted;
+  n = dp_get_worker_statistics(worker_stats, DATASTORE_BRIDGE_MAX_WORKERS);
+  total = 0;
+  max = 0;
+  for (i = 0; i < n; i++) {
+    total += worker_stats[i].rx_packets;
+    if (max < worker_stats[i].rx_packets) {
+      max = worker_stats[i].rx_packets;
+    }
+    stats->workers[i].rx_packets = worker_stats[i].rx_packets;
+    stats->workers[i].rx_bytes = worker_stats[i].rx_bytes;
+    stats->workers[i].tx_packets = worker_stats[i].tx_packets;
+    stats->workers[i].tx_dropped = worker_stats[i].tx_dropped;
+    stats->workers[i].polls = worker_stats[i].polls;
+  }
+  stats->worker_count = (uint32_t)n;
+  stats->worker_imbalance = (total == 0) ? 0 : max * n * 100 / total;
 
 out:
   flowdb_wrunlock(NULL);
   return rv;
 }
 
+static const struct {
+  datastore_bridge_table_classifier_t type;
+  enum table_classifier classifier;
+} table_classifier_map[] = {
+  { DATASTORE_BRIDGE_TABLE_CLASSIFIER_FLOWINFO, TABLE_CLASSIFIER_FLOWINFO },
+  { DATASTORE_BRIDGE_TABLE_CLASSIFIER_MBTREE, TABLE_CLASSIFIER_MBTREE },
+  { DATASTORE_BRIDGE_TABLE_CLASSIFIER_THTABLE, TABLE_CLASSIFIER_THTABLE },
+  { DATASTORE_BRIDGE_TABLE_CLASSIFIER_EXACT, TABLE_CLASSIFIER_EXACT },
+  { DATASTORE_BRIDGE_TABLE_CLASSIFIER_AUTO, TABLE_CLASSIFIER_AUTO },
+};
+
+lagopus_result_t
+dp_bridge_table_classifier_set(const char *name, uint8_t table_id,
+                               datastore_bridge_table_classifier_t
+                               classifier) {
+  struct bridge *bridge;
+  size_t i;
+
+  bridge = dp_bridge_lookup(name);
+  if (bridge == NULL) {
+    return LAGOPUS_RESULT_NOT_FOUND;
+  }
+  for (i = 0; i < sizeof(table_classifier_map) /
+       sizeof(table_classifier_map[0]); i++) {
+    if (table_classifier_map[i].type == classifier) {
+      return flowdb_table_classifier_set(bridge->flowdb, table_id,
+                                         table_classifier_map[i].classifier);
+    }
+  }
+  return LAGOPUS_RESULT_INVALID_ARGS;
+}
+
+lagopus_result_t
+dp_bridge_table_classifier_get(const char *name, uint8_t table_id,
+                               datastore_bridge_table_classifier_t
+                               *classifier,
+                               datastore_bridge_table_classifier_t
+                               *current) {
+  struct bridge *bridge;
+  enum table_classifier type;
+  lagopus_result_t rv;
+  bool is_auto;
+  size_t i;
+
+  bridge = dp_bridge_lookup(name);
+  if (bridge == NULL) {
+    return LAGOPUS_RESULT_NOT_FOUND;
+  }
+  rv = flowdb_table_classifier_get(bridge->flowdb, table_id, &type, &is_auto);
+  if (rv != LAGOPUS_RESULT_OK) {
+    return rv;
+  }
+  *current = DATASTORE_BRIDGE_TABLE_CLASSIFIER_UNKNOWN;
+  for (i = 0; i < sizeof(table_classifier_map) /
+       sizeof(table_classifier_map[0]); i++) {
+    if (table_classifier_map[i].classifier == type) {
+      *current = table_classifier_map[i].type;
+    }
+  }
+  *classifier = (is_auto == true) ? DATASTORE_BRIDGE_TABLE_CLASSIFIER_AUTO :
+                *current;
+  return LAGOPUS_RESULT_OK;
+}
+
 lagopus_result_t
 dp_bridge_meter_list_get(const char *name,
                          datastore_bridge_meter_info_list_t *list) {
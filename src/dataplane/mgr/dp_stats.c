@@ -0,0 +1,143 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ *      @file   dp_stats.c
+ *      @brief  Periodic port statistics collector.
+ *
+ * Port statistics and link state are read from the drivers on this
+ * thread only, and published per port as snapshots.  Forwarding
+ * threads never call the driver statistics functions.
+ */
+
+#include <inttypes.h>
+#include <time.h>
+
+#include "lagopus_apis.h"
+#include "lagopus/dataplane.h"
+#include "lagopus/dp_apis.h"
+#include "thread.h"
+
+#ifdef HAVE_DPDK
+#include "dpdk.h"
+#endif /* HAVE_DPDK */
+
+/* sleep granularity, to respond to stop request. */
+#define DP_STATS_TICK_MSEC      100
+
+static lagopus_thread_t stats_thread = NULL;
+static bool stats_run = false;
+static lagopus_mutex_t stats_lock = NULL;
+
+static unsigned int stats_interval = DP_STATS_INTERVAL_DEFAULT;
+
+lagopus_result_t
+dp_stats_interval_set(unsigned int msec) {
+  if (msec == 0) {
+    return LAGOPUS_RESULT_INVALID_ARGS;
+  }
+  stats_interval = msec;
+  return LAGOPUS_RESULT_OK;
+}
+
+unsigned int
+dp_stats_interval_get(void) {
+  return stats_interval;
+}
+
+static lagopus_result_t
+dp_stats_thread_loop(const lagopus_thread_t *t, void *arg) {
+  struct timespec ts;
+  unsigned int elapsed, tick;
+  lagopus_result_t rv;
+  global_state_t cur_state;
+  shutdown_grace_level_t cur_grace;
+
+  (void) t;
+  (void) arg;
+
+  rv = global_state_wait_for(GLOBAL_STATE_STARTED,
+                             &cur_state,
+                             &cur_grace,
+                             -1);
+  if (rv != LAGOPUS_RESULT_OK) {
+    return rv;
+  }
+
+  /* collect at once on start. */
+  elapsed = stats_interval;
+  while (stats_run == true) {
+    if (elapsed >= stats_interval) {
+      dp_port_stats_collect();
+      elapsed = 0;
+    }
+    tick = stats_interval - elapsed;
+    if (tick > DP_STATS_TICK_MSEC) {
+      tick = DP_STATS_TICK_MSEC;
+    }
+    ts.tv_sec = tick / 1000;
+    ts.tv_nsec = (long)(tick % 1000) * 1000 * 1000;
+    (void)nanosleep(&ts, NULL);
+    elapsed += tick;
+  }
+
+  return LAGOPUS_RESULT_OK;
+}
+
+lagopus_result_t
+dp_stats_thread_init(__UNUSED int argc,
+                     __UNUSED const char *const argv[],
+                     __UNUSED void *extarg,
+                     lagopus_thread_t **thdptr) {
+  static struct dataplane_arg dparg;
+
+#ifdef HAVE_DPDK
+  if (app.port_stats_interval != 0) {
+    stats_interval = app.port_stats_interval;
+  }
+#endif /* HAVE_DPDK */
+  dparg.threadptr = &stats_thread;
+  dparg.lock = &stats_lock;
+  dparg.running = &stats_run;
+  lagopus_thread_create(&stats_thread, dp_stats_thread_loop,
+                        dp_finalproc, dp_freeproc, "dp_stats", &dparg);
+  if (lagopus_mutex_create(&stats_lock) != LAGOPUS_RESULT_OK) {
+    lagopus_exit_fatal("lagopus_mutex_create");
+  }
+  *thdptr = &stats_thread;
+
+  return LAGOPUS_RESULT_OK;
+}
+
+lagopus_result_t
+dp_stats_thread_start(void) {
+  return dp_thread_start(&stats_thread, &stats_lock, &stats_run);
+}
+
+void
+dp_stats_thread_fini(void) {
+  dp_thread_finalize(&stats_thread);
+}
+
+lagopus_result_t
+dp_stats_thread_shutdown(shutdown_grace_level_t level) {
+  return dp_thread_shutdown(&stats_thread, &stats_lock, &stats_run, level);
+}
+
+lagopus_result_t
+dp_stats_thread_stop(void) {
+  return dp_thread_stop(&stats_thread, &stats_run);
+}
@@ -20,6 +20,7 @@
  */
 
 #include <inttypes.h>
+#include <pthread.h>
 #include <time.h>
 #include <sys/queue.h>
 
@@ -38,93 +39,198 @@
 #define DPRINTF(...)
 #endif
 
-TAILQ_HEAD(dp_timer_list, dp_timer) dp_timer_list;
+static struct dp_timer_wheel dp_timer_wheel;
+static pthread_mutex_t wheel_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool wheel_initialized = false;
 
 static lagopus_thread_t timer_thread = NULL;
 static bool timer_run = false;
 static lagopus_mutex_t timer_lock = NULL;
 
-
 void
-init_dp_timer(void) {
-  TAILQ_INIT(&dp_timer_list);
-  (void)get_current_time();
+dp_timer_wheel_init(struct dp_timer_wheel *wheel, time_t now) {
+  int i, j;
+
+  wheel->now = now;
+  for (i = 0; i < DP_TIMER_WHEEL_SLOTS0; i++) {
+    TAILQ_INIT(&wheel->slots0[i]);
+  }
+  for (i = 0; i < DP_TIMER_WHEEL_LEVELS - 1; i++) {
+    for (j = 0; j < DP_TIMER_WHEEL_SLOTS; j++) {
+      TAILQ_INIT(&wheel->slots[i][j]);
+    }
+  }
 }
 
-static struct dp_timer *
-find_dp_timer(time_t timeout,
-              int type,
-              struct dp_timer **prev,
-              time_t *prev_timep) {
+static void
+dp_timer_list_free(struct dp_timer_list *list) {
   struct dp_timer *dp_timer;
-  time_t prev_time;
 
-  *prev = NULL;
-  prev_time = 0;
-  TAILQ_FOREACH(dp_timer, &dp_timer_list, next) {
-    if (prev_time + dp_timer->timeout > timeout) {
-      dp_timer = NULL;
-      break;
+  while ((dp_timer = TAILQ_FIRST(list)) != NULL) {
+    TAILQ_REMOVE(list, dp_timer, next);
+    free(dp_timer);
+  }
+}
+
+void
+dp_timer_wheel_fini(struct dp_timer_wheel *wheel) {
+  int i, j;
+
+  for (i = 0; i < DP_TIMER_WHEEL_SLOTS0; i++) {
+    dp_timer_list_free(&wheel->slots0[i]);
+  }
+  for (i = 0; i < DP_TIMER_WHEEL_LEVELS - 1; i++) {
+    for (j = 0; j < DP_TIMER_WHEEL_SLOTS; j++) {
+      dp_timer_list_free(&wheel->slots[i][j]);
     }
-    if (prev_time + dp_timer->timeout == timeout &&
-        dp_timer->type == type &&
-        dp_timer->nentries < MAX_TIMEOUT_ENTRIES) {
-      /* found. */
+  }
+}
+
+/*
+ * Slot of the expiration time.  Level 0 holds timers expiring in
+ * next DP_TIMER_WHEEL_SLOTS0 ticks, upper levels hold timers by
+ * the higher bits of the expiration time.
+ */
+static struct dp_timer_list *
+dp_timer_wheel_slot(struct dp_timer_wheel *wheel, time_t expire) {
+  time_t delta;
+  int level, shift;
+
+  delta = expire - (wheel->now + 1);
+  if (delta < DP_TIMER_WHEEL_SLOTS0) {
+    return &wheel->slots0[expire & (DP_TIMER_WHEEL_SLOTS0 - 1)];
+  }
+  shift = DP_TIMER_WHEEL_BITS0;
+  for (level = 0; level < DP_TIMER_WHEEL_LEVELS - 2; level++) {
+    if (delta < ((time_t)1 << (shift + DP_TIMER_WHEEL_BITS))) {
       break;
     }
-    *prev = dp_timer;
-    prev_time += dp_timer->timeout;
+    shift += DP_TIMER_WHEEL_BITS;
   }
-  *prev_timep = prev_time;
-  return dp_timer;
+  return &wheel->slots[level][(expire >> shift) & (DP_TIMER_WHEEL_SLOTS - 1)];
 }
 
 void *
-add_dp_timer(int type,
-             time_t timeout,
-             void (*expire_func)(struct dp_timer *),
-             void *arg) {
-  struct dp_timer *dp_timer, *prev;
-  time_t prev_time;
-  void *rv;
-
-  dp_timer = find_dp_timer(timeout, type, &prev, &prev_time);
-  if (dp_timer != NULL) {
-    int i;
+dp_timer_wheel_add(struct dp_timer_wheel *wheel,
+                   int type,
+                   time_t timeout,
+                   void (*expire_func)(struct dp_timer *),
+                   void *arg) {
+  struct dp_timer_list *slot;
+  struct dp_timer *dp_timer;
+  time_t expire;
 
-    for (i = 0; i < MAX_TIMEOUT_ENTRIES; i++) {
-      if (dp_timer->timer_entry[i] == NULL) {
-        break;
-      }
-    }
-    dp_timer->timer_entry[i] = arg;
-    rv = &dp_timer->timer_entry[i];
-    if (i == dp_timer->nentries) {
-      dp_timer->nentries++;
-    }
-  } else {
+  if (timeout < 1) {
+    timeout = 1;
+  } else if (timeout > DP_TIMER_WHEEL_MAX_TIMEOUT) {
+    timeout = DP_TIMER_WHEEL_MAX_TIMEOUT;
+  }
+  expire = wheel->now + timeout;
+  slot = dp_timer_wheel_slot(wheel, expire);
+
+  /* timers added in same tick share the last entries. */
+  dp_timer = TAILQ_LAST(slot, dp_timer_list);
+  if (dp_timer == NULL ||
+      dp_timer->expire != expire ||
+      dp_timer->type != type ||
+      dp_timer->expire_func != expire_func ||
+      dp_timer->nentries == MAX_TIMEOUT_ENTRIES) {
     dp_timer = calloc(1, sizeof(struct dp_timer));
     if (dp_timer == NULL) {
       return NULL;
     }
+    dp_timer->expire = expire;
     dp_timer->type = type;
-    dp_timer->timer_entry[0] = arg;
     dp_timer->expire_func = expire_func;
-    rv = &dp_timer->timer_entry[0];
-    dp_timer->nentries++;
-    if (prev == NULL) {
-      dp_timer->timeout = timeout;
-      TAILQ_INSERT_HEAD(&dp_timer_list, dp_timer, next);
-    } else {
-      timeout -= prev_time;
-      dp_timer->timeout = timeout;
-      TAILQ_INSERT_AFTER(&dp_timer_list, prev, dp_timer, next);
-    }
-    /* re-calculation timeout of entries after inserted entry */
-    if ((dp_timer = TAILQ_NEXT(dp_timer, next)) != NULL) {
-      dp_timer->timeout -= timeout;
+    TAILQ_INSERT_TAIL(slot, dp_timer, next);
+  }
+  DPRINTF("add timer type %d expire %ld\n", type, (long)expire);
+  dp_timer->timer_entry[dp_timer->nentries] = arg;
+  return &dp_timer->timer_entry[dp_timer->nentries++];
+}
+
+void
+dp_timer_wheel_readd(struct dp_timer_wheel *wheel,
+                     struct dp_timer *dp_timer,
+                     time_t timeout) {
+  if (timeout < 1) {
+    timeout = 1;
+  } else if (timeout > DP_TIMER_WHEEL_MAX_TIMEOUT) {
+    timeout = DP_TIMER_WHEEL_MAX_TIMEOUT;
+  }
+  dp_timer->expire = wheel->now + timeout;
+  DPRINTF("readd timer type %d expire %ld\n",
+          dp_timer->type, (long)dp_timer->expire);
+  TAILQ_INSERT_TAIL(dp_timer_wheel_slot(wheel, dp_timer->expire),
+                    dp_timer, next);
+}
+
+/*
+ * Move timers in the slot of upper level down to lower levels.
+ */
+static void
+dp_timer_wheel_cascade(struct dp_timer_wheel *wheel,
+                       struct dp_timer_list *slot) {
+  struct dp_timer_list list;
+  struct dp_timer *dp_timer;
+
+  TAILQ_INIT(&list);
+  TAILQ_CONCAT(&list, slot, next);
+  while ((dp_timer = TAILQ_FIRST(&list)) != NULL) {
+    TAILQ_REMOVE(&list, dp_timer, next);
+    TAILQ_INSERT_TAIL(dp_timer_wheel_slot(wheel, dp_timer->expire),
+                      dp_timer, next);
+  }
+}
+
+void
+dp_timer_wheel_advance(struct dp_timer_wheel *wheel, time_t now,
+                       struct dp_timer_list *expired) {
+  time_t tick;
+  int level, shift, idx;
+
+  while (wheel->now < now) {
+    tick = wheel->now + 1;
+    if ((tick & (DP_TIMER_WHEEL_SLOTS0 - 1)) == 0) {
+      shift = DP_TIMER_WHEEL_BITS0;
+      for (level = 0; level < DP_TIMER_WHEEL_LEVELS - 1; level++) {
+        idx = (int)((tick >> shift) & (DP_TIMER_WHEEL_SLOTS - 1));
+        dp_timer_wheel_cascade(wheel, &wheel->slots[level][idx]);
+        if (idx != 0) {
+          break;
+        }
+        shift += DP_TIMER_WHEEL_BITS;
+      }
     }
+    TAILQ_CONCAT(expired,
+                 &wheel->slots0[tick & (DP_TIMER_WHEEL_SLOTS0 - 1)], next);
+    wheel->now = tick;
+  }
+}
+
+void
+init_dp_timer(void) {
+  struct timespec ts;
+
+  pthread_mutex_lock(&wheel_lock);
+  if (wheel_initialized == false) {
+    ts = get_current_time();
+    dp_timer_wheel_init(&dp_timer_wheel, ts.tv_sec);
+    wheel_initialized = true;
   }
+  pthread_mutex_unlock(&wheel_lock);
+}
+
+void *
+add_dp_timer(int type,
+             time_t timeout,
+             void (*expire_func)(struct dp_timer *),
+             void *arg) {
+  void *rv;
+
+  pthread_mutex_lock(&wheel_lock);
+  rv = dp_timer_wheel_add(&dp_timer_wheel, type, timeout, expire_func, arg);
+  pthread_mutex_unlock(&wheel_lock);
   return rv;
 }
 
@@ -135,7 +241,9 @@ dp_timer_expire(struct dp_timer *dp_timer) {
 
 static lagopus_result_t
 dp_timer_thread_loop(const lagopus_thread_t *t, void *arg) {
+  struct dp_timer_list expired;
   struct dp_timer *dp_timer;
+  struct timespec ts;
   lagopus_result_t rv;
   global_state_t cur_state;
   shutdown_grace_level_t cur_grace;
@@ -151,32 +259,22 @@ dp_timer_thread_loop(const lagopus_thread_t *t, void *arg) {
     return rv;
   }
 
+  TAILQ_INIT(&expired);
   while (timer_run == true) {
-    /* XXX flowdb lock */
-    dp_timer = TAILQ_FIRST(&dp_timer_list);
-    if (dp_timer == NULL) {
-      sleep(1);
-      continue;
-    }
-    /* XXX flowdb unlock */
-    do {
-      unsigned int elapsed;
-
-      while (dp_timer->timeout > 0) {
-        elapsed = sleep(1);
-        (void)get_current_time();
-        if (elapsed == 0) {
-          dp_timer->timeout--;
-        }
-      }
-      /* XXX flowdb lock */
+    (void)sleep(1);
+    ts = get_current_time();
+
+    /* flow timers, expired flows are removed per bridge at once. */
+    flow_timer_expire_all(ts.tv_sec);
+
+    pthread_mutex_lock(&wheel_lock);
+    dp_timer_wheel_advance(&dp_timer_wheel, ts.tv_sec, &expired);
+    pthread_mutex_unlock(&wheel_lock);
+    while ((dp_timer = TAILQ_FIRST(&expired)) != NULL) {
+      TAILQ_REMOVE(&expired, dp_timer, next);
       dp_timer_expire(dp_timer);
-      TAILQ_REMOVE(&dp_timer_list, dp_timer, next);
       free(dp_timer);
-      dp_timer = TAILQ_FIRST(&dp_timer_list);
-      /* XXX flowdb unlock */
-    } while (dp_timer != NULL);
-    sched_yield();
+    }
   }
 
   return LAGOPUS_RESULT_OK;
@@ -19,23 +19,112 @@
 
 enum {
   FLOW_TIMER,
-  MBTREE_TIMER,
+  CLASSIFIER_TIMER,
   UPDATER_TIMER,
   LINK_TIMER,
-  THTABLE_TIMER,
 };
 
 #define MAX_TIMEOUT_ENTRIES 256
 
+/*
+ * Hierarchical timing wheel of one second tick.  Level 0 has a slot
+ * for each second of the next DP_TIMER_WHEEL_SLOTS0 seconds, and each
+ * slot of upper levels covers all slots of the level below.  Timers
+ * in upper levels are moved down when the level below wraps around.
+ */
+#define DP_TIMER_WHEEL_BITS0 8
+#define DP_TIMER_WHEEL_BITS 6
+#define DP_TIMER_WHEEL_LEVELS 4
+#define DP_TIMER_WHEEL_SLOTS0 (1 << DP_TIMER_WHEEL_BITS0)
+#define DP_TIMER_WHEEL_SLOTS (1 << DP_TIMER_WHEEL_BITS)
+#define DP_TIMER_WHEEL_MAX_TIMEOUT                                      \
+  (((time_t)1 << (DP_TIMER_WHEEL_BITS0 +                                \
+                  DP_TIMER_WHEEL_BITS * (DP_TIMER_WHEEL_LEVELS - 1))) - 1)
+
+/*
+ * Timer entries of same type and same expiration.  An entry is
+ * cancelled by clearing it through the pointer returned from
+ * add_dp_timer() or dp_timer_wheel_add().
+ */
 struct dp_timer {
   TAILQ_ENTRY(dp_timer) next;
-  time_t timeout;
+  time_t expire;
   int type;
   void (*expire_func)(struct dp_timer *);
   int nentries;
   void *timer_entry[MAX_TIMEOUT_ENTRIES];
 };
 
+TAILQ_HEAD(dp_timer_list, dp_timer);
+
+struct dp_timer_wheel {
+  time_t now;                   /* last tick processed. */
+  struct dp_timer_list slots0[DP_TIMER_WHEEL_SLOTS0];
+  struct dp_timer_list slots[DP_TIMER_WHEEL_LEVELS - 1][DP_TIMER_WHEEL_SLOTS];
+};
+
+/**
+ * Initialize timing wheel.
+ *
+ * @param[in]   wheel   Timing wheel.
+ * @param[in]   now     Current time in seconds.
+ */
+void
+dp_timer_wheel_init(struct dp_timer_wheel *wheel, time_t now);
+
+/**
+ * Free timers left in timing wheel.
+ *
+ * @param[in]   wheel   Timing wheel.
+ */
+void
+dp_timer_wheel_fini(struct dp_timer_wheel *wheel);
+
+/**
+ * Add timer entry to timing wheel.  Timer expires at least one tick
+ * later.
+ *
+ * @param[in]   wheel           Timing wheel.
+ * @param[in]   type            Timer type.
+ * @param[in]   timeout         Timeout in seconds.
+ * @param[in]   expire_func     Called with expired timers.
+ * @param[in]   arg             Timer entry.
+ *
+ * @retval      !=NULL  Pointer to the entry, for cancellation.
+ * @retval      ==NULL  Memory exhausted.
+ */
+void *
+dp_timer_wheel_add(struct dp_timer_wheel *wheel,
+                   int type,
+                   time_t timeout,
+                   void (*expire_func)(struct dp_timer *),
+                   void *arg);
+
+/**
+ * Put an expired timer back to timing wheel without allocation.
+ * Entries left in the timer keep their pointers for cancellation.
+ *
+ * @param[in]   wheel           Timing wheel.
+ * @param[in]   dp_timer        Expired timer.
+ * @param[in]   timeout         Timeout in seconds.
+ */
+void
+dp_timer_wheel_readd(struct dp_timer_wheel *wheel,
+                     struct dp_timer *dp_timer,
+                     time_t timeout);
+
+/**
+ * Advance timing wheel to now, and move expired timers to list.
+ * Timers are not called, caller calls expire_func and frees them.
+ *
+ * @param[in]   wheel   Timing wheel.
+ * @param[in]   now     Current time in seconds.
+ * @param[out]  expired Expired timers.
+ */
+void
+dp_timer_wheel_advance(struct dp_timer_wheel *wheel, time_t now,
+                       struct dp_timer_list *expired);
+
 void
 init_dp_timer(void);
 
@@ -46,19 +135,26 @@ add_dp_timer(int type,
              void *arg);
 
 struct flow;
-struct flow_list;
+struct flowdb;
 struct interface;
 struct bridge;
 
+/**
+ * Timing wheel of flow timers of the flow database, protected by the
+ * flowdb write lock.
+ */
+struct dp_timer_wheel *
+flowdb_timer_wheel(struct flowdb *flowdb);
+
 lagopus_result_t
 add_flow_timer(struct flow *flow);
+void
+flow_timer_expire_all(time_t now);
 lagopus_result_t
-add_mbtree_timer(struct flow_list *flow_list, time_t timeout);
+add_classifier_timer(time_t timeout);
 lagopus_result_t
 add_link_timer(struct interface *ifp);
 lagopus_result_t
 add_updater_timer(struct bridge *bridge, time_t timeout);
-lagopus_result_t
-add_thtable_timer(struct flow_list *flow_list, time_t timeout);
 
 #endif /* SRC_DATAPLANE_MGR_DP_TIMER_H_ */
@@ -0,0 +1,182 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ *      @file   epoch.c
+ *      @brief  Epoch based synchronization between forwarding threads
+ *              and flow database writers.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "lagopus_apis.h"
+#include "epoch.h"
+
+/**
+ * Per thread state.  epoch is the global epoch observed at entering
+ * the section, 0 while the thread is out of the section.
+ */
+struct dp_epoch_slot {
+  volatile uint64_t epoch;
+  volatile bool used;
+  unsigned int nest;
+} __attribute__((aligned(64)));
+
+static struct dp_epoch_slot epoch_slots[DP_EPOCH_THREADS_MAX];
+static volatile uint64_t epoch_global = 1;
+static volatile bool epoch_exclusive = false;
+
+static __thread struct dp_epoch_slot *epoch_self = NULL;
+static pthread_key_t epoch_key;
+static pthread_once_t epoch_once = PTHREAD_ONCE_INIT;
+
+static void
+epoch_slot_release(void *arg) {
+  struct dp_epoch_slot *slot;
+
+  slot = arg;
+  slot->nest = 0;
+  slot->epoch = 0;
+  mbar();
+  slot->used = false;
+}
+
+static void
+epoch_key_create(void) {
+  (void)pthread_key_create(&epoch_key, epoch_slot_release);
+}
+
+static struct dp_epoch_slot *
+epoch_slot_get(void) {
+  struct dp_epoch_slot *slot;
+  int i;
+
+  if (likely(epoch_self != NULL)) {
+    return epoch_self;
+  }
+  (void)pthread_once(&epoch_once, epoch_key_create);
+  for (i = 0; i < DP_EPOCH_THREADS_MAX; i++) {
+    slot = &epoch_slots[i];
+    if (slot->used == false &&
+        __sync_bool_compare_and_swap(&slot->used, false, true) == true) {
+      slot->nest = 0;
+      slot->epoch = 0;
+      (void)pthread_setspecific(epoch_key, slot);
+      epoch_self = slot;
+      return slot;
+    }
+  }
+  lagopus_exit_fatal("too many threads in epoch section (max %d).\n",
+                     DP_EPOCH_THREADS_MAX);
+  return NULL;
+}
+
+static void
+epoch_section_begin(struct dp_epoch_slot *slot) {
+  for (;;) {
+    slot->epoch = epoch_global;
+    mbar();
+    if (likely(epoch_exclusive == false)) {
+      break;
+    }
+    /* writer is modifying data in place, step aside. */
+    slot->epoch = 0;
+    mbar();
+    while (epoch_exclusive == true) {
+      sched_yield();
+    }
+  }
+}
+
+void
+dp_epoch_enter(void) {
+  struct dp_epoch_slot *slot;
+
+  slot = epoch_slot_get();
+  if (slot->nest++ != 0) {
+    return;
+  }
+  epoch_section_begin(slot);
+}
+
+bool
+dp_epoch_check(const volatile bool *exclusive) {
+  struct dp_epoch_slot *slot;
+
+  if (likely(*exclusive == false)) {
+    return true;
+  }
+  /* step aside until the writer finishes. */
+  slot = epoch_self;
+  slot->epoch = 0;
+  mbar();
+  while (*exclusive == true) {
+    sched_yield();
+  }
+  epoch_section_begin(slot);
+  return false;
+}
+
+void
+dp_epoch_exit(void) {
+  struct dp_epoch_slot *slot;
+
+  slot = epoch_self;
+  if (slot == NULL || slot->nest == 0 || --slot->nest != 0) {
+    return;
+  }
+  mbar();
+  slot->epoch = 0;
+}
+
+void
+dp_epoch_synchronize(void) {
+  struct dp_epoch_slot *slot;
+  uint64_t target;
+  int i;
+
+  target = __sync_add_and_fetch(&epoch_global, 1);
+  for (i = 0; i < DP_EPOCH_THREADS_MAX; i++) {
+    slot = &epoch_slots[i];
+    if (slot == epoch_self) {
+      continue;
+    }
+    while (slot->used == true && slot->epoch != 0 && slot->epoch < target) {
+      sched_yield();
+    }
+  }
+  mbar();
+}
+
+void
+dp_epoch_exclusive_begin(volatile bool *exclusive) {
+  if (exclusive == NULL) {
+    exclusive = &epoch_exclusive;
+  }
+  *exclusive = true;
+  mbar();
+  dp_epoch_synchronize();
+}
+
+void
+dp_epoch_exclusive_end(volatile bool *exclusive) {
+  if (exclusive == NULL) {
+    exclusive = &epoch_exclusive;
+  }
+  mbar();
+  *exclusive = false;
+}
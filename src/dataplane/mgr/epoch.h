@@ -0,0 +1,86 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ *      @file   epoch.h
+ *      @brief  Epoch based synchronization between forwarding threads
+ *              and flow database writers.
+ *
+ * Forwarding threads enclose each burst with dp_epoch_enter() and
+ * dp_epoch_exit().  A writer publishes new data with a pointer store,
+ * then calls dp_epoch_synchronize() to wait until every thread that
+ * might still see the old data has left its burst.
+ */
+
+#ifndef SRC_DATAPLANE_MGR_EPOCH_H_
+#define SRC_DATAPLANE_MGR_EPOCH_H_
+
+#include <stdbool.h>
+
+/* max number of threads entering epoch section. */
+#define DP_EPOCH_THREADS_MAX    128
+
+/**
+ * Enter read side section of the calling thread.
+ * The section may be nested.
+ */
+void dp_epoch_enter(void);
+
+/**
+ * Leave read side section of the calling thread.
+ */
+void dp_epoch_exit(void);
+
+/**
+ * Wait until all threads in read side section entered before the call
+ * have left it.  Section of the calling thread is not waited.
+ */
+void dp_epoch_synchronize(void);
+
+/**
+ * Check exclusive flag of the data about to be read in read side
+ * section.  If the flag is set, leave the section until the writer
+ * finishes and enter again.  Must be called before reading the data,
+ * outside of nested section.
+ *
+ * @param[in]   exclusive       Exclusive flag of the data.
+ *
+ * @retval      true    Section is kept.
+ * @retval      false   Section is entered again, data read so far
+ *                      in the section must be read again.
+ */
+bool dp_epoch_check(const volatile bool *exclusive);
+
+/**
+ * Stop threads entering read side section for the data, and wait
+ * until all threads have left it.  Used when data read by forwarding
+ * threads is modified in place.  Writers must be serialized by the
+ * caller.
+ *
+ * @param[in]   exclusive       Exclusive flag of the data,
+ *                              NULL for all data.
+ */
+void dp_epoch_exclusive_begin(volatile bool *exclusive);
+
+/**
+ * Allow threads to enter read side section for the data again.
+ *
+ * @param[in]   exclusive       Exclusive flag of the data,
+ *                              NULL for all data.
+ */
+void dp_epoch_exclusive_end(volatile bool *exclusive);
+
+#endif /* SRC_DATAPLANE_MGR_EPOCH_H_ */
@@ -19,6 +19,10 @@
 #include "lagopus_apis.h"
 #include "lagopus/dataplane.h"
 #include "lagopus/flowdb.h"
+#include "lagopus/bridge.h"
+#include "lagopus/dp_apis.h"
+#include "lock.h"
+#include "counter.h"
 #include "dp_timer.h"
 
 #undef DEBUG
@@ -30,50 +34,82 @@
 #define DPRINTF(...)
 #endif
 
+/* expired flows of a bridge, used by the timer thread only. */
+static struct flow_expire *expired_flows = NULL;
+static struct eventq_data **removed_msgs = NULL;
+static size_t expired_max = 0;
+
+static bool
+flow_timer_expired_grow(void) {
+  struct flow_expire *flows;
+  struct eventq_data **msgs;
+  size_t max;
+
+  max = (expired_max == 0) ? 1024 : expired_max * 2;
+  flows = realloc(expired_flows, sizeof(*flows) * max);
+  if (flows == NULL) {
+    return false;
+  }
+  expired_flows = flows;
+  msgs = realloc(removed_msgs, sizeof(*msgs) * max);
+  if (msgs == NULL) {
+    return false;
+  }
+  removed_msgs = msgs;
+  expired_max = max;
+  return true;
+}
+
+/*
+ * Take the latest time the flow is hit by forwarding threads, which
+ * is recorded in the flow counter instead of the flow itself.
+ */
 static void
-flow_timer_expire(struct dp_timer *dp_timer) {
-  struct flow *flow;
-  struct ofp_error error;
+flow_timer_update_time(struct flow *flow, time_t now) {
+  struct dp_counter counter;
+  time_t seen;
+
+  dp_counter_get(flow->counter_id, &counter);
+  seen = (time_t)counter.seen;
+  if (seen > now) {
+    seen = now;
+  }
+  if (seen > flow->update_time.tv_sec) {
+    flow->update_time.tv_sec = seen;
+    flow->update_time.tv_nsec = 0;
+  }
+}
+
+static int
+flow_timer_reason(struct flow *flow, time_t now) {
   int reason;
-  int i;
 
-  DPRINTF("expired\n");
-  for (i = 0; i < dp_timer->nentries; i++) {
-    /* calculate elapsed time */
-    flow = dp_timer->timer_entry[i];
-    if (flow == NULL) {
-      continue;
-    }
-    reason = -1;
-    if (flow->hard_timeout != 0 &&
-        now_ts.tv_sec - flow->create_time.tv_sec >= flow->hard_timeout) {
-      /* hard timeout. */
-      reason = OFPRR_HARD_TIMEOUT;
-    }
-    if (flow->idle_timeout != 0 &&
-        now_ts.tv_sec - flow->update_time.tv_sec >= flow->idle_timeout) {
-      /* idle timeout. */
-      reason = OFPRR_IDLE_TIMEOUT;
-    }
-    if (reason != -1) {
-      flow->flow_timer = NULL;
-      flow_remove_with_reason(flow, flow->bridge, (uint8_t)reason, &error);
-    } else {
-      /* flow timeout is updated. */
-      add_flow_timer(flow);
-    }
+  reason = -1;
+  if (flow->idle_timeout != 0) {
+    flow_timer_update_time(flow, now);
+  }
+  if (flow->hard_timeout != 0 &&
+      now - flow->create_time.tv_sec >= flow->hard_timeout) {
+    /* hard timeout. */
+    reason = OFPRR_HARD_TIMEOUT;
   }
+  if (flow->idle_timeout != 0 &&
+      now - flow->update_time.tv_sec >= flow->idle_timeout) {
+    /* idle timeout. */
+    reason = OFPRR_IDLE_TIMEOUT;
+  }
+  return reason;
 }
 
-lagopus_result_t
-add_flow_timer(struct flow *flow) {
+static lagopus_result_t
+flow_timer_add(struct flow *flow, time_t now) {
   void *entryp;
   time_t timeout, idle_elapsed, hard_elapsed;
 
   idle_elapsed =
-    (time_t)flow->idle_timeout - (now_ts.tv_sec - flow->update_time.tv_sec);
+    (time_t)flow->idle_timeout - (now - flow->update_time.tv_sec);
   hard_elapsed =
-    (time_t)flow->hard_timeout - (now_ts.tv_sec - flow->create_time.tv_sec);
+    (time_t)flow->hard_timeout - (now - flow->create_time.tv_sec);
   if (flow->idle_timeout > 0 && flow->hard_timeout > 0) {
     timeout = MIN(idle_elapsed, hard_elapsed);
   } else if (flow->idle_timeout > 0) {
@@ -82,9 +118,99 @@ add_flow_timer(struct flow *flow) {
     timeout = hard_elapsed;
   }
   DPRINTF("add timeout %d sec\n", timeout);
-  entryp = add_dp_timer(FLOW_TIMER, timeout, flow_timer_expire, flow);
-  if (entryp != NULL) {
-    flow->flow_timer = entryp;
+  /* flow timers are expired by flow_timer_expire_all(). */
+  entryp = dp_timer_wheel_add(flowdb_timer_wheel(flow->bridge->flowdb),
+                              FLOW_TIMER, timeout, NULL, flow);
+  flow->flow_timer = entryp;
+  if (entryp == NULL) {
+    return LAGOPUS_RESULT_NO_MEMORY;
   }
   return LAGOPUS_RESULT_OK;
 }
+
+/*
+ * Expire flow timers of the bridge.  Expired flows are removed in
+ * one write section, and OFPT_FLOW_REMOVED messages are queued at
+ * once after unlock.
+ */
+static bool
+flow_timer_bridge_expire(void *key, void *val,
+                         lagopus_hashentry_t he, void *arg) {
+  struct bridge *bridge;
+  struct dp_timer_list expired;
+  struct dp_timer *dp_timer;
+  struct flow *flow;
+  size_t nflows, nmsgs;
+  time_t now;
+  bool retry;
+  int reason;
+  int i;
+
+  (void) key;
+  (void) he;
+
+  bridge = val;
+  now = *(time_t *)arg;
+  nflows = 0;
+  nmsgs = 0;
+  TAILQ_INIT(&expired);
+
+  flowdb_flowmod_lock_nested(bridge->flowdb);
+  dp_timer_wheel_advance(flowdb_timer_wheel(bridge->flowdb), now, &expired);
+  while ((dp_timer = TAILQ_FIRST(&expired)) != NULL) {
+    TAILQ_REMOVE(&expired, dp_timer, next);
+    DPRINTF("expired\n");
+    retry = false;
+    for (i = 0; i < dp_timer->nentries; i++) {
+      flow = dp_timer->timer_entry[i];
+      if (flow == NULL) {
+        continue;
+      }
+      dp_timer->timer_entry[i] = NULL;
+      reason = flow_timer_reason(flow, now);
+      if (reason == -1 ||
+          (nflows == expired_max && flow_timer_expired_grow() == false)) {
+        /* flow timeout is updated, or retried in next tick. */
+        if (flow_timer_add(flow, now) != LAGOPUS_RESULT_OK) {
+          /* keep the flow in this timer, retried in next tick. */
+          lagopus_msg_warning("flow timer re-arm failed, retry\n");
+          dp_timer->timer_entry[i] = flow;
+          flow->flow_timer = (void *)&dp_timer->timer_entry[i];
+          retry = true;
+        }
+        continue;
+      }
+      flow->flow_timer = NULL;
+      expired_flows[nflows].flow = flow;
+      expired_flows[nflows].reason = (uint8_t)reason;
+      nflows++;
+    }
+    if (retry == true) {
+      dp_timer_wheel_readd(flowdb_timer_wheel(bridge->flowdb), dp_timer, 1);
+    } else {
+      free(dp_timer);
+    }
+  }
+  if (nflows > 0) {
+    nmsgs = flow_remove_expired_nolock(bridge, expired_flows, nflows,
+                                       removed_msgs);
+  }
+  flowdb_flowmod_unlock_nested(bridge->flowdb);
+
+  if (nmsgs > 0) {
+    send_flow_removed_n(bridge->dpid, removed_msgs, nmsgs);
+  }
+  return true;
+}
+
+void
+flow_timer_expire_all(time_t now) {
+  flowdb_rdlock(NULL);
+  (void)dp_bridge_iterate(flow_timer_bridge_expire, &now);
+  flowdb_rdunlock(NULL);
+}
+
+lagopus_result_t
+add_flow_timer(struct flow *flow) {
+  return flow_timer_add(flow, now_ts.tv_sec);
+}
@@ -42,9 +42,35 @@
 #include "../agent/openflow13packet.h"
 
 #include "lock.h"
+#include "counter.h"
+#include "dp_timer.h"
 
 #include "callback.h"
 
+/*
+ * Classifier updates in the write section.  Hooks update the shadow
+ * classifier of the table; flowdb_publish() swaps it with the one used
+ * by forwarding threads, waits until they leave and replays updates to
+ * the other copy.  Removed flows and instructions are freed then.
+ */
+enum flowdb_update_op {
+  FLOWDB_UPDATE_ADD,            /** flow is added to the table. */
+  FLOWDB_UPDATE_DEL,            /** flow is removed from the table. */
+  FLOWDB_UPDATE_REBUILD,        /** classifier of the table is changed. */
+  FLOWDB_UPDATE_FREE_INSTRUCTIONS       /** instruction list is replaced. */
+};
+
+struct flowdb_update {
+  enum flowdb_update_op op;
+  struct table *table;
+  void *arg;
+};
+
+#define FLOWDB_UPDATE_LOG_MAX 4096
+
+/* flows scanned by a flow stats walk in one lock section. */
+#define FLOW_STATS_WALK_MAX 4096
+
 /**
  * @brief Flow database.
  */
@@ -57,11 +83,34 @@ struct flowdb {
   uint8_t table_size;           /** Flow table size. */
   struct table **tables;        /** Flow table. */
   enum switch_mode switch_mode; /** Switch mode. */
-
+  volatile bool exclusive;      /** Modified in place by the writer. */
+  struct flowdb_update *update_log;     /** Updates not published yet. */
+  int update_count;             /** Number of entries in update_log. */
+  struct dp_timer_wheel timer_wheel;    /** Flow timers. */
 };
 
+#ifdef HAVE_DPDK
+#define FLOWDB_LOCK_INIT(flowdb) rte_rwlock_init(&(flowdb)->rwlock)
+#define FLOWDB_LOCK_DESTROY(flowdb)
+#define FLOWDB_RDLOCK(flowdb) rte_rwlock_read_lock(&(flowdb)->rwlock)
+#define FLOWDB_RDUNLOCK(flowdb) rte_rwlock_read_unlock(&(flowdb)->rwlock)
+#define FLOWDB_WRLOCK(flowdb) rte_rwlock_write_lock(&(flowdb)->rwlock)
+#define FLOWDB_WRUNLOCK(flowdb) rte_rwlock_write_unlock(&(flowdb)->rwlock)
+#else
+#define FLOWDB_LOCK_INIT(flowdb) pthread_rwlock_init(&(flowdb)->rwlock, NULL)
+#define FLOWDB_LOCK_DESTROY(flowdb) pthread_rwlock_destroy(&(flowdb)->rwlock)
+#define FLOWDB_RDLOCK(flowdb) pthread_rwlock_rdlock(&(flowdb)->rwlock)
+#define FLOWDB_RDUNLOCK(flowdb) pthread_rwlock_unlock(&(flowdb)->rwlock)
+#define FLOWDB_WRLOCK(flowdb) pthread_rwlock_wrlock(&(flowdb)->rwlock)
+#define FLOWDB_WRUNLOCK(flowdb) pthread_rwlock_unlock(&(flowdb)->rwlock)
+#endif /* HAVE_DPDK */
+
+/* seconds to wait for more changes before profiling flows. */
 #define UPDATE_TIMEOUT 2
 
+/* tables having less flows are not worth special classifiers. */
+#define CLASSIFIER_AUTO_MIN_FLOWS 64
+
 #define PUT_TIMEOUT 100LL * 1000LL * 1000LL
 
 #define OXM_FIELD_TYPE(X)       ((X) >> 1)
@@ -77,6 +126,9 @@ struct flowdb {
 static lagopus_result_t
 send_flow_removed(uint64_t dpid, struct flow *flow, uint8_t reason);
 
+static struct eventq_data *
+flow_removed_alloc(struct flow *flow, uint8_t reason);
+
 static void
 flow_del_from_meter(struct meter_table *meter_table, struct flow *flow);
 
@@ -204,6 +256,7 @@ flow_free(struct flow *flow) {
     /* clear relationship. */
     *flow->flow_timer = NULL;
   }
+  dp_counter_free(flow->counter_id);
   match_list_entry_free(&flow->match_list);
   instruction_list_entry_free(&flow->instruction_list);
   free(flow);
@@ -237,6 +290,7 @@ flow_alloc(struct ofp_flow_mod *flow_mod,
   flow->cookie = flow_mod->cookie;
   flow->idle_timeout = flow_mod->idle_timeout;
   flow->hard_timeout = flow_mod->hard_timeout;
+  flow->counter_id = dp_counter_alloc();
   TAILQ_INIT(&flow->match_list);
   TAILQ_CONCAT(&flow->match_list, match_list, entry);
   TAILQ_INIT(&flow->instruction_list);
@@ -265,9 +319,16 @@ table_alloc(uint8_t table_id) {
   }
 
   table->table_id = table_id;
+  table->lookup_counter_id = dp_counter_alloc();
+  table->matched_counter_id = dp_counter_alloc();
   table->flow_list = calloc(1, sizeof(struct flow_list)
                             + sizeof(void *) * 65536);
   table->flow_list->nbranch = 65536;
+#if defined(USE_THTABLE)
+  table->classifier = TABLE_CLASSIFIER_THTABLE;
+#elif defined(USE_MBTREE)
+  table->classifier = TABLE_CLASSIFIER_MBTREE;
+#endif /* USE_THTABLE */
   return table;
 }
 
@@ -291,30 +352,476 @@ table_free(struct table *table) {
   int nflow, i;
 
   flow_list = table->flow_list;
-#ifdef USE_MBTREE
-  cleanup_mbtree(flow_list);
-#endif /* USE_MBTREE */
-#ifdef USE_THTABLE
-  thtable_free(flow_list->thtable);
-#endif /* USE_THTABLE */
   nflow = flow_list->nflow;
   for (i = 0; i < nflow; i++) {
     flow_free(flow_list->flows[i]);
   }
   free(flow_list);
+  dp_counter_free(table->lookup_counter_id);
+  dp_counter_free(table->matched_counter_id);
   free(table);
 }
 
 void
 flowdb_lock_init(struct flowdb *flowdb) {
-  (void) flowdb;
-  FLOWDB_RWLOCK_INIT();
+  if (flowdb == NULL) {
+    FLOWDB_RWLOCK_INIT();
+  } else {
+    FLOWDB_LOCK_INIT(flowdb);
+  }
+}
+
+void
+flowdb_rdlock(struct flowdb *flowdb) {
+  FLOWDB_RWLOCK_RDLOCK();
+  if (flowdb != NULL) {
+    FLOWDB_RDLOCK(flowdb);
+  }
+}
+
+void
+flowdb_rdunlock(struct flowdb *flowdb) {
+  if (flowdb != NULL) {
+    FLOWDB_RDUNLOCK(flowdb);
+  }
+  FLOWDB_RWLOCK_RDUNLOCK();
+}
+
+void
+flowdb_wrlock(struct flowdb *flowdb) {
+  if (flowdb == NULL) {
+    FLOWDB_UPDATE_BEGIN();
+    FLOWDB_RWLOCK_WRLOCK();
+    dp_epoch_exclusive_begin(NULL);
+  } else {
+    /* other bridges are not affected. */
+    FLOWDB_RWLOCK_RDLOCK();
+    FLOWDB_WRLOCK(flowdb);
+    dp_epoch_exclusive_begin(&flowdb->exclusive);
+  }
+}
+
+void
+flowdb_wrunlock(struct flowdb *flowdb) {
+  if (flowdb == NULL) {
+    dp_epoch_exclusive_end(NULL);
+    FLOWDB_RWLOCK_WRUNLOCK();
+    FLOWDB_UPDATE_END();
+  } else {
+    flowdb_publish(flowdb);
+    dp_epoch_exclusive_end(&flowdb->exclusive);
+    FLOWDB_WRUNLOCK(flowdb);
+    FLOWDB_RWLOCK_RDUNLOCK();
+  }
+}
+
+void
+flowdb_flowmod_lock(struct flowdb *flowdb) {
+  FLOWDB_RWLOCK_RDLOCK();
+  flowdb_flowmod_lock_nested(flowdb);
+}
+
+void
+flowdb_flowmod_unlock(struct flowdb *flowdb) {
+  flowdb_flowmod_unlock_nested(flowdb);
+  FLOWDB_RWLOCK_RDUNLOCK();
+}
+
+void
+flowdb_flowmod_lock_nested(struct flowdb *flowdb) {
+  FLOWDB_WRLOCK(flowdb);
+}
+
+void
+flowdb_flowmod_unlock_nested(struct flowdb *flowdb) {
+  flowdb_publish(flowdb);
+  FLOWDB_WRUNLOCK(flowdb);
+}
+
+struct dp_timer_wheel *
+flowdb_timer_wheel(struct flowdb *flowdb) {
+  return &flowdb->timer_wheel;
+}
+
+bool
+flowdb_epoch_check(struct flowdb *flowdb) {
+  return dp_epoch_check(&flowdb->exclusive);
+}
+
+/*
+ * rebuild the writer's copy of the classifier from flows of the table.
+ */
+static void
+table_classifier_rebuild(struct table *table) {
+  struct flowinfo *flowinfo;
+  int i;
+
+  flowinfo = table->shadow;
+  if (flowinfo != NULL) {
+    flowinfo->destroy_func(flowinfo);
+    table->shadow = NULL;
+  }
+  if (lagopus_add_flow_hook != NULL) {
+    for (i = 0; i < table->flow_list->nflow; i++) {
+      lagopus_add_flow_hook(table->flow_list->flows[i], table);
+    }
+  }
+}
+
+static void
+flowdb_update_log(struct flowdb *flowdb, enum flowdb_update_op op,
+                  struct table *table, void *arg) {
+  struct flowdb_update *update;
+
+  if (flowdb->update_count == FLOWDB_UPDATE_LOG_MAX) {
+    flowdb_publish(flowdb);
+  }
+  update = &flowdb->update_log[flowdb->update_count++];
+  update->op = op;
+  update->table = table;
+  update->arg = arg;
+  if (op != FLOWDB_UPDATE_FREE_INSTRUCTIONS) {
+    table->dirty = true;
+  }
+}
+
+void
+flowdb_publish(struct flowdb *flowdb) {
+  struct flowdb_update *update;
+  struct table *table;
+  void *userdata;
+  int i;
+
+  if (flowdb == NULL || flowdb->update_count == 0) {
+    return;
+  }
+  /* publish updated classifiers. */
+  for (i = 0; i < flowdb->update_count; i++) {
+    table = flowdb->update_log[i].table;
+    if (table != NULL && table->dirty == true) {
+      userdata = table->userdata;
+      mbar();
+      table->userdata = table->shadow;
+      table->shadow = userdata;
+      table->dirty = false;
+    }
+  }
+  /*
+   * invalidate cached entries referring changed tables.  forwarding
+   * threads read the generation before the classifier, then the entry
+   * registered with new generation never holds flows of old one.
+   */
+  mbar();
+  for (i = 0; i < flowdb->update_count; i++) {
+    table = flowdb->update_log[i].table;
+    if (table != NULL) {
+      table->generation++;
+    }
+  }
+  dp_epoch_synchronize();
+
+  /* old classifiers are not used anymore, bring them up to date. */
+  for (i = 0; i < flowdb->update_count; i++) {
+    update = &flowdb->update_log[i];
+    switch (update->op) {
+      case FLOWDB_UPDATE_ADD:
+        if (lagopus_add_flow_hook != NULL) {
+          lagopus_add_flow_hook(update->arg, update->table);
+        }
+        break;
+      case FLOWDB_UPDATE_DEL:
+        if (lagopus_del_flow_hook != NULL) {
+          lagopus_del_flow_hook(update->arg, update->table);
+        }
+        break;
+      case FLOWDB_UPDATE_REBUILD:
+        table_classifier_rebuild(update->table);
+        break;
+      default:
+        break;
+    }
+  }
+  for (i = 0; i < flowdb->update_count; i++) {
+    update = &flowdb->update_log[i];
+    switch (update->op) {
+      case FLOWDB_UPDATE_DEL:
+        flow_free(update->arg);
+        break;
+      case FLOWDB_UPDATE_FREE_INSTRUCTIONS:
+        instruction_list_entry_free(update->arg);
+        free(update->arg);
+        break;
+      default:
+        break;
+    }
+  }
+  flowdb->update_count = 0;
+}
+
+/*
+ * count flows by match type, then classifier of the table in auto
+ * mode is chosen again after changes settle.
+ */
+static void
+table_profile_update(struct table *table, struct flow *flow, int delta) {
+  struct match *match;
+  int type;
+
+  TAILQ_FOREACH(match, &flow->match_list, entry) {
+    type = OXM_FIELD_TYPE(match->oxm_field);
+    if (type <= OFPXMT_OFB_IPV6_EXTHDR) {
+      table->flow_match_type_count[type] += (uint32_t)delta;
+    }
+  }
+  if (table->classifier_auto == true && table->profile_pending == false &&
+      add_classifier_timer(UPDATE_TIMEOUT) == LAGOPUS_RESULT_OK) {
+    table->profile_pending = true;
+  }
+}
+
+static int
+signature_cmp(const void *a, const void *b) {
+  uint64_t s1 = *(const uint64_t *)a, s2 = *(const uint64_t *)b;
+
+  return (s1 > s2) - (s1 < s2);
+}
+
+/*
+ * signature of fields and masks of the flow, independent of order
+ * of the match list.
+ */
+static uint64_t
+flow_mask_signature(struct flow *flow) {
+  struct match *match;
+  uint64_t sig, h;
+  int i, len;
+
+  sig = 0;
+  TAILQ_FOREACH(match, &flow->match_list, entry) {
+    h = 14695981039346656037ULL;
+    h = (h ^ match->oxm_field) * 1099511628211ULL;
+    if ((match->oxm_field & 1) != 0) {
+      len = match->oxm_length / 2;
+      for (i = len; i < len * 2; i++) {
+        h = (h ^ match->oxm_value[i]) * 1099511628211ULL;
+      }
+    }
+    sig += h;
+  }
+  return sig;
+}
+
+static int
+table_mask_count(struct table *table) {
+  struct flow_list *flow_list;
+  uint64_t *sig;
+  int i, nmask;
+
+  flow_list = table->flow_list;
+  sig = malloc(sizeof(uint64_t) * (size_t)flow_list->nflow);
+  if (sig == NULL) {
+    return flow_list->nflow;
+  }
+  for (i = 0; i < flow_list->nflow; i++) {
+    sig[i] = flow_mask_signature(flow_list->flows[i]);
+  }
+  qsort(sig, (size_t)flow_list->nflow, sizeof(uint64_t), signature_cmp);
+  nmask = 0;
+  for (i = 0; i < flow_list->nflow; i++) {
+    if (i == 0 || sig[i] != sig[i - 1]) {
+      nmask++;
+    }
+  }
+  free(sig);
+  return nmask;
+}
+
+static int
+table_masked_count(struct table *table) {
+  struct flow_list *flow_list;
+  struct match *match;
+  int i, n;
+
+  flow_list = table->flow_list;
+  n = 0;
+  for (i = 0; i < flow_list->nflow; i++) {
+    TAILQ_FOREACH(match, &flow_list->flows[i]->match_list, entry) {
+      if ((match->oxm_field & 1) != 0) {
+        n++;
+        break;
+      }
+    }
+  }
+  return n;
+}
+
+/*
+ * flowinfo narrows flows by L2 and L3 fields, then compares the rest
+ * one by one.  Exact match costs a hash lookup per set of fields if
+ * few flows have masks.  Tuple space search costs a hash lookup per
+ * distinct mask, and the decision tree is the fallback for many masks.
+ */
+static enum table_classifier
+table_classifier_choose(struct table *table) {
+  static const int l4_types[] = {
+    OFPXMT_OFB_TCP_SRC, OFPXMT_OFB_TCP_DST,
+    OFPXMT_OFB_UDP_SRC, OFPXMT_OFB_UDP_DST,
+    OFPXMT_OFB_SCTP_SRC, OFPXMT_OFB_SCTP_DST,
+    OFPXMT_OFB_ICMPV4_TYPE, OFPXMT_OFB_ICMPV4_CODE,
+    OFPXMT_OFB_ICMPV6_TYPE, OFPXMT_OFB_ICMPV6_CODE
+  };
+  uint32_t nl4;
+  int nflow, nmask;
+  size_t i;
+
+  nflow = table->flow_list->nflow;
+  if (nflow < CLASSIFIER_AUTO_MIN_FLOWS) {
+    return TABLE_CLASSIFIER_FLOWINFO;
+  }
+  nmask = table_mask_count(table);
+  if (table_masked_count(table) * 8 < nflow && nflow >= nmask * 8) {
+    return TABLE_CLASSIFIER_EXACT;
+  }
+  nl4 = 0;
+  for (i = 0; i < sizeof(l4_types) / sizeof(l4_types[0]); i++) {
+    nl4 += table->flow_match_type_count[l4_types[i]];
+  }
+  if (nl4 * 2 < (uint32_t)nflow) {
+    return TABLE_CLASSIFIER_FLOWINFO;
+  }
+  if (nflow >= nmask * 8) {
+    return TABLE_CLASSIFIER_THTABLE;
+  }
+  return TABLE_CLASSIFIER_MBTREE;
+}
+
+/**
+ * Add flow to the classifier of the table.
+ */
+static void
+flow_classifier_add(struct flowdb *flowdb,
+                    struct flow *flow, struct table *table) {
+  flowdb_update_log(flowdb, FLOWDB_UPDATE_ADD, table, flow);
+  if (lagopus_add_flow_hook != NULL) {
+    lagopus_add_flow_hook(flow, table);
+  }
+  table_profile_update(table, flow, 1);
+}
+
+/**
+ * Remove flow from the classifier of the table.  Flow is freed when
+ * forwarding threads are no longer able to see it.
+ */
+static void
+flow_classifier_del(struct flowdb *flowdb,
+                    struct flow *flow, struct table *table) {
+  flowdb_update_log(flowdb, FLOWDB_UPDATE_DEL, table, flow);
+  if (lagopus_del_flow_hook != NULL) {
+    lagopus_del_flow_hook(flow, table);
+  }
+  table_profile_update(table, flow, -1);
+}
+
+/*
+ * pending updates are published before, then the old classifier is
+ * rebuilt from the same flows on publishing the new one.
+ */
+static lagopus_result_t
+table_classifier_switch(struct flowdb *flowdb, struct table *table,
+                        enum table_classifier classifier) {
+  if (table->classifier == classifier) {
+    return LAGOPUS_RESULT_OK;
+  }
+  flowdb_publish(flowdb);
+  table->classifier = classifier;
+  flowdb_update_log(flowdb, FLOWDB_UPDATE_REBUILD, table, NULL);
+  table_classifier_rebuild(table);
+  if (table->shadow == NULL && table->flow_list->nflow != 0) {
+    return LAGOPUS_RESULT_NO_MEMORY;
+  }
+  return LAGOPUS_RESULT_OK;
+}
+
+lagopus_result_t
+flowdb_table_classifier_set(struct flowdb *flowdb, uint8_t table_id,
+                            enum table_classifier classifier) {
+  struct table *table;
+  lagopus_result_t rv;
+
+  if (flowdb == NULL || classifier >= TABLE_CLASSIFIER_MAX) {
+    return LAGOPUS_RESULT_INVALID_ARGS;
+  }
+  flowdb_flowmod_lock(flowdb);
+  table = flowdb_get_table(flowdb, table_id);
+  if (table == NULL) {
+    rv = LAGOPUS_RESULT_NO_MEMORY;
+  } else if (classifier == TABLE_CLASSIFIER_AUTO) {
+    table->classifier_auto = true;
+    table->profile_pending = false;
+    rv = table_classifier_switch(flowdb, table,
+                                 table_classifier_choose(table));
+  } else {
+    table->classifier_auto = false;
+    rv = table_classifier_switch(flowdb, table, classifier);
+  }
+  flowdb_flowmod_unlock(flowdb);
+  return rv;
+}
+
+lagopus_result_t
+flowdb_table_classifier_get(struct flowdb *flowdb, uint8_t table_id,
+                            enum table_classifier *classifier,
+                            bool *is_auto) {
+  struct table *table;
+  lagopus_result_t rv;
+
+  if (flowdb == NULL || classifier == NULL || is_auto == NULL) {
+    return LAGOPUS_RESULT_INVALID_ARGS;
+  }
+  flowdb_flowmod_lock(flowdb);
+  table = table_lookup(flowdb, table_id);
+  if (table == NULL) {
+    rv = LAGOPUS_RESULT_NOT_FOUND;
+  } else {
+    *classifier = table->classifier;
+    *is_auto = table->classifier_auto;
+    rv = LAGOPUS_RESULT_OK;
+  }
+  flowdb_flowmod_unlock(flowdb);
+  return rv;
+}
+
+/*
+ * called by the classifier timer.  forwarding threads continue to
+ * lookup with the old classifier until the new one is published.
+ */
+void
+flowdb_classifier_update(struct flowdb *flowdb) {
+  struct table *table;
+  int i;
+
+  flowdb_flowmod_lock_nested(flowdb);
+  for (i = 0; i < flowdb->table_size; i++) {
+    table = flowdb->tables[i];
+    if (table != NULL && table->classifier_auto == true &&
+        table->profile_pending == true) {
+      table->profile_pending = false;
+      if (table_classifier_switch(flowdb, table,
+                                  table_classifier_choose(table)) !=
+          LAGOPUS_RESULT_OK) {
+        lagopus_msg_warning("table %d: classifier rebuild failed\n",
+                            table->table_id);
+      }
+    }
+  }
+  flowdb_flowmod_unlock_nested(flowdb);
 }
 
 /* Allocate flowdb. */
 struct flowdb *
 flowdb_alloc(uint8_t initial_table_size) {
   struct flowdb *flowdb;
+  struct timespec ts;
   size_t table_index_size;
   uint8_t i;
 
@@ -323,10 +830,20 @@ flowdb_alloc(uint8_t initial_table_size) {
   if (flowdb == NULL) {
     return NULL;
   }
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  dp_timer_wheel_init(&flowdb->timer_wheel, ts.tv_sec);
 
   /* Set default switch mode. */
   flowdb_switch_mode_set(flowdb, SWITCH_MODE_STANDALONE);
 
+  flowdb_lock_init(flowdb);
+  flowdb->update_log = calloc(FLOWDB_UPDATE_LOG_MAX,
+                              sizeof(struct flowdb_update));
+  if (flowdb->update_log == NULL) {
+    flowdb_free(flowdb);
+    return NULL;
+  }
+
   /* Allocate table index. */
   table_index_size = sizeof(struct table *) * (FLOWDB_TABLE_SIZE_MAX + 1);
   flowdb->tables = (struct table **)calloc(1, table_index_size);
@@ -354,6 +871,12 @@ void
 flowdb_free(struct flowdb *flowdb) {
   int i;
 
+  /* release flows removed in this write section. */
+  if (flowdb->update_log != NULL) {
+    flowdb_publish(flowdb);
+    free(flowdb->update_log);
+  }
+
   /* Free table index. */
   if (flowdb->tables != NULL) {
     for (i = 0; i < flowdb->table_size; i++) {
@@ -366,7 +889,11 @@ flowdb_free(struct flowdb *flowdb) {
     flowdb->tables = NULL;
   }
 
+  /* Free timers after flows referring them. */
+  dp_timer_wheel_fini(&flowdb->timer_wheel);
+
   /* Free flowdb. */
+  FLOWDB_LOCK_DESTROY(flowdb);
   free(flowdb);
 }
 
@@ -720,9 +1247,9 @@ flow_remove_with_reason(struct flow *flow,
 
   (void) error;
 
-  flowdb_wrlock(NULL);
+  flowdb_flowmod_lock(bridge->flowdb);
   ret = flow_remove_with_reason_nolock(flow, bridge, reason, error);
-  flowdb_wrunlock(NULL);
+  flowdb_flowmod_unlock(bridge->flowdb);
 
   return ret;
 }
@@ -743,12 +1270,6 @@ flow_remove_with_reason_nolock(struct flow *flow,
 
   ret = LAGOPUS_RESULT_OK;
 
-  /* Clear flow cache */
-#ifdef HAVE_DPDK
-  clear_worker_flowcache(false);
-#endif /* HAVE_DPDK */
-  clear_rawsock_flowcache();
-
   group_table = bridge->group_table;
   meter_table = bridge->meter_table;
   table = flowdb_get_table(bridge->flowdb, flow->table_id);
@@ -757,16 +1278,13 @@ flow_remove_with_reason_nolock(struct flow *flow,
   for (i = 0; i < flow_list->nflow; i++) {
     if (flow == flow_list->flows[i]) {
       /* call flowinfo cleanup. */
-      if (lagopus_del_flow_hook != NULL) {
-        lagopus_del_flow_hook(flow, table);
-      }
+      flow_classifier_del(bridge->flowdb, flow, table);
       flow_del_from_group(group_table, flow);
       flow_del_from_meter(meter_table, flow);
       if ((flow->flags & OFPFF_SEND_FLOW_REM) != 0) {
         /* send OFPT_FLOW_REMOVED message */
         ret = send_flow_removed(bridge->dpid, flow, reason);
       }
-      flow_free(flow);
       flow_list->nflow--;
       if (i < flow_list->nflow) {
         memmove(&flow_list->flows[i], &flow_list->flows[i + 1],
@@ -780,6 +1298,70 @@ out:
   return ret;
 }
 
+static int
+flow_expire_cmp(const void *a, const void *b) {
+  const struct flow_expire *e1 = a, *e2 = b;
+
+  if (e1->flow->table_id != e2->flow->table_id) {
+    return (int)e1->flow->table_id - (int)e2->flow->table_id;
+  }
+  if (e1->flow != e2->flow) {
+    return ((uintptr_t)e1->flow < (uintptr_t)e2->flow) ? -1 : 1;
+  }
+  return 0;
+}
+
+static bool
+flow_expire_find(struct flow_expire *expired, size_t n, struct flow *flow) {
+  struct flow_expire key;
+
+  key.flow = flow;
+  return bsearch(&key, expired, n, sizeof(*expired), flow_expire_cmp) != NULL;
+}
+
+size_t
+flow_remove_expired_nolock(struct bridge *bridge,
+                           struct flow_expire *expired,
+                           size_t nexpired,
+                           struct eventq_data **msgs) {
+  struct flowdb *flowdb;
+  struct flow_list *flow_list;
+  struct table *table;
+  struct flow *flow;
+  size_t i, first, nmsgs;
+  int j, k;
+
+  flowdb = bridge->flowdb;
+  nmsgs = 0;
+  qsort(expired, nexpired, sizeof(*expired), flow_expire_cmp);
+  for (first = 0; first < nexpired; first = i) {
+    table = table_lookup(flowdb, expired[first].flow->table_id);
+    for (i = first; i < nexpired &&
+         expired[i].flow->table_id == expired[first].flow->table_id; i++) {
+      flow = expired[i].flow;
+      flow_classifier_del(flowdb, flow, table);
+      flow_del_from_group(bridge->group_table, flow);
+      flow_del_from_meter(bridge->meter_table, flow);
+      if ((flow->flags & OFPFF_SEND_FLOW_REM) != 0) {
+        msgs[nmsgs] = flow_removed_alloc(flow, expired[i].reason);
+        if (msgs[nmsgs] != NULL) {
+          nmsgs++;
+        }
+      }
+    }
+    /* compact the flow list of the table at once. */
+    flow_list = table->flow_list;
+    for (j = 0, k = 0; j < flow_list->nflow; j++) {
+      flow = flow_list->flows[j];
+      if (flow_expire_find(&expired[first], i - first, flow) == false) {
+        flow_list->flows[k++] = flow;
+      }
+    }
+    flow_list->nflow = k;
+  }
+  return nmsgs;
+}
+
 /**
  * true if ml1 has all ml2 matches.
  */
@@ -930,14 +1512,15 @@ flow_action_examination(struct flow *flow,
 
 /* Examine apply-action for dataplane. */
 static void
-flow_instruction_examination(struct flow *flow) {
+flow_instruction_examination(struct flow *flow,
+                             struct instruction **instructions) {
   struct instruction *instruction;
   struct action *action, *output;
   int i;
 
   output = NULL;
   for (i = 0; i < INSTRUCTION_INDEX_MAX; i++) {
-    instruction = flow->instruction[i];
+    instruction = instructions[i];
     if (instruction == NULL) {
       continue;
     }
@@ -961,6 +1544,44 @@ flow_instruction_examination(struct flow *flow) {
   }
 }
 
+/**
+ * Replace instructions of the flow registered in the table.
+ * Forwarding threads may be executing old instructions, so they are
+ * freed at publish.  instruction_list is moved to the flow.
+ */
+static lagopus_result_t
+flow_replace_instructions(struct flowdb *flowdb,
+                          struct flow *flow,
+                          struct instruction_list *instruction_list,
+                          struct ofp_error *error) {
+  struct instruction *instruction[INSTRUCTION_INDEX_MAX];
+  struct instruction_list *old_list;
+  lagopus_result_t ret;
+  int i;
+
+  ret = map_instruction_list_to_array(instruction, instruction_list, error);
+  if (ret != LAGOPUS_RESULT_OK) {
+    return ret;
+  }
+  old_list = malloc(sizeof(struct instruction_list));
+  if (old_list == NULL) {
+    return LAGOPUS_RESULT_NO_MEMORY;
+  }
+  /* Examine apply-action for dataplane. */
+  flow_instruction_examination(flow, instruction);
+  mbar();
+  TAILQ_INIT(old_list);
+  TAILQ_CONCAT(old_list, &flow->instruction_list, entry);
+  TAILQ_CONCAT(&flow->instruction_list, instruction_list, entry);
+  for (i = 0; i < INSTRUCTION_INDEX_MAX; i++) {
+    flow->instruction[i] = instruction[i];
+  }
+  flowdb_update_log(flowdb, FLOWDB_UPDATE_FREE_INSTRUCTIONS,
+                    table_lookup(flowdb, flow->table_id), old_list);
+
+  return LAGOPUS_RESULT_OK;
+}
+
 lagopus_result_t
 flow_add_sub(struct flow *flow, struct flow_list *flows) {
   lagopus_result_t ret;
@@ -1028,7 +1649,7 @@ flowdb_flow_add(struct bridge *bridge,
   flowdb = bridge->flowdb;
 
   /* Write lock the flowdb. */
-  flowdb_wrlock(flowdb);
+  flowdb_flowmod_lock(flowdb);
 
   /* Get table. */
   table = flowdb_get_table(flowdb, flow_mod->table_id);
@@ -1087,27 +1708,16 @@ flowdb_flow_add(struct bridge *bridge,
       flow_free(flow);
       goto out;
     }
-    /* Examine apply-action for dataplane. */
-    flow_instruction_examination(flow);
-    /* overriden. */
+    /* overriden.  match is identical, only instructions are replaced. */
     flow_del_from_meter(bridge->meter_table, identical_flow);
     flow_del_from_group(bridge->group_table, identical_flow);
     if ((flow_mod->flags & OFPFF_RESET_COUNTS) != 0) {
-      identical_flow->packet_count = 0;
-      identical_flow->byte_count = 0;
-    }
-    match_list_entry_free(&identical_flow->match_list);
-    instruction_list_entry_free(&identical_flow->instruction_list);
-    TAILQ_CONCAT(&identical_flow->match_list,
-                 &flow->match_list,
-                 entry);
-    TAILQ_CONCAT(&identical_flow->instruction_list,
-                 &flow->instruction_list,
-                 entry);
+      dp_counter_reset(identical_flow->counter_id);
+    }
+    ret = flow_replace_instructions(flowdb, identical_flow,
+                                    &flow->instruction_list,
+                                    error);
     flow_free(flow);
-    ret = map_instruction_list_to_array(identical_flow->instruction,
-                                        &identical_flow->instruction_list,
-                                        error);
     if (ret != LAGOPUS_RESULT_OK) {
       goto out;
     }
@@ -1122,40 +1732,32 @@ flowdb_flow_add(struct bridge *bridge,
       goto out;
     }
     /* Examine apply-action for dataplane. */
-    flow_instruction_examination(flow);
-    ret = flow_add_sub(flow, table->flow_list);
-    if (ret != LAGOPUS_RESULT_OK) {
-      goto out;
-    }
-    if (lagopus_add_flow_hook != NULL) {
-      lagopus_add_flow_hook(flow, table);
-    }
+    flow_instruction_examination(flow, flow->instruction);
+    /* Arm the timer first, a flow without its timer is never expired. */
     if (flow->idle_timeout > 0 || flow->hard_timeout > 0) {
-      add_flow_timer(flow);
-    }
-#ifdef USE_MBTREE
-    if (table->flow_list->update_timer != NULL) {
-      *table->flow_list->update_timer = NULL;
+      ret = add_flow_timer(flow);
+      if (ret != LAGOPUS_RESULT_OK) {
+        lagopus_msg_warning("flow add: timer allocation failed.\n");
+        goto cleanup;
+      }
     }
-    add_mbtree_timer(table->flow_list, UPDATE_TIMEOUT);
-#endif /* USE_MBTREE */
-#ifdef USE_THTABLE
-    if (table->flow_list->update_timer != NULL) {
-      *table->flow_list->update_timer = NULL;
+    flow->seq = ++table->flow_seq;
+    ret = flow_add_sub(flow, table->flow_list);
+    if (ret != LAGOPUS_RESULT_OK) {
+      goto cleanup;
     }
-    add_thtable_timer(table->flow_list, UPDATE_TIMEOUT);
-#endif /* USE_MBTREE */
+    flow_classifier_add(flowdb, flow, table);
   }
+  goto out;
 
-  /* Clear flow cache */
-#ifdef HAVE_DPDK
-  clear_worker_flowcache(false);
-#endif /* HAVE_DPDK */
-  clear_rawsock_flowcache();
+cleanup:
+  flow_del_from_meter(bridge->meter_table, flow);
+  flow_del_from_group(bridge->group_table, flow);
+  flow_free(flow);
 
 out:
   /* Unlock the flowdb then return result. */
-  flowdb_wrunlock(flowdb);
+  flowdb_flowmod_unlock(flowdb);
   return ret;
 }
 
@@ -1167,6 +1769,7 @@ flow_modify_sub(struct bridge *bridge,
                 struct instruction_list *instruction_list,
                 struct ofp_error *error,
                 int strict) {
+  struct instruction_list new_list;
   struct flow *flow;
   lagopus_result_t ret;
   int i;
@@ -1187,7 +1790,6 @@ flow_modify_sub(struct bridge *bridge,
     flow_free(flow);
     goto out;
   }
-  flow_instruction_examination(flow);
   if (strict) {
     /*
      * strict. modify identical flow specified by flow_mod.
@@ -1197,23 +1799,24 @@ flow_modify_sub(struct bridge *bridge,
         flow_del_from_meter(bridge->meter_table, flow_list->flows[i]);
         flow_del_from_group(bridge->group_table, flow_list->flows[i]);
         if ((flow_mod->flags & OFPFF_RESET_COUNTS) != 0) {
-          flow_list->flows[i]->packet_count = 0;
-          flow_list->flows[i]->byte_count = 0;
+          dp_counter_reset(flow_list->flows[i]->counter_id);
+        }
+        TAILQ_INIT(&new_list);
+        ret = copy_instruction_list(&new_list, &flow->instruction_list);
+        if (ret == LAGOPUS_RESULT_OK) {
+          ret = flow_replace_instructions(bridge->flowdb, flow_list->flows[i],
+                                          &new_list, error);
         }
-        instruction_list_entry_free(&flow_list->flows[i]->instruction_list);
-        copy_instruction_list(&flow_list->flows[i]->instruction_list,
-                              &flow->instruction_list);
-        map_instruction_list_to_array(flow_list->flows[i]->instruction,
-                                      &flow_list->flows[i]->instruction_list,
-                                      error);
         if (ret != LAGOPUS_RESULT_OK) {
+          instruction_list_entry_free(&new_list);
+          flow_free(flow);
           goto out;
         }
-        ret = flow_action_check(bridge, flow, error);
+        ret = flow_action_check(bridge, flow_list->flows[i], error);
         if (ret != LAGOPUS_RESULT_OK) {
+          flow_free(flow);
           goto out;
         }
-        flow_instruction_examination(flow);
         break;
       }
     }
@@ -1240,26 +1843,22 @@ flow_modify_sub(struct bridge *bridge,
         flow_del_from_meter(bridge->meter_table, flow);
         flow_del_from_group(bridge->group_table, flow);
         if ((flow_mod->flags & OFPFF_RESET_COUNTS) != 0) {
-          flow->packet_count = 0;
-          flow->byte_count = 0;
+          dp_counter_reset(flow->counter_id);
         }
-        instruction_list_entry_free(&flow->instruction_list);
-        ret = copy_instruction_list(&flow->instruction_list,
-                                    instruction_list);
-        if (ret != LAGOPUS_RESULT_OK) {
-          break;
+        TAILQ_INIT(&new_list);
+        ret = copy_instruction_list(&new_list, instruction_list);
+        if (ret == LAGOPUS_RESULT_OK) {
+          ret = flow_replace_instructions(bridge->flowdb, flow, &new_list,
+                                          error);
         }
-        ret = map_instruction_list_to_array(flow->instruction,
-                                            &flow->instruction_list,
-                                            error);
         if (ret != LAGOPUS_RESULT_OK) {
+          instruction_list_entry_free(&new_list);
           break;
         }
         ret = flow_action_check(bridge, flow, error);
         if (ret != LAGOPUS_RESULT_OK) {
           goto out;
         }
-        flow_instruction_examination(flow);
       }
     }
     instruction_list_entry_free(instruction_list);
@@ -1330,23 +1929,21 @@ flow_removed_free(struct eventq_data *data) {
   }
 }
 
-static lagopus_result_t
-send_flow_removed(uint64_t dpid,
-                  struct flow *flow,
-                  uint8_t reason) {
+/**
+ * Make OFPT_FLOW_REMOVED message of the flow.  Match list is moved
+ * to the message.
+ */
+static struct eventq_data *
+flow_removed_alloc(struct flow *flow, uint8_t reason) {
   struct timespec ts;
   struct flow_removed *flow_removed;
   struct eventq_data *eventq_data;
-  lagopus_result_t rv;
 
   eventq_data = malloc(sizeof(*eventq_data));
   if (eventq_data == NULL) {
-    return LAGOPUS_RESULT_NO_MEMORY;
+    return NULL;
   }
   flow_removed = &eventq_data->flow_removed;
-  if (flow_removed == NULL) {
-    return LAGOPUS_RESULT_NO_MEMORY;
-  }
   /*flow_removed->ofp_flow_removed.header;*/
   flow_removed->ofp_flow_removed.cookie = flow->cookie;
   flow_removed->ofp_flow_removed.priority = (uint16_t)flow->priority;
@@ -1368,20 +1965,32 @@ send_flow_removed(uint64_t dpid,
 
   flow_removed->ofp_flow_removed.idle_timeout = flow->idle_timeout;
   flow_removed->ofp_flow_removed.hard_timeout = flow->hard_timeout;
-  if ((flow->flags & OFPFF_NO_PKT_COUNTS) == 0) {
-    flow_removed->ofp_flow_removed.packet_count = flow->packet_count;
-  } else {
+  flow_counter_get(flow, &flow_removed->ofp_flow_removed.packet_count,
+                   &flow_removed->ofp_flow_removed.byte_count);
+  if ((flow->flags & OFPFF_NO_PKT_COUNTS) != 0) {
     flow_removed->ofp_flow_removed.packet_count = 0xffffffffffffffff;
   }
-  if ((flow->flags & OFPFF_NO_BYT_COUNTS) == 0) {
-    flow_removed->ofp_flow_removed.byte_count = flow->byte_count;
-  } else {
+  if ((flow->flags & OFPFF_NO_BYT_COUNTS) != 0) {
     flow_removed->ofp_flow_removed.byte_count = 0xffffffffffffffff;
   }
   TAILQ_INIT(&flow_removed->match_list);
   TAILQ_CONCAT(&flow_removed->match_list, &flow->match_list, entry);
   eventq_data->type = LAGOPUS_EVENTQ_FLOW_REMOVED;
   eventq_data->free = flow_removed_free;
+  return eventq_data;
+}
+
+static lagopus_result_t
+send_flow_removed(uint64_t dpid,
+                  struct flow *flow,
+                  uint8_t reason) {
+  struct eventq_data *eventq_data;
+  lagopus_result_t rv;
+
+  eventq_data = flow_removed_alloc(flow, reason);
+  if (eventq_data == NULL) {
+    return LAGOPUS_RESULT_NO_MEMORY;
+  }
   rv = dp_eventq_data_put(dpid, &eventq_data, PUT_TIMEOUT);
   if (rv != LAGOPUS_RESULT_OK) {
     lagopus_perror(rv);
@@ -1389,6 +1998,22 @@ send_flow_removed(uint64_t dpid,
   return rv;
 }
 
+void
+send_flow_removed_n(uint64_t dpid, struct eventq_data **msgs, size_t n) {
+  lagopus_result_t rv;
+  size_t nput;
+
+  nput = 0;
+  rv = dp_eventq_data_put_n(dpid, msgs, n, &nput, PUT_TIMEOUT);
+  if (rv != LAGOPUS_RESULT_OK) {
+    lagopus_perror(rv);
+  }
+  /* messages not queued are dropped. */
+  for (; nput < n; nput++) {
+    flow_removed_free(msgs[nput]);
+  }
+}
+
 static bool
 find_action_output(struct flow *flow, uint32_t out_port) {
   int i;
@@ -1485,16 +2110,13 @@ flow_del_sub(struct bridge *bridge,
     }
     for (i = 0; i < flow_list->nflow; i++) {
       if (flow_compare(flow, flow_list->flows[i]) == true) {
-        if (lagopus_del_flow_hook != NULL) {
-          lagopus_del_flow_hook(flow_list->flows[i], table);
-        }
+        flow_classifier_del(bridge->flowdb, flow_list->flows[i], table);
         flow_del_from_group(group_table, flow_list->flows[i]);
         flow_del_from_meter(meter_table, flow_list->flows[i]);
         if ((flow_list->flows[i]->flags & OFPFF_SEND_FLOW_REM) != 0) {
           /* send OFPT_FLOW_REMOVED message */
           ret = send_flow_removed(bridge->dpid, flow, OFPRR_DELETE);
         }
-        flow_free(flow_list->flows[i]);
         flow_list->nflow--;
         if (i < flow_list->nflow) {
           memmove(&flow_list->flows[i], &flow_list->flows[i + 1],
@@ -1505,18 +2127,6 @@ flow_del_sub(struct bridge *bridge,
       }
     }
     flow_free(flow);
-#ifdef USE_MBTREE
-    if (flow_list->update_timer != NULL) {
-      *flow_list->update_timer = NULL;
-    }
-    add_mbtree_timer(flow_list, UPDATE_TIMEOUT);
-#endif /* USE_MBTREE */
-#ifdef USE_THTABLE
-    if (flow_list->update_timer != NULL) {
-      *flow_list->update_timer = NULL;
-    }
-    add_thtable_timer(flow_list, UPDATE_TIMEOUT);
-#endif /* USE_THTABLEE */
   } else {
     /*
      * not strict. delete all flows if matched by match_list and cookie.
@@ -1543,9 +2153,7 @@ flow_del_sub(struct bridge *bridge,
       }
       /* filtering by output port and group are not supported yet */
       if (match_compare(&flow->match_list, match_list) == true) {
-        if (lagopus_del_flow_hook != NULL) {
-          lagopus_del_flow_hook(flow, table);
-        }
+        flow_classifier_del(bridge->flowdb, flow, table);
         flow_del_from_group(group_table, flow);
         flow_del_from_meter(meter_table, flow);
         if ((flow->flags & OFPFF_SEND_FLOW_REM) != 0) {
@@ -1553,19 +2161,6 @@ flow_del_sub(struct bridge *bridge,
           ret = send_flow_removed(bridge->dpid, flow, OFPRR_DELETE);
         }
         flow_list->flows[i] = NULL;
-        flow_free(flow);
-#ifdef USE_MBTREE
-        if (flow_list->update_timer != NULL) {
-          *flow_list->update_timer = NULL;
-        }
-        add_mbtree_timer(flow_list, UPDATE_TIMEOUT);
-#endif /* USE_MBTREE */
-#ifdef USE_THTABLE
-        if (flow_list->update_timer != NULL) {
-          *flow_list->update_timer = NULL;
-        }
-        add_thtable_timer(flow_list, UPDATE_TIMEOUT);
-#endif /* USE_THTABLE */
       }
     }
     /* compaction. */
@@ -1654,7 +2249,7 @@ flowdb_flow_modify(struct bridge *bridge,
   }
 
   /* Write lock the flowdb. */
-  flowdb_wrlock(bridge->flowdb);
+  flowdb_flowmod_lock(bridge->flowdb);
 
   /* Get table. */
   table = flowdb_get_table(bridge->flowdb, flow_mod->table_id);
@@ -1672,15 +2267,9 @@ flowdb_flow_modify(struct bridge *bridge,
                              match_list, instruction_list,
                              error, strict);
 
-  /* Clear flow cache */
-#ifdef HAVE_DPDK
-  clear_worker_flowcache(false);
-#endif /* HAVE_DPDK */
-  clear_rawsock_flowcache();
-
   /* Unlock the flowdb and return result. */
 out:
-  flowdb_wrunlock(bridge->flowdb);
+  flowdb_flowmod_unlock(bridge->flowdb);
   return result;
 }
 
@@ -1712,7 +2301,7 @@ flowdb_flow_delete(struct bridge *bridge,
   flowdb = bridge->flowdb;
 
   /* Write lock the flowdb. */
-  flowdb_wrlock(flowdb);
+  flowdb_flowmod_lock(flowdb);
 
   /* OFPTT_ALL means targeting all tables. */
   if (flow_mod->table_id == OFPTT_ALL) {
@@ -1741,25 +2330,64 @@ flowdb_flow_delete(struct bridge *bridge,
                       strict, error);
   }
 
-  /* Clear flow cache */
-#ifdef HAVE_DPDK
-  clear_worker_flowcache(false);
-#endif /* HAVE_DPDK */
-  clear_rawsock_flowcache();
-
   /* Unlock the flowdb and return result. */
 out:
-  flowdb_wrunlock(flowdb);
+  flowdb_flowmod_unlock(flowdb);
   return result;
 }
 
+static void
+flow_stats_set(struct ofp_flow_stats *ofp, const struct flow *flow,
+               int table_id) {
+  struct timespec ts;
+
+  ofp->table_id = (uint8_t)table_id;
+#define COPY_STATS(member) ofp->member = flow->member
+  COPY_STATS(idle_timeout);
+  COPY_STATS(hard_timeout);
+  ofp->priority = (uint16_t)flow->priority;
+  COPY_STATS(flags);
+  COPY_STATS(cookie);
+#undef COPY_STATS
+  flow_counter_get(flow, &ofp->packet_count, &ofp->byte_count);
+  if ((flow->flags & OFPFF_NO_PKT_COUNTS) != 0) {
+    ofp->packet_count =  0xffffffffffffffff;
+  }
+  if ((flow->flags & OFPFF_NO_BYT_COUNTS) != 0) {
+    ofp->byte_count = 0xffffffffffffffff;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  ofp->duration_sec = (uint32_t)(ts.tv_sec - flow->create_time.tv_sec);
+  if (ts.tv_nsec < flow->create_time.tv_nsec) {
+    ofp->duration_sec--;
+    ofp->duration_nsec = 1 * 1000 * 1000 * 1000;
+  } else {
+    ofp->duration_nsec = 0;
+  }
+  ofp->duration_nsec += (uint32_t)ts.tv_nsec;
+  ofp->duration_nsec -= (uint32_t)flow->create_time.tv_nsec;
+}
+
+static inline bool
+flow_stats_match(struct flow *flow,
+                 struct ofp_flow_stats_request *request,
+                 struct match_list *match_list) {
+  if (request->cookie_mask != 0) {
+    if ((flow->cookie & request->cookie_mask) !=
+        (request->cookie & request->cookie_mask)) {
+      return false;
+    }
+  }
+  return match_compare(&flow->match_list, match_list);
+}
+
 static lagopus_result_t
 table_flow_stats(struct table *table,
                  int table_id,
                  struct ofp_flow_stats_request *request,
                  struct match_list *match_list,
                  struct flow_stats_list *flow_stats_list) {
-  struct timespec ts;
   struct flow_stats *flow_stats;
   struct flow_list *flow_list;
   struct flow *flow;
@@ -1771,48 +2399,13 @@ table_flow_stats(struct table *table,
   flow_list = table->flow_list;
   for (i = 0; i < flow_list->nflow; i++) {
     flow = flow_list->flows[i];
-    if (request->cookie_mask != 0) {
-      if ((flow->cookie & request->cookie_mask) !=
-          (request->cookie & request->cookie_mask)) {
-        continue;
-      }
-    }
-    if (match_compare(&flow->match_list, match_list) == true) {
+    if (flow_stats_match(flow, request, match_list) == true) {
       /* make flow stats. */
       flow_stats = calloc(1, sizeof(struct flow_stats));
       if (flow_stats == NULL) {
         goto out;
       }
-      flow_stats->ofp.table_id = (uint8_t)table_id;
-#define COPY_STATS(member) flow_stats->ofp.member = flow->member
-      COPY_STATS(idle_timeout);
-      COPY_STATS(hard_timeout);
-      flow_stats->ofp.priority = (uint16_t)flow->priority;
-      COPY_STATS(flags);
-      COPY_STATS(cookie);
-      if ((flow->flags & OFPFF_NO_PKT_COUNTS) == 0) {
-        COPY_STATS(packet_count);
-      } else {
-        flow_stats->ofp.packet_count =  0xffffffffffffffff;
-      }
-      if ((flow->flags & OFPFF_NO_BYT_COUNTS) == 0) {
-        COPY_STATS(byte_count);
-      } else {
-        flow_stats->ofp.byte_count = 0xffffffffffffffff;
-      }
-#undef COPY_STATS
-
-      clock_gettime(CLOCK_MONOTONIC, &ts);
-      flow_stats->ofp.duration_sec =
-        (uint32_t)(ts.tv_sec - flow->create_time.tv_sec);
-      if (ts.tv_nsec < flow->create_time.tv_nsec) {
-        flow_stats->ofp.duration_sec--;
-        flow_stats->ofp.duration_nsec = 1 * 1000 * 1000 * 1000;
-      } else {
-        flow_stats->ofp.duration_nsec = 0;
-      }
-      flow_stats->ofp.duration_nsec += (uint32_t)ts.tv_nsec;
-      flow_stats->ofp.duration_nsec -= (uint32_t)flow->create_time.tv_nsec;
+      flow_stats_set(&flow_stats->ofp, flow, table_id);
 
       /* copy lists. */
       TAILQ_INIT(&flow_stats->match_list);
@@ -1829,6 +2422,135 @@ out:
   return rv;
 }
 
+/*
+ * Index of the first flow after the cursor.  Flows are sorted by
+ * descending priority, and by insertion order within a priority.
+ */
+static int
+flow_stats_cursor_index(struct flow_list *flow_list,
+                        const struct flow_stats_cursor *cursor) {
+  struct flow *flow;
+  int st, ed, off;
+
+  st = 0;
+  ed = flow_list->nflow;
+  while (st < ed) {
+    off = st + (ed - st) / 2;
+    flow = flow_list->flows[off];
+    if (flow->priority > cursor->priority ||
+        (flow->priority == cursor->priority && flow->seq <= cursor->seq)) {
+      st = off + 1;
+    } else {
+      ed = off;
+    }
+  }
+  return st;
+}
+
+static lagopus_result_t
+table_flow_stats_walk(struct table *table,
+                      struct ofp_flow_stats_request *request,
+                      struct match_list *match_list,
+                      struct flow_stats_cursor *cursor,
+                      flow_stats_proc_t proc, void *arg,
+                      int *budget) {
+  struct ofp_flow_stats ofp;
+  struct flow_list *flow_list;
+  struct flow *flow;
+  lagopus_result_t rv;
+  int i;
+
+  flow_list = table->flow_list;
+  i = 0;
+  if (cursor->resume == true) {
+    i = flow_stats_cursor_index(flow_list, cursor);
+  }
+  for (; i < flow_list->nflow; i++) {
+    if (*budget <= 0) {
+      return LAGOPUS_RESULT_OUT_OF_RANGE;
+    }
+    (*budget)--;
+    flow = flow_list->flows[i];
+    if (flow_stats_match(flow, request, match_list) == true) {
+      flow_stats_set(&ofp, flow, cursor->table_id);
+      rv = proc(arg, &ofp, &flow->match_list, &flow->instruction_list);
+      if (rv != LAGOPUS_RESULT_OK) {
+        return rv;
+      }
+    }
+    cursor->resume = true;
+    cursor->priority = flow->priority;
+    cursor->seq = flow->seq;
+  }
+  return LAGOPUS_RESULT_OK;
+}
+
+/*
+ * Walk flows from the cursor under read lock, at most
+ * FLOW_STATS_WALK_MAX flows per call so that flow_mod is not blocked
+ * by a large table.
+ */
+static lagopus_result_t
+flowdb_flow_stats_walk(struct flowdb *flowdb,
+                       struct ofp_flow_stats_request *request,
+                       struct match_list *match_list,
+                       struct flow_stats_cursor *cursor,
+                       flow_stats_proc_t proc, void *arg,
+                       struct ofp_error *error) {
+  struct table *table;
+  int first, last, budget;
+  lagopus_result_t rv;
+
+  if (cursor->done == true) {
+    return LAGOPUS_RESULT_OK;
+  }
+  if (request->table_id == OFPTT_ALL) {
+    first = 0;
+    last = flowdb->table_size - 1;
+  } else {
+    if (request->table_id >= flowdb->table_size) {
+      error->type = OFPET_BAD_REQUEST;
+      error->code = OFPBRC_BAD_TABLE_ID;
+      lagopus_msg_info("flow stats: %d: table not found (%d:%d)",
+                       request->table_id, error->type, error->code);
+      return LAGOPUS_RESULT_OFP_ERROR;
+    }
+    first = last = request->table_id;
+  }
+  if (cursor->table_id < first) {
+    cursor->table_id = first;
+    cursor->resume = false;
+  }
+
+  rv = LAGOPUS_RESULT_OK;
+  budget = FLOW_STATS_WALK_MAX;
+
+  /* Read lock the flowdb. */
+  flowdb_rdlock(flowdb);
+
+  while (cursor->table_id <= last) {
+    table = table_lookup(flowdb, (uint8_t)cursor->table_id);
+    if (table != NULL) {
+      rv = table_flow_stats_walk(table, request, match_list, cursor,
+                                 proc, arg, &budget);
+      if (rv != LAGOPUS_RESULT_OK) {
+        break;
+      }
+    }
+    cursor->table_id++;
+    cursor->resume = false;
+  }
+
+  flowdb_rdunlock(flowdb);
+
+  if (rv == LAGOPUS_RESULT_OK) {
+    cursor->done = true;
+  } else if (rv == LAGOPUS_RESULT_OUT_OF_RANGE) {
+    rv = LAGOPUS_RESULT_OK;
+  }
+  return rv;
+}
+
 lagopus_result_t
 flowdb_flow_stats(struct flowdb *flowdb,
                   struct ofp_flow_stats_request *request,
@@ -1841,7 +2563,7 @@ flowdb_flow_stats(struct flowdb *flowdb,
   rv = LAGOPUS_RESULT_OK;
 
   /* Write lock the flowdb. */
-  flowdb_wrlock(flowdb);
+  flowdb_flowmod_lock(flowdb);
 
   if (request->table_id == OFPTT_ALL) {
     int i;
@@ -1872,7 +2594,7 @@ flowdb_flow_stats(struct flowdb *flowdb,
 
   /* Unlock the flowdb and return result. */
 out:
-  flowdb_wrunlock(flowdb);
+  flowdb_flowmod_unlock(flowdb);
   return rv;
 }
 
@@ -1884,6 +2606,7 @@ table_flow_counts(struct table *table,
 
   struct flow_list *flow_list;
   struct flow *flow;
+  uint64_t packets, bytes;
   int i;
 
   flow_list = table->flow_list;
@@ -1896,12 +2619,12 @@ table_flow_counts(struct table *table,
       }
     }
     if (match_compare(&flow->match_list, match_list) == true) {
-
+      flow_counter_get(flow, &packets, &bytes);
       if ((flow->flags & OFPFF_NO_PKT_COUNTS) == 0) {
-        reply->packet_count += flow->packet_count;
+        reply->packet_count += packets;
       }
       if ((flow->flags & OFPFF_NO_BYT_COUNTS) == 0) {
-        reply->byte_count += flow->byte_count;
+        reply->byte_count += bytes;
       }
       reply->flow_count++;
     }
@@ -1920,7 +2643,7 @@ flowdb_aggregate_stats(struct flowdb *flowdb,
   result = LAGOPUS_RESULT_OK;
 
   /* Write lock the flowdb. */
-  flowdb_wrlock(flowdb);
+  flowdb_flowmod_lock(flowdb);
 
   reply->packet_count = 0;
   reply->byte_count = 0;
@@ -1950,7 +2673,7 @@ flowdb_aggregate_stats(struct flowdb *flowdb,
 
   /* Unlock the flowdb and return result. */
 out:
-  flowdb_wrunlock(flowdb);
+  flowdb_flowmod_unlock(flowdb);
   return result;
 }
 
@@ -1976,13 +2699,33 @@ flowdb_table_stats(struct flowdb *flowdb,
     }
     stats->ofp.table_id = (uint8_t)table_id;
     stats->ofp.active_count = (uint32_t)table->flow_list->nflow;
-    stats->ofp.lookup_count = table->lookup_count;
-    stats->ofp.matched_count = table->matched_count;
+    table_counter_get(table, &stats->ofp.lookup_count,
+                      &stats->ofp.matched_count);
     TAILQ_INSERT_TAIL(list, stats, entry);
   }
   return LAGOPUS_RESULT_OK;
 }
 
+void
+flow_counter_get(const struct flow *flow, uint64_t *packets, uint64_t *bytes) {
+  struct dp_counter counter;
+
+  dp_counter_get(flow->counter_id, &counter);
+  *packets = counter.packets;
+  *bytes = counter.bytes;
+}
+
+void
+table_counter_get(const struct table *table,
+                  uint64_t *lookup, uint64_t *matched) {
+  struct dp_counter counter;
+
+  dp_counter_get(table->lookup_counter_id, &counter);
+  *lookup = counter.packets;
+  dp_counter_get(table->matched_counter_id, &counter);
+  *matched = counter.packets;
+}
+
 static struct table_property *
 alloc_table_prop(uint16_t type) {
   struct table_property *prop;
@@ -2893,6 +3636,24 @@ ofp_flow_stats_get(uint64_t dpid,
                            flow_stats_list, error);
 }
 
+lagopus_result_t
+ofp_flow_stats_walk(uint64_t dpid,
+                    struct ofp_flow_stats_request *flow_stats_request,
+                    struct match_list *match_list,
+                    struct flow_stats_cursor *cursor,
+                    flow_stats_proc_t proc, void *arg,
+                    struct ofp_error *error) {
+  struct bridge *bridge;
+
+  bridge = dp_bridge_lookup_by_dpid(dpid);
+  if (bridge == NULL) {
+    return LAGOPUS_RESULT_NOT_FOUND;
+  }
+
+  return flowdb_flow_stats_walk(bridge->flowdb, flow_stats_request,
+                                match_list, cursor, proc, arg, error);
+}
+
 /*
  * table_stats (Agent/DP API)
  */
@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "openflow.h"
 #include "lagopus_apis.h"
@@ -36,9 +37,34 @@
 #include "lagopus_error.h"
 
 #include "lock.h"
+#include "counter.h"
 
 #define GROUP_ID_KEY_LEN   32
 
+/* slots of select lookup table per bucket. */
+#define GROUP_SELECT_SLOTS_PER_BUCKET   100
+/* owner of unassigned slot. */
+#define GROUP_SELECT_NONE               0xffff
+#define GROUP_SELECT_MAX_BUCKETS        GROUP_SELECT_NONE
+
+/* table sizes, prime for the permutation to visit all slots. */
+static const uint32_t group_select_sizes[] = {
+  251, 509, 1021, 2039, 4093, 8191, 16381, 32749, 65521
+};
+
+/**
+ * Slot preference of bucket, and assignment state.
+ */
+struct group_select_perm {
+  uint32_t offset;              /** First preferred slot. */
+  uint32_t skip;                /** Distance to the next preferred slot. */
+  uint32_t next;                /** Number of preferred slots visited. */
+  uint32_t count;               /** Number of assigned slots. */
+  uint32_t target;              /** Number of slots by weight. */
+};
+
+volatile uint32_t group_liveness_gen = 1;
+
 static struct bucket *
 bucket_alloc(void) {
   struct bucket *bucket;
@@ -47,6 +73,7 @@ bucket_alloc(void) {
            calloc(1, sizeof(struct bucket));
   if (bucket != NULL) {
     TAILQ_INIT(&bucket->action_list);
+    bucket->counter_id = dp_counter_alloc();
   }
 
   return bucket;
@@ -62,6 +89,7 @@ bucket_list_free(struct bucket_list *bucket_list) {
       ofp_action_list_elem_free(&bucket->action_list);
     }
     TAILQ_REMOVE(bucket_list, bucket, entry);
+    dp_counter_free(bucket->counter_id);
     free(bucket);
   }
 }
@@ -76,32 +104,36 @@ struct group_table {
   struct bridge *bridge;
 };
 
+/**
+ * Groups are locked with the flow database of the parent bridge.
+ */
+static inline struct flowdb *
+group_table_flowdb(struct group_table *group_table) {
+  if (group_table->bridge == NULL) {
+    return NULL;
+  }
+  return group_table->bridge->flowdb;
+}
+
 static inline void
 group_table_rdlock(struct group_table *group_table) {
-  (void) group_table;
-
-  FLOWDB_RWLOCK_RDLOCK();
+  flowdb_rdlock(group_table_flowdb(group_table));
 }
 
 static inline void
 group_table_rdunlock(struct group_table *group_table) {
-  (void) group_table;
-
-  FLOWDB_RWLOCK_RDUNLOCK();
+  flowdb_rdunlock(group_table_flowdb(group_table));
 }
 
 static inline void
 group_table_wrlock(struct group_table *group_table) {
-  (void) group_table;
-
-  FLOWDB_UPDATE_BEGIN();
+  /* entries are modified in place, stop forwarding threads. */
+  flowdb_wrlock(group_table_flowdb(group_table));
 }
 
 static inline void
 group_table_wrunlock(struct group_table *group_table) {
-  (void) group_table;
-
-  FLOWDB_UPDATE_END();
+  flowdb_wrunlock(group_table_flowdb(group_table));
 }
 
 struct group_table *
@@ -193,6 +225,349 @@ group_live_bucket(struct bridge *bridge,
   return NULL;
 }
 
+void
+group_liveness_changed(void) {
+  (void)__sync_add_and_fetch(&group_liveness_gen, 1);
+}
+
+/**
+ * Liveness of select bucket.  Buckets without watch port and watch
+ * group are always live.
+ */
+static bool
+group_select_bucket_live(struct bridge *bridge, struct bucket *bucket) {
+  struct group *a_group;
+  bool watched;
+
+  if (bridge == NULL) {
+    return true;
+  }
+  watched = false;
+  if (bucket->ofp.watch_port != OFPP_ANY && bucket->ofp.watch_port != 0) {
+    if (port_liveness(bridge, bucket->ofp.watch_port) == true) {
+      return true;
+    }
+    watched = true;
+  }
+  if (bucket->ofp.watch_group != OFPG_ANY) {
+    a_group = group_table_lookup(bridge->group_table,
+                                 bucket->ofp.watch_group);
+    if (a_group != NULL && group_live_bucket(bridge, a_group) != NULL) {
+      return true;
+    }
+    watched = true;
+  }
+  return !watched;
+}
+
+static inline uint64_t
+group_select_mix(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+/**
+ * Identity of bucket over group_mod, made of watch and actions.
+ */
+static uint64_t
+group_select_bucket_key(const struct bucket *bucket) {
+  const struct action *action;
+  const uint8_t *p;
+  uint64_t key;
+  size_t i, len;
+
+  key = 0xcbf29ce484222325ULL;
+  key = (key ^ bucket->ofp.watch_port) * 0x100000001b3ULL;
+  key = (key ^ bucket->ofp.watch_group) * 0x100000001b3ULL;
+  TAILQ_FOREACH(action, &bucket->action_list, entry) {
+    p = (const uint8_t *)&action->ofpat;
+    len = action->ofpat.len;
+    if (len < sizeof(struct ofp_action_header)) {
+      len = sizeof(struct ofp_action_header);
+    }
+    for (i = 0; i < len; i++) {
+      key = (key ^ p[i]) * 0x100000001b3ULL;
+    }
+  }
+  return key;
+}
+
+static void
+group_select_free(struct group_select *sel) {
+  if (sel == NULL) {
+    return;
+  }
+  free(sel->table);
+  free(sel->owner);
+  free(sel->buckets);
+  free(sel->keys);
+  free(sel->perm);
+  free(sel);
+}
+
+static uint32_t
+group_select_size(uint32_t nbuckets, const struct group_select *old) {
+  uint32_t i, n, size;
+
+  n = sizeof(group_select_sizes) / sizeof(group_select_sizes[0]);
+  for (i = 0; i < n - 1; i++) {
+    if (group_select_sizes[i] >=
+        nbuckets * GROUP_SELECT_SLOTS_PER_BUCKET) {
+      break;
+    }
+  }
+  size = group_select_sizes[i];
+  /* keep size of the old table to keep its slots. */
+  if (old != NULL && old->size >= size && old->size / 4 <= size) {
+    size = old->size;
+  }
+  return size;
+}
+
+/**
+ * Assign slots to live buckets in proportion to their weight.  Slots
+ * of live buckets are kept, and buckets short of their share claim
+ * unassigned slots or slots of buckets over their share, in order of
+ * their own slot preference (Maglev).  Only the flows of removed
+ * buckets and the flows taken by added buckets move.
+ *
+ * @param[in]   sel     Lookup table.
+ * @param[in]   bridge  Bridge for liveness, NULL if all buckets are live.
+ */
+static void
+group_select_populate(struct group_select *sel, struct bridge *bridge) {
+  struct group_select_perm *perm;
+  struct bucket *bucket;
+  uint64_t weight, total, sum;
+  uint32_t i, j, slot, short_of, prev;
+  bool weighted;
+
+  weighted = false;
+  for (i = 0; i < sel->nbuckets; i++) {
+    if (sel->buckets[i]->ofp.weight != 0) {
+      weighted = true;
+      break;
+    }
+  }
+  total = 0;
+  for (i = 0; i < sel->nbuckets; i++) {
+    perm = &sel->perm[i];
+    bucket = sel->buckets[i];
+    perm->next = 0;
+    perm->count = 0;
+    perm->target = 0;
+    if (group_select_bucket_live(bridge, bucket) == true) {
+      /* keep weight in target until shares are computed. */
+      perm->target = (weighted == true ? bucket->ofp.weight : 1);
+      total += perm->target;
+    }
+  }
+  if (total == 0) {
+    memset(sel->owner, 0xff, sizeof(uint16_t) * sel->size);
+    for (j = 0; j < sel->size; j++) {
+      sel->table[j] = NULL;
+    }
+    return;
+  }
+  sum = 0;
+  prev = 0;
+  for (i = 0; i < sel->nbuckets; i++) {
+    perm = &sel->perm[i];
+    weight = perm->target;
+    sum += weight;
+    perm->target = (uint32_t)(sum * sel->size / total) - prev;
+    prev += perm->target;
+  }
+
+  for (j = 0; j < sel->size; j++) {
+    i = sel->owner[j];
+    if (i != GROUP_SELECT_NONE && sel->perm[i].target != 0) {
+      sel->perm[i].count++;
+    } else {
+      sel->owner[j] = GROUP_SELECT_NONE;
+    }
+  }
+  do {
+    short_of = 0;
+    for (i = 0; i < sel->nbuckets; i++) {
+      perm = &sel->perm[i];
+      if (perm->count >= perm->target) {
+        continue;
+      }
+      /* every slot is visited once, claimable slot is never missed. */
+      for (;;) {
+        slot = (uint32_t)((perm->offset +
+                           (uint64_t)perm->next * perm->skip) % sel->size);
+        perm->next++;
+        j = sel->owner[slot];
+        if (j == GROUP_SELECT_NONE ||
+            sel->perm[j].count > sel->perm[j].target) {
+          break;
+        }
+      }
+      if (j != GROUP_SELECT_NONE) {
+        sel->perm[j].count--;
+      }
+      sel->owner[slot] = (uint16_t)i;
+      perm->count++;
+      if (perm->count < perm->target) {
+        short_of++;
+      }
+    }
+  } while (short_of != 0);
+
+  /* slots are word sized, readers see either of old and new bucket. */
+  for (j = 0; j < sel->size; j++) {
+    bucket = sel->buckets[sel->owner[j]];
+    if (sel->table[j] != bucket) {
+      sel->table[j] = bucket;
+    }
+  }
+}
+
+/**
+ * Build lookup table of select group from its buckets.  Slots of
+ * buckets also in the old table are carried over.
+ *
+ * @param[in]   group   Group.
+ * @param[in]   bridge  Bridge for liveness, NULL if all buckets are live.
+ * @param[in]   old     Old lookup table, or NULL.
+ *
+ * @retval      !=NULL  Lookup table.
+ * @retval      ==NULL  Memory exhausted or too many buckets.
+ */
+static struct group_select *
+group_select_build(struct group *group, struct bridge *bridge,
+                   const struct group_select *old) {
+  struct group_select *sel;
+  struct bucket *bucket;
+  uint32_t i, j, n, nbuckets;
+
+  nbuckets = 0;
+  TAILQ_FOREACH(bucket, &group->bucket_list, entry) {
+    nbuckets++;
+  }
+  if (nbuckets == 0 || nbuckets >= GROUP_SELECT_MAX_BUCKETS) {
+    return NULL;
+  }
+  sel = calloc(1, sizeof(struct group_select));
+  if (sel == NULL) {
+    return NULL;
+  }
+  sel->nbuckets = nbuckets;
+  sel->size = group_select_size(nbuckets, old);
+  sel->table = calloc(sel->size, sizeof(struct bucket *));
+  sel->owner = malloc(sel->size * sizeof(uint16_t));
+  sel->buckets = calloc(nbuckets, sizeof(struct bucket *));
+  sel->keys = calloc(nbuckets, sizeof(uint64_t));
+  sel->perm = calloc(nbuckets, sizeof(struct group_select_perm));
+  if (sel->table == NULL || sel->owner == NULL || sel->buckets == NULL ||
+      sel->keys == NULL || sel->perm == NULL) {
+    group_select_free(sel);
+    return NULL;
+  }
+
+  i = 0;
+  TAILQ_FOREACH(bucket, &group->bucket_list, entry) {
+    sel->buckets[i] = bucket;
+    sel->keys[i] = group_select_bucket_key(bucket);
+    i++;
+  }
+  /* identical buckets are told by their order. */
+  for (i = nbuckets; i-- > 0;) {
+    n = 0;
+    for (j = 0; j < i; j++) {
+      if (sel->keys[j] == sel->keys[i]) {
+        n++;
+      }
+    }
+    sel->keys[i] = group_select_mix(sel->keys[i] + n);
+    sel->perm[i].offset = (uint32_t)(sel->keys[i] % sel->size);
+    sel->perm[i].skip = (uint32_t)(group_select_mix(sel->keys[i]) %
+                                   (sel->size - 1)) + 1;
+  }
+
+  memset(sel->owner, 0xff, sizeof(uint16_t) * sel->size);
+  if (old != NULL && old->size == sel->size) {
+    uint16_t *map;
+
+    map = malloc(old->nbuckets * sizeof(uint16_t));
+    if (map != NULL) {
+      for (j = 0; j < old->nbuckets; j++) {
+        map[j] = GROUP_SELECT_NONE;
+        for (i = 0; i < nbuckets; i++) {
+          if (sel->keys[i] == old->keys[j]) {
+            map[j] = (uint16_t)i;
+            break;
+          }
+        }
+      }
+      for (j = 0; j < sel->size; j++) {
+        if (old->owner[j] != GROUP_SELECT_NONE) {
+          sel->owner[j] = map[old->owner[j]];
+        }
+      }
+      free(map);
+    }
+  }
+  group_select_populate(sel, bridge);
+
+  return sel;
+}
+
+/**
+ * Rebuild lookup table and live bucket of the group after its
+ * buckets are modified.  Called with write lock.
+ */
+static void
+group_rebuild(struct group *group, struct bridge *bridge) {
+  struct group_select *old;
+
+  group->live_gen = group_liveness_gen;
+  old = group->select;
+  group->select = NULL;
+  if (group->type == OFPGT_SELECT) {
+    group->select = group_select_build(group, bridge, old);
+    if (group->select == NULL && TAILQ_EMPTY(&group->bucket_list) == false) {
+      lagopus_msg_warning("group %d: no lookup table, select by list\n",
+                          group->id);
+    }
+  }
+  group_select_free(old);
+  group->live_bucket = NULL;
+  if (group->type == OFPGT_FF && bridge != NULL) {
+    group->live_bucket = group_live_bucket(bridge, group);
+  }
+  if (bridge == NULL) {
+    /* liveness is unknown until added to the bridge. */
+    group->live_gen--;
+  }
+}
+
+void
+group_liveness_refresh(struct bridge *bridge, struct group *group) {
+  uint32_t gen;
+
+  if (__sync_bool_compare_and_swap(&group->refreshing, 0, 1) == false) {
+    /* refreshed by other thread, keep using the current one. */
+    return;
+  }
+  gen = group_liveness_gen;
+  if (group->select != NULL) {
+    group_select_populate(group->select, bridge);
+  }
+  if (group->type == OFPGT_FF) {
+    group->live_bucket = group_live_bucket(bridge, group);
+  }
+  group->live_gen = gen;
+  mbar();
+  group->refreshing = 0;
+}
+
 lagopus_result_t
 group_table_add(struct group_table *group_table,
                 struct group *group,
@@ -217,6 +592,11 @@ group_table_add(struct group_table *group_table,
   }
   /* Reference table. */
   group->group_table = group_table;
+  /* groups watching the group are refreshed. */
+  group_liveness_changed();
+  if (group_table->bridge != NULL) {
+    group_liveness_refresh(group_table->bridge, group);
+  }
   return LAGOPUS_RESULT_OK;
 }
 
@@ -231,6 +611,7 @@ group_table_delete(struct group_table *group_table, uint32_t group_id) {
     lagopus_hashmap_delete_no_lock(&group_table->hashmap,
                                    (void *)key, NULL, true);
   }
+  group_liveness_changed();
 
   return LAGOPUS_RESULT_OK;
 }
@@ -283,6 +664,7 @@ group_alloc(struct ofp_group_mod *group_mod,
 
   group->id = group_mod->group_id;
   group->type = group_mod->type;
+  group->counter_id = dp_counter_alloc();
   TAILQ_INIT(&group->bucket_list);
   copy_bucket_list(&group->bucket_list, bucket_list);
   if (lagopus_register_action_hook != NULL) {
@@ -298,6 +680,7 @@ group_alloc(struct ofp_group_mod *group_mod,
       merge_action_set(bucket->actions, &bucket->action_list);
     }
   }
+  group_rebuild(group, NULL);
   lagopus_hashmap_create(&group->flows, LAGOPUS_HASHMAP_TYPE_ONE_WORD, NULL);
   clock_gettime(CLOCK_MONOTONIC, &group->create_time);
 
@@ -325,22 +708,33 @@ group_do_flow_iterate(void *key, void *val,
 
 void
 group_free(struct group *group) {
+  group_select_free(group->select);
   bucket_list_free(&group->bucket_list);
   /* remove group action from each flows. */
   lagopus_hashmap_iterate_no_lock(&group->flows,
                                   group_do_flow_iterate,
                                   group->group_table->bridge);
   lagopus_hashmap_destroy(&group->flows, false);
+  dp_counter_free(group->counter_id);
   free(group);
 }
 
 void
 group_modify(struct group *group, struct ofp_group_mod *group_mod,
              struct bucket_list *bucket_list) {
+  struct bridge *bridge;
+
+  /* old table refers old buckets, it is only read until rebuilt. */
   bucket_list_free(&group->bucket_list);
   group->type = group_mod->type;
   TAILQ_INIT(&group->bucket_list);
   copy_bucket_list(&group->bucket_list, bucket_list);
+  bridge = NULL;
+  if (group->group_table != NULL) {
+    bridge = group->group_table->bridge;
+  }
+  group_liveness_changed();
+  group_rebuild(group, bridge);
 
   /* refresh action hook */
   if (lagopus_register_action_hook != NULL) {
@@ -382,11 +776,13 @@ static lagopus_result_t
 set_group_stats(struct group_stats *stats, const struct group *group) {
   struct timespec ts;
   struct bucket *bucket;
+  struct dp_counter counter;
 
   stats->ofp.group_id = group->id;
   stats->ofp.ref_count = (uint32_t)lagopus_hashmap_size(&group->flows);
-  stats->ofp.packet_count = group->packet_count;
-  stats->ofp.byte_count = group->byte_count;
+  dp_counter_get(group->counter_id, &counter);
+  stats->ofp.packet_count = counter.packets;
+  stats->ofp.byte_count = counter.bytes;
 
   clock_gettime(CLOCK_MONOTONIC, &ts);
   stats->ofp.duration_sec = (uint32_t)(ts.tv_sec - group->create_time.tv_sec);
@@ -408,7 +804,9 @@ set_group_stats(struct group_stats *stats, const struct group *group) {
     if (bucket_counter == NULL) {
       return LAGOPUS_RESULT_NO_MEMORY;
     }
-    bucket_counter->ofp = bucket->counter;
+    dp_counter_get(bucket->counter_id, &counter);
+    bucket_counter->ofp.packet_count = counter.packets;
+    bucket_counter->ofp.byte_count = counter.bytes;
     TAILQ_INSERT_TAIL(&stats->bucket_counter_list, bucket_counter, entry);
   }
   return LAGOPUS_RESULT_OK;
@@ -104,6 +104,14 @@ dp_interface_configure_internal(struct interface *ifp) {
       rv = rawsock_configure_interface(ifp);
       break;
 
+    case DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP:
+#ifdef __linux__
+      rv = afxdp_configure_interface(ifp);
+#else
+      rv = LAGOPUS_RESULT_INVALID_ARGS;
+#endif /* __linux__ */
+      break;
+
     case DATASTORE_INTERFACE_TYPE_UNKNOWN:
       rv = LAGOPUS_RESULT_OK;
       break;
@@ -150,6 +158,12 @@ dp_interface_unconfigure_internal(struct interface *ifp) {
       rv = rawsock_unconfigure_interface(ifp);
       break;
 
+#ifdef __linux__
+    case DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP:
+      rv = afxdp_unconfigure_interface(ifp);
+      break;
+#endif /* __linux__ */
+
     case DATASTORE_INTERFACE_TYPE_UNKNOWN:
       /* nothing to do. */
       rv = LAGOPUS_RESULT_OK;
@@ -188,6 +202,7 @@ dp_interface_start_internal(struct interface *ifp) {
       break;
 #endif
     case DATASTORE_INTERFACE_TYPE_ETHERNET_RAWSOCK:
+    case DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP:
       rv = rawsock_start_interface(ifp);
       break;
 
@@ -232,6 +247,7 @@ dp_interface_stop_internal(struct interface *ifp) {
       break;
 #endif
     case DATASTORE_INTERFACE_TYPE_ETHERNET_RAWSOCK:
+    case DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP:
       return rawsock_stop_interface(ifp);
 
     case DATASTORE_INTERFACE_TYPE_UNKNOWN:
@@ -268,6 +284,11 @@ dp_interface_rx_burst_internal(struct interface *ifp,
     case DATASTORE_INTERFACE_TYPE_ETHERNET_RAWSOCK:
       return rawsock_rx_burst(ifp, mbufs, nb);
 
+#ifdef __linux__
+    case DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP:
+      return afxdp_rx_burst(ifp, mbufs, nb);
+#endif /* __linux__ */
+
     case DATASTORE_INTERFACE_TYPE_UNKNOWN:
       break;
 
@@ -464,6 +485,11 @@ dp_interface_hw_addr_get_internal(struct interface *ifp, uint8_t *hw_addr) {
     case DATASTORE_INTERFACE_TYPE_ETHERNET_RAWSOCK:
       return rawsock_get_hwaddr(ifp, hw_addr);
 
+#ifdef __linux__
+    case DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP:
+      return afxdp_get_hwaddr(ifp, hw_addr);
+#endif /* __linux__ */
+
     case DATASTORE_INTERFACE_TYPE_UNKNOWN:
       return LAGOPUS_RESULT_OK;
 
@@ -493,6 +519,7 @@ dp_interface_stats_get_internal(struct interface *ifp,
       break;
 #endif
     case DATASTORE_INTERFACE_TYPE_ETHERNET_RAWSOCK:
+    case DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP:
       return rawsock_get_stats(ifp, stats);
 
     case DATASTORE_INTERFACE_TYPE_UNKNOWN:
@@ -523,6 +550,7 @@ dp_interface_stats_clear_internal(struct interface *ifp) {
       break;
 #endif
     case DATASTORE_INTERFACE_TYPE_ETHERNET_RAWSOCK:
+    case DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP:
       return rawsock_clear_stats(ifp);
 
     case DATASTORE_INTERFACE_TYPE_UNKNOWN:
@@ -555,6 +583,7 @@ dp_interface_change_config(struct interface *ifp,
       break;
 #endif
     case DATASTORE_INTERFACE_TYPE_ETHERNET_RAWSOCK:
+    case DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP:
       return rawsock_change_config(ifp, advertised, config);
 
     case DATASTORE_INTERFACE_TYPE_UNKNOWN:
@@ -586,6 +615,7 @@ dp_interface_queue_configure(struct interface *ifp) {
 #endif
 
     case DATASTORE_INTERFACE_TYPE_ETHERNET_RAWSOCK:
+    case DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP:
     case DATASTORE_INTERFACE_TYPE_UNKNOWN:
       return LAGOPUS_RESULT_OK;
 
@@ -624,6 +654,7 @@ dp_interface_queue_add(struct interface *ifp, dp_queue_info_t *queue) {
 #endif
 
     case DATASTORE_INTERFACE_TYPE_ETHERNET_RAWSOCK:
+    case DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP:
     case DATASTORE_INTERFACE_TYPE_UNKNOWN:
       rv = LAGOPUS_RESULT_OK;
       break;
@@ -658,6 +689,7 @@ dp_interface_queue_delete(struct interface *ifp, uint32_t queue_id) {
       break;
 #endif
     case DATASTORE_INTERFACE_TYPE_ETHERNET_RAWSOCK:
+    case DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP:
     case DATASTORE_INTERFACE_TYPE_UNKNOWN:
       return LAGOPUS_RESULT_OK;
 
@@ -24,8 +24,19 @@
 #include "rte_rwlock.h"
 #endif /* HAVE_DPDK */
 
+#include "epoch.h"
+
 /*
  * flowdb lock primitive.
+ *
+ * dpmgr_lock protects the bridge and port configuration, and is
+ * taken by control plane threads only.  Each flow database has its
+ * own rwlock for writers of the flow entries, groups and meters of
+ * the bridge.  Forwarding threads do not take any lock; they run in
+ * epoch section (epoch.h) and writers either publish updates and wait
+ * for the grace period (flowdb_flowmod_lock()), or stop threads
+ * reading the flow database while modifying data in place
+ * (flowdb_wrlock()).
  */
 #ifdef HAVE_DPDK
 rte_rwlock_t flowdb_update_lock;
@@ -44,10 +55,6 @@ rte_rwlock_t dpmgr_lock;
 #define FLOWDB_RWLOCK_WRUNLOCK() do {                                   \
     rte_rwlock_write_unlock(&dpmgr_lock);                               \
   } while(0)
-#define FLOWDB_UPDATE_CHECK() do {                      \
-    rte_rwlock_read_lock(&flowdb_update_lock);          \
-    rte_rwlock_read_unlock(&flowdb_update_lock);        \
-  } while (0)
 #define FLOWDB_UPDATE_BEGIN() do {               \
     rte_rwlock_write_lock(&flowdb_update_lock);  \
   } while (0)
@@ -73,10 +80,6 @@ pthread_rwlock_t dpmgr_lock;
 #define FLOWDB_RWLOCK_WRUNLOCK() do {                                   \
     pthread_rwlock_unlock(&dpmgr_lock);                                 \
   } while(0)
-#define FLOWDB_UPDATE_CHECK() do {                      \
-    pthread_rwlock_rdlock(&flowdb_update_lock);    \
-    pthread_rwlock_unlock(&flowdb_update_lock);     \
-  } while (0)
 #define FLOWDB_UPDATE_BEGIN() do {                      \
     pthread_rwlock_wrlock(&flowdb_update_lock);    \
   } while (0)
@@ -93,60 +96,112 @@ pthread_rwlock_t dpmgr_lock;
 void flowdb_lock_init(struct flowdb *flowdb);
 
 /**
- * Read lock the flow database.
+ * Publish classifier updates made in the write section, wait for
+ * forwarding threads to leave old one and reclaim removed flows.
+ * Called in write section.
  *
- * @param[in]   flowdb  Flow database to be locked.
+ * @param[in]   flowdb  Flow database.
  */
-static inline void
-flowdb_rdlock(struct flowdb *flowdb) {
-  (void) flowdb;
-  FLOWDB_RWLOCK_RDLOCK();
-}
+void flowdb_publish(struct flowdb *flowdb);
 
 /**
- * Check write lock the flow database.
+ * Check the flow database is not modified in place, from forwarding
+ * thread in epoch section.
  *
- * @param[in]   flowdb  Flow database to be locked.
+ * @param[in]   flowdb  Flow database to be read.
+ *
+ * @retval      true    Section is kept.
+ * @retval      false   Section is entered again, data read so far must
+ *                      be read again.
+ */
+bool flowdb_epoch_check(struct flowdb *flowdb);
+
+/**
+ * Enter the flow database from forwarding thread.
+ *
+ * @param[in]   flowdb  Flow database to be read, NULL if flow
+ *                      databases are checked by flowdb_epoch_check().
  */
 static inline void
-flowdb_check_update(struct flowdb *flowdb) {
-  (void) flowdb;
-  FLOWDB_UPDATE_CHECK();
+flowdb_epoch_enter(struct flowdb *flowdb) {
+  dp_epoch_enter();
+  if (flowdb != NULL) {
+    while (flowdb_epoch_check(flowdb) == false) {
+      /* checked again. */
+    }
+  }
 }
 
 /**
- * Write lock the flow database.
+ * Leave the flow database from forwarding thread.
  *
- * @param[in]   flowdb  Flow database to be locked.
+ * @param[in]   flowdb  Flow database to be read.
  */
 static inline void
-flowdb_wrlock(struct flowdb *flowdb) {
+flowdb_epoch_exit(struct flowdb *flowdb) {
   (void) flowdb;
-  FLOWDB_UPDATE_BEGIN();
-  FLOWDB_RWLOCK_WRLOCK();
+  dp_epoch_exit();
 }
 
+/**
+ * Read lock the flow database.  Not for forwarding threads.
+ *
+ * @param[in]   flowdb  Flow database to be locked, NULL for the bridge
+ *                      and port configuration only.
+ */
+void flowdb_rdlock(struct flowdb *flowdb);
+
 /**
  * Unlock read lock the flow database.
  *
  * @param[in]   flowdb  Flow database to be unlocked.
  */
-static inline void
-flowdb_rdunlock(struct flowdb *flowdb) {
-  (void) flowdb;
-  FLOWDB_RWLOCK_RDUNLOCK();
-}
+void flowdb_rdunlock(struct flowdb *flowdb);
+
+/**
+ * Write lock the flow database, and stop forwarding threads reading
+ * it.  If flowdb is NULL, the bridge and port configuration is locked
+ * and all forwarding threads are stopped.
+ *
+ * @param[in]   flowdb  Flow database to be locked.
+ */
+void flowdb_wrlock(struct flowdb *flowdb);
 
 /**
  * Unlock write lock the flow database.
  *
  * @param[in]   flowdb  Flow database to be unlocked.
  */
-static inline void
-flowdb_wrunlock(struct flowdb *flowdb) {
-  (void) flowdb;
-  FLOWDB_RWLOCK_WRUNLOCK();
-  FLOWDB_UPDATE_END();
-}
+void flowdb_wrunlock(struct flowdb *flowdb);
+
+/**
+ * Write lock the flow database for updating flow entries.
+ * Forwarding threads keep running on the published classifier.
+ *
+ * @param[in]   flowdb  Flow database to be locked.
+ */
+void flowdb_flowmod_lock(struct flowdb *flowdb);
+
+/**
+ * Unlock flowdb_flowmod_lock().  Updates are published.
+ *
+ * @param[in]   flowdb  Flow database to be unlocked.
+ */
+void flowdb_flowmod_unlock(struct flowdb *flowdb);
+
+/**
+ * flowdb_flowmod_lock() for the caller holding flowdb_rdlock(NULL),
+ * to update flow entries of bridges one by one.
+ *
+ * @param[in]   flowdb  Flow database to be locked.
+ */
+void flowdb_flowmod_lock_nested(struct flowdb *flowdb);
+
+/**
+ * Unlock flowdb_flowmod_lock_nested().  Updates are published.
+ *
+ * @param[in]   flowdb  Flow database to be unlocked.
+ */
+void flowdb_flowmod_unlock_nested(struct flowdb *flowdb);
 
 #endif /* SRC_DATAPLANE_MGR_LOCK_H_ */
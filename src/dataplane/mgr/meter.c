@@ -25,6 +25,7 @@
 #include "lagopus/dp_apis.h"
 
 #include "lock.h"
+#include "counter.h"
 
 /**
  * @brief Meter table.
@@ -32,8 +33,20 @@
 struct meter_table {                    /** Meter table. */
   pthread_rwlock_t rwlock;              /** Read-write lock. */
   lagopus_hashmap_t hashmap;            /** Meter id hashtable. */
+  struct bridge *bridge;                /** Parent bridge. */
 };
 
+/**
+ * Meters are locked with the flow database of the parent bridge.
+ */
+static inline struct flowdb *
+meter_table_flowdb(struct meter_table *meter_table) {
+  if (meter_table->bridge == NULL) {
+    return NULL;
+  }
+  return meter_table->bridge->flowdb;
+}
+
 static inline void
 meter_table_lock_init(struct meter_table *meter_table) {
   (void) meter_table;
@@ -41,30 +54,46 @@ meter_table_lock_init(struct meter_table *meter_table) {
 
 static inline void
 meter_table_rdlock(struct meter_table *meter_table) {
-  (void) meter_table;
-
-  FLOWDB_RWLOCK_RDLOCK();
+  flowdb_rdlock(meter_table_flowdb(meter_table));
 }
 
 static inline void
 meter_table_rdunlock(struct meter_table *meter_table) {
-  (void) meter_table;
-
-  FLOWDB_RWLOCK_RDUNLOCK();
+  flowdb_rdunlock(meter_table_flowdb(meter_table));
 }
 
 static inline void
 meter_table_wrlock(struct meter_table *meter_table) {
-  (void) meter_table;
-
-  FLOWDB_UPDATE_BEGIN();
+  /* entries are modified in place, stop forwarding threads. */
+  flowdb_wrlock(meter_table_flowdb(meter_table));
 }
 
 static inline void
 meter_table_wrunlock(struct meter_table *meter_table) {
-  (void) meter_table;
+  flowdb_wrunlock(meter_table_flowdb(meter_table));
+}
+
+/* bands are owned by the meter, counted while attached. */
+static void
+meter_bands_attach(struct meter *meter, struct meter_band_list *band_list) {
+  struct meter_band *band;
+
+  TAILQ_INIT(&meter->band_list);
+  TAILQ_CONCAT(&meter->band_list, band_list, entry);
+  TAILQ_FOREACH(band, &meter->band_list, entry) {
+    band->counter_id = dp_counter_alloc();
+  }
+}
 
-  FLOWDB_UPDATE_END();
+static void
+meter_bands_detach(struct meter *meter) {
+  struct meter_band *band;
+
+  while ((band = TAILQ_FIRST(&meter->band_list)) != NULL) {
+    TAILQ_REMOVE(&meter->band_list, band, entry);
+    dp_counter_free(band->counter_id);
+    meter_band_free(band);
+  }
 }
 
 static struct meter *
@@ -80,8 +109,8 @@ meter_alloc(uint32_t meter_id,
 
   meter->meter_id = meter_id;
   meter->flags = flags;
-  TAILQ_INIT(&meter->band_list);
-  TAILQ_CONCAT(&meter->band_list, band_list, entry);
+  meter->counter_id = dp_counter_alloc();
+  meter_bands_attach(meter, band_list);
   clock_gettime(CLOCK_MONOTONIC, &meter->create_time);
   if (lagopus_register_meter != NULL) {
     lagopus_register_meter(meter);
@@ -94,18 +123,12 @@ static lagopus_result_t
 meter_modify(struct meter *meter,
              uint16_t flags,
              struct meter_band_list *band_list) {
-  struct meter_band *band;
-
-  while ((band = TAILQ_FIRST(&meter->band_list)) != NULL) {
-    TAILQ_REMOVE(&meter->band_list, band, entry);
-    meter_band_free(band);
-  }
+  meter_bands_detach(meter);
   if (lagopus_unregister_meter != NULL) {
     lagopus_unregister_meter(meter);
   }
   meter->flags = flags;
-  TAILQ_INIT(&meter->band_list);
-  TAILQ_CONCAT(&meter->band_list, band_list, entry);
+  meter_bands_attach(meter, band_list);
   if (lagopus_register_meter != NULL) {
     lagopus_register_meter(meter);
   }
@@ -115,21 +138,17 @@ meter_modify(struct meter *meter,
 
 static void
 meter_free(struct meter *meter) {
-  struct meter_band *band;
-
-  while ((band = TAILQ_FIRST(&meter->band_list)) != NULL) {
-    TAILQ_REMOVE(&meter->band_list, band, entry);
-    meter_band_free(band);
-  }
+  meter_bands_detach(meter);
 
   if (lagopus_unregister_meter != NULL) {
     lagopus_unregister_meter(meter);
   }
+  dp_counter_free(meter->counter_id);
   free(meter);
 }
 
 struct meter_table *
-meter_table_alloc(void) {
+meter_table_alloc(struct bridge *parent) {
   struct meter_table *meter_table;
 
   meter_table = calloc(1, sizeof(struct meter_table));
@@ -146,6 +165,7 @@ meter_table_alloc(void) {
   }
 
   meter_table_lock_init(meter_table);
+  meter_table->bridge = parent;
 
   return meter_table;
 }
@@ -344,11 +364,13 @@ set_meter_stats(struct meter_stats *stats, const struct meter *meter) {
 
   struct timespec ts;
   struct meter_band *band;
+  struct dp_counter counter;
 
   stats->ofp.meter_id = meter->meter_id;
   stats->ofp.flow_count = meter->flow_count;
-  stats->ofp.packet_in_count = meter->input_packet_count;
-  stats->ofp.byte_in_count = meter->input_byte_count;
+  dp_counter_get(meter->counter_id, &counter);
+  stats->ofp.packet_in_count = counter.packets;
+  stats->ofp.byte_in_count = counter.bytes;
 
   clock_gettime(CLOCK_MONOTONIC, &ts);
   stats->ofp.duration_sec = (uint32_t)(ts.tv_sec - meter->create_time.tv_sec);
@@ -370,7 +392,9 @@ set_meter_stats(struct meter_stats *stats, const struct meter *meter) {
     if (band_stats == NULL) {
       return LAGOPUS_RESULT_NO_MEMORY;
     }
-    band_stats->ofp = band->stats;
+    dp_counter_get(band->counter_id, &counter);
+    band_stats->ofp.packet_band_count = counter.packets;
+    band_stats->ofp.byte_band_count = counter.bytes;
     TAILQ_INSERT_TAIL(&stats->meter_band_stats_list, band_stats, entry);
   }
 
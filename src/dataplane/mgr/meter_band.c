@@ -0,0 +1,170 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ *      @file   meter_band.c
+ *      @brief  Metering support with lock-free token bucket, common to
+ *              DPDK and raw socket dataplanes
+ */
+
+#include <sys/queue.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openflow.h>
+#include "lagopus/flowdb.h"
+#include "lagopus/meter.h"
+#include "lagopus/port.h"
+#include "lagopus/dataplane.h"
+#include "pktbuf.h"
+#include "packet.h"
+#include "counter.h"
+#include "meter_bucket.h"
+
+#define KBPS2BYTEPS(kbps) ((uint64_t)(kbps) * 1000 / 8)
+
+/*
+ * each band has token bucket of its rate, and packet exceeding the
+ * rate of band is red for the band.  bands are sorted by rate in
+ * descending order, the first red band is applied to the packet
+ * since it has the highest rate lower than the measured rate.
+ *
+ * without OFPMF_BURST, burst size is one second of the rate.
+ *
+ * token buckets are not locked, each forwarding thread takes credit
+ * of a band in bulk into its own share (see meter_bucket.h).
+ */
+
+struct band_bucket {
+  struct meter_bucket bucket;
+  struct meter_band *band;
+};
+
+struct band_buckets {
+  int nbands;
+  struct band_bucket bands[];
+};
+
+static void meter_band_register(struct meter *);
+static void meter_band_unregister(struct meter *);
+
+void
+lagopus_meter_init(void) {
+  lagopus_register_meter = meter_band_register;
+  lagopus_unregister_meter = meter_band_unregister;
+}
+
+static void
+band_bucket_config(struct band_bucket *bb, struct meter_band *band,
+                   uint16_t flags) {
+  uint64_t rate, burst;
+
+  if ((flags & OFPMF_PKTPS) == 0) {
+    /* unit of rate is kbps, token is byte. */
+    rate = KBPS2BYTEPS(band->rate);
+    burst = ((flags & OFPMF_BURST) != 0) ?
+            KBPS2BYTEPS(band->burst_size) : rate;
+    if (burst < MAX_PACKET_SZ) {
+      burst = MAX_PACKET_SZ;
+    }
+  } else {
+    /* unit of rate is pps, token is packet. */
+    rate = band->rate;
+    burst = ((flags & OFPMF_BURST) != 0) ? band->burst_size : rate;
+    if (burst < 1) {
+      burst = 1;
+    }
+  }
+  meter_bucket_config(&bb->bucket, rate, burst);
+  bb->band = band;
+}
+
+static void
+meter_band_register(struct meter *meter) {
+  struct band_buckets *buckets;
+  struct meter_band *band;
+  size_t size;
+  int i, j;
+
+  size = sizeof(*buckets);
+  TAILQ_FOREACH(band, &meter->band_list, entry) {
+    size += sizeof(struct band_bucket);
+  }
+  if (posix_memalign((void **)&buckets, 64, size) != 0) {
+    meter->driverdata = NULL;
+    return;
+  }
+  memset(buckets, 0, size);
+  TAILQ_FOREACH(band, &meter->band_list, entry) {
+    /* insertion sort by rate in descending order. */
+    for (i = 0; i < buckets->nbands; i++) {
+      if (band->rate > buckets->bands[i].band->rate) {
+        break;
+      }
+    }
+    for (j = buckets->nbands; j > i; j--) {
+      buckets->bands[j] = buckets->bands[j - 1];
+    }
+    band_bucket_config(&buckets->bands[i], band, meter->flags);
+    buckets->nbands++;
+  }
+  meter->driverdata = buckets;
+}
+
+static void
+meter_band_unregister(struct meter *meter) {
+  free(meter->driverdata);
+  meter->driverdata = NULL;
+}
+
+int
+lagopus_meter_packet(struct lagopus_packet *pkt, struct meter *meter,
+                     uint8_t *prec_level) {
+  struct band_buckets *buckets;
+  struct meter_band *band;
+  uint64_t now;
+  uint32_t tokens;
+  int index, i;
+
+  if ((meter->flags & OFPMF_STATS) != 0) {
+    dp_counter_add(meter->counter_id, 1, OS_M_PKTLEN(PKT2MBUF(pkt)));
+  }
+  buckets = meter->driverdata;
+  if (buckets == NULL || buckets->nbands == 0) {
+    return 0;
+  }
+  if ((meter->flags & OFPMF_PKTPS) == 0) {
+    tokens = (uint32_t)OS_M_PKTLEN(PKT2MBUF(pkt));
+  } else {
+    tokens = 1;
+  }
+  index = meter_bucket_share_index();
+  now = meter_bucket_clock();
+  for (i = 0; i < buckets->nbands; i++) {
+    if (meter_bucket_take(&buckets->bands[i].bucket,
+                          index, tokens, now) == false) {
+      band = buckets->bands[i].band;
+      if ((meter->flags & OFPMF_STATS) != 0) {
+        dp_counter_add(band->counter_id, 1, OS_M_PKTLEN(PKT2MBUF(pkt)));
+      }
+      if (band->type == OFPMBT_DSCP_REMARK) {
+        *prec_level = band->prec_level;
+      }
+      return band->type;
+    }
+  }
+  return 0;
+}
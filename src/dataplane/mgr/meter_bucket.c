@@ -0,0 +1,206 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ *      @file   meter_bucket.c
+ *      @brief  Lock-free token bucket for meter bands.
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+#include "lagopus_apis.h"
+#include "meter_bucket.h"
+
+#ifdef HAVE_DPDK
+#include <rte_cycles.h>
+#endif /* HAVE_DPDK */
+
+#define NSEC_PER_SEC    (1000ULL * 1000 * 1000)
+
+__thread int meter_bucket_self = -1;
+static volatile int meter_bucket_nshares = 0;
+static uint64_t meter_bucket_quantum = METER_BUCKET_QUANTUM_NSEC;
+
+#ifdef HAVE_DPDK
+/* TSC and CLOCK_MONOTONIC at calibration, nsec per TSC in 32.32. */
+static uint64_t clock_tsc_base;
+static uint64_t clock_nsec_base;
+static uint64_t clock_tsc_mult = 0;
+static pthread_once_t clock_once = PTHREAD_ONCE_INIT;
+#endif /* HAVE_DPDK */
+
+int
+meter_bucket_share_assign(void) {
+  meter_bucket_self = __sync_fetch_and_add(&meter_bucket_nshares, 1) %
+                      METER_BUCKET_SHARES;
+  return meter_bucket_self;
+}
+
+static uint64_t
+meter_bucket_clock_monotonic(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+#ifdef HAVE_DPDK
+static void
+meter_bucket_clock_calibrate(void) {
+  uint64_t mult;
+
+  mult = (NSEC_PER_SEC << 32) / rte_get_tsc_hz();
+  clock_nsec_base = meter_bucket_clock_monotonic();
+  clock_tsc_base = rte_rdtsc();
+  mbar();
+  clock_tsc_mult = mult;
+}
+#endif /* HAVE_DPDK */
+
+uint64_t
+meter_bucket_clock(void) {
+#ifdef HAVE_DPDK
+  if (likely(clock_tsc_mult != 0)) {
+    return clock_nsec_base +
+           (uint64_t)(((unsigned __int128)(rte_rdtsc() - clock_tsc_base) *
+                       clock_tsc_mult) >> 32);
+  }
+  (void)pthread_once(&clock_once, meter_bucket_clock_calibrate);
+#endif /* HAVE_DPDK */
+  return meter_bucket_clock_monotonic();
+}
+
+void
+meter_bucket_quantum_set(uint64_t nsec) {
+  if (nsec > METER_BUCKET_DEPTH_NSEC) {
+    nsec = METER_BUCKET_DEPTH_NSEC;
+  }
+  meter_bucket_quantum = nsec;
+}
+
+void
+meter_bucket_config(struct meter_bucket *bucket,
+                    uint64_t rate, uint64_t burst) {
+  double depth;
+
+  if (rate == 0) {
+    rate = 1;
+  }
+  memset(bucket, 0, sizeof(*bucket));
+  bucket->cost = (NSEC_PER_SEC <<
+                  (METER_BUCKET_TIME_SHIFT + METER_BUCKET_COST_SHIFT)) / rate;
+  depth = (double)burst * (double)(NSEC_PER_SEC << METER_BUCKET_TIME_SHIFT) /
+          (double)rate;
+  if (depth > (double)(METER_BUCKET_DEPTH_NSEC << METER_BUCKET_TIME_SHIFT)) {
+    depth = (double)(METER_BUCKET_DEPTH_NSEC << METER_BUCKET_TIME_SHIFT);
+  }
+  bucket->depth = (uint64_t)depth;
+  bucket->quantum = bucket->depth / METER_BUCKET_SHARES;
+  if (bucket->quantum > (meter_bucket_quantum << METER_BUCKET_TIME_SHIFT)) {
+    bucket->quantum = meter_bucket_quantum << METER_BUCKET_TIME_SHIFT;
+  }
+  /* full, whole depth is conforming from now. */
+  bucket->tat = meter_bucket_clock() << METER_BUCKET_TIME_SHIFT;
+  bucket->reclaimed = bucket->tat;
+}
+
+/*
+ * Advance theoretical arrival time by cost if it stays within depth.
+ * Time is compared by difference, so it may wrap around.
+ */
+static bool
+meter_bucket_grab(struct meter_bucket *bucket, uint64_t cost, uint64_t now) {
+  uint64_t tat, next;
+
+  do {
+    tat = bucket->tat;
+    next = ((int64_t)(tat - now) < 0 ? now : tat) + cost;
+    if ((int64_t)(next - now) > (int64_t)bucket->depth) {
+      return false;
+    }
+  } while (__sync_bool_compare_and_swap(&bucket->tat, tat, next) == false);
+
+  return true;
+}
+
+/*
+ * Return credit of idle shares to the bucket.  Only one thread
+ * reclaims per interval, others fail immediately.
+ */
+static bool
+meter_bucket_reclaim(struct meter_bucket *bucket,
+                     struct meter_bucket_share *self, uint64_t now) {
+  struct meter_bucket_share *share;
+  uint64_t last;
+  int64_t credit;
+  int i;
+
+  last = bucket->reclaimed;
+  if ((int64_t)(now - last) <
+      (int64_t)(METER_BUCKET_RECLAIM_NSEC << METER_BUCKET_TIME_SHIFT) ||
+      __sync_bool_compare_and_swap(&bucket->reclaimed, last, now) == false) {
+    return false;
+  }
+  credit = 0;
+  for (i = 0; i < METER_BUCKET_SHARES; i++) {
+    share = &bucket->shares[i];
+    if (share == self || share->credit == 0 ||
+        (int64_t)(now - share->used) <
+        (int64_t)(METER_BUCKET_RECLAIM_NSEC << METER_BUCKET_TIME_SHIFT)) {
+      continue;
+    }
+    /* may be transiently negative while the owner takes credit. */
+    credit += __sync_lock_test_and_set(&share->credit, 0);
+  }
+  if (credit == 0) {
+    return false;
+  }
+  (void)__sync_fetch_and_sub(&bucket->tat, (uint64_t)credit);
+
+  return true;
+}
+
+bool
+meter_bucket_take_slow(struct meter_bucket *bucket,
+                       struct meter_bucket_share *share,
+                       uint64_t cost, uint64_t now) {
+  int64_t credit;
+
+  if (bucket->quantum > 0 &&
+      meter_bucket_grab(bucket, cost + bucket->quantum, now) == true) {
+    (void)__sync_add_and_fetch(&share->credit, (int64_t)bucket->quantum);
+    share->used = now;
+    return true;
+  }
+
+  /* spend remaining credit of the share and take the rest. */
+  credit = __sync_lock_test_and_set(&share->credit, 0);
+  if (credit >= (int64_t)cost ||
+      meter_bucket_grab(bucket, cost - (uint64_t)credit, now) == true ||
+      (meter_bucket_reclaim(bucket, share, now) == true &&
+       meter_bucket_grab(bucket, cost - (uint64_t)credit, now) == true)) {
+    if (credit > (int64_t)cost) {
+      (void)__sync_add_and_fetch(&share->credit, credit - (int64_t)cost);
+    }
+    share->used = now;
+    return true;
+  }
+  (void)__sync_add_and_fetch(&share->credit, credit);
+
+  return false;
+}
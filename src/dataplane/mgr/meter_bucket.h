@@ -0,0 +1,184 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ *      @file   meter_bucket.h
+ *      @brief  Lock-free token bucket for meter bands.
+ *
+ * The bucket is kept as theoretical arrival time (GCRA) in a single
+ * word, so it is refilled and consumed by one compare-and-swap
+ * without lock.  Time is in 1/256 nsec, and tokens (bytes or packets)
+ * are converted to the time they take at the configured rate.
+ *
+ * Forwarding threads do not take tokens from the shared word per
+ * packet.  Each thread owns a share taking a quantum of credit at
+ * once and spends it locally.  Credit left in shares of idle threads
+ * is reclaimed to the bucket when other threads run out of it, at
+ * most once per reclaim interval.  Credit held by shares is bounded by
+ * METER_BUCKET_SHARES quanta, which is the accuracy bound of the meter
+ * over the burst size.  Smaller quantum is more accurate, and takes
+ * the shared word more often.
+ */
+
+#ifndef SRC_DATAPLANE_MGR_METER_BUCKET_H_
+#define SRC_DATAPLANE_MGR_METER_BUCKET_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lagopus_apis.h"
+
+/* number of shares, forwarding threads share them if more. */
+#define METER_BUCKET_SHARES             16
+
+/* fractional bits of time unit. */
+#define METER_BUCKET_TIME_SHIFT         8
+/* fractional bits of time per token. */
+#define METER_BUCKET_COST_SHIFT         16
+#define METER_BUCKET_COST_MASK          ((1ULL << METER_BUCKET_COST_SHIFT) - 1)
+
+/* default max credit taken by a share at once. */
+#define METER_BUCKET_QUANTUM_NSEC       100000
+/* credit of shares unused for this interval is reclaimed. */
+#define METER_BUCKET_RECLAIM_NSEC       1000000
+/* max burst size in time, larger burst is truncated. */
+#define METER_BUCKET_DEPTH_NSEC         (60ULL * 1000 * 1000 * 1000)
+
+/**
+ * @brief Credit of a forwarding thread.
+ */
+struct meter_bucket_share {
+  volatile int64_t credit;      /** Credit in time unit. */
+  volatile uint64_t used;       /** Time of last use. */
+} __attribute__((aligned(64)));
+
+/**
+ * @brief Token bucket.
+ */
+struct meter_bucket {
+  volatile uint64_t tat;        /** Theoretical arrival time. */
+  volatile uint64_t reclaimed;  /** Time of last reclaim. */
+  uint64_t cost;                /** Time per token, fixed point. */
+  uint64_t depth;               /** Bucket depth in time unit. */
+  uint64_t quantum;             /** Credit taken by a share at once. */
+  struct meter_bucket_share shares[METER_BUCKET_SHARES];
+} __attribute__((aligned(64)));
+
+/**
+ * Share index of the calling thread, assigned on first call.
+ */
+extern __thread int meter_bucket_self;
+
+/**
+ * Assign share index to the calling thread.  Slow path of
+ * meter_bucket_share_index().
+ *
+ * @retval      Share index.
+ */
+int meter_bucket_share_assign(void);
+
+/**
+ * Share index of the calling thread.
+ *
+ * @retval      Share index.
+ */
+static inline int
+meter_bucket_share_index(void) {
+  if (likely(meter_bucket_self >= 0)) {
+    return meter_bucket_self;
+  }
+  return meter_bucket_share_assign();
+}
+
+/**
+ * Current time for meter_bucket_take(), in nsec.  TSC is used on
+ * DPDK, CLOCK_MONOTONIC otherwise.
+ *
+ * @retval      Monotonic time in nsec.
+ */
+uint64_t meter_bucket_clock(void);
+
+/**
+ * Set max credit taken by a share at once.  Applied to buckets
+ * configured after the call.
+ *
+ * @param[in]   nsec    Credit in time of the rate, 0 takes the shared
+ *                      bucket per packet.
+ */
+void meter_bucket_quantum_set(uint64_t nsec);
+
+/**
+ * Configure bucket, initially full.
+ *
+ * @param[in]   bucket  Bucket.
+ * @param[in]   rate    Rate in tokens per second, at least 1.
+ * @param[in]   burst   Bucket size in tokens.
+ */
+void meter_bucket_config(struct meter_bucket *bucket,
+                         uint64_t rate, uint64_t burst);
+
+/**
+ * Take tokens from shared bucket and share.  Slow path of
+ * meter_bucket_take().
+ *
+ * @param[in]   bucket  Bucket.
+ * @param[in]   share   Share of the calling thread.
+ * @param[in]   cost    Cost of tokens in time unit.
+ * @param[in]   now     Current time in time unit.
+ *
+ * @retval      true    Tokens are taken.
+ * @retval      false   Bucket is empty.
+ */
+bool meter_bucket_take_slow(struct meter_bucket *bucket,
+                            struct meter_bucket_share *share,
+                            uint64_t cost, uint64_t now);
+
+/**
+ * Take tokens from the bucket.  Called by forwarding threads without
+ * lock.
+ *
+ * @param[in]   bucket  Bucket.
+ * @param[in]   index   Share index of the calling thread.
+ * @param[in]   tokens  Number of tokens.
+ * @param[in]   now     Current time in nsec.
+ *
+ * @retval      true    Tokens are taken, packet conforms to rate.
+ * @retval      false   Bucket is empty, packet exceeds rate.
+ */
+static inline bool
+meter_bucket_take(struct meter_bucket *bucket, int index,
+                  uint32_t tokens, uint64_t now) {
+  struct meter_bucket_share *share;
+  uint64_t cost;
+
+  share = &bucket->shares[index];
+  now <<= METER_BUCKET_TIME_SHIFT;
+  /* split not to overflow with low rate. */
+  cost = (uint64_t)tokens * (bucket->cost >> METER_BUCKET_COST_SHIFT) +
+         (((uint64_t)tokens * (bucket->cost & METER_BUCKET_COST_MASK)) >>
+          METER_BUCKET_COST_SHIFT);
+  if (share->credit >= (int64_t)cost) {
+    if (likely(__sync_sub_and_fetch(&share->credit, (int64_t)cost) >= 0)) {
+      share->used = now;
+      return true;
+    }
+    /* reclaimed meanwhile. */
+    (void)__sync_add_and_fetch(&share->credit, (int64_t)cost);
+  }
+  return meter_bucket_take_slow(bucket, share, cost, now);
+}
+
+#endif /* SRC_DATAPLANE_MGR_METER_BUCKET_H_ */
@@ -0,0 +1,356 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ *      @file   packet_in.c
+ *      @brief  Packet-in events from forwarding threads to the agent.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/queue.h>
+
+#include "lagopus_apis.h"
+#include "lagopus/pbuf.h"
+#include "lagopus/flowdb.h"
+#include "lagopus/bridge.h"
+#include "lagopus/eventq_data.h"
+#include "callback.h"
+#include "counter.h"
+#include "packet_in.h"
+
+#define PACKET_IN_NONE          UINT32_MAX
+
+/**
+ * @brief Event in the pool, followed by packet data buffer.
+ */
+struct packet_in_event {
+  struct eventq_data data;              /** Event, must be first. */
+  struct packet_in_queue *queue;        /** Pool of the event. */
+  uint32_t next;                        /** Next free event. */
+  union {
+    struct match match;
+    uint8_t buf[sizeof(struct match) + sizeof(uint32_t)];
+  } port_match;                         /** IN_PORT match. */
+  union {
+    struct match match;
+    uint8_t buf[sizeof(struct match) + sizeof(uint64_t)];
+  } metadata_match;                     /** METADATA match. */
+  struct pbuf pbuf;                     /** Packet data, must be last. */
+};
+
+#define PACKET_IN_EVENT_SIZE                                            \
+  ((sizeof(struct packet_in_event) + PACKET_IN_DATA_MAX + 63) & ~(size_t)63)
+
+/**
+ * @brief Token bucket.
+ */
+struct packet_in_bucket {
+  volatile int64_t tokens;              /** Available tokens. */
+  volatile uint64_t last;               /** Time of last refill (nsec). */
+  uint64_t interval;                    /** nsec per token, 0 if unlimited. */
+  int64_t burst;                        /** Max tokens. */
+} __attribute__((aligned(64)));
+
+struct packet_in_queue {
+  struct packet_in_bucket buckets[PACKET_IN_REASON_MAX];
+  volatile uint64_t free_head;          /** Tag and index of free list. */
+  volatile int refs;                    /** Bridge and events in use. */
+  uint32_t drop_counter_id;             /** Dropped packet-in. */
+  uint8_t *events;                      /** Events. */
+};
+
+/* events to be put at end of batch, per thread. */
+static __thread struct {
+  bool active;
+  struct bridge *bridge;
+  size_t n;
+  struct eventq_data *data[PACKET_IN_BATCH_MAX];
+} packet_in_batch;
+
+static inline struct packet_in_event *
+packet_in_event_get(struct packet_in_queue *queue, uint32_t idx) {
+  return (struct packet_in_event *)
+         (queue->events + (size_t)idx * PACKET_IN_EVENT_SIZE);
+}
+
+static inline uint32_t
+packet_in_event_index(struct packet_in_queue *queue,
+                      struct packet_in_event *event) {
+  return (uint32_t)((size_t)((uint8_t *)event - queue->events) /
+                    PACKET_IN_EVENT_SIZE);
+}
+
+static inline uint64_t
+packet_in_now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void
+packet_in_queue_release(struct packet_in_queue *queue) {
+  if (__sync_sub_and_fetch(&queue->refs, 1) == 0) {
+    dp_counter_free(queue->drop_counter_id);
+    free(queue->events);
+    free(queue);
+  }
+}
+
+/*
+ * Free list is a stack of event index.  Upper 32bit of the head is
+ * incremented on every update to detect reuse of the index.
+ */
+static struct packet_in_event *
+packet_in_pool_pop(struct packet_in_queue *queue) {
+  struct packet_in_event *event;
+  uint64_t head, new_head;
+  uint32_t idx;
+
+  do {
+    head = queue->free_head;
+    idx = (uint32_t)head;
+    if (idx == PACKET_IN_NONE) {
+      return NULL;
+    }
+    event = packet_in_event_get(queue, idx);
+    new_head = (((head >> 32) + 1) << 32) | event->next;
+  } while (__sync_bool_compare_and_swap(&queue->free_head,
+                                        head, new_head) == false);
+  return event;
+}
+
+static void
+packet_in_pool_push(struct packet_in_queue *queue,
+                    struct packet_in_event *event, uint32_t idx) {
+  uint64_t head, new_head;
+
+  do {
+    head = queue->free_head;
+    event->next = (uint32_t)head;
+    new_head = (((head >> 32) + 1) << 32) | idx;
+  } while (__sync_bool_compare_and_swap(&queue->free_head,
+                                        head, new_head) == false);
+}
+
+static void
+packet_in_event_free(struct eventq_data *data) {
+  struct packet_in_event *event;
+  struct packet_in_queue *queue;
+
+  event = (struct packet_in_event *)data;
+  queue = event->queue;
+  packet_in_pool_push(queue, event, packet_in_event_index(queue, event));
+  packet_in_queue_release(queue);
+}
+
+static bool
+packet_in_bucket_take(struct packet_in_bucket *bucket) {
+  uint64_t now, last, n;
+  int64_t tokens;
+
+  if (bucket->interval == 0) {
+    return true;
+  }
+  now = packet_in_now();
+  last = bucket->last;
+  if (now - last >= bucket->interval) {
+    /* refilled by one of threads seeing the time passed. */
+    n = (now - last) / bucket->interval;
+    if (__sync_bool_compare_and_swap(&bucket->last, last,
+                                     last + n * bucket->interval) == true) {
+      if (n > (uint64_t)bucket->burst) {
+        n = (uint64_t)bucket->burst;
+      }
+      tokens = __sync_add_and_fetch(&bucket->tokens, (int64_t)n);
+      while (tokens > bucket->burst &&
+             __sync_bool_compare_and_swap(&bucket->tokens, tokens,
+                                          bucket->burst) == false) {
+        tokens = bucket->tokens;
+      }
+    }
+  }
+  while ((tokens = bucket->tokens) > 0) {
+    if (__sync_bool_compare_and_swap(&bucket->tokens,
+                                     tokens, tokens - 1) == true) {
+      return true;
+    }
+  }
+  return false;
+}
+
+struct packet_in_queue *
+packet_in_queue_alloc(void) {
+  struct packet_in_queue *queue;
+  struct packet_in_event *event;
+  void *events;
+  uint32_t i;
+
+  if (posix_memalign((void **)&queue, 64, sizeof(*queue)) != 0) {
+    return NULL;
+  }
+  memset(queue, 0, sizeof(*queue));
+  if (posix_memalign(&events, 64,
+                     PACKET_IN_EVENT_SIZE * PACKET_IN_POOL_SIZE) != 0) {
+    free(queue);
+    return NULL;
+  }
+  queue->events = events;
+  queue->free_head = PACKET_IN_NONE;
+  for (i = PACKET_IN_POOL_SIZE; i > 0; i--) {
+    event = packet_in_event_get(queue, i - 1);
+    memset(event, 0, sizeof(*event));
+    event->queue = queue;
+    event->data.type = LAGOPUS_EVENTQ_PACKET_IN;
+    event->data.free = packet_in_event_free;
+    event->pbuf.size = PACKET_IN_DATA_MAX;
+    event->pbuf.refs = 1;
+    packet_in_pool_push(queue, event, i - 1);
+  }
+  for (i = 0; i < PACKET_IN_REASON_MAX; i++) {
+    (void)packet_in_rate_set(queue, (uint8_t)i,
+                             PACKET_IN_RATE_DEFAULT, PACKET_IN_BURST_DEFAULT);
+  }
+  queue->drop_counter_id = dp_counter_alloc();
+  queue->refs = 1;
+  return queue;
+}
+
+void
+packet_in_queue_free(struct packet_in_queue *queue) {
+  if (queue != NULL) {
+    packet_in_queue_release(queue);
+  }
+}
+
+lagopus_result_t
+packet_in_rate_set(struct packet_in_queue *queue, uint8_t reason,
+                   uint32_t rate, uint32_t burst) {
+  struct packet_in_bucket *bucket;
+
+  if (queue == NULL || reason >= PACKET_IN_REASON_MAX) {
+    return LAGOPUS_RESULT_INVALID_ARGS;
+  }
+  bucket = &queue->buckets[reason];
+  if (burst == 0) {
+    burst = 1;
+  }
+  bucket->burst = burst;
+  bucket->tokens = burst;
+  bucket->last = packet_in_now();
+  bucket->interval = (rate == 0) ? 0 : 1000000000ULL / rate;
+  if (rate != 0 && bucket->interval == 0) {
+    bucket->interval = 1;
+  }
+  return LAGOPUS_RESULT_OK;
+}
+
+uint64_t
+packet_in_drops_get(struct packet_in_queue *queue) {
+  struct dp_counter counter;
+
+  if (queue == NULL) {
+    return 0;
+  }
+  dp_counter_get(queue->drop_counter_id, &counter);
+  return counter.packets;
+}
+
+struct eventq_data *
+packet_in_event_alloc(struct packet_in_queue *queue, uint8_t reason,
+                      size_t size) {
+  struct packet_in_event *event;
+
+  if (reason >= PACKET_IN_REASON_MAX ||
+      size > PACKET_IN_DATA_MAX ||
+      (event = packet_in_pool_pop(queue)) == NULL) {
+    dp_counter_add(queue->drop_counter_id, 1, size);
+    return NULL;
+  }
+  /* token is taken after the event, not to be wasted on empty pool. */
+  if (packet_in_bucket_take(&queue->buckets[reason]) == false) {
+    packet_in_pool_push(queue, event, packet_in_event_index(queue, event));
+    dp_counter_add(queue->drop_counter_id, 1, size);
+    return NULL;
+  }
+  (void)__sync_add_and_fetch(&queue->refs, 1);
+  pbuf_reset(&event->pbuf);
+  event->data.packet_in.data = &event->pbuf;
+  TAILQ_INIT(&event->data.packet_in.match_list);
+  return &event->data;
+}
+
+struct match *
+packet_in_event_port_match(struct eventq_data *data) {
+  return &((struct packet_in_event *)data)->port_match.match;
+}
+
+struct match *
+packet_in_event_metadata_match(struct eventq_data *data) {
+  return &((struct packet_in_event *)data)->metadata_match.match;
+}
+
+static void
+packet_in_batch_flush(void) {
+  struct bridge *bridge;
+  size_t i, n_put;
+  lagopus_result_t rv;
+
+  if (packet_in_batch.n == 0) {
+    return;
+  }
+  bridge = packet_in_batch.bridge;
+  rv = dp_dataq_data_put_n(bridge->dpid, packet_in_batch.data,
+                           packet_in_batch.n, &n_put, 0);
+  if (rv != LAGOPUS_RESULT_OK) {
+    lagopus_msg_debug(10, "packet-in dropped: %s\n",
+                      lagopus_error_get_string(rv));
+  }
+  for (i = n_put; i < packet_in_batch.n; i++) {
+    dp_counter_add(bridge->packet_in->drop_counter_id, 1,
+                   pbuf_readable_size(packet_in_batch.data[i]->
+                                      packet_in.data));
+    packet_in_batch.data[i]->free(packet_in_batch.data[i]);
+  }
+  packet_in_batch.n = 0;
+  packet_in_batch.bridge = NULL;
+}
+
+void
+packet_in_event_put(struct bridge *bridge, struct eventq_data *data) {
+  if (packet_in_batch.n > 0 && packet_in_batch.bridge != bridge) {
+    packet_in_batch_flush();
+  }
+  packet_in_batch.bridge = bridge;
+  packet_in_batch.data[packet_in_batch.n++] = data;
+  if (packet_in_batch.active == false ||
+      packet_in_batch.n == PACKET_IN_BATCH_MAX) {
+    packet_in_batch_flush();
+  }
+}
+
+void
+packet_in_batch_begin(void) {
+  packet_in_batch.active = true;
+}
+
+void
+packet_in_batch_end(void) {
+  packet_in_batch_flush();
+  packet_in_batch.active = false;
+}
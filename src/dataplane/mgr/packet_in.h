@@ -0,0 +1,146 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ *      @file   packet_in.h
+ *      @brief  Packet-in events from forwarding threads to the agent.
+ *
+ * Packet-in events of a bridge are taken from a pool allocated with
+ * the bridge, limited per reason by token buckets, and queued to the
+ * agent in batches at the end of each burst.  Forwarding threads never
+ * allocate memory nor wait for the agent.  If the pool, the rate or
+ * the queue is exhausted, the packet-in is dropped and counted.
+ */
+
+#ifndef SRC_DATAPLANE_MGR_PACKET_IN_H_
+#define SRC_DATAPLANE_MGR_PACKET_IN_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lagopus_apis.h"
+#include "openflow.h"
+
+/* number of events of the pool of a bridge. */
+#define PACKET_IN_POOL_SIZE     1024
+
+/* max packet length of an event. */
+#ifdef MAX_PACKET_SZ
+#define PACKET_IN_DATA_MAX      MAX_PACKET_SZ
+#else
+#define PACKET_IN_DATA_MAX      2048
+#endif /* MAX_PACKET_SZ */
+
+/* default rate limit per reason. */
+#define PACKET_IN_RATE_DEFAULT  10000   /* packets per second. */
+#define PACKET_IN_BURST_DEFAULT 1000
+
+/* max number of events queued at once. */
+#define PACKET_IN_BATCH_MAX     64
+
+#define PACKET_IN_REASON_MAX    (OFPR_INVALID_TTL + 1)
+
+struct bridge;
+struct eventq_data;
+struct match;
+struct packet_in_queue;
+
+/**
+ * Allocate packet-in event pool and rate limiters of a bridge.
+ *
+ * @retval      !=NULL  Packet-in queue.
+ * @retval      ==NULL  Memory exhausted.
+ */
+struct packet_in_queue *packet_in_queue_alloc(void);
+
+/**
+ * Free packet-in queue.  Memory is released when all events in the
+ * agent queue are freed.
+ *
+ * @param[in]   queue   Packet-in queue.
+ */
+void packet_in_queue_free(struct packet_in_queue *queue);
+
+/**
+ * Set rate limit of packet-in.
+ *
+ * @param[in]   queue   Packet-in queue.
+ * @param[in]   reason  Packet-in reason.
+ * @param[in]   rate    Packets per second, 0 for unlimited.
+ * @param[in]   burst   Max packets sent at once.
+ *
+ * @retval      LAGOPUS_RESULT_OK               Succeeded.
+ * @retval      LAGOPUS_RESULT_INVALID_ARGS     Invalid reason.
+ */
+lagopus_result_t
+packet_in_rate_set(struct packet_in_queue *queue, uint8_t reason,
+                   uint32_t rate, uint32_t burst);
+
+/**
+ * Get count of dropped packet-in.
+ *
+ * @param[in]   queue   Packet-in queue.
+ *
+ * @retval      Number of dropped packet-in.
+ */
+uint64_t packet_in_drops_get(struct packet_in_queue *queue);
+
+/**
+ * Take an event from the pool if allowed by the rate limit.
+ * Packet data buffer of the event is empty, and match list is
+ * initialized.
+ *
+ * @param[in]   queue   Packet-in queue.
+ * @param[in]   reason  Packet-in reason.
+ * @param[in]   size    Packet length to be sent.
+ *
+ * @retval      !=NULL  Event, freed by data->free().
+ * @retval      ==NULL  Dropped.
+ */
+struct eventq_data *
+packet_in_event_alloc(struct packet_in_queue *queue, uint8_t reason,
+                      size_t size);
+
+/**
+ * Get storage of IN_PORT match of the event.
+ */
+struct match *packet_in_event_port_match(struct eventq_data *data);
+
+/**
+ * Get storage of METADATA match of the event.
+ */
+struct match *packet_in_event_metadata_match(struct eventq_data *data);
+
+/**
+ * Queue the event to the agent.  Events are put at once at
+ * packet_in_batch_end() if called in batch, immediately otherwise.
+ *
+ * @param[in]   bridge  Bridge.
+ * @param[in]   data    Event taken by packet_in_event_alloc().
+ */
+void packet_in_event_put(struct bridge *bridge, struct eventq_data *data);
+
+/**
+ * Start batch of packet-in of the calling thread.
+ */
+void packet_in_batch_begin(void);
+
+/**
+ * Queue packet-in in batch of the calling thread, and end the batch.
+ */
+void packet_in_batch_end(void);
+
+#endif /* SRC_DATAPLANE_MGR_PACKET_IN_H_ */
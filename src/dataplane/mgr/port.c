@@ -30,12 +30,30 @@
 #include "lagopus/dp_apis.h"
 #include "lagopus/interface.h"
 
+/**
+ * Set duration of the port to statistics.
+ */
+static void
+port_stats_duration(const struct port *port, struct ofp_port_stats *ofp) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  ofp->duration_sec = (uint32_t)(ts.tv_sec - port->create_time.tv_sec);
+  if (ts.tv_nsec < port->create_time.tv_nsec) {
+    ofp->duration_sec--;
+    ofp->duration_nsec = 1 * 1000 * 1000 * 1000;
+  } else {
+    ofp->duration_nsec = 0;
+  }
+  ofp->duration_nsec += (uint32_t)ts.tv_nsec;
+  ofp->duration_nsec -= (uint32_t)port->create_time.tv_nsec;
+}
+
 /**
  * no driver version of port_stats().
  */
 static struct port_stats *
 port_stats(struct port *port) {
-  struct timespec ts;
   struct port_stats *stats;
 
   stats = calloc(1, sizeof(struct port_stats));
@@ -56,17 +74,7 @@ port_stats(struct port *port) {
   stats->ofp.rx_over_err = UINT64_MAX;
   stats->ofp.rx_crc_err = UINT64_MAX;
   stats->ofp.collisions = UINT64_MAX;
-
-  clock_gettime(CLOCK_MONOTONIC, &ts);
-  stats->ofp.duration_sec = (uint32_t)(ts.tv_sec - port->create_time.tv_sec);
-  if (ts.tv_nsec < port->create_time.tv_nsec) {
-    stats->ofp.duration_sec--;
-    stats->ofp.duration_nsec = 1 * 1000 * 1000 * 1000;
-  } else {
-    stats->ofp.duration_nsec = 0;
-  }
-  stats->ofp.duration_nsec += (uint32_t)ts.tv_nsec;
-  stats->ofp.duration_nsec -= (uint32_t)port->create_time.tv_nsec;
+  port_stats_duration(port, &stats->ofp);
 
   return stats;
 }
@@ -105,13 +113,39 @@ port_lookup(lagopus_hashmap_t *hm, uint32_t id) {
   return port;
 }
 
+void
+dp_port_stats_publish(struct port *port, const struct ofp_port_stats *stats) {
+  /* odd sequence while the snapshot is being updated. */
+  port->stats_seq++;
+  mbar();
+  memcpy(&port->ofp_port_stats, stats, sizeof(*stats));
+  mbar();
+  port->stats_seq++;
+}
+
+void
+dp_port_stats_snapshot(const struct port *port, struct ofp_port_stats *stats) {
+  uint32_t seq;
+
+  do {
+    seq = port->stats_seq;
+    mbar();
+    memcpy(stats, &port->ofp_port_stats, sizeof(*stats));
+    mbar();
+  } while ((seq & 1) != 0 || seq != port->stats_seq);
+}
+
 static void
 port_add_stats(struct port *port, struct port_stats_list *list) {
   struct port_stats *stats;
 
   if (port->interface != NULL && port->interface->stats != NULL) {
-    stats = port->interface->stats(port);
+    /* counters are collected periodically by dp_stats thread. */
+    stats = calloc(1, sizeof(struct port_stats));
     if (stats != NULL) {
+      dp_port_stats_snapshot(port, &stats->ofp);
+      stats->ofp.port_no = port->ofp_port.port_no;
+      port_stats_duration(port, &stats->ofp);
       TAILQ_INSERT_TAIL(list, stats, entry);
     }
   }
@@ -309,7 +309,7 @@ add_fib_entry(struct fib *fib, struct in_addr dst_ip,
     memcpy(find_entry->src_mac, src_mac, UPDATER_ETH_LEN);
     memcpy(find_entry->dst_mac, dst_mac, UPDATER_ETH_LEN);
   } else {
-    lagopus_msg_error("lagopus hashmap find failed\n");
+    lagopus_msg_error_ratelimited("lagopus hashmap find failed\n");
   }
 
   return rv;
@@ -326,10 +326,10 @@ rewrite_pkt_header(struct lagopus_packet *pkt,
   /* rewrite ether header. (pkt, src hw addr, dst hw addr) */
   rv = lagopus_rewrite_pkt_header(pkt, src, dst);
   if (rv == LAGOPUS_RESULT_STOP) {
-    lagopus_msg_warning("ttl stop\n");
+    lagopus_msg_warning_ratelimited("ttl stop\n");
     lagopus_packet_free(pkt);
   } else if (rv != LAGOPUS_RESULT_OK) {
-    lagopus_msg_warning("failed rewrite ether header.");
+    lagopus_msg_warning_ratelimited("failed rewrite ether header.\n");
     lagopus_packet_free(pkt);
   }
 
@@ -570,7 +570,7 @@ rib_lookup(struct lagopus_packet *pkt) {
     /* get nexthop info from routing table(lpm). */
     rv = rib_route_nexthop_get(rib, &dst_addr, &nexthop, &scope, src_mac);
     if (rv != LAGOPUS_RESULT_OK) {
-      lagopus_msg_info("routing entry is not found.\n");
+      lagopus_msg_info_ratelimited("routing entry is not found.\n");
 #ifdef PIPELINER
       pkt->pipeline_context.error = true;
 #else
@@ -589,7 +589,7 @@ rib_lookup(struct lagopus_packet *pkt) {
     rib_arp_get(rib, &nexthop, dst_mac, &ifindex);
     if (ifindex == -1) {
       /* it is no entry on the arp table, send packet to tap(kernel). */
-      lagopus_msg_info("no entry in arp table. sent to kernel.\n");
+      lagopus_msg_info_ratelimited("no entry in arp table. sent to kernel.\n");
       pkt->send_kernel = true;
       rv = LAGOPUS_RESULT_OK;
       goto out;
@@ -605,7 +605,7 @@ rib_lookup(struct lagopus_packet *pkt) {
     add_fib_entry(fib, dst_addr,
                   src_mac, dst_mac, pkt->output_port);
   } else {
-    lagopus_msg_warning("hashmap error.\n");
+    lagopus_msg_warning_ratelimited("hashmap error.\n");
   }
 
 out:
@@ -0,0 +1,53 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ *      @file   sock_ethtool.c
+ *      @brief  ethtool queries for raw socket interfaces.
+ *
+ * linux/ethtool.h is kept out of sock_io.c, since its definitions
+ * collide with the dataplane packet headers.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <net/if.h>
+
+#include <linux/ethtool.h>
+#include <linux/sockios.h>
+
+#include "sock_ethtool.h"
+
+uint32_t
+rawsock_ethtool_rx_queues(int fd, const char *device) {
+  struct ethtool_channels channels;
+  struct ifreq ifreq;
+  uint32_t n;
+
+  memset(&channels, 0, sizeof(channels));
+  channels.cmd = ETHTOOL_GCHANNELS;
+  memset(&ifreq, 0, sizeof(ifreq));
+  snprintf(ifreq.ifr_name, sizeof(ifreq.ifr_name), "%s", device);
+  ifreq.ifr_data = (void *)&channels;
+  if (ioctl(fd, SIOCETHTOOL, &ifreq) != 0) {
+    return 1;
+  }
+  n = channels.rx_count + channels.combined_count;
+  return (n != 0) ? n : 1;
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ *      @file   sock_ethtool.h
+ *      @brief  ethtool queries for raw socket interfaces.
+ */
+
+#ifndef SRC_DATAPLANE_MGR_SOCK_ETHTOOL_H_
+#define SRC_DATAPLANE_MGR_SOCK_ETHTOOL_H_
+
+/**
+ * Get number of RX queues of the device.
+ *
+ * @param[in]   fd      Socket to issue SIOCETHTOOL.
+ * @param[in]   device  Device name.
+ *
+ * @retval      Number of RX queues, 1 if unknown.
+ */
+uint32_t rawsock_ethtool_rx_queues(int fd, const char *device);
+
+#endif /* SRC_DATAPLANE_MGR_SOCK_ETHTOOL_H_ */
@@ -38,6 +38,7 @@
 #include <linux/if_link.h>
 #include <linux/netlink.h>
 #include <linux/rtnetlink.h>
+#include <linux/sockios.h>
 
 #include "lagopus/dp_apis.h"
 #include "lagopus/flowdb.h"
@@ -52,7 +53,13 @@
 #include "csum.h"
 #include "thread.h"
 #include "lock.h"
+#include "counter.h"
+#include "meter_bucket.h"
+#include "packet_in.h"
 #include "sock_io.h"
+#include "sock_ethtool.h"
+#include "sock_ring.h"
+#include "sock_xdp.h"
 
 #ifdef HAVE_DPDK
 #include "dpdk.h"
@@ -62,15 +69,46 @@ static struct port_stats *rawsock_port_stats(struct port *port);
 
 #define NUM_PORTID 256
 
-static struct pollfd pollfd[NUM_PORTID];
+/**
+ * Raw socket worker.  Each worker has its own socket per interface,
+ * sockets of the same interface are joined to one PACKET_FANOUT group
+ * so that the kernel distributes flows among workers.
+ */
+struct rawsock_worker {
+  unsigned int id;
+  struct pollfd pollfd[NUM_PORTID];
+  struct rawsock_ring *rings[NUM_PORTID];
+  struct afxdp_socket *xsks[NUM_PORTID];
+  struct flowcache *flowcache;
+  bool volatile clear_cache;
+  struct rawsock_worker_stats stats;
+
+  lagopus_thread_t thread;
+  lagopus_mutex_t lock;
+  bool running;
+  struct dataplane_arg dparg;
+};
+
+static struct rawsock_worker workers[RAWSOCK_MAX_WORKERS];
+static unsigned int nb_workers = 1;
+
 static int ifindex[NUM_PORTID];
 
+/* devices using PACKET_MMAP ring, comma separated or "all". */
+static char *ring_devices = NULL;
+
+/* XDP program attached to ethernet-afxdp interface. */
+static struct afxdp_prog *xdp_progs[NUM_PORTID];
+
+/* force generic XDP mode, e.g. for veth. */
+static bool afxdp_generic = false;
+
+/* worker running on this thread, NULL if not a rawsock worker. */
+static __thread struct rawsock_worker *cur_worker = NULL;
+
 static bool no_cache = true;
-static int kvs_type = FLOWCACHE_HASHMAP_NOLOCK;
+static int kvs_type = FLOWCACHE_CUCKOO;
 static int hashtype = HASH_TYPE_INTEL64;
-static struct flowcache *flowcache;
-
-static bool volatile clear_cache = false;
 
 static int portidx = 0;
 
@@ -111,7 +149,6 @@ read_packet(int fd, uint8_t *buf, size_t buflen) {
   struct tpacket_auxdata *auxdata;
   uint16_t *p;
   ssize_t pktlen;
-  uint16_t ether_type;
 
   iov.iov_base = buf;
   iov.iov_len = buflen;
@@ -149,34 +186,71 @@ read_packet(int fd, uint8_t *buf, size_t buflen) {
     }
 #endif /* TP_STATUS_VLAN_VALID */
     p = (uint16_t *)(buf + ETHER_ADDR_LEN * 2);
-    switch (OS_NTOHS(p[0])) {
-      case ETHERTYPE_PBB:
-      case ETHERTYPE_VLAN:
-        ether_type = 0x88a8;
-        break;
-      default:
-        ether_type = ETHERTYPE_VLAN;
-        break;
-    }
     memmove(&p[2], p, pktlen - ETHER_ADDR_LEN * 2);
-    p[0] = OS_HTONS(ether_type);
+#if defined (TP_STATUS_VLAN_TPID_VALID)
+    p[0] = OS_HTONS(rawsock_vlan_tpid(auxdata->tp_status,
+                                      auxdata->tp_vlan_tpid, buf));
+#else
+    p[0] = OS_HTONS(rawsock_vlan_tpid(auxdata->tp_status, 0, buf));
+#endif /* TP_STATUS_VLAN_TPID_VALID */
     p[1] = OS_HTONS(auxdata->tp_vlan_tci);
     pktlen += 4;
   }
   return pktlen;
 }
 
+/**
+ * Check whether the device is listed in --rawsock-ring option.
+ */
+static bool
+rawsock_ring_selected(const char *device) {
+  const char *p;
+  size_t len;
+
+  if (ring_devices == NULL) {
+    return false;
+  }
+  if (!strcmp(ring_devices, "all")) {
+    return true;
+  }
+  len = strlen(device);
+  for (p = ring_devices; *p != '\0'; p += strcspn(p, ",")) {
+    if (*p == ',') {
+      p++;
+    }
+    if (!strncmp(p, device, len) && (p[len] == ',' || p[len] == '\0')) {
+      return true;
+    }
+  }
+  return false;
+}
+
 lagopus_result_t
 rawsock_rx_burst(struct interface *ifp, void *mbufs[], size_t nb) {
   lagopus_result_t i;
+  uint32_t portid;
 
+  portid = ifp->info.eth_rawsock.port_number;
+  if (workers[0].rings[portid] != NULL) {
+    struct lagopus_packet *pkts[RAWSOCK_RING_RX_BURST];
+    size_t n;
+
+    if (nb > RAWSOCK_RING_RX_BURST) {
+      nb = RAWSOCK_RING_RX_BURST;
+    }
+    n = rawsock_ring_rx_burst(workers[0].rings[portid], pkts, nb);
+    for (i = 0; i < (lagopus_result_t)n; i++) {
+      mbufs[i] = PKT2MBUF(pkts[i]);
+    }
+    return i;
+  }
   for (i = 0; i < nb; i++) {
     struct lagopus_packet *pkt;
     ssize_t len;
 
     pkt = alloc_lagopus_packet();
     mbufs[i] = PKT2MBUF(pkt);
-    len = read_packet(pollfd[ifp->info.eth_rawsock.port_number].fd,
+    len = read_packet(workers[0].pollfd[portid].fd,
                       OS_MTOD((OS_MBUF *)mbufs[i], uint8_t *), MAX_PACKET_SZ);
     if (len < 0) {
       switch (errno) {
@@ -211,6 +285,11 @@ rawsock_dataplane_init(int argc, const char *const argv[]) {
     {"no-cache", 0, 0, 0},
     {"kvstype", 1, 0, 0},
     {"hashtype", 1, 0, 0},
+    {"rawsock-ring", 1, 0, 0},
+    {"rawsock-workers", 1, 0, 0},
+    {"afxdp-generic", 0, 0, 0},
+    {"port-stats-interval", 1, 0, 0},
+    {"meter-quantum", 1, 0, 0},
     {NULL, 0, 0, 0}
   };
   int opt, optind;
@@ -222,7 +301,9 @@ rawsock_dataplane_init(int argc, const char *const argv[]) {
           no_cache = true;
         }
         if (!strcmp(lgopts[optind].name, "kvstype")) {
-          if (!strcmp(optarg, "hashmap_nolock")) {
+          if (!strcmp(optarg, "cuckoo")) {
+            kvs_type = FLOWCACHE_CUCKOO;
+          } else if (!strcmp(optarg, "hashmap_nolock")) {
             kvs_type = FLOWCACHE_HASHMAP_NOLOCK;
           } else if (!strcmp(optarg, "hashmap")) {
             kvs_type = FLOWCACHE_HASHMAP;
@@ -241,6 +322,46 @@ rawsock_dataplane_init(int argc, const char *const argv[]) {
             return -1;
           }
         }
+        if (!strcmp(lgopts[optind].name, "rawsock-ring")) {
+          free(ring_devices);
+          ring_devices = strdup(optarg);
+          if (ring_devices == NULL) {
+            return -1;
+          }
+        }
+        if (!strcmp(lgopts[optind].name, "rawsock-workers")) {
+          char *end;
+          unsigned long n;
+
+          n = strtoul(optarg, &end, 10);
+          if (*end != '\0' || n == 0 || n > RAWSOCK_MAX_WORKERS) {
+            return -1;
+          }
+          nb_workers = (unsigned int)n;
+        }
+        if (!strcmp(lgopts[optind].name, "afxdp-generic")) {
+          afxdp_generic = true;
+        }
+        if (!strcmp(lgopts[optind].name, "port-stats-interval")) {
+          char *end;
+          unsigned long n;
+
+          n = strtoul(optarg, &end, 10);
+          if (*end != '\0' || n == 0 || n > UINT32_MAX) {
+            return -1;
+          }
+          (void)dp_stats_interval_set((unsigned int)n);
+        }
+        if (!strcmp(lgopts[optind].name, "meter-quantum")) {
+          char *end;
+          unsigned long n;
+
+          n = strtoul(optarg, &end, 10);
+          if (*end != '\0') {
+            return -1;
+          }
+          meter_bucket_quantum_set((uint64_t)n * 1000);
+        }
         break;
     }
   }
@@ -248,6 +369,98 @@ rawsock_dataplane_init(int argc, const char *const argv[]) {
 }
 #endif /* !HAVE_DPDK */
 
+/**
+ * Setup PACKET_MMAP ring if the interface is selected.
+ * It must be called before bind.
+ */
+static struct rawsock_ring *
+rawsock_setup_ring(int fd, struct interface *ifp) {
+  struct rawsock_ring *ring;
+
+  if (rawsock_ring_selected(ifp->info.eth_rawsock.device) == false) {
+    return NULL;
+  }
+  ring = rawsock_ring_create(fd);
+  if (ring == NULL) {
+    lagopus_msg_warning("%s: PACKET_MMAP ring is not available, "
+                        "fallback to normal socket\n",
+                        ifp->info.eth_rawsock.device);
+  }
+  return ring;
+}
+
+static lagopus_result_t
+rawsock_join_fanout(int fd, uint32_t portid) {
+  int arg;
+
+  /* fanout group id is unique per network namespace. */
+  arg = (ifindex[portid] & 0xffff) | (PACKET_FANOUT_HASH << 16);
+  if (setsockopt(fd, SOL_PACKET, PACKET_FANOUT, &arg, sizeof(arg)) != 0) {
+    return LAGOPUS_RESULT_POSIX_API_ERROR;
+  }
+  return LAGOPUS_RESULT_OK;
+}
+
+/**
+ * Open sockets for worker 1..N-1 and join all sockets of the interface
+ * to the PACKET_FANOUT_HASH group.
+ */
+static lagopus_result_t
+rawsock_open_fanout(struct interface *ifp, uint32_t portid) {
+  struct sockaddr_ll sll;
+  unsigned int i;
+  int fd, on;
+
+  if (rawsock_join_fanout(workers[0].pollfd[portid].fd,
+                          portid) != LAGOPUS_RESULT_OK) {
+    lagopus_msg_error("%s: PACKET_FANOUT: %s\n",
+                      ifp->info.eth_rawsock.device, strerror(errno));
+    return LAGOPUS_RESULT_POSIX_API_ERROR;
+  }
+  memset(&sll, 0, sizeof(sll));
+  sll.sll_family = AF_PACKET;
+  sll.sll_protocol = htons(ETH_P_ALL);
+  sll.sll_ifindex = ifindex[portid];
+  for (i = 1; i < nb_workers; i++) {
+    fd = socket(PF_PACKET, SOCK_RAW | SOCK_NONBLOCK, htons(ETH_P_ALL));
+    if (fd == -1) {
+      lagopus_msg_error("%s: %s\n",
+                        ifp->info.eth_rawsock.device, strerror(errno));
+      return LAGOPUS_RESULT_POSIX_API_ERROR;
+    }
+    on = 1;
+    (void)setsockopt(fd, SOL_PACKET, PACKET_AUXDATA, &on, sizeof(on));
+    workers[i].rings[portid] = rawsock_setup_ring(fd, ifp);
+    workers[i].pollfd[portid].fd = fd;
+    workers[i].pollfd[portid].events = 0;
+    if (bind(fd, (struct sockaddr *)&sll, sizeof(sll)) != 0 ||
+        rawsock_join_fanout(fd, portid) != LAGOPUS_RESULT_OK) {
+      lagopus_msg_error("%s: worker %u: %s\n",
+                        ifp->info.eth_rawsock.device, i, strerror(errno));
+      return LAGOPUS_RESULT_POSIX_API_ERROR;
+    }
+  }
+  return LAGOPUS_RESULT_OK;
+}
+
+/**
+ * Close sockets and rings of all workers for the port.
+ */
+static void
+rawsock_close_sockets(uint32_t portid) {
+  unsigned int i;
+
+  for (i = 0; i < nb_workers; i++) {
+    workers[i].pollfd[portid].events = 0;
+    rawsock_ring_destroy(workers[i].rings[portid]);
+    workers[i].rings[portid] = NULL;
+    if (workers[i].pollfd[portid].fd > 0) {
+      close(workers[i].pollfd[portid].fd);
+    }
+    workers[i].pollfd[portid].fd = -1;
+  }
+}
+
 lagopus_result_t
 rawsock_configure_interface(struct interface *ifp) {
   struct nlreq {
@@ -302,6 +515,7 @@ rawsock_configure_interface(struct interface *ifp) {
   }
   lagopus_msg_info("Configuring %s, ifindex %d\n",
                    ifp->info.eth_rawsock.device, ifindex[portid]);
+  workers[0].rings[portid] = rawsock_setup_ring(fd, ifp);
   sll.sll_family = AF_PACKET;
   sll.sll_protocol = htons(ETH_P_ALL);
   sll.sll_ifindex = ifindex[portid];
@@ -343,8 +557,18 @@ rawsock_configure_interface(struct interface *ifp) {
     return LAGOPUS_RESULT_POSIX_API_ERROR;
   }
 
-  pollfd[portid].fd = fd;
-  pollfd[portid].events = 0;
+  workers[0].pollfd[portid].fd = fd;
+  workers[0].pollfd[portid].events = 0;
+  if (nb_workers > 1) {
+    lagopus_result_t rv;
+
+    rv = rawsock_open_fanout(ifp, portid);
+    if (rv != LAGOPUS_RESULT_OK) {
+      rawsock_close_sockets(portid);
+      put_port_number((int)portid);
+      return rv;
+    }
+  }
   ifp->stats = rawsock_port_stats;
 
   return LAGOPUS_RESULT_OK;
@@ -355,9 +579,7 @@ rawsock_unconfigure_interface(struct interface *ifp) {
   uint32_t portid;
 
   portid = ifp->info.eth_rawsock.port_number;
-  pollfd[portid].events = 0;
-  close(pollfd[portid].fd);
-  pollfd[portid].fd = -1;
+  rawsock_close_sockets(portid);
   ifindex[portid] = 0;
   put_port_number(portid);
 
@@ -367,18 +589,24 @@ rawsock_unconfigure_interface(struct interface *ifp) {
 lagopus_result_t
 rawsock_start_interface(struct interface *ifp) {
   uint32_t portid;
+  unsigned int i;
 
   portid = ifp->info.eth_rawsock.port_number;
-  pollfd[portid].events = POLLIN;
+  for (i = 0; i < nb_workers; i++) {
+    workers[i].pollfd[portid].events = POLLIN;
+  }
   return LAGOPUS_RESULT_OK;
 }
 
 lagopus_result_t
 rawsock_stop_interface(struct interface *ifp) {
   uint32_t portid;
+  unsigned int i;
 
   portid = ifp->info.eth_rawsock.port_number;
-  pollfd[portid].events = 0;
+  for (i = 0; i < nb_workers; i++) {
+    workers[i].pollfd[portid].events = 0;
+  }
   return LAGOPUS_RESULT_OK;
 }
 
@@ -389,7 +617,7 @@ rawsock_get_hwaddr(struct interface *ifp, uint8_t *hw_addr) {
   int fd;
 
   portid = ifp->info.eth_rawsock.port_number;
-  fd = pollfd[portid].fd;
+  fd = workers[0].pollfd[portid].fd;
   snprintf(ifreq.ifr_name, sizeof(ifreq.ifr_name),
            "%s", ifp->info.eth_rawsock.device);
   if (ioctl(fd, SIOCGIFHWADDR, &ifreq) != 0) {
@@ -400,32 +628,282 @@ rawsock_get_hwaddr(struct interface *ifp, uint8_t *hw_addr) {
   return LAGOPUS_RESULT_OK;
 }
 
+/**
+ * Pad short frame and update checksums before transmit.
+ */
+static inline OS_MBUF *
+rawsock_prepare_tx(struct lagopus_packet *pkt) {
+  OS_MBUF *m;
+  size_t plen;
+
+  m = PKT2MBUF(pkt);
+  plen = OS_M_PKTLEN(m);
+  if (plen < 60) {
+    memset(OS_M_APPEND(m, 60 - plen), 0, (uint32_t)(60 - plen));
+  }
+  if ((pkt->flags & PKT_FLAG_RECALC_CKSUM_MASK) != 0) {
+    if (pkt->ether_type == ETHERTYPE_IP) {
+      lagopus_update_ipv4_checksum(pkt);
+    } else if (pkt->ether_type == ETHERTYPE_IPV6) {
+      lagopus_update_ipv6_checksum(pkt);
+    }
+  }
+  return m;
+}
+
 int
 rawsock_send_packet_physical(struct lagopus_packet *pkt, uint32_t portid) {
-  if (pollfd[portid].fd != 0) {
+  struct rawsock_worker *w;
+  lagopus_result_t rv;
+
+  /* send from the socket of own worker, to keep TX ring uncontended. */
+  w = (cur_worker != NULL) ? cur_worker : &workers[0];
+  if (w->pollfd[portid].fd > 0) {
     OS_MBUF *m;
-    size_t plen;
-
-    m = PKT2MBUF(pkt);
-    plen = OS_M_PKTLEN(m);
-    if (plen < 60) {
-      memset(OS_M_APPEND(m, 60 - plen), 0, (uint32_t)(60 - plen));
-    }
-    if ((pkt->flags & PKT_FLAG_RECALC_CKSUM_MASK) != 0) {
-      if (pkt->ether_type == ETHERTYPE_IP) {
-        lagopus_update_ipv4_checksum(pkt);
-      } else if (pkt->ether_type == ETHERTYPE_IPV6) {
-        lagopus_update_ipv6_checksum(pkt);
+
+    m = rawsock_prepare_tx(pkt);
+    if (w->rings[portid] != NULL) {
+      rv = rawsock_ring_tx_enqueue(w->rings[portid],
+                                   OS_MTOD(m, uint8_t *),
+                                   OS_M_PKTLEN(m));
+      /* rawsock thread kicks TX rings at the end of each round. */
+      if (cur_worker == NULL) {
+        rawsock_ring_tx_flush(w->rings[portid]);
       }
-    }
-    (void)write(pollfd[portid].fd,
+    } else {
+      if (write(w->pollfd[portid].fd,
                 OS_MTOD(m, char *),
-                OS_M_PKTLEN(m));
+                OS_M_PKTLEN(m)) < 0) {
+        rv = LAGOPUS_RESULT_POSIX_API_ERROR;
+      } else {
+        rv = LAGOPUS_RESULT_OK;
+      }
+    }
+    if (cur_worker != NULL) {
+      if (rv == LAGOPUS_RESULT_OK) {
+        cur_worker->stats.tx_packets++;
+      } else {
+        cur_worker->stats.tx_dropped++;
+      }
+    }
   }
   lagopus_packet_free(pkt);
   return 0;
 }
 
+/**
+ * Detach XDP program and close AF_XDP sockets of all workers for the port.
+ */
+static void
+afxdp_close_sockets(uint32_t portid) {
+  unsigned int i;
+
+  afxdp_prog_detach(xdp_progs[portid]);
+  xdp_progs[portid] = NULL;
+  for (i = 0; i < nb_workers; i++) {
+    workers[i].pollfd[portid].events = 0;
+    workers[i].pollfd[portid].fd = -1;
+    afxdp_socket_destroy(workers[i].xsks[portid]);
+    workers[i].xsks[portid] = NULL;
+  }
+}
+
+lagopus_result_t
+afxdp_configure_interface(struct interface *ifp) {
+  struct afxdp_socket *xsk;
+  struct ifreq ifreq;
+  const char *device;
+  uint32_t portid, nqueues;
+  unsigned int i;
+  lagopus_result_t rv;
+  int fd;
+
+  device = ifp->info.eth_afxdp.device;
+  /* AF_XDP socket does not handle interface ioctl. */
+  fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd == -1) {
+    lagopus_msg_error("%s: %s\n", device, strerror(errno));
+    return LAGOPUS_RESULT_POSIX_API_ERROR;
+  }
+  memset(&ifreq, 0, sizeof(ifreq));
+  snprintf(ifreq.ifr_name, sizeof(ifreq.ifr_name), "%s", device);
+  if (ioctl(fd, SIOCGIFINDEX, &ifreq) != 0) {
+    close(fd);
+    lagopus_msg_warning("%s: %s\n", device, strerror(errno));
+    return LAGOPUS_RESULT_POSIX_API_ERROR;
+  }
+  portid = get_port_number();
+  if (portid == UINT32_MAX) {
+    close(fd);
+    lagopus_msg_error("%s: too many port opened\n", device);
+    return LAGOPUS_RESULT_TOO_MANY_OBJECTS;
+  }
+  ifp->info.eth_afxdp.port_number = portid;
+  ifindex[portid] = ifreq.ifr_ifindex;
+  if (ioctl(fd, SIOCGIFHWADDR, &ifreq) != 0) {
+    lagopus_msg_warning("%s: %s\n", device, strerror(errno));
+  } else {
+    memcpy(ifp->hw_addr, ifreq.ifr_hwaddr.sa_data, ETHER_ADDR_LEN);
+  }
+  if (ifp->info.eth_afxdp.mtu != 0) {
+    ifreq.ifr_mtu = ifp->info.eth_afxdp.mtu;
+    if (ioctl(fd, SIOCSIFMTU, &ifreq) != 0) {
+      lagopus_msg_warning("%s: MTU: %s\n", device, strerror(errno));
+    }
+  }
+  /* set promiscous mode */
+  if (ioctl(fd, SIOCGIFFLAGS, &ifreq) == 0) {
+    ifreq.ifr_flags |= IFF_PROMISC;
+    (void)ioctl(fd, SIOCSIFFLAGS, &ifreq);
+  }
+  nqueues = rawsock_ethtool_rx_queues(fd, device);
+  close(fd);
+  lagopus_msg_info("Configuring %s, ifindex %d, %u queues\n",
+                   device, ifindex[portid], nqueues);
+
+  xdp_progs[portid] = afxdp_prog_attach(ifindex[portid], afxdp_generic);
+  if (xdp_progs[portid] == NULL) {
+    rv = LAGOPUS_RESULT_POSIX_API_ERROR;
+    goto fail;
+  }
+  /* worker i serves RX queue i. */
+  for (i = 0; i < nb_workers && i < nqueues; i++) {
+    xsk = afxdp_socket_create(ifindex[portid], i,
+                              !afxdp_prog_is_generic(xdp_progs[portid]));
+    if (xsk == NULL) {
+      rv = LAGOPUS_RESULT_POSIX_API_ERROR;
+      goto fail;
+    }
+    workers[i].xsks[portid] = xsk;
+    workers[i].pollfd[portid].fd = afxdp_socket_fd(xsk);
+    workers[i].pollfd[portid].events = 0;
+    rv = afxdp_prog_register(xdp_progs[portid], i, xsk);
+    if (rv != LAGOPUS_RESULT_OK) {
+      lagopus_msg_error("%s: XSKMAP queue %u: %s\n",
+                        device, i, strerror(errno));
+      goto fail;
+    }
+  }
+  if (nqueues > nb_workers) {
+    lagopus_msg_warning("%s: %u of %u RX queues are passed to the kernel, "
+                        "reduce channels or add workers\n",
+                        device, nqueues - nb_workers, nqueues);
+  }
+  ifp->stats = rawsock_port_stats;
+
+  return LAGOPUS_RESULT_OK;
+
+fail:
+  afxdp_close_sockets(portid);
+  ifindex[portid] = 0;
+  put_port_number((int)portid);
+  return rv;
+}
+
+lagopus_result_t
+afxdp_unconfigure_interface(struct interface *ifp) {
+  uint32_t portid;
+
+  portid = ifp->info.eth_afxdp.port_number;
+  afxdp_close_sockets(portid);
+  ifindex[portid] = 0;
+  put_port_number((int)portid);
+
+  return LAGOPUS_RESULT_OK;
+}
+
+lagopus_result_t
+afxdp_get_hwaddr(struct interface *ifp, uint8_t *hw_addr) {
+  struct ifreq ifreq;
+  int fd;
+
+  fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd == -1) {
+    return LAGOPUS_RESULT_POSIX_API_ERROR;
+  }
+  snprintf(ifreq.ifr_name, sizeof(ifreq.ifr_name),
+           "%s", ifp->info.eth_afxdp.device);
+  if (ioctl(fd, SIOCGIFHWADDR, &ifreq) != 0) {
+    close(fd);
+    lagopus_msg_warning("%s\n", strerror(errno));
+    return LAGOPUS_RESULT_ANY_FAILURES;
+  }
+  close(fd);
+  memcpy(hw_addr, ifreq.ifr_hwaddr.sa_data, ETHER_ADDR_LEN);
+  return LAGOPUS_RESULT_OK;
+}
+
+lagopus_result_t
+afxdp_rx_burst(struct interface *ifp, void *mbufs[], size_t nb) {
+  struct lagopus_packet *pkts[AFXDP_RX_BURST];
+  struct afxdp_socket *xsk;
+  size_t i, n;
+
+  xsk = workers[0].xsks[ifp->info.eth_afxdp.port_number];
+  if (xsk == NULL) {
+    return 0;
+  }
+  if (nb > AFXDP_RX_BURST) {
+    nb = AFXDP_RX_BURST;
+  }
+  n = afxdp_socket_rx_burst(xsk, pkts, nb);
+  for (i = 0; i < n; i++) {
+    mbufs[i] = PKT2MBUF(pkts[i]);
+  }
+  return (lagopus_result_t)n;
+}
+
+int
+afxdp_send_packet_physical(struct lagopus_packet *pkt, uint32_t portid) {
+  struct afxdp_socket *xsk;
+  lagopus_result_t rv;
+  OS_MBUF *m;
+
+  /* worker without own queue shares the socket of worker 0. */
+  xsk = NULL;
+  if (cur_worker != NULL) {
+    xsk = cur_worker->xsks[portid];
+  }
+  if (xsk == NULL) {
+    xsk = workers[0].xsks[portid];
+  }
+  if (xsk != NULL) {
+    m = rawsock_prepare_tx(pkt);
+    rv = afxdp_socket_tx_enqueue(xsk, OS_MTOD(m, uint8_t *),
+                                 OS_M_PKTLEN(m));
+    /* own TX ring is kicked at the end of each round. */
+    if (cur_worker == NULL || xsk != cur_worker->xsks[portid]) {
+      afxdp_socket_tx_flush(xsk);
+    }
+    if (cur_worker != NULL) {
+      if (rv == LAGOPUS_RESULT_OK) {
+        cur_worker->stats.tx_packets++;
+      } else {
+        cur_worker->stats.tx_dropped++;
+      }
+    }
+  }
+  lagopus_packet_free(pkt);
+  return 0;
+}
+
+/**
+ * Sum frames dropped by full TX rings of all workers for the port.
+ */
+static uint64_t
+rawsock_ring_tx_dropped_sum(uint32_t portid) {
+  uint64_t dropped;
+  unsigned int i;
+
+  dropped = 0;
+  for (i = 0; i < nb_workers; i++) {
+    if (workers[i].rings[portid] != NULL) {
+      dropped += rawsock_ring_tx_dropped(workers[i].rings[portid]);
+    }
+  }
+  return dropped;
+}
+
 static struct port_stats *
 rawsock_port_stats(struct port *port) {
   struct {
@@ -455,7 +933,7 @@ rawsock_port_stats(struct port *port) {
     return NULL;
   }
 
-  if (pollfd[port->ifindex].fd == -1) {
+  if (workers[0].pollfd[port->ifindex].fd == -1) {
     return LAGOPUS_RESULT_OK;
   }
   fd = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK, NETLINK_ROUTE);
@@ -535,7 +1013,8 @@ found:
     stats->ofp.rx_bytes = link_stats->rx_bytes;
     stats->ofp.tx_bytes = link_stats->tx_bytes;
     stats->ofp.rx_dropped = link_stats->rx_dropped;
-    stats->ofp.tx_dropped = link_stats->tx_dropped;
+    stats->ofp.tx_dropped = link_stats->tx_dropped +
+                            rawsock_ring_tx_dropped_sum(port->ifindex);
     stats->ofp.rx_errors = link_stats->rx_errors;
     stats->ofp.tx_errors = link_stats->tx_errors;
     stats->ofp.rx_frame_err = link_stats->rx_frame_errors;
@@ -554,7 +1033,6 @@ found:
   }
   stats->ofp.duration_nsec += (uint32_t)ts.tv_nsec;
   stats->ofp.duration_nsec -= (uint32_t)port->create_time.tv_nsec;
-  OS_MEMCPY(&port->ofp_port_stats, &stats->ofp, sizeof(stats->ofp));
 
   return stats;
 }
@@ -581,7 +1059,7 @@ rawsock_get_stats(struct interface *ifp, datastore_interface_stats_t *stats) {
   int fd;
 
   link_stats = NULL;
-  if (pollfd[ifp->info.eth_rawsock.port_number].fd == -1) {
+  if (workers[0].pollfd[ifp->info.eth_rawsock.port_number].fd == -1) {
     return LAGOPUS_RESULT_OK;
   }
   fd = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK, NETLINK_ROUTE);
@@ -642,7 +1120,8 @@ found:
     stats->tx_packets = link_stats->tx_packets;
     stats->tx_bytes = link_stats->tx_bytes;
     stats->rx_errors = link_stats->rx_errors;
-    stats->tx_dropped = link_stats->tx_dropped;
+    stats->tx_dropped = link_stats->tx_dropped +
+      rawsock_ring_tx_dropped_sum(ifp->info.eth_rawsock.port_number);
     stats->tx_errors = link_stats->tx_errors;
   }
 
@@ -669,24 +1148,101 @@ rawsock_change_config(struct interface *ifp,
 
 void
 clear_rawsock_flowcache(void) {
-  clear_cache = true;
+  unsigned int i;
+
+  for (i = 0; i < nb_workers; i++) {
+    workers[i].clear_cache = true;
+  }
+}
+
+void
+rawsock_get_flowcache_statistics(struct ofcachestat *st) {
+  struct ofcachestat s;
+  unsigned int i;
+
+  st->nentries = 0;
+  st->hit = 0;
+  st->miss = 0;
+  st->invalidated = 0;
+  for (i = 0; i < nb_workers; i++) {
+    if (workers[i].flowcache == NULL) {
+      continue;
+    }
+    get_flowcache_statistics(workers[i].flowcache, &s);
+    st->nentries += s.nentries;
+    st->hit += s.hit;
+    st->miss += s.miss;
+    st->invalidated += s.invalidated;
+  }
+}
+
+unsigned int
+rawsock_worker_count(void) {
+  return nb_workers;
+}
+
+lagopus_result_t
+rawsock_get_worker_stats(unsigned int id,
+                         struct rawsock_worker_stats *stats) {
+  if (id >= nb_workers || stats == NULL) {
+    return LAGOPUS_RESULT_INVALID_ARGS;
+  }
+  *stats = workers[id].stats;
+  return LAGOPUS_RESULT_OK;
+}
+
+/**
+ * Process one received packet.
+ * flowdb read lock must be held by the caller.
+ *
+ * @param[in]   w       Worker.
+ * @param[in]   pkt     Received packet.
+ * @param[in]   port    Ingress port.
+ */
+static inline void
+rawsock_process_packet(struct rawsock_worker *w,
+                       struct lagopus_packet *pkt, struct port *port) {
+  static const uint8_t eth_bcast[] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+  enum switch_mode mode;
+
+  w->stats.rx_packets++;
+  w->stats.rx_bytes += OS_M_PKTLEN(PKT2MBUF(pkt));
+  pkt->cache = w->flowcache;
+  lagopus_packet_init(pkt, PKT2MBUF(pkt), port);
+  flowdb_switch_mode_get(port->bridge->flowdb, &mode);
+  if (
+#ifdef HYBRID
+          !memcmp(OS_MTOD(PKT2MBUF(pkt), uint8_t *),
+                  port->interface->hw_addr, ETHER_ADDR_LEN) ||
+          !memcmp(OS_MTOD(PKT2MBUF(pkt), uint8_t *),
+                  eth_bcast, ETHER_ADDR_LEN) ||
+#endif /* HYBRID */
+          mode == SWITCH_MODE_STANDALONE) {
+    lagopus_forward_packet_to_port(pkt, OFPP_NORMAL);
+  } else {
+    lagopus_match_and_action(pkt);
+  }
 }
 
 /**
  * Raw socket I/O process function.
  *
  * @param[in]   t       Thread object pointer.
- * @param[in]   arg     Do not used argument.
+ * @param[in]   arg     Dataplane argument embedded in the worker.
  */
 static lagopus_result_t
 dp_rawsock_thread_loop(__UNUSED const lagopus_thread_t *selfptr,
                     void *arg) {
-  static const uint8_t eth_bcast[] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
   struct lagopus_packet *pkt;
-  struct port_stats *stats;
+  struct lagopus_packet *pkts[RAWSOCK_RING_RX_BURST > AFXDP_RX_BURST ?
+                              RAWSOCK_RING_RX_BURST : AFXDP_RX_BURST];
+  struct rawsock_worker *w;
+  struct pollfd *pollfd;
+  struct rawsock_ring **rings;
+  struct afxdp_socket **xsks;
   ssize_t len;
+  size_t n, j;
   unsigned int i;
-  enum switch_mode mode;
   lagopus_result_t rv;
   global_state_t cur_state;
   shutdown_grace_level_t cur_grace;
@@ -701,15 +1257,21 @@ dp_rawsock_thread_loop(__UNUSED const lagopus_thread_t *selfptr,
     return rv;
   }
 
+  dparg = arg;
+  running = dparg->running;
+  w = (struct rawsock_worker *)
+      ((char *)dparg - offsetof(struct rawsock_worker, dparg));
+  pollfd = w->pollfd;
+  rings = w->rings;
+  xsks = w->xsks;
+  cur_worker = w;
+
   if (no_cache == false) {
-    flowcache = init_flowcache(kvs_type);
+    w->flowcache = init_flowcache(kvs_type);
   } else {
-    flowcache = NULL;
+    w->flowcache = NULL;
   }
 
-  dparg = arg;
-  running = dparg->running;
-
   while (*running == true) {
     struct port *port;
 
@@ -720,38 +1282,65 @@ dp_rawsock_thread_loop(__UNUSED const lagopus_thread_t *selfptr,
     if (poll(pollfd, (nfds_t)portidx, 100) < 0) {
       err(errno, "poll");
     }
+    w->stats.polls++;
     for (i = 0; i < portidx; i++) {
-      if (clear_cache == true && flowcache != NULL) {
-        clear_all_cache(flowcache);
-        clear_cache = false;
-      }
       if (pollfd[i].fd == -1 ||
 	  (pollfd[i].revents & (POLLERR | POLLHUP | POLLNVAL)) != 0) {
-	close(pollfd[i].fd);
+        /* AF_XDP socket is closed on unconfigure. */
+        if (xsks[i] == NULL) {
+          close(pollfd[i].fd);
+        }
 	pollfd[i].fd = -1; /* invalidate */
 	continue;
       }
-      flowdb_rdlock(NULL);
-      port = dp_port_lookup(DATASTORE_INTERFACE_TYPE_ETHERNET_RAWSOCK,
-                            (uint32_t)i);
+      flowdb_epoch_enter(NULL);
+      dp_counter_clock_update();
+      packet_in_batch_begin();
+      if (w->clear_cache == true && w->flowcache != NULL) {
+        /* flow table is updated, cached entries may be stale. */
+        w->clear_cache = false;
+        clear_all_cache(w->flowcache);
+      }
+      for (;;) {
+        if (xsks[i] != NULL) {
+          port = dp_port_lookup(DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP,
+                                (uint32_t)i);
+        } else {
+          port = dp_port_lookup(DATASTORE_INTERFACE_TYPE_ETHERNET_RAWSOCK,
+                                (uint32_t)i);
+        }
+        /* wait only for the flow database of this bridge. */
+        if (port == NULL || port->bridge == NULL ||
+            flowdb_epoch_check(port->bridge->flowdb) == true) {
+          break;
+        }
+      }
       if (port == NULL) {
-        flowdb_rdunlock(NULL);
+        flowdb_epoch_exit(NULL);
         continue;
       }
-      /* update port stats. */
-      if (port->interface != NULL && port->interface->stats != NULL) {
-        stats = port->interface->stats(port);
-        free(stats);
-      }
-
       if ((pollfd[i].revents & POLLIN) == 0) {
-        flowdb_rdunlock(NULL);
+        flowdb_epoch_exit(NULL);
         continue;
       }
       if (port->bridge != NULL &&
-          (port->ofp_port.config & OFPPC_NO_RECV) == 0) {
+          (port->ofp_port.config & OFPPC_NO_RECV) == 0 &&
+          xsks[i] != NULL) {
+        n = afxdp_socket_rx_burst(xsks[i], pkts, AFXDP_RX_BURST);
+        for (j = 0; j < n; j++) {
+          rawsock_process_packet(w, pkts[j], port);
+        }
+      } else if (port->bridge != NULL &&
+                 (port->ofp_port.config & OFPPC_NO_RECV) == 0 &&
+                 rings[i] != NULL) {
+        /* drain the RX ring without system call. */
+        n = rawsock_ring_rx_burst(rings[i], pkts, RAWSOCK_RING_RX_BURST);
+        for (j = 0; j < n; j++) {
+          rawsock_process_packet(w, pkts[j], port);
+        }
+      } else if (port->bridge != NULL &&
+                 (port->ofp_port.config & OFPPC_NO_RECV) == 0) {
         pkt = alloc_lagopus_packet();
-        pkt->cache = flowcache;
 
         /* not enough? */
         (void)OS_M_APPEND(PKT2MBUF(pkt), MAX_PACKET_SZ);
@@ -764,7 +1353,7 @@ dp_rawsock_thread_loop(__UNUSED const lagopus_thread_t *selfptr,
             case ECONNABORTED:
             case ECONNRESET:
             case EINTR:
-              flowdb_rdunlock(NULL);
+              flowdb_epoch_exit(NULL);
               continue;
 
             default:
@@ -772,42 +1361,44 @@ dp_rawsock_thread_loop(__UNUSED const lagopus_thread_t *selfptr,
           }
         }
         OS_M_TRIM(PKT2MBUF(pkt), MAX_PACKET_SZ - len);
-        lagopus_packet_init(pkt, PKT2MBUF(pkt), port);
-        flowdb_switch_mode_get(port->bridge->flowdb, &mode);
-        if (
-#ifdef HYBRID
-                !memcmp(OS_MTOD(PKT2MBUF(pkt), uint8_t *),
-                        port->interface->hw_addr, ETHER_ADDR_LEN) ||
-                !memcmp(OS_MTOD(PKT2MBUF(pkt), uint8_t *),
-                        eth_bcast, ETHER_ADDR_LEN) ||
-#endif /* HYBRID */
-                mode == SWITCH_MODE_STANDALONE) {
-          lagopus_forward_packet_to_port(pkt, OFPP_NORMAL);
-        } else {
-          lagopus_match_and_action(pkt);
-        }
+        rawsock_process_packet(w, pkt, port);
+      }
+      packet_in_batch_end();
+      flowdb_epoch_exit(NULL);
+    }
+    /* kick TX rings filled in this round. */
+    for (i = 0; i < portidx; i++) {
+      if (rings[i] != NULL && rawsock_ring_tx_pending(rings[i]) == true) {
+        rawsock_ring_tx_flush(rings[i]);
+      }
+      if (xsks[i] != NULL && afxdp_socket_tx_pending(xsks[i]) == true) {
+        afxdp_socket_tx_flush(xsks[i]);
       }
-      flowdb_rdunlock(NULL);
     }
   }
 
   return LAGOPUS_RESULT_OK;
 }
 
-static lagopus_thread_t rawsock_thread = NULL;
-static bool rawsock_run = false;
-static lagopus_mutex_t rawsock_lock = NULL;
-
 lagopus_result_t
 dp_rawsock_thread_init(int argc,
                        const char *const argv[],
                        __UNUSED void *extarg,
                        lagopus_thread_t **thdptr) {
-  static struct dataplane_arg dparg;
+  struct rawsock_worker *w;
   lagopus_result_t nb_ports;
+  char name[32];
+  unsigned int i, j;
 
 #ifdef HAVE_DPDK
   nb_ports = dpdk_dataplane_init(argc, argv);
+  ring_devices = app.rawsock_ring;
+  afxdp_generic = (app.afxdp_generic != 0);
+  if (app.rawsock_workers > RAWSOCK_MAX_WORKERS) {
+    nb_workers = RAWSOCK_MAX_WORKERS;
+  } else if (app.rawsock_workers != 0) {
+    nb_workers = app.rawsock_workers;
+  }
 #else
   nb_ports = rawsock_dataplane_init(argc, argv);
 #endif /* HAVE_DPDK */
@@ -820,44 +1411,95 @@ dp_rawsock_thread_init(int argc,
   lagopus_register_instruction_hook = lagopus_set_instruction_function;
   flowinfo_init();
 
-  dparg.threadptr = &rawsock_thread;
-  dparg.lock = &rawsock_lock;
-  dparg.running = &rawsock_run;
-  lagopus_thread_create(&rawsock_thread, dp_rawsock_thread_loop,
-                        dp_finalproc, dp_freeproc, "dp_rawsock",
-                        &dparg);
-  if (lagopus_mutex_create(&rawsock_lock) != LAGOPUS_RESULT_OK) {
-    lagopus_exit_fatal("lagopus_mutex_create");
+  for (i = 0; i < nb_workers; i++) {
+    w = &workers[i];
+    w->id = i;
+    if (i != 0) {
+      for (j = 0; j < NUM_PORTID; j++) {
+        w->pollfd[j].fd = -1;
+      }
+    }
+    w->dparg.threadptr = &w->thread;
+    w->dparg.lock = &w->lock;
+    w->dparg.running = &w->running;
+    if (i == 0) {
+      snprintf(name, sizeof(name), "dp_rawsock");
+    } else {
+      snprintf(name, sizeof(name), "dp_rawsock%u", i);
+    }
+    lagopus_thread_create(&w->thread, dp_rawsock_thread_loop,
+                          dp_finalproc, dp_freeproc, name,
+                          &w->dparg);
+    if (lagopus_mutex_create(&w->lock) != LAGOPUS_RESULT_OK) {
+      lagopus_exit_fatal("lagopus_mutex_create");
+    }
   }
-  *thdptr = &rawsock_thread;
+  if (nb_workers > 1) {
+    lagopus_msg_info("raw socket dataplane: %u workers\n", nb_workers);
+  }
+  *thdptr = &workers[0].thread;
 
   return LAGOPUS_RESULT_OK;
 }
 
 lagopus_result_t
 dp_rawsock_thread_start(void) {
+  lagopus_result_t rv;
+  unsigned int i;
+
 #ifdef HAVE_DPDK
   no_cache = app.no_cache;
   kvs_type = app.kvs_type;
   hashtype = app.hashtype;
 #endif /* HAVE_DPDK */
-  return dp_thread_start(&rawsock_thread, &rawsock_lock, &rawsock_run);
+  for (i = 0; i < nb_workers; i++) {
+    rv = dp_thread_start(&workers[i].thread, &workers[i].lock,
+                         &workers[i].running);
+    if (rv != LAGOPUS_RESULT_OK) {
+      return rv;
+    }
+  }
+  return LAGOPUS_RESULT_OK;
 }
 
 lagopus_result_t
 dp_rawsock_thread_stop(void) {
-  return dp_thread_stop(&rawsock_thread, &rawsock_run);
+  lagopus_result_t rv, rv2;
+  unsigned int i;
+
+  rv = LAGOPUS_RESULT_OK;
+  for (i = 0; i < nb_workers; i++) {
+    rv2 = dp_thread_stop(&workers[i].thread, &workers[i].running);
+    if (rv2 != LAGOPUS_RESULT_OK) {
+      rv = rv2;
+    }
+  }
+  return rv;
 }
 
 lagopus_result_t
 dp_rawsock_thread_shutdown(shutdown_grace_level_t level) {
-  return dp_thread_shutdown(&rawsock_thread, &rawsock_lock, &rawsock_run,
-                            level);
+  lagopus_result_t rv, rv2;
+  unsigned int i;
+
+  rv = LAGOPUS_RESULT_OK;
+  for (i = 0; i < nb_workers; i++) {
+    rv2 = dp_thread_shutdown(&workers[i].thread, &workers[i].lock,
+                             &workers[i].running, level);
+    if (rv2 != LAGOPUS_RESULT_OK) {
+      rv = rv2;
+    }
+  }
+  return rv;
 }
 
 void
 dp_rawsock_thread_fini(void) {
-  dp_thread_finalize(&rawsock_thread);
+  unsigned int i;
+
+  for (i = 0; i < nb_workers; i++) {
+    dp_thread_finalize(&workers[i].thread);
+  }
 }
 
 #if 0
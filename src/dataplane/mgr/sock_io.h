@@ -19,12 +19,68 @@
 
 #define SOCK_POLL_TIMEOUT 100 /* msec */
 
+/* max number of raw socket worker threads. */
+#define RAWSOCK_MAX_WORKERS 16
+
+/**
+ * Per worker statistics.  Updated by the owner worker only.
+ */
+struct rawsock_worker_stats {
+  uint64_t rx_packets;          /** Received packets. */
+  uint64_t rx_bytes;            /** Received bytes. */
+  uint64_t tx_packets;          /** Transmitted packets. */
+  uint64_t tx_dropped;          /** Packets failed to transmit. */
+  uint64_t polls;               /** Number of poll rounds. */
+};
+
+/**
+ * Select TPID of the VLAN tag stripped by the kernel.  Use TPID reported
+ * by the kernel if it is valid, otherwise guess from ether type following
+ * the source address of the received frame.
+ */
+static inline uint16_t
+rawsock_vlan_tpid(uint32_t status, uint16_t tpid, const uint8_t *frame) {
+#if defined (TP_STATUS_VLAN_TPID_VALID)
+  if ((status & TP_STATUS_VLAN_TPID_VALID) != 0 && tpid != 0) {
+    return tpid;
+  }
+#else
+  (void) status;
+  (void) tpid;
+#endif /* TP_STATUS_VLAN_TPID_VALID */
+  switch (OS_NTOHS(*(const uint16_t *)(frame + ETHER_ADDR_LEN * 2))) {
+    case ETHERTYPE_PBB:
+    case ETHERTYPE_VLAN:
+      return 0x88a8;
+    default:
+      return ETHERTYPE_VLAN;
+  }
+}
+
 ssize_t
 dp_rawsock_interface_recv_packet(int fd, uint8_t *buf, size_t buflen);
 
 lagopus_result_t
 rawsock_rx_burst(struct interface *ifp, void *mbufs[], size_t nb);
 
-  void clear_rawsock_flowcache(void);
+/**
+ * Get number of raw socket worker threads.
+ *
+ * @retval      number of workers.
+ */
+unsigned int rawsock_worker_count(void);
+
+/**
+ * Get statistics of the raw socket worker.
+ *
+ * @param[in]   id      Worker id, 0 to rawsock_worker_count() - 1.
+ * @param[out]  stats   Statistics.
+ *
+ * @retval      LAGOPUS_RESULT_OK               Succeeded.
+ * @retval      LAGOPUS_RESULT_INVALID_ARGS     Invalid worker id.
+ */
+lagopus_result_t
+rawsock_get_worker_stats(unsigned int id,
+                         struct rawsock_worker_stats *stats);
 
 #endif /* SRC_DATAPLANE_MGR_SOCK_IO_H_ */
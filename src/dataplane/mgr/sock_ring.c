@@ -0,0 +1,392 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ *      @file   sock_ring.c
+ *      @brief  PACKET_MMAP (TPACKET_V3) ring for raw socket dataplane.
+ *
+ * RX ring is consumed block by block; all frames in a retired block are
+ * copied into lagopus packets and the block is handed back to the kernel
+ * at once.  TX frames are written into the mapped TX ring and sent by
+ * one send() per flush.
+ */
+
+#include "lagopus_config.h"
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <net/if.h>
+
+#include <linux/if_packet.h>
+
+#include "lagopus_apis.h"
+#include "lagopus/dp_apis.h"
+#include "lagopus/dataplane.h"
+#include "pktbuf.h"
+#include "packet.h"
+#include "sock_io.h"
+#include "sock_ring.h"
+
+#ifdef TPACKET3_HDRLEN
+
+/*
+ * TPACKET_V3 frame header length, same as TPACKET3_HDRLEN but aligned
+ * in size_t to avoid sign conversion of the mask.
+ */
+static const size_t ring_hdrlen =
+  ((sizeof(struct tpacket3_hdr) + TPACKET_ALIGNMENT - 1) &
+   ~((size_t)TPACKET_ALIGNMENT - 1)) + sizeof(struct sockaddr_ll);
+
+struct rawsock_ring {
+  int fd;
+  uint8_t *map;
+  size_t map_size;
+
+  /* RX ring. */
+  uint8_t *rx_ring;
+  unsigned int rx_block_nr;
+  unsigned int rx_block;          /* current block index */
+  uint32_t rx_remain;             /* frames not consumed in current block */
+  struct tpacket3_hdr *rx_next;   /* next frame in current block */
+
+  /* TX ring. */
+  uint8_t *tx_ring;
+  unsigned int tx_frame_size;
+  unsigned int tx_frame_nr;
+  unsigned int tx_frame;          /* next frame index */
+  unsigned int tx_pending;        /* frames queued but not kicked */
+  uint64_t tx_dropped;            /* frames dropped by full TX ring */
+  lagopus_spinlock_t tx_lock;
+};
+
+static unsigned int
+ring_frame_size(void) {
+  unsigned int size;
+
+  size = TPACKET_ALIGNMENT;
+  while (size < ring_hdrlen + MAX_PACKET_SZ) {
+    size <<= 1;
+  }
+  return size;
+}
+
+struct rawsock_ring *
+rawsock_ring_create(int fd) {
+  struct rawsock_ring *ring;
+  struct tpacket_req3 req;
+  unsigned int frame_size;
+  int version;
+
+  version = TPACKET_V3;
+  if (setsockopt(fd, SOL_PACKET, PACKET_VERSION,
+                 &version, sizeof(version)) != 0) {
+    lagopus_msg_warning("PACKET_VERSION: %s\n", strerror(errno));
+    return NULL;
+  }
+  ring = calloc(1, sizeof(*ring));
+  if (ring == NULL) {
+    return NULL;
+  }
+  ring->fd = fd;
+  frame_size = ring_frame_size();
+
+  memset(&req, 0, sizeof(req));
+  req.tp_block_size = RAWSOCK_RING_BLOCK_SIZE;
+  req.tp_block_nr = RAWSOCK_RING_RX_BLOCK_NR;
+  req.tp_frame_size = frame_size;
+  req.tp_frame_nr = (RAWSOCK_RING_BLOCK_SIZE / frame_size) *
+                    RAWSOCK_RING_RX_BLOCK_NR;
+  req.tp_retire_blk_tov = RAWSOCK_RING_BLOCK_TIMEOUT;
+  req.tp_feature_req_word = TP_FT_REQ_FILL_RXHASH;
+  if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) != 0) {
+    lagopus_msg_warning("PACKET_RX_RING: %s\n", strerror(errno));
+    goto fail;
+  }
+  ring->rx_block_nr = req.tp_block_nr;
+
+  /* TX ring does not accept block timeout nor feature request. */
+  memset(&req, 0, sizeof(req));
+  req.tp_block_size = RAWSOCK_RING_BLOCK_SIZE;
+  req.tp_block_nr = RAWSOCK_RING_TX_BLOCK_NR;
+  req.tp_frame_size = frame_size;
+  req.tp_frame_nr = (RAWSOCK_RING_BLOCK_SIZE / frame_size) *
+                    RAWSOCK_RING_TX_BLOCK_NR;
+  if (setsockopt(fd, SOL_PACKET, PACKET_TX_RING, &req, sizeof(req)) != 0) {
+    lagopus_msg_warning("PACKET_TX_RING: %s\n", strerror(errno));
+    goto fail;
+  }
+  ring->tx_frame_size = frame_size;
+  ring->tx_frame_nr = req.tp_frame_nr;
+
+  ring->map_size = (size_t)RAWSOCK_RING_BLOCK_SIZE *
+                   (RAWSOCK_RING_RX_BLOCK_NR + RAWSOCK_RING_TX_BLOCK_NR);
+  ring->map = mmap(NULL, ring->map_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_LOCKED | MAP_POPULATE, fd, 0);
+  if (ring->map == MAP_FAILED) {
+    /* retry without locking pages. */
+    ring->map = mmap(NULL, ring->map_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd, 0);
+  }
+  if (ring->map == MAP_FAILED) {
+    lagopus_msg_warning("mmap: %s\n", strerror(errno));
+    goto fail;
+  }
+  ring->rx_ring = ring->map;
+  ring->tx_ring = ring->map +
+                  (size_t)RAWSOCK_RING_BLOCK_SIZE * RAWSOCK_RING_RX_BLOCK_NR;
+  if (lagopus_spinlock_initialize(&ring->tx_lock) != LAGOPUS_RESULT_OK) {
+    munmap(ring->map, ring->map_size);
+    goto fail;
+  }
+  return ring;
+
+fail:
+  free(ring);
+  return NULL;
+}
+
+void
+rawsock_ring_destroy(struct rawsock_ring *ring) {
+  if (ring == NULL) {
+    return;
+  }
+  munmap(ring->map, ring->map_size);
+  lagopus_spinlock_finalize(&ring->tx_lock);
+  free(ring);
+}
+
+static inline struct tpacket_block_desc *
+rx_block_desc(struct rawsock_ring *ring) {
+  return (struct tpacket_block_desc *)
+         (ring->rx_ring + (size_t)ring->rx_block * RAWSOCK_RING_BLOCK_SIZE);
+}
+
+/**
+ * Copy one frame into the packet buffer.  If the kernel stripped
+ * VLAN tag, put it back between source address and ether type.
+ */
+static inline size_t
+rx_copy_frame(uint8_t *dst, const struct tpacket3_hdr *hdr) {
+  const uint8_t *src;
+  size_t len;
+
+  src = (const uint8_t *)hdr + hdr->tp_mac;
+  len = hdr->tp_snaplen;
+#if defined (TP_STATUS_VLAN_VALID)
+  if ((hdr->tp_status & TP_STATUS_VLAN_VALID) != 0 &&
+#else
+  if (hdr->hv1.tp_vlan_tci != 0 &&
+#endif /* TP_STATUS_VLAN_VALID */
+      len >= ETHER_ADDR_LEN * 2 + 2) {
+    uint16_t *p;
+
+    if (len > MAX_PACKET_SZ - 4) {
+      len = MAX_PACKET_SZ - 4;
+    }
+    OS_MEMCPY(dst, src, ETHER_ADDR_LEN * 2);
+    p = (uint16_t *)(dst + ETHER_ADDR_LEN * 2);
+#if defined (TP_STATUS_VLAN_TPID_VALID)
+    p[0] = OS_HTONS(rawsock_vlan_tpid(hdr->tp_status,
+                                      hdr->hv1.tp_vlan_tpid, src));
+#else
+    p[0] = OS_HTONS(rawsock_vlan_tpid(hdr->tp_status, 0, src));
+#endif /* TP_STATUS_VLAN_TPID_VALID */
+    p[1] = OS_HTONS((uint16_t)hdr->hv1.tp_vlan_tci);
+    OS_MEMCPY(&p[2], src + ETHER_ADDR_LEN * 2, len - ETHER_ADDR_LEN * 2);
+    return len + 4;
+  }
+  if (len > MAX_PACKET_SZ) {
+    len = MAX_PACKET_SZ;
+  }
+  OS_MEMCPY(dst, src, len);
+  return len;
+}
+
+size_t
+rawsock_ring_rx_burst(struct rawsock_ring *ring,
+                      struct lagopus_packet *pkts[], size_t nb) {
+  struct tpacket_block_desc *bd;
+  struct lagopus_packet *pkt;
+  OS_MBUF *m;
+  size_t n, len;
+
+  n = 0;
+  while (n < nb) {
+    bd = rx_block_desc(ring);
+    if (ring->rx_next == NULL) {
+      if ((bd->hdr.bh1.block_status & TP_STATUS_USER) == 0) {
+        break;
+      }
+      /* read frame headers only after status is observed. */
+      mbar();
+      ring->rx_remain = bd->hdr.bh1.num_pkts;
+      ring->rx_next = (struct tpacket3_hdr *)
+                      ((uint8_t *)bd + bd->hdr.bh1.offset_to_first_pkt);
+    }
+    while (ring->rx_remain > 0 && n < nb) {
+      pkt = alloc_lagopus_packet();
+      if (pkt == NULL) {
+        return n;
+      }
+      m = PKT2MBUF(pkt);
+      len = rx_copy_frame(OS_MTOD(m, uint8_t *), ring->rx_next);
+      (void)OS_M_APPEND(m, len);
+      pkts[n++] = pkt;
+      ring->rx_next = (struct tpacket3_hdr *)
+                      ((uint8_t *)ring->rx_next + ring->rx_next->tp_next_offset);
+      ring->rx_remain--;
+    }
+    if (ring->rx_remain == 0) {
+      /* whole block is consumed, return it to the kernel. */
+      mbar();
+      bd->hdr.bh1.block_status = TP_STATUS_KERNEL;
+      ring->rx_next = NULL;
+      ring->rx_block = (ring->rx_block + 1) % ring->rx_block_nr;
+    }
+  }
+  return n;
+}
+
+static inline struct tpacket3_hdr *
+tx_frame_hdr(struct rawsock_ring *ring, unsigned int idx) {
+  return (struct tpacket3_hdr *)
+         (ring->tx_ring + (size_t)idx * ring->tx_frame_size);
+}
+
+static inline bool
+tx_frame_available(const struct tpacket3_hdr *hdr) {
+  return hdr->tp_status == TP_STATUS_AVAILABLE ||
+         (hdr->tp_status & TP_STATUS_WRONG_FORMAT) != 0;
+}
+
+static void
+tx_flush_locked(struct rawsock_ring *ring) {
+  if (ring->tx_pending != 0) {
+    if (send(ring->fd, NULL, 0, MSG_DONTWAIT) < 0 &&
+        errno != EAGAIN && errno != ENOBUFS) {
+      lagopus_msg_warning("send: %s\n", strerror(errno));
+    }
+    ring->tx_pending = 0;
+  }
+}
+
+lagopus_result_t
+rawsock_ring_tx_enqueue(struct rawsock_ring *ring,
+                        const uint8_t *data, size_t len) {
+  struct tpacket3_hdr *hdr;
+  lagopus_result_t rv;
+
+  if (len > ring->tx_frame_size - ring_hdrlen) {
+    return LAGOPUS_RESULT_TOO_LONG;
+  }
+  lagopus_spinlock_lock(&ring->tx_lock);
+  hdr = tx_frame_hdr(ring, ring->tx_frame);
+  if (tx_frame_available(hdr) == false) {
+    /* ring is full, kick the kernel and retry once. */
+    tx_flush_locked(ring);
+    mbar();
+    if (tx_frame_available(hdr) == false) {
+      ring->tx_dropped++;
+      rv = LAGOPUS_RESULT_NO_MEMORY;
+      goto out;
+    }
+  }
+  OS_MEMCPY((uint8_t *)hdr + ring_hdrlen - sizeof(struct sockaddr_ll),
+            data, len);
+  hdr->tp_len = (uint32_t)len;
+  hdr->tp_snaplen = (uint32_t)len;
+  hdr->tp_next_offset = 0;
+  mbar();
+  hdr->tp_status = TP_STATUS_SEND_REQUEST;
+  ring->tx_frame = (ring->tx_frame + 1) % ring->tx_frame_nr;
+  ring->tx_pending++;
+  rv = LAGOPUS_RESULT_OK;
+out:
+  lagopus_spinlock_unlock(&ring->tx_lock);
+  return rv;
+}
+
+void
+rawsock_ring_tx_flush(struct rawsock_ring *ring) {
+  lagopus_spinlock_lock(&ring->tx_lock);
+  tx_flush_locked(ring);
+  lagopus_spinlock_unlock(&ring->tx_lock);
+}
+
+bool
+rawsock_ring_tx_pending(struct rawsock_ring *ring) {
+  return ring->tx_pending != 0;
+}
+
+uint64_t
+rawsock_ring_tx_dropped(struct rawsock_ring *ring) {
+  return ring->tx_dropped;
+}
+
+#else /* TPACKET3_HDRLEN */
+
+struct rawsock_ring *
+rawsock_ring_create(int fd) {
+  (void) fd;
+  lagopus_msg_warning("TPACKET_V3 is not supported\n");
+  return NULL;
+}
+
+void
+rawsock_ring_destroy(struct rawsock_ring *ring) {
+  (void) ring;
+}
+
+size_t
+rawsock_ring_rx_burst(struct rawsock_ring *ring,
+                      struct lagopus_packet *pkts[], size_t nb) {
+  (void) ring;
+  (void) pkts;
+  (void) nb;
+  return 0;
+}
+
+lagopus_result_t
+rawsock_ring_tx_enqueue(struct rawsock_ring *ring,
+                        const uint8_t *data, size_t len) {
+  (void) ring;
+  (void) data;
+  (void) len;
+  return LAGOPUS_RESULT_UNSUPPORTED;
+}
+
+void
+rawsock_ring_tx_flush(struct rawsock_ring *ring) {
+  (void) ring;
+}
+
+bool
+rawsock_ring_tx_pending(struct rawsock_ring *ring) {
+  (void) ring;
+  return false;
+}
+
+uint64_t
+rawsock_ring_tx_dropped(struct rawsock_ring *ring) {
+  (void) ring;
+  return 0;
+}
+
+#endif /* TPACKET3_HDRLEN */
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ *      @file   sock_ring.h
+ *      @brief  PACKET_MMAP (TPACKET_V3) ring for raw socket dataplane.
+ */
+
+#ifndef SRC_DATAPLANE_MGR_SOCK_RING_H_
+#define SRC_DATAPLANE_MGR_SOCK_RING_H_
+
+/* ring geometry. */
+#define RAWSOCK_RING_BLOCK_SIZE    (1 << 18)  /* 256KB */
+#define RAWSOCK_RING_RX_BLOCK_NR   64
+#define RAWSOCK_RING_TX_BLOCK_NR   16
+#define RAWSOCK_RING_BLOCK_TIMEOUT 1          /* msec */
+
+/* max number of packets received at once. */
+#define RAWSOCK_RING_RX_BURST      32
+
+struct rawsock_ring;
+struct lagopus_packet;
+
+/**
+ * Setup TPACKET_V3 RX/TX ring on the packet socket.
+ * It must be called before the socket is bound to the interface.
+ *
+ * @param[in]   fd      PF_PACKET socket.
+ *
+ * @retval      !=NULL  ring object.
+ * @retval      NULL    TPACKET_V3 is not available.
+ */
+struct rawsock_ring *rawsock_ring_create(int fd);
+
+/**
+ * Unmap and free the ring.  Socket is not closed.
+ *
+ * @param[in]   ring    ring object.
+ */
+void rawsock_ring_destroy(struct rawsock_ring *ring);
+
+/**
+ * Receive packets from the RX ring without any system call.
+ * Received frames are copied into newly allocated lagopus packets,
+ * stripped VLAN tag is restored from the frame header.
+ *
+ * @param[in]   ring    ring object.
+ * @param[out]  pkts    received packets.
+ * @param[in]   nb      size of pkts.
+ *
+ * @retval      number of received packets.
+ */
+size_t rawsock_ring_rx_burst(struct rawsock_ring *ring,
+                             struct lagopus_packet *pkts[], size_t nb);
+
+/**
+ * Queue a frame to the TX ring.  Frame is not transmitted until
+ * rawsock_ring_tx_flush() is called.
+ *
+ * @param[in]   ring    ring object.
+ * @param[in]   data    frame.
+ * @param[in]   len     length of the frame.
+ *
+ * If TX ring is full, queued frames are kicked and the frame is retried
+ * once, then dropped and counted.
+ *
+ * @retval      LAGOPUS_RESULT_OK               queued.
+ * @retval      LAGOPUS_RESULT_NO_MEMORY        TX ring is full.
+ */
+lagopus_result_t rawsock_ring_tx_enqueue(struct rawsock_ring *ring,
+                                         const uint8_t *data, size_t len);
+
+/**
+ * Kick the kernel to transmit all queued frames in the TX ring.
+ *
+ * @param[in]   ring    ring object.
+ */
+void rawsock_ring_tx_flush(struct rawsock_ring *ring);
+
+/**
+ * Check whether TX ring has frames not kicked yet.
+ *
+ * @param[in]   ring    ring object.
+ */
+bool rawsock_ring_tx_pending(struct rawsock_ring *ring);
+
+/**
+ * Get number of frames dropped because TX ring is full.
+ *
+ * @param[in]   ring    ring object.
+ */
+uint64_t rawsock_ring_tx_dropped(struct rawsock_ring *ring);
+
+#endif /* SRC_DATAPLANE_MGR_SOCK_RING_H_ */
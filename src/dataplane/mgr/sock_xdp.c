@@ -0,0 +1,677 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ *      @file   sock_xdp.c
+ *      @brief  AF_XDP socket for ethernet-afxdp interface.
+ *
+ * Each socket owns a UMEM split in two halves: the first half is given
+ * to the kernel through the fill ring for RX, the second half is kept
+ * in a free list for TX and recycled from the completion ring.
+ * A tiny XDP program redirects every RX queue to the socket registered
+ * in XSKMAP, or passes the packet to the kernel stack if none.
+ * libbpf is not required, the program is loaded by bpf(2) directly.
+ *
+ * Lagopus packets own their data, so every frame is copied once between
+ * UMEM and the packet buffer in both directions.  XDP_ZEROCOPY bind only
+ * saves the copy inside the kernel; the dataplane is copy mode either way.
+ */
+
+#include "lagopus_config.h"
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <net/if.h>
+
+#include "lagopus_apis.h"
+#include "lagopus/dp_apis.h"
+#include "lagopus/dataplane.h"
+#include "pktbuf.h"
+#include "packet.h"
+#include "sock_xdp.h"
+
+#ifdef AF_XDP
+#include <linux/bpf.h>
+#include <linux/if_link.h>
+#include <linux/if_xdp.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#endif /* AF_XDP */
+
+#if defined(AF_XDP) && defined(XDP_USE_NEED_WAKEUP) && defined(__NR_bpf)
+
+/* max number of RX queues redirected by XSKMAP. */
+#define AFXDP_MAX_QUEUES      64
+
+struct afxdp_prog {
+  int ifindex;
+  int map_fd;
+  int prog_fd;
+  uint32_t flags;
+};
+
+struct xsk_ring {
+  uint32_t *producer;
+  uint32_t *consumer;
+  uint32_t *flags;
+  void *desc;
+  uint32_t mask;
+  void *map;
+  size_t map_size;
+};
+
+struct afxdp_socket {
+  int fd;
+  uint8_t *umem;
+  size_t umem_size;
+
+  struct xsk_ring rx;
+  struct xsk_ring fill;
+  struct xsk_ring tx;
+  struct xsk_ring comp;
+
+  /* TX frames not owned by the kernel. */
+  uint64_t tx_free[AFXDP_NUM_FRAMES / 2];
+  unsigned int tx_nfree;
+  unsigned int tx_pending;
+  lagopus_spinlock_t tx_lock;
+};
+
+static int
+sys_bpf(int cmd, union bpf_attr *attr) {
+  return (int)syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+}
+
+/**
+ * Attach or detach (prog_fd == -1) XDP program by RTM_SETLINK.
+ */
+static lagopus_result_t
+xdp_link_set(int ifindex, int prog_fd, uint32_t flags) {
+  struct {
+    struct nlmsghdr nlh;
+    struct ifinfomsg ifinfo;
+    char buf[64];
+  } req;
+  union {
+    struct nlmsghdr nlh;
+    char buf[512];
+  } res;
+  struct rtattr *nest, *rta;
+  struct nlmsgerr *nlerr;
+  ssize_t len;
+  int fd;
+
+  fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+  if (fd == -1) {
+    return LAGOPUS_RESULT_POSIX_API_ERROR;
+  }
+  memset(&req, 0, sizeof(req));
+  req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifinfomsg));
+  req.nlh.nlmsg_type = RTM_SETLINK;
+  req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+  req.ifinfo.ifi_family = AF_UNSPEC;
+  req.ifinfo.ifi_index = ifindex;
+
+  nest = (struct rtattr *)((char *)&req + NLMSG_ALIGN(req.nlh.nlmsg_len));
+  nest->rta_type = NLA_F_NESTED | IFLA_XDP;
+  nest->rta_len = RTA_LENGTH(0);
+
+  rta = (struct rtattr *)((char *)nest + nest->rta_len);
+  rta->rta_type = IFLA_XDP_FD;
+  rta->rta_len = RTA_LENGTH(sizeof(int));
+  memcpy(RTA_DATA(rta), &prog_fd, sizeof(int));
+  nest->rta_len = (unsigned short)(nest->rta_len + RTA_ALIGN(rta->rta_len));
+
+  if (flags != 0) {
+    rta = (struct rtattr *)((char *)nest + nest->rta_len);
+    rta->rta_type = IFLA_XDP_FLAGS;
+    rta->rta_len = RTA_LENGTH(sizeof(uint32_t));
+    memcpy(RTA_DATA(rta), &flags, sizeof(uint32_t));
+    nest->rta_len = (unsigned short)(nest->rta_len + RTA_ALIGN(rta->rta_len));
+  }
+  req.nlh.nlmsg_len = NLMSG_ALIGN(req.nlh.nlmsg_len) + nest->rta_len;
+
+  if (send(fd, &req, req.nlh.nlmsg_len, 0) < 0) {
+    close(fd);
+    return LAGOPUS_RESULT_POSIX_API_ERROR;
+  }
+  len = recv(fd, &res, sizeof(res), 0);
+  close(fd);
+  if (len < (ssize_t)NLMSG_LENGTH(sizeof(*nlerr)) ||
+      res.nlh.nlmsg_type != NLMSG_ERROR) {
+    return LAGOPUS_RESULT_POSIX_API_ERROR;
+  }
+  nlerr = NLMSG_DATA(&res.nlh);
+  if (nlerr->error != 0) {
+    errno = -nlerr->error;
+    return LAGOPUS_RESULT_POSIX_API_ERROR;
+  }
+  return LAGOPUS_RESULT_OK;
+}
+
+/**
+ * Load the XDP program:
+ *   return bpf_redirect_map(&xsks_map, ctx->rx_queue_index, XDP_PASS);
+ */
+static int
+xdp_prog_load(int map_fd) {
+  struct bpf_insn insns[] = {
+    /* r2 = ctx->rx_queue_index */
+    {
+      .code = BPF_LDX | BPF_MEM | BPF_W,
+      .dst_reg = BPF_REG_2,
+      .src_reg = BPF_REG_1,
+      .off = offsetof(struct xdp_md, rx_queue_index),
+    },
+    /* r1 = xsks_map */
+    {
+      .code = BPF_LD | BPF_DW | BPF_IMM,
+      .dst_reg = BPF_REG_1,
+      .src_reg = BPF_PSEUDO_MAP_FD,
+      .imm = map_fd,
+    },
+    { .code = 0 },
+    /* r3 = XDP_PASS */
+    {
+      .code = BPF_ALU64 | BPF_MOV | BPF_K,
+      .dst_reg = BPF_REG_3,
+      .imm = XDP_PASS,
+    },
+    /* r0 = bpf_redirect_map(r1, r2, r3) */
+    {
+      .code = BPF_JMP | BPF_CALL,
+      .imm = BPF_FUNC_redirect_map,
+    },
+    /* return r0 */
+    {
+      .code = BPF_JMP | BPF_EXIT,
+    },
+  };
+  static const char license[] = "Dual BSD/GPL";
+  union bpf_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.prog_type = BPF_PROG_TYPE_XDP;
+  attr.insns = (uint64_t)(uintptr_t)insns;
+  attr.insn_cnt = sizeof(insns) / sizeof(insns[0]);
+  attr.license = (uint64_t)(uintptr_t)license;
+  return sys_bpf(BPF_PROG_LOAD, &attr);
+}
+
+struct afxdp_prog *
+afxdp_prog_attach(int ifindex, bool generic) {
+  struct afxdp_prog *prog;
+  union bpf_attr attr;
+
+  prog = calloc(1, sizeof(*prog));
+  if (prog == NULL) {
+    return NULL;
+  }
+  prog->ifindex = ifindex;
+  prog->prog_fd = -1;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.map_type = BPF_MAP_TYPE_XSKMAP;
+  attr.key_size = sizeof(uint32_t);
+  attr.value_size = sizeof(int);
+  attr.max_entries = AFXDP_MAX_QUEUES;
+  prog->map_fd = sys_bpf(BPF_MAP_CREATE, &attr);
+  if (prog->map_fd < 0) {
+    lagopus_msg_warning("XSKMAP: %s\n", strerror(errno));
+    goto fail;
+  }
+  prog->prog_fd = xdp_prog_load(prog->map_fd);
+  if (prog->prog_fd < 0) {
+    lagopus_msg_warning("XDP program: %s\n", strerror(errno));
+    goto fail;
+  }
+
+  if (generic == false) {
+    prog->flags = XDP_FLAGS_UPDATE_IF_NOEXIST | XDP_FLAGS_DRV_MODE;
+    if (xdp_link_set(ifindex, prog->prog_fd,
+                     prog->flags) == LAGOPUS_RESULT_OK) {
+      return prog;
+    }
+    lagopus_msg_info("ifindex %d: native XDP is not available (%s), "
+                     "use generic XDP\n", ifindex, strerror(errno));
+  }
+  prog->flags = XDP_FLAGS_UPDATE_IF_NOEXIST | XDP_FLAGS_SKB_MODE;
+  if (xdp_link_set(ifindex, prog->prog_fd,
+                   prog->flags) != LAGOPUS_RESULT_OK) {
+    lagopus_msg_warning("ifindex %d: attach XDP program: %s\n",
+                        ifindex, strerror(errno));
+    goto fail;
+  }
+  return prog;
+
+fail:
+  if (prog->prog_fd >= 0) {
+    close(prog->prog_fd);
+  }
+  if (prog->map_fd >= 0) {
+    close(prog->map_fd);
+  }
+  free(prog);
+  return NULL;
+}
+
+void
+afxdp_prog_detach(struct afxdp_prog *prog) {
+  if (prog == NULL) {
+    return;
+  }
+  (void)xdp_link_set(prog->ifindex, -1, prog->flags & XDP_FLAGS_MODES);
+  close(prog->prog_fd);
+  close(prog->map_fd);
+  free(prog);
+}
+
+bool
+afxdp_prog_is_generic(const struct afxdp_prog *prog) {
+  return (prog->flags & XDP_FLAGS_SKB_MODE) != 0;
+}
+
+lagopus_result_t
+afxdp_prog_register(struct afxdp_prog *prog, uint32_t queue,
+                    struct afxdp_socket *xsk) {
+  union bpf_attr attr;
+
+  if (queue >= AFXDP_MAX_QUEUES) {
+    return LAGOPUS_RESULT_OUT_OF_RANGE;
+  }
+  memset(&attr, 0, sizeof(attr));
+  attr.map_fd = (uint32_t)prog->map_fd;
+  attr.key = (uint64_t)(uintptr_t)&queue;
+  attr.value = (uint64_t)(uintptr_t)&xsk->fd;
+  attr.flags = BPF_ANY;
+  if (sys_bpf(BPF_MAP_UPDATE_ELEM, &attr) != 0) {
+    return LAGOPUS_RESULT_POSIX_API_ERROR;
+  }
+  return LAGOPUS_RESULT_OK;
+}
+
+static int
+xsk_ring_map(int fd, struct xsk_ring *ring, const struct xdp_ring_offset *off,
+             size_t desc_size, off_t pgoff) {
+  uint8_t *map;
+
+  ring->map_size = off->desc + AFXDP_RING_SIZE * desc_size;
+  map = mmap(NULL, ring->map_size, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, fd, pgoff);
+  if (map == MAP_FAILED) {
+    ring->map = NULL;
+    return -1;
+  }
+  ring->map = map;
+  ring->producer = (uint32_t *)(map + off->producer);
+  ring->consumer = (uint32_t *)(map + off->consumer);
+  ring->flags = (uint32_t *)(map + off->flags);
+  ring->desc = map + off->desc;
+  ring->mask = AFXDP_RING_SIZE - 1;
+  return 0;
+}
+
+static void
+xsk_ring_unmap(struct xsk_ring *ring) {
+  if (ring->map != NULL) {
+    munmap(ring->map, ring->map_size);
+    ring->map = NULL;
+  }
+}
+
+static struct afxdp_socket *
+xsk_open(int ifindex, uint32_t queue, uint16_t bind_flags) {
+  struct afxdp_socket *xsk;
+  struct xdp_umem_reg reg;
+  struct xdp_mmap_offsets off;
+  struct sockaddr_xdp sxdp;
+  socklen_t optlen;
+  uint64_t *fill;
+  unsigned int i;
+  int size;
+
+  xsk = calloc(1, sizeof(*xsk));
+  if (xsk == NULL) {
+    return NULL;
+  }
+  xsk->fd = socket(AF_XDP, SOCK_RAW, 0);
+  if (xsk->fd < 0) {
+    free(xsk);
+    return NULL;
+  }
+  xsk->umem_size = (size_t)AFXDP_FRAME_SIZE * AFXDP_NUM_FRAMES;
+  xsk->umem = mmap(NULL, xsk->umem_size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+  if (xsk->umem == MAP_FAILED) {
+    xsk->umem = NULL;
+    goto fail;
+  }
+
+  memset(&reg, 0, sizeof(reg));
+  reg.addr = (uint64_t)(uintptr_t)xsk->umem;
+  reg.len = xsk->umem_size;
+  reg.chunk_size = AFXDP_FRAME_SIZE;
+  reg.headroom = 0;
+  if (setsockopt(xsk->fd, SOL_XDP, XDP_UMEM_REG, &reg, sizeof(reg)) != 0) {
+    goto fail;
+  }
+  size = AFXDP_RING_SIZE;
+  if (setsockopt(xsk->fd, SOL_XDP, XDP_UMEM_FILL_RING,
+                 &size, sizeof(size)) != 0 ||
+      setsockopt(xsk->fd, SOL_XDP, XDP_UMEM_COMPLETION_RING,
+                 &size, sizeof(size)) != 0 ||
+      setsockopt(xsk->fd, SOL_XDP, XDP_RX_RING,
+                 &size, sizeof(size)) != 0 ||
+      setsockopt(xsk->fd, SOL_XDP, XDP_TX_RING,
+                 &size, sizeof(size)) != 0) {
+    goto fail;
+  }
+  optlen = sizeof(off);
+  if (getsockopt(xsk->fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optlen) != 0) {
+    goto fail;
+  }
+  if (xsk_ring_map(xsk->fd, &xsk->rx, &off.rx, sizeof(struct xdp_desc),
+                   XDP_PGOFF_RX_RING) != 0 ||
+      xsk_ring_map(xsk->fd, &xsk->tx, &off.tx, sizeof(struct xdp_desc),
+                   XDP_PGOFF_TX_RING) != 0 ||
+      xsk_ring_map(xsk->fd, &xsk->fill, &off.fr, sizeof(uint64_t),
+                   (off_t)XDP_UMEM_PGOFF_FILL_RING) != 0 ||
+      xsk_ring_map(xsk->fd, &xsk->comp, &off.cr, sizeof(uint64_t),
+                   (off_t)XDP_UMEM_PGOFF_COMPLETION_RING) != 0) {
+    goto fail;
+  }
+
+  /* first half of UMEM for RX, the rest for TX. */
+  fill = xsk->fill.desc;
+  for (i = 0; i < AFXDP_NUM_FRAMES / 2; i++) {
+    fill[i & xsk->fill.mask] = (uint64_t)i * AFXDP_FRAME_SIZE;
+  }
+  mbar();
+  *xsk->fill.producer = AFXDP_NUM_FRAMES / 2;
+  for (i = 0; i < AFXDP_NUM_FRAMES / 2; i++) {
+    xsk->tx_free[i] = (uint64_t)(AFXDP_NUM_FRAMES / 2 + i) * AFXDP_FRAME_SIZE;
+  }
+  xsk->tx_nfree = AFXDP_NUM_FRAMES / 2;
+
+  memset(&sxdp, 0, sizeof(sxdp));
+  sxdp.sxdp_family = AF_XDP;
+  sxdp.sxdp_ifindex = (uint32_t)ifindex;
+  sxdp.sxdp_queue_id = queue;
+  sxdp.sxdp_flags = bind_flags;
+  if (bind(xsk->fd, (struct sockaddr *)&sxdp, sizeof(sxdp)) != 0) {
+    goto fail;
+  }
+  if (lagopus_spinlock_initialize(&xsk->tx_lock) != LAGOPUS_RESULT_OK) {
+    goto fail;
+  }
+  return xsk;
+
+fail:
+  xsk_ring_unmap(&xsk->rx);
+  xsk_ring_unmap(&xsk->tx);
+  xsk_ring_unmap(&xsk->fill);
+  xsk_ring_unmap(&xsk->comp);
+  close(xsk->fd);
+  if (xsk->umem != NULL) {
+    munmap(xsk->umem, xsk->umem_size);
+  }
+  free(xsk);
+  return NULL;
+}
+
+struct afxdp_socket *
+afxdp_socket_create(int ifindex, uint32_t queue, bool zerocopy) {
+  struct afxdp_socket *xsk;
+
+  if (zerocopy == true) {
+    xsk = xsk_open(ifindex, queue, XDP_ZEROCOPY | XDP_USE_NEED_WAKEUP);
+    if (xsk != NULL) {
+      return xsk;
+    }
+    lagopus_msg_info("ifindex %d queue %u: zero-copy is not available (%s), "
+                     "use copy mode\n", ifindex, queue, strerror(errno));
+  }
+  xsk = xsk_open(ifindex, queue, XDP_COPY | XDP_USE_NEED_WAKEUP);
+  if (xsk == NULL) {
+    lagopus_msg_warning("ifindex %d queue %u: AF_XDP: %s\n",
+                        ifindex, queue, strerror(errno));
+  }
+  return xsk;
+}
+
+void
+afxdp_socket_destroy(struct afxdp_socket *xsk) {
+  if (xsk == NULL) {
+    return;
+  }
+  xsk_ring_unmap(&xsk->rx);
+  xsk_ring_unmap(&xsk->tx);
+  xsk_ring_unmap(&xsk->fill);
+  xsk_ring_unmap(&xsk->comp);
+  close(xsk->fd);
+  munmap(xsk->umem, xsk->umem_size);
+  lagopus_spinlock_finalize(&xsk->tx_lock);
+  free(xsk);
+}
+
+int
+afxdp_socket_fd(const struct afxdp_socket *xsk) {
+  return xsk->fd;
+}
+
+size_t
+afxdp_socket_rx_burst(struct afxdp_socket *xsk,
+                      struct lagopus_packet *pkts[], size_t nb) {
+  struct xdp_desc *desc;
+  struct lagopus_packet *pkt;
+  uint64_t *fill;
+  uint32_t cons, prod, fill_prod;
+  size_t n, len;
+  OS_MBUF *m;
+
+  cons = *xsk->rx.consumer;
+  prod = *(volatile uint32_t *)xsk->rx.producer;
+  /* read descriptors only after producer is observed. */
+  mbar();
+  fill = xsk->fill.desc;
+  fill_prod = *xsk->fill.producer;
+  for (n = 0; n < nb && cons != prod; n++, cons++) {
+    desc = &((struct xdp_desc *)xsk->rx.desc)[cons & xsk->rx.mask];
+    pkt = alloc_lagopus_packet();
+    if (pkt == NULL) {
+      break;
+    }
+    m = PKT2MBUF(pkt);
+    len = desc->len;
+    if (len > MAX_PACKET_SZ) {
+      len = MAX_PACKET_SZ;
+    }
+    OS_MEMCPY(OS_MTOD(m, uint8_t *), xsk->umem + desc->addr, len);
+    (void)OS_M_APPEND(m, len);
+    pkts[n] = pkt;
+    /* give the frame back to the kernel. */
+    fill[fill_prod++ & xsk->fill.mask] =
+      desc->addr & ~(uint64_t)(AFXDP_FRAME_SIZE - 1);
+  }
+  if (n != 0) {
+    mbar();
+    *xsk->rx.consumer = cons;
+    *xsk->fill.producer = fill_prod;
+    if ((*(volatile uint32_t *)xsk->fill.flags & XDP_RING_NEED_WAKEUP) != 0) {
+      (void)recvfrom(xsk->fd, NULL, 0, MSG_DONTWAIT, NULL, NULL);
+    }
+  }
+  return n;
+}
+
+static void
+tx_reclaim_locked(struct afxdp_socket *xsk) {
+  uint64_t *comp;
+  uint32_t cons, prod;
+
+  cons = *xsk->comp.consumer;
+  prod = *(volatile uint32_t *)xsk->comp.producer;
+  mbar();
+  comp = xsk->comp.desc;
+  while (cons != prod) {
+    xsk->tx_free[xsk->tx_nfree++] = comp[cons++ & xsk->comp.mask];
+  }
+  mbar();
+  *xsk->comp.consumer = cons;
+}
+
+static void
+tx_flush_locked(struct afxdp_socket *xsk) {
+  if (xsk->tx_pending != 0) {
+    if ((*(volatile uint32_t *)xsk->tx.flags & XDP_RING_NEED_WAKEUP) != 0 &&
+        sendto(xsk->fd, NULL, 0, MSG_DONTWAIT, NULL, 0) < 0 &&
+        errno != EAGAIN && errno != EBUSY && errno != ENOBUFS &&
+        errno != ENETDOWN) {
+      lagopus_msg_warning("sendto: %s\n", strerror(errno));
+    }
+    xsk->tx_pending = 0;
+  }
+  tx_reclaim_locked(xsk);
+}
+
+lagopus_result_t
+afxdp_socket_tx_enqueue(struct afxdp_socket *xsk,
+                        const uint8_t *data, size_t len) {
+  struct xdp_desc *desc;
+  uint32_t prod;
+  uint64_t addr;
+
+  if (len > AFXDP_FRAME_SIZE) {
+    return LAGOPUS_RESULT_TOO_LONG;
+  }
+  lagopus_spinlock_lock(&xsk->tx_lock);
+  if (xsk->tx_nfree == 0) {
+    tx_flush_locked(xsk);
+    if (xsk->tx_nfree == 0) {
+      lagopus_spinlock_unlock(&xsk->tx_lock);
+      return LAGOPUS_RESULT_NO_MEMORY;
+    }
+  }
+  addr = xsk->tx_free[--xsk->tx_nfree];
+  OS_MEMCPY(xsk->umem + addr, data, len);
+  prod = *xsk->tx.producer;
+  desc = &((struct xdp_desc *)xsk->tx.desc)[prod & xsk->tx.mask];
+  desc->addr = addr;
+  desc->len = (uint32_t)len;
+  desc->options = 0;
+  mbar();
+  *xsk->tx.producer = prod + 1;
+  xsk->tx_pending++;
+  lagopus_spinlock_unlock(&xsk->tx_lock);
+  return LAGOPUS_RESULT_OK;
+}
+
+void
+afxdp_socket_tx_flush(struct afxdp_socket *xsk) {
+  lagopus_spinlock_lock(&xsk->tx_lock);
+  tx_flush_locked(xsk);
+  lagopus_spinlock_unlock(&xsk->tx_lock);
+}
+
+bool
+afxdp_socket_tx_pending(const struct afxdp_socket *xsk) {
+  return xsk->tx_pending != 0;
+}
+
+#else /* AF_XDP && XDP_USE_NEED_WAKEUP && __NR_bpf */
+
+struct afxdp_prog *
+afxdp_prog_attach(int ifindex, bool generic) {
+  (void) ifindex;
+  (void) generic;
+  lagopus_msg_warning("AF_XDP is not supported\n");
+  return NULL;
+}
+
+void
+afxdp_prog_detach(struct afxdp_prog *prog) {
+  (void) prog;
+}
+
+bool
+afxdp_prog_is_generic(const struct afxdp_prog *prog) {
+  (void) prog;
+  return false;
+}
+
+lagopus_result_t
+afxdp_prog_register(struct afxdp_prog *prog, uint32_t queue,
+                    struct afxdp_socket *xsk) {
+  (void) prog;
+  (void) queue;
+  (void) xsk;
+  return LAGOPUS_RESULT_UNSUPPORTED;
+}
+
+struct afxdp_socket *
+afxdp_socket_create(int ifindex, uint32_t queue, bool zerocopy) {
+  (void) ifindex;
+  (void) queue;
+  (void) zerocopy;
+  return NULL;
+}
+
+void
+afxdp_socket_destroy(struct afxdp_socket *xsk) {
+  (void) xsk;
+}
+
+int
+afxdp_socket_fd(const struct afxdp_socket *xsk) {
+  (void) xsk;
+  return -1;
+}
+
+size_t
+afxdp_socket_rx_burst(struct afxdp_socket *xsk,
+                      struct lagopus_packet *pkts[], size_t nb) {
+  (void) xsk;
+  (void) pkts;
+  (void) nb;
+  return 0;
+}
+
+lagopus_result_t
+afxdp_socket_tx_enqueue(struct afxdp_socket *xsk,
+                        const uint8_t *data, size_t len) {
+  (void) xsk;
+  (void) data;
+  (void) len;
+  return LAGOPUS_RESULT_UNSUPPORTED;
+}
+
+void
+afxdp_socket_tx_flush(struct afxdp_socket *xsk) {
+  (void) xsk;
+}
+
+bool
+afxdp_socket_tx_pending(const struct afxdp_socket *xsk) {
+  (void) xsk;
+  return false;
+}
+
+#endif /* AF_XDP && XDP_USE_NEED_WAKEUP && __NR_bpf */
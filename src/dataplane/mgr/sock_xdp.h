@@ -0,0 +1,149 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ *      @file   sock_xdp.h
+ *      @brief  AF_XDP socket for ethernet-afxdp interface.
+ */
+
+#ifndef SRC_DATAPLANE_MGR_SOCK_XDP_H_
+#define SRC_DATAPLANE_MGR_SOCK_XDP_H_
+
+/* UMEM geometry. */
+#define AFXDP_FRAME_SIZE      2048
+#define AFXDP_NUM_FRAMES      4096
+#define AFXDP_RING_SIZE       2048
+
+/* max number of packets received at once. */
+#define AFXDP_RX_BURST        32
+
+struct afxdp_prog;
+struct afxdp_socket;
+struct lagopus_packet;
+
+/**
+ * Load XDP program redirecting all RX queues to XSKMAP and attach it
+ * to the interface.
+ *
+ * @param[in]   ifindex Interface index.
+ * @param[in]   generic Use generic (SKB) XDP mode instead of driver mode.
+ *
+ * @retval      !=NULL  XDP program object.
+ * @retval      NULL    Failed to load or attach.
+ */
+struct afxdp_prog *afxdp_prog_attach(int ifindex, bool generic);
+
+/**
+ * Detach XDP program from the interface and release it.
+ *
+ * @param[in]   prog    XDP program object.
+ */
+void afxdp_prog_detach(struct afxdp_prog *prog);
+
+/**
+ * Check whether XDP program is running in generic mode.
+ *
+ * @param[in]   prog    XDP program object.
+ */
+bool afxdp_prog_is_generic(const struct afxdp_prog *prog);
+
+/**
+ * Redirect packets received on the queue to the socket.
+ *
+ * @param[in]   prog    XDP program object.
+ * @param[in]   queue   RX queue id.
+ * @param[in]   xsk     AF_XDP socket bound to the queue.
+ *
+ * @retval      LAGOPUS_RESULT_OK               Succeeded.
+ * @retval      LAGOPUS_RESULT_POSIX_API_ERROR  bpf(2) failed.
+ */
+lagopus_result_t afxdp_prog_register(struct afxdp_prog *prog, uint32_t queue,
+                                     struct afxdp_socket *xsk);
+
+/**
+ * Create AF_XDP socket with its own UMEM and bind it to the queue.
+ * If zero-copy bind is requested but not supported by the driver,
+ * copy mode bind is used.  Zero-copy bind lets the driver use UMEM
+ * directly, frames are still copied between UMEM and packet buffers
+ * by afxdp_socket_rx_burst() and afxdp_socket_tx_enqueue().
+ *
+ * @param[in]   ifindex         Interface index.
+ * @param[in]   queue           RX queue id.
+ * @param[in]   zerocopy        Try zero-copy mode.
+ *
+ * @retval      !=NULL  AF_XDP socket.
+ * @retval      NULL    Failed to create.
+ */
+struct afxdp_socket *afxdp_socket_create(int ifindex, uint32_t queue,
+                                         bool zerocopy);
+
+/**
+ * Close the socket and release UMEM.
+ *
+ * @param[in]   xsk     AF_XDP socket.
+ */
+void afxdp_socket_destroy(struct afxdp_socket *xsk);
+
+/**
+ * Get file descriptor of the socket for poll(2).
+ *
+ * @param[in]   xsk     AF_XDP socket.
+ */
+int afxdp_socket_fd(const struct afxdp_socket *xsk);
+
+/**
+ * Receive packets from the RX ring.  Frames are copied into newly
+ * allocated lagopus packets and returned to the fill ring at once.
+ *
+ * @param[in]   xsk     AF_XDP socket.
+ * @param[out]  pkts    Received packets.
+ * @param[in]   nb      Size of pkts.
+ *
+ * @retval      Number of received packets.
+ */
+size_t afxdp_socket_rx_burst(struct afxdp_socket *xsk,
+                             struct lagopus_packet *pkts[], size_t nb);
+
+/**
+ * Copy a frame into a free UMEM frame and queue it to the TX ring.
+ * Frame is not transmitted until afxdp_socket_tx_flush() is called.
+ *
+ * @param[in]   xsk     AF_XDP socket.
+ * @param[in]   data    Frame.
+ * @param[in]   len     Length of the frame.
+ *
+ * @retval      LAGOPUS_RESULT_OK               Queued.
+ * @retval      LAGOPUS_RESULT_TOO_LONG         Frame is larger than UMEM frame.
+ * @retval      LAGOPUS_RESULT_NO_MEMORY        No free TX frame.
+ */
+lagopus_result_t afxdp_socket_tx_enqueue(struct afxdp_socket *xsk,
+                                         const uint8_t *data, size_t len);
+
+/**
+ * Kick the kernel to transmit queued frames, and reclaim completed frames.
+ *
+ * @param[in]   xsk     AF_XDP socket.
+ */
+void afxdp_socket_tx_flush(struct afxdp_socket *xsk);
+
+/**
+ * Check whether TX ring has frames not kicked yet.
+ *
+ * @param[in]   xsk     AF_XDP socket.
+ */
+bool afxdp_socket_tx_pending(const struct afxdp_socket *xsk);
+
+#endif /* SRC_DATAPLANE_MGR_SOCK_XDP_H_ */
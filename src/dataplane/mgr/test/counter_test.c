@@ -0,0 +1,164 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include "unity.h"
+
+#include "lagopus_apis.h"
+#include "lagopus/flowdb.h"
+#include "counter.h"
+
+#define NTHREADS 4
+#define NLOOPS 100000
+
+struct counter_arg {
+  pthread_t tid;
+  uint32_t id;
+};
+
+void
+setUp(void) {
+}
+
+void
+tearDown(void) {
+}
+
+void
+test_dp_counter_add_get(void) {
+  struct dp_counter counter;
+  uint32_t id;
+
+  id = dp_counter_alloc();
+  TEST_ASSERT_NOT_EQUAL(id, DP_COUNTER_NONE);
+  dp_counter_get(id, &counter);
+  TEST_ASSERT_EQUAL(counter.packets, 0);
+  TEST_ASSERT_EQUAL(counter.bytes, 0);
+
+  dp_counter_add(id, 1, 64);
+  dp_counter_add(id, 2, 128);
+  dp_counter_get(id, &counter);
+  TEST_ASSERT_EQUAL(counter.packets, 3);
+  TEST_ASSERT_EQUAL(counter.bytes, 192);
+
+  dp_counter_reset(id);
+  dp_counter_get(id, &counter);
+  TEST_ASSERT_EQUAL(counter.packets, 0);
+  TEST_ASSERT_EQUAL(counter.bytes, 0);
+  dp_counter_add(id, 1, 64);
+  dp_counter_get(id, &counter);
+  TEST_ASSERT_EQUAL(counter.packets, 1);
+  TEST_ASSERT_EQUAL(counter.bytes, 64);
+  dp_counter_free(id);
+}
+
+void
+test_dp_counter_reuse(void) {
+  struct dp_counter counter;
+  uint32_t id, id2;
+
+  id = dp_counter_alloc();
+  dp_counter_add(id, 10, 640);
+  dp_counter_free(id);
+
+  /* freed id is reused, starts from zero. */
+  id2 = dp_counter_alloc();
+  TEST_ASSERT_EQUAL(id2, id);
+  dp_counter_get(id2, &counter);
+  TEST_ASSERT_EQUAL(counter.packets, 0);
+  TEST_ASSERT_EQUAL(counter.bytes, 0);
+  dp_counter_free(id2);
+}
+
+void
+test_dp_counter_seen(void) {
+  struct dp_counter counter;
+  uint32_t id;
+
+  id = dp_counter_alloc();
+  dp_counter_clock = 100;
+  dp_counter_add(id, 1, 64);
+  dp_counter_clock = 200;
+  dp_counter_add(id, 1, 64);
+  dp_counter_get(id, &counter);
+  TEST_ASSERT_EQUAL(counter.seen, 200);
+
+  /* time of last update is kept over reset. */
+  dp_counter_reset(id);
+  dp_counter_get(id, &counter);
+  TEST_ASSERT_EQUAL(counter.packets, 0);
+  TEST_ASSERT_EQUAL(counter.seen, 200);
+  dp_counter_free(id);
+
+  dp_counter_clock_update();
+  TEST_ASSERT_TRUE(dp_counter_clock >= get_current_time().tv_sec - 1);
+}
+
+void
+test_dp_counter_none(void) {
+  struct dp_counter counter;
+
+  dp_counter_add(DP_COUNTER_NONE, 1, 64);
+  dp_counter_get(DP_COUNTER_NONE, &counter);
+  TEST_ASSERT_EQUAL(counter.packets, 0);
+  TEST_ASSERT_EQUAL(counter.bytes, 0);
+  dp_counter_free(DP_COUNTER_NONE);
+}
+
+static void *
+counter_loop(void *arg) {
+  struct counter_arg *carg;
+  int i;
+
+  carg = arg;
+  for (i = 0; i < NLOOPS; i++) {
+    dp_counter_add(carg->id, 1, 64);
+  }
+  return NULL;
+}
+
+void
+test_dp_counter_threads(void) {
+  struct counter_arg cargs[NTHREADS];
+  struct dp_counter counter;
+  uint32_t id;
+  int i;
+
+  id = dp_counter_alloc();
+  for (i = 0; i < NTHREADS; i++) {
+    cargs[i].id = id;
+    TEST_ASSERT_EQUAL(pthread_create(&cargs[i].tid, NULL,
+                                     counter_loop, &cargs[i]), 0);
+  }
+  for (i = 0; i < NTHREADS; i++) {
+    pthread_join(cargs[i].tid, NULL);
+  }
+
+  /* counts of exited threads are kept. */
+  dp_counter_get(id, &counter);
+  TEST_ASSERT_EQUAL(counter.packets, (uint64_t)NTHREADS * NLOOPS);
+  TEST_ASSERT_EQUAL(counter.bytes, (uint64_t)NTHREADS * NLOOPS * 64);
+
+  /* shards of exited threads are taken over. */
+  for (i = 0; i < NTHREADS; i++) {
+    TEST_ASSERT_EQUAL(pthread_create(&cargs[i].tid, NULL,
+                                     counter_loop, &cargs[i]), 0);
+    pthread_join(cargs[i].tid, NULL);
+  }
+  dp_counter_get(id, &counter);
+  TEST_ASSERT_EQUAL(counter.packets, (uint64_t)2 * NTHREADS * NLOOPS);
+  dp_counter_free(id);
+}
@@ -23,12 +23,15 @@
 #include "lagopus/group.h"
 #include "lagopus/ethertype.h"
 #include "lagopus/dp_apis.h"
+#include "lagopus/ofp_dp_apis.h"
 #include "openflow13.h"
 #include "ofp_action.h"
 #include "ofp_match.h"
 #include "ofp_instruction.h"
 #include "datapath_test_misc.h"
 #include "datapath_test_misc_macros.h"
+#include "counter.h"
+#include "dp_timer.h"
 
 /* Create packet data. */
 #define BUF_SIZE 65535
@@ -498,6 +501,188 @@ test_flowdb_flow_add(void) {
   FLOWDB_DUMP(flowdb, "After cleanup", stdout);
 }
 
+void
+test_flowdb_table_classifier_set(void) {
+  struct table *table;
+  struct flow *flow;
+  struct ofp_flow_mod flow_mod;
+  struct match_list match_list;
+  struct instruction_list instruction_list;
+  struct ofp_error error;
+  int i;
+
+  TAILQ_INIT(&match_list);
+  TAILQ_INIT(&instruction_list);
+
+  flowinfo_init();
+
+  memset(&flow_mod, 0, sizeof(flow_mod));
+  flow_mod.table_id = 0;
+  flow_mod.out_port = OFPP_ANY;
+  flow_mod.out_group = OFPG_ANY;
+
+  table = flowdb_get_table(flowdb, flow_mod.table_id);
+  TEST_ASSERT_NOT_NULL(table);
+  TEST_ASSERT_EQUAL(flowdb_table_classifier_set(flowdb, 0,
+                                                TABLE_CLASSIFIER_MAX),
+                    LAGOPUS_RESULT_INVALID_ARGS);
+
+  for (i = 0; i < 4; i++) {
+    flow_mod.priority = (uint16_t)(i + 1);
+    make_match(&match_list,
+               2,
+               2, OFPXMT_OFB_ETH_TYPE << 1, ETHERTYPE_IP,
+               4, OFPXMT_OFB_IPV4_DST << 1, 0x0a000000 + (uint32_t)i);
+    TEST_ASSERT_FLOW_ADD_OK(bridge, &flow_mod, &match_list,
+                            &instruction_list, &error);
+  }
+  TEST_ASSERT_TABLE_NFLOW(&table, MISC_FLOWS, 4);
+
+  /* flows are moved to the new classifier. */
+  TEST_ASSERT_EQUAL(flowdb_table_classifier_set(flowdb, 0,
+                                                TABLE_CLASSIFIER_THTABLE),
+                    LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(table->classifier, TABLE_CLASSIFIER_THTABLE);
+  TEST_ASSERT_NOT_NULL(table->userdata);
+  for (i = 0; i < 4; i++) {
+    flow = table->flow_list->flows[i];
+    TEST_ASSERT_TRUE(lagopus_find_flow_hook(flow, table) == flow);
+  }
+
+  /* flows added after the switch go to the new classifier. */
+  flow_mod.priority = 10;
+  make_match(&match_list,
+             1,
+             2, OFPXMT_OFB_ETH_TYPE << 1, ETHERTYPE_IPV6);
+  TEST_ASSERT_FLOW_ADD_OK(bridge, &flow_mod, &match_list,
+                          &instruction_list, &error);
+  TEST_ASSERT_TABLE_NFLOW(&table, MISC_FLOWS, 5);
+
+  /* and back. */
+  TEST_ASSERT_EQUAL(flowdb_table_classifier_set(flowdb, 0,
+                                                TABLE_CLASSIFIER_FLOWINFO),
+                    LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(table->classifier, TABLE_CLASSIFIER_FLOWINFO);
+  for (i = 0; i < 5; i++) {
+    flow = table->flow_list->flows[i];
+    TEST_ASSERT_TRUE(lagopus_find_flow_hook(flow, table) == flow);
+  }
+
+  /* Cleanup. */
+  TEST_ASSERT_FLOW_DELETE_OK(bridge, &flow_mod, &match_list, &error);
+  TEST_ASSERT_TABLE_NFLOW(&table, MISC_FLOWS, 0);
+}
+
+void
+test_flowdb_table_classifier_auto(void) {
+  struct table *table;
+  struct flow *flow;
+  struct ofp_flow_mod flow_mod;
+  struct match_list match_list;
+  struct instruction_list instruction_list;
+  struct ofp_error error;
+  enum table_classifier classifier;
+  bool is_auto;
+  uint32_t src, mask;
+  int i;
+
+  TAILQ_INIT(&match_list);
+  TAILQ_INIT(&instruction_list);
+
+  flowinfo_init();
+
+  memset(&flow_mod, 0, sizeof(flow_mod));
+  flow_mod.table_id = 0;
+  flow_mod.out_port = OFPP_ANY;
+  flow_mod.out_group = OFPG_ANY;
+
+  table = flowdb_get_table(flowdb, flow_mod.table_id);
+  TEST_ASSERT_NOT_NULL(table);
+  TEST_ASSERT_EQUAL(flowdb_table_classifier_set(flowdb, 0,
+                                                TABLE_CLASSIFIER_AUTO),
+                    LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(flowdb_table_classifier_get(flowdb, 0, &classifier,
+                                                &is_auto),
+                    LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(classifier, TABLE_CLASSIFIER_FLOWINFO);
+  TEST_ASSERT_TRUE(is_auto);
+
+  /* many flows without masks are for exact match. */
+  for (i = 0; i < 128; i++) {
+    flow_mod.priority = (uint16_t)(i + 1);
+    make_match(&match_list,
+               4,
+               2, OFPXMT_OFB_ETH_TYPE << 1, ETHERTYPE_IP,
+               1, OFPXMT_OFB_IP_PROTO << 1, IPPROTO_TCP,
+               4, OFPXMT_OFB_IPV4_DST << 1, 0x0a000000 + (uint32_t)i,
+               2, OFPXMT_OFB_TCP_DST << 1, 80);
+    TEST_ASSERT_FLOW_ADD_OK(bridge, &flow_mod, &match_list,
+                            &instruction_list, &error);
+  }
+  TEST_ASSERT_EQUAL(table->flow_match_type_count[OFPXMT_OFB_TCP_DST], 128);
+  TEST_ASSERT_TRUE(table->profile_pending);
+  flowdb_classifier_update(flowdb);
+  TEST_ASSERT_FALSE(table->profile_pending);
+  TEST_ASSERT_EQUAL(table->classifier, TABLE_CLASSIFIER_EXACT);
+
+  /* many flows of a few masks are for tuple space search. */
+  for (i = 0; i < 32; i++) {
+    flow_mod.priority = (uint16_t)(i + 500);
+    mask = (uint32_t)~0 << (8 + (i % 4) * 4);
+    make_match(&match_list,
+               4,
+               2, OFPXMT_OFB_ETH_TYPE << 1, ETHERTYPE_IP,
+               1, OFPXMT_OFB_IP_PROTO << 1, IPPROTO_TCP,
+               8, (OFPXMT_OFB_IPV4_DST << 1) + 1,
+               (0x0b000000 + ((uint32_t)i << 8)) & mask, mask,
+               2, OFPXMT_OFB_TCP_DST << 1, 80);
+    TEST_ASSERT_FLOW_ADD_OK(bridge, &flow_mod, &match_list,
+                            &instruction_list, &error);
+  }
+  TEST_ASSERT_TRUE(table->profile_pending);
+  flowdb_classifier_update(flowdb);
+  TEST_ASSERT_EQUAL(table->classifier, TABLE_CLASSIFIER_THTABLE);
+
+  /* masks of each flow are for the decision tree. */
+  for (i = 0; i < 128; i++) {
+    flow_mod.priority = (uint16_t)(i + 1000);
+    mask = (uint32_t)~0 << (31 - i % 32);
+    src = (0xc0a80000 + (uint32_t)i) & mask;
+    make_match(&match_list,
+               4,
+               2, OFPXMT_OFB_ETH_TYPE << 1, ETHERTYPE_IP,
+               1, OFPXMT_OFB_IP_PROTO << 1, IPPROTO_TCP,
+               8, (OFPXMT_OFB_IPV4_SRC << 1) + 1, src, mask,
+               2, OFPXMT_OFB_TCP_SRC << 1, 1024 + i / 32);
+    TEST_ASSERT_FLOW_ADD_OK(bridge, &flow_mod, &match_list,
+                            &instruction_list, &error);
+  }
+  flowdb_classifier_update(flowdb);
+  TEST_ASSERT_EQUAL(table->classifier, TABLE_CLASSIFIER_MBTREE);
+  for (i = 0; i < 288; i++) {
+    flow = table->flow_list->flows[i];
+    TEST_ASSERT_TRUE(lagopus_find_flow_hook(flow, table) == flow);
+  }
+
+  /* fixed classifier is not changed. */
+  TEST_ASSERT_EQUAL(flowdb_table_classifier_set(flowdb, 0,
+                                                TABLE_CLASSIFIER_FLOWINFO),
+                    LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(flowdb_table_classifier_get(flowdb, 0, &classifier,
+                                                &is_auto),
+                    LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(classifier, TABLE_CLASSIFIER_FLOWINFO);
+  TEST_ASSERT_FALSE(is_auto);
+  table->profile_pending = true;
+  flowdb_classifier_update(flowdb);
+  TEST_ASSERT_EQUAL(table->classifier, TABLE_CLASSIFIER_FLOWINFO);
+
+  /* Cleanup. */
+  TEST_ASSERT_FLOW_DELETE_OK(bridge, &flow_mod, &match_list, &error);
+  TEST_ASSERT_TABLE_NFLOW(&table, MISC_FLOWS, 0);
+  TEST_ASSERT_EQUAL(table->flow_match_type_count[OFPXMT_OFB_TCP_DST], 0);
+}
+
 /*
  * XXX these macros depend on build_metadata() and md_*.
  */
@@ -861,6 +1046,266 @@ test_flowdb_flow_stats(void) {
   FLOWDB_DUMP(flowdb, "After cleanup", stdout);
 }
 
+struct walk_arg {
+  int limit;                    /* flows accepted per walk. */
+  int count;                    /* flows accepted in this walk. */
+  int total;
+  uint32_t seen;                /* bit per priority. */
+  int table_id;
+};
+
+static lagopus_result_t
+walk_proc(void *arg, const struct ofp_flow_stats *flow_stats,
+          struct match_list *match_list,
+          struct instruction_list *instruction_list) {
+  struct walk_arg *warg = arg;
+
+  (void) match_list;
+  (void) instruction_list;
+
+  if (warg->count == warg->limit) {
+    return LAGOPUS_RESULT_OUT_OF_RANGE;
+  }
+  TEST_ASSERT_TRUE(flow_stats->table_id >= warg->table_id);
+  warg->table_id = flow_stats->table_id;
+  warg->seen |= 1U << flow_stats->priority;
+  warg->count++;
+  warg->total++;
+  return LAGOPUS_RESULT_OK;
+}
+
+void
+test_flowdb_flow_stats_walk(void) {
+  struct table *table;
+  struct ofp_flow_mod flow_mod;
+  struct match_list match_list;
+  struct instruction_list instruction_list;
+  struct ofp_flow_stats_request request;
+  struct flow_stats_cursor cursor;
+  struct walk_arg warg;
+  struct ofp_error error;
+  int i, nwalk;
+
+  TAILQ_INIT(&match_list);
+  TAILQ_INIT(&instruction_list);
+
+  /* Add 10 flows to table 5 and 1 flow to table 7. */
+  memset(&flow_mod, 0, sizeof(flow_mod));
+  flow_mod.out_port = OFPP_ANY;
+  flow_mod.out_group = OFPG_ANY;
+  for (i = 0; i < 11; i++) {
+    flow_mod.table_id = (i < 10) ? 5 : 7;
+    flow_mod.priority = (uint16_t)i;
+    TEST_ASSERT_FLOW_ADD_OK(bridge, &flow_mod, &match_list,
+                            &instruction_list, &error);
+  }
+  table = table_lookup(flowdb, 5);
+  TEST_ASSERT_TABLE_NFLOW(&table, MISC_FLOWS, 10);
+
+  /* all tables, 3 flows per walk. */
+  memset(&request, 0, sizeof(request));
+  request.table_id = OFPTT_ALL;
+  memset(&cursor, 0, sizeof(cursor));
+  memset(&warg, 0, sizeof(warg));
+  warg.limit = 3;
+  for (nwalk = 0; cursor.done == false; nwalk++) {
+    TEST_ASSERT_TRUE(nwalk < 10);
+    warg.count = 0;
+    TEST_ASSERT_EQUAL(ofp_flow_stats_walk(dpid, &request, &match_list,
+                                          &cursor, walk_proc, &warg,
+                                          &error),
+                      LAGOPUS_RESULT_OK);
+  }
+  TEST_ASSERT_EQUAL(nwalk, 4);
+  TEST_ASSERT_EQUAL(warg.total, 11);
+  TEST_ASSERT_EQUAL(warg.seen, 0x7ff);
+  TEST_ASSERT_EQUAL(warg.table_id, 7);
+
+  /* single table, filtered by cookie. */
+  request.table_id = 5;
+  request.cookie = 1;
+  request.cookie_mask = 1;
+  memset(&cursor, 0, sizeof(cursor));
+  memset(&warg, 0, sizeof(warg));
+  warg.limit = 100;
+  TEST_ASSERT_EQUAL(ofp_flow_stats_walk(dpid, &request, &match_list,
+                                        &cursor, walk_proc, &warg, &error),
+                    LAGOPUS_RESULT_OK);
+  TEST_ASSERT_TRUE(cursor.done);
+  TEST_ASSERT_EQUAL(warg.total, 0);
+
+  request.cookie = 0;
+  request.cookie_mask = 0;
+  memset(&cursor, 0, sizeof(cursor));
+  TEST_ASSERT_EQUAL(ofp_flow_stats_walk(dpid, &request, &match_list,
+                                        &cursor, walk_proc, &warg, &error),
+                    LAGOPUS_RESULT_OK);
+  TEST_ASSERT_TRUE(cursor.done);
+  TEST_ASSERT_EQUAL(warg.total, 10);
+  TEST_ASSERT_EQUAL(warg.seen, 0x3ff);
+
+  /* unknown bridge. */
+  memset(&cursor, 0, sizeof(cursor));
+  TEST_ASSERT_EQUAL(ofp_flow_stats_walk(dpid + 1, &request, &match_list,
+                                        &cursor, walk_proc, &warg, &error),
+                    LAGOPUS_RESULT_NOT_FOUND);
+
+  /* Cleanup. */
+  flow_mod.table_id = OFPTT_ALL;
+  TEST_ASSERT_FLOW_DELETE_OK(bridge, &flow_mod, &match_list, &error);
+  TEST_ASSERT_TABLE_NFLOW(&table, MISC_FLOWS, 0);
+}
+
+#define CHURN_FLOWS     24
+#define CHURN_COOKIE_MAX 128
+
+struct churn_arg {
+  int limit;                    /* flows accepted per walk. */
+  int count;                    /* flows accepted in this walk. */
+  int nseen;
+  uint64_t order[CHURN_COOKIE_MAX];     /* cookies in reported order. */
+  int seen[CHURN_COOKIE_MAX];   /* times reported, by cookie. */
+};
+
+static lagopus_result_t
+churn_proc(void *arg, const struct ofp_flow_stats *flow_stats,
+           struct match_list *match_list,
+           struct instruction_list *instruction_list) {
+  struct churn_arg *carg = arg;
+
+  (void) match_list;
+  (void) instruction_list;
+
+  if (carg->count == carg->limit) {
+    return LAGOPUS_RESULT_OUT_OF_RANGE;
+  }
+  TEST_ASSERT_TRUE(flow_stats->cookie < CHURN_COOKIE_MAX);
+  carg->seen[flow_stats->cookie]++;
+  carg->order[carg->nseen++] = flow_stats->cookie;
+  carg->count++;
+  return LAGOPUS_RESULT_OK;
+}
+
+static void
+churn_flow_add(uint16_t priority, uint32_t port, uint64_t cookie) {
+  struct ofp_flow_mod flow_mod;
+  struct match_list match_list;
+  struct instruction_list instruction_list;
+  struct ofp_error error;
+
+  TAILQ_INIT(&match_list);
+  TAILQ_INIT(&instruction_list);
+  memset(&flow_mod, 0, sizeof(flow_mod));
+  flow_mod.table_id = 5;
+  flow_mod.priority = priority;
+  flow_mod.cookie = cookie;
+  flow_mod.out_port = OFPP_ANY;
+  flow_mod.out_group = OFPG_ANY;
+  add_port_match(&match_list, port);
+  TEST_ASSERT_FLOW_ADD_OK(bridge, &flow_mod, &match_list,
+                          &instruction_list, &error);
+}
+
+static void
+churn_flow_delete(uint64_t cookie) {
+  struct ofp_flow_mod flow_mod;
+  struct match_list match_list;
+  struct ofp_error error;
+
+  TAILQ_INIT(&match_list);
+  memset(&flow_mod, 0, sizeof(flow_mod));
+  flow_mod.table_id = 5;
+  flow_mod.command = OFPFC_DELETE;
+  flow_mod.cookie = cookie;
+  flow_mod.cookie_mask = UINT64_MAX;
+  flow_mod.out_port = OFPP_ANY;
+  flow_mod.out_group = OFPG_ANY;
+  TEST_ASSERT_FLOW_DELETE_OK(bridge, &flow_mod, &match_list, &error);
+}
+
+void
+test_flowdb_flow_stats_walk_churn(void) {
+  struct table *table;
+  struct ofp_flow_mod flow_mod;
+  struct match_list match_list;
+  struct ofp_flow_stats_request request;
+  struct flow_stats_cursor cursor;
+  struct churn_arg carg;
+  struct ofp_error error;
+  bool deleted[CHURN_COOKIE_MAX];
+  uint64_t cookie, next_cookie;
+  int i, nwalk, ndeleted;
+
+  /*
+   * 4 flows per priority 0..5, cookie 1..24 identifies the flow.
+   * Same priority flows are distinguished by in_port.
+   */
+  for (i = 0; i < CHURN_FLOWS; i++) {
+    churn_flow_add((uint16_t)(i / 4), (uint32_t)(i + 1), (uint64_t)(i + 1));
+  }
+  table = table_lookup(flowdb, 5);
+  TEST_ASSERT_TABLE_NFLOW(&table, MISC_FLOWS, CHURN_FLOWS);
+
+  memset(&request, 0, sizeof(request));
+  request.table_id = 5;
+  request.out_port = OFPP_ANY;
+  request.out_group = OFPG_ANY;
+  TAILQ_INIT(&match_list);
+  memset(&cursor, 0, sizeof(cursor));
+  memset(&carg, 0, sizeof(carg));
+  memset(deleted, 0, sizeof(deleted));
+  carg.limit = 5;
+  next_cookie = 100;
+  ndeleted = 0;
+  for (nwalk = 0; cursor.done == false; nwalk++) {
+    TEST_ASSERT_TRUE(nwalk < 20);
+    carg.count = 0;
+    TEST_ASSERT_EQUAL(ofp_flow_stats_walk(dpid, &request, &match_list,
+                                          &cursor, churn_proc, &carg,
+                                          &error),
+                      LAGOPUS_RESULT_OK);
+    if (cursor.done == true) {
+      break;
+    }
+    if ((nwalk % 2) == 0) {
+      /* add a flow in front of the cursor, which moves the rest back. */
+      churn_flow_add(6, (uint32_t)next_cookie, next_cookie);
+    } else {
+      /* delete a reported flow, which moves the rest forward. */
+      cookie = carg.order[ndeleted];
+      churn_flow_delete(cookie);
+      deleted[cookie] = true;
+      ndeleted++;
+      /* and add a flow behind the cursor. */
+      churn_flow_add(0, (uint32_t)next_cookie, next_cookie);
+    }
+    next_cookie++;
+  }
+  TEST_ASSERT_TRUE(ndeleted > 0);
+
+  /* every flow present through the walk is reported exactly once. */
+  for (cookie = 1; cookie <= CHURN_FLOWS; cookie++) {
+    if (deleted[cookie] == false) {
+      TEST_ASSERT_EQUAL(1, carg.seen[cookie]);
+    }
+  }
+  /* added flows are reported at most once. */
+  for (cookie = 100; cookie < next_cookie; cookie++) {
+    TEST_ASSERT_TRUE(carg.seen[cookie] <= 1);
+  }
+  /* flows added in front of the cursor are not reported, behind are. */
+  TEST_ASSERT_EQUAL(0, carg.seen[100]);
+  TEST_ASSERT_EQUAL(1, carg.seen[101]);
+
+  /* Cleanup. */
+  memset(&flow_mod, 0, sizeof(flow_mod));
+  flow_mod.table_id = OFPTT_ALL;
+  flow_mod.out_port = OFPP_ANY;
+  flow_mod.out_group = OFPG_ANY;
+  TEST_ASSERT_FLOW_DELETE_OK(bridge, &flow_mod, &match_list, &error);
+  TEST_ASSERT_TABLE_NFLOW(&table, MISC_FLOWS, 0);
+}
+
 void
 test_flowdb_flow_aggregate_stats(void) {
   struct table *table;
@@ -927,6 +1372,66 @@ test_flowdb_flow_aggregate_stats(void) {
   FLOWDB_DUMP(flowdb, "After cleanup", stdout);
 }
 
+void
+test_flowdb_flow_timer_expire(void) {
+  struct table *table;
+  struct ofp_flow_mod flow_mod;
+  struct match_list match_list;
+  struct instruction_list instruction_list;
+  struct ofp_error error;
+  time_t now;
+  int i;
+
+  TAILQ_INIT(&match_list);
+  TAILQ_INIT(&instruction_list);
+
+  /* hard timeout, idle timeout and permanent flows. */
+  now = get_current_time().tv_sec;
+  memset(&flow_mod, 0, sizeof(flow_mod));
+  flow_mod.table_id = 6;
+  flow_mod.flags = OFPFF_SEND_FLOW_REM;
+  flow_mod.out_port = OFPP_ANY;
+  flow_mod.out_group = OFPG_ANY;
+  flow_mod.priority = 1;
+  flow_mod.hard_timeout = 10;
+  TEST_ASSERT_FLOW_ADD_OK(bridge, &flow_mod, &match_list,
+                          &instruction_list, &error);
+  flow_mod.priority = 2;
+  flow_mod.hard_timeout = 0;
+  flow_mod.idle_timeout = 300;
+  TEST_ASSERT_FLOW_ADD_OK(bridge, &flow_mod, &match_list,
+                          &instruction_list, &error);
+  flow_mod.priority = 3;
+  flow_mod.idle_timeout = 0;
+  TEST_ASSERT_FLOW_ADD_OK(bridge, &flow_mod, &match_list,
+                          &instruction_list, &error);
+  table = table_lookup(flowdb, 6);
+  TEST_ASSERT_TABLE_NFLOW(&table, MISC_FLOWS, 3);
+
+  flow_timer_expire_all(now + 9);
+  TEST_ASSERT_TABLE_NFLOW(&table, MISC_FLOWS, 3);
+  flow_timer_expire_all(now + 10);
+  TEST_ASSERT_TABLE_NFLOW(&table, MISC_FLOWS, 2);
+
+  /* hit of the idle timeout flow is taken from the flow counter. */
+  for (i = 0; i < table->flow_list->nflow; i++) {
+    if (table->flow_list->flows[i]->priority == 2) {
+      dp_counter_clock = now + 200;
+      dp_counter_add(table->flow_list->flows[i]->counter_id, 1, 64);
+    }
+  }
+  flow_timer_expire_all(now + 300);
+  TEST_ASSERT_TABLE_NFLOW(&table, MISC_FLOWS, 2);
+  flow_timer_expire_all(now + 500);
+  TEST_ASSERT_TABLE_NFLOW(&table, MISC_FLOWS, 1);
+  TEST_ASSERT_EQUAL(table->flow_list->flows[0]->priority, 3);
+
+  /* Cleanup. */
+  flow_mod.table_id = OFPTT_ALL;
+  TEST_ASSERT_FLOW_DELETE_OK(bridge, &flow_mod, &match_list, &error);
+  TEST_ASSERT_TABLE_NFLOW(&table, MISC_FLOWS, 0);
+}
+
 void
 test_flowdb_switch_mode(void) {
   size_t i;
@@ -447,3 +447,212 @@ test_group_live_bucket(void) {
   TEST_ASSERT_EQUAL(rv, LAGOPUS_RESULT_OK);
   TEST_ASSERT_NULL(group_live_bucket(bridge, group));
 }
+
+static void
+select_bucket_list(struct bucket_list *bucket_list, uint32_t nbuckets,
+                   uint32_t except, uint32_t watch) {
+  struct bucket *bucket;
+  struct action *action;
+  uint32_t port;
+
+  TAILQ_INIT(bucket_list);
+  for (port = 1; port <= nbuckets; port++) {
+    if (port == except) {
+      continue;
+    }
+    action = action_alloc(sizeof(uint32_t));
+    TEST_ASSERT_NOT_NULL(action);
+    action->ofpat.type = OFPAT_OUTPUT;
+    ((struct ofp_action_output *)&action->ofpat)->port = port;
+    ((struct ofp_action_output *)&action->ofpat)->len =
+      sizeof(struct ofp_action_header) + sizeof(uint32_t);
+    bucket = calloc(1, sizeof(struct bucket));
+    TEST_ASSERT_NOT_NULL(bucket);
+    bucket->ofp.watch_port = (port <= watch ? port + 100 : OFPP_ANY);
+    bucket->ofp.watch_group = OFPG_ANY;
+    TAILQ_INIT(&bucket->action_list);
+    TAILQ_INSERT_TAIL(&bucket->action_list, action, entry);
+    TAILQ_INSERT_TAIL(bucket_list, bucket, entry);
+  }
+}
+
+static uint32_t
+select_output(struct bucket *bucket) {
+  struct action *action;
+
+  TEST_ASSERT_NOT_NULL(bucket);
+  action = TAILQ_FIRST(&bucket->action_list);
+  return ((struct ofp_action_output *)&action->ofpat)->port;
+}
+
+static void
+select_count(struct group *group, uint32_t *counts, uint32_t nbuckets) {
+  struct group_select *sel;
+  uint32_t i;
+
+  sel = group->select;
+  memset(counts, 0, sizeof(uint32_t) * (nbuckets + 1));
+  for (i = 0; i < sel->size; i++) {
+    counts[select_output(sel->table[i])]++;
+  }
+}
+
+void
+test_group_select_table(void) {
+  struct bridge *bridge;
+  struct group *group;
+  struct group_select *sel;
+  struct ofp_group_mod group_mod;
+  struct bucket_list bucket_list;
+  struct ofp_error error;
+  uint32_t counts[65], *ports, port, size, i;
+
+  bridge = dp_bridge_lookup("br0");
+  group_mod.group_id = 10;
+  group_mod.type = OFPGT_SELECT;
+  select_bucket_list(&bucket_list, 64, 0, 0);
+  group = group_alloc(&group_mod, &bucket_list);
+  TEST_ASSERT_NOT_NULL(group);
+  TEST_ASSERT_EQUAL(group_table_add(bridge->group_table, group, &error),
+                    LAGOPUS_RESULT_OK);
+  sel = group->select;
+  TEST_ASSERT_NOT_NULL(sel);
+  size = sel->size;
+  TEST_ASSERT_TRUE(size >= 64 * 100);
+
+  /* slots are shared equally. */
+  select_count(group, counts, 64);
+  for (port = 1; port <= 64; port++) {
+    TEST_ASSERT_TRUE(counts[port] == size / 64 ||
+                     counts[port] == size / 64 + 1);
+  }
+  ports = calloc(size, sizeof(uint32_t));
+  TEST_ASSERT_NOT_NULL(ports);
+  for (i = 0; i < size; i++) {
+    ports[i] = select_output(sel->table[i]);
+  }
+
+  /* remove bucket of port 10, only its slots move. */
+  select_bucket_list(&bucket_list, 64, 10, 0);
+  group_modify(group, &group_mod, &bucket_list);
+  sel = group->select;
+  TEST_ASSERT_NOT_NULL(sel);
+  TEST_ASSERT_EQUAL(sel->size, size);
+  for (i = 0; i < size; i++) {
+    port = select_output(sel->table[i]);
+    TEST_ASSERT_NOT_EQUAL(port, 10);
+    if (ports[i] != 10) {
+      TEST_ASSERT_EQUAL(port, ports[i]);
+    }
+    ports[i] = port;
+  }
+  select_count(group, counts, 64);
+  for (port = 1; port <= 64; port++) {
+    if (port != 10) {
+      TEST_ASSERT_TRUE(counts[port] == size / 63 ||
+                       counts[port] == size / 63 + 1);
+    }
+  }
+
+  /* add it again, only slots taken by it move. */
+  select_bucket_list(&bucket_list, 64, 0, 0);
+  group_modify(group, &group_mod, &bucket_list);
+  sel = group->select;
+  for (i = 0; i < size; i++) {
+    port = select_output(sel->table[i]);
+    if (port != 10) {
+      TEST_ASSERT_EQUAL(port, ports[i]);
+    }
+  }
+  select_count(group, counts, 64);
+  TEST_ASSERT_TRUE(counts[10] == size / 64 || counts[10] == size / 64 + 1);
+  free(ports);
+}
+
+void
+test_group_select_weight(void) {
+  struct bridge *bridge;
+  struct group *group;
+  struct ofp_group_mod group_mod;
+  struct bucket_list bucket_list;
+  struct bucket *bucket;
+  struct ofp_error error;
+  uint32_t counts[3], size;
+
+  bridge = dp_bridge_lookup("br0");
+  group_mod.group_id = 11;
+  group_mod.type = OFPGT_SELECT;
+  select_bucket_list(&bucket_list, 2, 0, 0);
+  TAILQ_FIRST(&bucket_list)->ofp.weight = 1;
+  TAILQ_LAST(&bucket_list, bucket_list)->ofp.weight = 3;
+  group = group_alloc(&group_mod, &bucket_list);
+  TEST_ASSERT_NOT_NULL(group);
+  TEST_ASSERT_EQUAL(group_table_add(bridge->group_table, group, &error),
+                    LAGOPUS_RESULT_OK);
+  TEST_ASSERT_NOT_NULL(group->select);
+  size = group->select->size;
+  select_count(group, counts, 2);
+  TEST_ASSERT_EQUAL(counts[1] + counts[2], size);
+  TEST_ASSERT_EQUAL(counts[1], size / 4);
+
+  /* bucket of weight 0 is not selected. */
+  select_bucket_list(&bucket_list, 2, 0, 0);
+  TAILQ_FIRST(&bucket_list)->ofp.weight = 1;
+  group_modify(group, &group_mod, &bucket_list);
+  select_count(group, counts, 2);
+  TEST_ASSERT_EQUAL(counts[1], group->select->size);
+  TAILQ_FOREACH(bucket, &group->bucket_list, entry) {
+    TEST_ASSERT_EQUAL(bucket, group->select->buckets[0]);
+    break;
+  }
+}
+
+void
+test_group_select_liveness(void) {
+  struct bridge *bridge;
+  struct group *group;
+  struct ofp_group_mod group_mod;
+  struct bucket_list bucket_list;
+  struct ofp_error error;
+  uint32_t counts[9], size, port, gen;
+
+  bridge = dp_bridge_lookup("br0");
+  group_mod.group_id = 12;
+  group_mod.type = OFPGT_SELECT;
+  /* buckets 1..4 watch ports not in the bridge. */
+  select_bucket_list(&bucket_list, 8, 0, 4);
+  group = group_alloc(&group_mod, &bucket_list);
+  TEST_ASSERT_NOT_NULL(group);
+  TEST_ASSERT_NOT_EQUAL(group->live_gen, group_liveness_gen);
+  TEST_ASSERT_EQUAL(group_table_add(bridge->group_table, group, &error),
+                    LAGOPUS_RESULT_OK);
+  size = group->select->size;
+  select_count(group, counts, 8);
+  for (port = 1; port <= 4; port++) {
+    TEST_ASSERT_EQUAL(counts[port], 0);
+  }
+  for (port = 5; port <= 8; port++) {
+    TEST_ASSERT_TRUE(counts[port] == size / 4 || counts[port] == size / 4 + 1);
+  }
+
+  /* refreshed on the next packet after liveness changes. */
+  gen = group->live_gen;
+  group_liveness_changed();
+  TEST_ASSERT_NOT_EQUAL(group->live_gen, group_liveness_gen);
+  group_liveness_check(bridge, group);
+  TEST_ASSERT_EQUAL(group->live_gen, group_liveness_gen);
+  TEST_ASSERT_NOT_EQUAL(group->live_gen, gen);
+  select_count(group, counts, 8);
+  TEST_ASSERT_EQUAL(counts[1], 0);
+
+  /* fast failover without live bucket. */
+  group_mod.group_id = 13;
+  group_mod.type = OFPGT_FF;
+  select_bucket_list(&bucket_list, 2, 0, 2);
+  group = group_alloc(&group_mod, &bucket_list);
+  TEST_ASSERT_EQUAL(group_table_add(bridge->group_table, group, &error),
+                    LAGOPUS_RESULT_OK);
+  TEST_ASSERT_NULL(group->select);
+  TEST_ASSERT_NULL(group->live_bucket);
+  TEST_ASSERT_EQUAL(group->live_gen, group_liveness_gen);
+}
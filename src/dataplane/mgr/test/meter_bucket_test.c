@@ -0,0 +1,205 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include "unity.h"
+
+#include "lagopus_apis.h"
+#include "meter_bucket.h"
+
+#define NSEC_PER_SEC    (1000ULL * 1000 * 1000)
+#define NTHREADS        4
+
+static struct meter_bucket bucket __attribute__((aligned(64)));
+
+void
+setUp(void) {
+}
+
+void
+tearDown(void) {
+}
+
+/*
+ * Offer packets at twice of the rate from several shares for one
+ * second of simulated time, return bytes passed.
+ */
+static uint64_t
+offer_kbps(uint64_t kbps, uint64_t burst, uint32_t pktlen, int nshares) {
+  uint64_t rate, npkts, i, passed, start, now;
+
+  rate = kbps * 1000 / 8;
+  meter_bucket_config(&bucket, rate, burst);
+  start = meter_bucket_clock();
+  npkts = rate * 2 / pktlen;
+  passed = 0;
+  for (i = 0; i < npkts; i++) {
+    now = start + i * NSEC_PER_SEC / npkts;
+    if (meter_bucket_take(&bucket, (int)(i % (uint64_t)nshares),
+                          pktlen, now) == true) {
+      passed += pktlen;
+    }
+  }
+  return passed;
+}
+
+static void
+check_accuracy(uint64_t kbps) {
+  uint64_t rate, burst, passed;
+
+  rate = kbps * 1000 / 8;
+  burst = rate / 100;
+  /* single thread, error is within a packet. */
+  passed = offer_kbps(kbps, burst, 1000, 1);
+  TEST_ASSERT_TRUE(passed <= rate + burst + 1000);
+  TEST_ASSERT_TRUE(passed >= rate + burst - 2000);
+
+  /* credit of shares never exceeds the rate. */
+  passed = offer_kbps(kbps, burst, 1000, 8);
+  TEST_ASSERT_TRUE(passed <= rate + burst + 1000);
+  TEST_ASSERT_TRUE(passed >= rate - rate / 100);
+}
+
+void
+test_meter_bucket_1mbps(void) {
+  check_accuracy(1000);
+}
+
+void
+test_meter_bucket_10mbps(void) {
+  check_accuracy(10000);
+}
+
+void
+test_meter_bucket_100mbps(void) {
+  check_accuracy(100000);
+}
+
+void
+test_meter_bucket_pps(void) {
+  uint64_t i, passed, start;
+
+  /* 1000 pps with burst of 10 packets, offer 5000 packets. */
+  meter_bucket_config(&bucket, 1000, 10);
+  start = meter_bucket_clock();
+  passed = 0;
+  for (i = 0; i < 5000; i++) {
+    if (meter_bucket_take(&bucket, 0, 1,
+                          start + i * NSEC_PER_SEC / 5000) == true) {
+      passed++;
+    }
+  }
+  TEST_ASSERT_TRUE(passed >= 1000 && passed <= 1011);
+}
+
+void
+test_meter_bucket_burst(void) {
+  uint64_t start;
+  int i;
+
+  /* burst passes at once, then packets are red until refilled. */
+  meter_bucket_config(&bucket, 1000, 4000);
+  start = meter_bucket_clock();
+  for (i = 0; i < 4; i++) {
+    TEST_ASSERT_TRUE(meter_bucket_take(&bucket, 0, 1000, start));
+  }
+  TEST_ASSERT_FALSE(meter_bucket_take(&bucket, 0, 1000, start));
+  TEST_ASSERT_FALSE(meter_bucket_take(&bucket, 0, 1000,
+                                      start + NSEC_PER_SEC / 2));
+  TEST_ASSERT_TRUE(meter_bucket_take(&bucket, 0, 1000,
+                                     start + NSEC_PER_SEC));
+
+  /* packet larger than burst never passes. */
+  TEST_ASSERT_FALSE(meter_bucket_take(&bucket, 0, 5000,
+                                      start + NSEC_PER_SEC * 10));
+}
+
+void
+test_meter_bucket_reclaim(void) {
+  uint64_t start;
+
+  /* 1M tokens/s, share takes 100 tokens at once. */
+  meter_bucket_config(&bucket, 1000000, 16000);
+  start = meter_bucket_clock();
+  TEST_ASSERT_TRUE(meter_bucket_take(&bucket, 1, 1, start));
+  TEST_ASSERT_EQUAL(bucket.shares[1].credit, bucket.quantum);
+
+  /* share 0 drains the bucket, credit of share 1 is left. */
+  while (meter_bucket_take(&bucket, 0, 1, start) == true) {
+  }
+
+  /* 1000 tokens refilled, and credit of idle share 1 is returned. */
+  start += METER_BUCKET_RECLAIM_NSEC;
+  TEST_ASSERT_TRUE(meter_bucket_take(&bucket, 0, 1050, start));
+  TEST_ASSERT_EQUAL(bucket.shares[1].credit, 0);
+}
+
+struct take_arg {
+  pthread_t tid;
+  int index;
+  uint64_t now;
+  uint64_t taken;
+};
+
+static void *
+take_loop(void *arg) {
+  struct take_arg *ta;
+  int miss;
+
+  ta = arg;
+  miss = 0;
+  while (miss < 1000) {
+    if (meter_bucket_take(&bucket, ta->index, 1, ta->now) == true) {
+      ta->taken++;
+      miss = 0;
+    } else {
+      miss++;
+    }
+  }
+  return NULL;
+}
+
+void
+test_meter_bucket_threads(void) {
+  struct take_arg args[NTHREADS];
+  uint64_t now, taken, left, cost, used;
+  int i;
+
+  /* time is stopped, tokens are conserved between threads. */
+  meter_bucket_config(&bucket, 1000000, 100000);
+  now = meter_bucket_clock();
+  for (i = 0; i < NTHREADS; i++) {
+    args[i].index = i;
+    args[i].now = now;
+    args[i].taken = 0;
+    TEST_ASSERT_EQUAL(pthread_create(&args[i].tid, NULL,
+                                     take_loop, &args[i]), 0);
+  }
+  taken = 0;
+  for (i = 0; i < NTHREADS; i++) {
+    pthread_join(args[i].tid, NULL);
+    taken += args[i].taken;
+  }
+  left = 0;
+  for (i = 0; i < METER_BUCKET_SHARES; i++) {
+    left += (uint64_t)bucket.shares[i].credit;
+  }
+  /* bucket is drained to less than a token. */
+  cost = bucket.cost >> METER_BUCKET_COST_SHIFT;
+  used = bucket.tat - (now << METER_BUCKET_TIME_SHIFT);
+  TEST_ASSERT_TRUE(used + cost > bucket.depth);
+  TEST_ASSERT_EQUAL(taken * cost + left, used);
+}
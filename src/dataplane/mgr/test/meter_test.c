@@ -20,14 +20,18 @@
 #include "lagopus_apis.h"
 #include "lagopus/pbuf.h"
 #include "lagopus/meter.h"
+#include "lagopus/dataplane.h"
 #include "openflow13.h"
 #include "ofp_band.h"
+#include "pktbuf.h"
+#include "packet.h"
+#include "counter.h"
 
 static struct meter_table *meter_table;
 
 void
 setUp(void) {
-  meter_table = meter_table_alloc();
+  meter_table = meter_table_alloc(NULL);
   TEST_ASSERT_NOT_NULL(meter_table);
 }
 
@@ -110,3 +114,76 @@ test_meter_lookup(void) {
   rv = meter_table_meter_delete(meter_table, &meter_mod, &error);
   TEST_ASSERT_EQUAL(rv, LAGOPUS_RESULT_OK);
 }
+
+static void
+band_add(struct meter_band_list *list, uint16_t type,
+         uint32_t rate, uint32_t burst_size, uint8_t prec_level) {
+  struct meter_band *band;
+
+  band = calloc(1, sizeof(struct meter_band));
+  TEST_ASSERT_NOT_NULL(band);
+  band->type = type;
+  band->rate = rate;
+  band->burst_size = burst_size;
+  band->prec_level = prec_level;
+  TAILQ_INSERT_TAIL(list, band, entry);
+}
+
+void
+test_meter_packet_bands(void) {
+  struct ofp_meter_mod meter_mod;
+  struct meter_band_list list;
+  struct ofp_error error;
+  struct lagopus_packet *pkt;
+  struct meter *meter;
+  struct meter_band *band;
+  struct dp_counter counter;
+  uint8_t prec_level;
+
+  lagopus_meter_init();
+  TAILQ_INIT(&list);
+  band_add(&list, OFPMBT_DSCP_REMARK, 1, 2, 1);
+  band_add(&list, OFPMBT_DROP, 2, 3, 0);
+  meter_mod.meter_id = 1;
+  meter_mod.flags = OFPMF_PKTPS | OFPMF_BURST | OFPMF_STATS;
+  TEST_ASSERT_EQUAL(meter_table_meter_add(meter_table, &meter_mod,
+                                          &list, &error),
+                    LAGOPUS_RESULT_OK);
+  meter = meter_table_lookup(meter_table, 1);
+  TEST_ASSERT_NOT_NULL(meter);
+
+  pkt = alloc_lagopus_packet();
+  TEST_ASSERT_NOT_NULL(pkt);
+  OS_M_APPEND(PKT2MBUF(pkt), 64);
+
+  /*
+   * burst of 2 packets passes the remark band, burst of 3 packets
+   * passes the drop band.  drop band of higher rate is applied first.
+   */
+  prec_level = 0;
+  TEST_ASSERT_EQUAL(lagopus_meter_packet(pkt, meter, &prec_level), 0);
+  TEST_ASSERT_EQUAL(lagopus_meter_packet(pkt, meter, &prec_level), 0);
+  TEST_ASSERT_EQUAL(lagopus_meter_packet(pkt, meter, &prec_level),
+                    OFPMBT_DSCP_REMARK);
+  TEST_ASSERT_EQUAL(prec_level, 1);
+  TEST_ASSERT_EQUAL(lagopus_meter_packet(pkt, meter, &prec_level),
+                    OFPMBT_DROP);
+  TEST_ASSERT_EQUAL(lagopus_meter_packet(pkt, meter, &prec_level),
+                    OFPMBT_DROP);
+
+  dp_counter_get(meter->counter_id, &counter);
+  TEST_ASSERT_EQUAL(counter.packets, 5);
+  TAILQ_FOREACH(band, &meter->band_list, entry) {
+    dp_counter_get(band->counter_id, &counter);
+    if (band->type == OFPMBT_DROP) {
+      TEST_ASSERT_EQUAL(counter.packets, 2);
+    } else {
+      TEST_ASSERT_EQUAL(counter.packets, 1);
+    }
+  }
+  lagopus_packet_free(pkt);
+
+  TEST_ASSERT_EQUAL(meter_table_meter_delete(meter_table, &meter_mod,
+                                             &error),
+                    LAGOPUS_RESULT_OK);
+}
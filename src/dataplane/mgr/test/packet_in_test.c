@@ -0,0 +1,231 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/queue.h>
+#include "unity.h"
+
+#include "lagopus_apis.h"
+#include "lagopus/pbuf.h"
+#include "lagopus/flowdb.h"
+#include "lagopus/bridge.h"
+#include "lagopus/eventq_data.h"
+#include "lagopus/dp_apis.h"
+#include "packet_in.h"
+
+#define QUEUE_MAX 16
+
+static struct bridge bridge;
+static struct eventq_data *queued[PACKET_IN_POOL_SIZE];
+static size_t nqueued;
+static size_t nput_calls;
+
+static lagopus_result_t
+dataq_put_n(uint64_t dpid, struct eventq_data **data, size_t n,
+            size_t *n_put, lagopus_chrono_t timeout) {
+  size_t i;
+
+  (void) dpid;
+  (void) timeout;
+
+  nput_calls++;
+  for (i = 0; i < n && nqueued < QUEUE_MAX; i++) {
+    queued[nqueued++] = data[i];
+  }
+  *n_put = i;
+  return (i == n) ? LAGOPUS_RESULT_OK : LAGOPUS_RESULT_TIMEDOUT;
+}
+
+static void
+dequeue_all(void) {
+  size_t i;
+
+  for (i = 0; i < nqueued; i++) {
+    queued[i]->free(queued[i]);
+  }
+  nqueued = 0;
+}
+
+void
+setUp(void) {
+  memset(&bridge, 0, sizeof(bridge));
+  bridge.packet_in = packet_in_queue_alloc();
+  TEST_ASSERT_NOT_NULL(bridge.packet_in);
+  nqueued = 0;
+  nput_calls = 0;
+  dp_dataq_put_n_func_register(dataq_put_n);
+}
+
+void
+tearDown(void) {
+  dequeue_all();
+  dp_dataq_put_n_func_register(NULL);
+  packet_in_queue_free(bridge.packet_in);
+}
+
+void
+test_packet_in_event_alloc(void) {
+  struct eventq_data *data;
+  struct pbuf *pbuf;
+  static const uint8_t pkt[64];
+
+  data = packet_in_event_alloc(bridge.packet_in, OFPR_NO_MATCH, sizeof(pkt));
+  TEST_ASSERT_NOT_NULL(data);
+  TEST_ASSERT_EQUAL(data->type, LAGOPUS_EVENTQ_PACKET_IN);
+  TEST_ASSERT_TRUE(TAILQ_EMPTY(&data->packet_in.match_list));
+  pbuf = data->packet_in.data;
+  TEST_ASSERT_NOT_NULL(pbuf);
+  TEST_ASSERT_EQUAL(pbuf_readable_size(pbuf), 0);
+  ENCODE_PUT(pkt, sizeof(pkt));
+  TEST_ASSERT_EQUAL(pbuf_readable_size(pbuf), sizeof(pkt));
+  TEST_ASSERT_NOT_NULL(packet_in_event_port_match(data));
+  TEST_ASSERT_NOT_NULL(packet_in_event_metadata_match(data));
+  data->free(data);
+
+  /* too large to be sent. */
+  data = packet_in_event_alloc(bridge.packet_in, OFPR_NO_MATCH,
+                               PACKET_IN_DATA_MAX + 1);
+  TEST_ASSERT_NULL(data);
+  TEST_ASSERT_EQUAL(packet_in_drops_get(bridge.packet_in), 1);
+}
+
+void
+test_packet_in_pool_exhausted(void) {
+  struct eventq_data *data[PACKET_IN_POOL_SIZE];
+  size_t i;
+
+  TEST_ASSERT_EQUAL(packet_in_rate_set(bridge.packet_in, OFPR_ACTION, 0, 0),
+                    LAGOPUS_RESULT_OK);
+  for (i = 0; i < PACKET_IN_POOL_SIZE; i++) {
+    data[i] = packet_in_event_alloc(bridge.packet_in, OFPR_ACTION, 64);
+    TEST_ASSERT_NOT_NULL(data[i]);
+  }
+  TEST_ASSERT_NULL(packet_in_event_alloc(bridge.packet_in, OFPR_ACTION, 64));
+  TEST_ASSERT_EQUAL(packet_in_drops_get(bridge.packet_in), 1);
+
+  /* freed events are reused. */
+  data[0]->free(data[0]);
+  data[0] = packet_in_event_alloc(bridge.packet_in, OFPR_ACTION, 64);
+  TEST_ASSERT_NOT_NULL(data[0]);
+  for (i = 0; i < PACKET_IN_POOL_SIZE; i++) {
+    data[i]->free(data[i]);
+  }
+}
+
+void
+test_packet_in_rate_limit(void) {
+  struct eventq_data *data;
+  int i, n;
+
+  TEST_ASSERT_EQUAL(packet_in_rate_set(bridge.packet_in,
+                                       PACKET_IN_REASON_MAX, 1, 1),
+                    LAGOPUS_RESULT_INVALID_ARGS);
+  TEST_ASSERT_EQUAL(packet_in_rate_set(bridge.packet_in, OFPR_NO_MATCH, 1, 5),
+                    LAGOPUS_RESULT_OK);
+  n = 0;
+  for (i = 0; i < 10; i++) {
+    data = packet_in_event_alloc(bridge.packet_in, OFPR_NO_MATCH, 64);
+    if (data != NULL) {
+      n++;
+      data->free(data);
+    }
+  }
+  TEST_ASSERT_EQUAL(n, 5);
+  TEST_ASSERT_EQUAL(packet_in_drops_get(bridge.packet_in), 5);
+
+  /* buckets are per reason. */
+  data = packet_in_event_alloc(bridge.packet_in, OFPR_INVALID_TTL, 64);
+  TEST_ASSERT_NOT_NULL(data);
+  data->free(data);
+}
+
+void
+test_packet_in_rate_limit_pool_exhausted(void) {
+  struct eventq_data *data[PACKET_IN_POOL_SIZE];
+  struct eventq_data *d;
+  size_t i;
+
+  TEST_ASSERT_EQUAL(packet_in_rate_set(bridge.packet_in, OFPR_ACTION, 0, 0),
+                    LAGOPUS_RESULT_OK);
+  for (i = 0; i < PACKET_IN_POOL_SIZE; i++) {
+    data[i] = packet_in_event_alloc(bridge.packet_in, OFPR_ACTION, 64);
+    TEST_ASSERT_NOT_NULL(data[i]);
+  }
+
+  /* no tokens are taken while the pool is empty. */
+  TEST_ASSERT_EQUAL(packet_in_rate_set(bridge.packet_in, OFPR_NO_MATCH, 1, 2),
+                    LAGOPUS_RESULT_OK);
+  for (i = 0; i < 10; i++) {
+    TEST_ASSERT_NULL(packet_in_event_alloc(bridge.packet_in,
+                                           OFPR_NO_MATCH, 64));
+  }
+  TEST_ASSERT_EQUAL(packet_in_drops_get(bridge.packet_in), 10);
+  for (i = 0; i < PACKET_IN_POOL_SIZE; i++) {
+    data[i]->free(data[i]);
+  }
+  for (i = 0; i < 2; i++) {
+    d = packet_in_event_alloc(bridge.packet_in, OFPR_NO_MATCH, 64);
+    TEST_ASSERT_NOT_NULL(d);
+    d->free(d);
+  }
+
+  /* event is returned to the pool when rate limited. */
+  TEST_ASSERT_NULL(packet_in_event_alloc(bridge.packet_in, OFPR_NO_MATCH, 64));
+  for (i = 0; i < PACKET_IN_POOL_SIZE; i++) {
+    data[i] = packet_in_event_alloc(bridge.packet_in, OFPR_ACTION, 64);
+    TEST_ASSERT_NOT_NULL(data[i]);
+  }
+  for (i = 0; i < PACKET_IN_POOL_SIZE; i++) {
+    data[i]->free(data[i]);
+  }
+}
+
+void
+test_packet_in_batch(void) {
+  struct eventq_data *data;
+  int i;
+
+  /* put immediately out of batch. */
+  data = packet_in_event_alloc(bridge.packet_in, OFPR_NO_MATCH, 64);
+  packet_in_event_put(&bridge, data);
+  TEST_ASSERT_EQUAL(nqueued, 1);
+  TEST_ASSERT_EQUAL(nput_calls, 1);
+  dequeue_all();
+
+  /* put at once at end of batch, overflow is dropped. */
+  packet_in_batch_begin();
+  for (i = 0; i < QUEUE_MAX + 4; i++) {
+    data = packet_in_event_alloc(bridge.packet_in, OFPR_NO_MATCH, 64);
+    TEST_ASSERT_NOT_NULL(data);
+    packet_in_event_put(&bridge, data);
+  }
+  TEST_ASSERT_EQUAL(nqueued, 0);
+  packet_in_batch_end();
+  TEST_ASSERT_EQUAL(nput_calls, 2);
+  TEST_ASSERT_EQUAL(nqueued, QUEUE_MAX);
+  TEST_ASSERT_EQUAL(packet_in_drops_get(bridge.packet_in), 4);
+}
+
+void
+test_packet_in_queue_free(void) {
+  struct eventq_data *data;
+
+  /* events in agent queue are valid after the bridge is freed. */
+  data = packet_in_event_alloc(bridge.packet_in, OFPR_NO_MATCH, 64);
+  TEST_ASSERT_NOT_NULL(data);
+  packet_in_queue_free(bridge.packet_in);
+  bridge.packet_in = packet_in_queue_alloc();
+  data->free(data);
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include "unity.h"
+
+#include "lagopus_apis.h"
+#include "lagopus/dp_apis.h"
+#include "lagopus/dataplane.h"
+
+#include "pktbuf.c"
+
+#define NTHREADS 4
+#define NPKTS 1000
+
+static struct dp_pktbuf_stats base;
+
+void
+setUp(void) {
+  dp_get_pktbuf_statistics(&base);
+}
+
+void
+tearDown(void) {
+  struct dp_pktbuf_stats st;
+
+  /* no buffer is leaked. */
+  dp_get_pktbuf_statistics(&st);
+  TEST_ASSERT_EQUAL(st.in_use, base.in_use);
+}
+
+void
+test_pktbuf_alloc_free(void) {
+  struct lagopus_packet *pkt, *pkt2;
+  struct dp_pktbuf_stats st;
+  OS_MBUF *m;
+
+  pkt = alloc_lagopus_packet();
+  TEST_ASSERT_NOT_NULL(pkt);
+  m = PKT2MBUF(pkt);
+  TEST_ASSERT_EQUAL(OS_M_PKTLEN(m), 0);
+  TEST_ASSERT_TRUE(OS_MTOD(m, uint8_t *) == &m->dat[128]);
+  TEST_ASSERT_EQUAL(m->refcnt, 0);
+  TEST_ASSERT_TRUE(m->node >= 0);
+  dp_get_pktbuf_statistics(&st);
+  TEST_ASSERT_EQUAL(st.in_use, base.in_use + 1);
+  TEST_ASSERT_TRUE(st.size >= PKTBUF_CHUNK);
+
+  /* headers are initialized again for reuse. */
+  pkt->nmatched = 3;
+  pkt->flags = PKT_FLAG_HAS_ACTION;
+  pkt->table_id = 10;
+  OS_M_APPEND(m, 64);
+  lagopus_packet_free(pkt);
+  pkt2 = alloc_lagopus_packet();
+  TEST_ASSERT_TRUE(pkt2 == pkt);
+  TEST_ASSERT_EQUAL(OS_M_PKTLEN(m), 0);
+  TEST_ASSERT_EQUAL(pkt2->nmatched, 0);
+  TEST_ASSERT_EQUAL(pkt2->flags, 0);
+  TEST_ASSERT_EQUAL(pkt2->table_id, 0);
+  lagopus_packet_free(pkt2);
+}
+
+void
+test_pktbuf_refcnt(void) {
+  struct lagopus_packet *pkt;
+  struct dp_pktbuf_stats st;
+
+  pkt = alloc_lagopus_packet();
+  TEST_ASSERT_NOT_NULL(pkt);
+  OS_M_ADDREF(PKT2MBUF(pkt));
+  lagopus_packet_free(pkt);
+  dp_get_pktbuf_statistics(&st);
+  TEST_ASSERT_EQUAL(st.in_use, base.in_use + 1);
+  lagopus_packet_free(pkt);
+}
+
+void
+test_pktbuf_cache_overflow(void) {
+  struct lagopus_packet *pkts[PKTBUF_CACHE_SIZE * 4];
+  struct pktbuf_cache *cache;
+  size_t i;
+
+  for (i = 0; i < sizeof(pkts) / sizeof(pkts[0]); i++) {
+    pkts[i] = alloc_lagopus_packet();
+    TEST_ASSERT_NOT_NULL(pkts[i]);
+  }
+  for (i = 0; i < sizeof(pkts) / sizeof(pkts[0]); i++) {
+    lagopus_packet_free(pkts[i]);
+  }
+  /* the thread keeps a small cache, others go back to the node. */
+  cache = pktbuf_cache_get();
+  TEST_ASSERT_TRUE(cache->count <= PKTBUF_CACHE_SIZE);
+  TEST_ASSERT_TRUE(pktbuf_nodes[cache->node].count >=
+                   PKTBUF_CACHE_SIZE * 3 - PKTBUF_BATCH);
+}
+
+static struct lagopus_packet *shared[NTHREADS][NPKTS];
+
+/*
+ * thread i frees references to packets of thread i - 1 and its own.
+ */
+static void *
+pktbuf_thread(void *arg) {
+  long id = (long)arg;
+  int i;
+
+  for (i = 0; i < NPKTS; i++) {
+    lagopus_packet_free(shared[(id + NTHREADS - 1) % NTHREADS][i]);
+    lagopus_packet_free(shared[id][i]);
+  }
+  return NULL;
+}
+
+void
+test_pktbuf_threads(void) {
+  pthread_t threads[NTHREADS];
+  long t;
+  int i;
+
+  for (t = 0; t < NTHREADS; t++) {
+    for (i = 0; i < NPKTS; i++) {
+      shared[t][i] = alloc_lagopus_packet();
+      TEST_ASSERT_NOT_NULL(shared[t][i]);
+      OS_M_ADDREF(PKT2MBUF(shared[t][i]));
+    }
+  }
+  for (t = 0; t < NTHREADS; t++) {
+    TEST_ASSERT_EQUAL(pthread_create(&threads[t], NULL,
+                                     pktbuf_thread, (void *)t), 0);
+  }
+  for (t = 0; t < NTHREADS; t++) {
+    TEST_ASSERT_EQUAL(pthread_join(threads[t], NULL), 0);
+  }
+}
+
+void
+test_pktbuf_exhausted(void) {
+  struct lagopus_packet **pkts;
+  struct dp_pktbuf_stats st;
+  int i, n;
+
+  n = PKTBUF_POOL_MAX + 1;
+  pkts = calloc((size_t)n, sizeof(struct lagopus_packet *));
+  TEST_ASSERT_NOT_NULL(pkts);
+  for (i = 0; i < n; i++) {
+    pkts[i] = alloc_lagopus_packet();
+    TEST_ASSERT_NOT_NULL(pkts[i]);
+  }
+  dp_get_pktbuf_statistics(&st);
+  TEST_ASSERT_EQUAL(st.size, PKTBUF_POOL_MAX);
+  TEST_ASSERT_EQUAL(st.in_use, base.in_use + PKTBUF_POOL_MAX);
+  TEST_ASSERT_EQUAL(st.exhausted, base.exhausted + 1);
+  for (i = 0; i < n; i++) {
+    lagopus_packet_free(pkts[i]);
+  }
+  free(pkts);
+}
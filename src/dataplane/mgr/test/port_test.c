@@ -235,6 +235,34 @@ test_lagopus_get_port_statistics(void) {
 #endif /* HYBRID */
 }
 
+void
+test_dp_port_stats_snapshot(void) {
+  struct port *port;
+  struct ofp_port_stats in, out;
+
+  port = port_alloc();
+  TEST_ASSERT_NOT_NULL(port);
+  memset(&in, 0, sizeof(in));
+  in.rx_packets = 10;
+  in.tx_packets = 20;
+  in.rx_bytes = 640;
+  in.tx_bytes = 1280;
+  dp_port_stats_publish(port, &in);
+  TEST_ASSERT_EQUAL(port->stats_seq & 1, 0);
+  dp_port_stats_snapshot(port, &out);
+  TEST_ASSERT_EQUAL(out.rx_packets, 10);
+  TEST_ASSERT_EQUAL(out.tx_packets, 20);
+  TEST_ASSERT_EQUAL(out.rx_bytes, 640);
+  TEST_ASSERT_EQUAL(out.tx_bytes, 1280);
+
+  in.rx_packets = 11;
+  dp_port_stats_publish(port, &in);
+  dp_port_stats_snapshot(port, &out);
+  TEST_ASSERT_EQUAL(out.rx_packets, 11);
+  TEST_ASSERT_EQUAL(port->stats_seq, 4);
+  port_free(port);
+}
+
 void
 test_port_config(void) {
   datastore_bridge_info_t info;
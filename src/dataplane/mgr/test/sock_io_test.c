@@ -0,0 +1,193 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/socket.h>
+#include <net/if.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include "unity.h"
+
+#include "lagopus_apis.h"
+#include "lagopus_gstate.h"
+#include "lagopus/dp_apis.h"
+#include "lagopus/dataplane.h"
+#include "lagopus/datastore/bridge.h"
+#include "lagopus/datastore/interface.h"
+
+#define NWORKERS 2
+#define NPKTS 64
+#define PKTLEN 64
+
+static const char bridge_name[] = "br0";
+static const char port_name[] = "port0";
+static const char if_name[] = "if0";
+
+void
+setUp(void) {
+  TEST_ASSERT_EQUAL(dp_api_init(), LAGOPUS_RESULT_OK);
+}
+
+void
+tearDown(void) {
+  dp_api_fini();
+}
+
+/*
+ * send frames to the loopback device, they are received by the
+ * raw socket workers bound to it.
+ */
+static int
+send_frames(int count) {
+  struct sockaddr_ll sll;
+  uint8_t frame[PKTLEN];
+  int fd, i, sent;
+
+  fd = socket(PF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+  if (fd == -1) {
+    return -1;
+  }
+  memset(&sll, 0, sizeof(sll));
+  sll.sll_family = AF_PACKET;
+  sll.sll_protocol = htons(ETH_P_ALL);
+  sll.sll_ifindex = (int)if_nametoindex("lo");
+  sll.sll_halen = ETH_ALEN;
+  memset(frame, 0, sizeof(frame));
+  frame[5] = 0x01;                      /* dst 00:00:00:00:00:01 */
+  frame[12] = 0x88;                     /* local experimental ethertype */
+  frame[13] = 0xb5;
+  sent = 0;
+  for (i = 0; i < count; i++) {
+    /* vary source address to spread frames over fanout group. */
+    frame[10] = (uint8_t)(i >> 8);
+    frame[11] = (uint8_t)i;
+    if (sendto(fd, frame, sizeof(frame), 0,
+               (struct sockaddr *)&sll, sizeof(sll)) == sizeof(frame)) {
+      sent++;
+    }
+  }
+  close(fd);
+  return sent;
+}
+
+void
+test_dp_get_worker_statistics_bound(void) {
+  struct dp_worker_stats st[DATASTORE_BRIDGE_MAX_WORKERS];
+  size_t n;
+
+  /* raw socket dataplane has one worker at least. */
+  n = dp_get_worker_statistics(st, DATASTORE_BRIDGE_MAX_WORKERS);
+  TEST_ASSERT_TRUE(n >= 1);
+  n = dp_get_worker_statistics(st, 0);
+  TEST_ASSERT_EQUAL(n, 0);
+}
+
+void
+test_bridge_stats_worker_counters(void) {
+  static const char *const argv[] = {
+    "lagopus", "--rawsock-workers", "2", NULL
+  };
+  datastore_bridge_info_t binfo;
+  datastore_interface_info_t iinfo;
+  datastore_bridge_stats_t stats;
+  struct dp_worker_stats ws[DATASTORE_BRIDGE_MAX_WORKERS];
+  struct table_stats *table_stats;
+  lagopus_thread_t *thdptr;
+  uint64_t rx_packets, rx_bytes;
+  uint32_t i;
+  int sent, retry;
+
+  sent = send_frames(0);
+  if (sent < 0) {
+    TEST_IGNORE_MESSAGE("raw socket is not permitted.");
+  }
+
+  TEST_ASSERT_EQUAL(dp_rawsock_thread_init(3, argv, NULL, &thdptr),
+                    LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(dp_get_worker_statistics(ws, DATASTORE_BRIDGE_MAX_WORKERS),
+                    NWORKERS);
+
+  memset(&binfo, 0, sizeof(binfo));
+  binfo.dpid = 1;
+  binfo.fail_mode = DATASTORE_BRIDGE_FAIL_MODE_SECURE;
+  TEST_ASSERT_EQUAL(dp_bridge_create(bridge_name, &binfo),
+                    LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(dp_interface_create(if_name), LAGOPUS_RESULT_OK);
+  memset(&iinfo, 0, sizeof(iinfo));
+  iinfo.type = DATASTORE_INTERFACE_TYPE_ETHERNET_RAWSOCK;
+  iinfo.eth_rawsock.device = strdup("lo");
+  iinfo.eth_rawsock.mtu = 1500;
+  TEST_ASSERT_EQUAL(dp_interface_info_set(if_name, &iinfo),
+                    LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(dp_port_create(port_name), LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(dp_port_interface_set(port_name, if_name),
+                    LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(dp_bridge_port_set(bridge_name, port_name, 1),
+                    LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(dp_interface_start(if_name), LAGOPUS_RESULT_OK);
+
+  TEST_ASSERT_EQUAL(global_state_set(GLOBAL_STATE_STARTED),
+                    LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(dp_rawsock_thread_start(), LAGOPUS_RESULT_OK);
+
+  sent = send_frames(NPKTS);
+  TEST_ASSERT_EQUAL(sent, NPKTS);
+
+  /* counters are updated by workers asynchronously. */
+  for (retry = 0; retry < 50; retry++) {
+    TAILQ_INIT(&stats.flow_table_stats);
+    TEST_ASSERT_EQUAL(dp_bridge_stats_get(bridge_name, &stats),
+                      LAGOPUS_RESULT_OK);
+    while ((table_stats = TAILQ_FIRST(&stats.flow_table_stats)) != NULL) {
+      TAILQ_REMOVE(&stats.flow_table_stats, table_stats, entry);
+      free(table_stats);
+    }
+    TEST_ASSERT_EQUAL(stats.worker_count, NWORKERS);
+    rx_packets = 0;
+    rx_bytes = 0;
+    for (i = 0; i < stats.worker_count; i++) {
+      rx_packets += stats.workers[i].rx_packets;
+      rx_bytes += stats.workers[i].rx_bytes;
+    }
+    if (rx_packets >= NPKTS &&
+        stats.workers[0].polls != 0 && stats.workers[1].polls != 0) {
+      break;
+    }
+    usleep(100000);
+  }
+  TEST_ASSERT_TRUE(rx_packets >= NPKTS);
+  TEST_ASSERT_TRUE(rx_bytes >= (uint64_t)NPKTS * PKTLEN);
+  /* 100 if balanced, 100 * workers if one worker takes all. */
+  TEST_ASSERT_TRUE(stats.worker_imbalance >= 100);
+  TEST_ASSERT_TRUE(stats.worker_imbalance <= 100 * NWORKERS);
+  for (i = 0; i < stats.worker_count; i++) {
+    /* every worker polls its own sockets. */
+    TEST_ASSERT_TRUE(stats.workers[i].polls != 0);
+    /* nothing is forwarded without flow entries. */
+    TEST_ASSERT_EQUAL(stats.workers[i].tx_packets, 0);
+  }
+
+  TEST_ASSERT_EQUAL(dp_rawsock_thread_stop(), LAGOPUS_RESULT_OK);
+  dp_rawsock_thread_shutdown(SHUTDOWN_GRACEFULLY);
+  dp_rawsock_thread_fini();
+  TEST_ASSERT_EQUAL(dp_interface_stop(if_name), LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(dp_bridge_port_unset(bridge_name, port_name),
+                    LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(dp_port_destroy(port_name), LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(dp_interface_destroy(if_name), LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(dp_bridge_destroy(bridge_name), LAGOPUS_RESULT_OK);
+}
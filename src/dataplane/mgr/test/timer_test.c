@@ -24,6 +24,39 @@
 
 #include "dp_timer.c"
 
+static int expire_count;
+
+static void
+count_expire(struct dp_timer *dp_timer) {
+  expire_count += dp_timer->nentries;
+}
+
+static int
+count_entries(struct dp_timer_list *list) {
+  struct dp_timer *dp_timer;
+  int i, n;
+
+  n = 0;
+  TAILQ_FOREACH(dp_timer, list, next) {
+    for (i = 0; i < dp_timer->nentries; i++) {
+      if (dp_timer->timer_entry[i] != NULL) {
+        n++;
+      }
+    }
+  }
+  return n;
+}
+
+static void
+free_list(struct dp_timer_list *list) {
+  struct dp_timer *dp_timer;
+
+  while ((dp_timer = TAILQ_FIRST(list)) != NULL) {
+    TAILQ_REMOVE(list, dp_timer, next);
+    free(dp_timer);
+  }
+}
+
 void
 setUp(void) {
   init_dp_timer();
@@ -34,154 +67,188 @@ tearDown(void) {
 }
 
 void
-test_add_flow_timer(void) {
-  struct flow flow;
-  struct dp_timer *dp_timer;
-  lagopus_result_t rv;
-
-  clock_gettime(CLOCK_MONOTONIC, &now_ts);
-  flow.idle_timeout = 100;
-  flow.hard_timeout = 100;
-  flow.create_time.tv_sec = now_ts.tv_sec;
-  flow.update_time.tv_sec = now_ts.tv_sec;
-  rv = add_flow_timer(&flow);
-  TEST_ASSERT_EQUAL(rv, LAGOPUS_RESULT_OK);
-  dp_timer = TAILQ_FIRST(&dp_timer_list);
-  TEST_ASSERT_NOT_NULL(dp_timer);
-  TEST_ASSERT_EQUAL(dp_timer->timeout, 100);
-  dp_timer = TAILQ_NEXT(dp_timer, next);
-  TEST_ASSERT_NULL(dp_timer);
-  flow.idle_timeout = 20;
-  flow.hard_timeout = 20;
-  rv = add_flow_timer(&flow);
-  TEST_ASSERT_EQUAL(rv, LAGOPUS_RESULT_OK);
-  dp_timer = TAILQ_FIRST(&dp_timer_list);
-  TEST_ASSERT_NOT_NULL(dp_timer);
-  TEST_ASSERT_EQUAL(dp_timer->timeout, 20);
-  dp_timer = TAILQ_NEXT(dp_timer, next);
-  TEST_ASSERT_NOT_NULL(dp_timer);
-  TEST_ASSERT_EQUAL(dp_timer->timeout, 80);
-  dp_timer = TAILQ_NEXT(dp_timer, next);
-  TEST_ASSERT_NULL(dp_timer);
+test_dp_timer_wheel_add_advance(void) {
+  struct dp_timer_wheel wheel;
+  struct dp_timer_list expired;
+  int arg;
+
+  dp_timer_wheel_init(&wheel, 1000);
+  TAILQ_INIT(&expired);
+  TEST_ASSERT_NOT_NULL(dp_timer_wheel_add(&wheel, 0, 10, NULL, &arg));
+  TEST_ASSERT_NOT_NULL(dp_timer_wheel_add(&wheel, 0, 20, NULL, &arg));
+
+  dp_timer_wheel_advance(&wheel, 1009, &expired);
+  TEST_ASSERT_EQUAL(count_entries(&expired), 0);
+  dp_timer_wheel_advance(&wheel, 1010, &expired);
+  TEST_ASSERT_EQUAL(count_entries(&expired), 1);
+  TEST_ASSERT_EQUAL(TAILQ_FIRST(&expired)->expire, 1010);
+  free_list(&expired);
+
+  /* missed ticks are caught up. */
+  dp_timer_wheel_advance(&wheel, 1100, &expired);
+  TEST_ASSERT_EQUAL(count_entries(&expired), 1);
+  TEST_ASSERT_EQUAL(TAILQ_FIRST(&expired)->expire, 1020);
+  free_list(&expired);
+  dp_timer_wheel_fini(&wheel);
 }
 
 void
-test_add_mbtree_timer(void) {
-  struct flow_list flow_list;
-  lagopus_result_t rv;
-
-  rv = add_mbtree_timer(&flow_list, 100);
-  TEST_ASSERT_EQUAL(rv, LAGOPUS_RESULT_OK);
+test_dp_timer_wheel_cascade(void) {
+  struct dp_timer_wheel wheel;
+  struct dp_timer_list expired;
+  static const time_t timeouts[] = {
+    255, 256, 300, 1000, 65535, 65536, 70000, 1 << 20
+  };
+  struct dp_timer *dp_timer;
+  time_t now;
+  int arg;
+  size_t i;
+
+  dp_timer_wheel_init(&wheel, 12345);
+  TAILQ_INIT(&expired);
+  for (i = 0; i < sizeof(timeouts) / sizeof(timeouts[0]); i++) {
+    TEST_ASSERT_NOT_NULL(dp_timer_wheel_add(&wheel, 0, timeouts[i],
+                                            NULL, &arg));
+  }
+  /* every timer expires exactly at its tick. */
+  for (i = 0; i < sizeof(timeouts) / sizeof(timeouts[0]); i++) {
+    now = 12345 + timeouts[i];
+    dp_timer_wheel_advance(&wheel, now - 1, &expired);
+    TEST_ASSERT_EQUAL(count_entries(&expired), 0);
+    dp_timer_wheel_advance(&wheel, now, &expired);
+    TEST_ASSERT_EQUAL(count_entries(&expired), 1);
+    dp_timer = TAILQ_FIRST(&expired);
+    TEST_ASSERT_EQUAL(dp_timer->expire, now);
+    free_list(&expired);
+  }
+  dp_timer_wheel_fini(&wheel);
 }
 
-static void
-t_add_flow_timer(int sec) {
-  struct flow flow;
-  lagopus_result_t rv;
-
-  clock_gettime(CLOCK_MONOTONIC, &now_ts);
-  flow.idle_timeout = sec;
-  flow.hard_timeout = sec;
-  flow.create_time.tv_sec = now_ts.tv_sec;
-  flow.update_time.tv_sec = now_ts.tv_sec;
-  rv = add_flow_timer(&flow);
-  TEST_ASSERT_EQUAL(rv, LAGOPUS_RESULT_OK);
+void
+test_dp_timer_wheel_cancel(void) {
+  struct dp_timer_wheel wheel;
+  struct dp_timer_list expired;
+  void **entryp;
+  int arg;
+
+  dp_timer_wheel_init(&wheel, 0);
+  TAILQ_INIT(&expired);
+  entryp = dp_timer_wheel_add(&wheel, 0, 5, NULL, &arg);
+  TEST_ASSERT_NOT_NULL(entryp);
+  TEST_ASSERT_EQUAL(*entryp, &arg);
+  *entryp = NULL;
+  dp_timer_wheel_advance(&wheel, 5, &expired);
+  TEST_ASSERT_EQUAL(count_entries(&expired), 0);
+  free_list(&expired);
+  dp_timer_wheel_fini(&wheel);
 }
 
 void
-test_add_multiple_timer(void) {
-  struct flow_list flow_list;
+test_dp_timer_wheel_readd(void) {
+  struct dp_timer_wheel wheel;
+  struct dp_timer_list expired;
   struct dp_timer *dp_timer;
-  lagopus_result_t rv;
+  void **entryp;
+  int arg;
+
+  dp_timer_wheel_init(&wheel, 0);
+  TAILQ_INIT(&expired);
+  entryp = dp_timer_wheel_add(&wheel, 0, 5, NULL, &arg);
+  TEST_ASSERT_NOT_NULL(entryp);
+  dp_timer_wheel_advance(&wheel, 5, &expired);
+  dp_timer = TAILQ_FIRST(&expired);
+  TEST_ASSERT_NOT_NULL(dp_timer);
+  TAILQ_REMOVE(&expired, dp_timer, next);
+
+  /* expired timer is retried in next tick, entry pointer is kept. */
+  dp_timer_wheel_readd(&wheel, dp_timer, 1);
+  TEST_ASSERT_EQUAL(*entryp, &arg);
+  dp_timer_wheel_advance(&wheel, 6, &expired);
+  TEST_ASSERT_EQUAL(count_entries(&expired), 1);
+  TEST_ASSERT_EQUAL(TAILQ_FIRST(&expired)->expire, 6);
+  TEST_ASSERT_TRUE(TAILQ_FIRST(&expired) == dp_timer);
+  TAILQ_REMOVE(&expired, dp_timer, next);
+
+  /* cancelled while waiting for retry. */
+  dp_timer_wheel_readd(&wheel, dp_timer, 1);
+  *entryp = NULL;
+  dp_timer_wheel_advance(&wheel, 7, &expired);
+  TEST_ASSERT_EQUAL(count_entries(&expired), 0);
+  free_list(&expired);
+  dp_timer_wheel_fini(&wheel);
+}
 
-  t_add_flow_timer(100);
-  dp_timer = TAILQ_FIRST(&dp_timer_list);
-  TEST_ASSERT_NOT_NULL(dp_timer);
-  TEST_ASSERT_EQUAL(dp_timer->timeout, 100);
-  dp_timer = TAILQ_NEXT(dp_timer, next);
-  TEST_ASSERT_NULL(dp_timer);
+void
+test_dp_timer_wheel_merge(void) {
+  struct dp_timer_wheel wheel;
+  struct dp_timer_list expired;
+  struct dp_timer *dp_timer;
+  int arg, i, nchunks;
+
+  dp_timer_wheel_init(&wheel, 0);
+  TAILQ_INIT(&expired);
+  /* timers of same tick share chunks of entries. */
+  for (i = 0; i < MAX_TIMEOUT_ENTRIES + 1; i++) {
+    TEST_ASSERT_NOT_NULL(dp_timer_wheel_add(&wheel, 0, 30, NULL, &arg));
+  }
+  TEST_ASSERT_NOT_NULL(dp_timer_wheel_add(&wheel, 1, 30, NULL, &arg));
+  dp_timer_wheel_advance(&wheel, 30, &expired);
+  TEST_ASSERT_EQUAL(count_entries(&expired), MAX_TIMEOUT_ENTRIES + 2);
+  nchunks = 0;
+  TAILQ_FOREACH(dp_timer, &expired, next) {
+    nchunks++;
+  }
+  TEST_ASSERT_EQUAL(nchunks, 3);
+  free_list(&expired);
+  dp_timer_wheel_fini(&wheel);
+}
 
-  t_add_flow_timer(20);
-  dp_timer = TAILQ_FIRST(&dp_timer_list);
-  TEST_ASSERT_NOT_NULL(dp_timer);
-  TEST_ASSERT_EQUAL(dp_timer->timeout, 20);
-  dp_timer = TAILQ_NEXT(dp_timer, next);
-  TEST_ASSERT_NOT_NULL(dp_timer);
-  TEST_ASSERT_EQUAL(dp_timer->timeout, 80);
-  dp_timer = TAILQ_NEXT(dp_timer, next);
-  TEST_ASSERT_NULL(dp_timer);
+void
+test_dp_timer_wheel_clamp(void) {
+  struct dp_timer_wheel wheel;
+  struct dp_timer_list expired;
+  int arg;
+
+  dp_timer_wheel_init(&wheel, 0);
+  TAILQ_INIT(&expired);
+  TEST_ASSERT_NOT_NULL(dp_timer_wheel_add(&wheel, 0, 0, NULL, &arg));
+  dp_timer_wheel_advance(&wheel, 1, &expired);
+  TEST_ASSERT_EQUAL(count_entries(&expired), 1);
+  free_list(&expired);
+  TEST_ASSERT_NOT_NULL(dp_timer_wheel_add(&wheel, 0,
+                                          DP_TIMER_WHEEL_MAX_TIMEOUT + 100,
+                                          NULL, &arg));
+  TEST_ASSERT_EQUAL(count_entries(&expired), 0);
+  dp_timer_wheel_fini(&wheel);
+}
 
-  rv = add_mbtree_timer(&flow_list, 5);
-  TEST_ASSERT_EQUAL(rv, LAGOPUS_RESULT_OK);
-  dp_timer = TAILQ_FIRST(&dp_timer_list);
-  TEST_ASSERT_NOT_NULL(dp_timer);
-  TEST_ASSERT_EQUAL(dp_timer->timeout, 5);
-  dp_timer = TAILQ_NEXT(dp_timer, next);
-  TEST_ASSERT_NOT_NULL(dp_timer);
-  TEST_ASSERT_EQUAL(dp_timer->timeout, 15);
-  dp_timer = TAILQ_NEXT(dp_timer, next);
-  TEST_ASSERT_NOT_NULL(dp_timer);
-  TEST_ASSERT_EQUAL(dp_timer->timeout, 80);
-  dp_timer = TAILQ_NEXT(dp_timer, next);
-  TEST_ASSERT_NULL(dp_timer);
+void
+test_add_dp_timer(void) {
+  struct dp_timer_list expired;
+  struct dp_timer *dp_timer;
+  int arg;
+
+  TEST_ASSERT_NOT_NULL(add_dp_timer(0, 3, count_expire, &arg));
+  TAILQ_INIT(&expired);
+  expire_count = 0;
+  pthread_mutex_lock(&wheel_lock);
+  dp_timer_wheel_advance(&dp_timer_wheel, dp_timer_wheel.now + 3, &expired);
+  pthread_mutex_unlock(&wheel_lock);
+  while ((dp_timer = TAILQ_FIRST(&expired)) != NULL) {
+    TAILQ_REMOVE(&expired, dp_timer, next);
+    dp_timer_expire(dp_timer);
+    free(dp_timer);
+  }
+  TEST_ASSERT_EQUAL(expire_count, 1);
+}
 
-  t_add_flow_timer(30);
-  TEST_ASSERT_EQUAL(rv, LAGOPUS_RESULT_OK);
-  dp_timer = TAILQ_FIRST(&dp_timer_list);
-  TEST_ASSERT_NOT_NULL(dp_timer);
-  TEST_ASSERT_EQUAL(dp_timer->timeout, 5);
-  dp_timer = TAILQ_NEXT(dp_timer, next);
-  TEST_ASSERT_NOT_NULL(dp_timer);
-  TEST_ASSERT_EQUAL(dp_timer->timeout, 15);
-  dp_timer = TAILQ_NEXT(dp_timer, next);
-  TEST_ASSERT_NOT_NULL(dp_timer);
-  TEST_ASSERT_EQUAL(dp_timer->timeout, 10);
-  dp_timer = TAILQ_NEXT(dp_timer, next);
-  TEST_ASSERT_NOT_NULL(dp_timer);
-  TEST_ASSERT_EQUAL(dp_timer->timeout, 70);
-  dp_timer = TAILQ_NEXT(dp_timer, next);
-  TEST_ASSERT_NULL(dp_timer);
+void
+test_add_classifier_timer(void) {
+  lagopus_result_t rv;
 
-  t_add_flow_timer(1);
+  rv = add_classifier_timer(100);
   TEST_ASSERT_EQUAL(rv, LAGOPUS_RESULT_OK);
-  dp_timer = TAILQ_FIRST(&dp_timer_list);
-  TEST_ASSERT_NOT_NULL(dp_timer);
-  TEST_ASSERT_EQUAL(dp_timer->timeout, 1);
-  dp_timer = TAILQ_NEXT(dp_timer, next);
-  TEST_ASSERT_NOT_NULL(dp_timer);
-  TEST_ASSERT_EQUAL(dp_timer->timeout, 4);
-  dp_timer = TAILQ_NEXT(dp_timer, next);
-  TEST_ASSERT_NOT_NULL(dp_timer);
-  TEST_ASSERT_EQUAL(dp_timer->timeout, 15);
-  dp_timer = TAILQ_NEXT(dp_timer, next);
-  TEST_ASSERT_NOT_NULL(dp_timer);
-  TEST_ASSERT_EQUAL(dp_timer->timeout, 10);
-  dp_timer = TAILQ_NEXT(dp_timer, next);
-  TEST_ASSERT_NOT_NULL(dp_timer);
-  TEST_ASSERT_EQUAL(dp_timer->timeout, 70);
-  dp_timer = TAILQ_NEXT(dp_timer, next);
-  TEST_ASSERT_NULL(dp_timer);
-
-  rv = add_mbtree_timer(&flow_list, 8);
+  /* pending timer is not added twice. */
+  rv = add_classifier_timer(100);
   TEST_ASSERT_EQUAL(rv, LAGOPUS_RESULT_OK);
-  dp_timer = TAILQ_FIRST(&dp_timer_list);
-  TEST_ASSERT_NOT_NULL(dp_timer);
-  TEST_ASSERT_EQUAL(dp_timer->timeout, 1);
-  dp_timer = TAILQ_NEXT(dp_timer, next);
-  TEST_ASSERT_NOT_NULL(dp_timer);
-  TEST_ASSERT_EQUAL(dp_timer->timeout, 4);
-  dp_timer = TAILQ_NEXT(dp_timer, next);
-  TEST_ASSERT_NOT_NULL(dp_timer);
-  TEST_ASSERT_EQUAL(dp_timer->timeout, 3);
-  dp_timer = TAILQ_NEXT(dp_timer, next);
-  TEST_ASSERT_NOT_NULL(dp_timer);
-  TEST_ASSERT_EQUAL(dp_timer->timeout, 12);
-  dp_timer = TAILQ_NEXT(dp_timer, next);
-  TEST_ASSERT_NOT_NULL(dp_timer);
-  TEST_ASSERT_EQUAL(dp_timer->timeout, 10);
-  dp_timer = TAILQ_NEXT(dp_timer, next);
-  TEST_ASSERT_NOT_NULL(dp_timer);
-  TEST_ASSERT_EQUAL(dp_timer->timeout, 70);
-  dp_timer = TAILQ_NEXT(dp_timer, next);
-  TEST_ASSERT_NULL(dp_timer);
 }
@@ -38,9 +38,6 @@
 #include "lagopus/ofp_bridge.h"
 #include "lagopus/ofp_bridgeq_mgr.h"
 #include "lagopus/dp_apis.h"
-#ifdef USE_MBTREE
-#include "lagopus/flowdb.h"
-#endif /* USE_MBTREE */
 
 #include "pktbuf.h"
 #include "packet.h"
@@ -80,9 +77,9 @@ dp_process_event_data(uint64_t dpid, struct eventq_data *data) {
     goto done;
   }
 
-  flowdb_check_update(NULL);
   flowdb_rdlock(NULL);
   bridge = dp_bridge_lookup_by_dpid(dpid);
+  flowdb_epoch_enter(bridge != NULL ? bridge->flowdb : NULL);
   if (bridge != NULL) {
     struct eventq_data *reply;
     struct lagopus_packet *pkt;
@@ -146,48 +143,10 @@ dp_process_event_data(uint64_t dpid, struct eventq_data *data) {
         break;
 
       case LAGOPUS_EVENTQ_BARRIER_REQUEST:
-#ifdef USE_MBTREE
-        /* rebuild branch tree. */
-        {
-          struct flowdb *flowdb;
-          struct table *table;
-          int i;
-
-          flowdb = bridge->flowdb;
-          for (i = 0; i < FLOWDB_TABLE_SIZE_MAX; i++) {
-            table = flowdb_get_table(flowdb, i);
-            if (table != NULL) {
-              cleanup_mbtree(table->flow_list);
-              build_mbtree(table->flow_list);
-            }
-          }
-        }
-#endif /* USE_MBTREE */
-#ifdef USE_THTABLE
-        /* rebuild tuple hash table. */
-        {
-          struct flowdb *flowdb;
-          struct table *table;
-          int i;
-
-          flowdb = bridge->flowdb;
-          for (i = 0; i < FLOWDB_TABLE_SIZE_MAX; i++) {
-            table = flowdb_get_table(flowdb, i);
-            if (table != NULL) {
-              thtable_update(table->flow_list);
-            }
-          }
-        }
-#endif /* USE_THTABLE */
-        /* flush pending requests from OFC, and reply. */
-        if (cache != NULL) {
-          /* clear my own cache */
-          clear_all_cache(cache);
-        }
-#ifdef HAVE_DPDK
-        /* and worker cache */
-        clear_worker_flowcache(true);
-#endif /* HAVE_DPDK */
+        /*
+         * flush pending requests from OFC, and reply.
+         * cached entries are invalidated by changes of flows.
+         */
         reply = malloc(sizeof(*reply));
         if (reply == NULL) {
           break;
@@ -205,6 +164,7 @@ dp_process_event_data(uint64_t dpid, struct eventq_data *data) {
   } else {
     rv = LAGOPUS_RESULT_INVALID_OBJECT;
   }
+  flowdb_epoch_exit(NULL);
   flowdb_rdunlock(NULL);
 
 done:
@@ -48,6 +48,8 @@
 #include "lagopus/dp_apis.h"
 #include "../agent/ofp_match.h"
 #include "callback.h"
+#include "counter.h"
+#include "packet_in.h"
 #include "pktbuf.h"
 #include "packet.h"
 #include "csum.h"
@@ -94,6 +96,9 @@
 #define PUT_TIMEOUT 1LL * 1000LL
 #define FIELD(n) ((n) << 1)
 
+/* max number of packets processed at once in the bulk path. */
+#define DP_BULK_MAX 64
+
 /**
  * action property for each type.  index is OFPAT_*.
  */
@@ -1324,6 +1329,31 @@ group_select_bucket(struct lagopus_packet *pkt, struct bucket_list *list) {
   return bucket;
 }
 
+/**
+ * Select bucket of select group by lookup table.
+ *
+ * @param[in]   pkt     Packet.
+ * @param[in]   group   OFPGT_SELECT group.
+ *
+ * @retval      !=NULL  Selected bucket.
+ * @retval      ==NULL  No live bucket.
+ */
+static inline struct bucket *
+group_select_lookup(struct lagopus_packet *pkt, struct group *group) {
+  struct group_select *sel;
+
+  group_liveness_check(pkt->bridge, group);
+  sel = group->select;
+  if (unlikely(sel == NULL)) {
+    return group_select_bucket(pkt, &group->bucket_list);
+  }
+  if (pkt->hash64 == 0) {
+    calc_packet_hash(pkt);
+  }
+  /* scale hash to table size by multiply instead of modulo. */
+  return sel->table[((pkt->hash64 & 0xffffffff) * sel->size) >> 32];
+}
+
 /**
  * Execute action bucket referenced by group id.
  *
@@ -1351,8 +1381,7 @@ execute_group_action(struct lagopus_packet *pkt, uint32_t group_id) {
   if (unlikely(group == NULL)) {
     return LAGOPUS_RESULT_NOT_FOUND;
   }
-  group->packet_count++;
-  group->byte_count += OS_M_PKTLEN(PKT2MBUF(pkt));
+  dp_counter_add(group->counter_id, 1, OS_M_PKTLEN(PKT2MBUF(pkt)));
   rv = LAGOPUS_RESULT_OK;
 
   switch (group->type) {
@@ -1360,8 +1389,7 @@ execute_group_action(struct lagopus_packet *pkt, uint32_t group_id) {
       TAILQ_FOREACH(bucket, &group->bucket_list, entry) {
         struct lagopus_packet *cpkt;
 
-        bucket->counter.packet_count++;
-        bucket->counter.byte_count += OS_M_PKTLEN(PKT2MBUF(pkt));
+        dp_counter_add(bucket->counter_id, 1, OS_M_PKTLEN(PKT2MBUF(pkt)));
         cpkt = copy_packet(pkt);
         if (cpkt != NULL) {
           re_classify_packet(cpkt);
@@ -1375,7 +1403,8 @@ execute_group_action(struct lagopus_packet *pkt, uint32_t group_id) {
           pkt->hash64 != 0) {
         /* register crc and flows to cache. */
         register_cache(pkt->cache, pkt->hash64,
-                       pkt->nmatched, pkt->matched_flow);
+                       pkt->nmatched, pkt->matched_flow,
+                       pkt->matched_generation);
       }
       /* to free original packet */
       lagopus_packet_free(pkt);
@@ -1387,10 +1416,9 @@ execute_group_action(struct lagopus_packet *pkt, uint32_t group_id) {
        * select one bucket.
        * selection algorithm is depend on the switch.
        */
-      bucket = group_select_bucket(pkt, &group->bucket_list);
+      bucket = group_select_lookup(pkt, group);
       if (bucket != NULL) {
-        bucket->counter.packet_count++;
-        bucket->counter.byte_count += OS_M_PKTLEN(PKT2MBUF(pkt));
+        dp_counter_add(bucket->counter_id, 1, OS_M_PKTLEN(PKT2MBUF(pkt)));
         rv = execute_action_set(pkt, bucket->actions);
       }
       break;
@@ -1399,18 +1427,17 @@ execute_group_action(struct lagopus_packet *pkt, uint32_t group_id) {
       /* execute only one bucket */
       bucket = TAILQ_FIRST(&group->bucket_list);
       if (bucket != NULL) {
-        bucket->counter.packet_count++;
-        bucket->counter.byte_count += OS_M_PKTLEN(PKT2MBUF(pkt));
+        dp_counter_add(bucket->counter_id, 1, OS_M_PKTLEN(PKT2MBUF(pkt)));
         rv = execute_action_set(pkt, bucket->actions);
       }
       break;
 
     case OFPGT_FF:
       /* execute only one live bucket */
-      bucket = group_live_bucket(pkt->bridge, group);
+      group_liveness_check(pkt->bridge, group);
+      bucket = group->live_bucket;
       if (bucket != NULL) {
-        bucket->counter.packet_count++;
-        bucket->counter.byte_count += OS_M_PKTLEN(PKT2MBUF(pkt));
+        dp_counter_add(bucket->counter_id, 1, OS_M_PKTLEN(PKT2MBUF(pkt)));
         rv = execute_action_set(pkt, bucket->actions);
       }
       break;
@@ -1515,6 +1542,8 @@ send_port_status(struct port *port, uint8_t reason) {
   if (port == NULL || port->bridge == NULL) {
     return LAGOPUS_RESULT_INVALID_OBJECT;
   }
+  /* groups watching the port are refreshed. */
+  group_liveness_changed();
   entry = malloc(sizeof(*entry));
   if (entry == NULL) {
     return LAGOPUS_RESULT_NO_MEMORY;
@@ -1532,17 +1561,6 @@ send_port_status(struct port *port, uint8_t reason) {
   return rv;
 }
 
-static void
-packet_in_free(struct eventq_data *data) {
-  if (data != NULL) {
-    ofp_match_list_elem_free(&data->packet_in.match_list);
-    if (data->packet_in.data != NULL) {
-      pbuf_free(data->packet_in.data);
-    }
-    free(data);
-  }
-}
-
 int
 lagopus_send_packet_physical(struct lagopus_packet *pkt,
                              struct interface *ifp) {
@@ -1561,6 +1579,12 @@ lagopus_send_packet_physical(struct lagopus_packet *pkt,
       return rawsock_send_packet_physical(pkt,
                                           ifp->info.eth_rawsock.port_number);
 
+#ifdef __linux__
+    case DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP:
+      return afxdp_send_packet_physical(pkt,
+                                        ifp->info.eth_afxdp.port_number);
+#endif /* __linux__ */
+
     case DATASTORE_INTERFACE_TYPE_GRE:
     case DATASTORE_INTERFACE_TYPE_NVGRE:
     case DATASTORE_INTERFACE_TYPE_VXLAN:
@@ -1586,12 +1610,16 @@ send_packet_in(struct lagopus_packet *pkt,
   struct match *port_match, *metadata_match;
   struct pbuf *pbuf;
   uint32_t port_no;
-  lagopus_result_t rv;
 
   DP_PRINT("%s\n", __func__);
   if (pkt->bridge == NULL) {
     return LAGOPUS_RESULT_INVALID_OBJECT;
   }
+  /* taken from the pool of the bridge, dropped if rate limited. */
+  data = packet_in_event_alloc(pkt->bridge->packet_in, reason, size);
+  if (data == NULL) {
+    return LAGOPUS_RESULT_NO_MEMORY;
+  }
   if ((pkt->flags & PKT_FLAG_RECALC_CKSUM_MASK) != 0) {
     if (pkt->ether_type == ETHERTYPE_IP) {
       lagopus_update_ipv4_checksum(pkt);
@@ -1599,49 +1627,20 @@ send_packet_in(struct lagopus_packet *pkt,
       lagopus_update_ipv6_checksum(pkt);
     }
   }
-  data = malloc(sizeof(*data));
-  if (data == NULL) {
-    return LAGOPUS_RESULT_NO_MEMORY;
-  }
-  pbuf = pbuf_alloc(size);
-  if (pbuf == NULL) {
-    free(data);
-    return LAGOPUS_RESULT_NO_MEMORY;
-  }
-  port_match = calloc(1, sizeof(struct match) + sizeof(port_no));
-  if (port_match == NULL) {
-    pbuf_free(pbuf);
-    free(data);
-    return LAGOPUS_RESULT_NO_MEMORY;
-  }
-  if (pkt->oob_data.metadata != 0) {
-    metadata_match = calloc(1, sizeof(struct match) +
-                            sizeof(pkt->oob_data.metadata));
-    if (metadata_match == NULL) {
-      pbuf_free(pbuf);
-      free(data);
-      free(port_match);
-      return LAGOPUS_RESULT_NO_MEMORY;
-    }
-  } else {
-    metadata_match = NULL;
-  }
-  data->type = LAGOPUS_EVENTQ_PACKET_IN;
-  data->free = packet_in_free;
   data->packet_in.ofp_packet_in.buffer_id = OFP_NO_BUFFER;
   data->packet_in.ofp_packet_in.reason = reason;
   data->packet_in.ofp_packet_in.table_id = pkt->table_id;
   data->packet_in.ofp_packet_in.cookie = cookie;
+  pbuf = data->packet_in.data;
   ENCODE_PUT(OS_MTOD(PKT2MBUF(pkt), void *), size);
-  data->packet_in.data = pbuf;
   data->packet_in.miss_send_len = miss_send_len;
 
-  TAILQ_INIT(&data->packet_in.match_list);
   /*
    * make context as match_list.
    * standard contexts are IN_PORT, IN_PHY_PORT, METADATA and TUNNEL_ID.
    */
   /* IN_PORT */
+  port_match = packet_in_event_port_match(data);
   port_match->oxm_field = FIELD(OFPXMT_OFB_IN_PORT);
   port_match->oxm_length = sizeof(port_no);
   port_no = OS_HTONL(pkt->in_port->ofp_port.port_no);
@@ -1653,6 +1652,7 @@ send_packet_in(struct lagopus_packet *pkt,
 
   /* METADATA */
   if (pkt->oob_data.metadata != 0) {
+    metadata_match = packet_in_event_metadata_match(data);
     metadata_match->oxm_field = FIELD(OFPXMT_OFB_METADATA);
     metadata_match->oxm_length = sizeof(pkt->oob_data.metadata);
     OS_MEMCPY(metadata_match->oxm_value,
@@ -1660,20 +1660,13 @@ send_packet_in(struct lagopus_packet *pkt,
               sizeof(pkt->oob_data.metadata));
     metadata_match->oxm_class = OFPXMC_OPENFLOW_BASIC;
     TAILQ_INSERT_TAIL(&data->packet_in.match_list, metadata_match, entry);
-  } else {
-    free(metadata_match);
   }
 
   /* TUNNEL_ID for physical port is omitted. */
 
   DP_PRINT("%s: put packet to dataq\n", __func__);
-  rv = dp_dataq_data_put(pkt->bridge->dpid,
-                         &data, PUT_TIMEOUT);
-  if (rv != LAGOPUS_RESULT_OK) {
-    DP_PRINT("%s: %s\n", __func__, lagopus_error_get_string(rv));
-    data->free(data);
-  }
-  return rv;
+  packet_in_event_put(pkt->bridge, data);
+  return LAGOPUS_RESULT_OK;
 }
 
 static bool
@@ -1834,7 +1827,8 @@ execute_action_output(struct lagopus_packet *pkt,
         pkt->hash64 != 0) {
       /* register crc and flows to cache. */
       register_cache(pkt->cache, pkt->hash64,
-                     pkt->nmatched, pkt->matched_flow);
+                     pkt->nmatched, pkt->matched_flow,
+                     pkt->matched_generation);
     }
     dp_interface_tx_packet(pkt, port, action->cookie);
     rv = LAGOPUS_RESULT_NO_MORE_ACTION;
@@ -2719,56 +2713,124 @@ lagopus_set_instruction_function(struct instruction *instruction) {
   }
 }
 
+/**
+ * Execute flows of the cache entry matched by the packet.
+ */
 static inline lagopus_result_t
-dp_openflow_do_cached_action(struct lagopus_packet *pkt) {
+dp_openflow_do_cached_entry(struct lagopus_packet *pkt,
+                            const struct cache_entry *cache_entry) {
   struct flowdb *flowdb;
   struct flow *flow;
-  struct flow **flowp;
+  struct flow * const *flowp;
   struct table *table;
-  const struct cache_entry *cache_entry;
   lagopus_result_t rv;
   unsigned i;
 
   flowdb = pkt->bridge->flowdb;
 
+  DP_PRINT("MATCHED (cache)\n");
+  pkt->flags |= PKT_FLAG_CACHED_FLOW;
+  flowp = cache_entry->flow;
+
+  rv = LAGOPUS_RESULT_OK;
+  for (i = 0; i < cache_entry->nmatched; i++) {
+    flow = *flowp++;
+    dp_counter_add(flow->counter_id, 1, OS_M_PKTLEN(PKT2MBUF(pkt)));
+    pkt->flow = flow;
+    pkt->table_id = flow->table_id;
+    table = table_lookup(flowdb, pkt->table_id);
+#ifdef DIAGNOSTIC
+    if (table == NULL) {
+      printf("cache_entry->flow[%u].table_id = %d, invalid\n",
+             i, flow->table_id);
+    }
+#endif /* DIAGNOSTIC */
+    dp_counter_add(table->lookup_counter_id, 1, 0);
+    if (likely(flow->priority > 0)) {
+      dp_counter_add(table->matched_counter_id, 1, 0);
+    }
+    rv = execute_instruction(pkt,
+                             (const struct instruction **)flow->instruction);
+    if (rv != LAGOPUS_RESULT_OK) {
+      break;
+    }
+  }
+  return rv;
+}
+
+static inline lagopus_result_t
+dp_openflow_do_cached_action(struct lagopus_packet *pkt) {
+  const struct cache_entry *cache_entry;
+
   calc_packet_hash(pkt);
   cache_entry = cache_lookup(pkt->cache, pkt);
   if (likely(cache_entry != NULL)) {
-    DP_PRINT("MATCHED (cache)\n");
-    pkt->flags |= PKT_FLAG_CACHED_FLOW;
-    flowp = cache_entry->flow;
+    return dp_openflow_do_cached_entry(pkt, cache_entry);
+  }
+  return LAGOPUS_RESULT_NOT_FOUND;
+}
 
-    rv = LAGOPUS_RESULT_OK;
-    for (i = 0; i < cache_entry->nmatched; i++) {
-      flow = *flowp++;
-      flow->packet_count++;
-      flow->byte_count += OS_M_PKTLEN(PKT2MBUF(pkt));
-      if (flow->idle_timeout != 0 || flow->hard_timeout != 0) {
-        flow->update_time = get_current_time();
-      }
-      pkt->flow = flow;
-      pkt->table_id = flow->table_id;
-      table = table_lookup(flowdb, pkt->table_id);
-#ifdef DIAGNOSTIC
-      if (table == NULL) {
-        printf("cache_entry->flow[%u].table_id = %d, invalid\n",
-               i, flow->table_id);
-      }
-#endif /* DIAGNOSTIC */
-      table->lookup_count++;
-      if (likely(flow->priority > 0)) {
-        table->matched_count++;
+/**
+ * Execute flows of the cache entry for all packets hitting it.
+ * Counters are updated once per flow, and instructions of a flow are
+ * executed for every packet before going to the next flow.
+ *
+ * @param[in]   cache_entry     Cache entry.
+ * @param[in]   pkts            Packets hitting the entry.
+ * @param[out]  rvs             Result of each packet.
+ * @param[in]   npkts           Number of packets.
+ */
+static inline void
+dp_openflow_do_cached_group(const struct cache_entry *cache_entry,
+                            struct lagopus_packet *pkts[],
+                            lagopus_result_t rvs[],
+                            size_t npkts) {
+  struct flowdb *flowdb;
+  struct flow *flow;
+  struct table *table;
+  uint64_t nbytes;
+  size_t j, nactive;
+  unsigned i;
+
+  /* same hash value, packets are received by the same bridge. */
+  flowdb = pkts[0]->bridge->flowdb;
+  for (j = 0; j < npkts; j++) {
+    pkts[j]->flags |= PKT_FLAG_CACHED_FLOW;
+    rvs[j] = LAGOPUS_RESULT_OK;
+  }
+  DP_PRINT("MATCHED (cache, %zu packets)\n", npkts);
+
+  for (i = 0; i < cache_entry->nmatched; i++) {
+    flow = cache_entry->flow[i];
+    nactive = 0;
+    nbytes = 0;
+    for (j = 0; j < npkts; j++) {
+      if (rvs[j] == LAGOPUS_RESULT_OK) {
+        nactive++;
+        nbytes += OS_M_PKTLEN(PKT2MBUF(pkts[j]));
       }
-      rv = execute_instruction(pkt,
-                               (const struct instruction **)flow->instruction);
-      if (rv != LAGOPUS_RESULT_OK) {
-        break;
+    }
+    if (nactive == 0) {
+      break;
+    }
+    dp_counter_add(flow->counter_id, nactive, nbytes);
+    table = table_lookup(flowdb, flow->table_id);
+    dp_counter_add(table->lookup_counter_id, nactive, 0);
+    if (likely(flow->priority > 0)) {
+      dp_counter_add(table->matched_counter_id, nactive, 0);
+    }
+    for (j = 0; j < npkts; j++) {
+      if (rvs[j] != LAGOPUS_RESULT_OK) {
+        /* stopped, or already freed by output. */
+        continue;
       }
+      pkts[j]->flow = flow;
+      pkts[j]->table_id = flow->table_id;
+      rvs[j] = execute_instruction(pkts[j],
+                                   (const struct instruction **)
+                                   flow->instruction);
     }
-  } else {
-    rv = LAGOPUS_RESULT_NOT_FOUND;
   }
-  return rv;
 }
 
 /**
@@ -2779,6 +2841,7 @@ dp_openflow_match(struct lagopus_packet *pkt) {
   struct flowdb *flowdb;
   struct flow *flow;
   struct table *table;
+  uint32_t generation;
   lagopus_result_t rv;
 
   flowdb = pkt->bridge->flowdb;
@@ -2790,16 +2853,16 @@ dp_openflow_match(struct lagopus_packet *pkt) {
     return LAGOPUS_RESULT_STOP;
   }
 
-  table->lookup_count++;
-#ifdef USE_MBTREE
-  flow = find_mbtree(pkt, table->flow_list);
-#else
+  dp_counter_add(table->lookup_counter_id, 1, 0);
+  /* generation must be read before the classifier, see flowdb_publish(). */
+  generation = table->generation;
+  mbar();
   flow = lagopus_find_flow(pkt, table);
-#endif
   if (likely(flow != NULL && pkt->nmatched < LAGOPUS_DP_PIPELINE_MAX)) {
     DP_PRINT("MATCHED\n");
     /* execute_instruction is able to call this function recursively. */
     pkt->flow = flow;
+    pkt->matched_generation[pkt->nmatched] = generation;
     pkt->matched_flow[pkt->nmatched++] = flow;
     rv = LAGOPUS_RESULT_OK;
   } else {
@@ -2855,6 +2918,36 @@ dp_openflow_do_action_set(struct lagopus_packet *pkt) {
   return rv;
 }
 
+/**
+ * Continue pipeline from the result of the first table lookup.
+ */
+static inline lagopus_result_t
+dp_openflow_do_pipeline(struct lagopus_packet *pkt, lagopus_result_t rv) {
+  while (rv == LAGOPUS_RESULT_OK) {
+    rv = dp_openflow_do_action(pkt);
+    if (rv <= LAGOPUS_RESULT_OK) {
+      break;
+    }
+    rv = dp_openflow_match(pkt);
+  }
+  return rv;
+}
+
+/**
+ * Execute action set and free the packet if not sent.
+ */
+static inline lagopus_result_t
+dp_openflow_finish(struct lagopus_packet *pkt, lagopus_result_t rv) {
+  if (rv == LAGOPUS_RESULT_OK) {
+    rv = dp_openflow_do_action_set(pkt);
+  }
+  /* required: if no output action, drop packet. */
+  if (rv != LAGOPUS_RESULT_NO_MORE_ACTION) {
+    lagopus_packet_free(pkt);
+  }
+  return rv;
+}
+
 /*
  * process received packet.
  */
@@ -2864,25 +2957,105 @@ lagopus_match_and_action(struct lagopus_packet *pkt) {
 
   rv = dp_openflow_do_cached_action(pkt);
   if (unlikely(rv == LAGOPUS_RESULT_NOT_FOUND)) {
-    for (;;) {
-      rv = dp_openflow_match(pkt);
-      if (rv != LAGOPUS_RESULT_OK) {
-        break;
+    rv = dp_openflow_do_pipeline(pkt, dp_openflow_match(pkt));
+  }
+  return dp_openflow_finish(pkt, rv);
+}
+
+static void
+dp_openflow_bulk(struct lagopus_packet *pkts[], size_t npkts,
+                 struct flowcache *cache) {
+  struct cache_entry *entries[DP_BULK_MAX];
+  const struct cache_entry *cache_entry;
+  struct lagopus_packet *group[DP_BULK_MAX];
+  struct lagopus_packet *pkt;
+  lagopus_result_t rvs[DP_BULK_MAX];
+  size_t misses[DP_BULK_MAX];
+  size_t i, j, k, ngroup, nmiss;
+
+  /* 1st stage: hash all packets. */
+  for (i = 0; i < npkts; i++) {
+    pkts[i]->cache = cache;
+    calc_packet_hash(pkts[i]);
+  }
+
+  /* 2nd stage: lookup cache of all packets. */
+  cache_lookup_bulk(cache, pkts, npkts, entries);
+  nmiss = 0;
+  for (i = 0; i < npkts; i++) {
+    if (entries[i] == NULL) {
+      misses[nmiss++] = i;
+    }
+  }
+
+  /* 3rd stage: packets hitting the same entry are processed together. */
+  for (i = 0; i < npkts; i++) {
+    cache_entry = entries[i];
+    if (cache_entry == NULL) {
+      continue;
+    }
+    ngroup = 0;
+    for (j = i; j < npkts; j++) {
+      if (entries[j] == cache_entry) {
+        group[ngroup++] = pkts[j];
+        entries[j] = NULL;
       }
-      rv = dp_openflow_do_action(pkt);
-      if (rv <= LAGOPUS_RESULT_OK) {
-        break;
+    }
+    dp_openflow_do_cached_group(cache_entry, group, rvs, ngroup);
+    for (j = 0; j < ngroup; j++) {
+      (void)dp_openflow_finish(group[j], rvs[j]);
+    }
+  }
+
+  /*
+   * 4th stage: missed packets are grouped and handled in received order.
+   * First table is looked up for each of them one by one, there is no
+   * batched classifier lookup.  A packet of the same flow as a preceding
+   * miss skips the lookup, it hits the cache entry made by that packet.
+   */
+  for (k = 0; k < nmiss; k++) {
+    pkt = pkts[misses[k]];
+    rvs[k] = LAGOPUS_RESULT_OK;
+    if (cache != NULL) {
+      for (j = 0; j < k; j++) {
+        if (pkts[misses[j]]->hash64 == pkt->hash64) {
+          /* same flow as the preceding packet, cached by it. */
+          rvs[k] = LAGOPUS_RESULT_NOT_FOUND;
+          break;
+        }
       }
     }
+    if (rvs[k] == LAGOPUS_RESULT_OK) {
+      rvs[k] = dp_openflow_match(pkt);
+    }
   }
-  if (rv == LAGOPUS_RESULT_OK) {
-    rv = dp_openflow_do_action_set(pkt);
+  for (k = 0; k < nmiss; k++) {
+    pkt = pkts[misses[k]];
+    if (unlikely(rvs[k] == LAGOPUS_RESULT_NOT_FOUND)) {
+      cache_entry = cache_lookup(cache, pkt);
+      if (cache_entry != NULL) {
+        (void)dp_openflow_finish(pkt,
+                                 dp_openflow_do_cached_entry(pkt,
+                                                             cache_entry));
+        continue;
+      }
+      rvs[k] = dp_openflow_match(pkt);
+    }
+    (void)dp_openflow_finish(pkt, dp_openflow_do_pipeline(pkt, rvs[k]));
   }
-  /* required: if no output action, drop packet. */
-  if (rv != LAGOPUS_RESULT_NO_MORE_ACTION) {
-    lagopus_packet_free(pkt);
+}
+
+void
+lagopus_bulk_match_and_action(struct lagopus_packet *pkts[], size_t npkts,
+                              struct flowcache *cache) {
+  size_t n;
+
+  while (npkts > 0) {
+    n = npkts < DP_BULK_MAX ? npkts : DP_BULK_MAX;
+    dp_openflow_bulk(pkts, n, cache);
+    pkts += n;
+    npkts -= n;
   }
-  return rv;
 }
 
 #ifdef HYBRID
@@ -0,0 +1,193 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ *      @file   dispatch_hash.c
+ *      @brief  Flow hash of received frame to dispatch it to workers.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <netinet/in.h>
+
+#include "lagopus/ethertype.h"
+#include "dispatch_hash.h"
+
+#define ETHERTYPE_QINQ          0x88a8
+#define ETHERTYPE_TEB           0x6558
+#define VXLAN_PORT              4789
+#define VXLAN_HDR_LEN           8
+#define GRE_FLAG_CSUM           0x8000
+#define GRE_FLAG_KEY            0x2000
+#define GRE_FLAG_SEQ            0x1000
+#define GRE_VERSION             0x0007
+/* outer and inner headers. */
+#define DISPATCH_HASH_DEPTH     2
+
+static inline uint16_t
+get16(const uint8_t *p) {
+  return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t
+get32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+         ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline uint64_t
+mix(uint64_t hash, uint32_t val) {
+  hash = (hash ^ val) * 0x9e3779b97f4a7c15ULL;
+  return hash ^ (hash >> 32);
+}
+
+static inline uint64_t
+mix_bytes(uint64_t hash, const uint8_t *p, size_t len) {
+  size_t i;
+
+  for (i = 0; i + 4 <= len; i += 4) {
+    hash = mix(hash, get32(p + i));
+  }
+  for (; i < len; i++) {
+    hash = mix(hash, p[i]);
+  }
+  return hash;
+}
+
+uint32_t
+dispatch_hash(const uint8_t *data, size_t len, uint32_t seed) {
+  const uint8_t *p, *end, *l4;
+  uint64_t hash;
+  uint16_t type, flags, dport;
+  uint8_t proto;
+  int depth;
+  size_t hlen;
+
+  p = data;
+  end = data + len;
+  hash = seed;
+  depth = 0;
+
+ether:
+  if (end - p < 14) {
+    goto out;
+  }
+  type = get16(p + 12);
+  while (type == ETHERTYPE_VLAN || type == ETHERTYPE_QINQ) {
+    if (end - p < 18) {
+      goto out;
+    }
+    p += 4;
+    type = get16(p + 12);
+  }
+  if (type != ETHERTYPE_IP && type != ETHERTYPE_IPV6) {
+    /* non-IP flows are told by ethernet addresses. */
+    hash = mix_bytes(hash, p, 12);
+    hash = mix(hash, type);
+    goto out;
+  }
+  p += 14;
+
+ip:
+  if (type == ETHERTYPE_IP) {
+    if (end - p < 20) {
+      goto out;
+    }
+    hlen = (size_t)(p[0] & 0x0f) << 2;
+    proto = p[9];
+    hash = mix(hash, get32(p + 12));
+    hash = mix(hash, get32(p + 16));
+    hash = mix(hash, proto);
+    /* fragments do not have ports except the first one. */
+    if ((get16(p + 6) & 0x3fff) != 0 || hlen < 20) {
+      goto out;
+    }
+  } else {
+    if (end - p < 40) {
+      goto out;
+    }
+    hlen = 40;
+    proto = p[6];
+    hash = mix_bytes(hash, p + 8, 32);
+    /* skip extension headers without ports. */
+    while (proto == IPPROTO_HOPOPTS || proto == IPPROTO_ROUTING ||
+           proto == IPPROTO_DSTOPTS) {
+      if (end - p < (ptrdiff_t)hlen + 8) {
+        goto out;
+      }
+      proto = p[hlen];
+      hlen += ((size_t)p[hlen + 1] + 1) << 3;
+    }
+    hash = mix(hash, proto);
+    if (proto == IPPROTO_FRAGMENT) {
+      goto out;
+    }
+  }
+  l4 = p + hlen;
+
+  switch (proto) {
+    case IPPROTO_TCP:
+    case IPPROTO_UDP:
+    case IPPROTO_SCTP:
+      if (end - l4 < 4) {
+        break;
+      }
+      hash = mix(hash, get32(l4));
+      dport = get16(l4 + 2);
+      if (proto == IPPROTO_UDP && dport == VXLAN_PORT &&
+          ++depth < DISPATCH_HASH_DEPTH) {
+        p = l4 + 8 + VXLAN_HDR_LEN;
+        goto ether;
+      }
+      break;
+
+    case IPPROTO_GRE:
+      if (end - l4 < 4 || ++depth >= DISPATCH_HASH_DEPTH) {
+        break;
+      }
+      flags = get16(l4);
+      if ((flags & GRE_VERSION) != 0) {
+        break;
+      }
+      type = get16(l4 + 2);
+      p = l4 + 4;
+      if ((flags & GRE_FLAG_CSUM) != 0) {
+        p += 4;
+      }
+      if ((flags & GRE_FLAG_KEY) != 0) {
+        if (end - p >= 4) {
+          hash = mix(hash, get32(p));
+        }
+        p += 4;
+      }
+      if ((flags & GRE_FLAG_SEQ) != 0) {
+        p += 4;
+      }
+      if (type == ETHERTYPE_TEB) {
+        goto ether;
+      }
+      if (type == ETHERTYPE_IP || type == ETHERTYPE_IPV6) {
+        goto ip;
+      }
+      break;
+
+    default:
+      break;
+  }
+
+out:
+  return (uint32_t)(hash ^ (hash >> 29));
+}
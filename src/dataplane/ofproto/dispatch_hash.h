@@ -0,0 +1,42 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ *      @file   dispatch_hash.h
+ *      @brief  Flow hash of received frame to dispatch it to workers.
+ */
+
+#ifndef SRC_DATAPLANE_OFPROTO_DISPATCH_HASH_H_
+#define SRC_DATAPLANE_OFPROTO_DISPATCH_HASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Hash of IP addresses, protocol and L4 ports of the frame, without
+ * classifying it.  The inner headers of VXLAN and GRE are hashed, and
+ * the ethernet addresses if the frame is not IP.  Used by I/O threads
+ * to keep a flow on a worker; it is not the flow cache key.
+ *
+ * @param[in]   data    Ethernet frame.
+ * @param[in]   len     Length of the frame.
+ * @param[in]   seed    Seed, e.g. the input port.
+ *
+ * @retval      Hash value.
+ */
+uint32_t dispatch_hash(const uint8_t *data, size_t len, uint32_t seed);
+
+#endif /* SRC_DATAPLANE_OFPROTO_DISPATCH_HASH_H_ */
@@ -0,0 +1,876 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ *      @file   exact.c
+ *      @brief  Exact match classifier.
+ *
+ * Flows without masked match fields are kept in a cuckoo hash table.
+ * Flows of the same set of fields have the same shape, and the key is
+ * the shape id and match values in 32bit words of byteoff_match.
+ * Words of the packet used by some shape are read once per packet,
+ * then each shape costs one hash lookup.  A bucket has signatures of
+ * its entries, the entry is referred only if the signature matches.
+ *
+ * Flows with masked fields are passed to the wildcard classifier,
+ * higher priority flow of the two is matched.
+ */
+
+#include "lagopus_config.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/queue.h>
+
+#include <openflow.h>
+
+#include "lagopus_apis.h"
+#include "lagopus/flowdb.h"
+#include "pktbuf.h"
+#include "packet.h"
+#include "counter.h"
+#include "thtable.h"
+
+#include "lagopus/flowinfo.h"
+
+#define EXACT_INITIAL_SIZE 16
+#define EXACT_WAYS 4
+#define EXACT_MAX_KICKS 128
+
+#define EXACT(self) ((struct exact *)(uintptr_t)(self)->userdata)
+
+/**
+ * @brief Number of flows of the priority.
+ */
+struct exact_priority {
+  int32_t priority;             /** Priority. */
+  int count;                    /** Number of flows. */
+};
+
+/**
+ * @brief Word of the shape.
+ */
+struct exact_word {
+  struct thtable_word word;     /** Masked word. */
+  int slot;                     /** Index of the packet word. */
+};
+
+/**
+ * @brief Flows of the same set of match fields.
+ */
+struct exact_shape {
+  uint32_t id;                  /** Shape id, part of the key. */
+  int pos;                      /** Index in sorted shapes. */
+  int nflow;                    /** Number of flows. */
+  int nprio;                    /** Number of priorities. */
+  int nprio_alloc;              /** Allocated size of priorities. */
+  struct exact_priority *prios; /** Priorities in descending order. */
+  int nword;                    /** Number of words. */
+  struct exact_word words[0];   /** Mask. */
+};
+
+/**
+ * @brief Flows of the same match value.
+ */
+struct exact_entry {
+  struct exact_shape *shape;    /** Shape of flows. */
+  uint32_t sig;                 /** Signature, hash of the key. */
+  int nflow;                    /** Number of flows. */
+  struct flow **flows;          /** Flows sorted by priority. */
+  uint32_t key[0];              /** Match value. */
+};
+
+/**
+ * @brief Bucket of the cuckoo hash table.
+ */
+struct exact_bucket {
+  uint32_t sig[EXACT_WAYS];     /** Signatures, 0 if empty. */
+  struct exact_entry *entry[EXACT_WAYS];        /** Entries. */
+};
+
+/**
+ * @brief Word read from the packet.
+ */
+struct exact_slot {
+  struct thtable_word word;     /** Unmasked word. */
+  int refs;                     /** Number of shape words, 0 if unused. */
+};
+
+/**
+ * @brief Exact match classifier.
+ */
+struct exact {
+  struct flowinfo *wildcard;    /** Classifier of flows with masks. */
+  uint32_t size;                /** Number of buckets, power of 2. */
+  uint32_t nentry;              /** Number of entries. */
+  uint32_t kick;                /** Way to be kicked out next. */
+  struct exact_bucket *buckets; /** Buckets. */
+  uint32_t next_id;             /** Id of the next shape. */
+  int nshape;                   /** Number of shapes. */
+  int nalloc;                   /** Allocated size of shapes. */
+  struct exact_shape **shapes;  /** Sorted by max priority. */
+  int nslot;                    /** Number of slots in use. */
+  struct exact_slot slots[THTABLE_WORDS];       /** Words of packet. */
+};
+
+static lagopus_result_t
+add_flow_exact(struct flowinfo *, struct flow *);
+static lagopus_result_t
+del_flow_exact(struct flowinfo *, struct flow *);
+static struct flow *
+match_flow_exact(struct flowinfo *, struct lagopus_packet *, int32_t *);
+static struct flow *
+find_flow_exact(struct flowinfo *, struct flow *);
+static void
+destroy_flowinfo_exact(struct flowinfo *);
+
+static inline int32_t
+exact_shape_max_priority(const struct exact_shape *shape) {
+  return shape->nprio == 0 ? -1 : shape->prios[0].priority;
+}
+
+static inline uint32_t
+exact_sig(uint32_t hash) {
+  return hash != 0 ? hash : 1;
+}
+
+static inline uint32_t
+exact_alt_bucket(uint32_t idx, uint32_t sig, uint32_t size) {
+  return (idx ^ (((sig >> 16) + 1) * 0x5bd1e995)) & (size - 1);
+}
+
+static bool
+exact_flow_is_exact(struct flow *flow) {
+  struct match *match;
+
+  TAILQ_FOREACH(match, &flow->match_list, entry) {
+    if ((match->oxm_field & 1) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static uint32_t
+exact_flow_key(struct flow *flow, const struct exact_shape *shape,
+               uint32_t *key) {
+  uint32_t hash;
+  int i;
+
+  hash = thtable_hash_add(0, shape->id);
+  for (i = 0; i < shape->nword; i++) {
+    thtable_flow_word(flow, &shape->words[i].word, &key[i]);
+    hash = thtable_hash_add(hash, key[i]);
+  }
+  return exact_sig(thtable_hash_finish(hash));
+}
+
+static inline struct exact_entry *
+exact_bucket_find(const struct exact_bucket *bucket,
+                  const struct exact_shape *shape,
+                  const uint32_t *key, uint32_t sig) {
+  struct exact_entry *entry;
+  int way;
+
+  for (way = 0; way < EXACT_WAYS; way++) {
+    if (bucket->sig[way] == sig) {
+      entry = bucket->entry[way];
+      if (entry->shape == shape &&
+          memcmp(entry->key, key,
+                 sizeof(uint32_t) * (size_t)shape->nword) == 0) {
+        return entry;
+      }
+    }
+  }
+  return NULL;
+}
+
+static inline struct exact_entry *
+exact_entry_lookup(const struct exact *exact,
+                   const struct exact_shape *shape,
+                   const uint32_t *key, uint32_t sig) {
+  struct exact_entry *entry;
+  uint32_t idx;
+
+  if (exact->size == 0) {
+    return NULL;
+  }
+  idx = sig & (exact->size - 1);
+  entry = exact_bucket_find(&exact->buckets[idx], shape, key, sig);
+  if (entry == NULL) {
+    idx = exact_alt_bucket(idx, sig, exact->size);
+    entry = exact_bucket_find(&exact->buckets[idx], shape, key, sig);
+  }
+  return entry;
+}
+
+static inline bool
+exact_bucket_put(struct exact_bucket *bucket, struct exact_entry *entry) {
+  int way;
+
+  for (way = 0; way < EXACT_WAYS; way++) {
+    if (bucket->sig[way] == 0) {
+      bucket->sig[way] = entry->sig;
+      bucket->entry[way] = entry;
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ * put the entry in one of its two buckets, kicking out entries to
+ * their other bucket if both are full.  kicked entries are moved
+ * back if no empty way is found.
+ */
+static bool
+exact_cuckoo_insert(struct exact_bucket *buckets, uint32_t size,
+                    uint32_t *kick, struct exact_entry *entry) {
+  struct exact_bucket *bucket;
+  struct exact_entry *victim;
+  uint32_t path[EXACT_MAX_KICKS];
+  uint32_t idx;
+  int n, way;
+
+  idx = entry->sig & (size - 1);
+  for (n = 0; n < EXACT_MAX_KICKS; n++) {
+    if (exact_bucket_put(&buckets[idx], entry) == true ||
+        exact_bucket_put(&buckets[exact_alt_bucket(idx, entry->sig, size)],
+                         entry) == true) {
+      return true;
+    }
+    way = (int)((*kick)++ % EXACT_WAYS);
+    bucket = &buckets[idx];
+    victim = bucket->entry[way];
+    bucket->sig[way] = entry->sig;
+    bucket->entry[way] = entry;
+    path[n] = idx * EXACT_WAYS + (uint32_t)way;
+    entry = victim;
+    idx = exact_alt_bucket(idx, entry->sig, size);
+  }
+  while (n-- > 0) {
+    bucket = &buckets[path[n] / EXACT_WAYS];
+    way = (int)(path[n] % EXACT_WAYS);
+    victim = bucket->entry[way];
+    bucket->sig[way] = entry->sig;
+    bucket->entry[way] = entry;
+    entry = victim;
+  }
+  return false;
+}
+
+/*
+ * move all entries to new buckets, size is doubled until all of them
+ * are placed.
+ */
+static lagopus_result_t
+exact_resize(struct exact *exact, uint32_t size) {
+  struct exact_bucket *buckets;
+  uint32_t i;
+  int way;
+
+ again:
+  buckets = calloc(size, sizeof(struct exact_bucket));
+  if (buckets == NULL) {
+    return LAGOPUS_RESULT_NO_MEMORY;
+  }
+  for (i = 0; i < exact->size; i++) {
+    for (way = 0; way < EXACT_WAYS; way++) {
+      if (exact->buckets[i].sig[way] != 0 &&
+          exact_cuckoo_insert(buckets, size, &exact->kick,
+                              exact->buckets[i].entry[way]) == false) {
+        free(buckets);
+        size *= 2;
+        goto again;
+      }
+    }
+  }
+  free(exact->buckets);
+  exact->buckets = buckets;
+  exact->size = size;
+  return LAGOPUS_RESULT_OK;
+}
+
+static lagopus_result_t
+exact_entry_insert(struct exact *exact, struct exact_entry *entry) {
+  lagopus_result_t rv;
+
+  /* keep load factor under 7/8. */
+  if ((uint64_t)(exact->nentry + 1) * 8 >
+      (uint64_t)exact->size * EXACT_WAYS * 7) {
+    rv = exact_resize(exact,
+                      exact->size == 0 ? EXACT_INITIAL_SIZE : exact->size * 2);
+    if (rv != LAGOPUS_RESULT_OK) {
+      return rv;
+    }
+  }
+  while (exact_cuckoo_insert(exact->buckets, exact->size,
+                             &exact->kick, entry) == false) {
+    rv = exact_resize(exact, exact->size * 2);
+    if (rv != LAGOPUS_RESULT_OK) {
+      return rv;
+    }
+  }
+  exact->nentry++;
+  return LAGOPUS_RESULT_OK;
+}
+
+static void
+exact_entry_remove(struct exact *exact, struct exact_entry *entry) {
+  struct exact_bucket *bucket;
+  uint32_t idx;
+  int way, i;
+
+  idx = entry->sig & (exact->size - 1);
+  for (i = 0; i < 2; i++) {
+    bucket = &exact->buckets[idx];
+    for (way = 0; way < EXACT_WAYS; way++) {
+      if (bucket->entry[way] == entry && bucket->sig[way] != 0) {
+        bucket->sig[way] = 0;
+        bucket->entry[way] = NULL;
+        exact->nentry--;
+        return;
+      }
+    }
+    idx = exact_alt_bucket(idx, entry->sig, exact->size);
+  }
+}
+
+static void
+exact_swap(struct exact *exact, int a, int b) {
+  struct exact_shape *shape;
+
+  shape = exact->shapes[a];
+  exact->shapes[a] = exact->shapes[b];
+  exact->shapes[b] = shape;
+  exact->shapes[a]->pos = a;
+  exact->shapes[b]->pos = b;
+}
+
+/*
+ * move the shape to keep shapes sorted by max priority.
+ */
+static void
+exact_sort(struct exact *exact, struct exact_shape *shape) {
+  int32_t max_priority;
+  int pos;
+
+  max_priority = exact_shape_max_priority(shape);
+  pos = shape->pos;
+  while (pos > 0 &&
+         exact_shape_max_priority(exact->shapes[pos - 1]) < max_priority) {
+    exact_swap(exact, pos - 1, pos);
+    pos--;
+  }
+  while (pos < exact->nshape - 1 &&
+         exact_shape_max_priority(exact->shapes[pos + 1]) > max_priority) {
+    exact_swap(exact, pos, pos + 1);
+    pos++;
+  }
+}
+
+static int
+exact_slot_get(struct exact *exact, const struct thtable_word *word) {
+  int i, empty;
+
+  empty = -1;
+  for (i = 0; i < exact->nslot; i++) {
+    if (exact->slots[i].refs == 0) {
+      if (empty < 0) {
+        empty = i;
+      }
+    } else if (exact->slots[i].word.base == word->base &&
+               exact->slots[i].word.off == word->off) {
+      exact->slots[i].refs++;
+      return i;
+    }
+  }
+  if (empty < 0) {
+    empty = exact->nslot++;
+  }
+  exact->slots[empty].word.base = word->base;
+  exact->slots[empty].word.off = word->off;
+  exact->slots[empty].word.mask = 0xffffffff;
+  exact->slots[empty].refs = 1;
+  return empty;
+}
+
+static void
+exact_slot_put(struct exact *exact, int slot) {
+  exact->slots[slot].refs--;
+  while (exact->nslot > 0 && exact->slots[exact->nslot - 1].refs == 0) {
+    exact->nslot--;
+  }
+}
+
+static bool
+exact_shape_equal(const struct exact_shape *shape,
+                  const struct thtable_word *words, int nword) {
+  int i;
+
+  if (shape->nword != nword) {
+    return false;
+  }
+  for (i = 0; i < nword; i++) {
+    if (shape->words[i].word.base != words[i].base ||
+        shape->words[i].word.off != words[i].off ||
+        shape->words[i].word.mask != words[i].mask) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * shapes are few, they are searched linearly.
+ */
+static struct exact_shape *
+exact_shape_get(struct exact *exact, struct flow *flow, bool create) {
+  struct exact_shape *shape, **shapes;
+  struct thtable_word words[THTABLE_WORDS];
+  int stage_end[THTABLE_STAGES];
+  int i, nword, nalloc;
+
+  nword = thtable_flow_mask(flow, words, stage_end);
+  for (i = 0; i < exact->nshape; i++) {
+    if (exact_shape_equal(exact->shapes[i], words, nword) == true) {
+      return exact->shapes[i];
+    }
+  }
+  if (create == false) {
+    return NULL;
+  }
+  if (exact->nshape == exact->nalloc) {
+    nalloc = exact->nalloc == 0 ? EXACT_INITIAL_SIZE : exact->nalloc * 2;
+    shapes = realloc(exact->shapes,
+                     sizeof(struct exact_shape *) * (size_t)nalloc);
+    if (shapes == NULL) {
+      return NULL;
+    }
+    exact->shapes = shapes;
+    exact->nalloc = nalloc;
+  }
+  shape = calloc(1, sizeof(struct exact_shape) +
+                 sizeof(struct exact_word) * (size_t)nword);
+  if (shape == NULL) {
+    return NULL;
+  }
+  shape->id = exact->next_id++;
+  shape->nword = nword;
+  for (i = 0; i < nword; i++) {
+    shape->words[i].word = words[i];
+    shape->words[i].slot = exact_slot_get(exact, &words[i]);
+  }
+  shape->pos = exact->nshape;
+  exact->shapes[exact->nshape++] = shape;
+  return shape;
+}
+
+static void
+exact_shape_del(struct exact *exact, struct exact_shape *shape) {
+  int i;
+
+  exact->nshape--;
+  for (i = shape->pos; i < exact->nshape; i++) {
+    exact->shapes[i] = exact->shapes[i + 1];
+    exact->shapes[i]->pos = i;
+  }
+  for (i = 0; i < shape->nword; i++) {
+    exact_slot_put(exact, shape->words[i].slot);
+  }
+  free(shape->prios);
+  free(shape);
+}
+
+static int
+exact_priority_search(const struct exact_shape *shape, int32_t priority) {
+  int st, ed, off;
+
+  st = 0;
+  ed = shape->nprio;
+  while (st < ed) {
+    off = st + (ed - st) / 2;
+    if (shape->prios[off].priority > priority) {
+      st = off + 1;
+    } else {
+      ed = off;
+    }
+  }
+  return st;
+}
+
+static lagopus_result_t
+exact_priority_add(struct exact *exact, struct exact_shape *shape,
+                   int32_t priority) {
+  struct exact_priority *prios;
+  int i, nalloc;
+
+  i = exact_priority_search(shape, priority);
+  if (i < shape->nprio && shape->prios[i].priority == priority) {
+    shape->prios[i].count++;
+    return LAGOPUS_RESULT_OK;
+  }
+  if (shape->nprio == shape->nprio_alloc) {
+    nalloc = shape->nprio_alloc == 0 ? 4 : shape->nprio_alloc * 2;
+    prios = realloc(shape->prios,
+                    sizeof(struct exact_priority) * (size_t)nalloc);
+    if (prios == NULL) {
+      return LAGOPUS_RESULT_NO_MEMORY;
+    }
+    shape->prios = prios;
+    shape->nprio_alloc = nalloc;
+  }
+  memmove(&shape->prios[i + 1], &shape->prios[i],
+          sizeof(struct exact_priority) * (size_t)(shape->nprio - i));
+  shape->prios[i].priority = priority;
+  shape->prios[i].count = 1;
+  shape->nprio++;
+  if (i == 0) {
+    exact_sort(exact, shape);
+  }
+  return LAGOPUS_RESULT_OK;
+}
+
+static void
+exact_priority_del(struct exact *exact, struct exact_shape *shape,
+                   int32_t priority) {
+  int i;
+
+  i = exact_priority_search(shape, priority);
+  if (i >= shape->nprio || shape->prios[i].priority != priority ||
+      --shape->prios[i].count != 0) {
+    return;
+  }
+  shape->nprio--;
+  memmove(&shape->prios[i], &shape->prios[i + 1],
+          sizeof(struct exact_priority) * (size_t)(shape->nprio - i));
+  if (i == 0) {
+    exact_sort(exact, shape);
+  }
+}
+
+static lagopus_result_t
+exact_entry_add_flow(struct exact_entry *entry, struct flow *flow) {
+  struct flow **flows;
+  int i, st, ed, off;
+
+  flows = realloc(entry->flows, (size_t)(entry->nflow + 1) * sizeof(flow));
+  if (flows == NULL) {
+    return LAGOPUS_RESULT_NO_MEMORY;
+  }
+  entry->flows = flows;
+  st = 0;
+  ed = entry->nflow;
+  while (st < ed) {
+    off = st + (ed - st) / 2;
+    if (entry->flows[off]->priority >= flow->priority) {
+      st = off + 1;
+    } else {
+      ed = off;
+    }
+  }
+  i = ed;
+  if (i < entry->nflow) {
+    memmove(&entry->flows[i + 1], &entry->flows[i],
+            sizeof(struct flow *) * (size_t)(entry->nflow - i));
+  }
+  entry->flows[i] = flow;
+  entry->nflow++;
+  return LAGOPUS_RESULT_OK;
+}
+
+static bool
+exact_entry_del_flow(struct exact_entry *entry, struct flow *flow) {
+  int i;
+
+  for (i = 0; i < entry->nflow; i++) {
+    if (entry->flows[i] == flow) {
+      memmove(&entry->flows[i], &entry->flows[i + 1],
+              sizeof(struct flow *) * (size_t)(entry->nflow - i - 1));
+      entry->nflow--;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void
+exact_entry_free(struct exact_entry *entry) {
+  free(entry->flows);
+  free(entry);
+}
+
+static lagopus_result_t
+add_flow_exact(struct flowinfo *self, struct flow *flow) {
+  struct exact *exact;
+  struct exact_shape *shape;
+  struct exact_entry *entry;
+  uint32_t key[THTABLE_WORDS];
+  uint32_t sig;
+  lagopus_result_t rv;
+
+  exact = EXACT(self);
+  if (exact_flow_is_exact(flow) == false) {
+    rv = exact->wildcard->add_func(exact->wildcard, flow);
+    if (rv == LAGOPUS_RESULT_OK) {
+      self->nflow++;
+    }
+    return rv;
+  }
+
+  flow_make_match(flow);
+
+  shape = exact_shape_get(exact, flow, true);
+  if (shape == NULL) {
+    return LAGOPUS_RESULT_NO_MEMORY;
+  }
+  sig = exact_flow_key(flow, shape, key);
+  entry = exact_entry_lookup(exact, shape, key, sig);
+  if (entry == NULL) {
+    entry = calloc(1, sizeof(struct exact_entry) +
+                   sizeof(uint32_t) * (size_t)shape->nword);
+    if (entry == NULL) {
+      rv = LAGOPUS_RESULT_NO_MEMORY;
+      goto out;
+    }
+    entry->shape = shape;
+    entry->sig = sig;
+    memcpy(entry->key, key, sizeof(uint32_t) * (size_t)shape->nword);
+    rv = exact_entry_insert(exact, entry);
+    if (rv != LAGOPUS_RESULT_OK) {
+      free(entry);
+      goto out;
+    }
+  }
+  rv = exact_entry_add_flow(entry, flow);
+  if (rv == LAGOPUS_RESULT_OK) {
+    rv = exact_priority_add(exact, shape, flow->priority);
+    if (rv != LAGOPUS_RESULT_OK) {
+      (void)exact_entry_del_flow(entry, flow);
+    }
+  }
+  if (rv != LAGOPUS_RESULT_OK) {
+    if (entry->nflow == 0) {
+      exact_entry_remove(exact, entry);
+      exact_entry_free(entry);
+    }
+    goto out;
+  }
+  shape->nflow++;
+  self->nflow++;
+
+out:
+  if (shape->nflow == 0) {
+    exact_shape_del(exact, shape);
+  }
+  return rv;
+}
+
+static lagopus_result_t
+del_flow_exact(struct flowinfo *self, struct flow *flow) {
+  struct exact *exact;
+  struct exact_shape *shape;
+  struct exact_entry *entry;
+  uint32_t key[THTABLE_WORDS];
+  uint32_t sig;
+  lagopus_result_t rv;
+
+  exact = EXACT(self);
+  if (exact_flow_is_exact(flow) == false) {
+    rv = exact->wildcard->del_func(exact->wildcard, flow);
+    if (rv == LAGOPUS_RESULT_OK) {
+      self->nflow--;
+    }
+    return rv;
+  }
+  shape = exact_shape_get(exact, flow, false);
+  if (shape == NULL) {
+    return LAGOPUS_RESULT_NOT_FOUND;
+  }
+  sig = exact_flow_key(flow, shape, key);
+  entry = exact_entry_lookup(exact, shape, key, sig);
+  if (entry == NULL || exact_entry_del_flow(entry, flow) == false) {
+    return LAGOPUS_RESULT_NOT_FOUND;
+  }
+  if (entry->nflow == 0) {
+    exact_entry_remove(exact, entry);
+    exact_entry_free(entry);
+  }
+  exact_priority_del(exact, shape, flow->priority);
+  shape->nflow--;
+  self->nflow--;
+  if (shape->nflow == 0) {
+    exact_shape_del(exact, shape);
+  }
+  return LAGOPUS_RESULT_OK;
+}
+
+/*
+ * exact match flow is counted only if no higher priority flow of the
+ * wildcard classifier matches.
+ */
+static struct flow *
+match_flow_exact(struct flowinfo *self, struct lagopus_packet *pkt,
+                 int32_t *pri) {
+  const struct exact *exact;
+  const struct exact_shape *shape;
+  const struct exact_entry *entry;
+  struct flow *flow, *matched;
+  uint32_t vec[THTABLE_WORDS];
+  uint32_t key[THTABLE_WORDS];
+  bool valid[THTABLE_WORDS];
+  uint32_t hash;
+  int i, j;
+
+  exact = EXACT(self);
+  matched = NULL;
+  if (exact->nshape != 0 &&
+      exact_shape_max_priority(exact->shapes[0]) > *pri) {
+    for (i = 0; i < exact->nslot; i++) {
+      valid[i] = exact->slots[i].refs != 0 &&
+                 thtable_packet_word(pkt, &exact->slots[i].word,
+                                     &vec[i]) == true;
+    }
+    for (i = 0; i < exact->nshape; i++) {
+      shape = exact->shapes[i];
+      if (exact_shape_max_priority(shape) <= *pri) {
+        /* no more higher priority flows. */
+        break;
+      }
+      hash = thtable_hash_add(0, shape->id);
+      for (j = 0; j < shape->nword; j++) {
+        if (valid[shape->words[j].slot] == false) {
+          break;
+        }
+        key[j] = vec[shape->words[j].slot] & shape->words[j].word.mask;
+        hash = thtable_hash_add(hash, key[j]);
+      }
+      if (j < shape->nword) {
+        continue;
+      }
+      entry = exact_entry_lookup(exact, shape, key,
+                                 exact_sig(thtable_hash_finish(hash)));
+      if (entry != NULL && entry->flows[0]->priority > *pri) {
+        matched = entry->flows[0];
+        *pri = matched->priority;
+      }
+    }
+  }
+  if (exact->wildcard->nflow != 0) {
+    flow = exact->wildcard->match_func(exact->wildcard, pkt, pri);
+    if (flow != NULL) {
+      return flow;
+    }
+  }
+  if (matched != NULL &&
+      (matched->flags & (OFPFF_NO_PKT_COUNTS | OFPFF_NO_BYT_COUNTS)) !=
+      (OFPFF_NO_PKT_COUNTS | OFPFF_NO_BYT_COUNTS)) {
+    dp_counter_add(matched->counter_id,
+                   (matched->flags & OFPFF_NO_PKT_COUNTS) == 0 ? 1 : 0,
+                   (matched->flags & OFPFF_NO_BYT_COUNTS) == 0 ?
+                   OS_M_PKTLEN(PKT2MBUF(pkt)) : 0);
+  }
+  return matched;
+}
+
+static struct flow *
+find_flow_exact(struct flowinfo *self, struct flow *flow) {
+  struct exact *exact;
+  struct exact_shape *shape;
+  struct exact_entry *entry;
+  uint32_t key[THTABLE_WORDS];
+  uint32_t sig;
+  int i;
+
+  exact = EXACT(self);
+  if (exact_flow_is_exact(flow) == false) {
+    return exact->wildcard->find_func(exact->wildcard, flow);
+  }
+
+  flow_make_match(flow);
+
+  shape = exact_shape_get(exact, flow, false);
+  if (shape == NULL) {
+    return NULL;
+  }
+  sig = exact_flow_key(flow, shape, key);
+  entry = exact_entry_lookup(exact, shape, key, sig);
+  if (entry == NULL) {
+    return NULL;
+  }
+  for (i = 0; i < entry->nflow; i++) {
+    if (entry->flows[i]->priority == flow->priority &&
+        entry->flows[i]->field_bits == flow->field_bits &&
+        thtable_match_list_equal(entry->flows[i], flow) == true) {
+      return entry->flows[i];
+    }
+  }
+  return NULL;
+}
+
+struct flowinfo *
+new_flowinfo_exact(struct flowinfo *wildcard) {
+  struct flowinfo *self;
+  struct exact *exact;
+
+  if (wildcard == NULL) {
+    return NULL;
+  }
+  self = calloc(1, sizeof(struct flowinfo));
+  exact = calloc(1, sizeof(struct exact));
+  if (self == NULL || exact == NULL) {
+    free(self);
+    free(exact);
+    wildcard->destroy_func(wildcard);
+    return NULL;
+  }
+  exact->wildcard = wildcard;
+  self->userdata = (uint64_t)(uintptr_t)exact;
+  self->add_func = add_flow_exact;
+  self->del_func = del_flow_exact;
+  self->match_func = match_flow_exact;
+  self->find_func = find_flow_exact;
+  self->destroy_func = destroy_flowinfo_exact;
+  return self;
+}
+
+static void
+destroy_flowinfo_exact(struct flowinfo *self) {
+  struct exact *exact;
+  uint32_t i;
+  int way, j;
+
+  exact = EXACT(self);
+  for (i = 0; i < exact->size; i++) {
+    for (way = 0; way < EXACT_WAYS; way++) {
+      if (exact->buckets[i].sig[way] != 0) {
+        exact_entry_free(exact->buckets[i].entry[way]);
+      }
+    }
+  }
+  for (j = 0; j < exact->nshape; j++) {
+    free(exact->shapes[j]->prios);
+    free(exact->shapes[j]);
+  }
+  exact->wildcard->destroy_func(exact->wildcard);
+  free(exact->buckets);
+  free(exact->shapes);
+  free(exact);
+  free(self);
+}
@@ -33,23 +33,35 @@ flowinfo_init(void) {
   lagopus_find_flow_hook = find_flow;
 }
 
+/*
+ * hooks update the writer's copy of the classifier (table->shadow).
+ * flowdb publishes it to forwarding threads.
+ */
 static void
 add_flow(struct flow *flow, struct table *table) {
   struct flowinfo *flowinfo;
 
-  if (table->userdata == NULL) {
-    if (table->table_id == 0) {
+  if (table->shadow == NULL) {
+    if (table->classifier == TABLE_CLASSIFIER_THTABLE) {
+      table->shadow = new_flowinfo_thtable();
+    } else if (table->classifier == TABLE_CLASSIFIER_MBTREE) {
+      table->shadow = new_flowinfo_mbtree();
+    } else if (table->classifier == TABLE_CLASSIFIER_EXACT) {
+      table->shadow = new_flowinfo_exact(table->table_id == 0 ?
+                                         new_flowinfo_vlan_vid() :
+                                         new_flowinfo_metadata_mask());
+    } else if (table->table_id == 0) {
       /* at first, match by ETH_TYPE for table 0 */
-      table->userdata = new_flowinfo_vlan_vid();
+      table->shadow = new_flowinfo_vlan_vid();
     } else {
       /* at first, match by metadata for other table */
-      table->userdata = new_flowinfo_metadata_mask();
+      table->shadow = new_flowinfo_metadata_mask();
     }
-    if (table->userdata == NULL) {
+    if (table->shadow == NULL) {
       return;
     }
   }
-  flowinfo = table->userdata;
+  flowinfo = table->shadow;
   flowinfo->add_func(flowinfo, flow);
 }
 
@@ -57,11 +69,11 @@ static void
 del_flow(struct flow *flow, struct table *table) {
   struct flowinfo *flowinfo;
 
-  if (table->userdata == NULL) {
+  if (table->shadow == NULL) {
     /* flows are not exist, nothing to do. */
     return;
   }
-  flowinfo = table->userdata;
+  flowinfo = table->shadow;
   flowinfo->del_func(flowinfo, flow);
 }
 
@@ -69,10 +81,10 @@ static struct flow *
 find_flow(struct flow *flow, struct table *table) {
   struct flowinfo *flowinfo;
 
-  if (table->userdata == NULL) {
+  if (table->shadow == NULL) {
     /* flows are not exist, nothing to do. */
     return NULL;
   }
-  flowinfo = table->userdata;
+  flowinfo = table->shadow;
   return flowinfo->find_func(flowinfo, flow);
 }
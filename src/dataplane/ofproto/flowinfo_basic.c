@@ -52,6 +52,7 @@
 #include "lagopus/dataplane.h"
 #include "pktbuf.h"
 #include "packet.h"
+#include "counter.h"
 
 #include "lagopus/flowinfo.h"
 
@@ -130,11 +131,12 @@ match_basic(const struct lagopus_packet *pkt, struct flow *flow) {
   }
   DPRINT("byteoff matched\n");
 
-  if ((flow->flags & OFPFF_NO_PKT_COUNTS) == 0) {
-    flow->packet_count++;
-  }
-  if ((flow->flags & OFPFF_NO_BYT_COUNTS) == 0) {
-    flow->byte_count += OS_M_PKTLEN(PKT2MBUF(pkt));
+  if ((flow->flags & (OFPFF_NO_PKT_COUNTS | OFPFF_NO_BYT_COUNTS)) !=
+      (OFPFF_NO_PKT_COUNTS | OFPFF_NO_BYT_COUNTS)) {
+    dp_counter_add(flow->counter_id,
+                   (flow->flags & OFPFF_NO_PKT_COUNTS) == 0 ? 1 : 0,
+                   (flow->flags & OFPFF_NO_BYT_COUNTS) == 0 ?
+                   OS_M_PKTLEN(PKT2MBUF(pkt)) : 0);
   }
 
   return true;
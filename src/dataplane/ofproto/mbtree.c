@@ -88,7 +88,7 @@ static const struct match_idx match_idx[] = {
   { OOB_BASE, 0, 0, 0, 0 },     /* 7 VLAN_PCP */
   { L3_BASE, 0, 0, 0, 0 },      /* 8 IP_DSCP */
   { L3_BASE, 0, 0, 0, 0 },      /* 9 IP_ECN */
-  MAKE_MATCH_IDX(IPPROTO_BASE, ip, ip_p, UINT8_MAX, 0), /* 10 IP_PROTO */
+  { IPPROTO_BASE, 0, 1, UINT8_MAX, 0 },  /* 10 IP_PROTO */
   MAKE_MATCH_IDX(L3_BASE, ip, ip_src, UINT32_MAX, 0),    /* 11 IPV4_SRC */
   MAKE_MATCH_IDX(L3_BASE, ip, ip_dst, UINT32_MAX, 0),    /* 12 IPV4_DST */
   MAKE_MATCH_IDX(L4_BASE, tcphdr, th_sport, UINT16_MAX, 0),      /* 13 TCP_SRC */
@@ -125,10 +125,24 @@ static const struct match_idx match_idx[] = {
   MAKE_MATCH_IDX(OOB2_BASE, oob2_data, ipv6_exthdr, UINT16_MAX, 0) /* 39 IPV6_EXTHDR */
 };
 
+/* max number of flows of sequencial search node. */
+#define MBTREE_MIN_FLOWS 4
+
+/* flow_list->rebuild */
+#define MBTREE_REBUILD  0x01    /* the subtree is unbalanced. */
+#define MBTREE_PENDING  0x02    /* some descendant is unbalanced. */
+
+union mbtree_key {
+  uint8_t bytes[sizeof(uint64_t)];
+  void *ptr;
+};
+
 static void
 build_mbtree_child(struct flow_list *flow_list, void *arg);
 static struct flow *
 find_mbtree_child(struct lagopus_packet *pkt, struct flow_list *flows);
+static void
+free_mbtree_child(void *arg);
 
 static struct match *
 get_match_eth_type(struct match_list *match_list, uint16_t *eth_type) {
@@ -143,6 +157,27 @@ get_match_eth_type(struct match_list *match_list, uint16_t *eth_type) {
   return match;
 }
 
+/*
+ * Masked fields can not be a branch, hashmap key is whole field of
+ * the packet.
+ */
+static inline bool
+is_branch_field(const struct match *match) {
+  unsigned int idx;
+
+  idx = OXM_FIELD_TYPE(match->oxm_field);
+  return (OXM_FIELD_HAS_MASK(match->oxm_field) == false &&
+          idx != OFPXMT_OFB_ETH_TYPE &&
+          idx < sizeof(match_idx) / sizeof(match_idx[0]) &&
+          match_idx[idx].size != 0 &&
+          match_idx[idx].size <= (int)sizeof(uint64_t));
+}
+
+static inline struct flow_list *
+alloc_mbtree_child(void) {
+  return calloc(1, sizeof(struct flow_list) + sizeof(void *));
+}
+
 struct match_stats {
   struct match match;
   uint8_t valmask[32];
@@ -214,7 +249,7 @@ count_flow_list_match(struct flow_list *flow_list,
   for (i = 0; i < flow_list->nflow; i++) {
     flow = flow_list->flows[i];
     TAILQ_FOREACH(match, &flow->match_list, entry) {
-      if (OXM_FIELD_TYPE(match->oxm_field) == OFPXMT_OFB_ETH_TYPE) {
+      if (is_branch_field(match) == false) {
         continue;
       }
       count_match(match, match_stats_list);
@@ -228,11 +263,11 @@ count_flow_list_match(struct flow_list *flow_list,
 }
 
 static int
-match_cmp(void *a, void *b) {
-  struct match_stats *ma, *mb;
+match_cmp(const void *a, const void *b) {
+  const struct match_stats *ma, *mb;
 
-  ma = *(struct match_stats **)a;
-  mb = *(struct match_stats **)b;
+  ma = *(struct match_stats * const *)a;
+  mb = *(struct match_stats * const *)b;
 
   return mb->count - ma->count;
 }
@@ -241,35 +276,44 @@ static struct match_stats **
 get_match_stats_array(struct flow_list *flow_list) {
   struct match_list match_stats_list;
   struct match_stats **match_array;
+  struct match *match;
   int nmatch, i;
 
   TAILQ_INIT(&match_stats_list);
   nmatch = count_flow_list_match(flow_list, &match_stats_list);
-  match_array = calloc(nmatch + 1, sizeof(struct match_stats *));
+  match_array = calloc((size_t)nmatch + 1, sizeof(struct match_stats *));
+  if (match_array == NULL) {
+    while ((match = TAILQ_FIRST(&match_stats_list)) != NULL) {
+      TAILQ_REMOVE(&match_stats_list, match, entry);
+      free(match);
+    }
+    return NULL;
+  }
   for (i = 0; i < nmatch; i++) {
-    match_array[i] = TAILQ_FIRST(&match_stats_list);
+    match_array[i] = (struct match_stats *)TAILQ_FIRST(&match_stats_list);
     TAILQ_REMOVE(&match_stats_list, TAILQ_FIRST(&match_stats_list), entry);
   }
-  qsort(match_array, nmatch, sizeof(struct match_stats *), match_cmp);
+  qsort(match_array, (size_t)nmatch, sizeof(struct match_stats *), match_cmp);
   return match_array;
 }
 
+static void
+free_match_stats_array(struct match_stats **match_array) {
+  int i;
+
+  for (i = 0; match_array[i] != NULL; i++) {
+    free(match_array[i]);
+  }
+  free(match_array);
+}
+
 static struct match *
-get_match_field(struct match_list *match_list, struct match *match_stats) {
+get_match_field(struct match_list *match_list, uint8_t oxm_field) {
   struct match *match;
 
   TAILQ_FOREACH(match, match_list, entry) {
-    if (match->oxm_field == match_stats->oxm_field) {
-      if ((match->oxm_field & 1) == 0) {
-        /* field match.  match has no mask. */
-        break;
-      }
-      if (!memcmp(&match->oxm_value[match->oxm_length >> 1],
-                  &match_stats->oxm_value[match->oxm_length >> 1],
-                  match->oxm_length >> 1)) {
-        /* field and mask match. */
-        break;
-      }
+    if (match->oxm_field == oxm_field) {
+      break;
     }
   }
   return match;
@@ -306,38 +350,57 @@ get_shifted_value(uint8_t origin[],
   }
 }
 
-static void *
+static inline void *
+get_match_key(struct flow_list *flow_list, struct match *match) {
+  union mbtree_key key;
+
+  memset(&key, 0, sizeof(key));
+  get_shifted_value(match->oxm_value,
+                    OXM_MATCH_VALUE_LEN(match),
+                    flow_list->shift, flow_list->keylen, key.bytes);
+  return key.ptr;
+}
+
+static struct flow_list *
 get_child_flow_list(struct flow_list *flow_list,
                     struct match *match,
-                    struct match_stats *most_match,
-                    void *child_array[]) {
-  uint8_t key[sizeof(uint64_t)];
-  void *child;
+                    bool create) {
+  lagopus_hashmap_t *hashmap;
+  void *key, *child;
   lagopus_result_t rv;
-  int i;
 
-  get_shifted_value(match->oxm_value,
-                    OXM_MATCH_VALUE_LEN(match),
-                    flow_list->shift, flow_list->keylen, key);
-  DPRINTF("oxm_value:");
-  for (i = 0; i < flow_list->keylen; i++) {
-    DPRINTF(" %d", match->oxm_value[i]);
-  }
-  DPRINTF(" keylen %d, key %d\n", flow_list->keylen, *(void **)key);
+  key = get_match_key(flow_list, match);
+  DPRINTF(" keylen %d, key %p\n", flow_list->keylen, key);
   switch (flow_list->type) {
     case HASHMAP:
-      if (child_array[0] == NULL) {
-        child_array[0] = calloc(1, sizeof(lagopus_hashmap_t));
-        lagopus_hashmap_create((void *)&child_array[0],
-                               LAGOPUS_HASHMAP_TYPE_ONE_WORD, cleanup_mbtree);
+      hashmap = (lagopus_hashmap_t *)&flow_list->branch[0];
+      if (*hashmap == NULL) {
+        if (create == false) {
+          return NULL;
+        }
+        rv = lagopus_hashmap_create(hashmap, LAGOPUS_HASHMAP_TYPE_ONE_WORD,
+                                    free_mbtree_child);
+        if (rv != LAGOPUS_RESULT_OK) {
+          return NULL;
+        }
       }
-      rv = lagopus_hashmap_find_no_lock((void *)&child_array[0], *(void **)key, &child);
+      rv = lagopus_hashmap_find_no_lock(hashmap, key, &child);
       if (rv != LAGOPUS_RESULT_OK) {
         void *val;
 
-        child = calloc(1, sizeof(struct flow_list) + sizeof(void *));
+        if (create == false) {
+          return NULL;
+        }
+        child = alloc_mbtree_child();
+        if (child == NULL) {
+          return NULL;
+        }
         val = child;
-        lagopus_hashmap_add_no_lock((void *)&child_array[0], *(void **)key, &val, false);
+        rv = lagopus_hashmap_add_no_lock(hashmap, key, &val, false);
+        if (rv != LAGOPUS_RESULT_OK) {
+          free(child);
+          return NULL;
+        }
       }
       break;
 
@@ -354,6 +417,7 @@ set_flow_list_desc(struct flow_list *flow_list,
   int idx;
 
   flow_list->type = HASHMAP;
+  flow_list->oxm_field = match_stats->match.oxm_field;
   idx = OXM_FIELD_TYPE(match_stats->match.oxm_field);
   flow_list->base = match_idx[idx].base;
   flow_list->match_off = match_idx[idx].off;
@@ -362,57 +426,58 @@ set_flow_list_desc(struct flow_list *flow_list,
   get_mask(match_idx[idx].mask, match_idx[idx].size, flow_list->mask);
 }
 
-static void
-distribute_match_flow(struct flow *flow,
-                      struct match *match,
-                      struct match_stats *match_stats,
-                      struct flow_list *flow_list) {
-  struct flow_list *child;
-
-  /* lookup child flow_list */
-  child = get_child_flow_list(flow_list,
-                              match,
-                              match_stats,
-                              (void **)flow_list->branch);
-  if (child != NULL) {
-    /* add flow to flow_list array */
-    flow_add_sub(flow, child);
-  }
-}
-
 static void
 distribute_flow_to_child(struct flow *flow,
-                         struct match_stats *match_stats,
                          struct flow_list *flow_list) {
+  struct flow_list *child;
   struct match *match;
 
-  match = get_match_field(&flow->match_list, &match_stats->match);
+  match = get_match_field(&flow->match_list, flow_list->oxm_field);
   if (match != NULL) {
-    distribute_match_flow(flow, match, match_stats, flow_list);
+    /* lookup child flow_list */
+    child = get_child_flow_list(flow_list, match, true);
+    if (child != NULL) {
+      /* add flow to flow_list array */
+      flow_add_sub(flow, child);
+    }
   } else {
     /* not found. don't care case */
     flow_add_sub(flow, flow_list->flows_dontcare);
   }
 }
 
+/*
+ * byte offset match of the flows are already made when the flows
+ * are added to the tree, the flows are simply copied.
+ */
 static void
 build_mbtree_sequencial(struct flow_list *flow_list) {
-  struct flow *flow;
-  int i;
+  struct flowinfo *basic;
+  struct flow **flows;
 
   flow_list->type = SEQUENCIAL;
-  if (flow_list->basic == NULL) {
-    flow_list->basic = new_flowinfo_basic();
+  basic = new_flowinfo_basic();
+  if (basic == NULL) {
+    return;
   }
-  for (i = 0; i < flow_list->nflow; i++) {
-    flow = flow_list->flows[i];
-    flow_list->basic->add_func(flow_list->basic, flow);
+  if (flow_list->nflow > 0) {
+    flows = realloc(basic->flows,
+                    sizeof(struct flow *) * (size_t)flow_list->nflow);
+    if (flows == NULL) {
+      basic->destroy_func(basic);
+      return;
+    }
+    memcpy(flows, flow_list->flows,
+           sizeof(struct flow *) * (size_t)flow_list->nflow);
+    basic->flows = flows;
+    basic->nflow = flow_list->nflow;
   }
+  flow_list->basic = basic;
 }
 
 static bool
 mbtree_do_build_iterate(void *key, void *val,
-                       lagopus_hashentry_t he, void *arg) {
+                        lagopus_hashentry_t he, void *arg) {
   struct flow_list *flow_list;
   const struct match_stats **match_array;
 
@@ -431,17 +496,18 @@ mbtree_do_build_iterate(void *key, void *val,
 static void
 build_mbtree_child(struct flow_list *flow_list,
                    void *arg) {
-  const int min_count = 4;
-  const struct match_stats *most_match;
-  const struct match_stats **match_array;
+  struct match_stats *most_match;
+  struct match_stats **match_array;
   int i;
 
   if (flow_list == NULL) {
     return;
   }
 
+  flow_list->nflow_built = flow_list->nflow;
+  flow_list->rebuild = 0;
   match_array = arg;
-  if (flow_list->nflow <= min_count || *match_array == NULL) {
+  if (flow_list->nflow <= MBTREE_MIN_FLOWS || *match_array == NULL) {
     build_mbtree_sequencial(flow_list);
     return;
   }
@@ -450,8 +516,11 @@ build_mbtree_child(struct flow_list *flow_list,
 
   /* distribute flow entries */
   if (flow_list->flows_dontcare == NULL) {
-    flow_list->flows_dontcare = calloc(1, sizeof(struct flow_list)
-                                       + sizeof(void *));
+    flow_list->flows_dontcare = alloc_mbtree_child();
+    if (flow_list->flows_dontcare == NULL) {
+      build_mbtree_sequencial(flow_list);
+      return;
+    }
   }
 
   /* set flow_list type and related values */
@@ -459,24 +528,21 @@ build_mbtree_child(struct flow_list *flow_list,
 
   DPRINTF("most_match: oxm_field %d\n", most_match->match.oxm_field);
   DPRINTF("most_match: oxm_length %d\n", most_match->match.oxm_length);
-  DPRINTF("most_match: min_value %llu\n", most_match->min_value);
-  DPRINTF("most_match: max_value %llu\n", most_match->max_value);
-  DPRINTF("most_match: shift %d\n", most_match->shift);
   DPRINTF("most_match: count %d\n", most_match->count);
   DPRINTF("flow_list: nflow %d\n", flow_list->nflow);
-  DPRINTF("flow_list: shift %d\n", flow_list->shift);
-  DPRINTF("flow_list: match_off %d\n", flow_list->match_off);
   DPRINTF("flow_list: keylen %d\n", flow_list->keylen);
 
   for (i = 0; i < flow_list->nflow; i++) {
-    distribute_flow_to_child(flow_list->flows[i], most_match, flow_list);
+    distribute_flow_to_child(flow_list->flows[i], flow_list);
   }
   DPRINTF("dontcare: nflow %d\n", flow_list->flows_dontcare->nflow);
   /* build child flow list */
   switch (flow_list->type) {
     case HASHMAP:
-      lagopus_hashmap_iterate(&flow_list->branch[0],
-                              mbtree_do_build_iterate, match_array);
+      if (flow_list->branch[0] != NULL) {
+        lagopus_hashmap_iterate((lagopus_hashmap_t *)&flow_list->branch[0],
+                                mbtree_do_build_iterate, match_array);
+      }
       break;
     default:
       break;
@@ -485,7 +551,7 @@ build_mbtree_child(struct flow_list *flow_list,
     DPRINTF("build_mbtree_child dontcare\n");
     build_mbtree_child(flow_list->flows_dontcare, match_array);
   } else {
-    free(flow_list->flows_dontcare);
+    free_mbtree_child(flow_list->flows_dontcare);
     flow_list->flows_dontcare = NULL;
   }
 }
@@ -561,93 +627,418 @@ dump_mbtree(struct flow_list *flows) {
 }
 #endif
 
+/*
+ * top level of the tree is branched by ether type.
+ */
+static struct flow_list **
+get_root_child(struct flow_list *flows, struct flow *flow) {
+  struct match *match;
+  uint16_t eth_type;
+
+  match = get_match_eth_type(&flow->match_list, &eth_type);
+  if (match != NULL) {
+    match->except_flag = true;
+    return (struct flow_list **)&flows->branch[ntohs(eth_type)];
+  }
+  return &flows->flows_dontcare;
+}
+
 void
 build_mbtree(struct flow_list *flows) {
   struct flow_list **childp;
   struct flow *flow;
-  struct match *match;
   struct match_stats **match_array;
-  uint16_t eth_type;
   int i;
 
   /* store flow into child flow_list. */
   for (i = 0; i < flows->nflow; i++) {
     flow = flows->flows[i];
-    match = get_match_eth_type(&flow->match_list, &eth_type);
-    if (match != NULL) {
-      match->except_flag = true;
-      childp = &flows->branch[ntohs(eth_type)];
-    } else {
-      childp = &flows->flows_dontcare;
-    }
+    childp = get_root_child(flows, flow);
     if (*childp == NULL) {
-      *childp = calloc(1, sizeof(struct flow_list)
-                       + sizeof(void *) * 65536);
-      (*childp)->nbranch = 65536;
+      *childp = alloc_mbtree_child();
+      if (*childp == NULL) {
+        continue;
+      }
     }
+    flow_make_match(flow);
     flow_add_sub(flow, *childp);
   }
   /* process for each child flow_list. */
   for (i = 0; i < flows->nbranch; i++) {
     if (flows->branch[i] != NULL) {
       match_array = get_match_stats_array(flows->branch[i]);
-      build_mbtree_child(flows->branch[i], match_array);
-      free(match_array);
+      if (match_array != NULL) {
+        build_mbtree_child(flows->branch[i], match_array);
+        free_match_stats_array(match_array);
+      }
     }
   }
   if (flows->flows_dontcare != NULL) {
     match_array = get_match_stats_array(flows->flows_dontcare);
-    build_mbtree_child(flows->flows_dontcare, match_array);
-    free(match_array);
+    if (match_array != NULL) {
+      build_mbtree_child(flows->flows_dontcare, match_array);
+      free_match_stats_array(match_array);
+    }
   }
+  flows->rebuild = 0;
 #if 0
   dump_mbtree(flows);
 #endif
 }
 
 static void
-free_mbtree(int type, void *arg) {
+free_mbtree_child(void *arg) {
   struct flow_list *flow_list;
-  int i;
 
-  if (arg != NULL) {
-    switch (type) {
-      case HASHMAP:
-        lagopus_hashmap_destroy(arg, true);
-        break;
-
-      case SEQUENCIAL:
-        flow_list = arg;
-        if (flow_list->basic != NULL) {
-          flow_list->basic->destroy_func(flow_list->basic);
-        }
-        free(flow_list);
-        break;
-    }
+  flow_list = arg;
+  if (flow_list == NULL) {
+    return;
+  }
+  if (flow_list->type == HASHMAP && flow_list->branch[0] != NULL) {
+    lagopus_hashmap_destroy((lagopus_hashmap_t *)&flow_list->branch[0], true);
   }
+  if (flow_list->basic != NULL) {
+    flow_list->basic->destroy_func(flow_list->basic);
+  }
+  free_mbtree_child(flow_list->flows_dontcare);
+  free(flow_list->flows);
+  free(flow_list);
 }
 
 void
 cleanup_mbtree(struct flow_list *flows) {
-  int i, type;
+  int i;
 
-  if (flows->update_timer != NULL) {
-    *flows->update_timer = NULL;
-  }
-  type = flows->type;
   flows->type = SEQUENCIAL;
+  flows->rebuild = 0;
   for (i = 0; i < flows->nbranch; i++) {
     if (flows->branch[i] != NULL) {
-      free_mbtree(type, flows->branch[i]);
+      free_mbtree_child(flows->branch[i]);
       flows->branch[i] = NULL;
     }
   }
   if (flows->flows_dontcare != NULL) {
-    cleanup_mbtree(flows->flows_dontcare);
+    free_mbtree_child(flows->flows_dontcare);
     flows->flows_dontcare = NULL;
   }
 }
 
+/*
+ * subtree is rebuilt if number of flows is doubled or halved since
+ * it was built.
+ */
+static inline void
+check_mbtree_balance(struct flow_list *flow_list) {
+  if (flow_list->nflow > flow_list->nflow_built * 2 + MBTREE_MIN_FLOWS ||
+      (flow_list->nflow_built > MBTREE_MIN_FLOWS &&
+       flow_list->nflow < flow_list->nflow_built / 2)) {
+    flow_list->rebuild |= MBTREE_REBUILD;
+  }
+}
+
+/*
+ * flows are sorted by priority, search from the first flow of the
+ * same priority.
+ */
+static void
+del_flow_sub(struct flow *flow, struct flow_list *flow_list) {
+  int i, st, ed, off;
+
+  st = 0;
+  ed = flow_list->nflow;
+  while (st < ed) {
+    off = st + (ed - st) / 2;
+    if (flow_list->flows[off]->priority > flow->priority) {
+      st = off + 1;
+    } else {
+      ed = off;
+    }
+  }
+  for (i = st; i < flow_list->nflow; i++) {
+    if (flow_list->flows[i]->priority != flow->priority) {
+      break;
+    }
+    if (flow_list->flows[i] == flow) {
+      flow_list->nflow--;
+      memmove(&flow_list->flows[i], &flow_list->flows[i + 1],
+              sizeof(struct flow *) * (size_t)(flow_list->nflow - i));
+      break;
+    }
+  }
+}
+
+/*
+ * add and delete modify only nodes on the path to the flow.
+ * the caller excludes forwarding threads.
+ */
+static void
+add_mbtree_child(struct flow_list *flow_list, struct flow *flow) {
+  struct flow_list *child;
+  struct match *match;
+
+  flow_add_sub(flow, flow_list);
+  check_mbtree_balance(flow_list);
+  if (flow_list->type == HASHMAP) {
+    match = get_match_field(&flow->match_list, flow_list->oxm_field);
+    if (match != NULL) {
+      child = get_child_flow_list(flow_list, match, true);
+    } else {
+      if (flow_list->flows_dontcare == NULL) {
+        flow_list->flows_dontcare = alloc_mbtree_child();
+      }
+      child = flow_list->flows_dontcare;
+    }
+    if (child == NULL) {
+      /* lost the flow, it will be recovered by rebuild. */
+      flow_list->rebuild |= MBTREE_REBUILD;
+      return;
+    }
+    add_mbtree_child(child, flow);
+    if (child->rebuild != 0) {
+      flow_list->rebuild |= MBTREE_PENDING;
+    }
+  } else {
+    if (flow_list->basic == NULL) {
+      flow_list->basic = new_flowinfo_basic();
+    }
+    if (flow_list->basic == NULL ||
+        flow_list->basic->add_func(flow_list->basic,
+                                   flow) != LAGOPUS_RESULT_OK) {
+      flow_list->rebuild |= MBTREE_REBUILD;
+    }
+  }
+}
+
+static void
+del_mbtree_child(struct flow_list *flow_list, struct flow *flow) {
+  lagopus_hashmap_t *hashmap;
+  struct flow_list *child;
+  struct match *match;
+  void *key;
+
+  del_flow_sub(flow, flow_list);
+  check_mbtree_balance(flow_list);
+  if (flow_list->type == HASHMAP) {
+    hashmap = (lagopus_hashmap_t *)&flow_list->branch[0];
+    match = get_match_field(&flow->match_list, flow_list->oxm_field);
+    if (match != NULL) {
+      key = get_match_key(flow_list, match);
+      if (*hashmap == NULL ||
+          lagopus_hashmap_find_no_lock(hashmap, key,
+                                       (void **)&child) != LAGOPUS_RESULT_OK) {
+        return;
+      }
+      del_mbtree_child(child, flow);
+      if (child->nflow == 0) {
+        (void)lagopus_hashmap_delete_no_lock(hashmap, key, NULL, true);
+      } else if (child->rebuild != 0) {
+        flow_list->rebuild |= MBTREE_PENDING;
+      }
+    } else if (flow_list->flows_dontcare != NULL) {
+      child = flow_list->flows_dontcare;
+      del_mbtree_child(child, flow);
+      if (child->nflow == 0) {
+        flow_list->flows_dontcare = NULL;
+        free_mbtree_child(child);
+      } else if (child->rebuild != 0) {
+        flow_list->rebuild |= MBTREE_PENDING;
+      }
+    }
+  } else if (flow_list->basic != NULL) {
+    flow_list->basic->del_func(flow_list->basic, flow);
+  }
+}
+
+bool
+add_mbtree(struct flow_list *flows, struct flow *flow) {
+  struct flow_list **childp;
+
+  childp = get_root_child(flows, flow);
+  if (*childp == NULL) {
+    *childp = alloc_mbtree_child();
+    if (*childp == NULL) {
+      return false;
+    }
+  }
+  add_mbtree_child(*childp, flow);
+  if ((*childp)->rebuild != 0) {
+    flows->rebuild |= MBTREE_PENDING;
+  }
+  return (flows->rebuild != 0);
+}
+
+bool
+del_mbtree(struct flow_list *flows, struct flow *flow) {
+  struct flow_list **childp, *child;
+
+  childp = get_root_child(flows, flow);
+  if (*childp != NULL) {
+    child = *childp;
+    del_mbtree_child(child, flow);
+    if (child->nflow == 0) {
+      *childp = NULL;
+      free_mbtree_child(child);
+    } else if (child->rebuild != 0) {
+      flows->rebuild |= MBTREE_PENDING;
+    }
+  }
+  return (flows->rebuild != 0);
+}
+
+/*
+ * build new subtree from the flows of the node.
+ * the node is not modified.
+ */
+static struct flow_list *
+rebuild_mbtree_node(struct flow_list *flow_list) {
+  struct flow_list *new_list;
+  struct match_stats **match_array;
+
+  new_list = alloc_mbtree_child();
+  if (new_list == NULL) {
+    return NULL;
+  }
+  if (flow_list->nflow > 0) {
+    new_list->flows = malloc(sizeof(struct flow *) *
+                             (size_t)flow_list->nflow);
+    if (new_list->flows == NULL) {
+      free(new_list);
+      return NULL;
+    }
+    memcpy(new_list->flows, flow_list->flows,
+           sizeof(struct flow *) * (size_t)flow_list->nflow);
+    new_list->nflow = flow_list->nflow;
+    new_list->alloced = flow_list->nflow;
+  }
+  match_array = get_match_stats_array(new_list);
+  if (match_array == NULL) {
+    free_mbtree_child(new_list);
+    return NULL;
+  }
+  build_mbtree_child(new_list, match_array);
+  free_match_stats_array(match_array);
+  return new_list;
+}
+
+static struct flow_list *
+rebuild_mbtree_child(struct flow_list *flow_list,
+                     struct flow_list **garbage);
+
+struct rebuild_arg {
+  struct flow_list *parent;
+  struct flow_list **garbage;
+};
+
+static bool
+mbtree_do_rebuild_iterate(void *key, void *val,
+                          lagopus_hashentry_t he, void *arg) {
+  struct rebuild_arg *rebuild_arg;
+  struct flow_list *flow_list, *new_list;
+
+  (void) key;
+  rebuild_arg = arg;
+  flow_list = val;
+  if (flow_list->rebuild != 0) {
+    new_list = rebuild_mbtree_child(flow_list, rebuild_arg->garbage);
+    if (new_list != flow_list) {
+      mbar();
+      (void)lagopus_hashmap_set_value(he, new_list);
+    }
+    if (new_list->rebuild != 0) {
+      rebuild_arg->parent->rebuild |= MBTREE_PENDING;
+    }
+  }
+  return true;
+}
+
+/*
+ * replace unbalanced subtrees by new ones.  new subtree is built
+ * aside and published by a pointer store, forwarding threads see
+ * either old or new one.  replaced subtrees are chained to garbage.
+ */
+static struct flow_list *
+rebuild_mbtree_child(struct flow_list *flow_list,
+                     struct flow_list **garbage) {
+  struct rebuild_arg rebuild_arg;
+  struct flow_list *new_list;
+
+  if ((flow_list->rebuild & MBTREE_REBUILD) != 0) {
+    new_list = rebuild_mbtree_node(flow_list);
+    if (new_list == NULL) {
+      /* retry at next time. */
+      return flow_list;
+    }
+    flow_list->next = *garbage;
+    *garbage = flow_list;
+    return new_list;
+  }
+  flow_list->rebuild = 0;
+  if (flow_list->type == HASHMAP && flow_list->branch[0] != NULL) {
+    rebuild_arg.parent = flow_list;
+    rebuild_arg.garbage = garbage;
+    lagopus_hashmap_iterate((lagopus_hashmap_t *)&flow_list->branch[0],
+                            mbtree_do_rebuild_iterate, &rebuild_arg);
+  }
+  if (flow_list->flows_dontcare != NULL &&
+      flow_list->flows_dontcare->rebuild != 0) {
+    new_list = rebuild_mbtree_child(flow_list->flows_dontcare, garbage);
+    if (new_list != flow_list->flows_dontcare) {
+      mbar();
+      flow_list->flows_dontcare = new_list;
+    }
+    if (new_list->rebuild != 0) {
+      flow_list->rebuild |= MBTREE_PENDING;
+    }
+  }
+  return flow_list;
+}
+
+void
+rebuild_mbtree(struct flow_list *flows, struct flow_list **garbage) {
+  struct flow_list *flow_list, *new_list;
+  int i;
+
+  if (flows->rebuild == 0) {
+    return;
+  }
+  flows->rebuild = 0;
+  for (i = 0; i < flows->nbranch; i++) {
+    flow_list = flows->branch[i];
+    if (flow_list != NULL && flow_list->rebuild != 0) {
+      new_list = rebuild_mbtree_child(flow_list, garbage);
+      if (new_list != flow_list) {
+        mbar();
+        flows->branch[i] = new_list;
+      }
+      if (new_list->rebuild != 0) {
+        flows->rebuild |= MBTREE_PENDING;
+      }
+    }
+  }
+  flow_list = flows->flows_dontcare;
+  if (flow_list != NULL && flow_list->rebuild != 0) {
+    new_list = rebuild_mbtree_child(flow_list, garbage);
+    if (new_list != flow_list) {
+      mbar();
+      flows->flows_dontcare = new_list;
+    }
+    if (new_list->rebuild != 0) {
+      flows->rebuild |= MBTREE_PENDING;
+    }
+  }
+}
+
+void
+free_mbtree(struct flow_list *garbage) {
+  struct flow_list *next;
+
+  while (garbage != NULL) {
+    next = garbage->next;
+    free_mbtree_child(garbage);
+    garbage = next;
+  }
+}
+
 struct flow *
 find_mbtree(struct lagopus_packet *pkt, struct flow_list *flows) {
   struct flow *flow, *alt_flow;
@@ -675,30 +1066,36 @@ find_mbtree(struct lagopus_packet *pkt, struct flow_list *flows) {
   return flow;
 }
 
+/*
+ * flows without the branch field are in dontcare of each level.
+ */
 static struct flow *
 find_mbtree_child(struct lagopus_packet *pkt, struct flow_list *flows) {
   struct flow *flow;
+  struct flow_list *child;
   uint8_t *src;
   lagopus_result_t rv;
 
   if (flows == NULL) {
     return NULL;
   }
-  while (flows->type == HASHMAP) {
-    uint8_t key[sizeof(uint64_t)];
+  if (flows->type == HASHMAP) {
+    union mbtree_key key;
     int i;
 
+    key.ptr = NULL;
     src = pkt->base[flows->base] + flows->match_off;
     for (i = 0; i < flows->keylen; i++) {
-      key[i] = src[i] & flows->mask[i];
+      key.bytes[i] = src[i] & flows->mask[i];
     }
-    rv = lagopus_hashmap_find_no_lock(&flows->branch[0],
-                                      *(void **)key, &flows);
-    if (rv != LAGOPUS_RESULT_OK) {
-      return NULL;
+    rv = lagopus_hashmap_find_no_lock((lagopus_hashmap_t *)&flows->branch[0],
+                                      key.ptr, (void **)&child);
+    if (rv == LAGOPUS_RESULT_OK) {
+      flow = find_mbtree_child(pkt, child);
+    } else {
+      flow = NULL;
     }
-  }
-  if (flows->basic != NULL) {
+  } else if (flows->basic != NULL) {
     int32_t pri = -1;
 
     flow = flows->basic->match_func(flows->basic, pkt, &pri);
@@ -718,3 +1115,177 @@ find_mbtree_child(struct lagopus_packet *pkt, struct flow_list *flows) {
   }
   return flow;
 }
+
+/*
+ * flowinfo of the decision tree.  the tree is modified while it is
+ * not published, then unbalanced subtrees are rebuilt at once.
+ */
+#define MBTREE(self) ((struct flow_list *)(uintptr_t)(self)->userdata)
+
+static lagopus_result_t
+add_flow_mbtree(struct flowinfo *, struct flow *);
+static lagopus_result_t
+del_flow_mbtree(struct flowinfo *, struct flow *);
+static struct flow *
+match_flow_mbtree(struct flowinfo *, struct lagopus_packet *, int32_t *);
+static struct flow *
+find_flow_mbtree(struct flowinfo *, struct flow *);
+static void
+destroy_flowinfo_mbtree(struct flowinfo *);
+
+struct flowinfo *
+new_flowinfo_mbtree(void) {
+  struct flowinfo *self;
+  struct flow_list *flows;
+
+  self = calloc(1, sizeof(struct flowinfo));
+  flows = calloc(1, sizeof(struct flow_list) + sizeof(void *) * 65536);
+  if (self == NULL || flows == NULL) {
+    free(self);
+    free(flows);
+    return NULL;
+  }
+  flows->nbranch = 65536;
+  self->userdata = (uint64_t)(uintptr_t)flows;
+  self->add_func = add_flow_mbtree;
+  self->del_func = del_flow_mbtree;
+  self->match_func = match_flow_mbtree;
+  self->find_func = find_flow_mbtree;
+  self->destroy_func = destroy_flowinfo_mbtree;
+  return self;
+}
+
+static void
+destroy_flowinfo_mbtree(struct flowinfo *self) {
+  struct flow_list *flows;
+
+  flows = MBTREE(self);
+  cleanup_mbtree(flows);
+  free(flows->flows);
+  free(flows);
+  free(self);
+}
+
+static void
+mbtree_rebuild_unpublished(struct flow_list *flows) {
+  struct flow_list *garbage;
+
+  garbage = NULL;
+  rebuild_mbtree(flows, &garbage);
+  free_mbtree(garbage);
+}
+
+static bool
+mbtree_flow_equal(struct flow *f1, struct flow *f2) {
+  struct match *m1, *m2;
+
+  if (f1->priority != f2->priority || f1->field_bits != f2->field_bits) {
+    return false;
+  }
+  m1 = TAILQ_FIRST(&f1->match_list);
+  m2 = TAILQ_FIRST(&f2->match_list);
+  while (m1 != NULL && m2 != NULL) {
+    if (m1->oxm_class != m2->oxm_class ||
+        m1->oxm_field != m2->oxm_field ||
+        m1->oxm_length != m2->oxm_length ||
+        memcmp(m1->oxm_value, m2->oxm_value, m1->oxm_length) != 0) {
+      return false;
+    }
+    m1 = TAILQ_NEXT(m1, entry);
+    m2 = TAILQ_NEXT(m2, entry);
+  }
+  return m1 == m2;
+}
+
+/*
+ * index of the flow in the root, the same flow or the flow of the
+ * same priority and match if equal is true.
+ */
+static int
+mbtree_flow_index(struct flow_list *flows, struct flow *flow, bool equal) {
+  int i, st, ed, off;
+
+  st = 0;
+  ed = flows->nflow;
+  while (st < ed) {
+    off = st + (ed - st) / 2;
+    if (flows->flows[off]->priority > flow->priority) {
+      st = off + 1;
+    } else {
+      ed = off;
+    }
+  }
+  for (i = st; i < flows->nflow; i++) {
+    if (flows->flows[i]->priority != flow->priority) {
+      break;
+    }
+    if (flows->flows[i] == flow ||
+        (equal == true && mbtree_flow_equal(flows->flows[i], flow) == true)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static lagopus_result_t
+add_flow_mbtree(struct flowinfo *self, struct flow *flow) {
+  struct flow_list *flows;
+  lagopus_result_t rv;
+
+  flows = MBTREE(self);
+  flow_make_match(flow);
+  rv = flow_add_sub(flow, flows);
+  if (rv != LAGOPUS_RESULT_OK) {
+    return rv;
+  }
+  if (add_mbtree(flows, flow) == true) {
+    mbtree_rebuild_unpublished(flows);
+  }
+  self->nflow++;
+  return LAGOPUS_RESULT_OK;
+}
+
+static lagopus_result_t
+del_flow_mbtree(struct flowinfo *self, struct flow *flow) {
+  struct flow_list *flows;
+  int i;
+
+  flows = MBTREE(self);
+  i = mbtree_flow_index(flows, flow, false);
+  if (i < 0) {
+    return LAGOPUS_RESULT_NOT_FOUND;
+  }
+  flows->nflow--;
+  memmove(&flows->flows[i], &flows->flows[i + 1],
+          sizeof(struct flow *) * (size_t)(flows->nflow - i));
+  if (del_mbtree(flows, flow) == true) {
+    mbtree_rebuild_unpublished(flows);
+  }
+  self->nflow--;
+  return LAGOPUS_RESULT_OK;
+}
+
+static struct flow *
+match_flow_mbtree(struct flowinfo *self, struct lagopus_packet *pkt,
+                  int32_t *pri) {
+  struct flow *flow;
+
+  flow = find_mbtree(pkt, MBTREE(self));
+  if (flow != NULL) {
+    *pri = flow->priority;
+  }
+  return flow;
+}
+
+static struct flow *
+find_flow_mbtree(struct flowinfo *self, struct flow *flow) {
+  struct flow_list *flows;
+  int i;
+
+  flows = MBTREE(self);
+  i = mbtree_flow_index(flows, flow, true);
+  if (i < 0) {
+    return NULL;
+  }
+  return flows->flows[i];
+}
@@ -17,6 +17,8 @@
 #ifndef SRC_DATAPLANE_OFPROTO_MBTREE_H_
 #define SRC_DATAPLANE_OFPROTO_MBTREE_H_
 
+#include <stdbool.h>
+
 struct flow;
 struct flow_list;
 struct lagopus_packet;
@@ -25,4 +27,20 @@ void cleanup_mbtree(struct flow_list *flows);
 void build_mbtree(struct flow_list *flows);
 struct flow *find_mbtree(struct lagopus_packet *pkt, struct flow_list *flows);
 
+/*
+ * Add or delete a flow modifying only the subtree the flow belongs to.
+ * Forwarding threads must be excluded.  Return true if some subtree
+ * becomes unbalanced and rebuild_mbtree() should be called.
+ */
+bool add_mbtree(struct flow_list *flows, struct flow *flow);
+bool del_mbtree(struct flow_list *flows, struct flow *flow);
+
+/*
+ * Replace unbalanced subtrees by rebuilt ones while forwarding threads
+ * are looking up.  Replaced subtrees are chained to *garbage, and
+ * freed by free_mbtree() after no thread refers them.
+ */
+void rebuild_mbtree(struct flow_list *flows, struct flow_list **garbage);
+void free_mbtree(struct flow_list *garbage);
+
 #endif /* SRC_DATAPLANE_OFPROTO_MBTREE_H_ */
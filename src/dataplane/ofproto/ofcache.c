@@ -24,9 +24,13 @@
 #include <sys/queue.h>
 #include <stdlib.h>
 #include <inttypes.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif /* __SSE2__ */
 
 #include "lagopus_apis.h"
 #include "lagopus/flowdb.h"
+#include "lagopus/bridge.h"
 
 #include "pktbuf.h"
 #include "packet.h"
@@ -72,16 +76,56 @@ struct flowcache_bank {
   uint64_t nentries;
   uint64_t hit;
   uint64_t miss;
+  uint64_t invalidated;
   int bank;
 };
 
 /**
  * per thread cache object.
  */
+/*
+ * Cuckoo flowcache.
+ *
+ * Each key has two candidate buckets.  The first is selected by the
+ * higher 32bit of the hash, the second by the first xor hash of the
+ * tag, lower 32bit of the hash folded to 16bit.  A bucket holds the
+ * tags of its 8 slots in 16 bytes, compared at once.  Slots are
+ * allocated at initialization, and an entry is replaced by clock
+ * algorithm when both candidate buckets are full.
+ */
+#define CUCKOO_BUCKET_WAYS      8
+#define CUCKOO_NBUCKETS         (1 << 13)
+#define CUCKOO_SLOT_FLOWS       4
+
+struct cuckoo_bucket {
+  uint16_t tag[CUCKOO_BUCKET_WAYS];     /* tag of slots, 0 is empty. */
+  uint8_t ref;                          /* referenced bits of slots. */
+} __attribute__((aligned(32)));
+
+struct cuckoo_slot {
+  struct cache_entry entry;
+  struct flow *flow_storage[CUCKOO_SLOT_FLOWS]; /* entry.flow[] */
+  uint32_t generation[CUCKOO_SLOT_FLOWS];
+  uint8_t table_id[CUCKOO_SLOT_FLOWS];
+} __attribute__((aligned(64)));
+
+struct flowcache_cuckoo {
+  struct cuckoo_bucket *buckets;
+  struct cuckoo_slot *slots;
+  uint32_t mask;
+  unsigned int hand;                    /* clock hand. */
+  /* statistics */
+  uint64_t nentries;
+  uint64_t hit;
+  uint64_t miss;
+  uint64_t invalidated;
+};
+
 struct flowcache {
   int used_bank;
   uint64_t max_entries;
   struct flowcache_bank *bank[NBANK];
+  struct flowcache_cuckoo *cuckoo;      /* used instead of banks. */
 };
 
 TAILQ_HEAD(cache_entry_list, cache_entry);
@@ -175,17 +219,29 @@ static void
 register_cache_bank(struct flowcache_bank *cache,
                     uint64_t hash64,
                     unsigned nmatched,
-                    const struct flow **flow) {
+                    const struct flow **flow,
+                    const uint32_t *generation) {
   struct cache_entry *cache_entry, *remove_entry;
   struct cache_list *list;
   uint32_t hash32_h;
+  unsigned i;
 
   DPRINTF("register cache (nmatched %d) to %p\n", nmatched, cache);
   cache_entry = calloc(1, sizeof(struct cache_entry) +
-                       sizeof(struct flow *) * nmatched);
+                       (sizeof(struct flow *) + sizeof(uint32_t) +
+                        sizeof(uint8_t)) * nmatched);
+  if (cache_entry == NULL) {
+    return;
+  }
   cache_entry->hash64 = hash64;
   cache_entry->nmatched = nmatched;
   memcpy(cache_entry->flow, flow, nmatched * sizeof(struct flow *));
+  cache_entry->generation = (uint32_t *)&cache_entry->flow[nmatched];
+  memcpy(cache_entry->generation, generation, nmatched * sizeof(uint32_t));
+  cache_entry->table_id = (uint8_t *)&cache_entry->generation[nmatched];
+  for (i = 0; i < nmatched; i++) {
+    cache_entry->table_id[i] = flow[i]->table_id;
+  }
   hash32_h = cache_entry->hash32_h;
 
   switch (cache->kvs_type) {
@@ -290,6 +346,28 @@ clear_all_cache_bank(struct flowcache_bank *cache) {
   cache->nentries = 0;
   cache->hit = 0;
   cache->miss = 0;
+  cache->invalidated = 0;
+}
+
+/**
+ * Check tables referred by the entry are not changed since the entry
+ * is registered.  Flows of stale entry may be freed already, only
+ * table ids saved in the entry are used.
+ */
+static inline bool
+cache_entry_is_valid(const struct cache_entry *cache_entry,
+                     struct flowdb *flowdb) {
+  const struct table *table;
+  unsigned i;
+
+  for (i = 0; i < cache_entry->nmatched; i++) {
+    table = table_lookup(flowdb, cache_entry->table_id[i]);
+    if (unlikely(table == NULL ||
+                 table->generation != cache_entry->generation[i])) {
+      return false;
+    }
+  }
+  return true;
 }
 
 static struct cache_entry *
@@ -335,6 +413,14 @@ cache_lookup_bank(struct flowcache_bank *cache, struct lagopus_packet *pkt) {
   if (likely(list != NULL)) {
     TAILQ_FOREACH(cache_entry, &list->entries, next) {
       if (pkt->hash32_l == cache_entry->hash32_l) {
+        if (unlikely(cache_entry_is_valid(cache_entry,
+                                          pkt->bridge->flowdb) == false)) {
+          /* flows are changed, looked up again and registered. */
+          remove_cache_list(list, cache_entry);
+          cache->nentries--;
+          cache->invalidated++;
+          break;
+        }
         cache->hit++;
         return cache_entry;
       }
@@ -377,6 +463,236 @@ fini_flowcache_bank(struct flowcache_bank *cache) {
   free(cache);
 }
 
+static struct flowcache_cuckoo *
+init_flowcache_cuckoo(void) {
+  struct flowcache_cuckoo *cache;
+  size_t nslots, i;
+
+  cache = calloc(1, sizeof(struct flowcache_cuckoo));
+  if (cache == NULL) {
+    return NULL;
+  }
+  nslots = CUCKOO_NBUCKETS * CUCKOO_BUCKET_WAYS;
+  if (posix_memalign((void **)&cache->buckets, 64,
+                     sizeof(struct cuckoo_bucket) * CUCKOO_NBUCKETS) != 0) {
+    free(cache);
+    return NULL;
+  }
+  if (posix_memalign((void **)&cache->slots, 64,
+                     sizeof(struct cuckoo_slot) * nslots) != 0) {
+    free(cache->buckets);
+    free(cache);
+    return NULL;
+  }
+  memset(cache->buckets, 0, sizeof(struct cuckoo_bucket) * CUCKOO_NBUCKETS);
+  memset(cache->slots, 0, sizeof(struct cuckoo_slot) * nslots);
+  for (i = 0; i < nslots; i++) {
+    cache->slots[i].entry.generation = cache->slots[i].generation;
+    cache->slots[i].entry.table_id = cache->slots[i].table_id;
+  }
+  cache->mask = CUCKOO_NBUCKETS - 1;
+  return cache;
+}
+
+static void
+fini_flowcache_cuckoo(struct flowcache_cuckoo *cache) {
+  free(cache->slots);
+  free(cache->buckets);
+  free(cache);
+}
+
+static inline uint16_t
+cuckoo_tag(uint32_t hash32_l) {
+  uint16_t tag;
+
+  tag = (uint16_t)(hash32_l ^ (hash32_l >> 16));
+  return tag != 0 ? tag : 1;
+}
+
+static inline uint32_t
+cuckoo_alt_bucket(const struct flowcache_cuckoo *cache,
+                  uint32_t bucket, uint16_t tag) {
+  return (bucket ^ ((uint32_t)tag * 0x5bd1e995U)) & cache->mask;
+}
+
+/**
+ * Compare tags of the bucket.
+ *
+ * @retval      Two bits per matched way, way N is bit 2N and 2N+1.
+ */
+static inline uint32_t
+cuckoo_match(const struct cuckoo_bucket *bucket, uint16_t tag) {
+#ifdef __SSE2__
+  __m128i tags;
+
+  tags = _mm_load_si128((const __m128i *)bucket->tag);
+  return (uint32_t)_mm_movemask_epi8(
+           _mm_cmpeq_epi16(tags, _mm_set1_epi16((short)tag)));
+#else
+  uint32_t mask;
+  int way;
+
+  mask = 0;
+  for (way = 0; way < CUCKOO_BUCKET_WAYS; way++) {
+    if (bucket->tag[way] == tag) {
+      mask |= 3U << (way << 1);
+    }
+  }
+  return mask;
+#endif /* __SSE2__ */
+}
+
+static inline int
+cuckoo_next_way(uint32_t *mask) {
+  int way;
+
+  way = __builtin_ctz(*mask) >> 1;
+  *mask &= ~(3U << (way << 1));
+  return way;
+}
+
+/**
+ * Prefetch both candidate buckets of the packet.
+ */
+static inline void
+cache_prefetch_cuckoo(const struct flowcache_cuckoo *cache,
+                      const struct lagopus_packet *pkt) {
+  uint32_t b;
+
+  b = pkt->hash32_h & cache->mask;
+  __builtin_prefetch(&cache->buckets[b]);
+  __builtin_prefetch(&cache->buckets[cuckoo_alt_bucket(
+                                        cache, b,
+                                        cuckoo_tag(pkt->hash32_l))]);
+}
+
+static struct cache_entry *
+cache_lookup_cuckoo(struct flowcache_cuckoo *cache,
+                    struct lagopus_packet *pkt) {
+  struct cuckoo_bucket *bucket;
+  struct cuckoo_slot *slot;
+  uint32_t b[2], mask;
+  uint16_t tag;
+  int i, way;
+
+  tag = cuckoo_tag(pkt->hash32_l);
+  b[0] = pkt->hash32_h & cache->mask;
+  b[1] = cuckoo_alt_bucket(cache, b[0], tag);
+  __builtin_prefetch(&cache->buckets[b[1]]);
+  for (i = 0; i < 2; i++) {
+    bucket = &cache->buckets[b[i]];
+    mask = cuckoo_match(bucket, tag);
+    while (mask != 0) {
+      way = cuckoo_next_way(&mask);
+      slot = &cache->slots[b[i] * CUCKOO_BUCKET_WAYS + (uint32_t)way];
+      if (slot->entry.hash64 != pkt->hash64) {
+        continue;
+      }
+      if (unlikely(cache_entry_is_valid(&slot->entry,
+                                        pkt->bridge->flowdb) == false)) {
+        /* flows are changed, looked up again and registered. */
+        bucket->tag[way] = 0;
+        bucket->ref &= (uint8_t)~(1 << way);
+        cache->nentries--;
+        cache->invalidated++;
+        cache->miss++;
+        return NULL;
+      }
+      bucket->ref |= (uint8_t)(1 << way);
+      cache->hit++;
+      return &slot->entry;
+    }
+  }
+  cache->miss++;
+  return NULL;
+}
+
+static void
+register_cache_cuckoo(struct flowcache_cuckoo *cache,
+                      uint64_t hash64,
+                      unsigned nmatched,
+                      const struct flow **flow,
+                      const uint32_t *generation) {
+  struct cuckoo_bucket *bucket;
+  struct cuckoo_slot *slot;
+  struct cache_entry key;
+  uint32_t b[2], mask;
+  unsigned i, n;
+  uint16_t tag;
+  int way;
+
+  if (nmatched > CUCKOO_SLOT_FLOWS) {
+    /* too long pipeline, not cached. */
+    return;
+  }
+  slot = NULL;
+  way = 0;
+  bucket = NULL;
+  key.hash64 = hash64;
+  tag = cuckoo_tag(key.hash32_l);
+  b[0] = key.hash32_h & cache->mask;
+  b[1] = cuckoo_alt_bucket(cache, b[0], tag);
+
+  /* same key already registered, or empty slot. */
+  for (i = 0; i < 2 && slot == NULL; i++) {
+    bucket = &cache->buckets[b[i]];
+    mask = cuckoo_match(bucket, tag);
+    while (mask != 0) {
+      way = cuckoo_next_way(&mask);
+      if (cache->slots[b[i] * CUCKOO_BUCKET_WAYS +
+                       (uint32_t)way].entry.hash64 == hash64) {
+        slot = &cache->slots[b[i] * CUCKOO_BUCKET_WAYS + (uint32_t)way];
+        break;
+      }
+    }
+  }
+  for (i = 0; i < 2 && slot == NULL; i++) {
+    bucket = &cache->buckets[b[i]];
+    mask = cuckoo_match(bucket, 0);
+    if (mask != 0) {
+      way = cuckoo_next_way(&mask);
+      slot = &cache->slots[b[i] * CUCKOO_BUCKET_WAYS + (uint32_t)way];
+      cache->nentries++;
+    }
+  }
+  if (slot == NULL) {
+    /* both buckets are full, replace not recently referenced one. */
+    for (n = 0; n < 4 * CUCKOO_BUCKET_WAYS; n++) {
+      i = cache->hand++ % (2 * CUCKOO_BUCKET_WAYS);
+      bucket = &cache->buckets[b[i / CUCKOO_BUCKET_WAYS]];
+      way = (int)(i % CUCKOO_BUCKET_WAYS);
+      if ((bucket->ref & (1 << way)) == 0) {
+        break;
+      }
+      bucket->ref &= (uint8_t)~(1 << way);
+    }
+    slot = &cache->slots[b[i / CUCKOO_BUCKET_WAYS] * CUCKOO_BUCKET_WAYS +
+                         (uint32_t)way];
+  }
+
+  slot->entry.hash64 = hash64;
+  slot->entry.nmatched = nmatched;
+  for (i = 0; i < nmatched; i++) {
+    slot->entry.flow[i] = (struct flow *)flow[i];
+    slot->generation[i] = generation[i];
+    slot->table_id[i] = flow[i]->table_id;
+  }
+  bucket->tag[way] = tag;
+  bucket->ref |= (uint8_t)(1 << way);
+}
+
+static void
+clear_all_cache_cuckoo(struct flowcache_cuckoo *cache) {
+  if (cache->nentries != 0) {
+    memset(cache->buckets, 0,
+           sizeof(struct cuckoo_bucket) * CUCKOO_NBUCKETS);
+  }
+  cache->nentries = 0;
+  cache->hit = 0;
+  cache->miss = 0;
+  cache->invalidated = 0;
+}
+
 struct flowcache *
 init_flowcache(int kvs_type) {
   struct flowcache *cache;
@@ -386,6 +702,15 @@ init_flowcache(int kvs_type) {
   if (cache == NULL) {
     return NULL;
   }
+  if (kvs_type == FLOWCACHE_CUCKOO) {
+    cache->cuckoo = init_flowcache_cuckoo();
+    if (cache->cuckoo == NULL) {
+      free(cache);
+      return NULL;
+    }
+    cache->max_entries = CUCKOO_NBUCKETS * CUCKOO_BUCKET_WAYS;
+    return cache;
+  }
   for (bank = 0; bank < NBANK; bank++) {
     cache->bank[bank] = init_flowcache_bank(kvs_type, bank);
     if (cache->bank[bank] == NULL) {
@@ -401,15 +726,21 @@ void
 register_cache(struct flowcache *cache,
                uint64_t hash64,
                unsigned nmatched,
-               const struct flow **flow) {
+               const struct flow **flow,
+               const uint32_t *generation) {
   struct flowcache_bank *bank, *alt_bank;
 
+  if (cache->cuckoo != NULL) {
+    register_cache_cuckoo(cache->cuckoo, hash64, nmatched, flow, generation);
+    return;
+  }
   bank = cache->bank[0];
-  register_cache_bank(bank, hash64, nmatched, flow);
+  register_cache_bank(bank, hash64, nmatched, flow, generation);
   if (bank->nentries >= cache->max_entries / 2) {
     alt_bank = init_flowcache_bank(bank->kvs_type, cache->bank[1]->bank + 1);
     alt_bank->hit = cache->bank[1]->hit;
     alt_bank->miss = cache->bank[1]->miss;
+    alt_bank->invalidated = cache->bank[1]->invalidated;
     fini_flowcache_bank(cache->bank[1]);
     cache->bank[0] = alt_bank;
     cache->bank[1] = bank;
@@ -424,6 +755,10 @@ clear_all_cache(struct flowcache *cache) {
     /* flowcache is not running, nothing to do. */
     return;
   }
+  if (cache->cuckoo != NULL) {
+    clear_all_cache_cuckoo(cache->cuckoo);
+    return;
+  }
   for (bank = 0; bank < NBANK; bank++) {
     clear_all_cache_bank(cache->bank[bank]);
   }
@@ -436,6 +771,9 @@ cache_lookup(struct flowcache *cache, struct lagopus_packet *pkt) {
   if (cache == NULL) {
     return NULL;
   }
+  if (likely(cache->cuckoo != NULL)) {
+    return cache_lookup_cuckoo(cache->cuckoo, pkt);
+  }
   rv = cache_lookup_bank(cache->bank[0], pkt);
   if (rv == NULL) {
     rv = cache_lookup_bank(cache->bank[1], pkt);
@@ -443,6 +781,33 @@ cache_lookup(struct flowcache *cache, struct lagopus_packet *pkt) {
   return rv;
 }
 
+void
+cache_lookup_bulk(struct flowcache *cache,
+                  struct lagopus_packet *pkts[], size_t npkts,
+                  struct cache_entry *entries[]) {
+  size_t i;
+
+  if (cache == NULL) {
+    for (i = 0; i < npkts; i++) {
+      entries[i] = NULL;
+    }
+    return;
+  }
+  if (likely(cache->cuckoo != NULL)) {
+    /* bring all buckets of the burst in, then compare. */
+    for (i = 0; i < npkts; i++) {
+      cache_prefetch_cuckoo(cache->cuckoo, pkts[i]);
+    }
+    for (i = 0; i < npkts; i++) {
+      entries[i] = cache_lookup_cuckoo(cache->cuckoo, pkts[i]);
+    }
+    return;
+  }
+  for (i = 0; i < npkts; i++) {
+    entries[i] = cache_lookup(cache, pkts[i]);
+  }
+}
+
 void
 get_flowcache_statistics(struct flowcache *cache, struct ofcachestat *st) {
   struct flowcache_bank *bank;
@@ -451,11 +816,20 @@ get_flowcache_statistics(struct flowcache *cache, struct ofcachestat *st) {
   st->nentries = 0;
   st->hit = 0;
   st->miss = 0;
+  st->invalidated = 0;
+  if (cache->cuckoo != NULL) {
+    st->nentries = cache->cuckoo->nentries;
+    st->hit = cache->cuckoo->hit;
+    st->miss = cache->cuckoo->miss;
+    st->invalidated = cache->cuckoo->invalidated;
+    return;
+  }
   for (i = 0; i < NBANK; i++) {
     bank = cache->bank[i];
     st->nentries += bank->nentries;
     st->hit += bank->hit;
     st->miss += bank->miss;
+    st->invalidated += bank->invalidated;
   }
 }
 
@@ -463,6 +837,11 @@ void
 fini_flowcache(struct flowcache *cache) {
   int bank;
 
+  if (cache->cuckoo != NULL) {
+    fini_flowcache_cuckoo(cache->cuckoo);
+    free(cache);
+    return;
+  }
   for (bank = 0; bank < NBANK; bank++) {
     fini_flowcache_bank(cache->bank[bank]);
   }
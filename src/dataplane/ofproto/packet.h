@@ -241,6 +241,7 @@ struct lagopus_packet {
   void *cache;
   unsigned nmatched;
   const struct flow *matched_flow[LAGOPUS_DP_PIPELINE_MAX];
+  uint32_t matched_generation[LAGOPUS_DP_PIPELINE_MAX];
 
   /*
    * flow information.
@@ -382,9 +383,6 @@ struct lagopus_packet {
  */
 static inline struct flow *
 lagopus_find_flow(struct lagopus_packet *pkt, struct table *table) {
-#ifdef USE_MBTREE
-  return find_mbtree(pkt, table->flow_list);
-#else
   struct flowinfo *flowinfo;
   struct flow *flow;
   int32_t prio;
@@ -398,7 +396,6 @@ lagopus_find_flow(struct lagopus_packet *pkt, struct table *table) {
     flow = NULL;
   }
   return flow;
-#endif /* USE_MBTREE */
 }
 
 #endif /* SRC_DATAPLANE_OFPROTO_PACKET_H_ */
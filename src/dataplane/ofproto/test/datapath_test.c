@@ -22,6 +22,7 @@
 #include "lagopus/dataplane.h"
 #include "lagopus/dp_apis.h"
 #include "lagopus/datastore/bridge.h"
+#include "lagopus/ofcache.h"
 #include "pktbuf.h"
 #include "packet.h"
 #include "datapath_test_misc.h"
@@ -147,7 +148,7 @@ test_action_OUTPUT(void) {
   execute_action(pkt, &action_list);
   TEST_ASSERT_EQUAL_MESSAGE(m->refcnt, 1,
                             "OUTPUT refcnt error.");
-  free(m);
+  OS_M_FREE(m);
 }
 
 void
@@ -190,5 +191,121 @@ test_lagopus_match_and_action(void) {
   lagopus_match_and_action(pkt);
   TEST_ASSERT_EQUAL_MESSAGE(m->refcnt, 1,
                             "match_and_action refcnt error.");
-  free(m);
+  OS_M_FREE(m);
+}
+
+#define BULK_NPKTS 4
+
+static void
+bulk_flow_add(struct bridge *bridge, uint32_t in_port, uint32_t out_port) {
+  struct ofp_flow_mod flow_mod;
+  struct match_list match_list;
+  struct instruction_list instruction_list;
+  struct instruction *insn;
+  struct action *action;
+  struct ofp_action_output *action_output;
+  struct ofp_error error;
+
+  TAILQ_INIT(&match_list);
+  TAILQ_INIT(&instruction_list);
+  add_match(&match_list, 4, OFPXMT_OFB_IN_PORT << 1,
+            (in_port >> 24) & 0xff, (in_port >> 16) & 0xff,
+            (in_port >> 8) & 0xff, in_port & 0xff);
+  insn = calloc(1, sizeof(struct instruction));
+  TEST_ASSERT_NOT_NULL(insn);
+  insn->ofpit.type = OFPIT_APPLY_ACTIONS;
+  lagopus_set_instruction_function(insn);
+  TAILQ_INIT(&insn->action_list);
+  action = calloc(1, sizeof(*action) +
+                  sizeof(*action_output) - sizeof(struct ofp_action_header));
+  TEST_ASSERT_NOT_NULL(action);
+  action_output = (struct ofp_action_output *)&action->ofpat;
+  action_output->type = OFPAT_OUTPUT;
+  action_output->port = out_port;
+  lagopus_set_action_function(action);
+  TAILQ_INSERT_TAIL(&insn->action_list, action, entry);
+  TAILQ_INSERT_TAIL(&instruction_list, insn, entry);
+
+  memset(&flow_mod, 0, sizeof(flow_mod));
+  flow_mod.command = OFPFC_ADD;
+  flow_mod.table_id = 0;
+  flow_mod.priority = 1;
+  flow_mod.out_port = OFPP_ANY;
+  flow_mod.out_group = OFPG_ANY;
+  TEST_ASSERT_EQUAL(flowdb_flow_add(bridge, &flow_mod, &match_list,
+                                    &instruction_list, &error),
+                    LAGOPUS_RESULT_OK);
+}
+
+static void
+bulk_burst(struct port *port, struct flowcache *cache) {
+  struct lagopus_packet *pkts[BULK_NPKTS];
+  OS_MBUF *m;
+  int i;
+
+  for (i = 0; i < BULK_NPKTS; i++) {
+    pkts[i] = alloc_lagopus_packet();
+    TEST_ASSERT_NOT_NULL(pkts[i]);
+    m = PKT2MBUF(pkts[i]);
+    OS_M_APPEND(m, 64);
+    m->refcnt = 2;
+    pkts[i]->table_id = 0;
+    lagopus_packet_init(pkts[i], m, port);
+  }
+  lagopus_bulk_match_and_action(pkts, BULK_NPKTS, cache);
+  for (i = 0; i < BULK_NPKTS; i++) {
+    m = PKT2MBUF(pkts[i]);
+    TEST_ASSERT_EQUAL_MESSAGE(m->refcnt, 1,
+                              "bulk_match_and_action refcnt error.");
+    OS_M_FREE(m);
+  }
+}
+
+void
+test_lagopus_bulk_match_and_action(void) {
+  struct bridge *bridge;
+  struct table *table;
+  struct flow *flow;
+  struct port *port;
+  struct flowcache *cache;
+  struct ofcachestat st;
+  uint64_t packets, bytes;
+
+  flowinfo_init();
+  bridge = dp_bridge_lookup("br0");
+  TEST_ASSERT_NOT_NULL(bridge);
+  flowdb_switch_mode_set(bridge->flowdb, SWITCH_MODE_OPENFLOW);
+  port = port_lookup(&bridge->ports, 1);
+  TEST_ASSERT_NOT_NULL(port);
+  bulk_flow_add(bridge, 1, 2);
+  table = table_lookup(bridge->flowdb, 0);
+  TEST_ASSERT_NOT_NULL(table);
+  TEST_ASSERT_EQUAL(table->flow_list->nflow, 1);
+  flow = table->flow_list->flows[0];
+  cache = init_flowcache(FLOWCACHE_CUCKOO);
+  TEST_ASSERT_NOT_NULL(cache);
+
+  /* all missed, the first one is classified and cached. */
+  bulk_burst(port, cache);
+  flow_counter_get(flow, &packets, &bytes);
+  TEST_ASSERT_EQUAL(packets, BULK_NPKTS);
+  get_flowcache_statistics(cache, &st);
+  TEST_ASSERT_EQUAL(st.nentries, 1);
+  TEST_ASSERT_EQUAL(st.miss, BULK_NPKTS);
+  TEST_ASSERT_EQUAL(st.hit, BULK_NPKTS - 1);
+
+  /* all hit the same entry. */
+  bulk_burst(port, cache);
+  flow_counter_get(flow, &packets, &bytes);
+  TEST_ASSERT_EQUAL(packets, 2 * BULK_NPKTS);
+  TEST_ASSERT_EQUAL(bytes, 2 * BULK_NPKTS * 64);
+  get_flowcache_statistics(cache, &st);
+  TEST_ASSERT_EQUAL(st.nentries, 1);
+  TEST_ASSERT_EQUAL(st.hit, 2 * BULK_NPKTS - 1);
+
+  /* without cache. */
+  bulk_burst(port, NULL);
+  flow_counter_get(flow, &packets, &bytes);
+  TEST_ASSERT_EQUAL(packets, 3 * BULK_NPKTS);
+  fini_flowcache(cache);
 }
@@ -0,0 +1,250 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <netinet/in.h>
+
+#include "unity.h"
+
+#include "lagopus/ethertype.h"
+#include "dispatch_hash.h"
+
+#define NWORKERS        4
+#define NFLOWS          4000
+
+static uint8_t frame[256];
+
+void
+setUp(void) {
+}
+
+void
+tearDown(void) {
+}
+
+static size_t
+put_ether(uint8_t *p, uint16_t type) {
+  static const uint8_t addrs[12] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02
+  };
+
+  memcpy(p, addrs, sizeof(addrs));
+  p[12] = (uint8_t)(type >> 8);
+  p[13] = (uint8_t)type;
+  return 14;
+}
+
+/* IPv4 and L4 ports, returns length of the headers. */
+static size_t
+put_ipv4(uint8_t *p, uint8_t proto, uint32_t src, uint32_t dst,
+         uint16_t sport, uint16_t dport) {
+  memset(p, 0, 28);
+  p[0] = 0x45;
+  p[9] = proto;
+  p[12] = (uint8_t)(src >> 24);
+  p[13] = (uint8_t)(src >> 16);
+  p[14] = (uint8_t)(src >> 8);
+  p[15] = (uint8_t)src;
+  p[16] = (uint8_t)(dst >> 24);
+  p[17] = (uint8_t)(dst >> 16);
+  p[18] = (uint8_t)(dst >> 8);
+  p[19] = (uint8_t)dst;
+  p[20] = (uint8_t)(sport >> 8);
+  p[21] = (uint8_t)sport;
+  p[22] = (uint8_t)(dport >> 8);
+  p[23] = (uint8_t)dport;
+  return 28;
+}
+
+static uint32_t
+tcp_hash(uint32_t src, uint32_t dst, uint16_t sport, uint16_t dport) {
+  size_t len;
+
+  len = put_ether(frame, ETHERTYPE_IP);
+  len += put_ipv4(frame + len, IPPROTO_TCP, src, dst, sport, dport);
+  return dispatch_hash(frame, len, 0);
+}
+
+static void
+check_spread(const uint32_t *hashes, int n) {
+  int counts[NWORKERS];
+  int i;
+
+  memset(counts, 0, sizeof(counts));
+  for (i = 0; i < n; i++) {
+    counts[hashes[i] % NWORKERS]++;
+  }
+  for (i = 0; i < NWORKERS; i++) {
+    TEST_ASSERT_TRUE(counts[i] > n / NWORKERS * 9 / 10);
+    TEST_ASSERT_TRUE(counts[i] < n / NWORKERS * 11 / 10);
+  }
+}
+
+void
+test_dispatch_hash_tuple(void) {
+  static uint32_t hashes[NFLOWS];
+  uint32_t hash;
+  int i;
+
+  /* flows between the same routers are spread by ports. */
+  for (i = 0; i < NFLOWS; i++) {
+    hashes[i] = tcp_hash(0x0a000001, 0x0a000002,
+                         (uint16_t)(1024 + i), 80);
+  }
+  check_spread(hashes, NFLOWS);
+  for (i = 0; i < NFLOWS; i++) {
+    hashes[i] = tcp_hash(0x0a000001 + (uint32_t)i, 0x0a000002, 1024, 80);
+  }
+  check_spread(hashes, NFLOWS);
+
+  /* ethernet addresses do not matter for IP. */
+  hash = tcp_hash(0x0a000001, 0x0a000002, 1024, 80);
+  frame[5] = 0x55;
+  TEST_ASSERT_EQUAL_UINT32(hash, dispatch_hash(frame, 14 + 28, 0));
+  /* seed does. */
+  TEST_ASSERT_NOT_EQUAL(hash, dispatch_hash(frame, 14 + 28, 1));
+}
+
+void
+test_dispatch_hash_vlan_fragment(void) {
+  uint32_t hash;
+  size_t len;
+
+  hash = tcp_hash(0x0a000001, 0x0a000002, 1024, 80);
+
+  /* VLAN tag is skipped. */
+  len = put_ether(frame, ETHERTYPE_VLAN);
+  frame[14] = 0x00;
+  frame[15] = 0x0a;
+  frame[16] = ETHERTYPE_IP >> 8;
+  frame[17] = ETHERTYPE_IP & 0xff;
+  len += 4;
+  len += put_ipv4(frame + len, IPPROTO_TCP, 0x0a000001, 0x0a000002,
+                  1024, 80);
+  TEST_ASSERT_EQUAL_UINT32(hash, dispatch_hash(frame, len, 0));
+
+  /* ports of non-first fragments are not read. */
+  len = put_ether(frame, ETHERTYPE_IP);
+  len += put_ipv4(frame + len, IPPROTO_TCP, 0x0a000001, 0x0a000002,
+                  1024, 80);
+  frame[14 + 7] = 0x10;
+  hash = dispatch_hash(frame, len, 0);
+  len = put_ether(frame, ETHERTYPE_IP);
+  len += put_ipv4(frame + len, IPPROTO_TCP, 0x0a000001, 0x0a000002,
+                  2048, 443);
+  frame[14 + 7] = 0x10;
+  TEST_ASSERT_EQUAL_UINT32(hash, dispatch_hash(frame, len, 0));
+}
+
+void
+test_dispatch_hash_ipv6(void) {
+  static uint32_t hashes[NFLOWS];
+  size_t len;
+  uint8_t *p;
+  int i;
+
+  for (i = 0; i < NFLOWS; i++) {
+    len = put_ether(frame, ETHERTYPE_IPV6);
+    p = frame + len;
+    memset(p, 0, 48);
+    p[0] = 0x60;
+    p[6] = IPPROTO_UDP;
+    p[23] = 1;
+    p[39] = 2;
+    p[40] = (uint8_t)(i >> 8);
+    p[41] = (uint8_t)i;
+    p[43] = 53;
+    hashes[i] = dispatch_hash(frame, len + 48, 0);
+  }
+  check_spread(hashes, NFLOWS);
+}
+
+void
+test_dispatch_hash_tunnel(void) {
+  static uint32_t hashes[NFLOWS];
+  size_t len, hdr;
+  int i;
+
+  /* VXLAN between two VTEPs, spread by inner flows. */
+  for (i = 0; i < NFLOWS; i++) {
+    len = put_ether(frame, ETHERTYPE_IP);
+    len += put_ipv4(frame + len, IPPROTO_UDP, 0xc0a80001, 0xc0a80002,
+                    49152, 4789);
+    /* VXLAN header follows UDP header. */
+    memset(frame + len, 0, 8);
+    len += 8;
+    len += put_ether(frame + len, ETHERTYPE_IP);
+    len += put_ipv4(frame + len, IPPROTO_TCP, 0x0a000001, 0x0a000002,
+                    (uint16_t)(1024 + i), 80);
+    hashes[i] = dispatch_hash(frame, len, 0);
+  }
+  check_spread(hashes, NFLOWS);
+
+  /* GRE with key carrying IPv4. */
+  for (i = 0; i < NFLOWS; i++) {
+    len = put_ether(frame, ETHERTYPE_IP);
+    hdr = put_ipv4(frame + len, IPPROTO_GRE, 0xc0a80001, 0xc0a80002, 0, 0);
+    len += hdr - 8;
+    memset(frame + len, 0, 8);
+    frame[len] = 0x20;
+    frame[len + 2] = ETHERTYPE_IP >> 8;
+    frame[len + 3] = ETHERTYPE_IP & 0xff;
+    frame[len + 7] = 1;
+    len += 8;
+    len += put_ipv4(frame + len, IPPROTO_UDP, 0x0a000001 + (uint32_t)i,
+                    0x0a000002, 1024, 80);
+    hashes[i] = dispatch_hash(frame, len, 0);
+  }
+  check_spread(hashes, NFLOWS);
+
+  /* GRE carrying ethernet. */
+  for (i = 0; i < NFLOWS; i++) {
+    len = put_ether(frame, ETHERTYPE_IP);
+    hdr = put_ipv4(frame + len, IPPROTO_GRE, 0xc0a80001, 0xc0a80002, 0, 0);
+    len += hdr - 8;
+    memset(frame + len, 0, 4);
+    frame[len + 2] = 0x65;
+    frame[len + 3] = 0x58;
+    len += 4;
+    len += put_ether(frame + len, ETHERTYPE_IP);
+    len += put_ipv4(frame + len, IPPROTO_TCP, 0x0a000001, 0x0a000002,
+                    1024, (uint16_t)i);
+    hashes[i] = dispatch_hash(frame, len, 0);
+  }
+  check_spread(hashes, NFLOWS);
+}
+
+void
+test_dispatch_hash_short(void) {
+  uint32_t hash;
+  size_t len;
+
+  /* non-IP frames are told by ethernet addresses. */
+  len = put_ether(frame, ETHERTYPE_ARP);
+  memset(frame + len, 0, 28);
+  len += 28;
+  hash = dispatch_hash(frame, len, 0);
+  frame[5] = 0x03;
+  TEST_ASSERT_NOT_EQUAL(hash, dispatch_hash(frame, len, 0));
+
+  /* truncated frames are hashed by what is read. */
+  len = put_ether(frame, ETHERTYPE_IP);
+  len += put_ipv4(frame + len, IPPROTO_TCP, 0x0a000001, 0x0a000002,
+                  1024, 80);
+  for (; len > 0; len--) {
+    (void)dispatch_hash(frame, len - 1, 0);
+  }
+}
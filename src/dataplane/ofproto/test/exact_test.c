@@ -0,0 +1,279 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "unity.h"
+
+#include "lagopus/dp_apis.h"
+#include "lagopus/dataplane.h"
+#include "lagopus/flowdb.h"
+#include "lagopus/port.h"
+#include "pktbuf.h"
+#include "packet.h"
+
+#include "datapath_test_misc.h"
+
+#include "exact.c"
+
+#define NFLOWS 64
+#define NHOSTS 10000
+
+static struct flowinfo *flowinfo;
+static struct lagopus_packet *pkt;
+static struct port port;
+
+void
+setUp(void) {
+  OS_MBUF *m;
+
+  TEST_ASSERT_EQUAL(dp_api_init(), LAGOPUS_RESULT_OK);
+  flowinfo = new_flowinfo_exact(new_flowinfo_vlan_vid());
+  TEST_ASSERT_NOT_NULL(flowinfo);
+
+  pkt = alloc_lagopus_packet();
+  TEST_ASSERT_NOT_NULL(pkt);
+  m = PKT2MBUF(pkt);
+  OS_M_APPEND(m, 64);
+  OS_MTOD(m, uint8_t *)[12] = 0x08;
+  OS_MTOD(m, uint8_t *)[13] = 0x00;
+  OS_MTOD(m, uint8_t *)[14] = 0x45;
+  OS_MTOD(m, uint8_t *)[23] = IPPROTO_TCP;
+  lagopus_packet_init(pkt, m, &port);
+}
+
+void
+tearDown(void) {
+  flowinfo->destroy_func(flowinfo);
+  lagopus_packet_free(pkt);
+  dp_api_fini();
+}
+
+/*
+ * IPv4 flow to 10.x.y.z/plen of host i, and TCP destination port if
+ * not 0.  IPV4_DST has no mask if plen is 32.
+ */
+static struct flow *
+alloc_host_flow(int priority, int i, int plen, uint16_t dport) {
+  struct flow *flow;
+  uint32_t mask;
+
+  flow = allocate_test_flow(10 * sizeof(struct match));
+  TEST_ASSERT_NOT_NULL(flow);
+  flow->priority = priority;
+  add_match(&flow->match_list, 2, OFPXMT_OFB_ETH_TYPE << 1, 0x08, 0x00);
+  if (plen == 32) {
+    add_match(&flow->match_list, 4, OFPXMT_OFB_IPV4_DST << 1,
+              10, (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+  } else if (plen != 0) {
+    mask = (uint32_t)~0 << (32 - plen);
+    add_match(&flow->match_list, 8, (OFPXMT_OFB_IPV4_DST << 1) + 1,
+              10, (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff,
+              mask >> 24, (mask >> 16) & 0xff, (mask >> 8) & 0xff,
+              mask & 0xff);
+  }
+  if (dport != 0) {
+    add_match(&flow->match_list, 1, OFPXMT_OFB_IP_PROTO << 1, IPPROTO_TCP);
+    add_match(&flow->match_list, 2, OFPXMT_OFB_TCP_DST << 1,
+              dport >> 8, dport & 0xff);
+  }
+  return flow;
+}
+
+static void
+set_packet(int i, uint16_t dport) {
+  uint8_t *p;
+
+  p = OS_MTOD(PKT2MBUF(pkt), uint8_t *);
+  p[30] = 10;
+  p[31] = (uint8_t)(i >> 16);
+  p[32] = (uint8_t)(i >> 8);
+  p[33] = (uint8_t)i;
+  p[36] = (uint8_t)(dport >> 8);
+  p[37] = (uint8_t)dport;
+}
+
+static struct flow *
+lookup(void) {
+  int32_t prio;
+
+  prio = -1;
+  return flowinfo->match_func(flowinfo, pkt, &prio);
+}
+
+void
+test_exact_cuckoo(void) {
+  struct exact *exact;
+  struct flow **flow;
+  int i;
+
+  exact = EXACT(flowinfo);
+  flow = calloc(NHOSTS, sizeof(struct flow *));
+  TEST_ASSERT_NOT_NULL(flow);
+  for (i = 0; i < NHOSTS; i++) {
+    flow[i] = alloc_host_flow(10, i, 32, 0);
+    TEST_ASSERT_EQUAL(flowinfo->add_func(flowinfo, flow[i]),
+                      LAGOPUS_RESULT_OK);
+  }
+  TEST_ASSERT_EQUAL(flowinfo->nflow, NHOSTS);
+  TEST_ASSERT_EQUAL(exact->nentry, NHOSTS);
+  TEST_ASSERT_EQUAL(exact->nshape, 1);
+  TEST_ASSERT_TRUE((uint64_t)exact->size * EXACT_WAYS * 7 >=
+                   (uint64_t)NHOSTS * 8);
+  for (i = 0; i < NHOSTS; i++) {
+    set_packet(i, 80);
+    TEST_ASSERT_TRUE(lookup() == flow[i]);
+  }
+  set_packet(NHOSTS, 80);
+  TEST_ASSERT_NULL(lookup());
+
+  /* entries kicked out are still reachable after delete. */
+  for (i = 0; i < NHOSTS; i += 2) {
+    TEST_ASSERT_EQUAL(flowinfo->del_func(flowinfo, flow[i]),
+                      LAGOPUS_RESULT_OK);
+  }
+  TEST_ASSERT_EQUAL(exact->nentry, NHOSTS / 2);
+  for (i = 0; i < NHOSTS; i++) {
+    set_packet(i, 80);
+    TEST_ASSERT_TRUE(lookup() == ((i % 2) == 1 ? flow[i] : NULL));
+  }
+  for (i = 0; i < NHOSTS; i++) {
+    free_test_flow(flow[i]);
+  }
+  free(flow);
+}
+
+void
+test_exact_shape(void) {
+  struct exact *exact;
+  struct flow *flow[NFLOWS];
+  int i;
+
+  exact = EXACT(flowinfo);
+  for (i = 0; i < NFLOWS; i++) {
+    /* 3 shapes, and flows with masks. */
+    flow[i] = alloc_host_flow(i, i, (i % 4) == 3 ? 24 : 32,
+                              (i % 4) < 2 ? 0 : 80);
+    TEST_ASSERT_EQUAL(flowinfo->add_func(flowinfo, flow[i]),
+                      LAGOPUS_RESULT_OK);
+  }
+  TEST_ASSERT_EQUAL(flowinfo->nflow, NFLOWS);
+  TEST_ASSERT_EQUAL(exact->wildcard->nflow, NFLOWS / 4);
+  TEST_ASSERT_EQUAL(exact->nshape, 2);
+  TEST_ASSERT_EQUAL(exact_shape_max_priority(exact->shapes[0]), NFLOWS - 2);
+  TEST_ASSERT_EQUAL(exact_shape_max_priority(exact->shapes[1]), NFLOWS - 3);
+  TEST_ASSERT_EQUAL(exact->shapes[1]->pos, 1);
+
+  /* ETH_TYPE, IPV4_DST, IP_PROTO and TCP_DST are read once. */
+  TEST_ASSERT_EQUAL(exact->nslot, 4);
+  TEST_ASSERT_EQUAL(exact->slots[0].refs, 2);
+  TEST_ASSERT_EQUAL(exact->slots[1].refs, 2);
+
+  /* max priority is recalculated, empty shape is removed. */
+  TEST_ASSERT_EQUAL(flowinfo->del_func(flowinfo, flow[NFLOWS - 2]),
+                    LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(flowinfo->del_func(flowinfo, flow[NFLOWS - 2]),
+                    LAGOPUS_RESULT_NOT_FOUND);
+  TEST_ASSERT_EQUAL(exact_shape_max_priority(exact->shapes[0]), NFLOWS - 3);
+  TEST_ASSERT_EQUAL(exact_shape_max_priority(exact->shapes[1]), NFLOWS - 6);
+  for (i = 0; i < NFLOWS; i++) {
+    if ((i % 4) == 2 && i != NFLOWS - 2) {
+      TEST_ASSERT_EQUAL(flowinfo->del_func(flowinfo, flow[i]),
+                        LAGOPUS_RESULT_OK);
+    }
+  }
+  TEST_ASSERT_EQUAL(exact->nshape, 1);
+  TEST_ASSERT_EQUAL(exact->nslot, 2);
+  TEST_ASSERT_EQUAL(flowinfo->nflow, NFLOWS - NFLOWS / 4);
+  for (i = 0; i < NFLOWS; i++) {
+    free_test_flow(flow[i]);
+  }
+}
+
+void
+test_exact_match(void) {
+  struct flow *any, *net, *host[NFLOWS], *web;
+  int i;
+
+  /* flows with masks are matched by the wildcard classifier. */
+  any = alloc_host_flow(1, 0, 0, 0);
+  net = alloc_host_flow(10, 0, 16, 0);
+  web = alloc_host_flow(30, 0, 16, 80);
+  TEST_ASSERT_EQUAL(flowinfo->add_func(flowinfo, any), LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(flowinfo->add_func(flowinfo, net), LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(flowinfo->add_func(flowinfo, web), LAGOPUS_RESULT_OK);
+  for (i = 0; i < NFLOWS; i++) {
+    host[i] = alloc_host_flow(20, i, 32, 0);
+    TEST_ASSERT_EQUAL(flowinfo->add_func(flowinfo, host[i]),
+                      LAGOPUS_RESULT_OK);
+  }
+  TEST_ASSERT_EQUAL(EXACT(flowinfo)->wildcard->nflow, 2);
+  for (i = 0; i < NFLOWS; i++) {
+    set_packet(i, 22);
+    TEST_ASSERT_TRUE(lookup() == host[i]);
+    set_packet(i, 80);
+    TEST_ASSERT_TRUE(lookup() == web);
+  }
+  set_packet(NFLOWS, 22);
+  TEST_ASSERT_TRUE(lookup() == net);
+  set_packet(1 << 16, 80);
+  TEST_ASSERT_TRUE(lookup() == any);
+
+  /* lower priority flow of the same value. */
+  TEST_ASSERT_EQUAL(flowinfo->del_func(flowinfo, host[0]), LAGOPUS_RESULT_OK);
+  host[0]->priority = 5;
+  TEST_ASSERT_EQUAL(flowinfo->add_func(flowinfo, host[0]), LAGOPUS_RESULT_OK);
+  set_packet(0, 22);
+  TEST_ASSERT_TRUE(lookup() == net);
+  TEST_ASSERT_EQUAL(flowinfo->del_func(flowinfo, net), LAGOPUS_RESULT_OK);
+  TEST_ASSERT_TRUE(lookup() == host[0]);
+  TEST_ASSERT_EQUAL(flowinfo->del_func(flowinfo, host[0]), LAGOPUS_RESULT_OK);
+  TEST_ASSERT_TRUE(lookup() == any);
+  TEST_ASSERT_EQUAL(flowinfo->del_func(flowinfo, any), LAGOPUS_RESULT_OK);
+  TEST_ASSERT_NULL(lookup());
+
+  /* not IPv4. */
+  TEST_ASSERT_EQUAL(flowinfo->add_func(flowinfo, any), LAGOPUS_RESULT_OK);
+  set_packet(1, 22);
+  pkt->ether_type = ETHERTYPE_IPV6;
+  TEST_ASSERT_NULL(lookup());
+
+  free_test_flow(any);
+  free_test_flow(net);
+  free_test_flow(web);
+  for (i = 0; i < NFLOWS; i++) {
+    free_test_flow(host[i]);
+  }
+}
+
+void
+test_exact_find(void) {
+  struct flow *flow, *same, *other, *masked, *masked_same;
+
+  flow = alloc_host_flow(10, 1, 32, 80);
+  same = alloc_host_flow(10, 1, 32, 80);
+  other = alloc_host_flow(11, 1, 32, 80);
+  masked = alloc_host_flow(10, 1, 24, 80);
+  masked_same = alloc_host_flow(10, 1, 24, 80);
+  TEST_ASSERT_EQUAL(flowinfo->add_func(flowinfo, flow), LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(flowinfo->add_func(flowinfo, masked), LAGOPUS_RESULT_OK);
+  TEST_ASSERT_TRUE(flowinfo->find_func(flowinfo, same) == flow);
+  TEST_ASSERT_NULL(flowinfo->find_func(flowinfo, other));
+  TEST_ASSERT_TRUE(flowinfo->find_func(flowinfo, masked_same) == masked);
+  free_test_flow(flow);
+  free_test_flow(same);
+  free_test_flow(other);
+  free_test_flow(masked);
+  free_test_flow(masked_same);
+}
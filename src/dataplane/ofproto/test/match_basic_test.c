@@ -172,7 +172,7 @@ test_match_basic_IN_PORT(void) {
   rv = match_basic(pkt, flow);
   TEST_ASSERT_EQUAL_MESSAGE(rv, true,
                             "IN_PORT match error.");
-  free(m);
+  OS_M_FREE(m);
 }
 
 void
@@ -164,7 +164,7 @@ test_match_basic_ETH_DST(void) {
   rv = match_basic(pkt, flow);
   TEST_ASSERT_EQUAL_MESSAGE(rv, true,
                             "ETH_DST match error.");
-  free(m);
+  OS_M_FREE(m);
 }
 
 void
@@ -210,7 +210,7 @@ test_match_basic_ETH_DST_W(void) {
   rv = match_basic(pkt, flow);
   TEST_ASSERT_EQUAL_MESSAGE(rv, true,
                             "ETH_DST_W match error.");
-  free(m);
+  OS_M_FREE(m);
 }
 
 void
@@ -260,7 +260,7 @@ test_match_basic_ETH_SRC(void) {
   rv = match_basic(pkt, flow);
   TEST_ASSERT_EQUAL_MESSAGE(rv, true,
                             "ETH_SRC match error.");
-  free(m);
+  OS_M_FREE(m);
 }
 
 void
@@ -306,6 +306,6 @@ test_match_basic_ETH_SRC_W(void) {
   rv = match_basic(pkt, flow);
   TEST_ASSERT_EQUAL_MESSAGE(rv, true,
                             "ETH_SRC_W match error.");
-  free(m);
+  OS_M_FREE(m);
 
 }
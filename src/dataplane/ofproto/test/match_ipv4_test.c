@@ -169,7 +169,7 @@ test_match_basic_IPV4_PROTO(void) {
   rv = match_basic(pkt, flow);
   TEST_ASSERT_EQUAL_MESSAGE(rv, true,
                             "IP_PROTO match(vlan) error.");
-  free(m);
+  OS_M_FREE(m);
 }
 
 void
@@ -228,7 +228,7 @@ test_match_basic_IPV4_SRC(void) {
   rv = match_basic(pkt, flow);
   TEST_ASSERT_EQUAL_MESSAGE(rv, true,
                             "IPV4_SRC match error.");
-  free(m);
+  OS_M_FREE(m);
 }
 
 void
@@ -285,7 +285,7 @@ test_match_basic_IPV4_SRC_W(void) {
   rv = match_basic(pkt, flow);
   TEST_ASSERT_EQUAL_MESSAGE(rv, true,
                             "IPV4_SRC_W match error.");
-  free(m);
+  OS_M_FREE(m);
 }
 
 void
@@ -441,7 +441,7 @@ test_match_basic_IPV4_TCP_SRC(void) {
   rv = match_basic(pkt, flow);
   TEST_ASSERT_EQUAL_MESSAGE(rv, true,
                             "TCP_SRC match error.");
-  free(m);
+  OS_M_FREE(m);
 }
 
 void
@@ -489,7 +489,7 @@ test_match_basic_IPV4_TCP_DST(void) {
   rv = match_basic(pkt, flow);
   TEST_ASSERT_EQUAL_MESSAGE(rv, true,
                             "TCP_DST match error.");
-  free(m);
+  OS_M_FREE(m);
 }
 
 void
@@ -535,7 +535,7 @@ test_match_basic_IPV4_UDP_SRC(void) {
   rv = match_basic(pkt, flow);
   TEST_ASSERT_EQUAL_MESSAGE(rv, true,
                             "UDP_SRC match error.");
-  free(m);
+  OS_M_FREE(m);
 }
 
 void
@@ -583,7 +583,7 @@ test_match_basic_IPV4_UDP_DST(void) {
   rv = match_basic(pkt, flow);
   TEST_ASSERT_EQUAL_MESSAGE(rv, true,
                             "UDP_DST match error.");
-  free(m);
+  OS_M_FREE(m);
 }
 
 void
@@ -629,7 +629,7 @@ test_match_basic_IPV4_SCTP_SRC(void) {
   rv = match_basic(pkt, flow);
   TEST_ASSERT_EQUAL_MESSAGE(rv, true,
                             "SCTP_SRC match error.");
-  free(m);
+  OS_M_FREE(m);
 }
 
 void
@@ -677,7 +677,7 @@ test_match_basic_IPV4_SCTP_DST(void) {
   rv = match_basic(pkt, flow);
   TEST_ASSERT_EQUAL_MESSAGE(rv, true,
                             "SCTP_DST match error.");
-  free(m);
+  OS_M_FREE(m);
 }
 
 void
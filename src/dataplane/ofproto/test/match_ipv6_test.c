@@ -164,7 +164,7 @@ test_match_basic_IPV6_PROTO(void) {
   rv = match_basic(pkt, flow);
   TEST_ASSERT_EQUAL_MESSAGE(rv, true,
                             "IPV6_IP_PROTO match(next hdr) error.");
-  free(m);
+  OS_M_FREE(m);
 }
 
 void
@@ -546,7 +546,7 @@ test_match_basic_IPV6_TCP_SRC(void) {
   rv = match_basic(pkt, flow);
   TEST_ASSERT_EQUAL_MESSAGE(rv, true,
                             "IPV6_TCP_SRC match(next hdr) error.");
-  free(m);
+  OS_M_FREE(m);
 }
 
 void
@@ -603,7 +603,7 @@ test_match_basic_IPV6_TCP_DST(void) {
   rv = match_basic(pkt, flow);
   TEST_ASSERT_EQUAL_MESSAGE(rv, true,
                             "IPV6_TCP_DST match(next hdr) error.");
-  free(m);
+  OS_M_FREE(m);
 }
 
 void
@@ -660,7 +660,7 @@ test_match_basic_IPV6_UDP_SRC(void) {
   rv = match_basic(pkt, flow);
   TEST_ASSERT_EQUAL_MESSAGE(rv, true,
                             "IPV6_UDP_SRC match(next hdr) error.");
-  free(m);
+  OS_M_FREE(m);
 }
 
 void
@@ -717,7 +717,7 @@ test_match_basic_IPV6_UDP_DST(void) {
   rv = match_basic(pkt, flow);
   TEST_ASSERT_EQUAL_MESSAGE(rv, true,
                             "IPV6_UDP_DST match(next hdr) error.");
-  free(m);
+  OS_M_FREE(m);
 }
 
 void
@@ -774,7 +774,7 @@ test_match_basic_IPV6_SCTP_SRC(void) {
   rv = match_basic(pkt, flow);
   TEST_ASSERT_EQUAL_MESSAGE(rv, true,
                             "IPV6_SCTP_SRC match(next hdr) error.");
-  free(m);
+  OS_M_FREE(m);
 }
 
 void
@@ -820,10 +820,10 @@ test_match_basic_IPV6_SCTP_DST(void) {
   OS_MTOD(m, uint8_t *)[20] = IPPROTO_DSTOPTS;
   OS_MTOD(m, uint8_t *)[54] = IPPROTO_SCTP;
   OS_MTOD(m, uint8_t *)[55] = 0;
-  lagopus_packet_init(pkt, m, &port);
-  rv = match_basic(pkt, flow);
   OS_MTOD(m, uint8_t *)[64] = 0x00;
   OS_MTOD(m, uint8_t *)[65] = 0xf0;
+  lagopus_packet_init(pkt, m, &port);
+  rv = match_basic(pkt, flow);
   TEST_ASSERT_EQUAL_MESSAGE(rv, false,
                             "IPV6_SCTP_DST mismatch(next hdr) error.");
   OS_MTOD(m, uint8_t *)[64] = 0xf0;
@@ -831,7 +831,7 @@ test_match_basic_IPV6_SCTP_DST(void) {
   rv = match_basic(pkt, flow);
   TEST_ASSERT_EQUAL_MESSAGE(rv, true,
                             "IPV6_SCTP_DST match(next hdr) error.");
-  free(m);
+  OS_M_FREE(m);
 }
 
 void
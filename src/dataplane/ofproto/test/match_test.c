@@ -37,6 +37,14 @@ tearDown(void) {
   dp_api_fini();
 }
 
+static uint64_t
+table_lookup_count(const struct table *table) {
+  uint64_t lookup, matched;
+
+  table_counter_get(table, &lookup, &matched);
+  return lookup;
+}
+
 void
 test_lagopus_find_flow(void) {
   datastore_bridge_info_t info;
@@ -69,7 +77,7 @@ test_lagopus_find_flow(void) {
   table = flowdb_get_table(pkt->in_port->bridge->flowdb, 0);
   table->userdata = new_flowinfo_eth_type();
   flow = lagopus_find_flow(pkt, table);
-  TEST_ASSERT_EQUAL_MESSAGE(table->lookup_count, 0,
+  TEST_ASSERT_EQUAL_MESSAGE(table_lookup_count(table), 0,
                             "lookup_count(misc) error.");
   TEST_ASSERT_NULL_MESSAGE(flow,
                            "flow(misc) error.");
@@ -77,7 +85,7 @@ test_lagopus_find_flow(void) {
   OS_MTOD(m, uint8_t *)[15] = 0x06;
   lagopus_packet_init(pkt, m, &port);
   flow = lagopus_find_flow(pkt, table);
-  TEST_ASSERT_EQUAL_MESSAGE(table->lookup_count, 0,
+  TEST_ASSERT_EQUAL_MESSAGE(table_lookup_count(table), 0,
                             "lookup_count(arp) error.");
   TEST_ASSERT_NULL_MESSAGE(flow,
                            "flow(arp) error.");
@@ -85,7 +93,7 @@ test_lagopus_find_flow(void) {
   OS_MTOD(m, uint8_t *)[15] = 0x00;
   lagopus_packet_init(pkt, m, port_lookup(&bridge->ports, 1));
   flow = lagopus_find_flow(pkt, table);
-  TEST_ASSERT_EQUAL_MESSAGE(table->lookup_count, 0,
+  TEST_ASSERT_EQUAL_MESSAGE(table_lookup_count(table), 0,
                             "lookup_count(ipv4) error.");
   TEST_ASSERT_NULL_MESSAGE(flow,
                            "flow(ipv4) error.");
@@ -94,7 +102,7 @@ test_lagopus_find_flow(void) {
   OS_MTOD(m, uint8_t *)[20] = IPPROTO_TCP;
   lagopus_packet_init(pkt, m, port_lookup(&bridge->ports, 1));
   flow = lagopus_find_flow(pkt, table);
-  TEST_ASSERT_EQUAL_MESSAGE(table->lookup_count, 0,
+  TEST_ASSERT_EQUAL_MESSAGE(table_lookup_count(table), 0,
                             "lookup_count(ipv6) error.");
   TEST_ASSERT_NULL_MESSAGE(flow,
                            "flow(ipv6) error.");
@@ -102,7 +110,7 @@ test_lagopus_find_flow(void) {
   OS_MTOD(m, uint8_t *)[15] = 0x47;
   lagopus_packet_init(pkt, m, port_lookup(&bridge->ports, 1));
   flow = lagopus_find_flow(pkt, table);
-  TEST_ASSERT_EQUAL_MESSAGE(table->lookup_count, 0,
+  TEST_ASSERT_EQUAL_MESSAGE(table_lookup_count(table), 0,
                             "lookup_count(mpls) error.");
   TEST_ASSERT_NULL_MESSAGE(flow,
                            "flow(mpls) error.");
@@ -110,7 +118,7 @@ test_lagopus_find_flow(void) {
   OS_MTOD(m, uint8_t *)[15] = 0x48;
   lagopus_packet_init(pkt, m, port_lookup(&bridge->ports, 1));
   flow = lagopus_find_flow(pkt, table);
-  TEST_ASSERT_EQUAL_MESSAGE(table->lookup_count, 0,
+  TEST_ASSERT_EQUAL_MESSAGE(table_lookup_count(table), 0,
                             "lookup_count(mpls-mc) error.");
   TEST_ASSERT_NULL_MESSAGE(flow,
                            "flow(mpls-mc) error.");
@@ -118,7 +126,7 @@ test_lagopus_find_flow(void) {
   OS_MTOD(m, uint8_t *)[15] = 0xe7;
   lagopus_packet_init(pkt, m, port_lookup(&bridge->ports, 1));
   flow = lagopus_find_flow(pkt, table);
-  TEST_ASSERT_EQUAL_MESSAGE(table->lookup_count, 0,
+  TEST_ASSERT_EQUAL_MESSAGE(table_lookup_count(table), 0,
                             "lookup_count(pbb) error.");
   TEST_ASSERT_NULL_MESSAGE(flow,
                            "flow(pbb) error.");
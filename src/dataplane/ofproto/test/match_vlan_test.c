@@ -69,7 +69,7 @@ test_match_basic_VLAN_VID(void) {
   rv = match_basic(pkt, flow);
   TEST_ASSERT_EQUAL_MESSAGE(rv, true,
                             "VLAN VID match error.");
-  free(m);
+  OS_M_FREE(m);
 }
 
 void
@@ -108,5 +108,5 @@ test_match_basic_VLAN_VID_W(void) {
   rv = match_basic(pkt, flow);
   TEST_ASSERT_EQUAL_MESSAGE(rv, true,
                             "VLAN VID_W match error.");
-  free(m);
+  OS_M_FREE(m);
 }
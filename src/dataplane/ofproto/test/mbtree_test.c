@@ -72,3 +72,245 @@ test_get_shifted_value(void) {
     TEST_ASSERT_EQUAL(key[i], oxm_value[i]);
   }
 }
+
+#define NFLOWS 64
+
+static struct flow_list *
+alloc_test_flow_list(void) {
+  struct flow_list *flows;
+
+  flows = calloc(1, sizeof(struct flow_list) + sizeof(void *) * 65536);
+  TEST_ASSERT_NOT_NULL(flows);
+  flows->nbranch = 65536;
+  return flows;
+}
+
+static struct flow *
+alloc_ipv4_dst_flow(int priority, uint8_t len, int i) {
+  struct flow *flow;
+
+  flow = allocate_test_flow(10 * sizeof(struct match));
+  TEST_ASSERT_NOT_NULL(flow);
+  flow->priority = priority;
+  add_match(&flow->match_list, 2, OFPXMT_OFB_ETH_TYPE << 1, 0x08, 0x00);
+  if (len == 4) {
+    add_match(&flow->match_list, 4, OFPXMT_OFB_IPV4_DST << 1,
+              10, 0, i >> 8, i & 0xff);
+  } else if (len == 8) {
+    add_match(&flow->match_list, 8, (OFPXMT_OFB_IPV4_DST << 1) + 1,
+              10, 0, 0, 0, 255, 0, 0, 0);
+  }
+  return flow;
+}
+
+static struct lagopus_packet *
+alloc_ipv4_packet(struct port *port) {
+  struct lagopus_packet *pkt;
+  OS_MBUF *m;
+
+  pkt = alloc_lagopus_packet();
+  TEST_ASSERT_NOT_NULL(pkt);
+  m = PKT2MBUF(pkt);
+  OS_M_APPEND(m, 64);
+  OS_MTOD(m, uint8_t *)[12] = 0x08;
+  OS_MTOD(m, uint8_t *)[13] = 0x00;
+  OS_MTOD(m, uint8_t *)[14] = 0x45;
+  OS_MTOD(m, uint8_t *)[23] = IPPROTO_TCP;
+  lagopus_packet_init(pkt, m, port);
+  return pkt;
+}
+
+static void
+set_ipv4_dst(struct lagopus_packet *pkt, uint8_t a, int i) {
+  uint8_t *p;
+
+  p = OS_MTOD(PKT2MBUF(pkt), uint8_t *);
+  p[30] = a;
+  p[31] = 0;
+  p[32] = (uint8_t)(i >> 8);
+  p[33] = (uint8_t)i;
+}
+
+void
+test_add_mbtree(void) {
+  struct flow_list *flows, *garbage;
+  struct flow *flow[NFLOWS], *wildcard;
+  struct lagopus_packet *pkt;
+  struct port port;
+  int i;
+
+  flows = alloc_test_flow_list();
+  pkt = alloc_ipv4_packet(&port);
+  wildcard = alloc_ipv4_dst_flow(1, 0, 0);
+  (void)add_mbtree(flows, wildcard);
+  for (i = 0; i < NFLOWS; i++) {
+    flow[i] = alloc_ipv4_dst_flow(10, 4, i);
+    (void)add_mbtree(flows, flow[i]);
+  }
+  TEST_ASSERT_NOT_EQUAL(flows->rebuild, 0);
+  for (i = 0; i < NFLOWS; i++) {
+    set_ipv4_dst(pkt, 10, i);
+    TEST_ASSERT_TRUE(find_mbtree(pkt, flows) == flow[i]);
+  }
+
+  /* unbalanced subtree is replaced. */
+  garbage = NULL;
+  rebuild_mbtree(flows, &garbage);
+  TEST_ASSERT_NOT_NULL(garbage);
+  TEST_ASSERT_EQUAL(flows->rebuild, 0);
+  TEST_ASSERT_EQUAL(((struct flow_list *)flows->branch[ETHERTYPE_IP])->type,
+                    HASHMAP);
+  free_mbtree(garbage);
+  for (i = 0; i < NFLOWS; i++) {
+    set_ipv4_dst(pkt, 10, i);
+    TEST_ASSERT_TRUE(find_mbtree(pkt, flows) == flow[i]);
+  }
+
+  /* flows without branch field are found in dontcare. */
+  set_ipv4_dst(pkt, 10, NFLOWS);
+  TEST_ASSERT_TRUE(find_mbtree(pkt, flows) == wildcard);
+
+  /* added to the built tree. */
+  flow[0] = alloc_ipv4_dst_flow(10, 4, NFLOWS);
+  (void)add_mbtree(flows, flow[0]);
+  TEST_ASSERT_TRUE(find_mbtree(pkt, flows) == flow[0]);
+
+  cleanup_mbtree(flows);
+  free(flows);
+}
+
+void
+test_del_mbtree(void) {
+  struct flow_list *flows, *garbage;
+  struct flow *flow[NFLOWS], *wildcard;
+  struct lagopus_packet *pkt;
+  struct port port;
+  int i;
+
+  flows = alloc_test_flow_list();
+  pkt = alloc_ipv4_packet(&port);
+  wildcard = alloc_ipv4_dst_flow(1, 0, 0);
+  (void)add_mbtree(flows, wildcard);
+  for (i = 0; i < NFLOWS; i++) {
+    flow[i] = alloc_ipv4_dst_flow(10, 4, i);
+    (void)add_mbtree(flows, flow[i]);
+  }
+  garbage = NULL;
+  rebuild_mbtree(flows, &garbage);
+  free_mbtree(garbage);
+
+  for (i = 0; i < NFLOWS; i += 2) {
+    (void)del_mbtree(flows, flow[i]);
+  }
+  for (i = 0; i < NFLOWS; i++) {
+    set_ipv4_dst(pkt, 10, i);
+    TEST_ASSERT_TRUE(find_mbtree(pkt, flows) ==
+                     ((i % 2 == 0) ? wildcard : flow[i]));
+  }
+
+  /* halved subtree is rebuilt. */
+  TEST_ASSERT_FALSE(del_mbtree(flows, flow[1]));
+  TEST_ASSERT_TRUE(del_mbtree(flows, flow[3]));
+  garbage = NULL;
+  rebuild_mbtree(flows, &garbage);
+  TEST_ASSERT_NOT_NULL(garbage);
+  free_mbtree(garbage);
+  for (i = 5; i < NFLOWS; i += 2) {
+    set_ipv4_dst(pkt, 10, i);
+    TEST_ASSERT_TRUE(find_mbtree(pkt, flows) == flow[i]);
+  }
+
+  /* empty subtree is freed. */
+  for (i = 5; i < NFLOWS; i += 2) {
+    (void)del_mbtree(flows, flow[i]);
+  }
+  (void)del_mbtree(flows, wildcard);
+  TEST_ASSERT_NULL(flows->branch[ETHERTYPE_IP]);
+
+  cleanup_mbtree(flows);
+  free(flows);
+}
+
+void
+test_build_mbtree_masked(void) {
+  struct flow_list *flows;
+  struct flow *flow[NFLOWS], *masked;
+  struct lagopus_packet *pkt;
+  struct port port;
+  int i;
+
+  flows = alloc_test_flow_list();
+  pkt = alloc_ipv4_packet(&port);
+  masked = alloc_ipv4_dst_flow(1, 8, 0);
+  flow_add_sub(masked, flows);
+  for (i = 0; i < NFLOWS; i++) {
+    flow[i] = alloc_ipv4_dst_flow(10, 4, i);
+    flow_add_sub(flow[i], flows);
+  }
+  build_mbtree(flows);
+
+  /* masked field is not a branch. */
+  set_ipv4_dst(pkt, 10, NFLOWS);
+  TEST_ASSERT_TRUE(find_mbtree(pkt, flows) == masked);
+  set_ipv4_dst(pkt, 11, 0);
+  TEST_ASSERT_NULL(find_mbtree(pkt, flows));
+  set_ipv4_dst(pkt, 10, 1);
+  TEST_ASSERT_TRUE(find_mbtree(pkt, flows) == flow[1]);
+
+  cleanup_mbtree(flows);
+  free(flows->flows);
+  free(flows);
+}
+
+void
+test_flowinfo_mbtree(void) {
+  struct flowinfo *flowinfo;
+  struct flow *flow[NFLOWS], *wildcard, *dup;
+  struct lagopus_packet *pkt;
+  struct port port;
+  int32_t prio;
+  int i;
+
+  flowinfo = new_flowinfo_mbtree();
+  TEST_ASSERT_NOT_NULL(flowinfo);
+  pkt = alloc_ipv4_packet(&port);
+  wildcard = alloc_ipv4_dst_flow(1, 0, 0);
+  TEST_ASSERT_EQUAL(flowinfo->add_func(flowinfo, wildcard),
+                    LAGOPUS_RESULT_OK);
+  for (i = 0; i < NFLOWS; i++) {
+    flow[i] = alloc_ipv4_dst_flow(10, 4, i);
+    TEST_ASSERT_EQUAL(flowinfo->add_func(flowinfo, flow[i]),
+                      LAGOPUS_RESULT_OK);
+  }
+  TEST_ASSERT_EQUAL(flowinfo->nflow, NFLOWS + 1);
+
+  /* unbalanced subtree is rebuilt before published. */
+  TEST_ASSERT_EQUAL(MBTREE(flowinfo)->rebuild, 0);
+  for (i = 0; i < NFLOWS; i++) {
+    set_ipv4_dst(pkt, 10, i);
+    prio = -1;
+    TEST_ASSERT_TRUE(flowinfo->match_func(flowinfo, pkt, &prio) == flow[i]);
+    TEST_ASSERT_EQUAL(prio, 10);
+  }
+
+  /* found by the same match and priority. */
+  dup = alloc_ipv4_dst_flow(10, 4, 3);
+  TEST_ASSERT_TRUE(flowinfo->find_func(flowinfo, dup) == flow[3]);
+  TEST_ASSERT_EQUAL(flowinfo->del_func(flowinfo, dup),
+                    LAGOPUS_RESULT_NOT_FOUND);
+  free_test_flow(dup);
+
+  for (i = 0; i < NFLOWS; i += 2) {
+    TEST_ASSERT_EQUAL(flowinfo->del_func(flowinfo, flow[i]),
+                      LAGOPUS_RESULT_OK);
+  }
+  TEST_ASSERT_EQUAL(flowinfo->nflow, NFLOWS / 2 + 1);
+  for (i = 0; i < NFLOWS; i++) {
+    set_ipv4_dst(pkt, 10, i);
+    prio = -1;
+    TEST_ASSERT_TRUE(flowinfo->match_func(flowinfo, pkt, &prio) ==
+                     ((i % 2 == 0) ? wildcard : flow[i]));
+  }
+  TEST_ASSERT_NULL(flowinfo->find_func(flowinfo, flow[0]));
+  flowinfo->destroy_func(flowinfo);
+}
@@ -0,0 +1,234 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/queue.h>
+
+#include "unity.h"
+
+#include "lagopus/flowdb.h"
+#include "lagopus/dataplane.h"
+#include "lagopus/dp_apis.h"
+#include "lagopus/ofcache.h"
+#include "lagopus/datastore/bridge.h"
+#include "pktbuf.h"
+#include "packet.h"
+#include "datapath_test_misc.h"
+
+static struct bridge *bridge;
+static struct flowcache *cache;
+static struct lagopus_packet *pkt;
+
+void
+setUp(void) {
+  datastore_bridge_info_t info;
+  struct port *port;
+
+  TEST_ASSERT_EQUAL(dp_api_init(), LAGOPUS_RESULT_OK);
+  flowinfo_init();
+
+  memset(&info, 0, sizeof(info));
+  info.fail_mode = DATASTORE_BRIDGE_FAIL_MODE_SECURE;
+  TEST_ASSERT_EQUAL(dp_bridge_create("br0", &info), LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(dp_port_create("port0"), LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(dp_bridge_port_set("br0", "port0", 1), LAGOPUS_RESULT_OK);
+  bridge = dp_bridge_lookup("br0");
+  TEST_ASSERT_NOT_NULL(bridge);
+  port = port_lookup(&bridge->ports, 1);
+  TEST_ASSERT_NOT_NULL(port);
+
+  cache = NULL;
+  pkt = alloc_lagopus_packet();
+  TEST_ASSERT_NOT_NULL(pkt);
+  OS_M_APPEND(PKT2MBUF(pkt), 64);
+  lagopus_packet_init(pkt, PKT2MBUF(pkt), port);
+  pkt->hash64 = 0x123456789abcdefULL;
+}
+
+void
+tearDown(void) {
+  lagopus_packet_free(pkt);
+  if (cache != NULL) {
+    fini_flowcache(cache);
+  }
+  TEST_ASSERT_EQUAL(dp_bridge_port_unset("br0", "port0"), LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(dp_port_destroy("port0"), LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(dp_bridge_destroy("br0"), LAGOPUS_RESULT_OK);
+  dp_api_fini();
+}
+
+static void
+in_port_flow_add(uint8_t table_id, uint32_t in_port) {
+  struct ofp_flow_mod flow_mod;
+  struct match_list match_list;
+  struct instruction_list instruction_list;
+  struct ofp_error error;
+
+  TAILQ_INIT(&match_list);
+  TAILQ_INIT(&instruction_list);
+  add_match(&match_list, 4, OFPXMT_OFB_IN_PORT << 1,
+            (in_port >> 24) & 0xff, (in_port >> 16) & 0xff,
+            (in_port >> 8) & 0xff, in_port & 0xff);
+  memset(&flow_mod, 0, sizeof(flow_mod));
+  flow_mod.command = OFPFC_ADD;
+  flow_mod.table_id = table_id;
+  flow_mod.priority = 1;
+  flow_mod.out_port = OFPP_ANY;
+  flow_mod.out_group = OFPG_ANY;
+  TEST_ASSERT_EQUAL(flowdb_flow_add(bridge, &flow_mod, &match_list,
+                                    &instruction_list, &error),
+                    LAGOPUS_RESULT_OK);
+}
+
+static void
+cache_create(int kvs_type) {
+  cache = init_flowcache(kvs_type);
+  TEST_ASSERT_NOT_NULL(cache);
+  pkt->cache = cache;
+}
+
+/* register the flow of table 0 matched by the packet. */
+static void
+register_table0_flow(void) {
+  struct table *table;
+  const struct flow *flow;
+  uint32_t generation;
+
+  table = table_lookup(bridge->flowdb, 0);
+  TEST_ASSERT_NOT_NULL(table);
+  generation = table->generation;
+  flow = lagopus_find_flow(pkt, table);
+  TEST_ASSERT_NOT_NULL(flow);
+  register_cache(cache, pkt->hash64, 1, &flow, &generation);
+}
+
+static void
+flowcache_hit(int kvs_type) {
+  struct cache_entry *cache_entry;
+  struct ofcachestat st;
+
+  cache_create(kvs_type);
+  in_port_flow_add(0, 1);
+  register_table0_flow();
+  cache_entry = cache_lookup(cache, pkt);
+  TEST_ASSERT_NOT_NULL(cache_entry);
+  TEST_ASSERT_EQUAL(cache_entry->nmatched, 1);
+  TEST_ASSERT_EQUAL(cache_entry->table_id[0], 0);
+  get_flowcache_statistics(cache, &st);
+  TEST_ASSERT_EQUAL(st.nentries, 1);
+  TEST_ASSERT_EQUAL(st.hit, 1);
+  TEST_ASSERT_EQUAL(st.invalidated, 0);
+}
+
+static void
+flowcache_other_table_changed(int kvs_type) {
+  struct ofcachestat st;
+
+  cache_create(kvs_type);
+  in_port_flow_add(0, 1);
+  register_table0_flow();
+  /* changes of the table not referred keep the entry. */
+  in_port_flow_add(1, 2);
+  TEST_ASSERT_NOT_NULL(cache_lookup(cache, pkt));
+  get_flowcache_statistics(cache, &st);
+  TEST_ASSERT_EQUAL(st.nentries, 1);
+  TEST_ASSERT_EQUAL(st.invalidated, 0);
+}
+
+static void
+flowcache_referred_table_changed(int kvs_type) {
+  struct ofcachestat st;
+
+  cache_create(kvs_type);
+  in_port_flow_add(0, 1);
+  register_table0_flow();
+  in_port_flow_add(0, 2);
+  TEST_ASSERT_NULL(cache_lookup(cache, pkt));
+  get_flowcache_statistics(cache, &st);
+  TEST_ASSERT_EQUAL(st.nentries, 0);
+  TEST_ASSERT_TRUE(st.miss >= 1);
+  TEST_ASSERT_EQUAL(st.invalidated, 1);
+
+  /* registered again with new generation. */
+  register_table0_flow();
+  TEST_ASSERT_NOT_NULL(cache_lookup(cache, pkt));
+}
+
+void
+test_flowcache_hashmap_hit(void) {
+  flowcache_hit(FLOWCACHE_HASHMAP_NOLOCK);
+}
+
+void
+test_flowcache_hashmap_other_table_changed(void) {
+  flowcache_other_table_changed(FLOWCACHE_HASHMAP_NOLOCK);
+}
+
+void
+test_flowcache_hashmap_referred_table_changed(void) {
+  flowcache_referred_table_changed(FLOWCACHE_HASHMAP_NOLOCK);
+}
+
+void
+test_flowcache_cuckoo_hit(void) {
+  flowcache_hit(FLOWCACHE_CUCKOO);
+}
+
+void
+test_flowcache_cuckoo_other_table_changed(void) {
+  flowcache_other_table_changed(FLOWCACHE_CUCKOO);
+}
+
+void
+test_flowcache_cuckoo_referred_table_changed(void) {
+  flowcache_referred_table_changed(FLOWCACHE_CUCKOO);
+}
+
+void
+test_flowcache_cuckoo_replace(void) {
+  struct ofcachestat st;
+  uint64_t i, n;
+
+  cache_create(FLOWCACHE_CUCKOO);
+  in_port_flow_add(0, 1);
+  /* twice of capacity, old entries are replaced. */
+  n = 2 * 65536;
+  for (i = 1; i <= n; i++) {
+    pkt->hash64 = i * 0x9e3779b97f4a7c15ULL;
+    register_table0_flow();
+  }
+  get_flowcache_statistics(cache, &st);
+  TEST_ASSERT_TRUE(st.nentries <= 65536);
+  TEST_ASSERT_TRUE(st.nentries >= 65536 / 2);
+  /* the last one is always found. */
+  TEST_ASSERT_NOT_NULL(cache_lookup(cache, pkt));
+  /* same key is registered once. */
+  register_table0_flow();
+  get_flowcache_statistics(cache, &st);
+  TEST_ASSERT_TRUE(st.nentries <= 65536);
+}
+
+void
+test_flowcache_cuckoo_clear(void) {
+  struct ofcachestat st;
+
+  cache_create(FLOWCACHE_CUCKOO);
+  in_port_flow_add(0, 1);
+  register_table0_flow();
+  clear_all_cache(cache);
+  TEST_ASSERT_NULL(cache_lookup(cache, pkt));
+  get_flowcache_statistics(cache, &st);
+  TEST_ASSERT_EQUAL(st.nentries, 0);
+}
@@ -16,57 +16,260 @@
 
 #include "unity.h"
 
+#include "lagopus/dp_apis.h"
+#include "lagopus/dataplane.h"
+#include "lagopus/flowdb.h"
+#include "lagopus/port.h"
+#include "pktbuf.h"
+#include "packet.h"
+
+#include "datapath_test_misc.h"
+
 #include "thtable.c"
 
-thtable_t thtable;
+#define NFLOWS 64
+
+static struct flowinfo *flowinfo;
+static struct lagopus_packet *pkt;
+static struct port port;
 
 void
 setUp(void) {
+  OS_MBUF *m;
+
   TEST_ASSERT_EQUAL(dp_api_init(), LAGOPUS_RESULT_OK);
-  thtable = thtable_alloc();
-  TEST_ASSERT_NOT_NULL(thtable);
+  flowinfo = new_flowinfo_thtable();
+  TEST_ASSERT_NOT_NULL(flowinfo);
+
+  pkt = alloc_lagopus_packet();
+  TEST_ASSERT_NOT_NULL(pkt);
+  m = PKT2MBUF(pkt);
+  OS_M_APPEND(m, 64);
+  OS_MTOD(m, uint8_t *)[12] = 0x08;
+  OS_MTOD(m, uint8_t *)[13] = 0x00;
+  OS_MTOD(m, uint8_t *)[14] = 0x45;
+  OS_MTOD(m, uint8_t *)[23] = IPPROTO_TCP;
+  lagopus_packet_init(pkt, m, &port);
 }
 
 void
 tearDown(void) {
-  TEST_ASSERT_NOT_NULL(thtable);
-  thtable_free(thtable);
+  flowinfo->destroy_func(flowinfo);
+  lagopus_packet_free(pkt);
   dp_api_fini();
 }
 
+/*
+ * IPv4 flow to 10.0.i.0/plen, and TCP destination port if not 0.
+ */
+static struct flow *
+alloc_acl_flow(int priority, int i, int plen, uint16_t dport) {
+  struct flow *flow;
+  uint32_t mask;
+
+  flow = allocate_test_flow(10 * sizeof(struct match));
+  TEST_ASSERT_NOT_NULL(flow);
+  flow->priority = priority;
+  add_match(&flow->match_list, 2, OFPXMT_OFB_ETH_TYPE << 1, 0x08, 0x00);
+  if (plen != 0) {
+    mask = (uint32_t)~0 << (32 - plen);
+    add_match(&flow->match_list, 8, (OFPXMT_OFB_IPV4_DST << 1) + 1,
+              10, 0, i & 0xff, 0,
+              mask >> 24, (mask >> 16) & 0xff, (mask >> 8) & 0xff,
+              mask & 0xff);
+  }
+  if (dport != 0) {
+    add_match(&flow->match_list, 1, OFPXMT_OFB_IP_PROTO << 1, IPPROTO_TCP);
+    add_match(&flow->match_list, 2, OFPXMT_OFB_TCP_DST << 1,
+              dport >> 8, dport & 0xff);
+  }
+  return flow;
+}
+
+static void
+set_packet(uint8_t a, int i, uint16_t dport) {
+  uint8_t *p;
+
+  p = OS_MTOD(PKT2MBUF(pkt), uint8_t *);
+  p[30] = a;
+  p[31] = 0;
+  p[32] = (uint8_t)i;
+  p[33] = 1;
+  p[36] = (uint8_t)(dport >> 8);
+  p[37] = (uint8_t)dport;
+}
+
+static struct flow *
+lookup(void) {
+  int32_t prio;
+
+  prio = -1;
+  return flowinfo->match_func(flowinfo, pkt, &prio);
+}
+
 void
-test_htlist_alloc(void) {
-  struct htlist *htlist;
-  int i;
+test_thtable_stage(void) {
+  struct thtable_stage stage;
+  uint32_t i;
 
-  for (i = 32767; i >= 0; i--) {
-    htlist = htlist_alloc(i);
-    TEST_ASSERT_NOT_NULL(htlist);
-    TEST_ASSERT_EQUAL(htlist->priority, i);
-    TEST_ASSERT_EQUAL(htlist->ntable, 0);
-    htlist_free(htlist);
+  TEST_ASSERT_EQUAL(thtable_stage_init(&stage, THTABLE_INITIAL_SIZE),
+                    LAGOPUS_RESULT_OK);
+  /* colliding hashes are kept reachable on grow and delete. */
+  for (i = 0; i < 100; i++) {
+    TEST_ASSERT_EQUAL(thtable_stage_add(&stage, i << 8), LAGOPUS_RESULT_OK);
+  }
+  TEST_ASSERT_EQUAL(thtable_stage_add(&stage, 0), LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(stage.count, 100);
+  TEST_ASSERT_TRUE(stage.size >= 200);
+  for (i = 0; i < 100; i += 2) {
+    thtable_stage_del(&stage, i << 8);
   }
+  for (i = 0; i < 100; i++) {
+    TEST_ASSERT_EQUAL(thtable_stage_find(&stage, i << 8),
+                      (i % 2 == 1 || i == 0) ? true : false);
+  }
+  thtable_stage_del(&stage, 0);
+  TEST_ASSERT_FALSE(thtable_stage_find(&stage, 0));
+  TEST_ASSERT_EQUAL(stage.count, 50);
+  free(stage.slots);
 }
 
 void
-test_htable_alloc(void) {
-  struct htable *htable;
+test_thtable_add_del(void) {
+  struct thtable *thtable;
+  struct flow *flow[NFLOWS];
+  int i;
 
-  htable = htable_alloc();
-  TEST_ASSERT_NOT_NULL(htable);
-  TEST_ASSERT_NOT_NULL(htable->hashmap);
-  htable_free(htable);
+  thtable = THTABLE(flowinfo);
+  for (i = 0; i < NFLOWS; i++) {
+    /* 4 masks. */
+    flow[i] = alloc_acl_flow(i, i, (i % 2) ? 24 : 16, (i % 4) < 2 ? 0 : 80);
+    TEST_ASSERT_EQUAL(flowinfo->add_func(flowinfo, flow[i]),
+                      LAGOPUS_RESULT_OK);
+  }
+  TEST_ASSERT_EQUAL(flowinfo->nflow, NFLOWS);
+  TEST_ASSERT_EQUAL(thtable->nsubtable, 4);
+  for (i = 1; i < thtable->nsubtable; i++) {
+    TEST_ASSERT_TRUE(thtable->subtables[i - 1]->max_priority >=
+                     thtable->subtables[i]->max_priority);
+    TEST_ASSERT_EQUAL(thtable->subtables[i]->pos, i);
+  }
+  TEST_ASSERT_EQUAL(thtable->subtables[0]->max_priority, NFLOWS - 1);
+
+  /* max priority is recalculated. */
+  TEST_ASSERT_EQUAL(flowinfo->del_func(flowinfo, flow[NFLOWS - 1]),
+                    LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(flowinfo->del_func(flowinfo, flow[NFLOWS - 1]),
+                    LAGOPUS_RESULT_NOT_FOUND);
+  TEST_ASSERT_EQUAL(thtable->subtables[0]->max_priority, NFLOWS - 2);
+  TEST_ASSERT_EQUAL(thtable->subtables[3]->max_priority, NFLOWS - 5);
+
+  /* empty subtable is removed. */
+  for (i = 0; i < NFLOWS - 1; i++) {
+    if ((i % 4) == 3) {
+      TEST_ASSERT_EQUAL(flowinfo->del_func(flowinfo, flow[i]),
+                        LAGOPUS_RESULT_OK);
+    }
+  }
+  TEST_ASSERT_EQUAL(thtable->nsubtable, 3);
+  TEST_ASSERT_EQUAL(flowinfo->nflow, NFLOWS - NFLOWS / 4);
+  for (i = 0; i < NFLOWS; i++) {
+    free_test_flow(flow[i]);
+  }
 }
 
 void
-test_thtable_add_htlist(void) {
-  struct htlist *htlist;
+test_thtable_match(void) {
+  struct flow *any, *net, *host[NFLOWS], *web;
   int i;
 
-  for (i = 0; i < 32768; i++) {
-    htlist = htlist_alloc(i);
-    TEST_ASSERT_NOT_NULL(htlist);
-    thtable_add_htlist(thtable, htlist);
-    TEST_ASSERT_EQUAL(thtable[htlist->priority], htlist);
+  any = alloc_acl_flow(1, 0, 0, 0);
+  net = alloc_acl_flow(10, 0, 8, 0);
+  web = alloc_acl_flow(30, 0, 8, 80);
+  TEST_ASSERT_EQUAL(flowinfo->add_func(flowinfo, any), LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(flowinfo->add_func(flowinfo, net), LAGOPUS_RESULT_OK);
+  TEST_ASSERT_EQUAL(flowinfo->add_func(flowinfo, web), LAGOPUS_RESULT_OK);
+  for (i = 0; i < NFLOWS; i++) {
+    host[i] = alloc_acl_flow(20, i, 24, 0);
+    TEST_ASSERT_EQUAL(flowinfo->add_func(flowinfo, host[i]),
+                      LAGOPUS_RESULT_OK);
+  }
+  for (i = 0; i < NFLOWS; i++) {
+    set_packet(10, i, 22);
+    TEST_ASSERT_TRUE(lookup() == host[i]);
+    set_packet(10, i, 80);
+    TEST_ASSERT_TRUE(lookup() == web);
+  }
+  set_packet(10, NFLOWS, 22);
+  TEST_ASSERT_TRUE(lookup() == net);
+  set_packet(11, 0, 80);
+  TEST_ASSERT_TRUE(lookup() == any);
+
+  /* lower priority flow of the same value. */
+  TEST_ASSERT_EQUAL(flowinfo->del_func(flowinfo, host[0]), LAGOPUS_RESULT_OK);
+  host[0]->priority = 5;
+  TEST_ASSERT_EQUAL(flowinfo->add_func(flowinfo, host[0]), LAGOPUS_RESULT_OK);
+  set_packet(10, 0, 22);
+  TEST_ASSERT_TRUE(lookup() == net);
+  TEST_ASSERT_EQUAL(flowinfo->del_func(flowinfo, net), LAGOPUS_RESULT_OK);
+  TEST_ASSERT_TRUE(lookup() == host[0]);
+  TEST_ASSERT_EQUAL(flowinfo->del_func(flowinfo, host[0]), LAGOPUS_RESULT_OK);
+  TEST_ASSERT_TRUE(lookup() == any);
+  TEST_ASSERT_EQUAL(flowinfo->del_func(flowinfo, any), LAGOPUS_RESULT_OK);
+  TEST_ASSERT_NULL(lookup());
+
+  /* not IPv4. */
+  TEST_ASSERT_EQUAL(flowinfo->add_func(flowinfo, any), LAGOPUS_RESULT_OK);
+  pkt->ether_type = ETHERTYPE_IPV6;
+  TEST_ASSERT_NULL(lookup());
+
+  free_test_flow(any);
+  free_test_flow(net);
+  free_test_flow(web);
+  for (i = 0; i < NFLOWS; i++) {
+    free_test_flow(host[i]);
   }
 }
+
+void
+test_thtable_stage_skip(void) {
+  struct thtable_subtable *subtable;
+  struct flow *flow;
+
+  flow = alloc_acl_flow(10, 1, 24, 80);
+  TEST_ASSERT_EQUAL(flowinfo->add_func(flowinfo, flow), LAGOPUS_RESULT_OK);
+  subtable = THTABLE(flowinfo)->subtables[0];
+
+  /* ETH_TYPE in L2, IPV4_DST and IP_PROTO in L3, TCP_DST in L4. */
+  TEST_ASSERT_EQUAL(subtable->nword, 4);
+  TEST_ASSERT_EQUAL(subtable->stage_end[0], 1);
+  TEST_ASSERT_EQUAL(subtable->stage_end[1], 3);
+  TEST_ASSERT_EQUAL(subtable->stage_end[2], 4);
+  TEST_ASSERT_NOT_EQUAL(subtable->stages[0].size, 0);
+  TEST_ASSERT_NOT_EQUAL(subtable->stages[1].size, 0);
+  TEST_ASSERT_EQUAL(subtable->stages[2].size, 0);
+
+  set_packet(10, 1, 80);
+  TEST_ASSERT_TRUE(thtable_subtable_match(subtable, pkt, -1) == flow);
+  TEST_ASSERT_NULL(thtable_subtable_match(subtable, pkt, 10));
+  set_packet(10, 2, 80);
+  TEST_ASSERT_NULL(thtable_subtable_match(subtable, pkt, -1));
+  set_packet(10, 1, 81);
+  TEST_ASSERT_NULL(thtable_subtable_match(subtable, pkt, -1));
+  free_test_flow(flow);
+}
+
+void
+test_thtable_find(void) {
+  struct flow *flow, *same, *other;
+
+  flow = alloc_acl_flow(10, 1, 24, 80);
+  same = alloc_acl_flow(10, 1, 24, 80);
+  other = alloc_acl_flow(11, 1, 24, 80);
+  TEST_ASSERT_EQUAL(flowinfo->add_func(flowinfo, flow), LAGOPUS_RESULT_OK);
+  TEST_ASSERT_TRUE(flowinfo->find_func(flowinfo, same) == flow);
+  TEST_ASSERT_NULL(flowinfo->find_func(flowinfo, other));
+  free_test_flow(flow);
+  free_test_flow(same);
+  free_test_flow(other);
+}
@@ -14,488 +14,916 @@
  * limitations under the License.
  */
 
+/**
+ *      @file   thtable.c
+ *      @brief  Tuple space search classifier.
+ *
+ * Flows are grouped into subtables by their mask.  A subtable is a
+ * hash table of masked match values, flows of the same value are
+ * sorted by priority.  Subtables are sorted by max priority of their
+ * flows, lookup stops when the matched flow has higher priority than
+ * rest of subtables.
+ *
+ * Match values are 32bit words of byteoff_match made by
+ * flow_make_match(), ordered by stage (L2, L3 and L4).  Each subtable
+ * has partial hashes of its flows up to the stage, lookup skips the
+ * subtable at the first stage no flow matches.
+ */
+
+#include "lagopus_config.h"
+
 #include <inttypes.h>
+#include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/types.h>
 #include <sys/queue.h>
 
-#include <lagopus_apis.h>
-#include <lagopus/dp_apis.h>
-#include <lagopus/flowdb.h>
+#include <openflow.h>
 
-#include "City.h"
+#include "lagopus_apis.h"
+#include "lagopus/ethertype.h"
+#include "lagopus/flowdb.h"
 #include "pktbuf.h"
 #include "packet.h"
-
+#include "counter.h"
 #include "thtable.h"
 
-#define DEBUG 0
-#if DEBUG > 0
-#define DPRINTF(...) printf(__VA_ARGS__)
-#else
-#define DPRINTF(...)
-#endif /* DEBUG */
-#if DEBUG > 1
-#define DDPRINTF(...) printf(__VA_ARGS__)
-#else
-#define DDPRINTF(...)
-#endif /* DEBUG */
-#if DEBUG > 2
-#define DDDPRINTF(...) printf(__VA_ARGS__)
-#else
-#define DDDPRINTF(...)
-#endif /* DEBUG */
-
-#define OXM_FIELD_TYPE(field) ((field) >> 1)
-#define OXM_FIELD_HAS_MASK(field) (((field) & 1) != 0)
-#define OXM_MATCH_VALUE_LEN(match) \
-  ((match)->oxm_length >> ((match)->oxm_field & 1))
-
-struct htable {
-  struct match_list match_list; /* for flow */
-  struct match_list mask_list; /* for packet */
-  lagopus_hashmap_t hashmap;
-#if DEBUG > 1
-  int nflow;
-#endif /* DEBUG */
+#include "lagopus/flowinfo.h"
+
+#define THTABLE_INITIAL_SIZE 16
+
+#define THTABLE(self) ((struct thtable *)(uintptr_t)(self)->userdata)
+
+/* bases of packet in lookup order, and their stage. */
+static const struct {
+  uint8_t base;
+  uint8_t stage;
+} thtable_bases[] = {
+  { THTABLE_ETH_TYPE, 0 },
+  { OOB_BASE, 0 },
+  { OOB2_BASE, 0 },
+  { ETH_BASE, 0 },
+  { PBB_BASE, 0 },
+  { MPLS_BASE, 1 },
+  { L3_BASE, 1 },
+  { IPPROTO_BASE, 1 },
+  { V6SRC_BASE, 1 },
+  { V6DST_BASE, 1 },
+  { L4_BASE, 2 },
+  { L4P_BASE, 2 },
+  { NDSLL_BASE, 2 },
+  { NDTLL_BASE, 2 }
 };
 
-struct htlist {
-  uint16_t priority;
-  int ntable;
-  struct htable *tables[8]; /* preliminary */
+/**
+ * @brief Flows of the same masked match value.
+ */
+struct thtable_entry {
+  struct thtable_entry *next;   /** Next entry in the bucket. */
+  uint32_t hash;                /** Hash of the key. */
+  int nflow;                    /** Number of flows. */
+  struct flow **flows;          /** Flows sorted by priority. */
+  uint32_t key[0];              /** Masked match value. */
 };
 
-#define calc_hash CityHash64WithSeed
+/**
+ * @brief Partial hash of flows up to the stage.
+ */
+struct thtable_slot {
+  uint32_t hash;                /** Partial hash. */
+  uint32_t refs;                /** Number of entries, 0 if empty. */
+};
 
-static struct htable *
-htable_alloc(void) {
-  struct htable *htable;
+struct thtable_stage {
+  uint32_t size;                /** Number of slots, 0 if not indexed. */
+  uint32_t count;               /** Number of used slots. */
+  struct thtable_slot *slots;   /** Open addressing slots. */
+};
 
-  htable = calloc(1, sizeof(struct htable));
-  if (htable != NULL) {
-    lagopus_hashmap_create(&htable->hashmap, LAGOPUS_HASHMAP_TYPE_ONE_WORD,
-                           NULL);
-    TAILQ_INIT(&htable->match_list);
-    TAILQ_INIT(&htable->mask_list);
-  }
-  return htable;
-}
+/**
+ * @brief Flows of the same mask.
+ */
+struct thtable_subtable {
+  struct thtable_subtable *next;        /** Next subtable of mask hash. */
+  uint32_t mask_hash;           /** Hash of the mask. */
+  int pos;                      /** Index in sorted subtables. */
+  int32_t max_priority;         /** Max priority of flows. */
+  int nmax;                     /** Number of flows of max priority. */
+  int nflow;                    /** Number of flows. */
+  uint32_t nentry;              /** Number of entries. */
+  uint32_t size;                /** Number of buckets, power of 2. */
+  struct thtable_entry **buckets;       /** Entries by hash. */
+  struct thtable_stage stages[THTABLE_STAGES];  /** Stage indexes. */
+  int stage_end[THTABLE_STAGES];        /** End of words of the stage. */
+  int nword;                    /** Number of words. */
+  struct thtable_word words[0]; /** Mask. */
+};
+
+/**
+ * @brief Tuple space search classifier.
+ */
+struct thtable {
+  int nsubtable;                /** Number of subtables. */
+  int nalloc;                   /** Allocated size of subtables. */
+  struct thtable_subtable **subtables;  /** Sorted by max priority. */
+  uint32_t size;                /** Number of mask buckets, power of 2. */
+  struct thtable_subtable **masks;      /** Subtables by mask hash. */
+};
 
+static lagopus_result_t
+add_flow_thtable(struct flowinfo *, struct flow *);
+static lagopus_result_t
+del_flow_thtable(struct flowinfo *, struct flow *);
+static struct flow *
+match_flow_thtable(struct flowinfo *, struct lagopus_packet *, int32_t *);
+static struct flow *
+find_flow_thtable(struct flowinfo *, struct flow *);
 static void
-htable_free(struct htable *htable) {
-  lagopus_hashmap_destroy(&htable->hashmap, false);
-  match_list_entry_free(&htable->match_list);
-  match_list_entry_free(&htable->mask_list);
-  free(htable);
+destroy_flowinfo_thtable(struct flowinfo *);
+
+/*
+ * stage index, partial hashes are referred by entries of the subtable.
+ */
+static inline bool
+thtable_stage_find(const struct thtable_stage *stage, uint32_t hash) {
+  uint32_t i;
+
+  for (i = hash & (stage->size - 1);
+       stage->slots[i].refs != 0;
+       i = (i + 1) & (stage->size - 1)) {
+    if (stage->slots[i].hash == hash) {
+      return true;
+    }
+  }
+  return false;
 }
 
-static struct htlist *
-htlist_alloc(uint16_t priority) {
-  struct htlist *htlist;
+static lagopus_result_t
+thtable_stage_init(struct thtable_stage *stage, uint32_t size) {
+  stage->slots = calloc(size, sizeof(struct thtable_slot));
+  if (stage->slots == NULL) {
+    return LAGOPUS_RESULT_NO_MEMORY;
+  }
+  stage->size = size;
+  stage->count = 0;
+  return LAGOPUS_RESULT_OK;
+}
 
-  htlist = calloc(1, sizeof(struct htlist));
-  if (htlist != NULL) {
-    htlist->priority = priority;
+static lagopus_result_t
+thtable_stage_add(struct thtable_stage *stage, uint32_t hash) {
+  struct thtable_slot *slots;
+  uint32_t i, j, size;
+
+  if ((stage->count + 1) * 2 > stage->size) {
+    slots = stage->slots;
+    size = stage->size;
+    if (thtable_stage_init(stage, size * 2) != LAGOPUS_RESULT_OK) {
+      stage->slots = slots;
+      stage->size = size;
+      return LAGOPUS_RESULT_NO_MEMORY;
+    }
+    for (i = 0; i < size; i++) {
+      if (slots[i].refs == 0) {
+        continue;
+      }
+      for (j = slots[i].hash & (stage->size - 1);
+           stage->slots[j].refs != 0;
+           j = (j + 1) & (stage->size - 1)) {
+        continue;
+      }
+      stage->slots[j] = slots[i];
+      stage->count++;
+    }
+    free(slots);
+  }
+  for (i = hash & (stage->size - 1);
+       stage->slots[i].refs != 0;
+       i = (i + 1) & (stage->size - 1)) {
+    if (stage->slots[i].hash == hash) {
+      stage->slots[i].refs++;
+      return LAGOPUS_RESULT_OK;
+    }
   }
-  return htlist;
+  stage->slots[i].hash = hash;
+  stage->slots[i].refs = 1;
+  stage->count++;
+  return LAGOPUS_RESULT_OK;
 }
 
 static void
-htlist_free(struct htlist *htlist) {
-  int i;
+thtable_stage_del(struct thtable_stage *stage, uint32_t hash) {
+  uint32_t i, j, home, mask;
 
-  for (i = 0; i < htlist->ntable; i++) {
-    htable_free(htlist->tables[i]);
+  mask = stage->size - 1;
+  for (i = hash & mask; stage->slots[i].refs != 0; i = (i + 1) & mask) {
+    if (stage->slots[i].hash == hash) {
+      break;
+    }
+  }
+  if (stage->slots[i].refs == 0 || --stage->slots[i].refs != 0) {
+    return;
+  }
+  /* move following slots back to keep probe sequences. */
+  for (j = (i + 1) & mask; stage->slots[j].refs != 0; j = (j + 1) & mask) {
+    home = stage->slots[j].hash & mask;
+    if (((j - home) & mask) >= ((j - i) & mask)) {
+      stage->slots[i] = stage->slots[j];
+      i = j;
+    }
   }
-  free(htlist);
+  stage->slots[i].refs = 0;
+  stage->count--;
 }
 
-thtable_t
-thtable_alloc(void) {
-  thtable_t thtable;
+bool
+thtable_flow_eth_type(struct flow *flow, uint32_t *eth_type) {
+  struct match *match;
+  uint16_t val;
+
+  TAILQ_FOREACH(match, &flow->match_list, entry) {
+    if (match->oxm_field == (OFPXMT_OFB_ETH_TYPE << 1)) {
+      if (eth_type != NULL) {
+        memcpy(&val, match->oxm_value, sizeof(val));
+        *eth_type = OS_NTOHS(val);
+      }
+      return true;
+    }
+  }
+  return false;
+}
 
-  thtable = calloc(THTABLE_INDEX_MAX + 1, sizeof(struct htlist *));
-  return thtable;
+int
+thtable_flow_mask(struct flow *flow, struct thtable_word *words,
+                  int *stage_end) {
+  const struct byteoff_match *byteoff;
+  uint32_t mask;
+  size_t i;
+  int n, off;
+  uint8_t base;
+
+  n = 0;
+  for (i = 0; i < sizeof(thtable_bases) / sizeof(thtable_bases[0]); i++) {
+    base = thtable_bases[i].base;
+    if (base == THTABLE_ETH_TYPE) {
+      if (thtable_flow_eth_type(flow, NULL) == true) {
+        words[n].base = base;
+        words[n].off = 0;
+        words[n].mask = 0xffff;
+        n++;
+      }
+    } else {
+      byteoff = &flow->byteoff_match[base];
+      for (off = 0; off < 32; off += 4) {
+        if (((byteoff->bits >> off) & 0x0f) == 0) {
+          continue;
+        }
+        memcpy(&mask, &byteoff->masks[off], sizeof(mask));
+        if (mask == 0) {
+          continue;
+        }
+        words[n].base = base;
+        words[n].off = (uint8_t)off;
+        words[n].mask = mask;
+        n++;
+      }
+    }
+    stage_end[thtable_bases[i].stage] = n;
+  }
+  return n;
 }
 
-void
-thtable_free(thtable_t thtable) {
+static uint32_t
+thtable_mask_hash(const struct thtable_word *words, int nword) {
+  uint32_t hash;
   int i;
 
-  if (thtable != NULL) {
-    for (i = 0; i <= THTABLE_INDEX_MAX; i++) {
-      struct htlist *htlist;
+  hash = (uint32_t)nword;
+  for (i = 0; i < nword; i++) {
+    hash = thtable_hash_add(hash,
+                            (uint32_t)words[i].base << 8 | words[i].off);
+    hash = thtable_hash_add(hash, words[i].mask);
+  }
+  return thtable_hash_finish(hash);
+}
+
+static bool
+thtable_mask_equal(const struct thtable_subtable *subtable,
+                   const struct thtable_word *words, int nword) {
+  int i;
 
-      htlist = thtable[i];
-      if (htlist != NULL) {
-        htlist_free(htlist);
-      }
+  if (subtable->nword != nword) {
+    return false;
+  }
+  for (i = 0; i < nword; i++) {
+    if (subtable->words[i].base != words[i].base ||
+        subtable->words[i].off != words[i].off ||
+        subtable->words[i].mask != words[i].mask) {
+      return false;
     }
-    free(thtable);
   }
+  return true;
 }
 
+/*
+ * make masked match value of the flow and hashes up to each stage.
+ */
 static void
-thtable_add_htlist(thtable_t thtable, struct htlist *htlist) {
-  thtable[htlist->priority] = htlist;
+thtable_flow_key(struct flow *flow, const struct thtable_subtable *subtable,
+                 uint32_t *key, uint32_t *hashes) {
+  const struct thtable_word *word;
+  uint32_t hash;
+  int i, stage;
+
+  hash = 0;
+  i = 0;
+  for (stage = 0; stage < THTABLE_STAGES; stage++) {
+    for (; i < subtable->stage_end[stage]; i++) {
+      word = &subtable->words[i];
+      thtable_flow_word(flow, word, &key[i]);
+      hash = thtable_hash_add(hash, key[i]);
+    }
+    hashes[stage] = thtable_hash_finish(hash);
+  }
 }
 
-static struct htlist *
-thtable_get_htlist(thtable_t thtable, int priority) {
-  return thtable[priority];
+static inline struct thtable_entry *
+thtable_entry_lookup(const struct thtable_subtable *subtable,
+                     const uint32_t *key, uint32_t hash) {
+  struct thtable_entry *entry;
+
+  for (entry = subtable->buckets[hash & (subtable->size - 1)];
+       entry != NULL;
+       entry = entry->next) {
+    if (entry->hash == hash &&
+        memcmp(entry->key, key,
+               sizeof(uint32_t) * (size_t)subtable->nword) == 0) {
+      return entry;
+    }
+  }
+  return NULL;
 }
 
-static int
-thtable_cmp(void *a, void *b) {
-  struct htlist *ta, *tb;
-
-  ta = *(struct htlist **)a;
-  tb = *(struct htlist **)b;
-  if (ta == NULL) {
-    return 1;
+static inline struct flow *
+thtable_subtable_match(const struct thtable_subtable *subtable,
+                       const struct lagopus_packet *pkt, int32_t pri) {
+  const struct thtable_entry *entry;
+  uint32_t key[THTABLE_WORDS];
+  uint32_t hash;
+  int i, stage;
+
+  hash = 0;
+  i = 0;
+  for (stage = 0; stage < THTABLE_STAGES; stage++) {
+    for (; i < subtable->stage_end[stage]; i++) {
+      if (thtable_packet_word(pkt, &subtable->words[i], &key[i]) == false) {
+        return NULL;
+      }
+      hash = thtable_hash_add(hash, key[i]);
+    }
+    if (subtable->stages[stage].size != 0 &&
+        thtable_stage_find(&subtable->stages[stage],
+                           thtable_hash_finish(hash)) == false) {
+      return NULL;
+    }
   }
-  if (tb == NULL) {
-    return -1;
+  entry = thtable_entry_lookup(subtable, key, thtable_hash_finish(hash));
+  if (entry != NULL && entry->flows[0]->priority > pri) {
+    return entry->flows[0];
   }
-  return tb->priority - ta->priority;
+  return NULL;
 }
 
 static void
-thtable_sort(thtable_t thtable) {
-  qsort(thtable, THTABLE_INDEX_MAX + 1, sizeof(struct htlist *), thtable_cmp);
+thtable_subtable_free(struct thtable_subtable *subtable) {
+  struct thtable_entry *entry;
+  uint32_t i;
+  int stage;
+
+  for (i = 0; i < subtable->size; i++) {
+    while ((entry = subtable->buckets[i]) != NULL) {
+      subtable->buckets[i] = entry->next;
+      free(entry->flows);
+      free(entry);
+    }
+  }
+  for (stage = 0; stage < THTABLE_STAGES; stage++) {
+    free(subtable->stages[stage].slots);
+  }
+  free(subtable->buckets);
+  free(subtable);
 }
 
-struct match_idx {
-  int base;
-  int off;
-  int size;
-  uint8_t mask[16];
-  int shift;
-};
-
 /*
- * pkt value: &base[idx])[off], sizeof(member), masked, right shifted
- * match value: oxm_value, OXM_MATCH_VALUE_LEN
+ * stages before the last one are indexed if they have words.
  */
-#define MAKE_IDX(base, type, member)        \
-  (base), offsetof(struct type, member), sizeof(((struct type *)0)->member)
+static struct thtable_subtable *
+thtable_subtable_alloc(const struct thtable_word *words, int nword,
+                       const int *stage_end) {
+  struct thtable_subtable *subtable;
+  int stage, last;
+
+  subtable = calloc(1, sizeof(struct thtable_subtable) +
+                    sizeof(struct thtable_word) * (size_t)nword);
+  if (subtable == NULL) {
+    return NULL;
+  }
+  subtable->buckets = calloc(THTABLE_INITIAL_SIZE,
+                             sizeof(struct thtable_entry *));
+  if (subtable->buckets == NULL) {
+    free(subtable);
+    return NULL;
+  }
+  subtable->size = THTABLE_INITIAL_SIZE;
+  subtable->max_priority = -1;
+  subtable->nword = nword;
+  memcpy(subtable->words, words, sizeof(struct thtable_word) * (size_t)nword);
+  memcpy(subtable->stage_end, stage_end, sizeof(subtable->stage_end));
+  for (last = THTABLE_STAGES - 1; last > 0; last--) {
+    if (stage_end[last] != stage_end[last - 1]) {
+      break;
+    }
+  }
+  for (stage = 0; stage < last; stage++) {
+    if (stage_end[stage] != (stage == 0 ? 0 : stage_end[stage - 1]) &&
+        thtable_stage_init(&subtable->stages[stage],
+                           THTABLE_INITIAL_SIZE) != LAGOPUS_RESULT_OK) {
+      thtable_subtable_free(subtable);
+      return NULL;
+    }
+  }
+  return subtable;
+}
 
-/*
- * 1. classify packet.
- * 2. pick pkt->base[n] + offset, N bytes
- * 3. mask
- * 4. compare with match->oxm_value, N bytes
- */
-const struct match_idx match_idx[]  = {
-  { MAKE_IDX(OOB_BASE, oob_data, in_port), {0xff,0xff,0xff,0xff}, 0 },
-  { MAKE_IDX(OOB_BASE, oob_data, in_phy_port), {0xff,0xff,0xff,0xff}, 0 },
-  { MAKE_IDX(OOB_BASE, oob_data, metadata), {0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff}, 0 },
-  { MAKE_IDX(ETH_BASE, ether_header, ether_dhost), {0xff,0xff,0xff,0xff,0xff,0xff}, 0 },
-  { MAKE_IDX(ETH_BASE, ether_header, ether_shost), {0xff,0xff,0xff,0xff,0xff,0xff}, 0 },
-  { MAKE_IDX(OOB_BASE, oob_data, ether_type), {0xff,0xff}, 0 },
-  { MAKE_IDX(OOB_BASE, oob_data, vlan_tci), {0x1f,0xff}, 0 },
-  { MAKE_IDX(OOB_BASE, oob_data, vlan_tci), {0xe0,00}, 13 },
-  { MAKE_IDX(L3_BASE, ip, ip_tos), {0xfc}, 3 },
-  { MAKE_IDX(L3_BASE, ip, ip_tos), {0x03}, 0 },
-  { IPPROTO_BASE, 0, 1, {0xff}, 0 },
-  { MAKE_IDX(L3_BASE, ip, ip_src), {0xff,0xff,0xff,0xff}, 0 },
-  { MAKE_IDX(L3_BASE, ip, ip_dst), {0xff,0xff,0xff,0xff}, 0 },
-  { MAKE_IDX(L4_BASE, tcphdr, th_sport), {0xff,0xff}, 0 },
-  { MAKE_IDX(L4_BASE, tcphdr, th_dport), {0xff,0xff}, 0 },
-  { MAKE_IDX(L4_BASE, udphdr, uh_sport), {0xff,0xff}, 0 },
-  { MAKE_IDX(L4_BASE, udphdr, uh_dport), {0xff,0xff}, 0 },
-  { MAKE_IDX(L4_BASE, tcphdr, th_sport), {0xff,0xff}, 0 },
-  { MAKE_IDX(L4_BASE, tcphdr, th_dport), {0xff,0xff}, 0 },
-  { MAKE_IDX(L4_BASE, icmp, icmp_type), {0xff}, 0 },
-  { MAKE_IDX(L4_BASE, icmp, icmp_code), {0xff}, 0 },
-  { MAKE_IDX(L3_BASE, ether_arp, arp_op), {0xff,0xff}, 0 },
-  { MAKE_IDX(L3_BASE, ether_arp, arp_spa), {0xff,0xff,0xff,0xff}, 0 },
-  { MAKE_IDX(L3_BASE, ether_arp, arp_tpa), {0xff,0xff,0xff,0xff}, 0 },
-  { MAKE_IDX(L3_BASE, ether_arp, arp_sha), {0xff,0xff,0xff,0xff,0xff,0xff}, 0 },
-  { MAKE_IDX(L3_BASE, ether_arp, arp_tha), {0xff,0xff,0xff,0xff,0xff,0xff}, 0 },
-  { MAKE_IDX(L3_BASE, ip6_hdr, ip6_src), {0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff}, 0 },
-  { MAKE_IDX(L3_BASE, ip6_hdr, ip6_dst), {0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff}, 0 },
-  { MAKE_IDX(L3_BASE, ip6_hdr, ip6_flow), {0x00,0x0f,0xff,0xff}, 0 },
-  { MAKE_IDX(L4_BASE, icmp6_hdr, icmp6_type), {0xff}, 0 },
-  { MAKE_IDX(L4_BASE, icmp6_hdr, icmp6_code), {0xff}, 0 },
-  { L4_BASE, 0, 0, 0, 0},
-  { NDSLL_BASE, 0, 2, {0xff,0xff}, 0 },
-  { NDTLL_BASE, 0, 2, {0xff,0xff}, 0 },
-  { MPLS_BASE, 0, 3, {0xff,0xff,0xf0}, 12 },
-  { MPLS_BASE, 2, 1, {0x01}, 0 },
-  { MPLS_BASE, 3, 1, {0xff}, 0 },
-  { MAKE_IDX(PBB_BASE, pbb_hdr, i_sid), {0x00,0xff,0xff,0xff}, 0 },
-  { MAKE_IDX(OOB2_BASE, oob2_data, tunnel_id), {0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff}, 0 },
-  { MAKE_IDX(OOB2_BASE, oob2_data, ipv6_exthdr), {0xff,0xff}, 0 }
-};
+static lagopus_result_t
+thtable_subtable_resize(struct thtable_subtable *subtable, uint32_t size) {
+  struct thtable_entry **buckets, *entry;
+  uint32_t i;
+
+  buckets = calloc(size, sizeof(struct thtable_entry *));
+  if (buckets == NULL) {
+    return LAGOPUS_RESULT_NO_MEMORY;
+  }
+  for (i = 0; i < subtable->size; i++) {
+    while ((entry = subtable->buckets[i]) != NULL) {
+      subtable->buckets[i] = entry->next;
+      entry->next = buckets[entry->hash & (size - 1)];
+      buckets[entry->hash & (size - 1)] = entry;
+    }
+  }
+  free(subtable->buckets);
+  subtable->buckets = buckets;
+  subtable->size = size;
+  return LAGOPUS_RESULT_OK;
+}
 
-static struct match *
-copy_masked_match(const struct match *src_match) {
-  struct match *dst_match;
-  struct match_idx *idx;
-  size_t len;
-  uint64_t val64;
-  uint32_t val32;
-  uint16_t val16;
-
-  len = OXM_MATCH_VALUE_LEN(src_match);
-  dst_match = calloc(1, sizeof(struct match) + len * 2);
-  if (dst_match == NULL) {
+static struct thtable_entry *
+thtable_entry_add(struct thtable_subtable *subtable,
+                  const uint32_t *key, const uint32_t *hashes) {
+  struct thtable_entry *entry;
+  uint32_t hash;
+  int stage;
+
+  if (subtable->nentry >= subtable->size &&
+      thtable_subtable_resize(subtable,
+                              subtable->size * 2) != LAGOPUS_RESULT_OK) {
     return NULL;
   }
-  memcpy(dst_match, src_match, sizeof(struct match));
-  idx = &match_idx[OXM_FIELD_TYPE(src_match->oxm_field)];
-  if (idx->size == len && idx->shift == 0) {
-    memcpy(dst_match->oxm_value, src_match->oxm_value, len);
-  } else {
-    switch (len) {
-      case 8:
-        memcpy(&val64, src_match->oxm_value, sizeof(val64));
-        val64 = OS_NTOHLL(val64);
-        val64 <<= idx->shift;
-        val64 = OS_HTONLL(val64);
-        memcpy(dst_match->oxm_value, &val64, sizeof(val64));
-        break;
-      case 4:
-        memcpy(&val32, src_match->oxm_value, sizeof(val32));
-        val32 = OS_NTOHL(val32);
-        val32 <<= idx->shift;
-        val32 = OS_HTONL(val32);
-        memcpy(dst_match->oxm_value, &val32, sizeof(val32));
-        break;
-      case 2:
-        memcpy(&val16, src_match->oxm_value, sizeof(val16));
-        val16 = OS_NTOHS(val16);
-        val16 <<= idx->shift;
-        val16 = OS_HTONS(val16);
-        memcpy(dst_match->oxm_value, &val16, sizeof(val16));
-        break;
-      case 1:
-        *dst_match->oxm_value = (*src_match->oxm_value) << idx->shift;
-        break;
+  entry = calloc(1, sizeof(struct thtable_entry) +
+                 sizeof(uint32_t) * (size_t)subtable->nword);
+  if (entry == NULL) {
+    return NULL;
+  }
+  for (stage = 0; stage < THTABLE_STAGES; stage++) {
+    if (subtable->stages[stage].size != 0 &&
+        thtable_stage_add(&subtable->stages[stage],
+                          hashes[stage]) != LAGOPUS_RESULT_OK) {
+      while (--stage >= 0) {
+        if (subtable->stages[stage].size != 0) {
+          thtable_stage_del(&subtable->stages[stage], hashes[stage]);
+        }
+      }
+      free(entry);
+      return NULL;
     }
   }
-  if (!OXM_FIELD_HAS_MASK(src_match->oxm_field)) {
-    memcpy(&dst_match->oxm_value[idx->size], idx->mask, idx->size);
-  } else if (idx->shift == 0) {
-    memcpy(&dst_match->oxm_value[idx->size],
-           &src_match->oxm_value[len + (len - idx->size)],
-           idx->size);
-  } else {
-    switch (len) {
-      case 8:
-        memcpy(&val64, &src_match->oxm_value[len], sizeof(val64));
-        val64 = OS_NTOHLL(val64);
-        val64 <<= idx->shift;
-        val64 = OS_HTONLL(val64);
-        memcpy(&dst_match->oxm_value[idx->size], &val64, sizeof(val64));
-        break;
-      case 4:
-        memcpy(&val32, &src_match->oxm_value[len], sizeof(val32));
-        val32 = OS_NTOHL(val32);
-        val32 <<= idx->shift;
-        val32 = OS_HTONL(val32);
-        memcpy(&dst_match->oxm_value[idx->size], &val32, sizeof(val32));
-        break;
-      case 2:
-        memcpy(&val16, &src_match->oxm_value[len], sizeof(val16));
-        val16 = OS_NTOHS(val16);
-        val16 <<= idx->shift;
-        val16 = OS_HTONS(val16);
-        memcpy(&dst_match->oxm_value[idx->size], &val16, sizeof(val16));
-        break;
-      case 1:
-        dst_match->oxm_value[idx->size] =
-            src_match->oxm_value[len] << idx->shift;
-        break;
+  hash = hashes[THTABLE_STAGES - 1];
+  entry->hash = hash;
+  memcpy(entry->key, key, sizeof(uint32_t) * (size_t)subtable->nword);
+  entry->next = subtable->buckets[hash & (subtable->size - 1)];
+  subtable->buckets[hash & (subtable->size - 1)] = entry;
+  subtable->nentry++;
+  return entry;
+}
+
+static void
+thtable_entry_del(struct thtable_subtable *subtable,
+                  struct thtable_entry *entry, const uint32_t *hashes) {
+  struct thtable_entry **entryp;
+  int stage;
+
+  for (entryp = &subtable->buckets[entry->hash & (subtable->size - 1)];
+       *entryp != entry;
+       entryp = &(*entryp)->next) {
+    continue;
+  }
+  *entryp = entry->next;
+  for (stage = 0; stage < THTABLE_STAGES; stage++) {
+    if (subtable->stages[stage].size != 0) {
+      thtable_stage_del(&subtable->stages[stage], hashes[stage]);
     }
   }
-  dst_match->oxm_length = idx->size;
-  return dst_match;
+  subtable->nentry--;
+  free(entry->flows);
+  free(entry);
+}
+
+static void
+thtable_swap(struct thtable *thtable, int a, int b) {
+  struct thtable_subtable *subtable;
+
+  subtable = thtable->subtables[a];
+  thtable->subtables[a] = thtable->subtables[b];
+  thtable->subtables[b] = subtable;
+  thtable->subtables[a]->pos = a;
+  thtable->subtables[b]->pos = b;
+}
+
+/*
+ * move the subtable to keep subtables sorted by max priority.
+ */
+static void
+thtable_sort(struct thtable *thtable, struct thtable_subtable *subtable) {
+  int pos;
+
+  pos = subtable->pos;
+  while (pos > 0 &&
+         thtable->subtables[pos - 1]->max_priority < subtable->max_priority) {
+    thtable_swap(thtable, pos - 1, pos);
+    pos--;
+  }
+  while (pos < thtable->nsubtable - 1 &&
+         thtable->subtables[pos + 1]->max_priority > subtable->max_priority) {
+    thtable_swap(thtable, pos, pos + 1);
+    pos++;
+  }
 }
 
 static lagopus_result_t
-copy_masked_match_list(struct match_list *dst,
-                       const struct match_list *src) {
-  struct match *src_match;
-  struct match *dst_match;
+thtable_masks_resize(struct thtable *thtable, uint32_t size) {
+  struct thtable_subtable **masks, *subtable;
+  uint32_t i;
 
-  TAILQ_FOREACH(src_match, src, entry) {
-    dst_match = copy_masked_match(src_match);
-    DPRINTF(" %d", dst_match->oxm_field);
-    TAILQ_INSERT_TAIL(dst, dst_match, entry);
+  masks = calloc(size, sizeof(struct thtable_subtable *));
+  if (masks == NULL) {
+    return LAGOPUS_RESULT_NO_MEMORY;
+  }
+  for (i = 0; i < thtable->size; i++) {
+    while ((subtable = thtable->masks[i]) != NULL) {
+      thtable->masks[i] = subtable->next;
+      subtable->next = masks[subtable->mask_hash & (size - 1)];
+      masks[subtable->mask_hash & (size - 1)] = subtable;
+    }
   }
+  free(thtable->masks);
+  thtable->masks = masks;
+  thtable->size = size;
   return LAGOPUS_RESULT_OK;
 }
 
-static lagopus_result_t
-htlist_add_flow(struct flow *flow, struct htlist *htlist) {
-  struct match *match, *tmatch;
-  struct htable *hash_table;
-  size_t len;
-  uint64_t key;
-  int i, count, tcount;
-
-  key = 0;
-  count = 0;
-  TAILQ_FOREACH(match, &flow->match_list, entry) {
-    struct match *pmatch;
-
-    pmatch = copy_masked_match(match);
-    key = calc_hash(pmatch->oxm_value, pmatch->oxm_length, key);
-    free(pmatch);
-    count++;
-  }
-  hash_table = NULL;
-  for (i = 0; i < htlist->ntable; i++) {
-    hash_table = htlist->tables[i];
-    if (hash_table == NULL) {
-      continue;
+static struct thtable_subtable *
+thtable_subtable_get(struct thtable *thtable, struct flow *flow,
+                     bool create) {
+  struct thtable_subtable *subtable, **subtables;
+  struct thtable_word words[THTABLE_WORDS];
+  int stage_end[THTABLE_STAGES];
+  uint32_t hash;
+  int nword, nalloc;
+
+  nword = thtable_flow_mask(flow, words, stage_end);
+  hash = thtable_mask_hash(words, nword);
+  if (thtable->size != 0) {
+    for (subtable = thtable->masks[hash & (thtable->size - 1)];
+         subtable != NULL;
+         subtable = subtable->next) {
+      if (subtable->mask_hash == hash &&
+          thtable_mask_equal(subtable, words, nword) == true) {
+        return subtable;
+      }
     }
-    tcount = 0;
-    TAILQ_FOREACH(tmatch, &hash_table->match_list, entry) {
-      tcount++;
-      TAILQ_FOREACH(match, &flow->match_list, entry) {
-        if (match->oxm_field == tmatch->oxm_field) {
-          len = OXM_MATCH_VALUE_LEN(match);
-          if (!OXM_FIELD_HAS_MASK(match->oxm_field) ||
-              !memcmp(match->oxm_value + len,
-                      tmatch->oxm_value + len,
-                      len)) {
-            break;
-          }
-        }
+  }
+  if (create == false) {
+    return NULL;
+  }
+  if ((uint32_t)thtable->nsubtable >= thtable->size &&
+      thtable_masks_resize(thtable,
+                           thtable->size == 0 ?
+                           THTABLE_INITIAL_SIZE :
+                           thtable->size * 2) != LAGOPUS_RESULT_OK) {
+    return NULL;
+  }
+  if (thtable->nsubtable == thtable->nalloc) {
+    nalloc = thtable->nalloc == 0 ? THTABLE_INITIAL_SIZE : thtable->nalloc * 2;
+    subtables = realloc(thtable->subtables,
+                        sizeof(struct thtable_subtable *) * (size_t)nalloc);
+    if (subtables == NULL) {
+      return NULL;
+    }
+    thtable->subtables = subtables;
+    thtable->nalloc = nalloc;
+  }
+  subtable = thtable_subtable_alloc(words, nword, stage_end);
+  if (subtable == NULL) {
+    return NULL;
+  }
+  subtable->mask_hash = hash;
+  subtable->next = thtable->masks[hash & (thtable->size - 1)];
+  thtable->masks[hash & (thtable->size - 1)] = subtable;
+  subtable->pos = thtable->nsubtable;
+  thtable->subtables[thtable->nsubtable++] = subtable;
+  return subtable;
+}
+
+static void
+thtable_subtable_del(struct thtable *thtable,
+                     struct thtable_subtable *subtable) {
+  struct thtable_subtable **subtablep;
+  int i;
+
+  for (subtablep = &thtable->masks[subtable->mask_hash & (thtable->size - 1)];
+       *subtablep != subtable;
+       subtablep = &(*subtablep)->next) {
+    continue;
+  }
+  *subtablep = subtable->next;
+  thtable->nsubtable--;
+  for (i = subtable->pos; i < thtable->nsubtable; i++) {
+    thtable->subtables[i] = thtable->subtables[i + 1];
+    thtable->subtables[i]->pos = i;
+  }
+  thtable_subtable_free(subtable);
+}
+
+/*
+ * max priority is recalculated when all flows of it are removed.
+ */
+static void
+thtable_subtable_reprioritize(struct thtable *thtable,
+                              struct thtable_subtable *subtable) {
+  struct thtable_entry *entry;
+  uint32_t i;
+  int j;
+
+  subtable->max_priority = -1;
+  subtable->nmax = 0;
+  for (i = 0; i < subtable->size; i++) {
+    for (entry = subtable->buckets[i]; entry != NULL; entry = entry->next) {
+      if (entry->flows[0]->priority > subtable->max_priority) {
+        subtable->max_priority = entry->flows[0]->priority;
+        subtable->nmax = 0;
       }
-      if (match == NULL) {
-        /* flow match is not found in hash table, top loop */
-        break;
+      for (j = 0; j < entry->nflow; j++) {
+        if (entry->flows[j]->priority != subtable->max_priority) {
+          break;
+        }
+        subtable->nmax++;
       }
     }
-    if (tmatch == NULL && count == tcount) {
-      /* hash table matched */
-      break;
+  }
+  thtable_sort(thtable, subtable);
+}
+
+static lagopus_result_t
+thtable_entry_add_flow(struct thtable_entry *entry, struct flow *flow) {
+  struct flow **flows;
+  int i, st, ed, off;
+
+  flows = realloc(entry->flows, (size_t)(entry->nflow + 1) * sizeof(flow));
+  if (flows == NULL) {
+    return LAGOPUS_RESULT_NO_MEMORY;
+  }
+  entry->flows = flows;
+  st = 0;
+  ed = entry->nflow;
+  while (st < ed) {
+    off = st + (ed - st) / 2;
+    if (entry->flows[off]->priority >= flow->priority) {
+      st = off + 1;
+    } else {
+      ed = off;
     }
-    hash_table = NULL;
   }
-  if (hash_table == NULL) {
-    char *p;
+  i = ed;
+  if (i < entry->nflow) {
+    memmove(&entry->flows[i + 1], &entry->flows[i],
+            sizeof(struct flow *) * (size_t)(entry->nflow - i));
+  }
+  entry->flows[i] = flow;
+  entry->nflow++;
+  return LAGOPUS_RESULT_OK;
+}
 
-    /* same match hash table does not exist.  create. */
-    if (htlist->ntable >= sizeof(htlist->tables) / sizeof(htlist->tables[0])) {
-      DPRINTF("warning: tables is over\n");
-      return LAGOPUS_RESULT_NO_MEMORY;
+static bool
+thtable_entry_del_flow(struct thtable_entry *entry, struct flow *flow) {
+  int i;
+
+  for (i = 0; i < entry->nflow; i++) {
+    if (entry->flows[i] == flow) {
+      memmove(&entry->flows[i], &entry->flows[i + 1],
+              sizeof(struct flow *) * (size_t)(entry->nflow - i - 1));
+      entry->nflow--;
+      return true;
     }
-    DPRINTF("alloc htlist->tebles[%d] match:", htlist->ntable);
-    hash_table = htable_alloc();
-    copy_match_list(&hash_table->match_list, &flow->match_list);
-    copy_masked_match_list(&hash_table->mask_list, &flow->match_list);
-    htlist->tables[htlist->ntable++] = hash_table;
-    DPRINTF("\n");
-  }
-#if DEBUG > 1
-  hash_table->nflow++;
-#endif /* DEBUG */
-  DDPRINTF("registered key %d flow %p\n", key, flow);
-  return lagopus_hashmap_add(&hash_table->hashmap, key, &flow, false);
+  }
+  return false;
 }
 
-lagopus_result_t
-thtable_add_flow(struct flow *flow, thtable_t thtable) {
-  struct htlist *htlist;
+struct flowinfo *
+new_flowinfo_thtable(void) {
+  struct flowinfo *self;
+  struct thtable *thtable;
 
-  htlist = thtable_get_htlist(thtable, flow->priority);
-  if (htlist == NULL) {
-    htlist = htlist_alloc(flow->priority);
-    thtable_add_htlist(thtable, htlist);
+  self = calloc(1, sizeof(struct flowinfo));
+  thtable = calloc(1, sizeof(struct thtable));
+  if (self == NULL || thtable == NULL) {
+    free(self);
+    free(thtable);
+    return NULL;
   }
-  return htlist_add_flow(flow, htlist);
+  self->userdata = (uint64_t)(uintptr_t)thtable;
+  self->add_func = add_flow_thtable;
+  self->del_func = del_flow_thtable;
+  self->match_func = match_flow_thtable;
+  self->find_func = find_flow_thtable;
+  self->destroy_func = destroy_flowinfo_thtable;
+  return self;
 }
 
-void
-thtable_update(struct flow_list *flow_list) {
-  thtable_t old_table, new_table;
+static void
+destroy_flowinfo_thtable(struct flowinfo *self) {
+  struct thtable *thtable;
   int i;
 
-  new_table = thtable_alloc();
-  for (i = 0; i < flow_list->nflow; i++) {
-    thtable_add_flow(flow_list->flows[i], new_table);
+  thtable = THTABLE(self);
+  for (i = 0; i < thtable->nsubtable; i++) {
+    thtable_subtable_free(thtable->subtables[i]);
+  }
+  free(thtable->subtables);
+  free(thtable->masks);
+  free(thtable);
+  free(self);
+}
+
+static lagopus_result_t
+add_flow_thtable(struct flowinfo *self, struct flow *flow) {
+  struct thtable *thtable;
+  struct thtable_subtable *subtable;
+  struct thtable_entry *entry;
+  uint32_t key[THTABLE_WORDS];
+  uint32_t hashes[THTABLE_STAGES];
+
+  flow_make_match(flow);
+
+  thtable = THTABLE(self);
+  subtable = thtable_subtable_get(thtable, flow, true);
+  if (subtable == NULL) {
+    return LAGOPUS_RESULT_NO_MEMORY;
+  }
+  thtable_flow_key(flow, subtable, key, hashes);
+  entry = thtable_entry_lookup(subtable, key, hashes[THTABLE_STAGES - 1]);
+  if (entry == NULL) {
+    entry = thtable_entry_add(subtable, key, hashes);
+  }
+  if (entry == NULL ||
+      thtable_entry_add_flow(entry, flow) != LAGOPUS_RESULT_OK) {
+    if (entry != NULL && entry->nflow == 0) {
+      thtable_entry_del(subtable, entry, hashes);
+    }
+    if (subtable->nflow == 0) {
+      thtable_subtable_del(thtable, subtable);
+    }
+    return LAGOPUS_RESULT_NO_MEMORY;
+  }
+  subtable->nflow++;
+  self->nflow++;
+  if (flow->priority > subtable->max_priority) {
+    subtable->max_priority = flow->priority;
+    subtable->nmax = 1;
+    thtable_sort(thtable, subtable);
+  } else if (flow->priority == subtable->max_priority) {
+    subtable->nmax++;
+  }
+  return LAGOPUS_RESULT_OK;
+}
+
+static lagopus_result_t
+del_flow_thtable(struct flowinfo *self, struct flow *flow) {
+  struct thtable *thtable;
+  struct thtable_subtable *subtable;
+  struct thtable_entry *entry;
+  uint32_t key[THTABLE_WORDS];
+  uint32_t hashes[THTABLE_STAGES];
+
+  thtable = THTABLE(self);
+  subtable = thtable_subtable_get(thtable, flow, false);
+  if (subtable == NULL) {
+    return LAGOPUS_RESULT_NOT_FOUND;
+  }
+  thtable_flow_key(flow, subtable, key, hashes);
+  entry = thtable_entry_lookup(subtable, key, hashes[THTABLE_STAGES - 1]);
+  if (entry == NULL || thtable_entry_del_flow(entry, flow) == false) {
+    return LAGOPUS_RESULT_NOT_FOUND;
+  }
+  if (entry->nflow == 0) {
+    thtable_entry_del(subtable, entry, hashes);
   }
-  thtable_sort(new_table);
-  old_table = flow_list->thtable;
-  flow_list->thtable = new_table;
-  if (old_table != NULL) {
-    thtable_free(old_table);
+  subtable->nflow--;
+  self->nflow--;
+  if (subtable->nflow == 0) {
+    thtable_subtable_del(thtable, subtable);
+  } else if (flow->priority == subtable->max_priority &&
+             --subtable->nmax == 0) {
+    thtable_subtable_reprioritize(thtable, subtable);
   }
+  return LAGOPUS_RESULT_OK;
 }
 
-static inline uint64_t
-key_from_packet(struct lagopus_packet *pkt,
-                struct match_list *mask_list) {
-  uint8_t buf[16];
-  struct match *match;
-  struct match_idx *idx;
-  size_t len;
-  uint64_t key;
+static struct flow *
+match_flow_thtable(struct flowinfo *self, struct lagopus_packet *pkt,
+                   int32_t *pri) {
+  struct thtable *thtable;
+  struct thtable_subtable *subtable;
+  struct flow *flow, *matched;
   int i;
 
-  key = 0;
-  DDPRINTF("match:");
-  TAILQ_FOREACH(match, mask_list, entry) {
-    idx = &match_idx[OXM_FIELD_TYPE(match->oxm_field)];
-    len = idx->size;
-    DDDPRINTF("idx->base %d\n", idx->base);
-    DDDPRINTF("idx->off %d\n", idx->off);
-    DDDPRINTF("idx->size %d\n", idx->size);
-    for (i = 0; i < idx->size; i++) {
-      DDDPRINTF("idx->mask[%d] %d\n", i, idx->mask[i]);
-    }
-    DDDPRINTF("idx->shift %d\n", idx->shift);
-    if (pkt->base[idx->base] == NULL) {
-      DPRINTF(" unmatched\n");
-      return 0;
+  thtable = THTABLE(self);
+  matched = NULL;
+  for (i = 0; i < thtable->nsubtable; i++) {
+    subtable = thtable->subtables[i];
+    if (subtable->max_priority <= *pri) {
+      /* no more higher priority flows. */
+      break;
     }
-    DDPRINTF(" %d", match->oxm_field);
-    for (i = 0; i < len; i++) {
-      buf[i] = *(pkt->base[idx->base] + idx->off + i);
-      buf[i] &= match->oxm_value[len + i];
+    flow = thtable_subtable_match(subtable, pkt, *pri);
+    if (flow != NULL) {
+      matched = flow;
+      *pri = flow->priority;
     }
-    key = calc_hash(buf, len, key);
   }
-  DDPRINTF("\n");
-  return key;
+  if (matched != NULL &&
+      (matched->flags & (OFPFF_NO_PKT_COUNTS | OFPFF_NO_BYT_COUNTS)) !=
+      (OFPFF_NO_PKT_COUNTS | OFPFF_NO_BYT_COUNTS)) {
+    dp_counter_add(matched->counter_id,
+                   (matched->flags & OFPFF_NO_PKT_COUNTS) == 0 ? 1 : 0,
+                   (matched->flags & OFPFF_NO_BYT_COUNTS) == 0 ?
+                   OS_M_PKTLEN(PKT2MBUF(pkt)) : 0);
+  }
+  return matched;
 }
 
-struct flow *
-thtable_match(struct lagopus_packet *pkt, thtable_t thtable) {
-  struct htlist *htlist;
-  struct flow *flow;
-  int i, j;
-  lagopus_result_t rv;
-
-  for (i = 0; i <= THTABLE_INDEX_MAX; i++) {
-    htlist = thtable[i];
-    if (htlist == NULL) {
-      /* unmatched. */
-      break;
+bool
+thtable_match_list_equal(struct flow *f1, struct flow *f2) {
+  struct match *m1, *m2;
+
+  m1 = TAILQ_FIRST(&f1->match_list);
+  m2 = TAILQ_FIRST(&f2->match_list);
+  while (m1 != NULL && m2 != NULL) {
+    if (m1->oxm_class != m2->oxm_class ||
+        m1->oxm_field != m2->oxm_field ||
+        m1->oxm_length != m2->oxm_length ||
+        memcmp(m1->oxm_value, m2->oxm_value, m1->oxm_length) != 0) {
+      return false;
     }
-    DDPRINTF("htlist->ntable %d\n", htlist->ntable);
-    for (j = 0; j < htlist->ntable; j++) {
-      uint64_t key;
+    m1 = TAILQ_NEXT(m1, entry);
+    m2 = TAILQ_NEXT(m2, entry);
+  }
+  return m1 == m2;
+}
 
-      key = key_from_packet(pkt, &htlist->tables[j]->mask_list);
-      if (key == 0) {
-        DDPRINTF("htlist->tables[%d]: not match list\n", j);
-        continue;
-      }
-      rv = lagopus_hashmap_find_no_lock(
-          &htlist->tables[j]->hashmap,
-          key,
-          (void **)&flow);
-      if (rv == LAGOPUS_RESULT_OK) {
-        return flow;
-      }
-      DDPRINTF("htlist->tables[%d]: (nflow:%d) key %d not found\n",
-              j, htlist->tables[j]->nflow, key);
+static struct flow *
+find_flow_thtable(struct flowinfo *self, struct flow *flow) {
+  struct thtable_subtable *subtable;
+  struct thtable_entry *entry;
+  uint32_t key[THTABLE_WORDS];
+  uint32_t hashes[THTABLE_STAGES];
+  int i;
+
+  flow_make_match(flow);
+
+  subtable = thtable_subtable_get(THTABLE(self), flow, false);
+  if (subtable == NULL) {
+    return NULL;
+  }
+  thtable_flow_key(flow, subtable, key, hashes);
+  entry = thtable_entry_lookup(subtable, key, hashes[THTABLE_STAGES - 1]);
+  if (entry == NULL) {
+    return NULL;
+  }
+  for (i = 0; i < entry->nflow; i++) {
+    if (entry->flows[i]->priority == flow->priority &&
+        entry->flows[i]->field_bits == flow->field_bits &&
+        thtable_match_list_equal(entry->flows[i], flow) == true) {
+      return entry->flows[i];
     }
   }
   return NULL;
@@ -14,18 +14,112 @@
  * limitations under the License.
  */
 
-#define THTABLE_INDEX_MAX UINT16_MAX
+/**
+ *      @file   thtable.h
+ *      @brief  Masked 32bit words of flows and packets, shared by hash
+ *              table classifiers.
+ */
+
+#ifndef SRC_DATAPLANE_OFPROTO_THTABLE_H_
+#define SRC_DATAPLANE_OFPROTO_THTABLE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "lagopus/ethertype.h"
+#include "lagopus/flowdb.h"
+#include "pktbuf.h"
+#include "packet.h"
+
+/* pseudo base of ETH_TYPE, not in byteoff_match. */
+#define THTABLE_ETH_TYPE MAX_BASE
+
+#define THTABLE_STAGES 3
+#define THTABLE_WORDS (MAX_BASE * 8 + 1)
+
+/**
+ * @brief Masked 32bit word of the packet.
+ */
+struct thtable_word {
+  uint8_t base;                 /** Index of pkt->base[]. */
+  uint8_t off;                  /** Byte offset from the base. */
+  uint32_t mask;                /** Mask. */
+};
+
+/*
+ * Get ETH_TYPE match value of the flow.  Return false if the flow
+ * does not match ETH_TYPE.
+ */
+bool thtable_flow_eth_type(struct flow *flow, uint32_t *eth_type);
+
+/*
+ * Make mask of the flow, words are ordered by stage (L2, L3 and L4),
+ * and stage_end[] is set to end of words of each stage.  Return the
+ * number of words.  flow_make_match() must be called before.
+ */
+int thtable_flow_mask(struct flow *flow, struct thtable_word *words,
+                      int *stage_end);
+
+/*
+ * Return true if match lists of the flows are the same.
+ */
+bool thtable_match_list_equal(struct flow *f1, struct flow *f2);
+
+static inline uint32_t
+thtable_hash_add(uint32_t hash, uint32_t data) {
+  data *= 0xcc9e2d51;
+  data = (data << 15) | (data >> 17);
+  data *= 0x1b873593;
+  hash ^= data;
+  hash = (hash << 13) | (hash >> 19);
+  return hash * 5 + 0xe6546b64;
+}
 
-struct flow;
-struct lagopus_packet;
-struct htlist;
-typedef struct htlist **thtable_t;
+static inline uint32_t
+thtable_hash_finish(uint32_t hash) {
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6b;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35;
+  hash ^= hash >> 16;
+  return hash;
+}
 
-thtable_t thtable_alloc(void);
-void thtable_free(thtable_t thtable);
+/*
+ * match value of the flow at the word.  value is not masked, it
+ * never matches if it has bits out of the mask as match_basic() does.
+ */
+static inline void
+thtable_flow_word(struct flow *flow, const struct thtable_word *word,
+                  uint32_t *val) {
+  if (word->base == THTABLE_ETH_TYPE) {
+    (void)thtable_flow_eth_type(flow, val);
+  } else {
+    memcpy(val, &flow->byteoff_match[word->base].bytes[word->off],
+           sizeof(uint32_t));
+  }
+}
 
-lagopus_result_t thtable_add_flow(struct flow *flow, thtable_t thtable);
+static inline bool
+thtable_packet_word(const struct lagopus_packet *pkt,
+                    const struct thtable_word *word, uint32_t *val) {
+  const uint8_t *base;
 
-void thtable_update(struct flow_list *flow_list);
+  if (word->base == THTABLE_ETH_TYPE) {
+    *val = pkt->ether_type;
+    return true;
+  }
+  if (word->base >= V6SRC_BASE && pkt->ether_type != ETHERTYPE_IPV6) {
+    return false;
+  }
+  base = pkt->base[word->base];
+  if (base == NULL) {
+    return false;
+  }
+  memcpy(val, &base[word->off], sizeof(uint32_t));
+  *val &= word->mask;
+  return true;
+}
 
-struct flow *thtable_match(struct lagopus_packet *pkt, thtable_t thtable);
+#endif /* SRC_DATAPLANE_OFPROTO_THTABLE_H_ */
@@ -0,0 +1,317 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ *      @file   pktbuf.c
+ *      @brief  Packet buffer pool of raw socket dataplane.
+ *
+ * Buffers are carved from chunks and kept on a free list per NUMA
+ * node.  Each thread has a small cache of buffers of its node, and
+ * exchanges them with the node free list in batches.  A buffer freed
+ * by a thread of another node goes back to the free list of its node.
+ * When the pool reaches PKTBUF_POOL_MAX, buffers are allocated out of
+ * the pool and counted as exhausted.
+ *
+ * Only headers of the buffer and the packet are initialized on
+ * allocation, packet data and matched flows are written by users.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/queue.h>
+#include <sys/syscall.h>
+
+#include "lagopus_apis.h"
+#include "lagopus/dp_apis.h"
+#include "lagopus/dataplane.h"
+#include "pktbuf.h"
+#include "packet.h"
+
+#define PKTBUF_MAX_NODES 8
+#define PKTBUF_CACHE_SIZE 64
+#define PKTBUF_BATCH 32
+#define PKTBUF_CHUNK 256
+#define PKTBUF_POOL_MAX 16384
+
+#define PKTBUF_SIZE                                                  \
+  ((sizeof(OS_MBUF) + sizeof(struct lagopus_packet) + 63) & ~(size_t)63)
+
+/**
+ * @brief Free list of a NUMA node.
+ */
+struct pktbuf_node {
+  pthread_mutex_t lock;         /** Lock of the free list. */
+  OS_MBUF *head;                /** Free buffers. */
+  unsigned count;               /** Number of free buffers. */
+};
+
+/**
+ * @brief Buffer cache of a thread.
+ */
+struct pktbuf_cache {
+  struct pktbuf_cache *next;    /** Next cache for statistics. */
+  int node;                     /** NUMA node of the thread. */
+  unsigned count;               /** Number of cached buffers. */
+  OS_MBUF *head;                /** Cached buffers. */
+  uint64_t allocs;              /** Allocated pool buffers. */
+  uint64_t frees;               /** Freed pool buffers. */
+  uint64_t exhausted;           /** Allocations out of the pool. */
+};
+
+static struct pktbuf_node pktbuf_nodes[PKTBUF_MAX_NODES] = {
+  [0 ... PKTBUF_MAX_NODES - 1] = { PTHREAD_MUTEX_INITIALIZER, NULL, 0 }
+};
+static struct pktbuf_cache *pktbuf_caches;
+static uint64_t pktbuf_pool_size;
+static pthread_once_t pktbuf_once = PTHREAD_ONCE_INIT;
+static pthread_key_t pktbuf_key;
+static __thread struct pktbuf_cache *pktbuf_cache;
+
+static int
+pktbuf_current_node(void) {
+#ifdef SYS_getcpu
+  unsigned cpu, node;
+
+  if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0 &&
+      node < PKTBUF_MAX_NODES) {
+    return (int)node;
+  }
+#endif /* SYS_getcpu */
+  return 0;
+}
+
+static void
+pktbuf_node_put(int node, OS_MBUF *head, OS_MBUF *tail, unsigned count) {
+  struct pktbuf_node *pn;
+
+  pn = &pktbuf_nodes[node];
+  pthread_mutex_lock(&pn->lock);
+  tail->next = pn->head;
+  pn->head = head;
+  pn->count += count;
+  pthread_mutex_unlock(&pn->lock);
+}
+
+/*
+ * cached buffers of the exiting thread go back to the node.
+ * the cache is kept for statistics.
+ */
+static void
+pktbuf_cache_flush(void *arg) {
+  struct pktbuf_cache *cache = arg;
+  OS_MBUF *tail;
+
+  if (cache->head != NULL) {
+    for (tail = cache->head; tail->next != NULL; tail = tail->next) {
+      continue;
+    }
+    pktbuf_node_put(cache->node, cache->head, tail, cache->count);
+    cache->head = NULL;
+    cache->count = 0;
+  }
+}
+
+static void
+pktbuf_key_create(void) {
+  (void)pthread_key_create(&pktbuf_key, pktbuf_cache_flush);
+}
+
+static struct pktbuf_cache *
+pktbuf_cache_get(void) {
+  struct pktbuf_cache *cache;
+
+  if (likely(pktbuf_cache != NULL)) {
+    return pktbuf_cache;
+  }
+  cache = calloc(1, sizeof(struct pktbuf_cache));
+  if (cache == NULL) {
+    return NULL;
+  }
+  cache->node = pktbuf_current_node();
+  do {
+    cache->next = pktbuf_caches;
+  } while (__sync_bool_compare_and_swap(&pktbuf_caches,
+                                        cache->next, cache) == false);
+  (void)pthread_once(&pktbuf_once, pktbuf_key_create);
+  (void)pthread_setspecific(pktbuf_key, cache);
+  pktbuf_cache = cache;
+  return cache;
+}
+
+/*
+ * buffers of a new chunk are first touched by the thread of the node.
+ */
+static bool
+pktbuf_chunk_alloc(struct pktbuf_node *pn, int node) {
+  uint8_t *chunk;
+  OS_MBUF *m;
+  int i;
+
+  if (__sync_add_and_fetch(&pktbuf_pool_size, PKTBUF_CHUNK) >
+      PKTBUF_POOL_MAX) {
+    (void)__sync_sub_and_fetch(&pktbuf_pool_size, PKTBUF_CHUNK);
+    return false;
+  }
+  chunk = calloc(PKTBUF_CHUNK, PKTBUF_SIZE);
+  if (chunk == NULL) {
+    (void)__sync_sub_and_fetch(&pktbuf_pool_size, PKTBUF_CHUNK);
+    return false;
+  }
+  for (i = 0; i < PKTBUF_CHUNK; i++) {
+    m = (OS_MBUF *)(chunk + PKTBUF_SIZE * (size_t)i);
+    m->node = node;
+    m->next = pn->head;
+    pn->head = m;
+  }
+  pn->count += PKTBUF_CHUNK;
+  return true;
+}
+
+static void
+pktbuf_cache_fill(struct pktbuf_cache *cache) {
+  struct pktbuf_node *pn;
+  OS_MBUF *m;
+
+  pn = &pktbuf_nodes[cache->node];
+  pthread_mutex_lock(&pn->lock);
+  if (pn->head != NULL || pktbuf_chunk_alloc(pn, cache->node) == true) {
+    while (cache->count < PKTBUF_BATCH && (m = pn->head) != NULL) {
+      pn->head = m->next;
+      pn->count--;
+      m->next = cache->head;
+      cache->head = m;
+      cache->count++;
+    }
+  }
+  pthread_mutex_unlock(&pn->lock);
+}
+
+static OS_MBUF *
+pktbuf_alloc(void) {
+  struct pktbuf_cache *cache;
+  OS_MBUF *m;
+
+  cache = pktbuf_cache_get();
+  if (unlikely(cache == NULL)) {
+    return NULL;
+  }
+  if (cache->head == NULL) {
+    pktbuf_cache_fill(cache);
+  }
+  m = cache->head;
+  if (likely(m != NULL)) {
+    cache->head = m->next;
+    cache->count--;
+    cache->allocs++;
+    return m;
+  }
+  cache->exhausted++;
+  m = malloc(PKTBUF_SIZE);
+  if (m != NULL) {
+    m->node = -1;
+  }
+  return m;
+}
+
+static void
+pktbuf_free(OS_MBUF *m) {
+  struct pktbuf_cache *cache;
+  OS_MBUF *tail;
+  unsigned n;
+
+  if (m->node < 0) {
+    free(m);
+    return;
+  }
+  cache = pktbuf_cache_get();
+  if (unlikely(cache == NULL || cache->node != m->node)) {
+    pktbuf_node_put(m->node, m, m, 1);
+    if (cache != NULL) {
+      cache->frees++;
+    }
+    return;
+  }
+  cache->frees++;
+  m->next = cache->head;
+  cache->head = m;
+  if (++cache->count > PKTBUF_CACHE_SIZE) {
+    /* return a batch from the head, keep the rest. */
+    tail = cache->head;
+    for (n = 1; n < PKTBUF_BATCH; n++) {
+      tail = tail->next;
+    }
+    m = cache->head;
+    cache->head = tail->next;
+    cache->count -= PKTBUF_BATCH;
+    pktbuf_node_put(cache->node, m, tail, PKTBUF_BATCH);
+  }
+}
+
+struct lagopus_packet *
+alloc_lagopus_packet(void) {
+  struct lagopus_packet *pkt;
+  OS_MBUF *m;
+
+  m = pktbuf_alloc();
+  if (m == NULL) {
+    lagopus_msg_error("mbuf alloc failed\n");
+    return NULL;
+  }
+  m->len = 0;
+  m->data = &m->dat[128];
+  m->refcnt = 0;
+  m->next = NULL;
+  pkt = MBUF2PKT(m);
+  /* matched flows are valid up to nmatched. */
+  memset(pkt, 0, offsetof(struct lagopus_packet, matched_flow));
+  memset(&pkt->table_id, 0,
+         sizeof(*pkt) - offsetof(struct lagopus_packet, table_id));
+
+  return pkt;
+}
+
+void
+sock_m_free(OS_MBUF *m) {
+  if (__sync_fetch_and_sub(&m->refcnt, 1) <= 0) {
+    pktbuf_free(m);
+  }
+}
+
+void
+lagopus_packet_free(struct lagopus_packet *pkt) {
+  OS_M_FREE(PKT2MBUF(pkt));
+}
+
+void
+dp_get_pktbuf_statistics(struct dp_pktbuf_stats *st) {
+  struct pktbuf_cache *cache;
+  uint64_t allocs, frees;
+
+  allocs = frees = 0;
+  st->exhausted = 0;
+  for (cache = pktbuf_caches; cache != NULL; cache = cache->next) {
+    allocs += cache->allocs;
+    frees += cache->frees;
+    st->exhausted += cache->exhausted;
+  }
+  st->size = pktbuf_pool_size;
+  st->in_use = allocs - frees;
+}
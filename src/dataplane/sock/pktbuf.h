@@ -39,7 +39,9 @@
 struct sock_buf {
   size_t len;
   unsigned char *data;
-  int refcnt;
+  int refcnt;                   /** Number of references - 1, atomic. */
+  int node;                     /** NUMA node of the pool, or -1. */
+  struct sock_buf *next;        /** Next buffer in the free list. */
   unsigned char dat[MAX_PACKET_SZ + 128];
 };
 
@@ -51,7 +53,7 @@ struct sock_buf {
 #define OS_M_TRIM(m,n)    ((m)->len -= (n))
 #define OS_M_FREE(m)      sock_m_free(m)
 #define OS_MTOD(m,type)   ((type)(m)->data)
-#define OS_M_ADDREF(m)    ((m)->refcnt++)
+#define OS_M_ADDREF(m)    ((void)__sync_add_and_fetch(&(m)->refcnt, 1))
 #define OS_NTOHS ntohs
 #define OS_NTOHL ntohl
 #ifdef LAGOPUS_BIG_ENDIAN
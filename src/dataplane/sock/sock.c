@@ -34,7 +34,6 @@
 
 #include "lagopus/dp_apis.h"
 #include "lagopus/flowdb.h"
-#include "lagopus/meter.h"
 #include "lagopus/ofp_dp_apis.h"
 #include "lagopus/port.h"
 #include "lagopus/dataplane.h"
@@ -43,34 +42,7 @@
 #include "pktbuf.h"
 #include "packet.h"
 #include "pcap.h"
-
-struct lagopus_packet *
-alloc_lagopus_packet(void) {
-  struct lagopus_packet *pkt;
-  OS_MBUF *m;
-
-  m = calloc(1, sizeof(*m) + sizeof(*pkt));
-  if (m == NULL) {
-    lagopus_msg_error("mbuf alloc failed\n");
-    return NULL;
-  }
-  pkt = (struct lagopus_packet *)&m[1];
-  m->data = &m->dat[128];
-
-  return pkt;
-}
-
-void
-sock_m_free(OS_MBUF *m) {
-  if (m->refcnt-- <= 0) {
-    free(m);
-  }
-}
-
-void
-lagopus_packet_free(struct lagopus_packet *pkt) {
-  OS_M_FREE(PKT2MBUF(pkt));
-}
+#include "mgr/sock_io.h"
 
 void
 lagopus_instruction_experimenter(__UNUSED struct lagopus_packet *pkt,
@@ -78,23 +50,27 @@ lagopus_instruction_experimenter(__UNUSED struct lagopus_packet *pkt,
   /* writing your own instruction */
 }
 
-int
-lagopus_meter_packet(__UNUSED struct lagopus_packet *pkt,
-                     __UNUSED struct meter *meter,
-                     __UNUSED uint8_t *prec_level) {
-  /* XXX not implemented */
-  return 0;
-}
-
 void
-lagopus_meter_init(void) {
-  /* XXX not implemented */
+dp_get_flowcache_statistics(struct bridge *bridge, struct ofcachestat *st) {
+  (void) bridge;
+
+  rawsock_get_flowcache_statistics(st);
 }
 
-void
-dp_get_flowcache_statistics(struct bridge *bridge, struct ofcachestat *st) {
-  st->nentries = 0;
-  st->hit = 0;
-  st->miss = 0;
-  /* not implemented yet */
+size_t
+dp_get_worker_statistics(struct dp_worker_stats *st, size_t n) {
+  struct rawsock_worker_stats s;
+  unsigned int i;
+
+  for (i = 0; i < rawsock_worker_count() && i < n; i++) {
+    if (rawsock_get_worker_stats(i, &s) != LAGOPUS_RESULT_OK) {
+      break;
+    }
+    st[i].rx_packets = s.rx_packets;
+    st[i].rx_bytes = s.rx_bytes;
+    st[i].tx_packets = s.tx_packets;
+    st[i].tx_dropped = s.tx_dropped;
+    st[i].polls = s.polls;
+  }
+  return i;
 }
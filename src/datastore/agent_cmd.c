@@ -20,27 +20,89 @@
 #define AGENT_CMD_NAME "agent"
 #define OPT_CHANNELQ_SIZE "-channelq-size"
 #define OPT_CHANNELQ_MAX_BATCHES "-channelq-max-batches"
+#define OPT_HANDLER_THREADS "-handler-threads"
 #define STATS_CHANNLEQ_ENTRIES "*channleq-entries"
+#define STATS_HANDLER_THREADS "*handler-threads"
+#define STATS_BRIDGES "*bridges"
+#define STATS_CHANNELQ_ENTRIES "*channelq-entries"
+#define STATS_EVENTQ_ENTRIES "*eventq-entries"
+#define STATS_DATAQ_ENTRIES "*dataq-entries"
+#define STATS_REQUESTS "*requests"
+#define STATS_ECHO_REQUESTS "*echo-requests"
+#define STATS_LATENCY_AVG "*latency-avg"
+#define STATS_LATENCY_MAX "*latency-max"
+
+static inline lagopus_result_t
+agent_cmd_thread_stats(lagopus_dstring_t *ds) {
+  lagopus_result_t ret = LAGOPUS_RESULT_ANY_FAILURES;
+  struct ofp_handler_stats stats;
+  uint16_t i;
+
+  for (i = 0; i < OFP_HANDLER_THREADS_MAX; i++) {
+    if ((ret = ofp_handler_thread_stats_get(i, &stats)) !=
+        LAGOPUS_RESULT_OK) {
+      break;
+    }
+    ret = lagopus_dstring_appendf(
+        ds,
+        "%s{\"%s\":%"PRIu64",\n"
+        "\"%s\":%"PRIu64",\n"
+        "\"%s\":%"PRIu64",\n"
+        "\"%s\":%"PRIu64",\n"
+        "\"%s\":%"PRIu64",\n"
+        "\"%s\":%"PRIu64",\n"
+        "\"%s\":%"PRIu64",\n"
+        "\"%s\":%"PRIu64"}",
+        (i == 0) ? "" : ",\n",
+        ATTR_NAME_GET_FOR_STR(STATS_BRIDGES), stats.bridges,
+        ATTR_NAME_GET_FOR_STR(STATS_CHANNELQ_ENTRIES), stats.channelq_entries,
+        ATTR_NAME_GET_FOR_STR(STATS_EVENTQ_ENTRIES), stats.eventq_entries,
+        ATTR_NAME_GET_FOR_STR(STATS_DATAQ_ENTRIES), stats.dataq_entries,
+        ATTR_NAME_GET_FOR_STR(STATS_REQUESTS), stats.requests,
+        ATTR_NAME_GET_FOR_STR(STATS_ECHO_REQUESTS), stats.echo_requests,
+        ATTR_NAME_GET_FOR_STR(STATS_LATENCY_AVG), stats.latency_avg,
+        ATTR_NAME_GET_FOR_STR(STATS_LATENCY_MAX), stats.latency_max);
+    if (ret != LAGOPUS_RESULT_OK) {
+      return ret;
+    }
+  }
+  /* the end of running threads. */
+  if (ret == LAGOPUS_RESULT_OUT_OF_RANGE) {
+    ret = LAGOPUS_RESULT_OK;
+  }
+
+  return ret;
+}
 
 static inline lagopus_result_t
 agent_cmd_stats(lagopus_dstring_t *result) {
   lagopus_result_t ret = LAGOPUS_RESULT_ANY_FAILURES;
   uint16_t stats = 0;
+  lagopus_dstring_t ds = NULL;
+  char *str = NULL;
 
   if ((ret = ofp_handler_channelq_stats_get(&stats)) ==
-      LAGOPUS_RESULT_OK) {
+      LAGOPUS_RESULT_OK &&
+      (ret = lagopus_dstring_create(&ds)) == LAGOPUS_RESULT_OK &&
+      (ret = agent_cmd_thread_stats(&ds)) == LAGOPUS_RESULT_OK &&
+      (ret = lagopus_dstring_str_get(&ds, &str)) == LAGOPUS_RESULT_OK) {
     ret = datastore_json_result_setf(
         result,
         LAGOPUS_RESULT_OK,
-        "[{\"%s\":%"PRIu16"}]",
+        "[{\"%s\":%"PRIu16",\n"
+        "\"%s\":[%s]}]",
         ATTR_NAME_GET_FOR_STR(STATS_CHANNLEQ_ENTRIES),
-        stats);
+        stats,
+        ATTR_NAME_GET_FOR_STR(STATS_HANDLER_THREADS),
+        str);
   } else {
     ret = datastore_json_result_string_setf(
         result,
         ret,
         "Can't get channelq stats.");
   }
+  lagopus_dstring_destroy(&ds);
+  free(str);
 
   return ret;
 }
@@ -50,16 +112,20 @@ agent_cmd_current_all(lagopus_dstring_t *result) {
   lagopus_result_t ret = LAGOPUS_RESULT_ANY_FAILURES;
   uint16_t channelq_size = ofp_handler_channelq_size_get();
   uint16_t channelq_max_batches = ofp_handler_channelq_max_batches_get();
+  uint16_t handler_threads = ofp_handler_threads_get();
 
   ret = datastore_json_result_setf(
       result,
       LAGOPUS_RESULT_OK,
       "[{\"%s\":%"PRIu16",\n"
+      "\"%s\":%"PRIu16",\n"
       "\"%s\":%"PRIu16"}]",
       ATTR_NAME_GET_FOR_STR(OPT_CHANNELQ_SIZE),
       channelq_size,
       ATTR_NAME_GET_FOR_STR(OPT_CHANNELQ_MAX_BATCHES),
-      channelq_max_batches);
+      channelq_max_batches,
+      ATTR_NAME_GET_FOR_STR(OPT_HANDLER_THREADS),
+      handler_threads);
   return ret;
 }
 
@@ -91,6 +157,20 @@ agent_cmd_current_channelq_max_batches(lagopus_dstring_t *result) {
   return ret;
 }
 
+static inline lagopus_result_t
+agent_cmd_current_handler_threads(lagopus_dstring_t *result) {
+  lagopus_result_t ret = LAGOPUS_RESULT_ANY_FAILURES;
+  uint16_t handler_threads = ofp_handler_threads_get();
+
+  ret = datastore_json_result_setf(
+      result,
+      LAGOPUS_RESULT_OK,
+      "[{\"%s\":%"PRIu16"}]",
+      ATTR_NAME_GET_FOR_STR(OPT_HANDLER_THREADS),
+      handler_threads);
+  return ret;
+}
+
 static inline lagopus_result_t
 agent_cmd_opt_parse_channelq_size(datastore_interp_state_t state,
                                   const char *const argv[],
@@ -151,6 +231,42 @@ agent_cmd_opt_parse_channelq_max_batches(datastore_interp_state_t state,
   return ret;
 }
 
+static inline lagopus_result_t
+agent_cmd_opt_parse_handler_threads(datastore_interp_state_t state,
+                                    const char *const argv[],
+                                    lagopus_dstring_t *result) {
+  lagopus_result_t ret = LAGOPUS_RESULT_ANY_FAILURES;
+  uint16_t val = 0;
+
+  if (IS_VALID_STRING(*argv) == true) {
+    if ((ret = lagopus_str_parse_uint16(*argv, &val)) ==
+        LAGOPUS_RESULT_OK) {
+      if (val >= 1 && val <= OFP_HANDLER_THREADS_MAX) {
+        if (state != DATASTORE_INTERP_STATE_DRYRUN) {
+          ret = ofp_handler_threads_set(val);
+        }
+      } else {
+        ret = datastore_json_result_string_setf(result,
+                                                LAGOPUS_RESULT_OUT_OF_RANGE,
+                                                "Bad opt value = %s",
+                                                *argv);
+      }
+    } else {
+      ret = datastore_json_result_string_setf(result,
+                                              LAGOPUS_RESULT_INVALID_ARGS,
+                                              "can't parse '%s' as a "
+                                              "uint16_t integer.",
+                                              *argv);
+    }
+  } else {
+    ret = datastore_json_result_string_setf(result,
+                                            LAGOPUS_RESULT_INVALID_ARGS,
+                                            "Bad opt value = %s",
+                                            *argv);
+  }
+  return ret;
+}
+
 static inline lagopus_result_t
 s_parse_agent(datastore_interp_t *iptr,
               datastore_interp_state_t state,
@@ -206,6 +322,16 @@ s_parse_agent(datastore_interp_t *iptr,
           } else {
             return agent_cmd_current_channelq_max_batches(result);
           }
+        } else if (strcmp(*argv, OPT_HANDLER_THREADS) == 0) {
+          argv++;
+          if (IS_VALID_STRING(*argv) == true) {
+            ret = agent_cmd_opt_parse_handler_threads(state, argv, result);
+            if (ret != LAGOPUS_RESULT_OK) {
+              return ret;
+            }
+          } else {
+            return agent_cmd_current_handler_threads(result);
+          }
         } else {
           return datastore_json_result_string_setf(
               result,
@@ -227,6 +353,7 @@ agent_cmd_serialize(lagopus_dstring_t *result) {
   lagopus_result_t ret = LAGOPUS_RESULT_ANY_FAILURES;
   uint16_t channelq_size = ofp_handler_channelq_size_get();
   uint16_t channelq_max_batches = ofp_handler_channelq_max_batches_get();
+  uint16_t handler_threads = ofp_handler_threads_get();
 
   if (result != NULL) {
     /* cmmand name. */
@@ -264,6 +391,20 @@ agent_cmd_serialize(lagopus_dstring_t *result) {
       goto done;
     }
 
+    /* handler-threads opt. */
+    if ((ret = lagopus_dstring_appendf(result, " "OPT_HANDLER_THREADS)) ==
+        LAGOPUS_RESULT_OK) {
+      if ((ret = lagopus_dstring_appendf(result, " %"PRIu16,
+                                         handler_threads)) !=
+          LAGOPUS_RESULT_OK) {
+        lagopus_perror(ret);
+        goto done;
+      }
+    } else {
+      lagopus_perror(ret);
+      goto done;
+    }
+
     /* Add newline. */
     if ((ret = lagopus_dstring_appendf(result, "\n\n")) !=
         LAGOPUS_RESULT_OK) {
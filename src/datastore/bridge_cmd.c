@@ -114,11 +114,24 @@ enum bridge_stats {
   STATS_FLOWCACHE_ENTRIES,
   STATS_FLOWCACHE_HIT,
   STATS_FLOWCACHE_MISS,
+  STATS_FLOWCACHE_INVALIDATED,
   STATS_FLOW_ENTRIES,
   STATS_FLOW_LOOKUP_COUNT,
   STATS_FLOW_MATCHED_COUNT,
+  STATS_PACKET_IN_DROPS,
+  STATS_PKTBUF_POOL_SIZE,
+  STATS_PKTBUF_POOL_IN_USE,
+  STATS_PKTBUF_POOL_EXHAUSTED,
+  STATS_WORKER_IMBALANCE,
   STATS_TABLES,
   STATS_TABLE_ID,
+  STATS_WORKERS,
+  STATS_WORKER_ID,
+  STATS_RX_PACKETS,
+  STATS_RX_BYTES,
+  STATS_TX_PACKETS,
+  STATS_TX_DROPPED,
+  STATS_POLLS,
 
   STATS_MAX,
 };
@@ -186,11 +199,24 @@ static const char *const stat_strs[STATS_MAX] = {
   "*flowcache-entries",       /* STATS_FLOWCACHE_ENTRIES (not option) */
   "*flowcache-hit",           /* STATS_FLOWCACHE_HIT (not option) */
   "*flowcache-miss",          /* STATS_FLOWCACHE_MISS (not option) */
+  "*flowcache-invalidated",   /* STATS_FLOWCACHE_INVALIDATED (not option) */
   "*flow-entries",            /* STATS_FLOW_ENTRIES (not option) */
   "*flow-lookup-count",       /* STATS_FLOW_LOOKUP_COUNT (not option) */
   "*flow-matched-count",      /* STATS_FLOW_MATCHED_COUNT (not option) */
+  "*packet-in-drops",         /* STATS_PACKET_IN_DROPS (not option) */
+  "*pktbuf-pool-size",        /* STATS_PKTBUF_POOL_SIZE (not option) */
+  "*pktbuf-pool-in-use",      /* STATS_PKTBUF_POOL_IN_USE (not option) */
+  "*pktbuf-pool-exhausted",   /* STATS_PKTBUF_POOL_EXHAUSTED (not option) */
+  "*worker-imbalance",        /* STATS_WORKER_IMBALANCE (not option) */
   "*tables",                  /* STATS_TABLES (not option) */
   "*table-id",                /* STATS_TABLE_ID (not option) */
+  "*workers",                 /* STATS_WORKERS (not option) */
+  "*worker-id",               /* STATS_WORKER_ID (not option) */
+  "*rx-packets",              /* STATS_RX_PACKETS (not option) */
+  "*rx-bytes",                /* STATS_RX_BYTES (not option) */
+  "*tx-packets",              /* STATS_TX_PACKETS (not option) */
+  "*tx-dropped",              /* STATS_TX_DROPPED (not option) */
+  "*polls",                   /* STATS_POLLS (not option) */
 };
 
 typedef struct configs {
@@ -5841,6 +5867,88 @@ done:
   return ret;
 }
 
+static inline lagopus_result_t
+bridge_cmd_stats_worker(lagopus_dstring_t *ds,
+                        configs_t *configs) {
+  lagopus_result_t ret = LAGOPUS_RESULT_OK;
+  datastore_bridge_worker_stats_t *worker_stats = NULL;
+  uint32_t i;
+
+  for (i = 0; i < configs->stats.worker_count; i++) {
+    worker_stats = &configs->stats.workers[i];
+    if ((ret = lagopus_dstring_appendf(
+            ds, DS_JSON_DELIMITER(i == 0, "{"))) !=
+        LAGOPUS_RESULT_OK) {
+      lagopus_perror(ret);
+      goto done;
+    }
+
+    /* worker_id */
+    if ((ret = datastore_json_uint32_append(
+            ds, ATTR_NAME_GET(stat_strs, STATS_WORKER_ID),
+            i, false)) !=
+        LAGOPUS_RESULT_OK) {
+      lagopus_perror(ret);
+      goto done;
+    }
+
+    /* rx_packets */
+    if ((ret = datastore_json_uint64_append(
+            ds, ATTR_NAME_GET(stat_strs, STATS_RX_PACKETS),
+            worker_stats->rx_packets, true)) !=
+        LAGOPUS_RESULT_OK) {
+      lagopus_perror(ret);
+      goto done;
+    }
+
+    /* rx_bytes */
+    if ((ret = datastore_json_uint64_append(
+            ds, ATTR_NAME_GET(stat_strs, STATS_RX_BYTES),
+            worker_stats->rx_bytes, true)) !=
+        LAGOPUS_RESULT_OK) {
+      lagopus_perror(ret);
+      goto done;
+    }
+
+    /* tx_packets */
+    if ((ret = datastore_json_uint64_append(
+            ds, ATTR_NAME_GET(stat_strs, STATS_TX_PACKETS),
+            worker_stats->tx_packets, true)) !=
+        LAGOPUS_RESULT_OK) {
+      lagopus_perror(ret);
+      goto done;
+    }
+
+    /* tx_dropped */
+    if ((ret = datastore_json_uint64_append(
+            ds, ATTR_NAME_GET(stat_strs, STATS_TX_DROPPED),
+            worker_stats->tx_dropped, true)) !=
+        LAGOPUS_RESULT_OK) {
+      lagopus_perror(ret);
+      goto done;
+    }
+
+    /* polls */
+    if ((ret = datastore_json_uint64_append(
+            ds, ATTR_NAME_GET(stat_strs, STATS_POLLS),
+            worker_stats->polls, true)) !=
+        LAGOPUS_RESULT_OK) {
+      lagopus_perror(ret);
+      goto done;
+    }
+
+    if ((ret = lagopus_dstring_appendf(
+            ds, "}")) !=
+        LAGOPUS_RESULT_OK) {
+      lagopus_perror(ret);
+      goto done;
+    }
+  }
+
+done:
+  return ret;
+}
+
 static lagopus_result_t
 bridge_cmd_stats_json_create(lagopus_dstring_t *ds,
                              configs_t *configs,
@@ -5915,6 +6023,15 @@ bridge_cmd_stats_json_create(lagopus_dstring_t *ds,
           goto done;
         }
 
+        /* flowcache_invalidated */
+        if ((ret = datastore_json_uint64_append(
+                ds, ATTR_NAME_GET(stat_strs, STATS_FLOWCACHE_INVALIDATED),
+                configs->stats.flowcache_invalidated, true)) !=
+            LAGOPUS_RESULT_OK) {
+          lagopus_perror(ret);
+          goto done;
+        }
+
         /* flow_entries */
         if ((ret = datastore_json_uint64_append(
                 ds, ATTR_NAME_GET(stat_strs, STATS_FLOW_ENTRIES),
@@ -5942,6 +6059,51 @@ bridge_cmd_stats_json_create(lagopus_dstring_t *ds,
           goto done;
         }
 
+        /* packet_in_drops */
+        if ((ret = datastore_json_uint64_append(
+                ds, ATTR_NAME_GET(stat_strs, STATS_PACKET_IN_DROPS),
+                configs->stats.packet_in_drops, true)) !=
+            LAGOPUS_RESULT_OK) {
+          lagopus_perror(ret);
+          goto done;
+        }
+
+        /* pktbuf_pool_size */
+        if ((ret = datastore_json_uint64_append(
+                ds, ATTR_NAME_GET(stat_strs, STATS_PKTBUF_POOL_SIZE),
+                configs->stats.pktbuf_pool_size, true)) !=
+            LAGOPUS_RESULT_OK) {
+          lagopus_perror(ret);
+          goto done;
+        }
+
+        /* pktbuf_pool_in_use */
+        if ((ret = datastore_json_uint64_append(
+                ds, ATTR_NAME_GET(stat_strs, STATS_PKTBUF_POOL_IN_USE),
+                configs->stats.pktbuf_pool_in_use, true)) !=
+            LAGOPUS_RESULT_OK) {
+          lagopus_perror(ret);
+          goto done;
+        }
+
+        /* pktbuf_pool_exhausted */
+        if ((ret = datastore_json_uint64_append(
+                ds, ATTR_NAME_GET(stat_strs, STATS_PKTBUF_POOL_EXHAUSTED),
+                configs->stats.pktbuf_pool_exhausted, true)) !=
+            LAGOPUS_RESULT_OK) {
+          lagopus_perror(ret);
+          goto done;
+        }
+
+        /* worker_imbalance */
+        if ((ret = datastore_json_uint64_append(
+                ds, ATTR_NAME_GET(stat_strs, STATS_WORKER_IMBALANCE),
+                configs->stats.worker_imbalance, true)) !=
+            LAGOPUS_RESULT_OK) {
+          lagopus_perror(ret);
+          goto done;
+        }
+
         /* tables */
         if ((ret = lagopus_dstring_appendf(
                 ds, DELIMITER_INSTERN(KEY_FMT "["),
@@ -5965,6 +6127,29 @@ bridge_cmd_stats_json_create(lagopus_dstring_t *ds,
           goto done;
         }
 
+        /* workers */
+        if ((ret = lagopus_dstring_appendf(
+                ds, DELIMITER_INSTERN(KEY_FMT "["),
+                ATTR_NAME_GET(stat_strs, STATS_WORKERS))) !=
+            LAGOPUS_RESULT_OK) {
+          lagopus_perror(ret);
+          goto done;
+        }
+
+        /* worker */
+        if ((ret = bridge_cmd_stats_worker(ds, configs)) !=
+            LAGOPUS_RESULT_OK) {
+          lagopus_perror(ret);
+          goto done;
+        }
+
+        if ((ret = lagopus_dstring_appendf(
+                ds, "]")) !=
+            LAGOPUS_RESULT_OK) {
+          lagopus_perror(ret);
+          goto done;
+        }
+
         if ((ret = lagopus_dstring_appendf(ds, "}")) != LAGOPUS_RESULT_OK) {
           goto done;
         }
@@ -6000,7 +6185,8 @@ bridge_cmd_parse(datastore_interp_t *iptr,
   size_t i;
   void *sub_cmd_proc;
   configs_t out_configs = {0, 0LL, false, false, false,
-                           {0LL, 0LL, 0LL, 0LL, 0LL, 0LL, 0LL, 0LL, 0LL, {0LL}},
+                           {0LL, 0LL, 0LL, 0LL, 0LL, 0LL, 0LL, 0LL, 0LL, 0LL,
+                            0LL, 0LL, 0LL, 0LL, 0LL, 0, {{0LL}}, {0LL}},
                            NULL};
   char *name = NULL;
   char *fullname = NULL;
@@ -21,16 +21,21 @@
 #include "flow_cmd_internal.h"
 #include "conv_json.h"
 #include "flow_cmd_type.h"
+#include "lagopus/dp_apis.h"
 
 /* command name. */
 #define CMD_NAME "flow"
 
+/* sub command name. */
+#define CLASSIFIER_SUB_CMD "classifier"
+
 /* option num. */
 enum flow_opts {
   OPT_NAME = 0,
   OPT_TABLE_ID,
   OPT_TMP_DIR,
   OPT_WITH_STATS,
+  OPT_TYPE,
 
   OPT_MAX,
 };
@@ -41,11 +46,23 @@ static const char *const opt_strs[OPT_MAX] = {
   "-table-id",           /* OPT_TABLE_ID */
   "-tmp-dir",            /* OPT_TMP_DIR */
   "-with-stats",         /* OPT_WITH_STATS */
+  "-type",               /* OPT_TYPE */
+};
+
+/* classifier name. */
+static const char *const classifier_strs[] = {
+  "unknown",             /* DATASTORE_BRIDGE_TABLE_CLASSIFIER_UNKNOWN */
+  "flowinfo",            /* DATASTORE_BRIDGE_TABLE_CLASSIFIER_FLOWINFO */
+  "mbtree",              /* DATASTORE_BRIDGE_TABLE_CLASSIFIER_MBTREE */
+  "thtable",             /* DATASTORE_BRIDGE_TABLE_CLASSIFIER_THTABLE */
+  "exact",               /* DATASTORE_BRIDGE_TABLE_CLASSIFIER_EXACT */
+  "auto",                /* DATASTORE_BRIDGE_TABLE_CLASSIFIER_AUTO */
 };
 
 typedef struct flow_conf {
   char *name;
   uint8_t table_id;
+  datastore_bridge_table_classifier_t classifier;
 } flow_conf_t;
 
 typedef struct configs {
@@ -57,6 +74,7 @@ static lagopus_hashmap_t sub_cmd_table = NULL;
 static lagopus_hashmap_t sub_cmd_not_name_table = NULL;
 static lagopus_hashmap_t dump_opt_table = NULL;
 static lagopus_hashmap_t config_opt_table = NULL;
+static lagopus_hashmap_t classifier_opt_table = NULL;
 
 #include "flow_cmd_dump.c"
 #include "flow_cmd_mod.c"
@@ -119,6 +137,48 @@ with_stats_opt_parse(const char *const *argv[],
   return ret;
 }
 
+static lagopus_result_t
+type_opt_parse(const char *const *argv[],
+               void *c, void *out_configs,
+               lagopus_dstring_t *result) {
+  lagopus_result_t ret = LAGOPUS_RESULT_ANY_FAILURES;
+  flow_conf_t *conf = NULL;
+  size_t i;
+
+  if (argv != NULL && c != NULL &&
+      out_configs != NULL && result != NULL) {
+    conf = (flow_conf_t *) c;
+
+    if (*(*argv + 1) != NULL) {
+      (*argv)++;
+      for (i = DATASTORE_BRIDGE_TABLE_CLASSIFIER_MIN + 1;
+           i <= DATASTORE_BRIDGE_TABLE_CLASSIFIER_MAX; i++) {
+        if (strcmp(*(*argv), classifier_strs[i]) == 0) {
+          conf->classifier = (datastore_bridge_table_classifier_t) i;
+          ret = LAGOPUS_RESULT_OK;
+          break;
+        }
+      }
+      if (ret != LAGOPUS_RESULT_OK) {
+        ret = datastore_json_result_string_setf(result,
+                                                LAGOPUS_RESULT_INVALID_ARGS,
+                                                "Bad opt value = %s.",
+                                                *(*argv));
+      }
+    } else {
+      ret = datastore_json_result_string_setf(result,
+                                              LAGOPUS_RESULT_INVALID_ARGS,
+                                              "Bad opt value.");
+    }
+  } else {
+    ret = datastore_json_result_set(result,
+                                    LAGOPUS_RESULT_INVALID_ARGS,
+                                    NULL);
+  }
+
+  return ret;
+}
+
 static lagopus_result_t
 tmp_dir_opt_parse(const char *const *argv[],
                   void *c, void *out_configs,
@@ -481,6 +541,183 @@ del_sub_cmd_parse(datastore_interp_t *iptr,
   return ret;
 }
 
+static lagopus_result_t
+classifier_json_append(const char *name, uint8_t table_id,
+                       bool delimiter, lagopus_dstring_t *result) {
+  lagopus_result_t ret = LAGOPUS_RESULT_ANY_FAILURES;
+  datastore_bridge_table_classifier_t classifier, current;
+
+  if ((ret = dp_bridge_table_classifier_get(name, table_id,
+                                            &classifier, &current)) !=
+      LAGOPUS_RESULT_OK) {
+    goto done;
+  }
+  if ((ret = lagopus_dstring_appendf(result, "%s{",
+                                     delimiter == true ? "," : "")) !=
+      LAGOPUS_RESULT_OK) {
+    lagopus_perror(ret);
+    goto done;
+  }
+  if ((ret = datastore_json_uint8_append(
+               result, ATTR_NAME_GET(opt_strs, OPT_TABLE_ID),
+               table_id, false)) !=
+      LAGOPUS_RESULT_OK) {
+    lagopus_perror(ret);
+    goto done;
+  }
+  if ((ret = datastore_json_string_append(
+               result, ATTR_NAME_GET(opt_strs, OPT_TYPE),
+               classifier_strs[classifier], true)) !=
+      LAGOPUS_RESULT_OK) {
+    lagopus_perror(ret);
+    goto done;
+  }
+  if ((ret = datastore_json_string_append(
+               result, "current-type",
+               classifier_strs[current], true)) !=
+      LAGOPUS_RESULT_OK) {
+    lagopus_perror(ret);
+    goto done;
+  }
+  if ((ret = lagopus_dstring_appendf(result, "}")) !=
+      LAGOPUS_RESULT_OK) {
+    lagopus_perror(ret);
+    goto done;
+  }
+
+done:
+  return ret;
+}
+
+/*
+ * flow <name> classifier [-table-id <id>] [-type <type>]
+ *   set lookup engine of the table, and show engines of the tables.
+ */
+static lagopus_result_t
+classifier_sub_cmd_parse(datastore_interp_t *iptr,
+                         datastore_interp_state_t state,
+                         size_t argc, const char *const argv[],
+                         char *name,
+                         lagopus_hashmap_t *hptr,
+                         datastore_update_proc_t proc,
+                         void *out_configs,
+                         lagopus_dstring_t *result) {
+  lagopus_result_t ret = LAGOPUS_RESULT_ANY_FAILURES;
+  flow_conf_t conf = {NULL, OFPTT_ALL,
+                      DATASTORE_BRIDGE_TABLE_CLASSIFIER_UNKNOWN
+                     };
+  void *opt_proc;
+  bool delimiter;
+  int i;
+  (void) state;
+  (void) argc;
+  (void) hptr;
+  (void) proc;
+
+  if (iptr != NULL && argv != NULL && name != NULL &&
+      out_configs != NULL && result != NULL) {
+    if (bridge_exists(name) == false) {
+      ret = datastore_json_result_string_setf(result,
+                                              LAGOPUS_RESULT_NOT_FOUND,
+                                              "Not found. name = %s.",
+                                              name);
+      goto done;
+    }
+    conf.name = name;
+
+    argv++;
+    while (*argv != NULL) {
+      if (IS_VALID_STRING(*(argv)) == true) {
+        if ((ret = lagopus_hashmap_find(&classifier_opt_table,
+                                        (void *)(*argv),
+                                        &opt_proc)) ==
+            LAGOPUS_RESULT_OK) {
+          /* parse opt. */
+          if (opt_proc != NULL) {
+            ret = ((opt_proc_t) opt_proc)(&argv,
+                                          (void *) &conf,
+                                          out_configs,
+                                          result);
+            if (ret != LAGOPUS_RESULT_OK) {
+              goto done;
+            }
+          } else {
+            ret = LAGOPUS_RESULT_NOT_FOUND;
+            lagopus_perror(ret);
+            goto done;
+          }
+        } else {
+          ret = datastore_json_result_string_setf(result,
+                                                  LAGOPUS_RESULT_INVALID_ARGS,
+                                                  "opt = %s.", *argv);
+          goto done;
+        }
+      } else {
+        ret = datastore_json_result_set(result,
+                                        LAGOPUS_RESULT_INVALID_ARGS,
+                                        NULL);
+        goto done;
+      }
+      argv++;
+    }
+
+    if (conf.classifier != DATASTORE_BRIDGE_TABLE_CLASSIFIER_UNKNOWN) {
+      if (conf.table_id == OFPTT_ALL) {
+        ret = datastore_json_result_string_setf(result,
+                                                LAGOPUS_RESULT_INVALID_ARGS,
+                                                "Bad opt value. "
+                                                "table-id is required.");
+        goto done;
+      }
+      if ((ret = dp_bridge_table_classifier_set(conf.name, conf.table_id,
+                                                conf.classifier)) !=
+          LAGOPUS_RESULT_OK) {
+        ret = datastore_json_result_string_setf(result, ret,
+                                                "Can't set classifier.");
+        goto done;
+      }
+    }
+
+    if (conf.table_id != OFPTT_ALL) {
+      if ((ret = classifier_json_append(conf.name, conf.table_id,
+                                        false, result)) ==
+          LAGOPUS_RESULT_NOT_FOUND) {
+        ret = datastore_json_result_string_setf(result, ret,
+                                                "Not found. table-id = %d.",
+                                                conf.table_id);
+      }
+    } else {
+      if ((ret = lagopus_dstring_appendf(result, "[")) !=
+          LAGOPUS_RESULT_OK) {
+        lagopus_perror(ret);
+        goto done;
+      }
+      delimiter = false;
+      for (i = 0; i < OFPTT_ALL; i++) {
+        ret = classifier_json_append(conf.name, (uint8_t) i,
+                                     delimiter, result);
+        if (ret == LAGOPUS_RESULT_OK) {
+          delimiter = true;
+        } else if (ret != LAGOPUS_RESULT_NOT_FOUND) {
+          goto done;
+        }
+      }
+      if ((ret = lagopus_dstring_appendf(result, "]")) !=
+          LAGOPUS_RESULT_OK) {
+        lagopus_perror(ret);
+        goto done;
+      }
+    }
+  } else {
+    ret = datastore_json_result_set(result,
+                                    LAGOPUS_RESULT_INVALID_ARGS,
+                                    NULL);
+  }
+
+done:
+  return ret;
+}
+
 STATIC lagopus_result_t
 flow_cmd_parse(datastore_interp_t *iptr,
                datastore_interp_state_t state,
@@ -498,7 +735,9 @@ flow_cmd_parse(datastore_interp_t *iptr,
   char *name = NULL;
   char *fullname = NULL;
   char *str = NULL;
-  flow_conf_t conf = {NULL, OFPTT_ALL};
+  flow_conf_t conf = {NULL, OFPTT_ALL,
+                      DATASTORE_BRIDGE_TABLE_CLASSIFIER_UNKNOWN
+                     };
   configs_t out_configs = {false, false};
   lagopus_dstring_t conf_result = NULL;
   (void) u_proc;
@@ -641,6 +880,10 @@ initialize_internal(void) {
       ((ret = sub_cmd_add(DEL_SUB_CMD,
                           del_sub_cmd_parse,
                           &sub_cmd_table)) !=
+       LAGOPUS_RESULT_OK) ||
+      ((ret = sub_cmd_add(CLASSIFIER_SUB_CMD,
+                          classifier_sub_cmd_parse,
+                          &sub_cmd_table)) !=
        LAGOPUS_RESULT_OK)) {
     goto done;
   }
@@ -690,6 +933,23 @@ initialize_internal(void) {
     goto done;
   }
 
+  /* create hashmap for classifier opts. */
+  if ((ret = lagopus_hashmap_create(&classifier_opt_table,
+                                    LAGOPUS_HASHMAP_TYPE_STRING,
+                                    NULL)) != LAGOPUS_RESULT_OK) {
+    lagopus_perror(ret);
+    goto done;
+  }
+
+  if (((ret = opt_add(opt_strs[OPT_TABLE_ID], table_id_opt_parse,
+                      &classifier_opt_table)) !=
+       LAGOPUS_RESULT_OK) ||
+      ((ret = opt_add(opt_strs[OPT_TYPE], type_opt_parse,
+                      &classifier_opt_table)) !=
+       LAGOPUS_RESULT_OK)) {
+    goto done;
+  }
+
   if ((ret = flow_cmd_mod_initialize()) !=
       LAGOPUS_RESULT_OK) {
     goto done;
@@ -731,4 +991,6 @@ flow_cmd_finalize(void) {
   dump_opt_table = NULL;
   lagopus_hashmap_destroy(&config_opt_table, true);
   config_opt_table = NULL;
+  lagopus_hashmap_destroy(&classifier_opt_table, true);
+  classifier_opt_table = NULL;
 }
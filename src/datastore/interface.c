@@ -74,7 +74,8 @@ static const interface_type_t types[] = {
   {DATASTORE_INTERFACE_TYPE_GRE, "gre"},
   {DATASTORE_INTERFACE_TYPE_NVGRE, "nvgre"},
   {DATASTORE_INTERFACE_TYPE_VXLAN, "vxlan"},
-  {DATASTORE_INTERFACE_TYPE_VHOST_USER, "vhost-user"}
+  {DATASTORE_INTERFACE_TYPE_VHOST_USER, "vhost-user"},
+  {DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP, "ethernet-afxdp"}
 };
 
 static lagopus_hashmap_t interface_table = NULL;
@@ -75,6 +75,10 @@ enum interface_stats {
                               OPT_BIT_GET(OPT_DEVICE) |               \
                               OPT_BIT_GET(OPT_MTU) |                  \
                               OPT_BIT_GET(OPT_IP_ADDR))
+#define OPT_ETHERNET_AFXDP (OPT_COMMON | \
+                            OPT_BIT_GET(OPT_DEVICE) |               \
+                            OPT_BIT_GET(OPT_MTU) |                  \
+                            OPT_BIT_GET(OPT_IP_ADDR))
 #define OPT_ETHERNET_DPDK_PHY (OPT_COMMON | OPT_BIT_GET(OPT_PORT_NO) | \
                                OPT_BIT_GET(OPT_DEVICE) |               \
                                OPT_BIT_GET(OPT_MTU) |                  \
@@ -218,6 +222,12 @@ ethernet_port_create(const char *name,
         interface_info.eth_rawsock.mtu = mtu;
         interface_info.eth_rawsock.ip_addr = ip_addr;
         break;
+      case DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP:
+        interface_info.eth_afxdp.port_number = port_no;
+        interface_info.eth_afxdp.device = device;
+        interface_info.eth_afxdp.mtu = mtu;
+        interface_info.eth_afxdp.ip_addr = ip_addr;
+        break;
       case DATASTORE_INTERFACE_TYPE_VXLAN:
         if (((ret = interface_get_dst_addr(attr, &dst_addr)) ==
              LAGOPUS_RESULT_OK) &&
@@ -303,6 +313,7 @@ interface_port_create(const char *name,
     switch (type) {
       case DATASTORE_INTERFACE_TYPE_ETHERNET_DPDK_PHY:
       case DATASTORE_INTERFACE_TYPE_ETHERNET_RAWSOCK:
+      case DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP:
       case DATASTORE_INTERFACE_TYPE_VXLAN:
         ret = ethernet_port_create(name, attr, type);
         break;
@@ -341,6 +352,7 @@ interface_port_destroy(const char *name,
     switch (type) {
       case DATASTORE_INTERFACE_TYPE_ETHERNET_DPDK_PHY:
       case DATASTORE_INTERFACE_TYPE_ETHERNET_RAWSOCK:
+      case DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP:
       case DATASTORE_INTERFACE_TYPE_VXLAN:
         ret = ethernet_port_destroy(name, attr);
         break;
@@ -1151,6 +1163,7 @@ opt_parse(const char *const argv[],
             switch (type) {
               case DATASTORE_INTERFACE_TYPE_ETHERNET_DPDK_PHY:
               case DATASTORE_INTERFACE_TYPE_ETHERNET_RAWSOCK:
+              case DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP:
                 table = ethernet_opt_table;
                 break;
               case DATASTORE_INTERFACE_TYPE_GRE:
@@ -2116,6 +2129,9 @@ interface_cmd_serialize(datastore_interp_t *iptr,
       case DATASTORE_INTERFACE_TYPE_ETHERNET_RAWSOCK:
         flags &= OPT_ETHERNET_RAWSOCK;
         break;
+      case DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP:
+        flags &= OPT_ETHERNET_AFXDP;
+        break;
       case DATASTORE_INTERFACE_TYPE_GRE:
         flags &= OPT_GRE;
         break;
@@ -2983,6 +2999,9 @@ interface_cmd_json_create(lagopus_dstring_t *ds,
               case DATASTORE_INTERFACE_TYPE_ETHERNET_RAWSOCK:
                 flags &= OPT_ETHERNET_RAWSOCK;
                 break;
+              case DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP:
+                flags &= OPT_ETHERNET_AFXDP;
+                break;
               case DATASTORE_INTERFACE_TYPE_GRE:
                 flags &= OPT_GRE;
                 break;
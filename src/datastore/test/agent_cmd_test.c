@@ -69,7 +69,8 @@ test_agent_cmd_parse_set_opts(void) {
   const char test_str1[] =
       "{\"ret\":\"OK\",\n"
       "\"data\":[{\"channelq-size\":1000,\n"
-      "\"channelq-max-batches\":1000}]}";
+      "\"channelq-max-batches\":1000,\n"
+      "\"handler-threads\":1}]}";
   const char *argv2[] = {"agent",
                          "-channelq-size", "1",
                          NULL};
@@ -79,7 +80,8 @@ test_agent_cmd_parse_set_opts(void) {
   const char test_str3[] =
       "{\"ret\":\"OK\",\n"
       "\"data\":[{\"channelq-size\":1,\n"
-      "\"channelq-max-batches\":1000}]}";
+      "\"channelq-max-batches\":1000,\n"
+      "\"handler-threads\":1}]}";
   const char *argv4[] = {"agent",
                          "-channelq-size",
                          NULL};
@@ -95,7 +97,8 @@ test_agent_cmd_parse_set_opts(void) {
   const char test_str6[] =
       "{\"ret\":\"OK\",\n"
       "\"data\":[{\"channelq-size\":1,\n"
-      "\"channelq-max-batches\":2}]}";
+      "\"channelq-max-batches\":2,\n"
+      "\"handler-threads\":1}]}";
   const char *argv7[] = {"agent",
                          "-channelq-max-batches",
                          NULL};
@@ -139,6 +142,64 @@ test_agent_cmd_parse_set_opts(void) {
                  &ds, str, test_str7);
 }
 
+void
+test_agent_cmd_parse_handler_threads(void) {
+  lagopus_result_t ret = LAGOPUS_RESULT_ANY_FAILURES;
+  datastore_interp_state_t state = DATASTORE_INTERP_STATE_AUTO_COMMIT;
+  char *str = NULL;
+  const char *argv1[] = {"agent",
+                         "-handler-threads", "4",
+                         NULL};
+  const char test_str1[] = "{\"ret\":\"OK\"}";
+  const char *argv2[] = {"agent",
+                         "-handler-threads",
+                         NULL};
+  const char test_str2[] =
+      "{\"ret\":\"OK\",\n"
+      "\"data\":[{\"handler-threads\":4}]}";
+  const char *argv3[] = {"agent",
+                         "-handler-threads", "0",
+                         NULL};
+  const char test_str3[] =
+      "{\"ret\":\"OUT_OF_RANGE\",\n"
+      "\"data\":\"Bad opt value = 0\"}";
+  const char *argv4[] = {"agent",
+                         "-handler-threads", "17",
+                         NULL};
+  const char test_str4[] =
+      "{\"ret\":\"OUT_OF_RANGE\",\n"
+      "\"data\":\"Bad opt value = 17\"}";
+  const char *argv5[] = {"agent",
+                         "-handler-threads", "1",
+                         NULL};
+  const char test_str5[] = "{\"ret\":\"OK\"}";
+
+  /* set handler-threads */
+  TEST_CMD_PARSE(ret, LAGOPUS_RESULT_OK, s_parse_agent, &interp, state,
+                 ARGV_SIZE(argv1), argv1, &tbl, NULL,
+                 &ds, str, test_str1);
+
+  /* show handler-threads */
+  TEST_CMD_PARSE(ret, LAGOPUS_RESULT_OK, s_parse_agent, &interp, state,
+                 ARGV_SIZE(argv2), argv2, &tbl, NULL,
+                 &ds, str, test_str2);
+
+  /* out of range. */
+  TEST_CMD_PARSE(ret, LAGOPUS_RESULT_DATASTORE_INTERP_ERROR,
+                 s_parse_agent, &interp, state,
+                 ARGV_SIZE(argv3), argv3, &tbl, NULL,
+                 &ds, str, test_str3);
+  TEST_CMD_PARSE(ret, LAGOPUS_RESULT_DATASTORE_INTERP_ERROR,
+                 s_parse_agent, &interp, state,
+                 ARGV_SIZE(argv4), argv4, &tbl, NULL,
+                 &ds, str, test_str4);
+
+  /* set default. */
+  TEST_CMD_PARSE(ret, LAGOPUS_RESULT_OK, s_parse_agent, &interp, state,
+                 ARGV_SIZE(argv5), argv5, &tbl, NULL,
+                 &ds, str, test_str5);
+}
+
 void
 test_agent_cmd_parse_over_channelq_size(void) {
   lagopus_result_t ret = LAGOPUS_RESULT_ANY_FAILURES;
@@ -224,7 +285,8 @@ test_agent_cmd_parse_serialize(void) {
   const char serialize_str1[] =
       "agent "
       "-channelq-size 2000 "
-      "-channelq-max-batches 3000\n\n";
+      "-channelq-max-batches 3000 "
+      "-handler-threads 1\n\n";
 
   /* set */
   TEST_CMD_PARSE(ret, LAGOPUS_RESULT_OK, s_parse_agent, &interp, state,
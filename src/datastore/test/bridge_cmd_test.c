@@ -10762,13 +10762,25 @@ test_bridge_cmd_parse_stats_01(void) {
     "\"flowcache-entries\":0,\n"
     "\"flowcache-hit\":0,\n"
     "\"flowcache-miss\":0,\n"
+    "\"flowcache-invalidated\":0,\n"
     "\"flow-entries\":0,\n"
     "\"flow-lookup-count\":0,\n"
     "\"flow-matched-count\":0,\n"
+    "\"packet-in-drops\":0,\n"
+    "\"pktbuf-pool-size\":0,\n"
+    "\"pktbuf-pool-in-use\":0,\n"
+    "\"pktbuf-pool-exhausted\":0,\n"
+    "\"worker-imbalance\":0,\n"
     "\"tables\":[{\"table-id\":0,\n"
     "\"flow-entries\":0,\n"
     "\"flow-lookup-count\":0,\n"
-    "\"flow-matched-count\":0}]}]}";
+    "\"flow-matched-count\":0}],\n"
+    "\"workers\":[{\"worker-id\":0,\n"
+    "\"rx-packets\":0,\n"
+    "\"rx-bytes\":0,\n"
+    "\"tx-packets\":0,\n"
+    "\"tx-dropped\":0,\n"
+    "\"polls\":0}]}]}";
   const char *argv3[] = {"bridge", "test_name63", "destroy",
                          NULL
                         };
@@ -312,6 +312,104 @@ test_flow_cmd_parse_config_bad_tmp_dir(void) {
 }
 
 
+void
+test_flow_cmd_parse_classifier_01(void) {
+  lagopus_result_t ret = LAGOPUS_RESULT_ANY_FAILURES;
+  datastore_interp_state_t state = DATASTORE_INTERP_STATE_AUTO_COMMIT;
+  char *str = NULL;
+  const char *argv1[] = {"flow", "br0", "classifier",
+                         "-table-id", "1",
+                         "-type", "thtable",
+                         NULL
+                        };
+  const char test_str1[] =
+    "{\"ret\":\"OK\",\n"
+    "\"data\":{\"table-id\":1,\n"
+    "\"type\":\"thtable\",\n"
+    "\"current-type\":\"thtable\"}}";
+  const char *argv2[] = {"flow", "br0", "classifier",
+                         "-table-id", "1",
+                         "-type", "auto",
+                         NULL
+                        };
+  const char test_str2[] =
+    "{\"ret\":\"OK\",\n"
+    "\"data\":{\"table-id\":1,\n"
+    "\"type\":\"auto\",\n"
+    "\"current-type\":\"flowinfo\"}}";
+  const char *argv3[] = {"flow", "br0", "classifier",
+                         NULL
+                        };
+  const char test_str3[] =
+    "{\"ret\":\"OK\",\n"
+    "\"data\":[{\"table-id\":0,\n"
+    "\"type\":\"flowinfo\",\n"
+    "\"current-type\":\"flowinfo\"},"
+    "{\"table-id\":1,\n"
+    "\"type\":\"auto\",\n"
+    "\"current-type\":\"flowinfo\"}]}";
+
+  /* set cmd. */
+  TEST_CMD_PARSE(ret, LAGOPUS_RESULT_OK,
+                 flow_cmd_parse, &interp, state,
+                 ARGV_SIZE(argv1), argv1, &tbl, NULL,
+                 &ds, str, test_str1);
+
+  /* auto, chosen from flows. */
+  TEST_CMD_PARSE(ret, LAGOPUS_RESULT_OK,
+                 flow_cmd_parse, &interp, state,
+                 ARGV_SIZE(argv2), argv2, &tbl, NULL,
+                 &ds, str, test_str2);
+
+  /* show cmd. */
+  TEST_CMD_PARSE(ret, LAGOPUS_RESULT_OK,
+                 flow_cmd_parse, &interp, state,
+                 ARGV_SIZE(argv3), argv3, &tbl, NULL,
+                 &ds, str, test_str3);
+}
+
+void
+test_flow_cmd_parse_classifier_bad_type(void) {
+  lagopus_result_t ret = LAGOPUS_RESULT_ANY_FAILURES;
+  datastore_interp_state_t state = DATASTORE_INTERP_STATE_AUTO_COMMIT;
+  char *str = NULL;
+  const char *argv1[] = {"flow", "br0", "classifier",
+                         "-table-id", "1",
+                         "-type", "hoge",
+                         NULL
+                        };
+  const char test_str1[] =
+    "{\"ret\":\"INVALID_ARGS\",\n"
+    "\"data\":\"Bad opt value = hoge.\"}";
+  const char *argv2[] = {"flow", "br0", "classifier",
+                         "-type", "mbtree",
+                         NULL
+                        };
+  const char test_str2[] =
+    "{\"ret\":\"INVALID_ARGS\",\n"
+    "\"data\":\"Bad opt value. table-id is required.\"}";
+  const char *argv3[] = {"flow", "br0", "classifier",
+                         "-table-id", "200",
+                         NULL
+                        };
+  const char test_str3[] =
+    "{\"ret\":\"NOT_FOUND\",\n"
+    "\"data\":\"Not found. table-id = 200.\"}";
+
+  TEST_CMD_PARSE(ret, LAGOPUS_RESULT_DATASTORE_INTERP_ERROR,
+                 flow_cmd_parse, &interp, state,
+                 ARGV_SIZE(argv1), argv1, &tbl, NULL,
+                 &ds, str, test_str1);
+  TEST_CMD_PARSE(ret, LAGOPUS_RESULT_DATASTORE_INTERP_ERROR,
+                 flow_cmd_parse, &interp, state,
+                 ARGV_SIZE(argv2), argv2, &tbl, NULL,
+                 &ds, str, test_str2);
+  TEST_CMD_PARSE(ret, LAGOPUS_RESULT_DATASTORE_INTERP_ERROR,
+                 flow_cmd_parse, &interp, state,
+                 ARGV_SIZE(argv3), argv3, &tbl, NULL,
+                 &ds, str, test_str3);
+}
+
 void
 test_destroy(void) {
   destroy = true;
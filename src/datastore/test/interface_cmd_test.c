@@ -1082,6 +1082,50 @@ test_interface_cmd_parse_create_vhost_user_over_port(void) {
                  &ds, str, test_str1);
 }
 
+void
+test_interface_cmd_parse_create_afxdp_01(void) {
+  lagopus_result_t ret = LAGOPUS_RESULT_ANY_FAILURES;
+  datastore_interp_state_t state = DATASTORE_INTERP_STATE_AUTO_COMMIT;
+  char *str = NULL;
+  const char *argv1[] = {"interface", "test_name47", "create",
+                         "-type", "ethernet-afxdp",
+                         "-device", "veth0",
+                         "-mtu", "1",
+                         "-ip-addr", "127.0.0.2",
+                         NULL
+                        };
+  const char test_str1[] = "{\"ret\":\"OK\"}";
+  const char *argv2[] = {"interface", "test_name47", NULL};
+  const char test_str2[] =
+    "{\"ret\":\"OK\",\n"
+    "\"data\":[{\"name\":\""DATASTORE_NAMESPACE_DELIMITER"test_name47\",\n"
+    "\"type\":\"ethernet-afxdp\",\n"
+    "\"device\":\"veth0\",\n"
+    "\"mtu\":1,\n"
+    "\"ip-addr\":\"127.0.0.2\",\n"
+    "\"is-used\":false,\n"
+    "\"is-enabled\":false}]}";
+  const char *argv3[] = {"interface", "test_name47", "destroy",
+                         NULL
+                        };
+  const char test_str3[] = "{\"ret\":\"OK\"}";
+
+  /* create cmd. */
+  TEST_CMD_PARSE(ret, LAGOPUS_RESULT_OK, interface_cmd_parse, &interp, state,
+                 ARGV_SIZE(argv1), argv1, &tbl, interface_cmd_update,
+                 &ds, str, test_str1);
+
+  /* show cmd. */
+  TEST_CMD_PARSE(ret, LAGOPUS_RESULT_OK, interface_cmd_parse, &interp, state,
+                 ARGV_SIZE(argv2), argv2, &tbl, interface_cmd_update,
+                 &ds, str, test_str2);
+
+  /* destroy cmd. */
+  TEST_CMD_PARSE(ret, LAGOPUS_RESULT_OK, interface_cmd_parse, &interp, state,
+                 ARGV_SIZE(argv3), argv3, &tbl, interface_cmd_update,
+                 &ds, str, test_str3);
+}
+
 void
 test_interface_cmd_serialize_default_opt(void) {
   lagopus_result_t ret = LAGOPUS_RESULT_ANY_FAILURES;
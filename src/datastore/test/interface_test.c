@@ -911,13 +911,18 @@ test_interface_type_to_str(void) {
     TEST_ASSERT_EQUAL(LAGOPUS_RESULT_OK, rc);
     TEST_ASSERT_EQUAL_STRING("vhost-user", actual_type_str);
 
+    rc = interface_type_to_str(DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP,
+                               &actual_type_str);
+    TEST_ASSERT_EQUAL(LAGOPUS_RESULT_OK, rc);
+    TEST_ASSERT_EQUAL_STRING("ethernet-afxdp", actual_type_str);
+
     rc = interface_type_to_str(DATASTORE_INTERFACE_TYPE_MIN, &actual_type_str);
     TEST_ASSERT_EQUAL(LAGOPUS_RESULT_OK, rc);
     TEST_ASSERT_EQUAL_STRING("unknown", actual_type_str);
 
     rc = interface_type_to_str(DATASTORE_INTERFACE_TYPE_MAX, &actual_type_str);
     TEST_ASSERT_EQUAL(LAGOPUS_RESULT_OK, rc);
-    TEST_ASSERT_EQUAL_STRING("vhost-user", actual_type_str);
+    TEST_ASSERT_EQUAL_STRING("ethernet-afxdp", actual_type_str);
   }
 
   // Abnormal case
@@ -969,6 +974,11 @@ test_interface_type_to_enum(void) {
     TEST_ASSERT_EQUAL(LAGOPUS_RESULT_OK, rc);
     TEST_ASSERT_EQUAL_UINT32(DATASTORE_INTERFACE_TYPE_VHOST_USER, actual_type);
 
+    rc = interface_type_to_enum("ethernet-afxdp", &actual_type);
+    TEST_ASSERT_EQUAL(LAGOPUS_RESULT_OK, rc);
+    TEST_ASSERT_EQUAL_UINT32(DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP,
+                             actual_type);
+
     rc = interface_type_to_enum("UNKNOWN", &actual_type);
     TEST_ASSERT_EQUAL(LAGOPUS_RESULT_INVALID_ARGS, rc);
 
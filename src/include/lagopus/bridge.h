@@ -72,6 +72,7 @@ struct bridge {
   struct flowdb *flowdb;                /** Flow database. */
   struct group_table *group_table;      /** Group table. */
   struct meter_table *meter_table;      /** Meter table. */
+  struct packet_in_queue *packet_in;    /** Packet-in event pool. */
 #ifdef HYBRID
   struct bridge **updater_timer;         /**< Timer for updater. */
   struct mactable mactable;             /** Mac learning table. */
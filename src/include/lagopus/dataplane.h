@@ -75,11 +75,14 @@ struct meter;
 struct port;
 struct bucket_list;
 struct bucket;
+struct flowcache;
 
 int
 dpdk_send_packet_physical(struct lagopus_packet *pkt, struct interface *);
 int
 rawsock_send_packet_physical(struct lagopus_packet *pkt, uint32_t portid);
+int
+afxdp_send_packet_physical(struct lagopus_packet *pkt, uint32_t portid);
 
 lagopus_result_t
 execute_instruction_meter(struct lagopus_packet *pkt,
@@ -241,6 +244,22 @@ lagopus_forward_packet_to_port_hybrid(struct lagopus_packet *);
  */
 lagopus_result_t lagopus_match_and_action(struct lagopus_packet *);
 
+/**
+ * Process packets of a burst by OpenFlow rule.
+ *
+ * @param[in]   pkts    packets.
+ * @param[in]   npkts   number of packets.
+ * @param[in]   cache   flow cache, NULL if not used.
+ *
+ * hash values of all packets are calculated and the cache is looked
+ * up at once, then packets hitting the same cache entry are processed
+ * together.  missed packets are classified after them, in received
+ * order.  all packets are consumed.
+ */
+void lagopus_bulk_match_and_action(struct lagopus_packet *pkts[],
+                                   size_t npkts,
+                                   struct flowcache *cache);
+
 /**
  * Execute experimenter instruction.
  *
@@ -543,6 +562,51 @@ lagopus_result_t dp_timer_thread_shutdown(shutdown_grace_level_t);
  */
 void dp_timer_thread_fini(void);
 
+/* default interval of port statistics collection in msec. */
+#define DP_STATS_INTERVAL_DEFAULT 1000
+
+/**
+ * Set interval of port statistics collection.
+ *
+ * @param[in]   msec    Interval in milliseconds.
+ *
+ * @retval      LAGOPUS_RESULT_OK               Succeeded.
+ * @retval      LAGOPUS_RESULT_INVALID_ARGS     Interval is zero.
+ */
+lagopus_result_t dp_stats_interval_set(unsigned int msec);
+
+/**
+ * Get interval of port statistics collection in milliseconds.
+ */
+unsigned int dp_stats_interval_get(void);
+
+/**
+ * Dataplane port statistics collector thread initialization.
+ */
+lagopus_result_t
+dp_stats_thread_init(int argc, const char *const argv[],
+                     void *extarg, lagopus_thread_t **thdptr);
+
+/**
+ * Dataplane port statistics collector thread start function.
+ */
+lagopus_result_t dp_stats_thread_start(void);
+
+/**
+ * Dataplane port statistics collector thread stop function.
+ */
+lagopus_result_t dp_stats_thread_stop(void);
+
+/**
+ * Dataplane port statistics collector thread shutdown function.
+ */
+lagopus_result_t dp_stats_thread_shutdown(shutdown_grace_level_t);
+
+/**
+ * Dataplane port statistics collector thread finalize function.
+ */
+void dp_stats_thread_fini(void);
+
 #ifdef HYBRID
 /**
  * Dataplane tapio thread initialization.
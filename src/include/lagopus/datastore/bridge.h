@@ -33,6 +33,17 @@ typedef enum datastore_bridge_fail_mode {
   DATASTORE_BRIDGE_FAIL_MODE_MAX = DATASTORE_BRIDGE_FAIL_MODE_STANDALONE,
 } datastore_bridge_fail_mode_t;
 
+typedef enum datastore_bridge_table_classifier {
+  DATASTORE_BRIDGE_TABLE_CLASSIFIER_UNKNOWN = 0,
+  DATASTORE_BRIDGE_TABLE_CLASSIFIER_FLOWINFO,
+  DATASTORE_BRIDGE_TABLE_CLASSIFIER_MBTREE,
+  DATASTORE_BRIDGE_TABLE_CLASSIFIER_THTABLE,
+  DATASTORE_BRIDGE_TABLE_CLASSIFIER_EXACT,
+  DATASTORE_BRIDGE_TABLE_CLASSIFIER_AUTO,
+  DATASTORE_BRIDGE_TABLE_CLASSIFIER_MIN = DATASTORE_BRIDGE_TABLE_CLASSIFIER_UNKNOWN,
+  DATASTORE_BRIDGE_TABLE_CLASSIFIER_MAX = DATASTORE_BRIDGE_TABLE_CLASSIFIER_AUTO,
+} datastore_bridge_table_classifier_t;
+
 typedef enum datastore_bridge_action_type {
   DATASTORE_BRIDGE_ACTION_TYPE_UNKNOWN = 0,
   DATASTORE_BRIDGE_ACTION_TYPE_COPY_TTL_OUT,
@@ -242,6 +253,19 @@ typedef struct datastore_bridge_queue_info {
   uint16_t down_streamq_max_batches;
 } datastore_bridge_queue_info_t;
 
+#define DATASTORE_BRIDGE_MAX_WORKERS 32
+
+/**
+ * @brief	datastore_bridge_worker_stats_t
+ */
+typedef struct datastore_bridge_worker_stats {
+  uint64_t rx_packets;
+  uint64_t rx_bytes;
+  uint64_t tx_packets;
+  uint64_t tx_dropped;
+  uint64_t polls;
+} datastore_bridge_worker_stats_t;
+
 /**
  * @brief	datastore_bridge_stats_t
  */
@@ -252,9 +276,17 @@ typedef struct datastore_bridge_stats {
   uint64_t flowcache_entries;
   uint64_t flowcache_hit;
   uint64_t flowcache_miss;
+  uint64_t flowcache_invalidated;
   uint64_t flow_entries;
   uint64_t flow_lookup_count;
   uint64_t flow_matched_count;
+  uint64_t packet_in_drops;
+  uint64_t pktbuf_pool_size;
+  uint64_t pktbuf_pool_in_use;
+  uint64_t pktbuf_pool_exhausted;
+  uint64_t worker_imbalance;    /* busiest worker over average, in percent. */
+  uint32_t worker_count;
+  datastore_bridge_worker_stats_t workers[DATASTORE_BRIDGE_MAX_WORKERS];
   struct table_stats_list flow_table_stats;
 } datastore_bridge_stats_t;
 
@@ -28,8 +28,9 @@ typedef enum datastore_interface_type {
   DATASTORE_INTERFACE_TYPE_NVGRE,
   DATASTORE_INTERFACE_TYPE_VXLAN,
   DATASTORE_INTERFACE_TYPE_VHOST_USER,
+  DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP,
   DATASTORE_INTERFACE_TYPE_MIN = DATASTORE_INTERFACE_TYPE_UNKNOWN,
-  DATASTORE_INTERFACE_TYPE_MAX = DATASTORE_INTERFACE_TYPE_VHOST_USER,
+  DATASTORE_INTERFACE_TYPE_MAX = DATASTORE_INTERFACE_TYPE_ETHERNET_AFXDP,
 } datastore_interface_type_t;
 
 /**
@@ -52,6 +53,16 @@ struct datastore_interface_eth_rawsock {
   uint16_t mtu;
 };
 
+/**
+ * @brief	datastore_interface_eth_afxdp
+ */
+struct datastore_interface_eth_afxdp {
+  uint32_t port_number;
+  const char *device;
+  lagopus_ip_address_t *ip_addr;
+  uint16_t mtu;
+};
+
 /**
  * @brief	datastore_interface_vxla
  */
@@ -79,6 +90,7 @@ typedef struct datastore_interface_info {
     datastore_interface_eth eth;
     struct datastore_interface_eth_dpdk_phy eth_dpdk_phy;
     struct datastore_interface_eth_rawsock eth_rawsock;
+    struct datastore_interface_eth_afxdp eth_afxdp;
     struct datastore_interface_vxlan vxlan;
     /*
      * TODO: Add gre, nvgre, vhost-user.
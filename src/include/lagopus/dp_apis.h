@@ -221,6 +221,14 @@ dp_port_config_get(const char *name, uint32_t *config);
 lagopus_result_t
 dp_port_state_get(const char *name, uint32_t *state);
 
+/**
+ * Read statistics and link state of all ports from the drivers,
+ * and publish them as snapshots.
+ * Called periodically by dp_stats thread.
+ */
+void
+dp_port_stats_collect(void);
+
 /**
  * Associate port and interface.
  *
@@ -457,6 +465,19 @@ dp_bridge_lookup(const char *name);
 struct bridge *
 dp_bridge_lookup_by_dpid(uint64_t dpid);
 
+/**
+ * Apply a function to all bridges.  Bridges must not be added or
+ * deleted in the function.
+ *
+ * @param[in]   proc    Function called with name and bridge.
+ * @param[in]   arg     Argument of proc.
+ *
+ * @retval      LAGOPUS_RESULT_OK       Succeeded.
+ * @retval      !=LAGOPUS_RESULT_OK     Failed.
+ */
+lagopus_result_t
+dp_bridge_iterate(lagopus_hashmap_iteration_proc_t proc, void *arg);
+
 /**
  * Get bridge statictics.
  *
@@ -470,6 +491,42 @@ lagopus_result_t
 dp_bridge_stats_get(const char *name,
                     datastore_bridge_stats_t *stats);
 
+/**
+ * Set lookup engine of the flow table.
+ *
+ * @param[in]   name            Name of bridge.
+ * @param[in]   table_id        Table ID.
+ * @param[in]   classifier      Classifier, or auto to choose from flows.
+ *
+ * @retval      LAGOPUS_RESULT_OK               Succeeded.
+ * @retval      LAGOPUS_RESULT_NOT_FOUND        Bridge is not exist.
+ * @retval      LAGOPUS_RESULT_INVALID_ARGS     Invalid classifier.
+ * @retval      LAGOPUS_RESULT_NO_MEMORY        Memory exhausted.
+ */
+lagopus_result_t
+dp_bridge_table_classifier_set(const char *name, uint8_t table_id,
+                               datastore_bridge_table_classifier_t
+                               classifier);
+
+/**
+ * Get lookup engine of the flow table.
+ *
+ * @param[in]   name            Name of bridge.
+ * @param[in]   table_id        Table ID.
+ * @param[out]  classifier      Configured classifier.
+ * @param[out]  current         Classifier used now, differs from
+ *                              classifier in auto mode.
+ *
+ * @retval      LAGOPUS_RESULT_OK               Succeeded.
+ * @retval      LAGOPUS_RESULT_NOT_FOUND        Bridge or table is not exist.
+ */
+lagopus_result_t
+dp_bridge_table_classifier_get(const char *name, uint8_t table_id,
+                               datastore_bridge_table_classifier_t
+                               *classifier,
+                               datastore_bridge_table_classifier_t
+                               *current);
+
 lagopus_result_t
 dp_bridge_meter_list_get(const char *name,
                          datastore_bridge_meter_info_list_t *list);
@@ -642,14 +699,81 @@ struct bridge;
 void
 dp_get_flowcache_statistics(struct bridge *bridge, struct ofcachestat *st);
 
+/**
+ * @brief Packet buffer pool statistics.
+ */
+struct dp_pktbuf_stats {
+  uint64_t size;                /** Number of buffers of the pool. */
+  uint64_t in_use;              /** Number of pool buffers in use. */
+  uint64_t exhausted;           /** Allocations failed or out of the pool. */
+};
+
+/**
+ * Get packet buffer pool statistics of the dataplane.
+ *
+ * @param[out]  st       Statistics of packet buffer pool.
+ */
+void
+dp_get_pktbuf_statistics(struct dp_pktbuf_stats *st);
+
+/**
+ * @brief Per worker thread statistics of the dataplane.
+ */
+struct dp_worker_stats {
+  uint64_t rx_packets;          /** Packets received by the worker. */
+  uint64_t rx_bytes;            /** Bytes received by the worker. */
+  uint64_t tx_packets;          /** Packets transmitted by the worker. */
+  uint64_t tx_dropped;          /** Packets failed to transmit. */
+  uint64_t polls;               /** Number of poll rounds. */
+};
+
+/**
+ * Get per worker statistics of the dataplane.  Counters not kept by
+ * the dataplane are zero, DPDK workers have packets dispatched by I/O
+ * lcores in rx_packets only.
+ *
+ * @param[out]  st       Array of statistics, indexed by worker id.
+ * @param[in]   n        Number of elements of st.
+ *
+ * @retval      Number of workers stored in st.
+ */
+size_t
+dp_get_worker_statistics(struct dp_worker_stats *st, size_t n);
+
+/**
+ * Clear flow cache of raw socket workers at their next poll round.
+ * Changes of flows invalidate cached entries by table generation,
+ * this is for changes of bridge configuration.
+ */
+void
+clear_rawsock_flowcache(void);
+
+/**
+ * Get flow cache statistics of raw socket workers.
+ *
+ * @param[out]  st       Statistics of flow cache.
+ */
+void
+rawsock_get_flowcache_statistics(struct ofcachestat *st);
+
 struct eventq_data;
 
 typedef lagopus_result_t (*dp_dataq_put_func_t)(uint64_t dpid,
                                                 struct eventq_data **data,
                                                 lagopus_chrono_t timeout);
+typedef lagopus_result_t (*dp_dataq_put_n_func_t)(uint64_t dpid,
+                                                  struct eventq_data **data,
+                                                  size_t n,
+                                                  size_t *n_put,
+                                                  lagopus_chrono_t timeout);
 typedef lagopus_result_t (*dp_eventq_put_func_t)(uint64_t dpid,
                                                  struct eventq_data **data,
                                                  lagopus_chrono_t timeout);
+typedef lagopus_result_t (*dp_eventq_put_n_func_t)(uint64_t dpid,
+                                                   struct eventq_data **data,
+                                                   size_t n,
+                                                   size_t *n_put,
+                                                   lagopus_chrono_t timeout);
 
 /**
  * Register data queue put function.
@@ -663,6 +787,20 @@ typedef lagopus_result_t (*dp_eventq_put_func_t)(uint64_t dpid,
 dp_dataq_put_func_t
 dp_dataq_put_func_register(dp_dataq_put_func_t func);
 
+/**
+ * Register data queue put function for multiple data.  Data are put
+ * one by one by the data queue put function if not registered.
+ *
+ *      @param[in]      func    Pointer of put function, which stores
+ *                              number of data put to n_put.
+ *      @retval         Previous pointer of put function.
+ *
+ * Use put function for:
+ * - packet-in from forwarding threads
+ */
+dp_dataq_put_n_func_t
+dp_dataq_put_n_func_register(dp_dataq_put_n_func_t func);
+
 /**
  * Register event queue put function.
  *
@@ -676,6 +814,20 @@ dp_dataq_put_func_register(dp_dataq_put_func_t func);
 dp_eventq_put_func_t
 dp_eventq_put_func_register(dp_dataq_put_func_t func);
 
+/**
+ * Register event queue put function for multiple data.  Data are put
+ * one by one by the event queue put function if not registered.
+ *
+ *      @param[in]      func    Pointer of put function, which stores
+ *                              number of data put to n_put.
+ *      @retval         Previous pointer of put function.
+ *
+ * Use put function for:
+ * - flow removed by timer
+ */
+dp_eventq_put_n_func_t
+dp_eventq_put_n_func_register(dp_eventq_put_n_func_t func);
+
 /**
  * Process event data from agent.
  *
@@ -169,8 +169,8 @@ struct flow {
 
   /* Instruction array for execution. */
   struct instruction *instruction[INSTRUCTION_INDEX_MAX];
-  uint64_t packet_count;                        /** Matched packet count. */
-  uint64_t byte_count;                          /** Mtched byte count. */
+  uint32_t counter_id;                          /** Matched packet and
+                                                 ** byte counter. */
   uint16_t flags;                               /** ofp_flow_mod flags. */
   int32_t priority;                             /** Priority. */
   uint64_t cookie;                              /** ofp_flow_mod cookie. a*/
@@ -185,6 +185,8 @@ struct flow {
   struct timespec update_time;                  /** Last updated time. */
   struct flow **flow_timer;                     /** Back reference to entry
                                                  ** of the flow timer. */
+  uint64_t seq;                                 /** Insertion order in the
+                                                 ** table. */
 
 };
 
@@ -197,7 +199,6 @@ enum action_flag {
 #define SET_FIELD_ETH (SET_FIELD_ETH_DST | SET_FIELD_ETH_SRC)
 
 struct flowinfo;
-struct thtable;
 
 /**
  * @brief List of flow entries.
@@ -236,26 +237,52 @@ struct flow_list {
 
   uint8_t oxm_field;
   uint8_t shift;
-  struct flow_list **update_timer;
-  struct thtable *thtable;
+
+  int nflow_built;              /** nflow when the subtree is built. */
+  uint8_t rebuild;              /** subtree to be rebuilt. */
+  struct flow_list *next;       /** next replaced subtree to be freed. */
 
   int nbranch;
   void *branch[0];
 };
 
+/**
+ * @brief Classifier of flow table used by forwarding threads.
+ */
+enum table_classifier {
+  TABLE_CLASSIFIER_FLOWINFO = 0,        /** Structured flowinfo. */
+  TABLE_CLASSIFIER_THTABLE,             /** Tuple space search. */
+  TABLE_CLASSIFIER_MBTREE,              /** Multi-branch decision tree. */
+  TABLE_CLASSIFIER_EXACT,               /** Exact match hash, and
+                                         ** flowinfo for flows with masks. */
+  TABLE_CLASSIFIER_AUTO,                /** Chosen from flows, only for
+                                         ** flowdb_table_classifier_set(). */
+  TABLE_CLASSIFIER_MAX
+};
+
 /**
  * @brief Flow table.
  */
 struct table {
   struct flow_list *flow_list;  /** Flows by types. */
-  uint64_t lookup_count;        /** Lookup count */
-  uint64_t matched_count;       /** Matched count */
+  uint32_t lookup_counter_id;   /** Lookup counter, packets only. */
+  uint32_t matched_counter_id;  /** Matched counter, packets only. */
   uint8_t table_id;             /** Table id. */
-  uint16_t flow_match_type_count[OFPXMT_OFB_IPV6_EXTHDR + 1];  /** Flow counts
+  uint32_t flow_match_type_count[OFPXMT_OFB_IPV6_EXTHDR + 1];  /** Flow counts
                                                                 ** by match
                                                                 ** type. */
   struct ofp_table_features features;   /** Features. */
   void *userdata;               /** userdata used in dataplane */
+  void *shadow;                 /** userdata updated by writer, replaces
+                                 ** userdata on publish. */
+  bool dirty;                   /** shadow is not published yet. */
+  enum table_classifier classifier;     /** Type of userdata. */
+  bool classifier_auto;         /** classifier is chosen from flows. */
+  bool profile_pending;         /** flows are changed since chosen. */
+  volatile uint32_t generation; /** Incremented on publishing changes
+                                 ** of the flows, invalidates cached
+                                 ** entries referring the table. */
+  uint64_t flow_seq;            /** Last insertion order given to a flow. */
 };
 
 
@@ -424,6 +451,29 @@ flowdb_table_stats(struct flowdb *,
                    struct table_stats_list *,
                    struct ofp_error *);
 
+/**
+ * Get matched packet and byte count of the flow, summed over
+ * forwarding threads.
+ *
+ * @param[in]   flow    Flow.
+ * @param[out]  packets Packet count.
+ * @param[out]  bytes   Byte count.
+ */
+void
+flow_counter_get(const struct flow *flow, uint64_t *packets, uint64_t *bytes);
+
+/**
+ * Get lookup and matched count of the table, summed over forwarding
+ * threads.
+ *
+ * @param[in]   table   Table.
+ * @param[out]  lookup  Lookup count.
+ * @param[out]  matched Matched count.
+ */
+void
+table_counter_get(const struct table *table,
+                  uint64_t *lookup, uint64_t *matched);
+
 lagopus_result_t
 flowdb_get_table_features(struct flowdb *,
                           struct table_features_list *,
@@ -470,6 +520,41 @@ flowdb_dump(struct flowdb *flowdb, FILE *fp);
 struct table *
 flowdb_get_table(struct flowdb *flowdb, uint8_t table_id);
 
+/**
+ * Change classifier of the table.  Classifier is rebuilt from flows
+ * of the table and replaces the current one on return.  With
+ * TABLE_CLASSIFIER_AUTO, it is chosen from flows now and again
+ * after flows are changed.
+ *
+ * @param[in]   flowdb          Flow database.
+ * @param[in]   table_id        Table ID.
+ * @param[in]   classifier      Classifier.
+ *
+ * @retval LAGOPUS_RESULT_OK            Succeeded.
+ * @retval LAGOPUS_RESULT_INVALID_ARGS  Invalid classifier.
+ * @retval LAGOPUS_RESULT_NO_MEMORY     Memory exhausted.
+ */
+lagopus_result_t
+flowdb_table_classifier_set(struct flowdb *flowdb, uint8_t table_id,
+                            enum table_classifier classifier);
+
+/**
+ * Get classifier of the table.
+ *
+ * @param[in]   flowdb          Flow database.
+ * @param[in]   table_id        Table ID.
+ * @param[out]  classifier      Classifier used now.
+ * @param[out]  is_auto         true if classifier is chosen from flows.
+ *
+ * @retval LAGOPUS_RESULT_OK            Succeeded.
+ * @retval LAGOPUS_RESULT_INVALID_ARGS  Invalid arguments.
+ * @retval LAGOPUS_RESULT_NOT_FOUND     Table not found.
+ */
+lagopus_result_t
+flowdb_table_classifier_get(struct flowdb *flowdb, uint8_t table_id,
+                            enum table_classifier *classifier,
+                            bool *is_auto);
+
 /* Utility functions. */
 void
 match_list_entry_free(struct match_list *match_list);
@@ -503,6 +588,46 @@ flow_remove_with_reason_nolock(struct flow *flow,
                                uint8_t reason,
                                struct ofp_error *error);
 
+/**
+ * Flow expired by the flow timer.
+ */
+struct flow_expire {
+  struct flow *flow;                    /** Expired flow. */
+  uint8_t reason;                       /** OFPRR_IDLE_TIMEOUT or
+                                         ** OFPRR_HARD_TIMEOUT. */
+};
+
+struct eventq_data;
+
+/**
+ * Remove expired flows of the bridge at once, in flowdb write
+ * section.  Flow list of each table is compacted once.
+ *
+ * @param[in]   bridge          Bridge.
+ * @param[in]   expired         Expired flows, sorted in place.
+ * @param[in]   nexpired        Number of expired flows.
+ * @param[out]  msgs            OFPT_FLOW_REMOVED messages, sized
+ *                              nexpired.  Sent by send_flow_removed_n()
+ *                              after unlock.
+ *
+ * @retval      Number of messages.
+ */
+size_t
+flow_remove_expired_nolock(struct bridge *bridge,
+                           struct flow_expire *expired,
+                           size_t nexpired,
+                           struct eventq_data **msgs);
+
+/**
+ * Queue OFPT_FLOW_REMOVED messages to the agent at once.
+ *
+ * @param[in]   dpid    Datapath id of the bridge.
+ * @param[in]   msgs    Messages, freed if not queued.
+ * @param[in]   n       Number of messages.
+ */
+void
+send_flow_removed_n(uint64_t dpid, struct eventq_data **msgs, size_t n);
+
 struct timespec now_ts;
 
 static inline struct timespec
@@ -529,11 +654,20 @@ void init_dp_timer(void);
 lagopus_result_t add_flow_timer(struct flow *flow);
 
 /**
- * register to refresh flow_list optimization to timer list.
+ * register to choose classifiers of tables in auto mode.
+ *
+ * @param[in]   timeout         Timeout in seconds.
+ */
+lagopus_result_t add_classifier_timer(time_t timeout);
+
+/**
+ * Choose classifiers of tables in auto mode from their flows, and
+ * switch to them.  Forwarding threads continue to lookup while
+ * switching.
  *
- * @param[in]   flow_list       list of flow.
+ * @param[in]   flowdb  Flow database.
  */
-lagopus_result_t add_mbtree_timer(struct flow_list *flow_list, time_t timeout);
+void flowdb_classifier_update(struct flowdb *flowdb);
 
 /**
  * flow removal timer loop.
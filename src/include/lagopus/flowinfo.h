@@ -157,6 +157,34 @@ struct flowinfo *new_flowinfo_metadata(void);
  */
 struct flowinfo *new_flowinfo_metadata_mask(void);
 
+/**
+ * Allocate and initialize flowinfo for tuple space search.
+ *
+ * @retval      !=NULL  Created flowinfo.
+ *              ==NULL  failed to create flowinfo.
+ */
+struct flowinfo *new_flowinfo_thtable(void);
+
+/**
+ * Allocate and initialize flowinfo for multi-branch decision tree.
+ *
+ * @retval      !=NULL  Created flowinfo.
+ *              ==NULL  failed to create flowinfo.
+ */
+struct flowinfo *new_flowinfo_mbtree(void);
+
+/**
+ * Allocate and initialize flowinfo for exact match.  Flows with
+ * masked match fields are passed to the wildcard flowinfo, it is
+ * destroyed with the created flowinfo.
+ *
+ * @param[in]   wildcard        Flowinfo for flows with masks.
+ *
+ * @retval      !=NULL  Created flowinfo.
+ *              ==NULL  failed to create flowinfo.
+ */
+struct flowinfo *new_flowinfo_exact(struct flowinfo *wildcard);
+
 /**
  * Initialize flowinfo module.
  */
@@ -26,6 +26,25 @@
 
 struct group_stats_list;
 struct group_desc_list;
+struct group_select_perm;
+
+/**
+ * @brief Lookup table of OFPGT_SELECT group.
+ *
+ * Slots are assigned to live buckets in proportion to their weight,
+ * and the packet hash selects a slot.  Slots are reassigned
+ * incrementally, so adding or removing a bucket moves only the flows
+ * of that bucket.
+ */
+struct group_select {
+  uint32_t size;                        /** Number of slots, prime. */
+  uint32_t nbuckets;                    /** Number of buckets. */
+  struct bucket **table;                /** Bucket of each slot. */
+  uint16_t *owner;                      /** Bucket index of each slot. */
+  struct bucket **buckets;              /** Buckets by index. */
+  uint64_t *keys;                       /** Identity of buckets. */
+  struct group_select_perm *perm;       /** Slot preference of buckets. */
+};
 
 /**
  * @brief Group structure.
@@ -34,10 +53,13 @@ struct group {                          /** Internal group structure. */
   uint32_t id;                          /** OpenFlow group id. */
   enum ofp_group_type type;             /** Group type. */
   struct bucket_list bucket_list;       /** List of goup bucket */
-  int select;                           /** Round-robin index
+  struct group_select *select;          /** Lookup table
                                          ** for OFPGT_SELECT */
-  uint64_t packet_count;                /** Packet count. */
-  uint64_t byte_count;                  /** Byte count. */
+  struct bucket *live_bucket;           /** Live bucket for OFPGT_FF */
+  volatile uint32_t live_gen;           /** Liveness generation of
+                                         ** select and live_bucket */
+  volatile int refreshing;              /** Liveness is refreshing. */
+  uint32_t counter_id;                  /** Packet and byte counter. */
   uint32_t duration_sec;                /** Duration (sec part) */
   uint32_t duration_nsec;               /** Duration (nano sec part */
   struct timespec create_time;          /** Creation time. */
@@ -203,4 +225,40 @@ struct bucket *
 group_live_bucket(struct bridge *bridge,
                   struct group *group);
 
+/**
+ * Generation of port and group liveness.
+ */
+extern volatile uint32_t group_liveness_gen;
+
+/**
+ * Notify liveness of ports or groups is changed.  Lookup tables and
+ * live buckets of groups are refreshed on the next packet.
+ */
+void
+group_liveness_changed(void);
+
+/**
+ * Refresh lookup table and live bucket of the group with current
+ * liveness.  Called by forwarding threads, and the table is modified
+ * in place.
+ *
+ * @param[in]   bridge  Bridge.
+ * @param[in]   group   Group.
+ */
+void
+group_liveness_refresh(struct bridge *bridge, struct group *group);
+
+/**
+ * Refresh group if liveness is changed since the last refresh.
+ *
+ * @param[in]   bridge  Bridge.
+ * @param[in]   group   Group.
+ */
+static inline void
+group_liveness_check(struct bridge *bridge, struct group *group) {
+  if (group->live_gen != group_liveness_gen) {
+    group_liveness_refresh(bridge, group);
+  }
+}
+
 #endif /* SRC_INCLUDE_LAGOPUS_GROUP_H_ */
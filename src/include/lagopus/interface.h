@@ -174,5 +174,11 @@ rawsock_change_config(struct interface *ifp,
                       uint32_t advertised,
                       uint32_t config);
 
+lagopus_result_t afxdp_configure_interface(struct interface *ifp);
+lagopus_result_t afxdp_unconfigure_interface(struct interface *ifp);
+lagopus_result_t afxdp_get_hwaddr(struct interface *ifp, uint8_t hw_addr[]);
+lagopus_result_t
+afxdp_rx_burst(struct interface *ifp, void *mbufs[], size_t nb);
+
 
 #endif /* SRC_INCLUDE_LAGOPUS_INTERFACE_H_ */
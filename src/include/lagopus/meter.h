@@ -50,7 +50,7 @@ struct meter_band {
                                          ** to add.  Only used by
                                          ** OFPMBT_DSCP_REMARK. */
   uint32_t experimenter;                /** Experimenter. */
-  struct ofp_meter_band_stats stats;    /** Counters. */
+  uint32_t counter_id;                  /** Band packet and byte counter. */
 };
 
 TAILQ_HEAD(meter_band_list, meter_band);        /** Meter band list. */
@@ -63,8 +63,8 @@ struct meter {
   uint16_t flags;                       /** ofp_meter_flags. */
   struct meter_band_list band_list;     /** Unordered list of meter band. */
   uint32_t flow_count;                  /** Flow count. */
-  uint64_t input_packet_count;          /** Input packet count. */
-  uint64_t input_byte_count;            /** Input byte count. */
+  uint32_t counter_id;                  /** Input packet and byte
+                                         ** counter. */
   uint32_t duration_sec;                /** Duration (sec part) */
   uint32_t duration_nanosec;            /** Duration (nanosec part) */
   struct timespec create_time;          /** Creation time. */
@@ -72,15 +72,18 @@ struct meter {
 };
 
 struct meter_table;
+struct bridge;
 
 /**
  * Allocate meter table.
  *
+ * @param[in]   parent          Parent bridge.
+ *
  * @retval      !=NULL          Meter table.
  * @retval      ==NULL          Memory exhausted.
  */
 struct meter_table *
-meter_table_alloc(void);
+meter_table_alloc(struct bridge *parent);
 
 /**
  * Free meter table.
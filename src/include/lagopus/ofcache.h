@@ -25,6 +25,7 @@
 #define FLOWCACHE_HASHMAP        1
 #define FLOWCACHE_PTREE          2
 #define FLOWCACHE_RTE_HASH       3
+#define FLOWCACHE_CUCKOO         4
 
 #define CACHE_NODE_MAX_ENTRIES 256
 
@@ -39,6 +40,7 @@ struct ofcachestat {
   uint64_t nentries;                    /** number of cache entry */
   uint64_t hit;                         /** cache hit count */
   uint64_t miss;                        /** cache miss count */
+  uint64_t invalidated;                 /** stale entry count */
 };
 
 /**
@@ -54,6 +56,9 @@ struct cache_entry {
     };
   };
   unsigned nmatched;                    /** number of flow. */
+  uint32_t *generation;                 /** generation of the tables
+                                         ** at looking up the flows. */
+  uint8_t *table_id;                    /** table id of the flows. */
   struct flow *flow[0];                 /** flow entries. */
 };
 
@@ -69,6 +74,9 @@ struct cache_entry {
  *      FLOWCACHE_HASHMAP_NOLOCK
  *      FLOWCACHE_HASHMAP
  *      FLOWCACHE_PTREE
+ *      FLOWCACHE_RTE_HASH
+ *      FLOWCACHE_CUCKOO        preallocated, per thread.  entries of
+ *                              more than 4 flows are not cached.
  */
 struct flowcache *init_flowcache(int kvs_type);
 
@@ -79,12 +87,15 @@ struct flowcache *init_flowcache(int kvs_type);
  * @param[in]   hash64          Hash value for lookup cache entry.
  * @param[in]   nmatched        Number of flows.
  * @param[in]   flow            Flow entries.
+ * @param[in]   generation      Generation of the table of each flow,
+ *                              read before looking up the flow.
  */
 void
 register_cache(struct flowcache *cache,
                uint64_t hash64,
                unsigned nmatched,
-               const struct flow **flow);
+               const struct flow **flow,
+               const uint32_t *generation);
 
 /**
  * Clear all cache entry.
@@ -101,10 +112,27 @@ void clear_all_cache(struct flowcache *cache);
  *
  * @retval      !=NULL  Cache entry.
  * @retval      ==NULL  does not exist in cache.
+ *
+ * Entry referring a table changed after registration is stale,
+ * removed and not returned.
  */
 struct cache_entry *
 cache_lookup(struct flowcache *cache, struct lagopus_packet *pkt);
 
+/**
+ * Lookup cache for packets of a burst.  Memory of all packets is
+ * fetched before comparing keys, to overlap the latency.
+ *
+ * @param[in]   cache   Flow cache object.
+ * @param[in]   pkts    Packets, hash value is already calculated.
+ * @param[in]   npkts   Number of packets.
+ * @param[out]  entries Cache entry of each packet, NULL if not found.
+ */
+void
+cache_lookup_bulk(struct flowcache *cache,
+                  struct lagopus_packet *pkts[], size_t npkts,
+                  struct cache_entry *entries[]);
+
 /**
  * Finalize cache.
  *
@@ -32,7 +32,7 @@
 struct bucket {
   TAILQ_ENTRY(bucket) entry;
   struct ofp_bucket ofp;
-  struct ofp_bucket_counter counter;
+  uint32_t counter_id;
   struct action_list action_list;
   struct action_list actions[LAGOPUS_ACTION_SET_ORDER_MAX];
 };
@@ -28,6 +28,23 @@
 struct ofp_handler_record;
 struct channel;
 
+/* max number of handler threads. */
+#define OFP_HANDLER_THREADS_MAX 16
+
+/**
+ * Stats of a handler thread.
+ */
+struct ofp_handler_stats {
+  uint64_t bridges;             /** Number of bridges of the thread. */
+  uint64_t channelq_entries;    /** Entries in channelq. */
+  uint64_t eventq_entries;      /** Entries in eventq of the bridges. */
+  uint64_t dataq_entries;       /** Entries in dataq of the bridges. */
+  uint64_t requests;            /** Processed messages from channels. */
+  uint64_t echo_requests;       /** Processed echo requests. */
+  uint64_t latency_avg;         /** Average time in channelq (nsec). */
+  uint64_t latency_max;         /** Max time in channelq (nsec). */
+};
+
 /**
  * Create ofp_handler
  */
@@ -65,6 +82,19 @@ ofp_handler_finalize(void);
 lagopus_result_t
 ofp_handler_get_channelq(lagopus_bbq_t **retptr);
 
+/**
+ * get channelq of the thread handling the bridge.
+ *
+ *     @param[in]	dpid	Datapath id.
+ *     @param[out]	retptr	A pointer to channelq.
+ *
+ *     @retval	LAGOPUS_RESULT_OK	Succeeded.
+ *     @retval	LAGOPUS_RESULT_INVALID_OBJECT	Failed, invalid object
+ *     @retval	LAGOPUS_RESULT_INVALID_ARGS	Failed, invalid args
+ */
+lagopus_result_t
+ofp_handler_get_channelq_by_dpid(uint64_t dpid, lagopus_bbq_t **retptr);
+
 /**
  * put eventq_data for event_dataq
  */
@@ -93,6 +123,27 @@ ofp_handler_dataq_data_put(uint64_t dpid,
                            struct eventq_data **data,
                            lagopus_chrono_t timeout);
 
+/**
+ * Put array of data to dataq without lookup for each data.
+ *
+ *     @param[in]	dpid	Datapath id.
+ *     @param[in]	data	An array of pointers to \e eventq_data structure.
+ *     @param[in]	n	Number of elements of \b data.
+ *     @param[out]	n_put	Number of elements put.
+ *     @param[in]	A wait time (in nsec).
+ *
+ *     @retval	LAGOPUS_RESULT_OK	Succeeded.
+ *     @retval	LAGOPUS_RESULT_NOT_FOUND	Not found dpid.
+ *     @retval	LAGOPUS_RESULT_TIMEDOUT	Timedout.
+ *     @retval	LAGOPUS_RESULT_ANY_FAILURES	Failed.
+ */
+lagopus_result_t
+ofp_handler_dataq_data_put_n(uint64_t dpid,
+                             struct eventq_data **data,
+                             size_t n,
+                             size_t *n_put,
+                             lagopus_chrono_t timeout);
+
 /**
  * Put data to eventq.
  *
@@ -110,6 +161,27 @@ ofp_handler_eventq_data_put(uint64_t dpid,
                             struct eventq_data **data,
                             lagopus_chrono_t timeout);
 
+/**
+ * Put array of data to eventq.
+ *
+ *     @param[in]	dpid	Datapath id.
+ *     @param[in]	data	An array of pointers to \e eventq_data structure.
+ *     @param[in]	n	Number of elements of \b data.
+ *     @param[out]	n_put	Number of elements put.
+ *     @param[in]	A wait time (in nsec).
+ *
+ *     @retval	LAGOPUS_RESULT_OK	Succeeded.
+ *     @retval	LAGOPUS_RESULT_NOT_FOUND	Not found dpid.
+ *     @retval	LAGOPUS_RESULT_TIMEDOUT	Timedout.
+ *     @retval	LAGOPUS_RESULT_ANY_FAILURES	Failed.
+ */
+lagopus_result_t
+ofp_handler_eventq_data_put_n(uint64_t dpid,
+                              struct eventq_data **data,
+                              size_t n,
+                              size_t *n_put,
+                              lagopus_chrono_t timeout);
+
 /**
  * Get data event_dataq.
  *
@@ -186,4 +258,39 @@ ofp_handler_channelq_max_batches_get(void);
 lagopus_result_t
 ofp_handler_channelq_stats_get(uint16_t *val);
 
+/**
+ * Set number of handler threads.  Bridges are sharded by dpid to the
+ * threads, and each thread handles queues and channels of its bridges.
+ * It takes effect at next start.
+ *
+ *     @param[in]	val	Number of threads.
+ *
+ *     @retval	LAGOPUS_RESULT_OK	Succeeded.
+ *     @retval	LAGOPUS_RESULT_OUT_OF_RANGE	Failed, out of range.
+ */
+lagopus_result_t
+ofp_handler_threads_set(uint16_t val);
+
+/**
+ * Get number of handler threads.
+ *
+ *     @retval	handler_threads
+ */
+uint16_t
+ofp_handler_threads_get(void);
+
+/**
+ * Get stats of a running handler thread.
+ *
+ *     @param[in]	idx	Index of the thread.
+ *     @param[out]	stats	Stats.
+ *
+ *     @retval	LAGOPUS_RESULT_OK	Succeeded.
+ *     @retval	LAGOPUS_RESULT_OUT_OF_RANGE	Failed, no such thread.
+ *     @retval	LAGOPUS_RESULT_INVALID_OBJECT	Failed, invalid object
+ *     @retval	LAGOPUS_RESULT_INVALID_ARGS	Failed, invalid args
+ */
+lagopus_result_t
+ofp_handler_thread_stats_get(uint16_t idx, struct ofp_handler_stats *stats);
+
 #endif /* __LAGOPUS_OFP_HANDLER_H__ */
@@ -68,6 +68,66 @@ ofp_flow_stats_get(uint64_t dpid,
                    struct match_list *match_list,
                    struct flow_stats_list *flow_stats_list,
                    struct ofp_error *error);
+
+/**
+ * Position of flow stats walk, zero cleared before the first walk.
+ * The walk is resumed after the last flow passed, which is identified
+ * by its priority and insertion order since flows are moved in the
+ * table by flow_mod between walks.
+ */
+struct flow_stats_cursor {
+  int table_id;                 /** Table to be walked. */
+  bool resume;                  /** priority and seq are valid. */
+  int32_t priority;             /** Priority of the last flow passed. */
+  uint64_t seq;                 /** Insertion order of the last flow
+                                 ** passed. */
+  bool done;                    /** All flows are walked. */
+};
+
+/**
+ * Flow stats procedure called for each flow in walk.  Lists belong to
+ * the flow entry, and valid only in the call.
+ *
+ *     @retval	LAGOPUS_RESULT_OK	Continue walk.
+ *     @retval	LAGOPUS_RESULT_OUT_OF_RANGE	Stop walk, the flow is
+ *     passed again in the next walk.
+ *     @retval	!=LAGOPUS_RESULT_OK	Stop walk with the error.
+ */
+typedef lagopus_result_t
+(*flow_stats_proc_t)(void *arg,
+                     const struct ofp_flow_stats *flow_stats,
+                     struct match_list *match_list,
+                     struct instruction_list *instruction_list);
+
+/**
+ * Walk flows for \b OFPMP_FLOW without copying them.  The flow
+ * database is locked only in the call, the walk stops when proc
+ * returns LAGOPUS_RESULT_OUT_OF_RANGE or enough flows are scanned, and
+ * is resumed from the cursor.  A flow present through the whole walk
+ * is passed exactly once even if other flows are added or removed
+ * between walks.
+ *
+ *     @param[in]	dpid	Datapath id.
+ *     @param[in]	flow_stats_request	A pointer to \e ofp_flow_stats_request
+ *     structure.
+ *     @param[in]	match_list	A pointer to list of match.
+ *     @param[in,out]	cursor	A pointer to \e flow_stats_cursor structure.
+ *     @param[in]	proc	Procedure called for each matched flow.
+ *     @param[in]	arg	Argument of proc.
+ *     @param[out]	error	A pointer to \e ofp_error structure.
+ *     If errors occur, set filed values.
+ *
+ *     @retval	LAGOPUS_RESULT_OK	Succeeded, cursor->done is set
+ *     if all flows are walked.
+ *     @retval	LAGOPUS_RESULT_ANY_FAILURES	Failed.
+ */
+lagopus_result_t
+ofp_flow_stats_walk(uint64_t dpid,
+                    struct ofp_flow_stats_request *flow_stats_request,
+                    struct match_list *match_list,
+                    struct flow_stats_cursor *cursor,
+                    flow_stats_proc_t proc, void *arg,
+                    struct ofp_error *error);
 /* Multipart - Flow Stats END */
 
 /* Multipart - Queue stats */
@@ -36,6 +36,8 @@ struct port {
   int type;                             /** Port type. */
   struct ofp_port ofp_port;             /** OpenFlow port. */
   struct ofp_port_stats ofp_port_stats; /** OpenFlow port statistics. */
+  volatile uint32_t stats_seq;          /** Sequence of ofp_port_stats,
+                                         *  odd while being updated. */
   uint32_t ifindex;                     /** Interface index for physical port.
                                          *  Not same as ofp_port.port_no. */
   struct bridge *bridge;                /** Parent bridge. */
@@ -119,6 +121,25 @@ lagopus_get_port_statistics(lagopus_hashmap_t *hm,
                             struct port_stats_list *list,
                             struct ofp_error *error);
 
+/**
+ * Publish port statistics snapshot.
+ * Only the statistics collector thread updates the snapshot.
+ *
+ * @param[in]   port    Port.
+ * @param[in]   stats   Statistics read from the driver.
+ */
+void
+dp_port_stats_publish(struct port *port, const struct ofp_port_stats *stats);
+
+/**
+ * Get consistent copy of port statistics snapshot without lock.
+ *
+ * @param[in]   port    Port.
+ * @param[out]  stats   Copy of the latest snapshot.
+ */
+void
+dp_port_stats_snapshot(const struct port *port, struct ofp_port_stats *stats);
+
 /**
  * Process port_mod request.
  *
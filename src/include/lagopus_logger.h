@@ -71,6 +71,13 @@
 
 #define TRACE_MAX_SIZE 4096
 
+
+/**
+ * Default interval (nsec) and burst of the rate limited messages.
+ */
+#define LAGOPUS_LOG_RATELIMIT_INTERVAL	(5LL * 1000LL * 1000LL * 1000LL)
+#define LAGOPUS_LOG_RATELIMIT_BURST	10
+
 
 
 
@@ -93,6 +100,24 @@ typedef enum {
 } lagopus_log_destination_t;
 
 
+/**
+ * A rate limit state of a call site. Static storage defined by the
+ * lagopus_msg_*_ratelimited() macros; don't touch the members.
+ */
+typedef struct lagopus_log_ratelimit {
+  volatile lagopus_chrono_t m_begin;
+  volatile uint32_t m_n_emitted;
+  volatile uint32_t m_n_suppressed;
+  volatile bool m_is_registered;
+  lagopus_chrono_t m_interval;
+  lagopus_log_level_t m_level;
+  const char *m_file;
+  int m_line;
+  const char *m_func;
+  struct lagopus_log_ratelimit *m_next;
+} lagopus_log_ratelimit_t;
+
+
 
 
 
@@ -212,6 +237,57 @@ lagopus_log_destination_t
 lagopus_log_get_destination(const char **arg);
 
 
+/**
+ * Switch the logger to the asynchronous mode or back.
+ *
+ *	@param[in]	async	\b true: each thread puts the messages into
+ *	its own lock-free ring and a writer thread emits them, \b false:
+ *	the calling thread emits the messages with the logger locked
+ *	(blocking, the default.)
+ *
+ *	@details In the asynchronous mode only the message body is
+ *	formatted by the calling thread, the header is formatted by the
+ *	writer thread. The messages are dropped and counted if the ring
+ *	is full. The fatal messages and the messages too long for the
+ *	ring are always emitted synchronously.
+ */
+void	lagopus_log_set_async(bool async);
+
+
+/**
+ * Check if the logger is in the asynchronous mode.
+ *
+ *	@returns	\b true if asynchronous.
+ */
+bool	lagopus_log_is_async(void);
+
+
+/**
+ * Wait until the messages put so far are emitted by the writer
+ * thread. Returns immediately in the synchronous mode.
+ */
+void	lagopus_log_flush(void);
+
+
+/**
+ * Check the rate limit of a call site: not intended for direct use.
+ *
+ *	@details The number of the suppressed messages is emitted when
+ *	the next interval begins, or by the writer thread in the
+ *	asynchronous mode if the call site stays quiet.
+ *
+ *	@retval	true	Emit the message.
+ *	@retval	false	Suppress the message.
+ */
+bool	lagopus_log_ratelimit(lagopus_log_ratelimit_t *rl,
+                            lagopus_log_level_t log_level,
+                            const char *file,
+                            int line,
+                            const char *func,
+                            lagopus_chrono_t interval,
+                            uint32_t burst);
+
+
 /**
  * The main logging workhorse: not intended for direct use.
  */
@@ -316,6 +392,52 @@ __attr_format_printf__(6, 7);
                    __PROC__, __VA_ARGS__)
 
 
+/**
+ * Emit a message at most \b burst times per \b interval (nsec) from
+ * the call site.
+ *
+ *	@param[in]	lv	A log level (lagopus_log_level_t).
+ *	@param[in]	interval	An interval in nsec.
+ *	@param[in]	burst	Max messages in an interval.
+ */
+#define lagopus_msg_ratelimited(lv, interval, burst, ...)               \
+  do {                                                                  \
+    static lagopus_log_ratelimit_t __rl;                                \
+    if (lagopus_log_ratelimit(&__rl, (lv), __FILE__, __LINE__,          \
+                              __PROC__, (interval), (burst)) == true) { \
+      lagopus_log_emit((lv), 0LL, __FILE__, __LINE__, __PROC__,         \
+                       __VA_ARGS__);                                    \
+    }                                                                   \
+  } while (0)
+
+
+/**
+ * Emit a rate limited informative message to the log.
+ */
+#define lagopus_msg_info_ratelimited(...)                               \
+  lagopus_msg_ratelimited(LAGOPUS_LOG_LEVEL_INFO,                       \
+                          LAGOPUS_LOG_RATELIMIT_INTERVAL,               \
+                          LAGOPUS_LOG_RATELIMIT_BURST, __VA_ARGS__)
+
+
+/**
+ * Emit a rate limited warning message to the log.
+ */
+#define lagopus_msg_warning_ratelimited(...)                            \
+  lagopus_msg_ratelimited(LAGOPUS_LOG_LEVEL_WARNING,                    \
+                          LAGOPUS_LOG_RATELIMIT_INTERVAL,               \
+                          LAGOPUS_LOG_RATELIMIT_BURST, __VA_ARGS__)
+
+
+/**
+ * Emit a rate limited error message to the log.
+ */
+#define lagopus_msg_error_ratelimited(...)                              \
+  lagopus_msg_ratelimited(LAGOPUS_LOG_LEVEL_ERROR,                      \
+                          LAGOPUS_LOG_RATELIMIT_INTERVAL,               \
+                          LAGOPUS_LOG_RATELIMIT_BURST, __VA_ARGS__)
+
+
 /**
  * Emit an arbitarary message to the log.
  */
@@ -93,12 +93,82 @@ static const char *const s_trace_strs[] = {
 static size_t s_n_trace_strs = sizeof(s_trace_strs) / sizeof(char *);
 
 
+
+
+
+/*
+ * The asynchronous mode.
+ *
+ *	Each thread owns a single producer/single consumer ring of the
+ *	records. The thread formats only the message body into a record,
+ *	and the writer thread formats the headers and emits the records
+ *	of all the rings with the logger locked once per batch.
+ */
+#define LOG_RING_SIZE		256	/* records per thread, power of 2. */
+#define LOG_RECORD_MSG_MAX	512
+#define LOG_THD_INFO_MAX	64
+#define LOG_WRITER_IDLE_NSEC	(10LL * 1000LL * 1000LL)
+#define LOG_WAIT_NSEC		(100LL * 1000LL)
+#define LOG_REPORT_INTERVAL	(1000LL * 1000LL * 1000LL)
+
+typedef struct log_record {
+  lagopus_log_level_t m_level;
+  uint64_t m_debug_level;
+  time_t m_time;
+  const char *m_file;
+  int m_line;
+  const char *m_func;
+  char m_msg[LOG_RECORD_MSG_MAX];
+} log_record_t;
+
+typedef struct log_ring {
+  volatile uint64_t m_head;		/* by the writer. */
+  uint64_t m_n_reported_drops;		/* by the writer. */
+  volatile uint64_t m_tail		/* by the owner thread. */
+  __attribute__((aligned(64)));
+  volatile uint64_t m_n_drops;		/* by the owner thread. */
+  volatile bool m_is_used;
+  char m_thd_info[LOG_THD_INFO_MAX];
+  struct log_ring *volatile m_next;
+  log_record_t m_records[LOG_RING_SIZE];
+} log_ring_t;
+
+static volatile bool s_is_async = false;
+static volatile bool s_writer_is_running = false;
+static volatile bool s_writer_do_stop = false;
+static pthread_t s_writer_tid;
+static __thread bool s_is_writer = false;
+
+static pthread_mutex_t s_rings_lock = PTHREAD_MUTEX_INITIALIZER;
+static log_ring_t *volatile s_rings = NULL;
+static __thread log_ring_t *s_ring = NULL;
+static pthread_key_t s_ring_key;
+static bool s_is_ring_key_initialized = false;
+
+static lagopus_log_ratelimit_t *volatile s_ratelimits = NULL;
+
+
 
 
 
 static void
 s_child_at_fork(void) {
+  log_ring_t *r;
+
   (void)pthread_mutex_init(&s_log_lock, NULL);
+  (void)pthread_mutex_init(&s_rings_lock, NULL);
+
+  /*
+   * The writer thread is gone, and the records belong to the parent.
+   * The writer is started again by the next message.
+   */
+  s_writer_is_running = false;
+  for (r = s_rings; r != NULL; r = r->m_next) {
+    r->m_head = r->m_tail;
+    r->m_n_reported_drops = r->m_n_drops;
+    r->m_is_used = false;
+  }
+  s_ring = NULL;
 }
 
 
@@ -287,10 +357,10 @@ s_get_syslog_priority(lagopus_log_level_t l) {
 
 
 static inline size_t
-s_get_date_str(char *buf, size_t buf_len) {
+s_get_date_str(time_t x, char *buf, size_t buf_len) {
   const char *fmt = "[%a %h %d %T %Z %Y]";
-  time_t x = time(NULL);
-  return strftime(buf, buf_len, fmt, localtime(&x));
+  struct tm tm;
+  return strftime(buf, buf_len, fmt, localtime_r(&x, &tm));
 }
 
 
@@ -337,27 +407,126 @@ done:
 
 
 static inline void
-s_do_log(lagopus_log_level_t l, const char *msg) {
-  FILE *fd;
-  int o_cancel_state;
+s_get_thd_info_str(char *buf, size_t buf_len) {
+  pthread_t tid;
+  char thd_name[32];
+  int st = 0;
 
-  (void)pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &o_cancel_state);
+  tid = pthread_self();
+#ifdef HAVE_PTHREAD_SETNAME_NP
+  st = pthread_getname_np(tid, thd_name, sizeof(thd_name));
+#else
+  thd_name[0] = '\0';
+  st = -1;
+#endif /* HAVE_PTHREAD_SETNAME_NP */
+#if SIZEOF_PTHREAD_T == SIZEOF_INT64_T
+#define TIDFMT "0x" PFTIDS(016, x)
+#elif SIZEOF_PTHREAD_T == SIZEOF_INT
+#define TIDFMT "0x" PFTIDS(08, x)
+#endif /* SIZEOF_PTHREAD_T == SIZEOF_INT64_T ... */
+  if (st == 0 && IS_VALID_STRING(thd_name) == true) {
+    snprintf(buf, buf_len, "[%u:" TIDFMT ":%s]",
+             (unsigned int)getpid(),
+             tid,
+             thd_name);
+  } else {
+    snprintf(buf, buf_len, "[%u:" TIDFMT "]",
+             (unsigned int)getpid(),
+             tid);
+  }
+}
 
-  s_lock();
 
+/*
+ * Returns the header length WITHOUT '\0'.
+ */
+static inline size_t
+s_get_header_str(lagopus_log_level_t lv,
+                 uint64_t debug_level,
+                 time_t t,
+                 const char *thd_info,
+                 const char *file,
+                 int line,
+                 const char *func,
+                 char *buf, size_t buf_len) {
+  char date_buf[32];
+  char trace_info_buf[1024];
+  size_t trace_info_len = 0;
+  int len;
+
+  if (lv == LAGOPUS_LOG_LEVEL_TRACE) {
+    uint32_t f = (uint32_t)debug_level & 0xffffffff;
+    trace_info_len = s_get_trace_str(f,
+                                     trace_info_buf,
+                                     sizeof(trace_info_buf));
+  }
+
+  if (s_do_date == true) {
+    s_get_date_str(t, date_buf, sizeof(date_buf));
+  } else {
+    date_buf[0] = '\0';
+  }
+
+  if (trace_info_len == 0) {
+    len = snprintf(buf, buf_len,
+                   "%s%s%s:%s:%d:%s: ",
+                   date_buf,
+                   s_get_level_str(lv),
+                   thd_info,
+                   file, line, func);
+  } else {
+    len = snprintf(buf, buf_len,
+                   "%s[%s%s]%s:%s:%d:%s: ",
+                   date_buf,
+                   s_get_level_str(lv), trace_info_buf,
+                   thd_info,
+                   file, line, func);
+  }
+
+  if (len < 0) {
+    buf[0] = '\0';
+    return 0;
+  }
+  return ((size_t)len < buf_len) ? (size_t)len : buf_len - 1;
+}
+
+
+static inline void
+s_write(lagopus_log_level_t l, const char *hdr, const char *msg) {
   switch (s_log_dst) {
     case LAGOPUS_LOG_EMIT_TO_FILE:
     case LAGOPUS_LOG_EMIT_TO_UNKNOWN: {
-      fd = (s_log_fd != NULL) ? s_log_fd : stderr;
-      (void)fprintf(fd, "%s", msg);
-      (void)fflush(fd);
+      FILE *fd = (s_log_fd != NULL) ? s_log_fd : stderr;
+      (void)fprintf(fd, "%s%s", hdr, msg);
       break;
     }
     case LAGOPUS_LOG_EMIT_TO_SYSLOG: {
       int prio = s_get_syslog_priority(l);
-      syslog(prio, "%s", msg);
+      syslog(prio, "%s%s", hdr, msg);
     }
   }
+}
+
+
+static inline void
+s_flush(void) {
+  if (s_log_dst == LAGOPUS_LOG_EMIT_TO_FILE ||
+      s_log_dst == LAGOPUS_LOG_EMIT_TO_UNKNOWN) {
+    (void)fflush((s_log_fd != NULL) ? s_log_fd : stderr);
+  }
+}
+
+
+static inline void
+s_do_log(lagopus_log_level_t l, const char *msg) {
+  int o_cancel_state;
+
+  (void)pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &o_cancel_state);
+
+  s_lock();
+
+  s_write(l, "", msg);
+  s_flush();
 
   s_unlock();
 
@@ -365,6 +534,335 @@ s_do_log(lagopus_log_level_t l, const char *msg) {
 }
 
 
+static inline void
+s_do_log_sync(lagopus_log_level_t lv,
+              uint64_t debug_level,
+              const char *file,
+              int line,
+              const char *func,
+              const char *fmt, va_list args)
+__attr_format_printf__(6, 0);
+
+
+static inline void
+s_do_log_sync(lagopus_log_level_t lv,
+              uint64_t debug_level,
+              const char *file,
+              int line,
+              const char *func,
+              const char *fmt, va_list args) {
+  char msg[4096];
+  size_t hdr_len;
+  size_t left_len;
+  char thd_info_buf[1024];
+
+  s_get_thd_info_str(thd_info_buf, sizeof(thd_info_buf));
+  hdr_len = s_get_header_str(lv, debug_level,
+                             (s_do_date == true) ? time(NULL) : 0,
+                             thd_info_buf, file, line, func,
+                             msg, sizeof(msg));
+
+  /*
+   * hdr_len indicates the buffer length WITHOUT '\0'.
+   */
+  left_len = sizeof(msg) - hdr_len;
+  if (left_len > 1) {
+    (void)vsnprintf(msg + hdr_len, left_len -1, fmt, args);
+  }
+
+  s_do_log(lv, msg);
+}
+
+
+
+
+
+static inline lagopus_chrono_t
+s_now(void) {
+  struct timespec ts;
+
+  (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (lagopus_chrono_t)ts.tv_sec * 1000LL * 1000LL * 1000LL +
+         (lagopus_chrono_t)ts.tv_nsec;
+}
+
+
+static inline void
+s_nap(lagopus_chrono_t nsec) {
+  struct timespec ts;
+
+  ts.tv_sec = (time_t)(nsec / (1000LL * 1000LL * 1000LL));
+  ts.tv_nsec = (long)(nsec % (1000LL * 1000LL * 1000LL));
+  (void)nanosleep(&ts, NULL);
+}
+
+
+static void
+s_ring_release(void *ptr) {
+  log_ring_t *r = (log_ring_t *)ptr;
+
+  if (r != NULL) {
+    r->m_is_used = false;
+  }
+}
+
+
+static inline log_ring_t *
+s_ring_get(void) {
+  log_ring_t *r = s_ring;
+
+  if (likely(r != NULL)) {
+    return r;
+  }
+
+  (void)pthread_mutex_lock(&s_rings_lock);
+  {
+    /*
+     * Reuse the ring of an exited thread once the writer drained it.
+     */
+    for (r = s_rings; r != NULL; r = r->m_next) {
+      if (r->m_is_used == false && r->m_head == r->m_tail) {
+        break;
+      }
+    }
+    if (r == NULL &&
+        (r = (log_ring_t *)malloc(sizeof(*r))) != NULL) {
+      (void)memset((void *)r, 0, sizeof(*r));
+      r->m_next = s_rings;
+      mbar();
+      s_rings = r;
+    }
+    if (r != NULL) {
+      r->m_is_used = true;
+      s_get_thd_info_str(r->m_thd_info, sizeof(r->m_thd_info));
+      if (s_is_ring_key_initialized == true) {
+        (void)pthread_setspecific(s_ring_key, (void *)r);
+      }
+      s_ring = r;
+    }
+  }
+  (void)pthread_mutex_unlock(&s_rings_lock);
+
+  return r;
+}
+
+
+static inline bool
+s_ring_put(log_ring_t *r,
+           lagopus_log_level_t lv,
+           uint64_t debug_level,
+           const char *file,
+           int line,
+           const char *func,
+           const char *fmt, va_list args)
+__attr_format_printf__(7, 0);
+
+
+/*
+ * Returns false if the message is too long for a record.
+ */
+static inline bool
+s_ring_put(log_ring_t *r,
+           lagopus_log_level_t lv,
+           uint64_t debug_level,
+           const char *file,
+           int line,
+           const char *func,
+           const char *fmt, va_list args) {
+  uint64_t tail = r->m_tail;
+  log_record_t *rec;
+  int len;
+
+  if (tail - r->m_head >= LOG_RING_SIZE) {
+    r->m_n_drops++;
+    return true;
+  }
+
+  rec = &(r->m_records[tail & (LOG_RING_SIZE - 1)]);
+  len = vsnprintf(rec->m_msg, sizeof(rec->m_msg), fmt, args);
+  if (len < 0 || (size_t)len >= sizeof(rec->m_msg)) {
+    return false;
+  }
+  rec->m_level = lv;
+  rec->m_debug_level = debug_level;
+  rec->m_time = (s_do_date == true) ? time(NULL) : 0;
+  rec->m_file = file;
+  rec->m_line = line;
+  rec->m_func = func;
+
+  mbar();
+  r->m_tail = tail + 1;
+
+  return true;
+}
+
+
+static inline void
+s_ring_wait_empty(log_ring_t *r) {
+  while (r->m_head != r->m_tail &&
+         s_writer_is_running == true &&
+         s_is_writer == false) {
+    s_nap(LOG_WAIT_NSEC);
+  }
+}
+
+
+static inline size_t
+s_ring_drain(void) {
+  char hdr[2048];
+  log_ring_t *r;
+  log_record_t *rec;
+  uint64_t tail;
+  uint64_t n_drops;
+  size_t n = 0;
+  int o_cancel_state;
+
+  (void)pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &o_cancel_state);
+
+  s_lock();
+
+  for (r = s_rings; r != NULL; r = r->m_next) {
+    tail = r->m_tail;
+    mbar();
+    while (r->m_head != tail) {
+      rec = &(r->m_records[r->m_head & (LOG_RING_SIZE - 1)]);
+      (void)s_get_header_str(rec->m_level, rec->m_debug_level, rec->m_time,
+                             r->m_thd_info,
+                             rec->m_file, rec->m_line, rec->m_func,
+                             hdr, sizeof(hdr));
+      s_write(rec->m_level, hdr, rec->m_msg);
+      mbar();
+      r->m_head++;
+      n++;
+    }
+
+    n_drops = r->m_n_drops;
+    if (n_drops != r->m_n_reported_drops) {
+      char msg[64];
+
+      (void)s_get_header_str(LAGOPUS_LOG_LEVEL_WARNING, 0LL,
+                             (s_do_date == true) ? time(NULL) : 0,
+                             r->m_thd_info, __FILE__, __LINE__, __PROC__,
+                             hdr, sizeof(hdr));
+      (void)snprintf(msg, sizeof(msg), "%" PRIu64 " messages dropped.\n",
+                     n_drops - r->m_n_reported_drops);
+      s_write(LAGOPUS_LOG_LEVEL_WARNING, hdr, msg);
+      r->m_n_reported_drops = n_drops;
+      n++;
+    }
+  }
+
+  if (n > 0) {
+    s_flush();
+  }
+
+  s_unlock();
+
+  (void)pthread_setcancelstate(o_cancel_state, NULL);
+
+  return n;
+}
+
+
+static inline void
+s_ratelimit_reset(lagopus_log_ratelimit_t *rl,
+                  lagopus_chrono_t begin, lagopus_chrono_t now) {
+  if (__sync_bool_compare_and_swap(&(rl->m_begin), begin, now) == true) {
+    uint32_t n;
+
+    rl->m_n_emitted = 0;
+    n = __sync_lock_test_and_set(&(rl->m_n_suppressed), 0);
+    if (n > 0) {
+      lagopus_log_emit(rl->m_level, 0LL, rl->m_file, rl->m_line, rl->m_func,
+                       "%u messages suppressed.\n", n);
+    }
+  }
+}
+
+
+static inline void
+s_ratelimit_report(lagopus_chrono_t now) {
+  lagopus_log_ratelimit_t *rl;
+  lagopus_chrono_t begin;
+
+  for (rl = s_ratelimits; rl != NULL; rl = rl->m_next) {
+    begin = rl->m_begin;
+    if (rl->m_n_suppressed > 0 && now - begin >= rl->m_interval) {
+      s_ratelimit_reset(rl, begin, now);
+    }
+  }
+}
+
+
+static void *
+s_writer_main(void *arg) {
+  lagopus_chrono_t now;
+  lagopus_chrono_t last_report = s_now();
+
+  (void)arg;
+
+  s_is_writer = true;
+#ifdef HAVE_PTHREAD_SETNAME_NP
+  (void)pthread_setname_np(pthread_self(), "log_writer");
+#endif /* HAVE_PTHREAD_SETNAME_NP */
+
+  while (s_writer_do_stop == false) {
+    if (s_ring_drain() == 0) {
+      s_nap(LOG_WRITER_IDLE_NSEC);
+    }
+    now = s_now();
+    if (now - last_report >= LOG_REPORT_INTERVAL) {
+      s_ratelimit_report(now);
+      last_report = now;
+    }
+  }
+  (void)s_ring_drain();
+
+  return NULL;
+}
+
+
+static inline bool
+s_writer_start(void) {
+  if (likely(s_writer_is_running == true)) {
+    return true;
+  }
+
+  (void)pthread_mutex_lock(&s_log_lock);
+  if (s_writer_is_running == false && s_is_async == true) {
+    s_writer_do_stop = false;
+    if (pthread_create(&s_writer_tid, NULL, s_writer_main, NULL) == 0) {
+      s_writer_is_running = true;
+    }
+  }
+  (void)pthread_mutex_unlock(&s_log_lock);
+
+  return s_writer_is_running;
+}
+
+
+static inline void
+s_writer_stop(void) {
+  bool is_running;
+  pthread_t tid;
+
+  (void)pthread_mutex_lock(&s_log_lock);
+  is_running = s_writer_is_running;
+  tid = s_writer_tid;
+  s_writer_do_stop = true;
+  (void)pthread_mutex_unlock(&s_log_lock);
+
+  if (is_running == true && pthread_equal(tid, pthread_self()) == 0) {
+    (void)pthread_join(tid, NULL);
+    s_writer_is_running = false;
+    /*
+     * Records put while the writer was exiting.
+     */
+    (void)s_ring_drain();
+  }
+}
+
+
 
 
 
@@ -382,91 +880,38 @@ lagopus_log_emit(lagopus_log_level_t lv,
        lagopus_log_check_trace_flags(debug_level) == true)) {
 
     va_list args;
-    char date_buf[32];
-    char msg[4096];
-    size_t hdr_len;
-    size_t left_len;
-    char thd_info_buf[1024];
-    pthread_t tid;
-    char thd_name[32];
-    int st = 0;
     int s_errno = errno;
-    char trace_info_buf[1024];
-    size_t trace_info_len = 0;
-
-#ifdef DO_TRACE_DETAIL
-    bool do_trace_detail = false;
-    if (lv == LAGOPUS_LOG_LEVEL_TRACE) {
-      do_trace_detail =
-        ((debug_level & 0xffffffff00000000LL) == 0x0000000100000000LL) ?
-        true : false;
-    }
-#endif /* DO_TRACE_DETAIL */
-
-    if (lv == LAGOPUS_LOG_LEVEL_TRACE) {
-      uint32_t f = (uint32_t)debug_level & 0xffffffff;
-      trace_info_len = s_get_trace_str(f,
-                                       trace_info_buf,
-                                       sizeof(trace_info_buf));
-    }
-
-    if (s_do_date == true) {
-      s_get_date_str(date_buf, sizeof(date_buf));
-    } else {
-      date_buf[0] = '\0';
-    }
-
-    tid = pthread_self();
-#ifdef HAVE_PTHREAD_SETNAME_NP
-    st = pthread_getname_np(tid, thd_name, sizeof(thd_name));
-#else
-    thd_name[0] = '\0';
-    st = -1;
-#endif /* HAVE_PTHREAD_SETNAME_NP */
-#if SIZEOF_PTHREAD_T == SIZEOF_INT64_T
-#define TIDFMT "0x" PFTIDS(016, x)
-#elif SIZEOF_PTHREAD_T == SIZEOF_INT
-#define TIDFMT "0x" PFTIDS(08, x)
-#endif /* SIZEOF_PTHREAD_T == SIZEOF_INT64_T ... */
-    if (st == 0 && IS_VALID_STRING(thd_name) == true) {
-      snprintf(thd_info_buf, sizeof(thd_info_buf), "[%u:" TIDFMT ":%s]",
-               (unsigned int)getpid(),
-               tid,
-               thd_name);
-    } else {
-      snprintf(thd_info_buf, sizeof(thd_info_buf), "[%u:" TIDFMT "]",
-               (unsigned int)getpid(),
-               tid);
-    }
+    log_ring_t *r;
 
     va_start(args, fmt);
-    va_end(args);
 
-    if (trace_info_len == 0) {
-      hdr_len = (size_t)snprintf(msg, sizeof(msg),
-                                 "%s%s%s:%s:%d:%s: ",
-                                 date_buf,
-                                 s_get_level_str(lv),
-                                 thd_info_buf,
-                                 file, line, func);
-    } else {
-      hdr_len = (size_t)snprintf(msg, sizeof(msg),
-                                 "%s[%s%s]%s:%s:%d:%s: ",
-                                 date_buf,
-                                 s_get_level_str(lv), trace_info_buf,
-                                 thd_info_buf,
-                                 file, line, func);
+    if (s_is_async == true &&
+        s_is_writer == false &&
+        lv != LAGOPUS_LOG_LEVEL_FATAL &&
+        s_writer_start() == true &&
+        (r = s_ring_get()) != NULL) {
+      va_list args_copy;
+      bool is_put;
+
+      va_copy(args_copy, args);
+      is_put = s_ring_put(r, lv, debug_level, file, line, func,
+                          fmt, args_copy);
+      va_end(args_copy);
+      if (is_put == true) {
+        goto done;
+      }
     }
 
     /*
-     * hdr_len indicates the buffer length WITHOUT '\0'.
+     * Keep the order of the messages of this thread.
      */
-    left_len = sizeof(msg) - hdr_len;
-    if (left_len > 1) {
-      (void)vsnprintf(msg + hdr_len, left_len -1, fmt, args);
+    if (s_ring != NULL) {
+      s_ring_wait_empty(s_ring);
     }
+    s_do_log_sync(lv, debug_level, file, line, func, fmt, args);
 
-    s_do_log(lv, msg);
+  done:
+    va_end(args);
 
     errno = s_errno;
   }
@@ -518,6 +963,9 @@ lagopus_log_finalize(void) {
 
   lagopus_msg_debug(10, "Finalize the logger.\n");
 
+  s_is_async = false;
+  s_writer_stop();
+
   (void)pthread_mutex_lock(&s_log_lock);
   s_log_final();
   (void)pthread_mutex_unlock(&s_log_lock);
@@ -589,6 +1037,81 @@ lagopus_log_check_trace_flags(uint64_t flags) {
 }
 
 
+void
+lagopus_log_set_async(bool async) {
+  if (async == true) {
+    s_is_async = true;
+  } else if (s_is_async == true) {
+    s_is_async = false;
+    s_writer_stop();
+  }
+}
+
+
+bool
+lagopus_log_is_async(void) {
+  return s_is_async;
+}
+
+
+void
+lagopus_log_flush(void) {
+  log_ring_t *r;
+  uint64_t tail;
+
+  if (s_writer_is_running == false || s_is_writer == true) {
+    return;
+  }
+
+  for (r = s_rings; r != NULL; r = r->m_next) {
+    tail = r->m_tail;
+    while ((int64_t)(tail - r->m_head) > 0 &&
+           s_writer_is_running == true) {
+      s_nap(LOG_WAIT_NSEC);
+    }
+  }
+}
+
+
+bool
+lagopus_log_ratelimit(lagopus_log_ratelimit_t *rl,
+                      lagopus_log_level_t log_level,
+                      const char *file,
+                      int line,
+                      const char *func,
+                      lagopus_chrono_t interval,
+                      uint32_t burst) {
+  lagopus_chrono_t now = s_now();
+  lagopus_chrono_t begin = rl->m_begin;
+
+  if (begin == 0 || now - begin >= interval) {
+    rl->m_level = log_level;
+    rl->m_file = file;
+    rl->m_line = line;
+    rl->m_func = func;
+    rl->m_interval = interval;
+    s_ratelimit_reset(rl, begin, now);
+  }
+
+  if (rl->m_n_emitted < burst &&
+      __sync_add_and_fetch(&(rl->m_n_emitted), 1) <= burst) {
+    return true;
+  }
+
+  (void)__sync_add_and_fetch(&(rl->m_n_suppressed), 1);
+  if (rl->m_is_registered == false &&
+      __sync_bool_compare_and_swap(&(rl->m_is_registered),
+                                   false, true) == true) {
+    do {
+      rl->m_next = s_ratelimits;
+    } while (__sync_bool_compare_and_swap(&s_ratelimits,
+                                          rl->m_next, rl) == false);
+  }
+
+  return false;
+}
+
+
 lagopus_log_destination_t
 lagopus_log_get_destination(const char **arg) {
   lagopus_log_destination_t ret = LAGOPUS_LOG_EMIT_TO_UNKNOWN;
@@ -662,6 +1185,10 @@ s_once_proc(void) {
   uint16_t d = 0;
   lagopus_log_destination_t log_dst = LAGOPUS_LOG_EMIT_TO_UNKNOWN;
 
+  if (pthread_key_create(&s_ring_key, s_ring_release) == 0) {
+    s_is_ring_key_initialized = true;
+  }
+
   if (IS_VALID_STRING(dbg_lvl_str) == true) {
     uint16_t tmp = 0;
     if (lagopus_str_parse_uint16(dbg_lvl_str, &tmp) == LAGOPUS_RESULT_OK) {
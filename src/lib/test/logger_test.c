@@ -0,0 +1,178 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lagopus_apis.h"
+#include "unity.h"
+
+#define LOG_FILE "./logger_test.log"
+#define N_THREADS 4
+#define N_MSGS 100
+#define INTERVAL (10LL * 1000LL * 1000LL)
+
+void
+setUp(void) {
+  (void)unlink(LOG_FILE);
+  TEST_ASSERT_EQUAL(LAGOPUS_RESULT_OK,
+                    lagopus_log_initialize(LAGOPUS_LOG_EMIT_TO_FILE,
+                                           LOG_FILE, false, true, 0));
+}
+
+void
+tearDown(void) {
+  lagopus_log_set_async(false);
+  (void)lagopus_log_initialize(LAGOPUS_LOG_EMIT_TO_UNKNOWN, NULL,
+                               false, true, 0);
+  (void)unlink(LOG_FILE);
+}
+
+static size_t
+s_count(const char *str) {
+  FILE *fd;
+  char buf[4096];
+  size_t n = 0;
+
+  fd = fopen(LOG_FILE, "r");
+  TEST_ASSERT_NOT_NULL(fd);
+  while (fgets(buf, sizeof(buf), fd) != NULL) {
+    if (strstr(buf, str) != NULL) {
+      n++;
+    }
+  }
+  (void)fclose(fd);
+
+  return n;
+}
+
+static void *
+s_thread_main(void *arg) {
+  int i;
+
+  (void)arg;
+  for (i = 0; i < N_MSGS; i++) {
+    lagopus_msg_info("thread message %d.\n", i);
+  }
+
+  return NULL;
+}
+
+void
+test_sync(void) {
+  TEST_ASSERT_FALSE(lagopus_log_is_async());
+  lagopus_msg_info("sync message.\n");
+  TEST_ASSERT_EQUAL(1, s_count("sync message."));
+}
+
+void
+test_async(void) {
+  int i;
+
+  lagopus_log_set_async(true);
+  TEST_ASSERT_TRUE(lagopus_log_is_async());
+  for (i = 0; i < N_MSGS; i++) {
+    lagopus_msg_info("async message %d.\n", i);
+  }
+  lagopus_log_flush();
+  TEST_ASSERT_EQUAL(N_MSGS, s_count("async message"));
+
+  /* the header is formatted by the writer. */
+  TEST_ASSERT_EQUAL(N_MSGS, s_count("[INFO ]"));
+}
+
+void
+test_async_long_message(void) {
+  char buf[2048];
+
+  lagopus_log_set_async(true);
+  memset(buf, 'x', sizeof(buf) - 1);
+  buf[sizeof(buf) - 1] = '\0';
+  lagopus_msg_info("first message.\n");
+  lagopus_msg_info("long message %s.\n", buf);
+  lagopus_msg_info("last message.\n");
+  lagopus_log_set_async(false);
+  TEST_ASSERT_EQUAL(1, s_count("first message."));
+  TEST_ASSERT_EQUAL(1, s_count("long message xxx"));
+  TEST_ASSERT_EQUAL(1, s_count("last message."));
+}
+
+void
+test_async_threads(void) {
+  pthread_t tids[N_THREADS];
+  int i;
+
+  lagopus_log_set_async(true);
+  for (i = 0; i < N_THREADS; i++) {
+    TEST_ASSERT_EQUAL(0, pthread_create(&tids[i], NULL,
+                                        s_thread_main, NULL));
+  }
+  for (i = 0; i < N_THREADS; i++) {
+    TEST_ASSERT_EQUAL(0, pthread_join(tids[i], NULL));
+  }
+  lagopus_log_flush();
+  TEST_ASSERT_EQUAL(N_THREADS * N_MSGS, s_count("thread message"));
+}
+
+void
+test_ratelimit(void) {
+  static lagopus_log_ratelimit_t rl;
+  int i;
+
+  for (i = 0; i < 3; i++) {
+    TEST_ASSERT_TRUE(lagopus_log_ratelimit(&rl, LAGOPUS_LOG_LEVEL_INFO,
+                                           __FILE__, __LINE__, __PROC__,
+                                           INTERVAL, 3));
+  }
+  for (i = 0; i < 7; i++) {
+    TEST_ASSERT_FALSE(lagopus_log_ratelimit(&rl, LAGOPUS_LOG_LEVEL_INFO,
+                                            __FILE__, __LINE__, __PROC__,
+                                            INTERVAL, 3));
+  }
+  TEST_ASSERT_EQUAL(0, s_count("messages suppressed."));
+
+  /* the summary is emitted when the next interval begins. */
+  usleep(INTERVAL / 1000LL * 2LL);
+  TEST_ASSERT_TRUE(lagopus_log_ratelimit(&rl, LAGOPUS_LOG_LEVEL_INFO,
+                                         __FILE__, __LINE__, __PROC__,
+                                         INTERVAL, 3));
+  TEST_ASSERT_EQUAL(1, s_count("7 messages suppressed."));
+}
+
+void
+test_ratelimit_macro(void) {
+  int i;
+
+  for (i = 0; i < LAGOPUS_LOG_RATELIMIT_BURST * 2; i++) {
+    lagopus_msg_info_ratelimited("limited message.\n");
+  }
+  TEST_ASSERT_EQUAL(LAGOPUS_LOG_RATELIMIT_BURST,
+                    s_count("limited message."));
+}
+
+void
+test_ratelimit_report(void) {
+  int i;
+
+  lagopus_log_set_async(true);
+  for (i = 0; i < 10; i++) {
+    lagopus_msg_ratelimited(LAGOPUS_LOG_LEVEL_INFO, INTERVAL, 1,
+                            "reported message.\n");
+  }
+
+  /* the writer reports the call site staying quiet. */
+  sleep(2);
+  lagopus_log_flush();
+  TEST_ASSERT_EQUAL(1, s_count("reported message."));
+  TEST_ASSERT_EQUAL(1, s_count("9 messages suppressed."));
+}
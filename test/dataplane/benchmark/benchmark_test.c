@@ -32,7 +32,6 @@
 #include "pktbuf.h"
 #include "packet.h"
 #include "mbtree.h"
-#include "thtable.h"
 
 #include "datapath_test_misc.h"
 
@@ -514,6 +513,7 @@ flow_benchmark(int type,
   struct flow *flow;
   struct lagopus_packet *pkt;
   const struct cache_entry *cache_entry;
+  uint32_t generation;
   uint64_t lookup_count, match_count;
   size_t i;
 
@@ -531,9 +531,9 @@ flow_benchmark(int type,
   }
   if (type == TYPE_THTABLE) {
     flowdb = pkts[0]->in_port->bridge->flowdb;
-    table = table_lookup(flowdb, pkts[0]->table_id);
-    thtable_update(table->flow_list);
-    TEST_ASSERT_NOT_NULL(table->flow_list->thtable);
+    TEST_ASSERT_EQUAL(flowdb_table_classifier_set(flowdb, pkts[0]->table_id,
+                                                  TABLE_CLASSIFIER_THTABLE),
+                      LAGOPUS_RESULT_OK);
   }
   if (type == TYPE_FLOWCACHE) {
     for (i = 0; i < npkts; i++) {
@@ -559,14 +559,15 @@ flow_benchmark(int type,
           flow = find_mbtree(pkt, table->flow_list);
           break;
         case TYPE_THTABLE:
-          flow = thtable_match(pkt, table->flow_list->thtable);
+          flow = lagopus_find_flow(pkt, table);
           break;
         case TYPE_FLOWCACHE:
           cache_entry = cache_lookup(pkt->cache, pkt);
           if (unlikely(cache_entry == NULL)) {
+            generation = table->generation;
             flow = lagopus_find_flow(pkt, table);
             if (flow != NULL && pkt->cache != NULL) {
-              register_cache(pkt->cache, pkt->hash64, 1, &flow);
+              register_cache(pkt->cache, pkt->hash64, 1, &flow, &generation);
             }
           }
           break;
@@ -577,6 +578,12 @@ flow_benchmark(int type,
       }
     }
   }
+  if (type == TYPE_THTABLE) {
+    flowdb = pkts[0]->in_port->bridge->flowdb;
+    TEST_ASSERT_EQUAL(flowdb_table_classifier_set(flowdb, pkts[0]->table_id,
+                                                  TABLE_CLASSIFIER_FLOWINFO),
+                      LAGOPUS_RESULT_OK);
+  }
   TEST_ASSERT_NOT_EQUAL(lookup_count, 0);
   /*TEST_ASSERT_EQUAL(lookup_count, match_count);*/
   if (match_count == 0) {
@@ -0,0 +1,159 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file	benchmark_util.c
+ * @brief	Helpers shared by dataplane benchmarks.
+ */
+
+#include <inttypes.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <sys/time.h>
+#include <sys/queue.h>
+
+#include "unity.h"
+#include "lagopus/datastore/bridge.h"
+#include "lagopus/dp_apis.h"
+#include "lagopus/dataplane.h"
+#include "lagopus/flowdb.h"
+#include "lagopus/flowinfo.h"
+#include "lagopus/bridge.h"
+#include "lagopus/port.h"
+#include "pktbuf.h"
+#include "packet.h"
+
+#include "benchmark_util.h"
+
+volatile bool benchmark_loop;
+
+uint64_t
+benchmark_now_nsec(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void
+sigalrm_handler(int sig) {
+  (void) sig;
+
+  benchmark_loop = false;
+}
+
+void
+benchmark_timer_set(time_t sec) {
+  struct itimerval newit, oldit;
+
+  signal(SIGALRM, sigalrm_handler);
+  newit.it_interval.tv_sec = 0;
+  newit.it_interval.tv_usec = 0;
+  newit.it_value.tv_sec = sec;
+  newit.it_value.tv_usec = 0;
+  setitimer(ITIMER_REAL, &newit, &oldit);
+}
+
+void
+benchmark_print_rate(const char *name, uint64_t count, time_t sec) {
+  double rate;
+
+  rate = (double)count / (double)sec;
+  if (rate / 1000000.0 >= 0.1) {
+    printf("*** %s: %3.2fM/sec\n", name, rate / 1000000.0);
+  } else if (rate / 1000.0 >= 0.1) {
+    printf("*** %s: %3.2fK/sec\n", name, rate / 1000.0);
+  } else {
+    printf("*** %s: %3.2f/sec\n", name, rate);
+  }
+}
+
+void
+benchmark_print_latency(const char *name, uint64_t nsec, uint64_t count) {
+  printf("*** %-20s: %10.1f nsec/op, %8.3f msec total\n",
+         name, (double)nsec / (double)count, (double)nsec / 1000000.0);
+}
+
+void
+benchmark_setup(void) {
+  printf("\n");
+  TEST_ASSERT_EQUAL(dp_api_init(), LAGOPUS_RESULT_OK);
+  flowinfo_init();
+}
+
+void
+benchmark_teardown(void) {
+  dp_api_fini();
+}
+
+struct bridge *
+benchmark_bridge_create(const char *name, uint64_t dpid,
+                        int port_start, int nports) {
+  datastore_bridge_info_t info;
+  struct bridge *bridge;
+  char *str;
+  int i;
+
+  memset(&info, 0, sizeof(info));
+  info.dpid = dpid;
+  info.fail_mode = DATASTORE_BRIDGE_FAIL_MODE_SECURE;
+  TEST_ASSERT_EQUAL(dp_bridge_create(name, &info), LAGOPUS_RESULT_OK);
+  for (i = 0; i < nports; i++) {
+    asprintf(&str, "port%d", port_start + i);
+    TEST_ASSERT_NOT_NULL(str);
+    TEST_ASSERT_EQUAL(dp_port_create(str), LAGOPUS_RESULT_OK);
+    TEST_ASSERT_EQUAL(dp_bridge_port_set(name, str, (uint32_t)i + 1),
+                      LAGOPUS_RESULT_OK);
+    free(str);
+  }
+  bridge = dp_bridge_lookup(name);
+  TEST_ASSERT_NOT_NULL(bridge);
+  return bridge;
+}
+
+void
+benchmark_bridge_destroy(const char *name, int port_start, int nports) {
+  char *str;
+  int i;
+
+  for (i = 0; i < nports; i++) {
+    asprintf(&str, "port%d", port_start + i);
+    TEST_ASSERT_NOT_NULL(str);
+    TEST_ASSERT_EQUAL(dp_bridge_port_unset(name, str), LAGOPUS_RESULT_OK);
+    TEST_ASSERT_EQUAL(dp_port_destroy(str), LAGOPUS_RESULT_OK);
+    free(str);
+  }
+  TEST_ASSERT_EQUAL(dp_bridge_destroy(name), LAGOPUS_RESULT_OK);
+}
+
+struct lagopus_packet *
+benchmark_tcp_packet_alloc(struct port *port) {
+  struct lagopus_packet *pkt;
+
+  pkt = alloc_lagopus_packet();
+  TEST_ASSERT_NOT_NULL(pkt);
+  OS_M_APPEND(PKT2MBUF(pkt), 64);
+  OS_MTOD(PKT2MBUF(pkt), uint8_t *)[12] = 0x08;
+  OS_MTOD(PKT2MBUF(pkt), uint8_t *)[13] = 0x00;
+  OS_MTOD(PKT2MBUF(pkt), uint8_t *)[14] = 0x45;
+  OS_MTOD(PKT2MBUF(pkt), uint8_t *)[23] = IPPROTO_TCP;
+  lagopus_packet_init(pkt, PKT2MBUF(pkt), port);
+  return pkt;
+}
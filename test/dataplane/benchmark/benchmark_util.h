@@ -0,0 +1,99 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file	benchmark_util.h
+ * @brief	Helpers shared by dataplane benchmarks.
+ */
+
+#ifndef __BENCHMARK_UTIL_H__
+#define __BENCHMARK_UTIL_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+struct bridge;
+struct port;
+struct lagopus_packet;
+
+/* cleared by SIGALRM after benchmark_timer_set() expires. */
+extern volatile bool benchmark_loop;
+
+/**
+ * Monotonic clock in nanoseconds.
+ */
+uint64_t
+benchmark_now_nsec(void);
+
+/**
+ * Clear benchmark_loop after sec seconds.
+ */
+void
+benchmark_timer_set(time_t sec);
+
+/**
+ * Print count per second in M, K or as is.
+ */
+void
+benchmark_print_rate(const char *name, uint64_t count, time_t sec);
+
+/**
+ * Print nanoseconds per operation and total milliseconds.
+ */
+void
+benchmark_print_latency(const char *name, uint64_t nsec, uint64_t count);
+
+/**
+ * Initialize dataplane APIs and the default classifier for setUp().
+ */
+void
+benchmark_setup(void);
+
+/**
+ * Finalize dataplane APIs for tearDown().
+ */
+void
+benchmark_teardown(void);
+
+/**
+ * Create bridge and attach ports "port<port_start>" ... as
+ * OpenFlow port 1 ... nports.
+ *
+ *	@param[in]	name		Bridge name.
+ *	@param[in]	dpid		Datapath id.
+ *	@param[in]	port_start	Index of the first port name.
+ *	@param[in]	nports		Number of ports, may be 0.
+ *
+ *	@retval		Created bridge.
+ */
+struct bridge *
+benchmark_bridge_create(const char *name, uint64_t dpid,
+                        int port_start, int nports);
+
+/**
+ * Detach and destroy ports, then destroy the bridge.
+ */
+void
+benchmark_bridge_destroy(const char *name, int port_start, int nports);
+
+/**
+ * Allocate 64 bytes IPv4/TCP packet received on port.
+ */
+struct lagopus_packet *
+benchmark_tcp_packet_alloc(struct port *port);
+
+#endif /* __BENCHMARK_UTIL_H__ */
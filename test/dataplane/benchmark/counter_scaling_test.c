@@ -0,0 +1,202 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Update throughput of flow and table counters of a flow hit by
+ * 1..N forwarding threads, sharded counters against counters shared
+ * by all threads.
+ */
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/queue.h>
+
+#include "unity.h"
+#include "lagopus/datastore/bridge.h"
+#include "lagopus/dp_apis.h"
+#include "lagopus/dataplane.h"
+#include "lagopus/flowdb.h"
+#include "lagopus/bridge.h"
+#include "counter.h"
+
+#include "datapath_test_misc.h"
+#include "benchmark_util.h"
+
+#define NUMBER_OF_WORKERS 8
+#define PACKET_LEN 64
+#define STATS_ROUNDS 100000
+
+static struct bridge *bridge;
+static struct flow *flow;
+static struct table *table;
+
+/* counters of all threads in one cache line, as updated before. */
+static struct {
+  volatile uint64_t packet_count;
+  volatile uint64_t byte_count;
+  volatile uint64_t lookup_count;
+  volatile uint64_t matched_count;
+} shared __attribute__((aligned(64)));
+
+struct worker_arg {
+  pthread_t tid;
+  bool sharded;
+  uint64_t count;
+} __attribute__((aligned(64)));
+
+void
+setUp(void) {
+  struct ofp_flow_mod flow_mod;
+  struct match_list match_list;
+  struct instruction_list instruction_list;
+  struct ofp_error error;
+
+  benchmark_setup();
+  bridge = benchmark_bridge_create("br0", 0, 0, 0);
+
+  /* the flow hit by all workers. */
+  TAILQ_INIT(&match_list);
+  TAILQ_INIT(&instruction_list);
+  add_match(&match_list, 4, OFPXMT_OFB_IN_PORT << 1, 0, 0, 0, 1);
+  memset(&flow_mod, 0, sizeof(flow_mod));
+  flow_mod.command = OFPFC_ADD;
+  flow_mod.table_id = 0;
+  flow_mod.priority = 1;
+  flow_mod.out_port = OFPP_ANY;
+  flow_mod.out_group = OFPG_ANY;
+  TEST_ASSERT_EQUAL(flowdb_flow_add(bridge, &flow_mod, &match_list,
+                                    &instruction_list, &error),
+                    LAGOPUS_RESULT_OK);
+  table = table_lookup(bridge->flowdb, 0);
+  TEST_ASSERT_NOT_NULL(table);
+  TEST_ASSERT_EQUAL(table->flow_list->nflow, 1);
+  flow = table->flow_list->flows[0];
+}
+
+void
+tearDown(void) {
+  benchmark_bridge_destroy("br0", 0, 0);
+  bridge = NULL;
+  benchmark_teardown();
+}
+
+static void *
+worker_loop(void *arg) {
+  struct worker_arg *warg;
+  uint64_t count;
+
+  warg = arg;
+  count = 0;
+  /* same updates as a packet hitting the flow cache. */
+  if (warg->sharded == true) {
+    while (benchmark_loop == true) {
+      dp_counter_add(flow->counter_id, 1, PACKET_LEN);
+      dp_counter_add(table->lookup_counter_id, 1, 0);
+      dp_counter_add(table->matched_counter_id, 1, 0);
+      count++;
+    }
+  } else {
+    while (benchmark_loop == true) {
+      __sync_fetch_and_add(&shared.packet_count, 1);
+      __sync_fetch_and_add(&shared.byte_count, PACKET_LEN);
+      __sync_fetch_and_add(&shared.lookup_count, 1);
+      __sync_fetch_and_add(&shared.matched_count, 1);
+      count++;
+    }
+  }
+  warg->count = count;
+  return NULL;
+}
+
+static uint64_t
+counter_benchmark(int nworkers, bool sharded, time_t sec) {
+  struct worker_arg wargs[NUMBER_OF_WORKERS];
+  uint64_t count, packets, bytes, lookup, matched;
+  uint64_t packets0, bytes0, lookup0, matched0;
+  int i;
+
+  flow_counter_get(flow, &packets0, &bytes0);
+  table_counter_get(table, &lookup0, &matched0);
+  memset((void *)&shared, 0, sizeof(shared));
+
+  benchmark_loop = true;
+  for (i = 0; i < nworkers; i++) {
+    wargs[i].sharded = sharded;
+    wargs[i].count = 0;
+    TEST_ASSERT_EQUAL(pthread_create(&wargs[i].tid, NULL,
+                                     worker_loop, &wargs[i]), 0);
+  }
+  benchmark_timer_set(sec);
+  count = 0;
+  for (i = 0; i < nworkers; i++) {
+    pthread_join(wargs[i].tid, NULL);
+    count += wargs[i].count;
+  }
+
+  if (sharded == true) {
+    flow_counter_get(flow, &packets, &bytes);
+    table_counter_get(table, &lookup, &matched);
+    packets -= packets0;
+    bytes -= bytes0;
+    lookup -= lookup0;
+    matched -= matched0;
+  } else {
+    packets = shared.packet_count;
+    bytes = shared.byte_count;
+    lookup = shared.lookup_count;
+    matched = shared.matched_count;
+  }
+  TEST_ASSERT_EQUAL(packets, count);
+  TEST_ASSERT_EQUAL(bytes, count * PACKET_LEN);
+  TEST_ASSERT_EQUAL(lookup, count);
+  TEST_ASSERT_EQUAL(matched, count);
+  return count;
+}
+
+void
+test_counter_scaling_benchmark(void) {
+  uint64_t count;
+  int nworkers;
+
+  printf("******** counter updates, 1..%d workers ************\n",
+         NUMBER_OF_WORKERS);
+  for (nworkers = 1; nworkers <= NUMBER_OF_WORKERS; nworkers *= 2) {
+    printf("*** %d workers\n", nworkers);
+    count = counter_benchmark(nworkers, false, 1);
+    benchmark_print_rate("shared", count, 1);
+    count = counter_benchmark(nworkers, true, 1);
+    benchmark_print_rate("sharded", count, 1);
+  }
+}
+
+void
+test_counter_aggregation_benchmark(void) {
+  uint64_t start, packets, bytes;
+  int i;
+
+  /* shards of all workers are summed on every request. */
+  (void)counter_benchmark(NUMBER_OF_WORKERS, true, 1);
+  printf("******** counter aggregation, %d shards ************\n",
+         NUMBER_OF_WORKERS);
+  start = benchmark_now_nsec();
+  for (i = 0; i < STATS_ROUNDS; i++) {
+    flow_counter_get(flow, &packets, &bytes);
+  }
+  printf("*** flow_counter_get: %6.1f nsec/op\n",
+         (double)(benchmark_now_nsec() - start) / (double)STATS_ROUNDS);
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Exact match classifier against tuple space search (thtable) and the
+ * default flowinfo tree with fully specified TCP 5-tuple flows.
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/queue.h>
+
+#include "unity.h"
+#include "lagopus/dp_apis.h"
+#include "lagopus/dataplane.h"
+#include "lagopus/flowdb.h"
+#include "lagopus/flowinfo.h"
+#include "lagopus/port.h"
+#include "pktbuf.h"
+#include "packet.h"
+
+#include "datapath_test_misc.h"
+#include "benchmark_util.h"
+
+static struct flow **test_flows;
+static struct flow **results;
+static struct lagopus_packet *pkt;
+static struct port port;
+
+void
+setUp(void) {
+  benchmark_setup();
+
+  pkt = benchmark_tcp_packet_alloc(&port);
+}
+
+void
+tearDown(void) {
+  lagopus_packet_free(pkt);
+  benchmark_teardown();
+}
+
+/*
+ * connection i: addresses and ports are derived from i.
+ */
+static struct flow *
+tuple_flow_alloc(int i) {
+  struct flow *flow;
+  uint32_t src, dst;
+  uint16_t sport, dport;
+
+  src = 0x0a000000 + ((uint32_t)i >> 8);
+  dst = 0xc0a80000 + ((uint32_t)i & 0xff);
+  sport = (uint16_t)(1024 + (i & 0x3fff));
+  dport = (uint16_t)(80 + (i >> 14));
+  flow = allocate_test_flow(10 * sizeof(struct match));
+  TEST_ASSERT_NOT_NULL(flow);
+  flow->priority = 100;
+  add_match(&flow->match_list, 2, OFPXMT_OFB_ETH_TYPE << 1, 0x08, 0x00);
+  add_match(&flow->match_list, 1, OFPXMT_OFB_IP_PROTO << 1, IPPROTO_TCP);
+  add_match(&flow->match_list, 4, OFPXMT_OFB_IPV4_SRC << 1,
+            src >> 24, (src >> 16) & 0xff, (src >> 8) & 0xff, src & 0xff);
+  add_match(&flow->match_list, 4, OFPXMT_OFB_IPV4_DST << 1,
+            dst >> 24, (dst >> 16) & 0xff, (dst >> 8) & 0xff, dst & 0xff);
+  add_match(&flow->match_list, 2, OFPXMT_OFB_TCP_SRC << 1,
+            sport >> 8, sport & 0xff);
+  add_match(&flow->match_list, 2, OFPXMT_OFB_TCP_DST << 1,
+            dport >> 8, dport & 0xff);
+  refresh_match(flow);
+  return flow;
+}
+
+static void
+set_packet(int i) {
+  uint8_t *p;
+  uint32_t src, dst;
+  uint16_t sport, dport;
+
+  src = 0x0a000000 + ((uint32_t)i >> 8);
+  dst = 0xc0a80000 + ((uint32_t)i & 0xff);
+  sport = (uint16_t)(1024 + (i & 0x3fff));
+  dport = (uint16_t)(80 + (i >> 14));
+  p = OS_MTOD(PKT2MBUF(pkt), uint8_t *);
+  p[26] = (uint8_t)(src >> 24);
+  p[27] = (uint8_t)(src >> 16);
+  p[28] = (uint8_t)(src >> 8);
+  p[29] = (uint8_t)src;
+  p[30] = (uint8_t)(dst >> 24);
+  p[31] = (uint8_t)(dst >> 16);
+  p[32] = (uint8_t)(dst >> 8);
+  p[33] = (uint8_t)dst;
+  p[34] = (uint8_t)(sport >> 8);
+  p[35] = (uint8_t)sport;
+  p[36] = (uint8_t)(dport >> 8);
+  p[37] = (uint8_t)dport;
+}
+
+/*
+ * Add, lookup packets of every connection, and delete.  Lookup
+ * results of the first classifier are kept to compare classifiers.
+ */
+static void
+classifier_benchmark(const char *name, struct flowinfo *flowinfo,
+                     int nflow, bool compare) {
+  struct flow *flow;
+  uint64_t start, nmiss;
+  int32_t prio;
+  int i;
+
+  printf("**** %s\n", name);
+  TEST_ASSERT_NOT_NULL(flowinfo);
+  start = benchmark_now_nsec();
+  for (i = 0; i < nflow; i++) {
+    TEST_ASSERT_EQUAL(flowinfo->add_func(flowinfo, test_flows[i]),
+                      LAGOPUS_RESULT_OK);
+  }
+  benchmark_print_latency("add", benchmark_now_nsec() - start, (uint64_t)nflow);
+
+  nmiss = 0;
+  start = benchmark_now_nsec();
+  for (i = 0; i < nflow; i++) {
+    set_packet(i);
+    prio = -1;
+    flow = flowinfo->match_func(flowinfo, pkt, &prio);
+    if (compare == true) {
+      if (flow != results[i]) {
+        nmiss++;
+      }
+    } else {
+      results[i] = flow;
+    }
+  }
+  benchmark_print_latency("lookup", benchmark_now_nsec() - start,
+                          (uint64_t)nflow);
+  TEST_ASSERT_EQUAL(nmiss, 0);
+
+  start = benchmark_now_nsec();
+  for (i = 0; i < nflow; i++) {
+    TEST_ASSERT_EQUAL(flowinfo->del_func(flowinfo, test_flows[i]),
+                      LAGOPUS_RESULT_OK);
+  }
+  benchmark_print_latency("del", benchmark_now_nsec() - start, (uint64_t)nflow);
+  TEST_ASSERT_EQUAL(flowinfo->nflow, 0);
+  flowinfo->destroy_func(flowinfo);
+}
+
+static void
+exact_benchmark(int nflow, bool with_flowinfo) {
+  int i;
+
+  printf("******** 5-tuple %d flows ********\n", nflow);
+  test_flows = calloc((size_t)nflow, sizeof(struct flow *));
+  results = calloc((size_t)nflow, sizeof(struct flow *));
+  TEST_ASSERT_NOT_NULL(test_flows);
+  TEST_ASSERT_NOT_NULL(results);
+  for (i = 0; i < nflow; i++) {
+    test_flows[i] = tuple_flow_alloc(i);
+  }
+
+  if (with_flowinfo == true) {
+    classifier_benchmark("flowinfo", new_flowinfo_vlan_vid(), nflow, false);
+  }
+  classifier_benchmark("thtable", new_flowinfo_thtable(), nflow,
+                       with_flowinfo);
+  classifier_benchmark("exact", new_flowinfo_exact(new_flowinfo_vlan_vid()),
+                       nflow, true);
+
+  for (i = 0; i < nflow; i++) {
+    free_test_flow(test_flows[i]);
+  }
+  free(test_flows);
+  free(results);
+}
+
+void
+test_exact_10k_benchmark(void) {
+  exact_benchmark(10000, true);
+}
+
+void
+test_exact_100k_benchmark(void) {
+  exact_benchmark(100000, true);
+}
+
+void
+test_exact_1m_benchmark(void) {
+  exact_benchmark(1000000, false);
+}
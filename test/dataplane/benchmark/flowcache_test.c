@@ -0,0 +1,184 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Insert, hit and miss latency of flow cache kinds.
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/queue.h>
+
+#include "unity.h"
+#include "lagopus/datastore/bridge.h"
+#include "lagopus/dp_apis.h"
+#include "lagopus/dataplane.h"
+#include "lagopus/flowdb.h"
+#include "lagopus/bridge.h"
+#include "lagopus/port.h"
+#include "lagopus/ofcache.h"
+#include "pktbuf.h"
+#include "packet.h"
+
+#ifdef HAVE_DPDK
+#include <rte_version.h>
+#endif /* HAVE_DPDK */
+
+#include "datapath_test_misc.h"
+#include "benchmark_util.h"
+
+/* number of cached packet hashes, fits in all kinds. */
+#define CACHE_ENTRIES 16384
+#define LOOKUP_ROUNDS 64
+
+#define HASH_OF(i) ((uint64_t)(i) * 0x9e3779b97f4a7c15ULL)
+
+static struct bridge *bridge;
+static struct lagopus_packet *pkt;
+
+void
+setUp(void) {
+  struct ofp_flow_mod flow_mod;
+  struct match_list match_list;
+  struct instruction_list instruction_list;
+  struct ofp_error error;
+  struct port *port;
+
+  benchmark_setup();
+  bridge = benchmark_bridge_create("br0", 0, 0, 1);
+  port = port_lookup(&bridge->ports, 1);
+  TEST_ASSERT_NOT_NULL(port);
+
+  /* the flow referred by all cache entries. */
+  TAILQ_INIT(&match_list);
+  TAILQ_INIT(&instruction_list);
+  add_match(&match_list, 4, OFPXMT_OFB_IN_PORT << 1, 0, 0, 0, 1);
+  memset(&flow_mod, 0, sizeof(flow_mod));
+  flow_mod.command = OFPFC_ADD;
+  flow_mod.table_id = 0;
+  flow_mod.priority = 1;
+  flow_mod.out_port = OFPP_ANY;
+  flow_mod.out_group = OFPG_ANY;
+  TEST_ASSERT_EQUAL(flowdb_flow_add(bridge, &flow_mod, &match_list,
+                                    &instruction_list, &error),
+                    LAGOPUS_RESULT_OK);
+
+  pkt = alloc_lagopus_packet();
+  TEST_ASSERT_NOT_NULL(pkt);
+  OS_M_APPEND(PKT2MBUF(pkt), 64);
+  lagopus_packet_init(pkt, PKT2MBUF(pkt), port);
+}
+
+void
+tearDown(void) {
+  lagopus_packet_free(pkt);
+  benchmark_bridge_destroy("br0", 0, 1);
+  bridge = NULL;
+  benchmark_teardown();
+}
+
+static void
+flowcache_benchmark(int kvs_type, const char *kind) {
+  struct flowcache *cache;
+  struct ofcachestat st;
+  struct table *table;
+  struct flow *flow;
+  uint64_t start, nhit, nmiss;
+  uint32_t generation;
+  int i, round;
+
+  table = table_lookup(bridge->flowdb, 0);
+  TEST_ASSERT_NOT_NULL(table);
+  pkt->table_id = 0;
+  flow = lagopus_find_flow(pkt, table);
+  TEST_ASSERT_NOT_NULL(flow);
+  generation = table->generation;
+
+  cache = init_flowcache(kvs_type);
+  TEST_ASSERT_NOT_NULL(cache);
+  pkt->cache = cache;
+
+  printf("******** flowcache %s, %d entries ********\n",
+         kind, CACHE_ENTRIES);
+  start = benchmark_now_nsec();
+  for (i = 1; i <= CACHE_ENTRIES; i++) {
+    register_cache(cache, HASH_OF(i), 1, &flow, &generation);
+  }
+  benchmark_print_latency("insert", benchmark_now_nsec() - start,
+                          CACHE_ENTRIES);
+
+  nhit = 0;
+  start = benchmark_now_nsec();
+  for (round = 0; round < LOOKUP_ROUNDS; round++) {
+    for (i = 1; i <= CACHE_ENTRIES; i++) {
+      pkt->hash64 = HASH_OF(i);
+      if (cache_lookup(cache, pkt) != NULL) {
+        nhit++;
+      }
+    }
+  }
+  benchmark_print_latency("hit", benchmark_now_nsec() - start,
+                          (uint64_t)LOOKUP_ROUNDS * CACHE_ENTRIES);
+
+  nmiss = 0;
+  start = benchmark_now_nsec();
+  for (round = 0; round < LOOKUP_ROUNDS; round++) {
+    for (i = 1; i <= CACHE_ENTRIES; i++) {
+      pkt->hash64 = HASH_OF(i + CACHE_ENTRIES);
+      if (cache_lookup(cache, pkt) == NULL) {
+        nmiss++;
+      }
+    }
+  }
+  benchmark_print_latency("miss", benchmark_now_nsec() - start,
+                          (uint64_t)LOOKUP_ROUNDS * CACHE_ENTRIES);
+
+  get_flowcache_statistics(cache, &st);
+  printf("*** flowcache stats: entry:%" PRIu64 ", hit:%" PRIu64
+         ", miss:%" PRIu64 "\n", st.nentries, st.hit, st.miss);
+  fini_flowcache(cache);
+  pkt->cache = NULL;
+
+  TEST_ASSERT_EQUAL(nhit, (uint64_t)LOOKUP_ROUNDS * CACHE_ENTRIES);
+  TEST_ASSERT_EQUAL(nmiss, (uint64_t)LOOKUP_ROUNDS * CACHE_ENTRIES);
+}
+
+void
+test_flowcache_hashmap_nolock_benchmark(void) {
+  flowcache_benchmark(FLOWCACHE_HASHMAP_NOLOCK, "hashmap_nolock");
+}
+
+void
+test_flowcache_hashmap_benchmark(void) {
+  flowcache_benchmark(FLOWCACHE_HASHMAP, "hashmap");
+}
+
+void
+test_flowcache_cuckoo_benchmark(void) {
+  flowcache_benchmark(FLOWCACHE_CUCKOO, "cuckoo");
+}
+
+void
+test_flowcache_rte_hash_benchmark(void) {
+#ifdef HAVE_DPDK
+#if RTE_VERSION >= RTE_VERSION_NUM(2, 1, 0, 0)
+  flowcache_benchmark(FLOWCACHE_RTE_HASH, "rte_hash");
+  return;
+#endif /* RTE_VERSION */
+#endif /* HAVE_DPDK */
+  TEST_IGNORE_MESSAGE("rte_hash is not available.");
+}
@@ -0,0 +1,192 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Lookup throughput of forwarding threads while flow_mods are
+ * applied to the same table continuously.
+ */
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <sys/queue.h>
+
+#include "unity.h"
+#include "lagopus/datastore/bridge.h"
+#include "lagopus/dp_apis.h"
+#include "lagopus/dataplane.h"
+#include "lagopus/flowdb.h"
+#include "lagopus/bridge.h"
+#include "lagopus/port.h"
+#include "pktbuf.h"
+#include "packet.h"
+#include "epoch.h"
+
+#include "datapath_test_misc.h"
+#include "benchmark_util.h"
+
+#define NUMBER_OF_PORTS 8
+#define PORT_START 0
+
+#define NUMBER_OF_READERS 2
+
+/* in_port of churning flows, packets never match them. */
+#define CHURN_PORT_START 1000
+#define CHURN_PORT_COUNT 256
+
+static struct bridge *bridge;
+
+struct reader_arg {
+  pthread_t tid;
+  struct lagopus_packet *pkt;
+  uint64_t lookup_count;
+  uint64_t miss_count;
+};
+
+void
+setUp(void) {
+  benchmark_setup();
+  bridge = benchmark_bridge_create("br0", 0, PORT_START, NUMBER_OF_PORTS);
+}
+
+void
+tearDown(void) {
+  benchmark_bridge_destroy("br0", PORT_START, NUMBER_OF_PORTS);
+  bridge = NULL;
+  benchmark_teardown();
+}
+
+static lagopus_result_t
+in_port_flow_mod(uint16_t command, uint32_t in_port) {
+  struct ofp_flow_mod flow_mod;
+  struct match_list match_list;
+  struct instruction_list instruction_list;
+  struct ofp_error error;
+
+  TAILQ_INIT(&match_list);
+  TAILQ_INIT(&instruction_list);
+  add_match(&match_list, 4, OFPXMT_OFB_IN_PORT << 1,
+            (in_port >> 24) & 0xff, (in_port >> 16) & 0xff,
+            (in_port >> 8) & 0xff, in_port & 0xff);
+  memset(&flow_mod, 0, sizeof(flow_mod));
+  flow_mod.command = (uint8_t)command;
+  flow_mod.table_id = 0;
+  flow_mod.priority = 1;
+  flow_mod.out_port = OFPP_ANY;
+  flow_mod.out_group = OFPG_ANY;
+
+  if (command == OFPFC_ADD) {
+    return flowdb_flow_add(bridge, &flow_mod, &match_list,
+                           &instruction_list, &error);
+  }
+  return flowdb_flow_delete(bridge, &flow_mod, &match_list, &error);
+}
+
+static void *
+reader_loop(void *arg) {
+  struct reader_arg *rarg;
+  struct lagopus_packet *pkt;
+  struct table *table;
+  struct flow *flow;
+
+  rarg = arg;
+  pkt = rarg->pkt;
+  while (benchmark_loop == true) {
+    /* same as one packet burst of forwarding thread. */
+    dp_epoch_enter();
+    table = table_lookup(pkt->bridge->flowdb, pkt->table_id);
+    flow = lagopus_find_flow(pkt, table);
+    if (flow == NULL) {
+      rarg->miss_count++;
+    }
+    dp_epoch_exit();
+    rarg->lookup_count++;
+  }
+  return NULL;
+}
+
+static void
+flowmod_churn_benchmark(int nreaders, time_t sec) {
+  struct reader_arg rargs[NUMBER_OF_READERS];
+  struct port *port;
+  uint64_t lookup_count, miss_count, flowmod_count;
+  uint32_t in_port;
+  int i;
+
+  /* the flow always matched by readers. */
+  TEST_ASSERT_EQUAL(in_port_flow_mod(OFPFC_ADD, 1), LAGOPUS_RESULT_OK);
+  port = port_lookup(&bridge->ports, 1);
+  TEST_ASSERT_NOT_NULL(port);
+
+  benchmark_loop = true;
+  for (i = 0; i < nreaders; i++) {
+    rargs[i].pkt = alloc_lagopus_packet();
+    TEST_ASSERT_NOT_NULL(rargs[i].pkt);
+    rargs[i].pkt->table_id = 0;
+    rargs[i].pkt->cache = NULL;
+    OS_M_APPEND(PKT2MBUF(rargs[i].pkt), 64);
+    lagopus_packet_init(rargs[i].pkt, PKT2MBUF(rargs[i].pkt), port);
+    rargs[i].lookup_count = 0;
+    rargs[i].miss_count = 0;
+    TEST_ASSERT_EQUAL(pthread_create(&rargs[i].tid, NULL,
+                                     reader_loop, &rargs[i]), 0);
+  }
+
+  benchmark_timer_set(sec);
+  flowmod_count = 0;
+  in_port = 0;
+  while (benchmark_loop == true) {
+    TEST_ASSERT_EQUAL(in_port_flow_mod(OFPFC_ADD,
+                                       CHURN_PORT_START + in_port),
+                      LAGOPUS_RESULT_OK);
+    TEST_ASSERT_EQUAL(in_port_flow_mod(OFPFC_DELETE_STRICT,
+                                       CHURN_PORT_START + in_port),
+                      LAGOPUS_RESULT_OK);
+    flowmod_count += 2;
+    in_port = (in_port + 1) % CHURN_PORT_COUNT;
+  }
+
+  lookup_count = 0;
+  miss_count = 0;
+  for (i = 0; i < nreaders; i++) {
+    pthread_join(rargs[i].tid, NULL);
+    lookup_count += rargs[i].lookup_count;
+    miss_count += rargs[i].miss_count;
+    lagopus_packet_free(rargs[i].pkt);
+  }
+  TEST_ASSERT_EQUAL(in_port_flow_mod(OFPFC_DELETE_STRICT, 1),
+                    LAGOPUS_RESULT_OK);
+
+  printf("*** %d readers\n", nreaders);
+  benchmark_print_rate("lookup", lookup_count, sec);
+  benchmark_print_rate("flow_mod", flowmod_count, sec);
+  TEST_ASSERT_NOT_EQUAL(lookup_count, 0);
+  /* the matched flow is never touched by churn. */
+  TEST_ASSERT_EQUAL(miss_count, 0);
+}
+
+void
+test_flowmod_churn_1_reader_benchmark(void) {
+  printf("******** flow_mod churn, 1 reader ******************\n");
+  flowmod_churn_benchmark(1, 3);
+}
+
+void
+test_flowmod_churn_n_readers_benchmark(void) {
+  printf("******** flow_mod churn, %d readers ****************\n",
+         NUMBER_OF_READERS);
+  flowmod_churn_benchmark(NUMBER_OF_READERS, 3);
+}
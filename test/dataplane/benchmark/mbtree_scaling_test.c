@@ -0,0 +1,193 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Decision tree (mbtree) build, incremental update and lookup time
+ * against number of flows in the table.
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/queue.h>
+
+#include "unity.h"
+#include "lagopus/dp_apis.h"
+#include "lagopus/dataplane.h"
+#include "lagopus/flowdb.h"
+#include "lagopus/port.h"
+#include "pktbuf.h"
+#include "packet.h"
+#include "mbtree.h"
+
+#include "datapath_test_misc.h"
+#include "benchmark_util.h"
+
+#define NCHURN 1000
+
+static struct flow_list *flows;
+static struct flow **test_flows;
+static struct lagopus_packet *pkt;
+static struct port port;
+
+void
+setUp(void) {
+  benchmark_setup();
+  flows = calloc(1, sizeof(struct flow_list) + sizeof(void *) * 65536);
+  TEST_ASSERT_NOT_NULL(flows);
+  flows->nbranch = 65536;
+
+  pkt = benchmark_tcp_packet_alloc(&port);
+}
+
+void
+tearDown(void) {
+  cleanup_mbtree(flows);
+  free(flows->flows);
+  free(flows);
+  lagopus_packet_free(pkt);
+  benchmark_teardown();
+}
+
+/*
+ * IPv4/TCP flow to 10.0.0.0 + i, one of eight flows also matches
+ * masked source address which can not be a branch.
+ */
+static struct flow *
+ipv4_flow_alloc(int i) {
+  struct flow *flow;
+
+  flow = allocate_test_flow(10 * sizeof(struct match));
+  TEST_ASSERT_NOT_NULL(flow);
+  flow->priority = (uint16_t)(i % 16);
+  add_match(&flow->match_list, 2, OFPXMT_OFB_ETH_TYPE << 1, 0x08, 0x00);
+  add_match(&flow->match_list, 1, OFPXMT_OFB_IP_PROTO << 1, IPPROTO_TCP);
+  add_match(&flow->match_list, 4, OFPXMT_OFB_IPV4_DST << 1,
+            10, (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+  if (i % 8 == 0) {
+    add_match(&flow->match_list, 8, (OFPXMT_OFB_IPV4_SRC << 1) + 1,
+              0, 0, 0, 0, 0, 0, 0, 0);
+  }
+  return flow;
+}
+
+static void
+set_ipv4_dst(int i) {
+  uint8_t *p;
+
+  p = OS_MTOD(PKT2MBUF(pkt), uint8_t *);
+  p[30] = 10;
+  p[31] = (uint8_t)(i >> 16);
+  p[32] = (uint8_t)(i >> 8);
+  p[33] = (uint8_t)i;
+}
+
+static void
+lookup_benchmark(const char *name, int nflow) {
+  uint64_t start, nhit;
+  int i;
+
+  nhit = 0;
+  start = benchmark_now_nsec();
+  for (i = 0; i < nflow; i++) {
+    set_ipv4_dst(i);
+    if (find_mbtree(pkt, flows) == test_flows[i]) {
+      nhit++;
+    }
+  }
+  benchmark_print_latency(name, benchmark_now_nsec() - start, (uint64_t)nflow);
+  TEST_ASSERT_EQUAL(nhit, (uint64_t)nflow);
+}
+
+static void
+rebuild(void) {
+  struct flow_list *garbage;
+
+  garbage = NULL;
+  rebuild_mbtree(flows, &garbage);
+  free_mbtree(garbage);
+}
+
+static void
+mbtree_benchmark(int nflow) {
+  uint64_t start;
+  int i;
+
+  printf("******** mbtree %d flows ********\n", nflow);
+  test_flows = calloc((size_t)nflow, sizeof(struct flow *));
+  TEST_ASSERT_NOT_NULL(test_flows);
+  for (i = 0; i < nflow; i++) {
+    test_flows[i] = ipv4_flow_alloc(i);
+    TEST_ASSERT_EQUAL(flow_add_sub(test_flows[i], flows), LAGOPUS_RESULT_OK);
+  }
+
+  /* whole tree built at once, as done on every change before. */
+  start = benchmark_now_nsec();
+  build_mbtree(flows);
+  benchmark_print_latency("full build", benchmark_now_nsec() - start, 1);
+  lookup_benchmark("lookup", nflow);
+  cleanup_mbtree(flows);
+
+  /*
+   * incremental insert, unbalanced subtrees are rebuilt at once
+   * instead of by the timer.
+   */
+  start = benchmark_now_nsec();
+  for (i = 0; i < nflow; i++) {
+    if (add_mbtree(flows, test_flows[i]) == true) {
+      rebuild();
+    }
+  }
+  benchmark_print_latency("incremental add", benchmark_now_nsec() - start,
+                          (uint64_t)nflow);
+  lookup_benchmark("lookup (incremental)", nflow);
+
+  /* flow_mod churn on the built tree. */
+  start = benchmark_now_nsec();
+  for (i = 0; i < NCHURN; i++) {
+    (void)del_mbtree(flows, test_flows[i % nflow]);
+    (void)add_mbtree(flows, test_flows[i % nflow]);
+  }
+  benchmark_print_latency("churn del+add", benchmark_now_nsec() - start,
+                          NCHURN);
+  start = benchmark_now_nsec();
+  rebuild();
+  benchmark_print_latency("rebuild after churn", benchmark_now_nsec() - start,
+                          1);
+  lookup_benchmark("lookup (churned)", nflow);
+
+  cleanup_mbtree(flows);
+  for (i = 0; i < nflow; i++) {
+    free_test_flow(test_flows[i]);
+  }
+  free(test_flows);
+  flows->nflow = 0;
+}
+
+void
+test_mbtree_1k_benchmark(void) {
+  mbtree_benchmark(1000);
+}
+
+void
+test_mbtree_10k_benchmark(void) {
+  mbtree_benchmark(10000);
+}
+
+void
+test_mbtree_100k_benchmark(void) {
+  mbtree_benchmark(100000);
+}
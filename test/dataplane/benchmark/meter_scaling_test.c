@@ -0,0 +1,184 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Throughput and accuracy of a meter hit by 1..N forwarding threads,
+ * credit shares per thread against the shared bucket per packet.
+ */
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/queue.h>
+
+#include "unity.h"
+#include "lagopus/dp_apis.h"
+#include "lagopus/dataplane.h"
+#include "lagopus/meter.h"
+#include "pktbuf.h"
+#include "packet.h"
+#include "meter_bucket.h"
+
+#include "benchmark_util.h"
+
+#define NUMBER_OF_WORKERS 8
+#define PACKET_LEN 64
+/* 1Gbps, burst 1Mbit. */
+#define METER_KBPS 1000000
+#define METER_BURST_KB 1000
+
+static struct meter_table *meter_table;
+static struct meter *meter;
+
+struct worker_arg {
+  pthread_t tid;
+  uint64_t count;
+  uint64_t passed;
+} __attribute__((aligned(64)));
+
+static void
+meter_create(uint64_t quantum_nsec) {
+  struct ofp_meter_mod meter_mod;
+  struct meter_band_list list;
+  struct meter_band *band;
+  struct ofp_error error;
+
+  meter_bucket_quantum_set(quantum_nsec);
+  TAILQ_INIT(&list);
+  band = calloc(1, sizeof(struct meter_band));
+  TEST_ASSERT_NOT_NULL(band);
+  band->type = OFPMBT_DROP;
+  band->rate = METER_KBPS;
+  band->burst_size = METER_BURST_KB;
+  TAILQ_INSERT_TAIL(&list, band, entry);
+  meter_mod.meter_id = 1;
+  meter_mod.flags = OFPMF_KBPS | OFPMF_BURST | OFPMF_STATS;
+  TEST_ASSERT_EQUAL(meter_table_meter_add(meter_table, &meter_mod,
+                                          &list, &error),
+                    LAGOPUS_RESULT_OK);
+  meter = meter_table_lookup(meter_table, 1);
+  TEST_ASSERT_NOT_NULL(meter);
+}
+
+static void
+meter_destroy(void) {
+  struct ofp_meter_mod meter_mod;
+  struct ofp_error error;
+
+  meter_mod.meter_id = 1;
+  TEST_ASSERT_EQUAL(meter_table_meter_delete(meter_table, &meter_mod,
+                                             &error),
+                    LAGOPUS_RESULT_OK);
+  meter = NULL;
+}
+
+void
+setUp(void) {
+  benchmark_setup();
+  lagopus_meter_init();
+  meter_table = meter_table_alloc(NULL);
+  TEST_ASSERT_NOT_NULL(meter_table);
+}
+
+void
+tearDown(void) {
+  meter_table_free(meter_table);
+  meter_table = NULL;
+  meter_bucket_quantum_set(METER_BUCKET_QUANTUM_NSEC);
+  benchmark_teardown();
+}
+
+static void *
+worker_loop(void *arg) {
+  struct worker_arg *warg;
+  struct lagopus_packet *pkt;
+  uint64_t count, passed;
+  uint8_t prec_level;
+
+  warg = arg;
+  pkt = alloc_lagopus_packet();
+  OS_M_APPEND(PKT2MBUF(pkt), PACKET_LEN);
+  count = 0;
+  passed = 0;
+  while (benchmark_loop == true) {
+    if (lagopus_meter_packet(pkt, meter, &prec_level) == 0) {
+      passed++;
+    }
+    count++;
+  }
+  lagopus_packet_free(pkt);
+  warg->count = count;
+  warg->passed = passed;
+  return NULL;
+}
+
+/*
+ * Offer packets from all workers as fast as possible for a second.
+ * Passed bytes are compared with the rate over elapsed time plus
+ * burst, and returned as error in percent.
+ */
+static double
+meter_benchmark(const char *name, int nworkers, uint64_t quantum_nsec) {
+  struct worker_arg wargs[NUMBER_OF_WORKERS];
+  uint64_t start, elapsed, count, passed;
+  double expected, error;
+  int i;
+
+  meter_create(quantum_nsec);
+  benchmark_loop = true;
+  start = benchmark_now_nsec();
+  for (i = 0; i < nworkers; i++) {
+    wargs[i].count = 0;
+    wargs[i].passed = 0;
+    TEST_ASSERT_EQUAL(pthread_create(&wargs[i].tid, NULL,
+                                     worker_loop, &wargs[i]), 0);
+  }
+  benchmark_timer_set(1);
+  count = 0;
+  passed = 0;
+  for (i = 0; i < nworkers; i++) {
+    pthread_join(wargs[i].tid, NULL);
+    count += wargs[i].count;
+    passed += wargs[i].passed;
+  }
+  elapsed = benchmark_now_nsec() - start;
+  meter_destroy();
+
+  expected = (double)METER_KBPS * 1000.0 / 8.0 * (double)elapsed / 1e9 +
+             (double)METER_BURST_KB * 1000.0 / 8.0;
+  error = ((double)(passed * PACKET_LEN) - expected) * 100.0 / expected;
+  printf("*** %-8s: %6.2fMpps offered, %6.2fMpps passed, error %+5.2f%%\n",
+         name, (double)count * 1000.0 / (double)elapsed,
+         (double)passed * 1000.0 / (double)elapsed, error);
+  return error;
+}
+
+void
+test_meter_scaling_benchmark(void) {
+  double error;
+  int nworkers;
+
+  printf("******** 1Gbps meter, 1..%d workers ************\n",
+         NUMBER_OF_WORKERS);
+  for (nworkers = 1; nworkers <= NUMBER_OF_WORKERS; nworkers *= 2) {
+    printf("*** %d workers\n", nworkers);
+    error = meter_benchmark("shared", nworkers, 0);
+    TEST_ASSERT_TRUE(error < 1.0 && error > -5.0);
+    error = meter_benchmark("shares", nworkers, METER_BUCKET_QUANTUM_NSEC);
+    TEST_ASSERT_TRUE(error < 1.0 && error > -5.0);
+  }
+}
@@ -0,0 +1,218 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Isolation of bridges: lookup of forwarding threads reading one
+ * bridge while another bridge is modified in place continuously.
+ */
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/queue.h>
+
+#include "unity.h"
+#include "lagopus/datastore/bridge.h"
+#include "lagopus/dp_apis.h"
+#include "lagopus/dataplane.h"
+#include "lagopus/flowdb.h"
+#include "lagopus/bridge.h"
+#include "lagopus/port.h"
+#include "pktbuf.h"
+#include "packet.h"
+#include "lock.h"
+
+#include "datapath_test_misc.h"
+#include "benchmark_util.h"
+
+#define NUMBER_OF_BRIDGES 2
+#define NUMBER_OF_PORTS 4
+
+/* time the writer holds the flow database in place, in usec. */
+#define WRITER_HOLD_USEC 200
+
+static struct bridge *bridges[NUMBER_OF_BRIDGES];
+
+struct reader_arg {
+  pthread_t tid;
+  struct bridge *bridge;
+  struct lagopus_packet *pkt;
+  uint64_t lookup_count;
+  uint64_t miss_count;
+  uint64_t max_nsec;
+};
+
+void
+setUp(void) {
+  char name[16];
+  int i;
+
+  benchmark_setup();
+  for (i = 0; i < NUMBER_OF_BRIDGES; i++) {
+    snprintf(name, sizeof(name), "br%d", i);
+    bridges[i] = benchmark_bridge_create(name, (uint64_t)i + 1,
+                                         i * NUMBER_OF_PORTS,
+                                         NUMBER_OF_PORTS);
+  }
+}
+
+void
+tearDown(void) {
+  char name[16];
+  int i;
+
+  for (i = 0; i < NUMBER_OF_BRIDGES; i++) {
+    snprintf(name, sizeof(name), "br%d", i);
+    benchmark_bridge_destroy(name, i * NUMBER_OF_PORTS, NUMBER_OF_PORTS);
+    bridges[i] = NULL;
+  }
+  benchmark_teardown();
+}
+
+static lagopus_result_t
+in_port_flow_mod(struct bridge *bridge, uint16_t command, uint32_t in_port) {
+  struct ofp_flow_mod flow_mod;
+  struct match_list match_list;
+  struct instruction_list instruction_list;
+  struct ofp_error error;
+
+  TAILQ_INIT(&match_list);
+  TAILQ_INIT(&instruction_list);
+  add_match(&match_list, 4, OFPXMT_OFB_IN_PORT << 1,
+            (in_port >> 24) & 0xff, (in_port >> 16) & 0xff,
+            (in_port >> 8) & 0xff, in_port & 0xff);
+  memset(&flow_mod, 0, sizeof(flow_mod));
+  flow_mod.command = (uint8_t)command;
+  flow_mod.table_id = 0;
+  flow_mod.priority = 1;
+  flow_mod.out_port = OFPP_ANY;
+  flow_mod.out_group = OFPG_ANY;
+
+  if (command == OFPFC_ADD) {
+    return flowdb_flow_add(bridge, &flow_mod, &match_list,
+                           &instruction_list, &error);
+  }
+  return flowdb_flow_delete(bridge, &flow_mod, &match_list, &error);
+}
+
+static void *
+reader_loop(void *arg) {
+  struct reader_arg *rarg;
+  struct lagopus_packet *pkt;
+  struct flowdb *flowdb;
+  struct table *table;
+  struct flow *flow;
+  uint64_t start, elapsed;
+
+  rarg = arg;
+  pkt = rarg->pkt;
+  flowdb = rarg->bridge->flowdb;
+  while (benchmark_loop == true) {
+    /* same as one packet burst of forwarding thread. */
+    start = benchmark_now_nsec();
+    flowdb_epoch_enter(flowdb);
+    table = table_lookup(flowdb, pkt->table_id);
+    flow = lagopus_find_flow(pkt, table);
+    if (flow == NULL) {
+      rarg->miss_count++;
+    }
+    flowdb_epoch_exit(flowdb);
+    elapsed = benchmark_now_nsec() - start;
+    if (elapsed > rarg->max_nsec) {
+      rarg->max_nsec = elapsed;
+    }
+    rarg->lookup_count++;
+  }
+  return NULL;
+}
+
+static void
+multibridge_benchmark(bool churn, time_t sec) {
+  struct reader_arg rargs[NUMBER_OF_BRIDGES];
+  struct port *port;
+  uint64_t start, write_count;
+  int i;
+
+  benchmark_loop = true;
+  for (i = 0; i < NUMBER_OF_BRIDGES; i++) {
+    /* the flow always matched by readers. */
+    TEST_ASSERT_EQUAL(in_port_flow_mod(bridges[i], OFPFC_ADD, 1),
+                      LAGOPUS_RESULT_OK);
+    port = port_lookup(&bridges[i]->ports, 1);
+    TEST_ASSERT_NOT_NULL(port);
+    rargs[i].bridge = bridges[i];
+    rargs[i].pkt = alloc_lagopus_packet();
+    TEST_ASSERT_NOT_NULL(rargs[i].pkt);
+    rargs[i].pkt->table_id = 0;
+    rargs[i].pkt->cache = NULL;
+    OS_M_APPEND(PKT2MBUF(rargs[i].pkt), 64);
+    lagopus_packet_init(rargs[i].pkt, PKT2MBUF(rargs[i].pkt), port);
+    rargs[i].lookup_count = 0;
+    rargs[i].miss_count = 0;
+    rargs[i].max_nsec = 0;
+    TEST_ASSERT_EQUAL(pthread_create(&rargs[i].tid, NULL,
+                                     reader_loop, &rargs[i]), 0);
+  }
+
+  benchmark_timer_set(sec);
+  write_count = 0;
+  while (benchmark_loop == true) {
+    if (churn == true) {
+      /* modify br1 in place, as group/meter mod or rebuild does. */
+      flowdb_wrlock(bridges[1]->flowdb);
+      start = benchmark_now_nsec();
+      while (benchmark_now_nsec() - start < WRITER_HOLD_USEC * 1000) {
+        /* hold */
+      }
+      flowdb_wrunlock(bridges[1]->flowdb);
+      write_count++;
+    }
+    usleep(WRITER_HOLD_USEC);
+  }
+
+  for (i = 0; i < NUMBER_OF_BRIDGES; i++) {
+    pthread_join(rargs[i].tid, NULL);
+    lagopus_packet_free(rargs[i].pkt);
+    TEST_ASSERT_EQUAL(in_port_flow_mod(bridges[i], OFPFC_DELETE_STRICT, 1),
+                      LAGOPUS_RESULT_OK);
+  }
+
+  if (churn == true) {
+    benchmark_print_rate("br1 in place write", write_count, sec);
+  }
+  for (i = 0; i < NUMBER_OF_BRIDGES; i++) {
+    printf("*** br%d lookup max latency: %" PRIu64 " usec\n",
+           i, rargs[i].max_nsec / 1000);
+    benchmark_print_rate(i == 0 ? "br0 lookup" : "br1 lookup",
+               rargs[i].lookup_count, sec);
+    TEST_ASSERT_NOT_EQUAL(rargs[i].lookup_count, 0);
+    TEST_ASSERT_EQUAL(rargs[i].miss_count, 0);
+  }
+}
+
+void
+test_multibridge_idle_benchmark(void) {
+  printf("******** 2 bridges, no writer **********************\n");
+  multibridge_benchmark(false, 3);
+}
+
+void
+test_multibridge_churn_benchmark(void) {
+  printf("******** 2 bridges, br1 modified in place **********\n");
+  multibridge_benchmark(true, 3);
+}
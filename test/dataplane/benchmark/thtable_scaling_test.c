@@ -0,0 +1,206 @@
+/*
+ * Copyright 2014-2016 Nippon Telegraph and Telephone Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Tuple space search (thtable) against the default flowinfo tree
+ * with a wildcard-heavy ACL, where most flows have their own mask.
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/queue.h>
+
+#include "unity.h"
+#include "lagopus/dp_apis.h"
+#include "lagopus/dataplane.h"
+#include "lagopus/flowdb.h"
+#include "lagopus/flowinfo.h"
+#include "lagopus/port.h"
+#include "pktbuf.h"
+#include "packet.h"
+
+#include "datapath_test_misc.h"
+#include "benchmark_util.h"
+
+/* source and destination prefix length, with or without port. */
+#define NMASK (33 * 33 * 2)
+
+static struct flow **test_flows;
+static struct flow **results;
+static struct lagopus_packet *pkt;
+static struct port port;
+
+void
+setUp(void) {
+  benchmark_setup();
+
+  pkt = benchmark_tcp_packet_alloc(&port);
+}
+
+void
+tearDown(void) {
+  lagopus_packet_free(pkt);
+  benchmark_teardown();
+}
+
+static void
+add_prefix_match(struct flow *flow, int field, uint32_t addr, int plen) {
+  uint32_t mask;
+
+  if (plen == 0) {
+    return;
+  }
+  mask = (uint32_t)~0 << (32 - plen);
+  add_match(&flow->match_list, 8, (field << 1) + 1,
+            addr >> 24, (addr >> 16) & 0xff, (addr >> 8) & 0xff, addr & 0xff,
+            mask >> 24, (mask >> 16) & 0xff, (mask >> 8) & 0xff,
+            mask & 0xff);
+}
+
+/*
+ * ACL entry i: source and destination prefixes of different length,
+ * and TCP destination port in half of masks.  Priority is unique.
+ */
+static struct flow *
+acl_flow_alloc(int i) {
+  struct flow *flow;
+  int mask;
+
+  mask = i % NMASK;
+  flow = allocate_test_flow(10 * sizeof(struct match));
+  TEST_ASSERT_NOT_NULL(flow);
+  flow->priority = (uint16_t)i;
+  add_match(&flow->match_list, 2, OFPXMT_OFB_ETH_TYPE << 1, 0x08, 0x00);
+  add_prefix_match(flow, OFPXMT_OFB_IPV4_SRC, 0x0a000000 + (uint32_t)i,
+                   mask % 33);
+  add_prefix_match(flow, OFPXMT_OFB_IPV4_DST, 0xc0a80000 + (uint32_t)i,
+                   (mask / 33) % 33);
+  if (mask / (33 * 33) == 0) {
+    add_match(&flow->match_list, 1, OFPXMT_OFB_IP_PROTO << 1, IPPROTO_TCP);
+    add_match(&flow->match_list, 2, OFPXMT_OFB_TCP_DST << 1,
+              (i >> 8) & 0xff, i & 0xff);
+  }
+  refresh_match(flow);
+  return flow;
+}
+
+static void
+set_packet(int i) {
+  uint8_t *p;
+  uint32_t src, dst;
+
+  src = 0x0a000000 + (uint32_t)i;
+  dst = 0xc0a80000 + (uint32_t)i;
+  p = OS_MTOD(PKT2MBUF(pkt), uint8_t *);
+  p[26] = (uint8_t)(src >> 24);
+  p[27] = (uint8_t)(src >> 16);
+  p[28] = (uint8_t)(src >> 8);
+  p[29] = (uint8_t)src;
+  p[30] = (uint8_t)(dst >> 24);
+  p[31] = (uint8_t)(dst >> 16);
+  p[32] = (uint8_t)(dst >> 8);
+  p[33] = (uint8_t)dst;
+  p[36] = (uint8_t)(i >> 8);
+  p[37] = (uint8_t)i;
+}
+
+/*
+ * Add, lookup packets built from every entry, and delete.  Lookup
+ * results are kept to compare classifiers.
+ */
+static void
+classifier_benchmark(const char *name, struct flowinfo *flowinfo,
+                     int nflow, bool compare) {
+  struct flow *flow;
+  uint64_t start, nmiss;
+  int32_t prio;
+  int i;
+
+  printf("**** %s\n", name);
+  start = benchmark_now_nsec();
+  for (i = 0; i < nflow; i++) {
+    TEST_ASSERT_EQUAL(flowinfo->add_func(flowinfo, test_flows[i]),
+                      LAGOPUS_RESULT_OK);
+  }
+  benchmark_print_latency("add", benchmark_now_nsec() - start, (uint64_t)nflow);
+
+  nmiss = 0;
+  start = benchmark_now_nsec();
+  for (i = 0; i < nflow; i++) {
+    set_packet(i);
+    prio = -1;
+    flow = flowinfo->match_func(flowinfo, pkt, &prio);
+    if (compare == true) {
+      if (flow != results[i]) {
+        nmiss++;
+      }
+    } else {
+      results[i] = flow;
+    }
+  }
+  benchmark_print_latency("lookup", benchmark_now_nsec() - start,
+                          (uint64_t)nflow);
+  TEST_ASSERT_EQUAL(nmiss, 0);
+
+  start = benchmark_now_nsec();
+  for (i = 0; i < nflow; i++) {
+    TEST_ASSERT_EQUAL(flowinfo->del_func(flowinfo, test_flows[i]),
+                      LAGOPUS_RESULT_OK);
+  }
+  benchmark_print_latency("del", benchmark_now_nsec() - start, (uint64_t)nflow);
+  TEST_ASSERT_EQUAL(flowinfo->nflow, 0);
+  flowinfo->destroy_func(flowinfo);
+}
+
+static void
+thtable_benchmark(int nflow) {
+  int i;
+
+  printf("******** ACL %d flows, %d masks ********\n",
+         nflow, nflow < NMASK ? nflow : NMASK);
+  test_flows = calloc((size_t)nflow, sizeof(struct flow *));
+  results = calloc((size_t)nflow, sizeof(struct flow *));
+  TEST_ASSERT_NOT_NULL(test_flows);
+  TEST_ASSERT_NOT_NULL(results);
+  for (i = 0; i < nflow; i++) {
+    test_flows[i] = acl_flow_alloc(i);
+  }
+
+  classifier_benchmark("flowinfo", new_flowinfo_vlan_vid(), nflow, false);
+  classifier_benchmark("thtable", new_flowinfo_thtable(), nflow, true);
+
+  for (i = 0; i < nflow; i++) {
+    free_test_flow(test_flows[i]);
+  }
+  free(test_flows);
+  free(results);
+}
+
+void
+test_thtable_1k_benchmark(void) {
+  thtable_benchmark(1000);
+}
+
+void
+test_thtable_10k_benchmark(void) {
+  thtable_benchmark(10000);
+}
+
+void
+test_thtable_50k_benchmark(void) {
+  thtable_benchmark(50000);
+}
@@ -21,6 +21,7 @@
 #include "lagopus/dp_apis.h"
 #include "lagopus/port.h"
 #include "lagopus/bridge.h"
+#include "lagopus/ofcache.h"
 #include "dpdk/dpdk.h"
 #include "dpdk/pktbuf.h"
 #include "ofproto/packet.h"
@@ -29,13 +30,19 @@
 
 #define DPID 0x1LL
 #define IN_PORT 1
+#define BURST_SIZE 32
 
 lagopus_result_t
 lagopus_packet_init(struct lagopus_packet *pkt, void *m, struct port *port);
 lagopus_result_t
 lagopus_match_and_action(struct lagopus_packet *pkt);
+void
+lagopus_bulk_match_and_action(struct lagopus_packet *pkts[], size_t npkts,
+                              struct flowcache *cache);
 
 static struct table *table = NULL;
+static struct flowcache *cache = NULL;
+static struct port sample_port = {0};
 
 lagopus_result_t
 setup_modules(int argc,
@@ -141,3 +148,95 @@ match_pkts(void *pkts, size_t size) {
 
   return ret;
 }
+
+lagopus_result_t
+setup_match_and_action(void *pkts, size_t size) {
+  lagopus_result_t ret = LAGOPUS_RESULT_ANY_FAILURES;
+  size_t i;
+  struct rte_mbuf **mbufs;
+  struct lagopus_packet *pkt = NULL;
+  struct bridge *bridge = NULL;
+
+  if (pkts != NULL) {
+    mbufs = pkts;
+
+    bridge = dp_bridge_lookup_by_dpid(DPID);
+    if (bridge != NULL) {
+      if (cache == NULL) {
+        cache = init_flowcache(FLOWCACHE_CUCKOO);
+        if (cache == NULL) {
+          ret = LAGOPUS_RESULT_NO_MEMORY;
+          lagopus_perror(ret);
+          goto done;
+        }
+      }
+      sample_port.ofp_port.port_no = IN_PORT;
+      sample_port.bridge = bridge;
+
+      for (i = 0; i < size; i++) {
+        /* packets are consumed by target func, keep them. */
+        rte_mbuf_refcnt_update(mbufs[i], 1);
+        pkt = MBUF2PKT(mbufs[i]);
+        lagopus_packet_init(pkt, mbufs[i], &sample_port);
+        pkt->cache = cache;
+      }
+
+      ret = LAGOPUS_RESULT_OK;
+    } else {
+      ret = LAGOPUS_RESULT_NOT_FOUND;
+      lagopus_perror(ret);
+    }
+  } else {
+    ret = LAGOPUS_RESULT_INVALID_ARGS;
+    lagopus_perror(ret);
+  }
+
+ done:
+  return ret;
+}
+
+lagopus_result_t
+match_and_action_pkts(void *pkts, size_t size) {
+  lagopus_result_t ret = LAGOPUS_RESULT_ANY_FAILURES;
+  size_t i;
+  struct rte_mbuf **mbufs;
+
+  if (pkts != NULL) {
+    mbufs = pkts;
+    for (i = 0; i < size; i++) {
+      (void) lagopus_match_and_action(MBUF2PKT(mbufs[i]));
+    }
+    ret = LAGOPUS_RESULT_OK;
+  } else {
+    ret = LAGOPUS_RESULT_INVALID_ARGS;
+    lagopus_perror(ret);
+  }
+
+  return ret;
+}
+
+lagopus_result_t
+bulk_match_and_action_pkts(void *pkts, size_t size) {
+  lagopus_result_t ret = LAGOPUS_RESULT_ANY_FAILURES;
+  size_t i, n;
+  struct rte_mbuf **mbufs;
+  struct lagopus_packet *burst[BURST_SIZE];
+
+  if (pkts != NULL) {
+    mbufs = pkts;
+    n = 0;
+    for (i = 0; i < size; i++) {
+      burst[n++] = MBUF2PKT(mbufs[i]);
+      if (n == BURST_SIZE || i == size - 1) {
+        lagopus_bulk_match_and_action(burst, n, cache);
+        n = 0;
+      }
+    }
+    ret = LAGOPUS_RESULT_OK;
+  } else {
+    ret = LAGOPUS_RESULT_INVALID_ARGS;
+    lagopus_perror(ret);
+  }
+
+  return ret;
+}
@@ -37,4 +37,13 @@ teardown(void *pkts, size_t size);
 lagopus_result_t
 match_pkts(void *pkts, size_t size);
 
+lagopus_result_t
+setup_match_and_action(void *pkts, size_t size);
+
+lagopus_result_t
+match_and_action_pkts(void *pkts, size_t size);
+
+lagopus_result_t
+bulk_match_and_action_pkts(void *pkts, size_t size);
+
 #endif /*__BENCHMARK_MATCH_PKTS_H__ */